@@ -0,0 +1,149 @@
+/*--
+    Bench.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Bench.h"
+#include "Corpus.h"
+#include "Golden.h"
+#include "Tracing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+
+std::vector<BenchCase *> &BenchCase::allBenchmarks()
+{
+    static std::vector<BenchCase *> _allBenchmarks;
+    return _allBenchmarks;
+}
+
+double Samples::percentile(double p) const
+{
+    if(_samples.empty())
+        return 0.;
+    if(!_sorted)
+    {
+        sort(_samples.begin(), _samples.end());
+        _sorted = true;
+    }
+    int rank = (int)ceil(p * 0.01 * _samples.size()) - 1;
+    return _samples[std::max(0, std::min(rank, (int)_samples.size() - 1))];
+}
+
+double Samples::mean() const
+{
+    double sum = 0.;
+    for(int i = 0; i < (int)_samples.size(); ++i)
+        sum += _samples[i];
+    return _samples.empty() ? 0. : sum / _samples.size();
+}
+
+struct BenchComparator
+{
+    bool operator()(BenchCase *b1, BenchCase *b2) const { return b1->name() < b2->name(); }
+};
+
+static void usage()
+{
+    printf("Usage: CornucopiaBench [-reps N] [-only NAME] [-record FILE | -check FILE [-tolerance T] [-slower PERCENT]] [-trace FILE] [SKETCHFILE...]\n");
+    printf("  -reps N     how many times each benchmark repeats its work (default 5)\n");
+    printf("  -only NAME  run only the benchmarks whose name contains NAME\n");
+    printf("  -record     instead of benchmarking, record the corpus's fits and stage times in a golden file\n");
+    printf("  -check      instead of benchmarking, compare the fits and stage times with a golden file\n");
+    printf("  -tolerance  the relative difference in objectives and lengths -check allows (default 1e-6)\n");
+    printf("  -slower     the stage slowdown -check allows, in percent (default 25)\n");
+    printf("  -trace      write a trace of the fits in the Chrome trace event format (see Tracing.h)\n");
+    printf("  SKETCHFILE  sketch files (see SketchFile.h) whose strokes are added to the corpus\n");
+}
+
+int main(int argc, char **argv)
+{
+    int reps = 5;
+    string only, recordFile, checkFile, traceFile;
+    GoldenOptions goldenOptions;
+    for(int i = 1; i < argc; ++i)
+    {
+        if(!strcmp(argv[i], "-reps") && i + 1 < argc)
+            reps = max(1, atoi(argv[++i]));
+        else if(!strcmp(argv[i], "-only") && i + 1 < argc)
+            only = argv[++i];
+        else if(!strcmp(argv[i], "-record") && i + 1 < argc)
+            recordFile = argv[++i];
+        else if(!strcmp(argv[i], "-check") && i + 1 < argc)
+            checkFile = argv[++i];
+        else if(!strcmp(argv[i], "-trace") && i + 1 < argc)
+            traceFile = argv[++i];
+        else if(!strcmp(argv[i], "-tolerance") && i + 1 < argc)
+            goldenOptions.tolerance = atof(argv[++i]);
+        else if(!strcmp(argv[i], "-slower") && i + 1 < argc)
+            goldenOptions.maxSlowdownPercent = atof(argv[++i]);
+        else if(argv[i][0] == '-')
+        {
+            usage();
+            return 1;
+        }
+        else if(!Corpus::addSketchFile(argv[i]))
+        {
+            printf("Could not read sketch file %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if(!traceFile.empty())
+        Cornu::Tracing::start();
+
+    bool ok = true;
+    goldenOptions.reps = reps;
+    if(!recordFile.empty())
+        ok = recordGolden(recordFile, goldenOptions);
+    else if(!checkFile.empty())
+        ok = checkGolden(checkFile, goldenOptions);
+    else
+    {
+        std::sort(BenchCase::allBenchmarks().begin(), BenchCase::allBenchmarks().end(), BenchComparator());
+
+        for(int i = 0; i < (int)BenchCase::allBenchmarks().size(); ++i)
+        {
+            BenchCase *bench = BenchCase::allBenchmarks()[i];
+            if(bench->name().find(only) == string::npos)
+                continue;
+            printf("==== %s ====\n", bench->name().c_str());
+            bench->run(reps);
+            printf("\n");
+        }
+    }
+
+    if(!traceFile.empty())
+    {
+        Cornu::Tracing::stop();
+        ofstream out(traceFile.c_str());
+        if(!Cornu::Tracing::writeChromeTrace(out))
+        {
+            printf("Could not write trace file %s\n", traceFile.c_str());
+            ok = false;
+        }
+    }
+
+    return ok ? 0 : 1;
+}
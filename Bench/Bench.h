@@ -0,0 +1,77 @@
+/*--
+    Bench.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_BENCH_H_INCLUDED
+#define CORNUCOPIA_BENCH_H_INCLUDED
+
+#include <vector>
+#include <string>
+#include <chrono>
+
+namespace Cornu {}
+namespace Eigen {}
+
+//Benchmarks register themselves like test cases (see Test.h) and print their own reports
+class BenchCase
+{
+public:
+    BenchCase()
+    {
+        allBenchmarks().push_back(this);
+    }
+
+    virtual ~BenchCase()
+    {
+        //should not be called
+    }
+
+    virtual void run(int reps) = 0; //reps scales how long the benchmark runs
+    virtual std::string name() { return "Unnamed"; }
+
+    static std::vector<BenchCase *> &allBenchmarks(); //Meyer's singleton
+};
+
+typedef std::chrono::steady_clock BenchClock;
+
+inline double secondsSince(BenchClock::time_point start)
+{
+    return std::chrono::duration<double>(BenchClock::now() - start).count();
+}
+
+//Collects samples (e.g. latencies) and reports their percentiles
+class Samples
+{
+public:
+    Samples() : _sorted(false) {}
+
+    void add(double x) { _samples.push_back(x); _sorted = false; }
+    int size() const { return (int)_samples.size(); }
+    bool empty() const { return _samples.empty(); }
+
+    double percentile(double p) const; //p in [0, 100], nearest rank
+    double mean() const;
+    double max() const { return percentile(100.); }
+
+private:
+    mutable std::vector<double> _samples;
+    mutable bool _sorted;
+};
+
+#endif //CORNUCOPIA_BENCH_H_INCLUDED
@@ -0,0 +1,172 @@
+/*--
+    Corpus.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Corpus.h"
+#include "SketchFile.h"
+
+#include <cmath>
+#include <cstdio>
+
+using namespace std;
+using namespace Eigen;
+using namespace Cornu;
+
+static VectorC<Vector2d> makeVector(const Curve::PointVector &pts)
+{
+    VectorC<Vector2d> out((int)pts.size(), NOT_CIRCULAR);
+    for(int i = 0; i < out.size(); ++i)
+        out[i] = pts[i];
+    return out;
+}
+
+//Points along a piecewise linear path through corners, spaced about step apart, with some noise
+static Curve::PointVector throughCorners(const Curve::PointVector &corners, double step, double noise, CorpusRandom &random)
+{
+    Curve::PointVector out;
+    for(int i = 0; i + 1 < (int)corners.size(); ++i)
+    {
+        Vector2d dir = corners[i + 1] - corners[i];
+        int num = max(1, (int)(dir.norm() / step));
+        for(int j = 0; j < num; ++j)
+            out.push_back(corners[i] + dir * (double(j) / num) + noise * Vector2d(random.uniform(-1, 1), random.uniform(-1, 1)));
+    }
+    out.push_back(corners.back());
+    return out;
+}
+
+static vector<CorpusStroke> syntheticStrokes()
+{
+    vector<CorpusStroke> out;
+    CorpusRandom random(12345);
+    Curve::PointVector pts;
+    CorpusStroke stroke;
+
+    //a short, nearly straight stroke
+    pts.clear();
+    for(int i = 0; i < 12; ++i)
+        pts.push_back(Vector2d(100 + 4 * i, 100 + 0.02 * i * i));
+    stroke.name = "short line";
+    stroke.pts = new Polyline(makeVector(pts));
+    out.push_back(stroke);
+
+    //a short arc
+    pts.clear();
+    for(int i = 0; i < 25; ++i)
+        pts.push_back(Vector2d(200, 200) + 60 * Vector2d(cos(0.05 * i), sin(0.05 * i)));
+    stroke.name = "short arc";
+    stroke.pts = new Polyline(makeVector(pts));
+    out.push_back(stroke);
+
+    //a long smooth wave
+    pts.clear();
+    for(int i = 0; i < 1000; ++i)
+        pts.push_back(Vector2d(2 * i, 80 * sin(0.01 * i) + 30 * sin(0.037 * i)));
+    stroke.name = "long wave";
+    stroke.pts = new Polyline(makeVector(pts));
+    out.push_back(stroke);
+
+    //a wave with the kind of noise a tablet adds
+    pts.clear();
+    for(int i = 0; i < 300; ++i)
+        pts.push_back(Vector2d(3 * i, 50 * sin(0.03 * i)) + 1.5 * Vector2d(random.uniform(-1, 1), random.uniform(-1, 1)));
+    stroke.name = "noisy wave";
+    stroke.pts = new Polyline(makeVector(pts));
+    out.push_back(stroke);
+
+    //a circle that ends where it started, so it gets closed
+    pts.clear();
+    for(int i = 0; i <= 200; ++i)
+        pts.push_back(Vector2d(300, 300) + 100 * Vector2d(cos(2 * PI * i / 200), sin(2 * PI * i / 200)) + 0.5 * Vector2d(random.uniform(-1, 1), random.uniform(-1, 1)));
+    stroke.name = "closed circle";
+    stroke.pts = new Polyline(makeVector(pts));
+    out.push_back(stroke);
+
+    //a closed square with four corners
+    Curve::PointVector corners;
+    corners.push_back(Vector2d(0, 0));
+    corners.push_back(Vector2d(200, 0));
+    corners.push_back(Vector2d(200, 200));
+    corners.push_back(Vector2d(0, 200));
+    corners.push_back(Vector2d(0, 0));
+    stroke.name = "closed square";
+    stroke.pts = new Polyline(makeVector(throughCorners(corners, 3., 0.5, random)));
+    out.push_back(stroke);
+
+    //a zigzag with many corners
+    corners.clear();
+    for(int i = 0; i < 16; ++i)
+        corners.push_back(Vector2d(40 * i, (i % 2) ? 80 : 0));
+    stroke.name = "zigzag";
+    stroke.pts = new Polyline(makeVector(throughCorners(corners, 3., 0.3, random)));
+    out.push_back(stroke);
+
+    //a spiral, where the curvature changes steadily as in a clothoid
+    pts.clear();
+    for(int i = 0; i < 400; ++i)
+    {
+        double angle = 0.03 * i, radius = 20 + 0.5 * i;
+        pts.push_back(Vector2d(400, 400) + radius * Vector2d(cos(angle), sin(angle)));
+    }
+    stroke.name = "spiral";
+    stroke.pts = new Polyline(makeVector(pts));
+    out.push_back(stroke);
+
+    //an S drawn with uneven speed, so the samples are denser in some places than others
+    pts.clear();
+    for(double t = 0; t < 1.; t += 0.002 + 0.006 * fabs(sin(3 * PI * t)))
+        pts.push_back(Vector2d(300 * t, 100 * sin(2 * PI * t)) + 0.7 * Vector2d(random.uniform(-1, 1), random.uniform(-1, 1)));
+    stroke.name = "uneven S";
+    stroke.pts = new Polyline(makeVector(pts));
+    out.push_back(stroke);
+
+    return out;
+}
+
+std::vector<CorpusStroke> &Corpus::_strokes()
+{
+    static vector<CorpusStroke> strokes = syntheticStrokes();
+    return strokes;
+}
+
+const std::vector<CorpusStroke> &Corpus::strokes()
+{
+    return _strokes();
+}
+
+bool Corpus::addSketchFile(const std::string &fileName)
+{
+    MappedFile file(fileName);
+    if(!file.isOpen())
+        return false;
+    SketchFileView view(file.data(), file.size());
+    if(!view.isValid())
+        return false;
+
+    for(int i = 0; i < view.numSketches(); ++i)
+    {
+        CorpusStroke stroke;
+        char suffix[20];
+        sprintf(suffix, " #%d", i);
+        stroke.name = fileName + suffix;
+        stroke.pts = view.polyline(i); //copies the points, so the file can be closed
+        _strokes().push_back(stroke);
+    }
+    return true;
+}
@@ -0,0 +1,64 @@
+/*--
+    Corpus.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_CORPUS_H_INCLUDED
+#define CORNUCOPIA_CORPUS_H_INCLUDED
+
+#include "Polyline.h"
+
+#include <string>
+#include <vector>
+
+//A linear congruential generator, so the noise doesn't depend on the platform's rand()
+class CorpusRandom
+{
+public:
+    CorpusRandom(unsigned seed) : _state(seed) {}
+
+    double uniform(double from, double to)
+    {
+        _state = _state * 1664525u + 1013904223u;
+        return from + (to - from) * (_state >> 8) / double(1 << 24);
+    }
+
+private:
+    unsigned _state;
+};
+
+struct CorpusStroke
+{
+    std::string name;
+    Cornu::PolylineConstPtr pts;
+};
+
+//The strokes the fitting benchmarks run on.  The synthetic strokes use their own random number
+//generator, so they are the same on every platform and every run; recorded strokes are added from
+//sketch files.
+class Corpus
+{
+public:
+    static const std::vector<CorpusStroke> &strokes();
+    static bool addSketchFile(const std::string &fileName); //returns false if the file can't be read
+
+private:
+    static std::vector<CorpusStroke> &_strokes(); //Meyer's singleton
+};
+
+#endif //CORNUCOPIA_CORPUS_H_INCLUDED
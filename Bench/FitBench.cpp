@@ -0,0 +1,117 @@
+/*--
+    FitBench.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Bench.h"
+#include "Corpus.h"
+#include "Fitter.h"
+
+#include <cstdio>
+
+using namespace std;
+using namespace Eigen;
+using namespace Cornu;
+
+//Fits the whole corpus with every preset, and with every alternative algorithm for each stage
+//(the rest of the parameters default), and reports the latency of each stage and the throughput.
+class FitBench : public BenchCase
+{
+public:
+    //override
+    std::string name() { return "FitBench"; }
+
+    //override
+    void run(int reps)
+    {
+        const vector<CorpusStroke> &strokes = Corpus::strokes();
+        printf("%d strokes, %d repetitions; latencies in microseconds\n", (int)strokes.size(), reps);
+
+        for(int i = 0; i < Parameters::NUM_PRESETS; ++i)
+            runConfiguration(Parameters::presets()[i].name(), Parameters::presets()[i], reps);
+
+        for(int stage = 0; stage < NUM_ALGORITHM_STAGES; ++stage)
+        {
+            for(int alg = 1; alg < AlgorithmBase::numAlgorithmsForStage((AlgorithmStage)stage); ++alg)
+            {
+                Parameters params;
+                params.setAlgorithm(stage, alg);
+                AlgorithmBase *algorithm = AlgorithmBase::get((AlgorithmStage)stage, alg);
+                runConfiguration(algorithm->stageName() + ": " + algorithm->name(), params, reps);
+            }
+        }
+    }
+
+private:
+    void runConfiguration(const string &configName, const Parameters &params, int reps)
+    {
+        const vector<CorpusStroke> &strokes = Corpus::strokes();
+
+        //one untimed pass, so lazily built tables don't count against the first stroke
+        for(int i = 0; i < (int)strokes.size(); ++i)
+            fit(strokes[i], params);
+
+        vector<Samples> stageSamples(NUM_ALGORITHM_STAGES);
+        Samples totalSamples;
+        WorkCounters counters;
+        int numFailed = 0;
+        BenchClock::time_point start = BenchClock::now();
+        for(int rep = 0; rep < reps; ++rep)
+        {
+            for(int i = 0; i < (int)strokes.size(); ++i)
+            {
+                Fitter fitter;
+                FitStats stats = fit(strokes[i], params, &fitter);
+                numFailed += !fitter.finalOutput();
+                for(int stage = 0; stage < NUM_ALGORITHM_STAGES; ++stage)
+                    stageSamples[stage].add(stats.stageNanoseconds[stage] * 1e-3);
+                totalSamples.add(stats.totalNanoseconds * 1e-3);
+                counters += stats.counters;
+            }
+        }
+        double seconds = secondsSince(start);
+
+        printf("%s: %.1f strokes/sec", configName.c_str(), totalSamples.size() / seconds);
+        if(numFailed)
+            printf(", %d fits FAILED", numFailed);
+        printf("\n    %-22s %10s %10s\n", "stage", "p50", "p99");
+        for(int stage = 0; stage < NUM_ALGORITHM_STAGES; ++stage)
+        {
+            string stageName = AlgorithmBase::get((AlgorithmStage)stage, 0)->stageName();
+            printf("    %-22s %10.1f %10.1f\n", stageName.c_str(), stageSamples[stage].percentile(50), stageSamples[stage].percentile(99));
+        }
+        printf("    %-22s %10.1f %10.1f\n", "Total", totalSamples.percentile(50), totalSamples.percentile(99));
+#if CORNU_COUNTERS
+        printf("    %-30s %12s\n", "work per stroke", "mean");
+        for(int i = 0; i < WorkCounters::NUM_COUNTERS; ++i)
+            printf("    %-30s %12.1f\n", WorkCounters::name((WorkCounters::Counter)i), double(counters.counts[i]) / totalSamples.size());
+#endif
+    }
+
+    static FitStats fit(const CorpusStroke &stroke, const Parameters &params, Fitter *fitter = NULL)
+    {
+        Fitter local;
+        if(!fitter)
+            fitter = &local;
+        fitter->setParams(params);
+        fitter->setOriginalSketch(stroke.pts);
+        return fitter->run();
+    }
+};
+
+static FitBench bench;
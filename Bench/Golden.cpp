@@ -0,0 +1,285 @@
+/*--
+    Golden.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Golden.h"
+#include "Bench.h"
+#include "Corpus.h"
+#include "Fitter.h"
+#include "Preprocessing.h"
+#include "PrimitiveFitter.h"
+#include "GraphConstructor.h"
+#include "PathFinder.h"
+#include "Combiner.h"
+#include "PrimitiveSequence.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+using namespace std;
+using namespace Eigen;
+using namespace Cornu;
+
+namespace
+{
+
+//below this, a stage's time over the corpus is too short to compare
+const double minComparedMicroseconds = 1000.;
+
+struct GoldenFit
+{
+    GoldenFit() : numResampled(0), numPrimitives(0), objective(0.), length(0.) {}
+
+    int numResampled;
+    string path; //the primitive types and the continuities between them, as in the path finder's debugging output
+    int numPrimitives;
+    double objective;
+    double length;
+};
+
+struct GoldenTimes
+{
+    double stageMicroseconds[NUM_ALGORITHM_STAGES];
+};
+
+struct Golden
+{
+    map<string, GoldenFit> fits; //by preset and stroke name, separated by a tab
+    map<string, GoldenTimes> times; //by preset
+};
+
+string pathString(const Fitter &fitter)
+{
+    const vector<int> &path = fitter.output<PATH_FINDING>()->path;
+    if(path.empty())
+        return "none";
+
+    const vector<FitPrimitive> &primitives = fitter.output<PRIMITIVE_FITTING>()->primitives;
+    const AlgorithmOutput<GRAPH_CONSTRUCTION> &graph = *fitter.output<GRAPH_CONSTRUCTION>();
+    bool closed = fitter.output<CURVE_CLOSING>()->closed;
+    const char curveTypes[3] = { 'L', 'A', 'C' }; //line, arc, clothoid
+
+    ostringstream out;
+    for(int i = 0; i < (int)path.size(); ++i)
+    {
+        const Edge &edge = graph.edges[path[i]];
+        out << curveTypes[primitives[edge.startVtx].curve->getType()];
+        if(edge.continuity == -1)
+            break;
+        out << "-" << (int)edge.continuity << "-";
+        if(!closed && i + 1 == (int)path.size())
+            out << curveTypes[primitives[edge.endVtx].curve->getType()];
+    }
+    return out.str();
+}
+
+Golden fitCorpus(const GoldenOptions &options)
+{
+    const vector<CorpusStroke> &strokes = Corpus::strokes();
+    Golden out;
+    for(int i = 0; i < Parameters::NUM_PRESETS; ++i)
+    {
+        const Parameters &params = Parameters::presets()[i];
+        vector<Samples> stageSamples(NUM_ALGORITHM_STAGES);
+        //one more pass than timed, so lazily built tables don't count; it also records the fits
+        for(int rep = 0; rep <= options.reps; ++rep)
+        {
+            long long stageNanoseconds[NUM_ALGORITHM_STAGES] = { 0 };
+            for(int j = 0; j < (int)strokes.size(); ++j)
+            {
+                Fitter fitter;
+                fitter.setParams(params);
+                fitter.setOriginalSketch(strokes[j].pts);
+                const FitStats &stats = fitter.run();
+                for(int stage = 0; stage < NUM_ALGORITHM_STAGES; ++stage)
+                    stageNanoseconds[stage] += stats.stageNanoseconds[stage];
+                if(rep > 0)
+                    continue;
+
+                GoldenFit &fit = out.fits[params.name() + "\t" + strokes[j].name];
+                fit.numResampled = stats.numResampledPoints;
+                fit.path = pathString(fitter);
+                PrimitiveSequenceConstPtr curve = fitter.finalOutput();
+                fit.numPrimitives = curve ? curve->primitives().size() : 0;
+                fit.objective = fitter.output<COMBINING>()->objective;
+                fit.length = curve ? curve->length() : 0.;
+            }
+            for(int stage = 0; rep > 0 && stage < NUM_ALGORITHM_STAGES; ++stage)
+                stageSamples[stage].add(stageNanoseconds[stage] * 1e-3);
+        }
+        for(int stage = 0; stage < NUM_ALGORITHM_STAGES; ++stage)
+            out.times[params.name()].stageMicroseconds[stage] = stageSamples[stage].percentile(50);
+    }
+    return out;
+}
+
+//Nothing in the names contains tabs, and spaces in stroke names or the rest are untouched
+vector<string> splitTabs(const string &line)
+{
+    vector<string> out;
+    istringstream in(line);
+    string field;
+    while(getline(in, field, '\t'))
+        out.push_back(field);
+    return out;
+}
+
+bool readGolden(const string &fileName, Golden &out)
+{
+    ifstream in(fileName.c_str());
+    if(!in)
+        return false;
+
+    string line;
+    while(getline(in, line))
+    {
+        vector<string> fields = splitTabs(line);
+        if(fields.size() == 8 && fields[0] == "fit")
+        {
+            GoldenFit &fit = out.fits[fields[1] + "\t" + fields[2]];
+            fit.numResampled = atoi(fields[3].c_str());
+            fit.path = fields[4];
+            fit.numPrimitives = atoi(fields[5].c_str());
+            fit.objective = atof(fields[6].c_str());
+            fit.length = atof(fields[7].c_str());
+        }
+        else if(fields.size() == 2 + NUM_ALGORITHM_STAGES && fields[0] == "time")
+        {
+            for(int stage = 0; stage < NUM_ALGORITHM_STAGES; ++stage)
+                out.times[fields[1]].stageMicroseconds[stage] = atof(fields[2 + stage].c_str());
+        }
+        else if(!line.empty() && line[0] != '#')
+            return false;
+    }
+    return true;
+}
+
+bool near(double x, double golden, double tolerance)
+{
+    return fabs(x - golden) <= tolerance * max(1., fabs(golden));
+}
+
+} //namespace
+
+bool recordGolden(const std::string &fileName, const GoldenOptions &options)
+{
+    Golden golden = fitCorpus(options);
+
+    ofstream out(fileName.c_str());
+    out << "#fit\tpreset\tstroke\tresampled points\tpath\tprimitives\tobjective\tlength\n";
+    out << "#time\tpreset";
+    for(int stage = 0; stage < NUM_ALGORITHM_STAGES; ++stage)
+        out << "\t" << AlgorithmBase::get((AlgorithmStage)stage, 0)->stageName() << " (us)";
+    out << "\n";
+
+    out.precision(17);
+    for(map<string, GoldenFit>::const_iterator it = golden.fits.begin(); it != golden.fits.end(); ++it)
+    {
+        const GoldenFit &fit = it->second;
+        out << "fit\t" << it->first << "\t" << fit.numResampled << "\t" << fit.path << "\t" << fit.numPrimitives
+            << "\t" << fit.objective << "\t" << fit.length << "\n";
+    }
+    out.precision(6);
+    for(map<string, GoldenTimes>::const_iterator it = golden.times.begin(); it != golden.times.end(); ++it)
+    {
+        out << "time\t" << it->first;
+        for(int stage = 0; stage < NUM_ALGORITHM_STAGES; ++stage)
+            out << "\t" << it->second.stageMicroseconds[stage];
+        out << "\n";
+    }
+
+    printf("Recorded %d fits in %s\n", (int)golden.fits.size(), fileName.c_str());
+    return bool(out);
+}
+
+bool checkGolden(const std::string &fileName, const GoldenOptions &options)
+{
+    Golden golden;
+    if(!readGolden(fileName, golden))
+    {
+        printf("Could not read golden file %s\n", fileName.c_str());
+        return false;
+    }
+    Golden current = fitCorpus(options);
+
+    int numDiffering = 0, numSlower = 0;
+    for(map<string, GoldenFit>::const_iterator it = current.fits.begin(); it != current.fits.end(); ++it)
+    {
+        string name = it->first;
+        name[name.find('\t')] = '/';
+        if(!golden.fits.count(it->first))
+        {
+            printf("%s: not in the golden file\n", name.c_str());
+            ++numDiffering;
+            continue;
+        }
+        const GoldenFit &fit = it->second, &goldenFit = golden.fits[it->first];
+        ostringstream diffs;
+        if(fit.numResampled != goldenFit.numResampled)
+            diffs << " resampled points " << fit.numResampled << " (was " << goldenFit.numResampled << ")";
+        if(fit.path != goldenFit.path)
+            diffs << " path " << fit.path << " (was " << goldenFit.path << ")";
+        if(fit.numPrimitives != goldenFit.numPrimitives)
+            diffs << " primitives " << fit.numPrimitives << " (was " << goldenFit.numPrimitives << ")";
+        if(!near(fit.objective, goldenFit.objective, options.tolerance))
+            diffs << " objective " << fit.objective << " (was " << goldenFit.objective << ")";
+        if(!near(fit.length, goldenFit.length, options.tolerance))
+            diffs << " length " << fit.length << " (was " << goldenFit.length << ")";
+        if(!diffs.str().empty())
+        {
+            printf("%s:%s\n", name.c_str(), diffs.str().c_str());
+            ++numDiffering;
+        }
+    }
+    for(map<string, GoldenFit>::const_iterator it = golden.fits.begin(); it != golden.fits.end(); ++it)
+    {
+        if(!current.fits.count(it->first))
+        {
+            string name = it->first;
+            name[name.find('\t')] = '/';
+            printf("%s: in the golden file but not in the corpus\n", name.c_str());
+            ++numDiffering;
+        }
+    }
+
+    printf("%-16s %-22s %12s %12s %8s\n", "preset", "stage", "golden (us)", "now (us)", "change");
+    for(map<string, GoldenTimes>::const_iterator it = current.times.begin(); it != current.times.end(); ++it)
+    {
+        if(!golden.times.count(it->first))
+            continue;
+        for(int stage = 0; stage < NUM_ALGORITHM_STAGES; ++stage)
+        {
+            double now = it->second.stageMicroseconds[stage], was = golden.times[it->first].stageMicroseconds[stage];
+            if(max(now, was) < minComparedMicroseconds)
+                continue;
+            double change = 100. * (now - was) / max(was, 1e-3);
+            bool slower = change > options.maxSlowdownPercent;
+            numSlower += slower;
+            printf("%-16s %-22s %12.1f %12.1f %+7.1f%%%s\n", it->first.c_str(), AlgorithmBase::get((AlgorithmStage)stage, 0)->stageName().c_str(),
+                   was, now, change, slower ? "  SLOWER" : "");
+        }
+    }
+
+    printf("%d of %d fits differ, %d stage times regressed by more than %g%%\n", numDiffering, (int)current.fits.size(),
+           numSlower, options.maxSlowdownPercent);
+    return numDiffering == 0 && numSlower == 0;
+}
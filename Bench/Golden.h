@@ -0,0 +1,43 @@
+/*--
+    Golden.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_GOLDEN_H_INCLUDED
+#define CORNUCOPIA_GOLDEN_H_INCLUDED
+
+#include <string>
+
+//A safety net for changes that should keep fits the same: the corpus is fitted with every preset, and for
+//every stroke the number of resampled points, the chosen path, the number of primitives, the final objective
+//and the curve length are recorded in a golden file along with each stage's time over the corpus.  Checking
+//fits again and fails if a fit differs, or a stage got slower, by more than the tolerances.
+//The file is text, one tab-separated record per line, so differences can be read with diff.
+struct GoldenOptions
+{
+    GoldenOptions() : reps(5), tolerance(1e-6), maxSlowdownPercent(25.) {}
+
+    int reps; //the times are the medians over this many fits of the corpus
+    double tolerance; //relative, for the objective and the length
+    double maxSlowdownPercent;
+};
+
+bool recordGolden(const std::string &fileName, const GoldenOptions &options); //returns false if the file can't be written
+bool checkGolden(const std::string &fileName, const GoldenOptions &options); //prints the differences, returns false if any
+
+#endif //CORNUCOPIA_GOLDEN_H_INCLUDED
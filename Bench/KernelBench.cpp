@@ -0,0 +1,266 @@
+/*--
+    KernelBench.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Bench.h"
+#include "Corpus.h"
+#include "Fitter.h"
+#include "Fresnel.h"
+#include "Clothoid.h"
+#include "Arc.h"
+#include "Solver.h"
+#include "GraphConstructor.h"
+#include "Combiner.h"
+#include "TwoCurveCombine.h"
+
+#include <cstdio>
+#include <cmath>
+
+using namespace std;
+using namespace Eigen;
+using namespace Cornu;
+
+static volatile double sink; //results are added here so the compiler can't drop the work
+
+static void report(const char *what, double seconds, double numOps)
+{
+    printf("    %-36s %12.1f ns/op\n", what, 1e9 * seconds / numOps);
+}
+
+//Times the library's innermost kernels on their own
+class KernelBench : public BenchCase
+{
+public:
+    //override
+    std::string name() { return "KernelBench"; }
+
+    //override
+    void run(int reps)
+    {
+        fresnelBench(reps);
+        projectBench(reps);
+        transformBench(reps);
+        denseSolveBench(reps);
+        fitterBench(reps);
+    }
+
+private:
+    typedef void (*ScalarFresnel)(double, double *, double *);
+    typedef void (*VectorFresnel)(const VectorXd &, VectorXd *, VectorXd *);
+
+    //the arguments and the reference are the ones FresnelTest uses: fresnel on [-5, 5]
+    void fresnelBench(int reps)
+    {
+        printf("Fresnel integrals, relative error against fresnel on [-5, 5]\n");
+        const int num = 100000;
+        VectorXd t(num), sRef, cRef;
+        for(int i = 0; i < num; ++i)
+            t[i] = (double(i) / double(num)) * 10. - 5.;
+        fresnel(t, &sRef, &cRef);
+
+        const char *names[3] = { "fresnel", "fresnelApprox", "fresnelTable" };
+        ScalarFresnel scalar[3] = { &fresnel, &fresnelApprox, &fresnelTable };
+        VectorFresnel vectorized[3] = { &fresnel, &fresnelApprox, &fresnelTable };
+
+        for(int k = 0; k < 3; ++k)
+        {
+            double sum = 0, s, c;
+            BenchClock::time_point start = BenchClock::now();
+            for(int rep = 0; rep < reps; ++rep)
+            {
+                for(int i = 0; i < num; ++i)
+                {
+                    scalar[k](t[i], &s, &c);
+                    sum += s + c;
+                }
+            }
+            report((string(names[k]) + " (scalar)").c_str(), secondsSince(start), double(reps) * num);
+
+            VectorXd sv, cv;
+            start = BenchClock::now();
+            for(int rep = 0; rep < reps; ++rep)
+            {
+                vectorized[k](t, &sv, &cv);
+                sum += sv[rep] + cv[rep];
+            }
+            report((string(names[k]) + " (VectorXd)").c_str(), secondsSince(start), double(reps) * num);
+            sink += sum;
+
+            ArrayXd diffSq = (sv - sRef).array().square() + (cv - cRef).array().square();
+            double relErr = (diffSq / (sRef.array().square() + cRef.array().square())).sqrt().maxCoeff();
+            printf("    %-36s %12.3g\n", "max relative error", relErr);
+        }
+    }
+
+    void projectBench(int reps)
+    {
+        printf("Projection onto a single primitive\n");
+        CorpusRandom random(1);
+        const int numCurves = 100, numPts = 100;
+        vector<CurvePrimitiveConstPtr> arcs, clothoids;
+        for(int i = 0; i < numCurves; ++i)
+        {
+            double length = random.uniform(1., 10.), curvature = random.uniform(-0.5, 0.5);
+            arcs.push_back(new Arc(Vector2d::Zero(), random.uniform(-PI, PI), length, curvature));
+            clothoids.push_back(new Clothoid(Vector2d::Zero(), random.uniform(-PI, PI), length, curvature, random.uniform(-0.5, 0.5)));
+        }
+        Curve::PointVector pts(numPts);
+        for(int i = 0; i < numPts; ++i)
+            pts[i] = Vector2d(random.uniform(-10., 10.), random.uniform(-10., 10.));
+
+        const char *names[2] = { "Arc::project", "Clothoid::project" };
+        const vector<CurvePrimitiveConstPtr> *curves[2] = { &arcs, &clothoids };
+        for(int k = 0; k < 2; ++k)
+        {
+            double sum = 0;
+            BenchClock::time_point start = BenchClock::now();
+            for(int rep = 0; rep < reps; ++rep)
+                for(int i = 0; i < numCurves; ++i)
+                    for(int j = 0; j < numPts; ++j)
+                        sum += (*curves[k])[i]->project(pts[j]);
+            report(names[k], secondsSince(start), double(reps) * numCurves * numPts);
+            sink += sum;
+        }
+    }
+
+    //moving curves, e.g., as they're dragged, against making them again from the moved parameters
+    void transformBench(int reps)
+    {
+        printf("Moving a clothoid by a similarity\n");
+        CorpusRandom random(3);
+        const int numCurves = 1000;
+        vector<ClothoidPtr> clothoids;
+        for(int i = 0; i < numCurves; ++i)
+        {
+            double length = random.uniform(1., 10.), curvature = random.uniform(-0.5, 0.5);
+            clothoids.push_back(new Clothoid(Vector2d::Zero(), random.uniform(-PI, PI), length, curvature, random.uniform(-0.5, 0.5)));
+        }
+        //a small drag, so the curves don't drift off
+        Similarity similarity(1.001, 0.001, Vector2d(0.5, -0.5)), back = similarity.inverse();
+
+        double sum = 0;
+        BenchClock::time_point start = BenchClock::now();
+        for(int rep = 0; rep < reps * 10; ++rep)
+            for(int i = 0; i < numCurves; ++i)
+            {
+                clothoids[i]->transform((rep & 1) ? back : similarity);
+                sum += clothoids[i]->params()[CurvePrimitive::X];
+            }
+        report("Clothoid::transform", secondsSince(start), double(reps) * 10 * numCurves);
+
+        start = BenchClock::now();
+        for(int rep = 0; rep < reps * 10; ++rep)
+            for(int i = 0; i < numCurves; ++i)
+            {
+                CurvePrimitive::ParamVec params = clothoids[i]->params();
+                params.head<2>() = ((rep & 1) ? back : similarity) * Vector2d(params.head<2>());
+                clothoids[i]->setParams(params);
+                sum += clothoids[i]->params()[CurvePrimitive::X];
+            }
+        report("Clothoid::setParams", secondsSince(start), double(reps) * 10 * numCurves);
+        sink += sum;
+    }
+
+    //a two-curve sized problem: 12 variables and a residual per sample
+    void denseSolveBench(int reps)
+    {
+        printf("Dense least squares step (LSDenseEvalData)\n");
+        CorpusRandom random(2);
+        const int numVars = 12, numResiduals = 60, num = 2000;
+        LSDenseEvalData data;
+        data.errVectorRef() = VectorXd(numResiduals);
+        data.errDerRef() = MatrixXd(numResiduals, numVars);
+        for(int i = 0; i < numResiduals; ++i)
+        {
+            data.errVectorRef()[i] = random.uniform(-1., 1.);
+            for(int j = 0; j < numVars; ++j)
+                data.errDerRef()(i, j) = random.uniform(-1., 1.);
+        }
+
+        VectorXd delta(numVars);
+        double sum = 0;
+        BenchClock::time_point start = BenchClock::now();
+        for(int rep = 0; rep < reps * num; ++rep)
+        {
+            set<LSBoxConstraint> constraints;
+            data.solveForDelta(1., delta, constraints);
+            sum += delta[0];
+        }
+        report("solveForDelta", secondsSince(start), double(reps) * num);
+
+        int signs[numVars] = { 0 };
+        start = BenchClock::now();
+        for(int rep = 0; rep < reps * num; ++rep)
+        {
+            unsigned activeVars = 0;
+            data.solveForDeltaSmall(1., delta, activeVars, signs);
+            sum += delta[0];
+        }
+        report("solveForDeltaSmall", secondsSince(start), double(reps) * num);
+        sink += sum;
+    }
+
+    //The two-curve and multicurve problems need a fit's intermediate results, so this fits the corpus and
+    //reruns those parts on the outputs.  The multicurve problem (and its sparse solve) is internal to the
+    //combiner, so the whole combining stage is timed, and divided by its LS iterations too.
+    void fitterBench(int reps)
+    {
+        printf("Problems solved on the corpus fits\n");
+        const vector<CorpusStroke> &strokes = Corpus::strokes();
+        double combineSeconds = 0, twoCurveSeconds = 0, sum = 0;
+        int numCombines = 0, numIterations = 0, numTwoCurve = 0;
+        for(int i = 0; i < (int)strokes.size(); ++i)
+        {
+            Fitter fitter;
+            fitter.setOriginalSketch(strokes[i].pts);
+            fitter.run();
+            if(!fitter.finalOutput())
+                continue;
+
+            //every edge once--there are thousands
+            const vector<Edge> &edges = fitter.output<GRAPH_CONSTRUCTION>()->edges;
+            BenchClock::time_point start = BenchClock::now();
+            for(int j = 0; j < (int)edges.size(); ++j)
+            {
+                if(edges[j].continuity < 0)
+                    continue;
+                Combination combination = twoCurveCombine(edges[j].startVtx, edges[j].endVtx, edges[j].continuity, fitter);
+                sum += combination.err1;
+                ++numTwoCurve;
+            }
+            twoCurveSeconds += secondsSince(start);
+
+            AlgorithmBase *combiner = AlgorithmBase::get(COMBINING, fitter.params().getAlgorithm(COMBINING));
+            start = BenchClock::now();
+            for(int rep = 0; rep < reps; ++rep)
+            {
+                AlgorithmOutputBasePtr out = combiner->run(fitter);
+                numIterations += static_cast<const AlgorithmOutput<COMBINING> *>(out.get())->lsIterations;
+                ++numCombines;
+            }
+            combineSeconds += secondsSince(start);
+        }
+        report("twoCurveCombine", twoCurveSeconds, numTwoCurve);
+        report("combining stage", combineSeconds, numCombines);
+        report("combining stage, per LS iteration", combineSeconds, max(1, numIterations));
+        sink += sum;
+    }
+};
+
+static KernelBench bench;
@@ -0,0 +1,99 @@
+/*--
+    PipelineBench.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "Bench.h"
+#include "Corpus.h"
+#include "FitPipeline.h"
+#include "PrimitiveSequence.h"
+
+#include <cstdio>
+#include <cmath>
+
+using namespace std;
+using namespace Cornu;
+
+//Compares the throughput of fitting the corpus one stroke after another with one Fitter
+//to pushing it through FitPipeline's with different ways of splitting the stages between threads.
+class PipelineBench : public BenchCase
+{
+public:
+    //override
+    std::string name() { return "PipelineBench"; }
+
+    //override
+    void run(int reps)
+    {
+        const vector<CorpusStroke> &strokes = Corpus::strokes();
+        printf("%d strokes, %d repetitions\n", (int)strokes.size(), reps);
+
+        Parameters params;
+        Fitter fitter;
+        fitter.setParams(params);
+        double length = 0.;
+        BenchClock::time_point start = BenchClock::now();
+        for(int rep = 0; rep < reps; ++rep)
+        {
+            for(int i = 0; i < (int)strokes.size(); ++i)
+            {
+                fitter.reset();
+                fitter.setOriginalSketch(strokes[i].pts);
+                fitter.run();
+                if(fitter.finalOutput())
+                    length += fitter.finalOutput()->length();
+            }
+        }
+        report("Serial", reps * (int)strokes.size(), secondsSince(start), length, length);
+
+        runPipeline("Pipeline (default stages)", params, FitPipeline::defaultThreadFirstStages(), reps, length);
+        runPipeline("Pipeline (every stage)", params, FitPipeline::everyStage(), reps, length);
+    }
+
+private:
+    static void runPipeline(const string &configName, const Parameters &params, const vector<AlgorithmStage> &threadFirstStages,
+                            int reps, double serialLength)
+    {
+        const vector<CorpusStroke> &strokes = Corpus::strokes();
+
+        double length = 0.;
+        BenchClock::time_point start = BenchClock::now();
+        {
+            FitPipeline pipeline(params, threadFirstStages);
+            FitPipeline::Result result;
+            for(int rep = 0; rep < reps; ++rep)
+            {
+                for(int i = 0; i < (int)strokes.size(); ++i)
+                    pipeline.submit(strokes[i].pts);
+                while(pipeline.takeResult(result))
+                    if(result.curve)
+                        length += result.curve->length();
+            }
+        }
+        report(configName, reps * (int)strokes.size(), secondsSince(start), length, serialLength);
+    }
+
+    static void report(const string &configName, int numStrokes, double seconds, double length, double serialLength)
+    {
+        printf("%s: %.1f strokes/sec", configName.c_str(), numStrokes / seconds);
+        if(fabs(length - serialLength) > 1e-6 * serialLength)
+            printf(", total length %lf DIFFERS from serial %lf", length, serialLength);
+        printf("\n");
+    }
+};
+
+static PipelineBench bench;
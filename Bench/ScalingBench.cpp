@@ -0,0 +1,224 @@
+/*--
+    ScalingBench.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Bench.h"
+#include "Corpus.h"
+#include "Fitter.h"
+
+#include <cmath>
+#include <cstdio>
+
+using namespace std;
+using namespace Eigen;
+using namespace Cornu;
+
+static const int minPoints = 100;
+static const int maxPoints = 51200;
+static const double step = 2.; //between the sketch points, about the resampling's spacing
+static const double maxSecondsPerFit = 20.;
+static const double maxGraphEdges = 2e7; //the graph takes about 80 bytes per edge
+static const double superlinearSlope = 1.25; //above which a measure is marked
+
+//Fits synthetic strokes of each shape at doubling lengths and reports how each stage's time and the sizes of
+//the intermediate results grow with the length: the slope of a least squares line through them on a log-log
+//plot against the number of sketch points, which is 1 for a stage that is linear in the length and 2 for a
+//quadratic one.  Scale detection is off, so a stroke twice as long isn't scaled down; the resampling still
+//decides how many points it keeps (few on a line), so those are reported too.  A shape's sweep stops once the
+//growth so far predicts that the next length would take longer than maxSecondsPerFit or make more than
+//maxGraphEdges edges, so a stage that blows up doesn't keep the benchmark from finishing.
+class ScalingBench : public BenchCase
+{
+public:
+    //override
+    std::string name() { return "ScalingBench"; }
+
+    //override
+    void run(int reps)
+    {
+        printf("Slopes of log(time or size) against log(sketch points), %d repetitions per length; times in milliseconds\n", reps);
+        for(int shape = 0; shape < NUM_SHAPES; ++shape)
+            runShape((Shape)shape, reps);
+    }
+
+private:
+    enum Shape
+    {
+        LINE,
+        SPIRAL,
+        ZIGZAG,
+        CLOSED_LOOP,
+        NUM_SHAPES
+    };
+
+    enum Measure
+    {
+        NUM_CANDIDATES = NUM_ALGORITHM_STAGES, //the measures after the stage times
+        NUM_EDGES,
+        NUM_VALIDATED,
+        TOTAL_TIME,
+        NUM_MEASURES
+    };
+
+    static const char *shapeName(Shape shape)
+    {
+        static const char *names[NUM_SHAPES] = { "line", "spiral", "zigzag", "closed loop" };
+        return names[shape];
+    }
+
+    static string measureName(int measure)
+    {
+        if(measure < NUM_ALGORITHM_STAGES)
+            return AlgorithmBase::get((AlgorithmStage)measure, 0)->stageName();
+        static const char *names[NUM_MEASURES - NUM_ALGORITHM_STAGES] = { "candidates", "graph edges", "validated edges", "Total" };
+        return names[measure - NUM_ALGORITHM_STAGES];
+    }
+
+    //numPts points about step apart, with a little noise, so a long stroke has the same features as a short one
+    static PolylineConstPtr makeStroke(Shape shape, int numPts)
+    {
+        CorpusRandom random(numPts);
+        VectorC<Vector2d> pts(numPts, NOT_CIRCULAR);
+        double angle = 0.;
+        for(int i = 0; i < numPts; ++i)
+        {
+            switch(shape)
+            {
+            case LINE:
+                pts[i] = Vector2d(step * i, 0.);
+                break;
+            case SPIRAL: //an Archimedean spiral whose turns are 60 apart, so the curvature keeps changing
+            {
+                double radius = 20. + 60. * angle / (2. * PI);
+                pts[i] = radius * Vector2d(cos(angle), sin(angle));
+                angle += step / radius;
+                break;
+            }
+            case ZIGZAG: //a corner every 40 points
+            {
+                int phase = i % 80;
+                pts[i] = Vector2d(step * i, step * (phase < 40 ? phase : 80 - phase));
+                break;
+            }
+            case CLOSED_LOOP: //a circle that ends where it started
+            {
+                double radius = step * (numPts - 1) / (2. * PI);
+                pts[i] = radius * Vector2d(cos(2. * PI * i / (numPts - 1)), sin(2. * PI * i / (numPts - 1)));
+                break;
+            }
+            default:
+                break;
+            }
+            pts[i] += 0.3 * Vector2d(random.uniform(-1, 1), random.uniform(-1, 1));
+        }
+        if(shape == CLOSED_LOOP)
+            pts[numPts - 1] = pts[0];
+        return new Polyline(pts);
+    }
+
+    void runShape(Shape shape, int reps)
+    {
+        Parameters params;
+        params.setAlgorithm(SCALE_DETECTION, 1); //no scale detection
+
+        vector<double> logPoints;
+        vector<vector<double> > logMeasures(NUM_MEASURES);
+        vector<bool> measured(NUM_MEASURES, true); //false once a measure is zero at some length: it has no slope
+
+        printf("%s:\n    %10s %10s %10s %12s %12s %10s %10s\n", shapeName(shape), "points", "resampled", "total", "candidates", "edges", "validated", "peak MB");
+        for(int numPts = minPoints; numPts <= maxPoints; numPts *= 2)
+        {
+            PolylineConstPtr stroke = makeStroke(shape, numPts);
+            vector<Samples> stageSamples(NUM_ALGORITHM_STAGES);
+            Samples totalSamples;
+            FitStats stats;
+            for(int rep = 0; rep < reps; ++rep)
+            {
+                Fitter fitter;
+                fitter.setParams(params);
+                fitter.setOriginalSketch(stroke);
+                stats = fitter.run();
+                for(int stage = 0; stage < NUM_ALGORITHM_STAGES; ++stage)
+                    stageSamples[stage].add(stats.stageNanoseconds[stage] * 1e-6);
+                totalSamples.add(stats.totalNanoseconds * 1e-6);
+            }
+
+            vector<double> values(NUM_MEASURES);
+            for(int stage = 0; stage < NUM_ALGORITHM_STAGES; ++stage)
+                values[stage] = stageSamples[stage].percentile(50);
+            values[NUM_CANDIDATES] = stats.numCandidatePrimitives;
+            values[NUM_EDGES] = stats.numGraphEdges;
+            values[NUM_VALIDATED] = stats.numValidatedEdges;
+            values[TOTAL_TIME] = totalSamples.percentile(50);
+            printf("    %10d %10d %10.2f %12d %12d %10d %10.1f\n", numPts, stats.numResampledPoints, values[TOTAL_TIME],
+                   stats.numCandidatePrimitives, stats.numGraphEdges, stats.numValidatedEdges, stats.peakBytes / 1048576.);
+
+            logPoints.push_back(log(double(numPts)));
+            for(int i = 0; i < NUM_MEASURES; ++i)
+            {
+                measured[i] = measured[i] && values[i] > 0.;
+                logMeasures[i].push_back(measured[i] ? log(values[i]) : 0.);
+            }
+
+            //the next length multiplies each by about as much as this one did
+            if(numPts * 2 <= maxPoints && (predictNext(logMeasures[TOTAL_TIME], measured[TOTAL_TIME]) > 1000. * maxSecondsPerFit ||
+                                           predictNext(logMeasures[NUM_EDGES], measured[NUM_EDGES]) > maxGraphEdges))
+            {
+                printf("    (stopped: the next length would take too long or make too many edges)\n");
+                break;
+            }
+        }
+
+        printf("    slopes:\n");
+        for(int i = 0; i < NUM_MEASURES; ++i)
+        {
+            if(!measured[i] || logPoints.size() < 3)
+                continue;
+            double slope = fitSlope(logPoints, logMeasures[i]);
+            printf("    %-26s %8.2f%s\n", measureName(i).c_str(), slope, slope > superlinearSlope ? "  SUPERLINEAR" : "");
+        }
+    }
+
+    //the next value of a measure that doubles or more with each length, from its last two (logarithmic) values
+    static double predictNext(const vector<double> &logValues, bool measured)
+    {
+        int n = (int)logValues.size();
+        if(!measured || n == 0)
+            return 0.;
+        double growth = n > 1 ? max(log(2.), logValues[n - 1] - logValues[n - 2]) : log(2.);
+        return exp(logValues[n - 1] + growth);
+    }
+
+    //of the least squares line through the points (x[i], y[i])
+    static double fitSlope(const vector<double> &x, const vector<double> &y)
+    {
+        double n = (double)x.size(), sx = 0., sy = 0., sxx = 0., sxy = 0.;
+        for(int i = 0; i < (int)x.size(); ++i)
+        {
+            sx += x[i];
+            sy += y[i];
+            sxx += x[i] * x[i];
+            sxy += x[i] * y[i];
+        }
+        double denom = n * sxx - sx * sx;
+        return denom > 0. ? (n * sxy - sx * sy) / denom : 0.;
+    }
+};
+
+static ScalingBench bench;
@@ -34,30 +34,34 @@ using namespace std;
 using namespace Eigen;
 NAMESPACE_Cornu
 
-std::vector<std::vector<AlgorithmBase *> > AlgorithmBase::_algorithms(NUM_ALGORITHM_STAGES);
 bool AlgorithmBase::_initializationFinished = false;
 
+std::vector<std::vector<AlgorithmBase *> > &AlgorithmBase::_algorithms()
+{
+    static std::vector<std::vector<AlgorithmBase *> > algorithms(NUM_ALGORITHM_STAGES);
+    return algorithms;
+}
+
 const std::vector<std::vector<AlgorithmBase *> > &AlgorithmBase::_getAlgorithms()
 {
-    _initialize();
-    return _algorithms;
+    //The registration runs exactly once, the first time any thread gets here--other threads wait for it
+    static const bool initialized = _initialize();
+    (void)initialized;
+    return _algorithms();
 }
 
 void AlgorithmBase::_addAlgorithm(int stage, AlgorithmBase *algorithm)
 {
     if(_initializationFinished)
     {
-        Debugging::get()->printf("ERROR: Attempting to create algorithm too late!");
+        CORNU_DEBUG(printf("ERROR: Attempting to create algorithm too late!"));
         return; //Noop
     }
-    _algorithms[stage].push_back(algorithm);
+    _algorithms()[stage].push_back(algorithm);
 }
 
-void AlgorithmBase::_initialize()
+bool AlgorithmBase::_initialize()
 {
-    if(_initializationFinished)
-        return;
-
     Algorithm<SCALE_DETECTION>::_initialize();
     Algorithm<PRELIM_RESAMPLING>::_initialize();
     Algorithm<CURVE_CLOSING>::_initialize();
@@ -71,6 +75,7 @@ void AlgorithmBase::_initialize()
     Algorithm<COMBINING>::_initialize();
 
     _initializationFinished = true;
+    return true;
 }
 
 END_NAMESPACE_Cornu
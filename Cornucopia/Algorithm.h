@@ -49,10 +49,21 @@ enum AlgorithmStage
 
 struct AlgorithmOutputBase : public smart_base
 {
+    AlgorithmOutputBase() : degraded(false) {}
+
+    //About how many bytes the output holds in its vectors and in the objects only it points to (see FitStats).
+    //It goes by the sizes rather than the elements, so it's cheap enough to check after every stage.
+    virtual size_t memoryBytes() const { return 0; }
+
+    bool degraded; //whether the stage cut its work short because the fitter's time budget ran out (see Fitter::setTimeBudget)
 };
 
 CORNU_SMART_TYPEDEFS(AlgorithmOutputBase);
 
+//the bytes a vector has allocated, for memoryBytes
+template<typename Vector>
+size_t vectorBytes(const Vector &v) { return v.capacity() * sizeof(typename Vector::value_type); }
+
 //The output of an algorithm stage.  It is specialized for every stage.
 template<int AlgStage>
 struct AlgorithmOutput : public AlgorithmOutputBase
@@ -71,7 +82,10 @@ class AlgorithmBase
 public:
     virtual std::string name() const { return "Default"; }
     virtual std::string stageName() const = 0;
-    virtual AlgorithmOutputBasePtr run(const Fitter &) = 0;
+    //An output of this stage that is no longer needed can be passed in to be cleared and filled again, which
+    //keeps the memory of its vectors (it's only used if nothing else points to it)
+    virtual AlgorithmOutputBasePtr run(const Fitter &fitter, AlgorithmOutputBasePtr recycled = AlgorithmOutputBasePtr()) = 0;
+    virtual void clearOutput(AlgorithmOutputBase &output) const = 0; //output must be of this stage
 
     static int numAlgorithmsForStage(AlgorithmStage stage) { return (int)_getAlgorithms()[stage].size(); }
     static AlgorithmBase *get(AlgorithmStage stage, int algorithm) { return _getAlgorithms()[stage][algorithm]; }
@@ -82,8 +96,8 @@ protected:
 
 private:
     static bool _initializationFinished;
-    static void _initialize();
-    static std::vector<std::vector<AlgorithmBase *> > _algorithms;
+    static bool _initialize();
+    static std::vector<std::vector<AlgorithmBase *> > &_algorithms();
 };
 
 template<int AlgStage>
@@ -91,17 +105,31 @@ class AlgorithmBaseTemplate : public AlgorithmBase
 {
 public:
     //override
-    AlgorithmOutputBasePtr run(const Fitter &fitter)
+    AlgorithmOutputBasePtr run(const Fitter &fitter, AlgorithmOutputBasePtr recycled = AlgorithmOutputBasePtr())
     {
-        smart_ptr<AlgorithmOutput<AlgStage> > out = new AlgorithmOutput<AlgStage>();
+        smart_ptr<AlgorithmOutput<AlgStage> > out;
+        if(recycled.unique())
+        {
+            out = static_pointer_cast<AlgorithmOutput<AlgStage> >(recycled);
+            clearOutput(*out);
+        }
+        else
+            out = new AlgorithmOutput<AlgStage>();
         _run(fitter, *out);
         return out;
     }
 
+    //override
+    void clearOutput(AlgorithmOutputBase &output) const
+    {
+        static const AlgorithmOutput<AlgStage> empty = AlgorithmOutput<AlgStage>();
+        static_cast<AlgorithmOutput<AlgStage> &>(output) = empty; //copying (not moving) an empty vector keeps the memory
+    }
+
     static std::vector<std::string> names()
     {
         std::vector<std::string> out;
-        for(int i = 0; i < (int)_getAlgorithms().size(); ++i)
+        for(int i = 0; i < (int)_getAlgorithms()[AlgStage].size(); ++i)
             out.push_back(_getAlgorithms()[AlgStage][i]->name());
 
         return out;
@@ -19,6 +19,7 @@
 */
 
 #include "Arc.h"
+#include "WorkCounters.h"
 
 using namespace std;
 using namespace Eigen;
@@ -48,6 +49,14 @@ void Arc::_paramsChanged()
         Vec toCenter(-_tangent[1], _tangent[0]);
         _radius = 1. / _params[CURVATURE];
         _center = _startPos() + _radius * toCenter;
+
+        //rotate the direction from the center to the start by half of _angleDiff and then by all of it
+        double cosHalf = cos(0.5 * _angleDiff), sinHalf = sin(0.5 * _angleDiff);
+        Vec fromCenter = _startPos() - _center;
+        Vec midFromCenter(cosHalf * fromCenter[0] - sinHalf * fromCenter[1], sinHalf * fromCenter[0] + cosHalf * fromCenter[1]);
+        _midDir = midFromCenter / fabs(_radius);
+        _cosHalfSpan = cosHalf;
+        _end = _center + Vec(cosHalf * midFromCenter[0] - sinHalf * midFromCenter[1], sinHalf * midFromCenter[0] + cosHalf * midFromCenter[1]);
     }
 }
 
@@ -65,7 +74,7 @@ bool Arc::isValidImpl() const
 void Arc::eval(double s, Vec *pos, Vec *der, Vec *der2) const
 {
     double angle = _startAngle() + s * _params[CURVATURE];
-    double cosa, sina;
+    double cosa = 1., sina = 0.; //a flat arc without derivatives doesn't use them
     if(!_flat || der || der2)
     {
         cosa = cos(angle);
@@ -85,6 +94,7 @@ void Arc::eval(double s, Vec *pos, Vec *der, Vec *der2) const
 
 double Arc::project(const Vec &point) const
 {
+    CORNU_COUNT(ARC_PROJECTIONS, 1);
     double t;
     if(_flat)
     {
@@ -110,6 +120,70 @@ double Arc::project(const Vec &point) const
     return max(0., min(_length(), t));
 }
 
+void Arc::evalMany(const double *s, int n, Vec *pos, Vec *der, Vec *der2) const
+{
+    for(int i = 0; i < n; ++i)
+        Arc::eval(s[i], pos ? pos + i : NULL, der ? der + i : NULL, der2 ? der2 + i : NULL);
+}
+
+void Arc::projectMany(const Vec *points, int n, double *out) const
+{
+    for(int i = 0; i < n; ++i)
+        out[i] = Arc::project(points[i]);
+}
+
+//A point whose direction from the center is within half the span of the arc from its middle is closest to the
+//circle there, and other points are closest to an endpoint.  This is the same closest point as project finds,
+//without the trigonometry.
+double Arc::distanceSqTo(const Vec &point) const
+{
+    double out;
+    Arc::distanceSqMany(&point, 1, &out);
+    return out;
+}
+
+//The loop has no branches or calls, so the compiler vectorizes it
+void Arc::distanceSqMany(const Vec *points, int n, double *out) const
+{
+    const double startX = _params[X], startY = _params[Y];
+    if(_flat) //same approximation as eval
+    {
+        const double dirX = _tangent[0], dirY = _tangent[1], length = _length();
+        for(int i = 0; i < n; ++i)
+        {
+            double x = points[i][0] - startX, y = points[i][1] - startY;
+            double t = min(length, max(0., dirX * x + dirY * y));
+            x -= t * dirX;
+            y -= t * dirY;
+            out[i] = x * x + y * y;
+        }
+        return;
+    }
+
+    const double centerX = _center[0], centerY = _center[1], midX = _midDir[0], midY = _midDir[1];
+    const double endX = _end[0], endY = _end[1], radius = fabs(_radius), cosHalfSpan = _cosHalfSpan;
+    for(int i = 0; i < n; ++i)
+    {
+        double x = points[i][0] - centerX, y = points[i][1] - centerY;
+        double dist = sqrt(x * x + y * y);
+        double toCircle = (dist - radius) * (dist - radius);
+        double sx = points[i][0] - startX, sy = points[i][1] - startY;
+        double ex = points[i][0] - endX, ey = points[i][1] - endY;
+        double toEnd = min(sx * sx + sy * sy, ex * ex + ey * ey);
+        out[i] = (midX * x + midY * y >= dist * cosHalfSpan) ? toCircle : toEnd;
+    }
+}
+
+//The curvature is constant, so equal steps of the longest length the tolerance allows, rounded down to fit
+void Arc::tessellate(double tolerance, PointVector &out) const
+{
+    int steps = max(1, (int)ceil(_length() / _tessellationStep(tolerance, _params[CURVATURE])));
+    size_t first = out.size();
+    out.resize(first + steps + 1);
+    for(int i = 0; i <= steps; ++i)
+        Arc::eval(_length() * i / steps, &(out[first + i]));
+}
+
 void Arc::trim(double sFrom, double sTo)
 {
     Vec newStart = pos(sFrom);
@@ -39,6 +39,11 @@ public:
     void eval(double s, Vec *pos, Vec *der = NULL, Vec *der2 = NULL) const;
 
     double project(const Vec &point) const;
+    void evalMany(const double *s, int n, Vec *pos, Vec *der = NULL, Vec *der2 = NULL) const;
+    void projectMany(const Vec *points, int n, double *out) const;
+    double distanceSqTo(const Vec &point) const;
+    void distanceSqMany(const Vec *points, int n, double *out) const;
+    void tessellate(double tolerance, PointVector &out) const;
 
     double angle(double s) const { return _startAngle() + s * _params[CURVATURE]; }
     double curvature(double s) const { return _params[CURVATURE]; }
@@ -59,17 +64,23 @@ public:
     Vec center() const { return _center; }
     double radius() const { return _radius; }
 
-    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 protected:
     //override
     void _paramsChanged();
     bool isValidImpl() const;
 
 private:
+    friend struct PrimitiveValue;
+
     Vec _tangent; //at start
     Vec _center; //if arc is not flat
     double _radius; //if arc is not flat, 1 / curvature
     double _angleDiff; //length * curvature
+    //for distances to an arc that is not flat: the direction from the center to the midpoint, the cosine of
+    //half of the angle the arc spans, and the end point
+    Vec _midDir;
+    double _cosHalfSpan;
+    Vec _end;
     bool _flat; //if true, arc is almost flat and we should use an approximation
 };
 
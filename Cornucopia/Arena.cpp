@@ -0,0 +1,132 @@
+/*--
+    Arena.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Arena.h"
+#include "defs.h"
+
+#include <atomic>
+#include <new>
+#include <Eigen/Core>
+
+using namespace std;
+NAMESPACE_Cornu
+
+//Every allocation is preceded by a header that says which block it came from (NULL for the heap).
+//The header size keeps everything after it aligned as strictly as Eigen's fixed-size types need, which
+//is 32 or 64 bytes with AVX.  Blocks come from Eigen's aligned_malloc, whose alignment is at least that.
+static const size_t headerSize = EIGEN_MAX_ALIGN_BYTES > 16 ? EIGEN_MAX_ALIGN_BYTES : 16;
+static_assert(EIGEN_MAX_ALIGN_BYTES <= 16 || EIGEN_DEFAULT_ALIGN_BYTES >= EIGEN_MAX_ALIGN_BYTES, "aligned_malloc must align the blocks");
+
+static size_t roundUp(size_t size) { return (size + headerSize - 1) & ~(headerSize - 1); }
+
+static void *heapAllocate(size_t size)
+{
+    void *mem = Eigen::internal::aligned_malloc(headerSize + size);
+    *((void **)mem) = NULL;
+    return (char *)mem + headerSize;
+}
+
+//A block is only freed once all of its objects are, so a single long-lived object pins the whole block.
+//In particular, what a Fitter keeps past reset does: the outputs it retains, and the spare outputs it keeps
+//so the next run can reuse their memory (see Fitter::reset and Fitter::setReleaseIntermediateOutputs).  Each
+//of those keeps the block it was allocated in, though the block's other objects are gone.  So an idle fitter
+//holds up to a block per kept output.
+struct Arena::Block
+{
+    atomic<int> refCount; //number of live objects, plus one while the arena is allocating from this block
+};
+
+thread_local Arena *Arena::_current = NULL;
+
+Arena::Arena(size_t blockSize)
+    : _blockSize(blockSize), _block(NULL), _cur(NULL), _end(NULL)
+{
+}
+
+Arena::Arena(const Arena &other)
+    : _blockSize(other._blockSize), _block(NULL), _cur(NULL), _end(NULL)
+{
+}
+
+Arena::~Arena()
+{
+    if(_block)
+        _releaseBlock(_block);
+}
+
+void *Arena::allocate(size_t size)
+{
+    if(_current)
+        return _current->_allocate(size);
+    return heapAllocate(size);
+}
+
+void Arena::deallocate(void *ptr)
+{
+    if(!ptr)
+        return;
+
+    char *mem = (char *)ptr - headerSize;
+    Block *block = *((Block **)mem);
+    if(block)
+        _releaseBlock(block);
+    else
+        Eigen::internal::aligned_free(mem);
+}
+
+void *Arena::_allocate(size_t size)
+{
+    if(size * 4 > _blockSize) //big objects go on the heap so they don't waste blocks
+        return heapAllocate(size);
+
+    size = headerSize + roundUp(size);
+
+    if(_cur + size > _end)
+        _newBlock();
+
+    char *mem = _cur;
+    _cur += size;
+    _block->refCount.fetch_add(1, memory_order_relaxed);
+    *((Block **)mem) = _block;
+    return mem + headerSize;
+}
+
+void Arena::_newBlock()
+{
+    if(_block)
+        _releaseBlock(_block);
+
+    char *mem = (char *)Eigen::internal::aligned_malloc(_blockSize);
+    _block = new (mem) Block();
+    _block->refCount.store(1, memory_order_relaxed);
+    _cur = mem + roundUp(sizeof(Block)); //so the first slot is aligned too
+    _end = mem + _blockSize;
+}
+
+void Arena::_releaseBlock(Block *block)
+{
+    if(block->refCount.fetch_sub(1, memory_order_acq_rel) == 1)
+    {
+        block->~Block();
+        Eigen::internal::aligned_free(block);
+    }
+}
+
+END_NAMESPACE_Cornu
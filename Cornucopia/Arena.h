@@ -0,0 +1,81 @@
+/*--
+    Arena.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_ARENA_H_INCLUDED
+#define CORNUCOPIA_ARENA_H_INCLUDED
+
+#include <cstddef>
+
+namespace Cornu
+{
+
+//A fitter creates thousands of small objects (candidate primitives, clones, polylines, solver data).
+//An Arena hands out memory for them by bumping a pointer through large blocks.  Each block counts the
+//objects living in it and goes back to the system when the last one is deleted.  So objects that are
+//released when the fitter's outputs are cleared go away together, and objects that outlive the fitter
+//(for example, its final output) remain valid--they just keep their block around.
+//Allocation from an Arena is only done by the thread that made it current (see Scope), but objects
+//may be deleted from any thread.  All allocations are aligned for fixed-size Eigen types.
+class Arena
+{
+public:
+    Arena(size_t blockSize = 64 * 1024);
+    Arena(const Arena &other); //copying gives a new empty arena
+    ~Arena();
+
+    Arena &operator=(const Arena &) { return *this; }
+
+    //Makes an arena current for the calling thread for the lifetime of the Scope object
+    class Scope
+    {
+    public:
+        Scope(Arena *arena) : _prev(_current) { _current = arena; }
+        ~Scope() { _current = _prev; }
+    private:
+        Arena *_prev;
+    };
+
+    //These allocate from the calling thread's current arena (or from the heap if there is none)
+    static void *allocate(size_t size);
+    static void deallocate(void *ptr);
+
+private:
+    struct Block;
+
+    void *_allocate(size_t size);
+    void _newBlock();
+    static void _releaseBlock(Block *block);
+
+    size_t _blockSize;
+    Block *_block;
+    char *_cur;
+    char *_end;
+
+    static thread_local Arena *_current;
+};
+
+//Put this in a class to have its instances allocated by the current arena
+#define CORNU_ARENA_OPERATOR_NEW \
+    static void *operator new(size_t size) { return Cornu::Arena::allocate(size); } \
+    static void operator delete(void *ptr) { Cornu::Arena::deallocate(ptr); }
+
+} //end of namespace Cornu
+
+#endif //CORNUCOPIA_ARENA_H_INCLUDED
@@ -19,6 +19,11 @@
 */
 
 #include "Bezier.h"
+#include "PrimitiveSequence.h"
+
+#include <ostream>
+#include <cstdio>
+#include <cstring>
 
 using namespace std;
 using namespace Eigen;
@@ -52,6 +57,191 @@ void BezierSpline::eval(double t, Vec *pos, Vec *der, Vec *der2) const
     _primitives[idx].eval(t - idx, pos, der, der2);
 }
 
+PathWriter::PathWriter(std::ostream &out, Format format, int decimals)
+    : _out(&out), _buffer(NULL), _capacity(0), _size(0), _format(format), _decimals(decimals), _last(0), _pending(0)
+{
+    _scale = pow(10., decimals);
+}
+
+PathWriter::PathWriter(char *buffer, size_t capacity, Format format, int decimals)
+    : _out(NULL), _buffer(buffer), _capacity(capacity), _size(0), _format(format), _decimals(decimals), _last(0), _pending(0)
+{
+    _scale = pow(10., decimals);
+}
+
+void PathWriter::write(const PrimitiveSequence &curve, double tolerance)
+{
+    const VectorC<CurvePrimitiveConstPtr> &primitives = curve.primitives();
+    _moveTo(primitives[0]->startPos());
+
+    CubicBezier pieces[PrimitiveSequence::maxBezierPieces];
+    for(int i = 0; i < primitives.size(); ++i)
+    {
+        const CurvePrimitive &primitive = *primitives[i];
+        double length = primitive.length();
+        double curvature = primitive.startCurvature();
+        bool arc = (primitive.getType() == CurvePrimitive::ARC);
+
+        if(primitive.getType() == CurvePrimitive::LINE || (arc && SQR(length) * fabs(curvature) <= 8. * tolerance))
+            _lineTo(primitive.endPos()); //the middle of a flat arc is within tolerance of the chord
+        else if(arc && _format == SVG)
+        {
+            //split into arcs that turn less than pi, so the large arc flag isn't needed
+            int numArcs = 1 + (int)(fabs(curvature) * length / PI);
+            for(int k = 1; k <= numArcs; ++k)
+                _arcTo(1. / fabs(curvature), curvature > 0., primitive.pos(length * k / numArcs));
+        }
+        else
+        {
+            int num = PrimitiveSequence::primitiveToBezier(primitive, tolerance, pieces);
+            for(int k = 0; k < num; ++k)
+                _cubicTo(pieces[k]);
+        }
+    }
+
+    if(curve.isClosed())
+        _close();
+}
+
+void PathWriter::write(const BezierSpline &spline)
+{
+    if(spline.primitives().empty())
+        return;
+    _moveTo(spline.primitives()[0].controlPoint(0));
+    for(int i = 0; i < spline.primitives().size(); ++i)
+        _cubicTo(spline.primitives()[i]);
+}
+
+void PathWriter::flush()
+{
+    if(_out && _pending > 0)
+        _out->write(_staging, _pending);
+    _pending = 0;
+}
+
+void PathWriter::_moveTo(const Vec &pt)
+{
+    _svgCommand('M');
+    _number(pt[0]);
+    _number(pt[1]);
+    _pdfOperator('m');
+}
+
+void PathWriter::_lineTo(const Vec &pt)
+{
+    _svgCommand('L');
+    _number(pt[0]);
+    _number(pt[1]);
+    _pdfOperator('l');
+}
+
+void PathWriter::_cubicTo(const CubicBezier &bezier)
+{
+    _svgCommand('C');
+    for(int i = 1; i < 4; ++i)
+    {
+        _number(bezier.controlPoint(i)[0]);
+        _number(bezier.controlPoint(i)[1]);
+    }
+    _pdfOperator('c');
+}
+
+void PathWriter::_arcTo(double radius, bool positive, const Vec &pt)
+{
+    _svgCommand('A');
+    _number(radius);
+    _number(radius);
+    _separate();
+    _put(positive ? "0 0 1" : "0 0 0", 5); //rotation, large arc and sweep flags
+    _number(pt[0]);
+    _number(pt[1]);
+}
+
+void PathWriter::_close()
+{
+    _svgCommand('Z');
+    _pdfOperator('h');
+}
+
+void PathWriter::_svgCommand(char command)
+{
+    if(_format != SVG)
+        return;
+    _separate();
+    _put(&command, 1);
+}
+
+void PathWriter::_pdfOperator(char op)
+{
+    if(_format != PDF)
+        return;
+    char str[2] = { op, '\n' };
+    _separate();
+    _put(str, 2);
+}
+
+void PathWriter::_separate()
+{
+    if(_size > 0 && _last != '\n')
+        _put(" ", 1);
+}
+
+//Formats the number as an integer number of 10^-decimals units, which is much faster than printf.  Numbers
+//too big for that are rare and go through printf.
+void PathWriter::_number(double x)
+{
+    _separate();
+
+    char str[40];
+    double scaled = floor(fabs(x) * _scale + 0.5);
+    if(!(scaled < 9e15) || _decimals > 30) //the digits below wouldn't fit in str
+    {
+        int len = snprintf(str, sizeof(str), "%.*f", _decimals, x); //what it would have written, if it's longer
+        if(len > 0)
+            _put(str, min(len, (int)sizeof(str) - 1));
+        return;
+    }
+
+    long long units = (long long)scaled;
+    int decimals = _decimals;
+    while(decimals > 0 && units % 10 == 0) //drop trailing zeros
+    {
+        units /= 10;
+        --decimals;
+    }
+
+    //digits from the last one, with at least one before the decimal point
+    char *end = str + sizeof(str), *cur = end;
+    for(int digit = 0; units > 0 || digit <= decimals; ++digit)
+    {
+        if(digit == decimals && decimals > 0)
+            *--cur = '.';
+        *--cur = char('0' + units % 10);
+        units /= 10;
+    }
+    if(x < 0. && scaled > 0.)
+        *--cur = '-';
+    _put(cur, int(end - cur));
+}
+
+void PathWriter::_put(const char *str, int len)
+{
+    if(_buffer)
+    {
+        if(_size < _capacity)
+            memcpy(_buffer + _size, str, min((size_t)len, _capacity - _size));
+    }
+    else
+    {
+        if(_pending + len > (int)sizeof(_staging))
+            flush();
+        memcpy(_staging + _pending, str, len);
+        _pending += len;
+    }
+    _size += len;
+    _last = str[len - 1];
+}
+
 END_NAMESPACE_Cornu
 
 
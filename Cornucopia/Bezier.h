@@ -24,6 +24,7 @@
 #include "defs.h"
 #include "smart_ptr.h"
 #include "VectorC.h"
+#include <iosfwd>
 
 NAMESPACE_Cornu
 
@@ -63,6 +64,58 @@ private:
     PrimitiveVector _primitives;
 };
 
+class PrimitiveSequence;
+
+//Writes curves as path data--the d attribute of an SVG path or PDF content stream path operators--straight
+//into a stream or a caller's buffer, without building the curves' Bezier splines first.  Lines and, in SVG,
+//arcs are written exactly and other primitives as cubics within the tolerance.  Coordinates are written
+//with a fixed number of decimals, with trailing zeros dropped.
+class PathWriter
+{
+public:
+    typedef Eigen::Vector2d Vec;
+    enum Format { SVG, PDF };
+
+    PathWriter(std::ostream &out, Format format = SVG, int decimals = 3);
+    //writes at most capacity characters, without a terminating zero
+    PathWriter(char *buffer, size_t capacity, Format format = SVG, int decimals = 3);
+    ~PathWriter() { flush(); }
+
+    //each one starts a new subpath, which is closed for closed curves
+    void write(const PrimitiveSequence &curve, double tolerance);
+    void write(const BezierSpline &spline);
+
+    void flush(); //passes anything not yet written on to the stream
+
+    size_t size() const { return _size; } //the number of characters in the output, including ones that didn't fit in the buffer
+    bool truncated() const { return _buffer && _size > _capacity; }
+
+private:
+    void _moveTo(const Vec &pt);
+    void _lineTo(const Vec &pt);
+    void _cubicTo(const CubicBezier &bezier);
+    void _arcTo(double radius, bool positive, const Vec &pt); //SVG only, the arc must turn less than pi
+    void _close();
+
+    //SVG commands come before the coordinates and PDF operators after them, one per line
+    void _svgCommand(char command);
+    void _pdfOperator(char op);
+    void _separate(); //a space unless at the start of a line
+    void _number(double x);
+    void _put(const char *str, int len);
+
+    std::ostream *_out;
+    char *_buffer;
+    size_t _capacity;
+    size_t _size;
+    Format _format;
+    int _decimals;
+    double _scale; //10^decimals
+    char _last; //the last character written
+    int _pending; //characters in _staging
+    char _staging[4096]; //for the stream
+};
+
 END_NAMESPACE_Cornu
 
 #endif //CORNUCOPIA_BEZIER_H_INCLUDED
@@ -0,0 +1,107 @@
+/*--
+    BoxTree.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "BoxTree.h"
+
+using namespace std;
+using namespace Eigen;
+NAMESPACE_Cornu
+
+static const int leafSize = 8;
+
+void BoxTree::Box::extend(const Vector2d &pt)
+{
+    for(int i = 0; i < 2; ++i)
+    {
+        min[i] = std::min(min[i], pt[i]);
+        max[i] = std::max(max[i], pt[i]);
+    }
+}
+
+void BoxTree::Box::extend(const Box &other)
+{
+    for(int i = 0; i < 2; ++i)
+    {
+        min[i] = std::min(min[i], other.min[i]);
+        max[i] = std::max(max[i], other.max[i]);
+    }
+}
+
+void BoxTree::Box::inflate(double amount)
+{
+    for(int i = 0; i < 2; ++i)
+    {
+        min[i] -= amount;
+        max[i] += amount;
+    }
+}
+
+double BoxTree::Box::distanceSq(const Vector2d &pt) const
+{
+    double out = 0;
+    for(int i = 0; i < 2; ++i)
+    {
+        if(pt[i] < min[i])
+            out += SQR(min[i] - pt[i]);
+        else if(pt[i] > max[i])
+            out += SQR(pt[i] - max[i]);
+    }
+    return out;
+}
+
+BoxTree::BoxTree(const vector<Box> &itemBoxes)
+    : _items(itemBoxes)
+{
+    for(int i = 0; i < (int)_items.size(); ++i)
+    {
+        Box &box = _items[i];
+        box.inflate(1e-12 * (1. + fabs(box.min[0]) + fabs(box.min[1]) + fabs(box.max[0]) + fabs(box.max[1])));
+    }
+
+    _nodes.reserve(2 * ((int)_items.size() / leafSize + 1));
+    _nodes.resize(1);
+    _build(0, 0, (int)_items.size());
+}
+
+void BoxTree::_build(int nodeIdx, int first, int last)
+{
+    Node node;
+    node.first = first;
+    node.last = last;
+    node.child = -1;
+    if(last - first <= leafSize)
+    {
+        for(int i = first; i < last; ++i)
+            node.box.extend(_items[i]);
+    }
+    else
+    {
+        node.child = (int)_nodes.size();
+        _nodes.resize(_nodes.size() + 2);
+        int mid = (first + last) / 2;
+        _build(node.child, first, mid);
+        _build(node.child + 1, mid, last);
+        node.box = _nodes[node.child].box;
+        node.box.extend(_nodes[node.child + 1].box);
+    }
+    _nodes[nodeIdx] = node;
+}
+
+END_NAMESPACE_Cornu
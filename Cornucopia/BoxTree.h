@@ -0,0 +1,97 @@
+/*--
+    BoxTree.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_BOXTREE_H_INCLUDED
+#define CORNUCOPIA_BOXTREE_H_INCLUDED
+
+#include "defs.h"
+#include <vector>
+#include <Eigen/Core>
+
+NAMESPACE_Cornu
+
+//A tree of bounding boxes over a sequence of items (such as the segments of a polyline) for finding the
+//item closest to a point.  Consecutive items of a curve are close together, so splitting the item range
+//in half at each node gives tight boxes without sorting anything, and the tree is built in linear time.
+class BoxTree
+{
+public:
+    struct Box
+    {
+        Box() { min[0] = min[1] = 1e100; max[0] = max[1] = -1e100; }
+
+        void extend(const Eigen::Vector2d &pt);
+        void extend(const Box &other);
+        void inflate(double amount);
+        double distanceSq(const Eigen::Vector2d &pt) const; //zero inside the box
+
+        double min[2], max[2];
+    };
+
+    //The boxes are inflated slightly so rounding in computing an item's distance can't make it smaller than its box's
+    BoxTree(const std::vector<Box> &itemBoxes);
+
+    const Box &bounds() const { return _nodes[0].box; }
+
+    //Calls tryItem(i) for every item whose box is no farther than sqrt(minDistSq).  tryItem may decrease
+    //minDistSq, and items near the point are tried first so that it does early.
+    template<typename TryItem>
+    void visit(const Eigen::Vector2d &point, double &minDistSq, TryItem tryItem) const
+    {
+        int stack[64];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+        while(stackSize > 0)
+        {
+            const Node &node = _nodes[stack[--stackSize]];
+            if(node.box.distanceSq(point) > minDistSq)
+                continue;
+            if(node.child < 0)
+            {
+                for(int i = node.first; i < node.last; ++i)
+                    if(_items[i].distanceSq(point) <= minDistSq)
+                        tryItem(i);
+                continue;
+            }
+            int nearer = node.child, farther = node.child + 1;
+            if(_nodes[farther].box.distanceSq(point) < _nodes[nearer].box.distanceSq(point))
+                std::swap(nearer, farther);
+            stack[stackSize++] = farther;
+            stack[stackSize++] = nearer;
+        }
+    }
+
+private:
+    struct Node
+    {
+        Box box;
+        int first, last; //the items in the box
+        int child; //index of the first child (the second is right after it) or -1 for leaves
+    };
+
+    void _build(int nodeIdx, int first, int last);
+
+    std::vector<Box> _items;
+    std::vector<Node> _nodes;
+};
+
+END_NAMESPACE_Cornu
+
+#endif //CORNUCOPIA_BOXTREE_H_INCLUDED
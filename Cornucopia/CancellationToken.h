@@ -0,0 +1,50 @@
+/*--
+    CancellationToken.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_CANCELLATIONTOKEN_H_INCLUDED
+#define CORNUCOPIA_CANCELLATIONTOKEN_H_INCLUDED
+
+#include "defs.h"
+#include "smart_ptr.h"
+
+#include <atomic>
+
+NAMESPACE_Cornu
+
+//Lets any thread stop a fit that's no longer wanted (see Fitter::setCancellationToken).  Cancelling sticks
+//until the token is reset.  The long loops of the stages poll it, which is a relaxed load, so it's cheap.
+class CancellationToken : public smart_base
+{
+public:
+    CancellationToken() : _cancelled(false) {}
+
+    void cancel() { _cancelled.store(true, std::memory_order_relaxed); }
+    void reset() { _cancelled.store(false, std::memory_order_relaxed); }
+    bool isCancelled() const { return _cancelled.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> _cancelled;
+};
+
+CORNU_SMART_TYPEDEFS(CancellationToken);
+
+END_NAMESPACE_Cornu
+
+#endif //CORNUCOPIA_CANCELLATIONTOKEN_H_INCLUDED
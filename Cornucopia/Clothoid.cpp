@@ -20,7 +20,9 @@
 
 #include "Clothoid.h"
 #include "Fresnel.h"
+#include "WorkCounters.h"
 #include "Eigen/LU"
+#include "Eigen/StdVector"
 
 using namespace std;
 using namespace Eigen;
@@ -39,12 +41,15 @@ Clothoid::Clothoid(const Vec &start, double startAngle, double length, double cu
     _paramsChanged();
 }
 
+const double Clothoid::MAX_NEAR_ARC_DEVIATION = 1e-2;
+
 void Clothoid::_paramsChanged()
 {
     Vector2d startcs;
 
     _arc = fabs(_params[DCURVATURE]) < 1e-12;
     _flat = false;
+    _evalPos = &Clothoid::_fresnelPos;
 
     if(_arc)
     {
@@ -52,6 +57,7 @@ void Clothoid::_paramsChanged()
 
         if(_flat)
         {
+            _evalPos = &Clothoid::_flatPos;
             _t1 = 0;
             _tdiff = 1;
 
@@ -65,6 +71,7 @@ void Clothoid::_paramsChanged()
         }
         else //non-flat arc
         {
+            _evalPos = &Clothoid::_arcPos;
             _t1 = 0;
             _tdiff = _params[CURVATURE];
 
@@ -84,27 +91,62 @@ void Clothoid::_paramsChanged()
         _t1 = _params[CURVATURE] * scale;
         _tdiff = _params[DCURVATURE] * scale;
 
+        double basicAngle = _t1 * _t1 * HALFPI;
+        double angleShift = (_tdiff > 0) ? _params[ANGLE] - basicAngle : _params[ANGLE] + basicAngle;
+        _cosShift = cos(angleShift);
+        _sinShift = sin(angleShift);
+        double cosAS = PI * scale * _cosShift, sinAS = PI * scale * _sinShift;
         if(_tdiff > 0)
         {
-            double angleShift = _params[ANGLE] - _t1 * _t1 * HALFPI;
-            double cosAS = PI * scale * cos(angleShift), sinAS = PI * scale * sin(angleShift);
             _mat << cosAS, -sinAS,
                 sinAS, cosAS;
         }
         else //we need a reflection here
         {
-            double angleShift = _params[ANGLE] + _t1 * _t1 * HALFPI;
-            double cosAS = PI * scale * cos(angleShift), sinAS = PI * scale * sin(angleShift);
             _mat << -cosAS, -sinAS,
                 -sinAS, cosAS;
         }
 
-        fresnel(_t1, &(startcs[1]), &(startcs[0]));
+        fresnelCurve(_t1, &(startcs[1]), &(startcs[0]));
+        _startcs = startcs;
+        _startcsDer = Vector2d(cos(basicAngle), sin(basicAngle));
+
+        if(0.5 * fabs(_params[DCURVATURE]) * _params[LENGTH] * _params[LENGTH] < MAX_NEAR_ARC_DEVIATION)
+        {
+            _evalPos = &Clothoid::_nearArcPos;
+            _cosStart = cos(_params[ANGLE]);
+            _sinStart = sin(_params[ANGLE]);
+        }
     }
 
     _startShift = _startPos() - _mat * startcs;    
 }
 
+void Clothoid::_flatPos(double s, Vec *pos) const
+{
+    (*pos) = _startShift + _mat * Vector2d(_t1 + s * _tdiff, 0);
+}
+
+void Clothoid::_arcPos(double s, Vec *pos) const
+{
+    double t = _t1 + s * _tdiff;
+    (*pos) = _startShift + _mat * Vector2d(cos(t), sin(t));
+}
+
+void Clothoid::_nearArcPos(double s, Vec *pos) const
+{
+    double x, y;
+    fresnelNearArc(_params[CURVATURE], _params[DCURVATURE], s, &x, &y);
+    (*pos) = Vector2d(_params[X] + _cosStart * x - _sinStart * y, _params[Y] + _sinStart * x + _cosStart * y);
+}
+
+void Clothoid::_fresnelPos(double s, Vec *pos) const
+{
+    Vector2d cs;
+    fresnelCurve(_t1 + s * _tdiff, &(cs[1]), &(cs[0]));
+    (*pos) = _startShift + _mat * cs;
+}
+
 bool Clothoid::isValidImpl() const
 {
     if(_params[LENGTH] < 0.)
@@ -115,19 +157,7 @@ bool Clothoid::isValidImpl() const
 void Clothoid::eval(double s, Vec *pos, Vec *der, Vec *der2) const
 {
     if(pos)
-    {
-        double t = _t1 + s * _tdiff;
-
-        Vector2d cs;
-        if(_flat)
-            cs = Vector2d(t, 0);
-        else if(_arc)
-            cs = Vector2d(cos(t), sin(t));
-        else
-            fresnel(t, &(cs[1]), &(cs[0]));
-
-        (*pos) = _startShift + _mat * cs;
-    }
+        (this->*_evalPos)(s, pos);
     if(der || der2)
     {
         double angle = _params[ANGLE] + s * (_params[CURVATURE] + 0.5 * s * _params[DCURVATURE]);
@@ -140,6 +170,50 @@ void Clothoid::eval(double s, Vec *pos, Vec *der, Vec *der2) const
     }
 }
 
+void Clothoid::evalMany(const double *s, int n, Vec *pos, Vec *der, Vec *der2) const
+{
+    if(pos && _evalPos == &Clothoid::_fresnelPos)
+    {
+        static thread_local VectorXd t, sn, cn; //kept per thread, like the buffer in projectMany
+        t.resize(n);
+        for(int i = 0; i < n; ++i)
+            t[i] = _t1 + s[i] * _tdiff;
+
+        fresnelCurve(t, &sn, &cn);
+
+        for(int i = 0; i < n; ++i)
+            pos[i] = _startShift + _mat * Vector2d(cn[i], sn[i]);
+    }
+    else if(pos)
+    {
+        for(int i = 0; i < n; ++i)
+            (this->*_evalPos)(s[i], pos + i);
+    }
+
+    if(der || der2)
+    {
+        for(int i = 0; i < n; ++i)
+            Clothoid::eval(s[i], NULL, der ? der + i : NULL, der2 ? der2 + i : NULL);
+    }
+}
+
+//|curvature| is largest at one end of any piece, so a step that suits both of its ends suits the whole piece
+void Clothoid::tessellate(double tolerance, PointVector &out) const
+{
+    static thread_local vector<double> s;
+    s.assign(1, 0.);
+    while(s.back() < _length())
+    {
+        double step = _tessellationStep(tolerance, curvature(s.back()));
+        step = min(step, _tessellationStep(tolerance, curvature(min(_length(), s.back() + step))));
+        s.push_back(min(_length(), s.back() + step));
+    }
+
+    size_t first = out.size();
+    out.resize(first + s.size());
+    evalMany(&(s[0]), (int)s.size(), &(out[first]));
+}
+
 double Clothoid::angle(double s) const
 {
     return _params[ANGLE] + s * (_params[CURVATURE] + 0.5 * s * _params[DCURVATURE]);
@@ -152,6 +226,7 @@ double Clothoid::curvature(double s) const
 
 double Clothoid::project(const Vec &point) const
 {
+    CORNU_COUNT(CLOTHOID_PROJECTIONS, 1);
     if(_flat)
     {
         Vector2d tangent(cos(_params[ANGLE]), sin(_params[ANGLE]));
@@ -189,6 +264,74 @@ double Clothoid::project(const Vec &point) const
     return (bestT - _t1) / _tdiff;
 }
 
+//Newton's method from the hint finds a local minimum s of the distance, at distance d.  If the tangent turns by
+//less than theta < pi/2 along the whole clothoid, the chord from pos(s) to pos(s') is at least |s - s'| cos(theta),
+//so every point within d of the query is at most r = 2d / cos(theta) away from s along the curve.  There, half the
+//second derivative of the squared distance, 1 + dot(der2, pos - point), is at least 1 - |curvature| (d + r), so
+//if that's positive, s is the global minimum.  Otherwise, this does the full projection.
+double Clothoid::projectNear(const Vec &point, double sHint) const
+{
+    if(_flat || _arc)
+        return project(point);
+
+    const double len = _length();
+    const double k0 = startCurvature(), k1 = endCurvature();
+    double turning = (k0 * k1 >= 0.) ? 0.5 * fabs(k0 + k1) * len : 0.5 * (SQR(k0) + SQR(k1)) / fabs(k1 - k0) * len;
+    if(turning > 1.2)
+        return project(point);
+
+    double s = max(0., min(len, sHint));
+    for(int i = 0; i < 8; ++i)
+    {
+        Vec p, der, der2;
+        eval(s, &p, &der, &der2);
+        Vec diff = p - point;
+        double dotDer = 1. + der2.dot(diff);
+        if(dotDer <= 0.)
+            break;
+
+        double newS = max(0., min(len, s - der.dot(diff) / dotDer));
+        double step = fabs(newS - s);
+        if(step < 1e-12 * (1. + len))
+        {
+            double dist = diff.norm() + step;
+            double reach = 2. * dist / cos(turning);
+            if(max(fabs(k0), fabs(k1)) * (dist + reach) < 1.)
+            {
+                CORNU_COUNT(CLOTHOID_PROJECTIONS, 1); //the fallbacks count in project
+                return newS;
+            }
+            break;
+        }
+        s = newS;
+    }
+
+    return project(point);
+}
+
+void Clothoid::projectMany(const Vec *points, int n, double *out) const
+{
+    if(_flat || _arc || n <= 1)
+    {
+        for(int i = 0; i < n; ++i)
+            out[i] = Clothoid::project(points[i]);
+        return;
+    }
+
+    //go to the canonical clothoid once for all the points
+    double endT = _t1 + _tdiff * _length();
+    Matrix2d inv = _mat.inverse();
+    static thread_local vector<Vec, aligned_allocator<Vec> > pts; //kept per thread, as the solvers call this for every evaluation
+    pts.resize(n);
+    for(int i = 0; i < n; ++i)
+        pts[i] = inv * (points[i] - _startShift);
+
+    _clothoidProjector()->projectMany(&(pts[0]), n, min(_t1, endT), max(_t1, endT), out);
+    CORNU_COUNT(CLOTHOID_PROJECTIONS, n);
+    for(int i = 0; i < n; ++i)
+        out[i] = (out[i] - _t1) / _tdiff;
+}
+
 void Clothoid::trim(double sFrom, double sTo)
 {
     Vec newStart = pos(sFrom);
@@ -212,14 +355,71 @@ void Clothoid::flip()
     _paramsChanged();
 }
 
+//A similarity takes the canonical clothoid to the same place on it (_t1 doesn't change), so the Fresnel
+//integrals at the start don't need to be evaluated again: the transformation from the canonical clothoid is just
+//composed with the similarity
+void Clothoid::transform(const Similarity &similarity)
+{
+    bool wasArc = _arc;
+    _transformParams(similarity);
+    //the thresholds in _paramsChanged are absolute, so a scaled clothoid may be evaluated differently
+    if(wasArc || fabs(_params[DCURVATURE]) < 1e-12)
+    {
+        _paramsChanged();
+        return;
+    }
+
+    double scale = similarity.scale();
+    _tdiff /= scale;
+    _mat.col(0) = scale * similarity.rotate(_mat.col(0));
+    _mat.col(1) = scale * similarity.rotate(_mat.col(1));
+    _startShift = similarity * _startShift;
+    Vector2d shift = similarity.rotate(Vector2d(_cosShift, _sinShift));
+    _cosShift = shift[0];
+    _sinShift = shift[1];
+    if(_evalPos == &Clothoid::_nearArcPos) //0.5 * |dcurvature| * length^2 doesn't change
+    {
+        Vector2d start = similarity.rotate(Vector2d(_cosStart, _sinStart));
+        _cosStart = start[0];
+        _sinStart = start[1];
+    }
+}
+
 void Clothoid::derivativeAt(double s, ParamDer &out, ParamDer &outTan) const
+{
+    evalWithDerivatives(s, NULL, NULL, out, outTan);
+}
+
+//The position comes from the same Fresnel evaluation as the derivatives, and the terms that depend only on the
+//parameters are computed in _paramsChanged
+void Clothoid::evalWithDerivatives(double s, Vec *outPos, Vec *outTangent, ParamDer &out, ParamDer &outTan) const
 {
     outTan = out = ParamDer::Zero(2, 6);
     out(0, X) = 1;
     out(1, Y) = 1;
 
-    Vec pos, tangent;
-    eval(s, &pos, &tangent);
+    double t = _t1 + s * _tdiff;
+    Vec pos, tangent, csDiff; //csDiff is the canonical clothoid at t minus _startcs
+    if(_flat || _arc)
+        eval(s, &pos, &tangent);
+    else if(_evalPos != &Clothoid::_fresnelPos)
+    {
+        //_mat is a scaled rotation (or reflection), so its inverse is its scaled transpose
+        eval(s, &pos, &tangent);
+        csDiff = _mat.transpose() * (pos - _startPos()) / _mat.col(0).squaredNorm();
+    }
+    else
+    {
+        Vec cs;
+        fresnelCurve(t, &(cs[1]), &(cs[0]));
+        pos = _startShift + _mat * cs;
+        csDiff = cs - _startcs;
+        eval(s, NULL, &tangent);
+    }
+    if(outPos)
+        *outPos = pos;
+    if(outTangent)
+        *outTangent = tangent;
 
     Vec diff = pos - _startPos();
     out(0, ANGLE) = -diff[1];
@@ -262,27 +462,15 @@ void Clothoid::derivativeAt(double s, ParamDer &out, ParamDer &outTan) const
         //dstartcs/dx = cossin(pi t1^2 / 2) * dt1/dx
         //dp/dx = dmat/dx * (cs - startcs) + mat * (dcs/dx - dstartcs/dx)
 
-        double t = _t1 + s * _tdiff;
         double scale = sqrt(fabs(1. / (PI * _params[DCURVATURE])));
         RowVector2d dt1dx(scale, -_params[CURVATURE] * scale / (2. * _params[DCURVATURE]));
         RowVector2d dtdx = dt1dx + RowVector2d(0, scale * s * 0.5);
-        Vector2d cs, startcs;
-        fresnel(t, &(cs[1]), &(cs[0]));
-        fresnel(_t1, &(startcs[1]), &(startcs[0]));
-        double basicAngle = HALFPI * _t1 * _t1;
-        Vector2d dstartcs(cos(basicAngle), sin(basicAngle));
         Vector2d dcs(cos(HALFPI * t * t), sin(HALFPI * t * t));
 
-        Matrix2d result = (_mat * dcs) * dtdx - (_mat * dstartcs) * dt1dx;
+        Matrix2d result = (_mat * dcs) * dtdx - (_mat * _startcsDer) * dt1dx;
         Matrix2d dmatdc, dmatdd;
 
-        double angleShift;
-        if(_tdiff > 0.)
-            angleShift = _params[ANGLE] - _t1 * _t1 * HALFPI;
-        else
-            angleShift = _params[ANGLE] + _t1 * _t1 * HALFPI;
-
-        double cosAS = cos(angleShift), sinAS = sin(angleShift);
+        double cosAS = _cosShift, sinAS = _sinShift;
         dmatdc << sinAS, cosAS,
             -cosAS, sinAS;
         dmatdc *= PI * scale * _params[CURVATURE] / _params[DCURVATURE];
@@ -299,8 +487,8 @@ void Clothoid::derivativeAt(double s, ParamDer &out, ParamDer &outTan) const
             dmatdd.col(0) *= -1;
         }
 
-        result.col(0) += dmatdc * (cs - startcs);
-        result.col(1) += dmatdd * (cs - startcs);
+        result.col(0) += dmatdc * csDiff;
+        result.col(1) += dmatdd * csDiff;
 
         out.block<2, 2>(0, CURVATURE) = result;
     }
@@ -334,7 +522,7 @@ void Clothoid::derivativeAtEnd(int continuity, EndDer &out) const
     }
 }
 
-void Clothoid::toEndCurvatureDerivative(MatrixXd &der) const
+void Clothoid::toEndCurvatureDerivative(Ref<MatrixXd> der) const
 {
     double invLength = 1. / _params[LENGTH];
     der.col(DCURVATURE) *= invLength;
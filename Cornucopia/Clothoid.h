@@ -36,8 +36,12 @@ public:
 
     //overrides
     void eval(double s, Vec *pos, Vec *der = NULL, Vec *der2 = NULL) const;
+    void evalMany(const double *s, int n, Vec *pos, Vec *der = NULL, Vec *der2 = NULL) const; //uses the vectorized Fresnel integrals
 
     double project(const Vec &point) const;
+    double projectNear(const Vec &point, double sHint) const;
+    void projectMany(const Vec *points, int n, double *out) const;
+    void tessellate(double tolerance, PointVector &out) const;
 
     double angle(double s) const;
     double curvature(double s) const;
@@ -49,32 +53,54 @@ public:
 
     void trim(double sFrom, double sTo);
     void flip();
-    CurvePrimitivePtr clone() const { ClothoidPtr out = new Clothoid(); out->setParams(_params); return out; }
+    void transform(const Similarity &similarity);
+    CurvePrimitivePtr clone() const { return new Clothoid(*this); } //copies what _paramsChanged computed
     void derivativeAt(double s, ParamDer &out, ParamDer &outTan) const;
+    void evalWithDerivatives(double s, Vec *pos, Vec *tangent, ParamDer &out, ParamDer &outTan) const;
     void derivativeAtEnd(int continuity, EndDer &out) const;
 
-    void toEndCurvatureDerivative(Eigen::MatrixXd &der) const;
+    void toEndCurvatureDerivative(Eigen::Ref<Eigen::MatrixXd> der) const;
 
     class _ClothoidProjector //internal singleton class
     {
     public:
         virtual double project(const Vec &pt, double from, double to) const = 0;
+        virtual void projectMany(const Vec *pts, int n, double from, double to, double *out) const = 0;
     };
 
-    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 protected:
     //override
     void _paramsChanged();
     bool isValidImpl() const;
 
 private:
+    friend struct PrimitiveValue;
+
     Vec _startShift; //translation component of transformation from canonical clothoid
     Eigen::Matrix2d _mat; //rotation and scale component of transformation from canonical clothoid
     double _t1; //start parameter on the canonical clothoid
     double _tdiff;
+    //for parameter derivatives of a non-degenerate clothoid: the canonical clothoid at _t1 and its derivative
+    //there, and the cosine and sine of the rotation angle of _mat
+    Vec _startcs, _startcsDer;
+    double _cosShift, _sinShift;
     bool _arc;
     bool _flat;
 
+    //position evaluation, chosen in _paramsChanged
+    typedef void (Clothoid::*_PosEvaluator)(double s, Vec *pos) const;
+    _PosEvaluator _evalPos;
+    void _flatPos(double s, Vec *pos) const;
+    void _arcPos(double s, Vec *pos) const;
+    void _nearArcPos(double s, Vec *pos) const;
+    void _fresnelPos(double s, Vec *pos) const;
+
+    //A clothoid whose curvature changes so little that its angle is within MAX_NEAR_ARC_DEVIATION of an arc's
+    //is evaluated with fresnelNearArc: so far out on the canonical clothoid, the Fresnel integrals lose all
+    //precision
+    static const double MAX_NEAR_ARC_DEVIATION;
+    double _cosStart, _sinStart;
+
     class _ClothoidProjectorImpl;
     static _ClothoidProjector *_clothoidProjector(); //projects onto a generic clothoid
 };
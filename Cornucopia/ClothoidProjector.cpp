@@ -21,6 +21,7 @@
 #include "Clothoid.h"
 #include "Arc.h"
 #include "Fresnel.h"
+#include "BoxTree.h"
 
 #include <deque>
 
@@ -68,6 +69,20 @@ public:
         return true;
     }
 
+    double start() const { return _start; }
+    double distanceSqTo(const Vector2d &pt) const { return (pt - _arc->pos(_arc->project(pt))).squaredNorm(); }
+
+    //bounds the approximating arc: it doesn't stray from the chord between samples by more than half their spacing
+    BoxTree::Box box() const
+    {
+        BoxTree::Box out;
+        const int samples = 8;
+        for(int i = 0; i <= samples; ++i)
+            out.extend(_arc->pos(_length * i / samples));
+        out.inflate(_length / (2 * samples));
+        return out;
+    }
+
 private:
     ArcPtr _arc;
     double _start;
@@ -89,40 +104,53 @@ public:
             _arcs.push_back(_ApproxArc(t, _arcSpacing));
         }
         _maxArcParam = t;
+
+        //how far the arcs stray from the clothoid, measured between the points they're built through
+        _arcError = 0.;
+        for(int i = 0; i < (int)_arcs.size(); ++i)
+        {
+            for(int j = 1; j < 8; j += 2)
+            {
+                Vec pt;
+                eval(_arcs[i].start() + _arcSpacing * j / 8, &pt);
+                _arcError = max(_arcError, sqrt(_arcs[i].distanceSqTo(pt)));
+            }
+        }
+
+        vector<BoxTree::Box> boxes(_arcs.size());
+        for(int i = 0; i < (int)_arcs.size(); ++i)
+            boxes[i] = _arcs[i].box();
+        _tree = new BoxTree(boxes);
     }
 
     double project(const Vec &pt, double from, double to) const
     {
-        double minT, minDistSq;
+        double out;
+        projectMany(&pt, 1, from, to, &out);
+        return out;
+    }
 
+    //The end points and the arcs outside the precomputed range depend only on from and to, so they are
+    //computed once for all the points.  The precomputed arcs are found through the tree.
+    void projectMany(const Vec *pts, int n, double from, double to, double *out) const
+    {
         Vector2d startPt, endPt;
         fresnelApprox(from, &(startPt[1]), &(startPt[0]));
         fresnelApprox(to, &(endPt[1]), &(endPt[0]));
 
-        //test start and end points
-        minT = from;
-        minDistSq = (pt - startPt).squaredNorm();
-        double distSq = (pt - endPt).squaredNorm();
-        if(distSq < minDistSq)
-        {
-            minDistSq = distSq;
-            minT = to;
-        }
-
-        //A possible optimization for clothoids outside the precomputed range is to batch
-        //the fresnel integral evaluations.  Not sure how much it'll help.
+        vector<_ApproxArc> extraArcs;
         int minArcIdx = (int)floor((_maxArcParam + from) / _arcSpacing);
         if(minArcIdx < 0)
         {
             minArcIdx = 0;
-            //test against arcs before the precomputed ones
+            //arcs before the precomputed ones
             double start = from;
             double stop = min(to, -_maxArcParam);
             int cnt = 0; //iteration count to prevent looping over a really spirally clothoid
             while(start + 1e-8 < stop && ++cnt < 100)
             {
                 double len = min(stop - start, -1. / start);
-                _ApproxArc(start, len).test(pt, minDistSq, minT, from, to);
+                extraArcs.push_back(_ApproxArc(start, len));
 
                 start += len;
             }
@@ -131,25 +159,62 @@ public:
         if(maxArcIdx > (int)_arcs.size())
         {
             maxArcIdx = (int)_arcs.size();
-            //test against arcs past the end of the precomputed ones
+            //arcs past the end of the precomputed ones
             double start = to;
             double stop = max(_maxArcParam, from);
             int cnt = 0; //iteration count to prevent looping over a really spirally clothoid
             while(start - 1e-8 > stop && ++cnt < 100)
             {
                 double len = min(start - stop, 1. / start);
-                _ApproxArc(start - len, len).test(pt, minDistSq, minT, from, to);
+                extraArcs.push_back(_ApproxArc(start - len, len));
 
                 start -= len;
             }
         }
 
-        for(int i = minArcIdx; i < maxArcIdx; ++i)
-            _arcs[i].test(pt, minDistSq, minT, from, to);
+        for(int p = 0; p < n; ++p)
+        {
+            const Vec &pt = pts[p];
+
+            //test start and end points
+            double endT = from;
+            double endDistSq = (pt - startPt).squaredNorm();
+            double distSq = (pt - endPt).squaredNorm();
+            if(distSq < endDistSq)
+            {
+                endDistSq = distSq;
+                endT = to;
+            }
+
+            //The arcs are only close to the clothoid, so one that seems a little farther than the end point may
+            //lead to a closer point, and one that seems a little closer may not.  Those get refined and compared.
+            double slack = _arcError * (4. * sqrt(endDistSq) + _arcError);
+            double minT = endT;
+            double minDistSq = endDistSq + slack;
+
+            for(int i = 0; i < (int)extraArcs.size(); ++i)
+                extraArcs[i].test(pt, minDistSq, minT, from, to);
 
-        minT = projectNewton(minT, pt, from, to);
-        minT = projectNewton(minT, pt, from, to);
-        return minT;
+            if(minArcIdx < maxArcIdx)
+            {
+                _tree->visit(pt, minDistSq, [&](int i) {
+                    if(i >= minArcIdx && i < maxArcIdx)
+                        _arcs[i].test(pt, minDistSq, minT, from, to);
+                });
+            }
+
+            bool nearTie = minT != endT && minDistSq > endDistSq - slack;
+            minT = projectNewton(minT, pt, from, to);
+            minT = projectNewton(minT, pt, from, to);
+            if(nearTie)
+            {
+                Vec minPt;
+                eval(minT, &minPt);
+                if((pt - minPt).squaredNorm() > endDistSq)
+                    minT = endT;
+            }
+            out[p] = minT;
+        }
     }
 
 private:
@@ -184,6 +249,8 @@ private:
     const double _arcSpacing;
     deque<_ApproxArc> _arcs;
     double _maxArcParam;
+    double _arcError;
+    BoxTree *_tree; //over _arcs, lives as long as the singleton
 };
 
 Clothoid::_ClothoidProjector *Clothoid::_clothoidProjector()
@@ -31,9 +31,12 @@
 #include "Fitter.h"
 #include "Oversketcher.h"
 #include "PiecewiseLinearUtils.h"
+#include "Fresnel.h"
+#include "Tracing.h"
 
 #include <iterator>
 #include <cstdio>
+#include <mutex>
 
 #include <Eigen/LU>
 #include <Eigen/Cholesky>
@@ -42,44 +45,116 @@ using namespace std;
 using namespace Eigen;
 NAMESPACE_Cornu
 
-#define SPARSE 1
-
-class MulticurveDenseEvalData : public LSEvalData
+//What the multicurve problem evaluates: for each curve, the block of the Gauss-Newton Hessian J^T J and its part
+//of the gradient, and the continuity constraints between consecutive curves (closed curves have one more, between
+//the last curve and the first).  The subclasses solve the damped KKT system with them in different ways.
+class MulticurveEvalData : public LSEvalData
 {
 public:
+    typedef Matrix<double, Dynamic, Dynamic, 0, 6, 6> BlockType;
+    typedef vector<BlockType, aligned_allocator<BlockType> > BlockVectorType;
+    typedef CurvePrimitive::EndDer ConBlockType;
+    typedef vector<ConBlockType, aligned_allocator<ConBlockType> > ConBlockVectorType;
+
     //overrides
     double error() const { return _con.squaredNorm(); }
 
-    void solveForDelta(double damping, Eigen::VectorXd &out, std::set<LSBoxConstraint> &constraints)
+    VectorXd &errVectorRef() { return _err; } //-J^T e
+    BlockVectorType &errDerBlocksRef() { return _errDerBlocks; } //the blocks of J^T J
+
+    VectorXd &conVectorRef() { return _con; }
+    ConBlockVectorType &conDerBlocksRef() { return _conDerBlocks; } //derivative of the constraints between curves i and i + 1 w.r.t. curve i
+    ConBlockVectorType &conDerNextBlocksRef() { return _conDerNextBlocks; } //...and w.r.t. curve i + 1
+
+protected:
+    void _computeIndices()
     {
-        size_t vars = _errDer.cols();
+        _blockIndices.resize(_errDerBlocks.size() + 1);
+        _blockSizes.resize(_errDerBlocks.size());
+        _blockIndices[0] = 0;
 
-        size_t size = vars + _con.size() + constraints.size();
-        MatrixXd lhs = MatrixXd::Zero(size, size);
-        VectorXd rhs = VectorXd::Zero(size);
+        for(int i = 0; i < (int)_errDerBlocks.size(); ++i)
+        {
+            _blockSizes[i] = _errDerBlocks[i].rows();
+            _blockIndices[i + 1] = _blockIndices[i] + _blockSizes[i];
+        }
 
-        lhs.block(0, 0, vars, vars) = _errDer.transpose() * _errDer;
-        rhs.segment(0, vars) = -_errDer.transpose() * _err;
+        _closed = (_conDerBlocks.size() == _errDerBlocks.size());
+    }
 
-        lhs.block(vars, 0, _conDer.rows(), _conDer.cols()) = _conDer;
-        lhs.block(0, vars, _conDer.cols(), _conDer.rows()) = _conDer.transpose();
-        rhs.segment(vars, _con.size()) = -_con;
+    //Around a closed curve, the continuity constraints are nearly dependent when the curve is nearly a circle: closing
+    //the tangent angle then all but closes the position.  Their rows are regularized by this fraction of their diagonal
+    //in the Schur complement of the constraints, which keeps the multipliers of the dependent combination (and so the
+    //step) from being set by rounding.
+    static double _closureRegularization() { return 1e-6; }
 
-        int cnt = 0;
-        for(set<LSBoxConstraint>::const_iterator it = constraints.begin(); it != constraints.end(); ++it, ++cnt)
-            lhs(vars + _conDer.rows() + cnt, it->index) = lhs(it->index, vars + _conDer.rows() + cnt) = 1.;
+    vector<size_t> _blockIndices, _blockSizes;
+    bool _closed;
+    BlockVectorType _errDerBlocks;
 
-        //lhs += damping * MatrixXd::Identity(size, size);
-        lhs.block(0, 0, vars, vars) += damping * MatrixXd::Identity(vars, vars);
-        VectorXd result = lhs.lu().solve(rhs);
+    Eigen::VectorXd _err;
+    Eigen::VectorXd _con;
+    ConBlockVectorType _conDerBlocks;
+    ConBlockVectorType _conDerNextBlocks;
+};
 
-        out = result.segment(0, vars);
+//Solves the whole KKT system (the damped Hessian, the constraints and the active box constraints) by LU, on the
+//stack.  That is cubic in the number of curves, so it's only for paths of up to MAX_CURVES curves, which most are.
+//In the benchmark sketches, it combines paths of two and three curves slightly faster than the sparse solve (a
+//few percent of the combiner's time, most of which goes to the error evaluation).  The same solve with
+//heap-allocated matrices is never faster: at four curves, it is already 40% slower.
+class MulticurveDenseEvalData : public MulticurveEvalData
+{
+public:
+    enum { MAX_CURVES = 3, MAX_SIZE = MAX_CURVES * (6 + 4 + 6) }; //at most 6 variables, 4 continuity and 6 box constraints per curve
 
-#if 0
-        printf("Solve err = %lf\n", (lhs * result - rhs).norm());
-        if(_conDer.size() > 0)
-            printf("Con Solve err = %lf\n", (_conDer * out + _con).norm());
-#endif
+    //override
+    void solveForDelta(double damping, Eigen::VectorXd &out, std::set<LSBoxConstraint> &constraints)
+    {
+        typedef Matrix<double, Dynamic, Dynamic, 0, MAX_SIZE, MAX_SIZE> SystemMatrix;
+        typedef Matrix<double, Dynamic, 1, 0, MAX_SIZE, 1> SystemVector;
+
+        _computeIndices();
+        int n = (int)_errDerBlocks.size();
+        int vars = (int)_blockIndices.back();
+        int numCon = (int)_con.size();
+        int size = vars + numCon + (int)constraints.size();
+
+        SystemMatrix lhs = SystemMatrix::Zero(size, size);
+        SystemVector rhs = SystemVector::Zero(size);
+        for(int i = 0; i < n; ++i)
+        {
+            lhs.block(_blockIndices[i], _blockIndices[i], _blockSizes[i], _blockSizes[i]) =
+                _errDerBlocks[i] + damping * BlockType::Identity(_blockSizes[i], _blockSizes[i]);
+            rhs.segment(_blockIndices[i], _blockSizes[i]) = _err.segment(_blockIndices[i], _blockSizes[i]);
+        }
+
+        for(int i = 0, row = vars; i < (int)_conDerBlocks.size(); row += (int)_conDerBlocks[i].rows(), ++i)
+        {
+            int rows = (int)_conDerBlocks[i].rows();
+            int next = (i + 1) % n;
+            lhs.block(row, _blockIndices[i], rows, _blockSizes[i]) = _conDerBlocks[i];
+            lhs.block(row, _blockIndices[next], rows, _blockSizes[next]) += _conDerNextBlocks[i]; //for a closed curve of one primitive, next is i
+        }
+        lhs.block(0, vars, vars, numCon) = lhs.block(vars, 0, numCon, vars).transpose();
+        rhs.segment(vars, numCon) = -_con;
+        if(_closed) //with the Schur complement diagonal estimated from the Hessian's
+        {
+            for(int row = vars; row < vars + numCon; ++row)
+            {
+                double diagonal = 0.;
+                for(int j = 0; j < vars; ++j)
+                    diagonal += lhs(row, j) * lhs(row, j) / lhs(j, j);
+                lhs(row, row) = -_closureRegularization() * diagonal;
+            }
+        }
+
+        int cnt = 0;
+        for(set<LSBoxConstraint>::const_iterator it = constraints.begin(); it != constraints.end(); ++it, ++cnt)
+            lhs(vars + numCon + cnt, it->index) = lhs(it->index, vars + numCon + cnt) = 1.;
+
+        SystemVector result = PartialPivLU<SystemMatrix>(lhs).solve(rhs);
+        out = result.head(vars);
 
         //check which constraints we don't need
         cnt = 0;
@@ -87,7 +162,7 @@ public:
         {
             set<LSBoxConstraint>::iterator next = it;
             ++next;
-            if(result(vars + _conDer.rows() + cnt) * it->sign > 0)
+            if(result(vars + numCon + cnt) * it->sign > 0)
             {
                 //printf("Unsetting constraint on variable at index %d\n", it->index);
                 constraints.erase(it);
@@ -95,155 +170,426 @@ public:
             it = next;
         }
     }
-
-    //for derivative verification, combine error and constraints
-    VectorXd errVec() const
-    {
-        VectorXd out(_err.size() + _con.size());
-        out << _err, _con;
-        return out;
-    }
-
-    MatrixXd errVecDer() const
-    {
-        MatrixXd out(_err.size() + _con.size(), _errDer.cols());
-        out << _errDer, _conDer;
-        return out;
-    }
-
-    VectorXd &errVectorRef() { return _err; }
-    MatrixXd &errDerRef() { return _errDer; }
-
-    VectorXd &conVectorRef() { return _con; }
-    MatrixXd &conDerRef() { return _conDer; }
-
-private:
-    Eigen::VectorXd _err;
-    Eigen::MatrixXd _errDer;
-    Eigen::VectorXd _con;
-    Eigen::MatrixXd _conDer;
 };
 
-class MulticurveSparseEvalData : public LSEvalData
+//The error Hessian is block diagonal (one block per curve) and every constraint row involves at most
+//two consecutive curves, so the Schur complement of the constraints is block tridiagonal--cyclic for
+//closed curves.  Constraint rows are grouped so that group g has the continuity constraints between
+//curves g and g + 1 followed by the box constraints on the variables of curve g.  Then group g only
+//shares curves with groups g - 1 and g + 1, and the whole solve is linear in the number of curves.
+//An open chain of curves may also have links: constraint rows between any two curves (or one), for joining
+//strokes fitted together (see JointMulticurveProblem).  They border the block tridiagonal part like the last
+//group of a closed curve does.
+class MulticurveSparseEvalData : public MulticurveEvalData
 {
 public:
-    typedef Matrix<double, Dynamic, Dynamic, 0, 6, 6> BlockType;
-    typedef vector<BlockType, aligned_allocator<BlockType> > BlockVectorType;
-    typedef LLT<BlockType> BlockCholType;
-    typedef vector<BlockCholType, aligned_allocator<BlockCholType> > BlockCholVectorType;
-
     //overrides
-    double error() const { return _con.squaredNorm(); }
+    double error() const { return _con.squaredNorm() + _linkCon.squaredNorm(); }
 
     void solveForDelta(double damping, Eigen::VectorXd &out, std::set<LSBoxConstraint> &constraints)
     {
         _computeIndices();
+        assert(_linkCurves.empty() || !_closed);
+        _computeGroups(constraints);
+
+        int n = (int)_errDerBlocks.size();
+        _chols.resize(n);
+        for(int i = 0; i < n; ++i)
+            _chols[i].compute(_errDerBlocks[i] + damping * BlockType::Identity(_blockSizes[i], _blockSizes[i]));
+
+        //W = L^-1 C^T, restricted to each group's curves, and the Schur complement right hand side C H^-1 rhs - c
+        _wSelf.resize(n);
+        _wNext.resize(n);
+        _lambda.resize(n);
+        for(int g = 0; g < n; ++g)
+        {
+            _wSelf[g] = _chols[g].matrixL().solve(_groupSelf[g].transpose());
+            _lambda[g] = _groupSelf[g] * _chols[g].solve(_err.segment(_blockIndices[g], _blockSizes[g])) - _groupRhs[g];
 
-        size_t vars = _blockIndices.back();
-        size_t cons = _con.size() + constraints.size();
-
-        size_t size = vars + cons;
-        VectorXd rhs = VectorXd::Zero(size);
-        rhs.segment(0, vars) = _err;
-        rhs.segment(vars, _con.size()) = -_con;
-
-        BlockCholVectorType cholBlocks(_errDerBlocks.size());
-        for(size_t i = 0; i < cholBlocks.size(); ++i)
-            cholBlocks[i] = BlockCholType(_errDerBlocks[i] + damping * MatrixXd::Identity(_blockSizes[i], _blockSizes[i]));
-
-        MatrixXd C = MatrixXd::Zero(cons, vars);
-        C.block(0, 0, _con.size(), vars) = _conDer;
-
-        int cnt = 0;
-        for(set<LSBoxConstraint>::const_iterator it = constraints.begin(); it != constraints.end(); ++it, ++cnt)
-            C(_conDer.rows() + cnt, it->index) = 1.;
-
-        MatrixXd K(C.cols(), C.rows());
-        _solveCholL(K, cholBlocks, C.transpose());
-        LLT<MatrixXd> CholK(K.transpose() * K);
-
-        VectorXd mid(size), result(size);
-
-        //solve for mid
-        _solveCholL(mid.segment(0, vars), cholBlocks, rhs.segment(0, vars));
-        mid.segment(vars, cons) = CholK.matrixL().solve(rhs.segment(vars, cons) - K.adjoint() * mid.segment(0, vars));
+            int next = _next(g);
+            if(next >= 0)
+            {
+                _wNext[g] = _chols[next].matrixL().solve(_groupNext[g].transpose());
+                _lambda[g] += _groupNext[g] * _chols[next].solve(_err.segment(_blockIndices[next], _blockSizes[next]));
+            }
+        }
 
-        //solve for result
-        result.segment(vars, cons) = -CholK.matrixU().solve(mid.segment(vars, cons));
-        _solveCholU(result.segment(0, vars), cholBlocks, mid.segment(0, vars) - K * result.segment(vars, cons));
+        //solve the Schur complement system for the Lagrange multipliers
+        if(!_linkCurves.empty())
+            _solveWithLinks();
+        else if(_closed && n < 3)
+            _solveDense();
+        else
+            _solveBlockTridiagonal();
+
+        //back substitute for the variables: x = H^-1 (rhs - C^T lambda)
+        if(!_linkCurves.empty())
+            _linkRhs.assign(n, BlockColType());
+        for(int k = 0, row = 0; k < (int)_linkCurves.size(); row += (int)_linkDerBlocks[k].rows(), ++k)
+        {
+            int r = (int)_linkDerBlocks[k].rows();
+            _addToLinkRhs(_linkCurves[k].first, _linkDerBlocks[k].transpose() * _linkLambda.segment(row, r));
+            _addToLinkRhs(_linkCurves[k].second, _linkDerOtherBlocks[k].transpose() * _linkLambda.segment(row, r));
+        }
+        out.resize(_blockIndices.back());
+        for(int i = 0; i < n; ++i)
+        {
+            BlockColType rhs = _err.segment(_blockIndices[i], _blockSizes[i]) - _groupSelf[i].transpose() * _lambda[i];
+            if(_prev(i) >= 0)
+                rhs -= _groupNext[_prev(i)].transpose() * _lambda[_prev(i)];
+            if(!_linkCurves.empty() && _linkRhs[i].size() > 0)
+                rhs -= _linkRhs[i];
+            out.segment(_blockIndices[i], _blockSizes[i]) = _chols[i].solve(rhs);
+        }
 
-        out = result.segment(0, vars);
 #if 0
-        if(_conDer.size() > 0)
-            printf("Con Solve err = %lf\n", (_conDer * out + _con).norm());
+        printf("Con Solve err = %lf\n", (_conDerTimes(out) + _con).norm());
 #endif
 
         //check which constraints we don't need
-        cnt = 0;
-        for(set<LSBoxConstraint>::iterator it = constraints.begin(); it != constraints.end(); ++cnt)
+        int g = 0, cnt = 0;
+        for(set<LSBoxConstraint>::iterator it = constraints.begin(); it != constraints.end();)
         {
             set<LSBoxConstraint>::iterator next = it;
             ++next;
-            if(result(vars + _conDer.rows() + cnt) * it->sign > 0)
+            for(; it->index >= (int)_blockIndices[g + 1]; ++g)
+                cnt = 0;
+            if(_lambda[g][_groupJunctionRows(g) + cnt] * it->sign > 0)
             {
                 //printf("Unsetting constraint on variable at index %d\n", it->index);
                 constraints.erase(it);
             }
+            ++cnt;
             it = next;
         }
     }
 
-    VectorXd &errVectorRef() { return _err; }
-    BlockVectorType &errDerBlocksRef() { return _errDerBlocks; }
-
-    VectorXd &conVectorRef() { return _con; }
-    MatrixXd &conDerRef() { return _conDer; }
+    //the links are only for open chains of curves
+    VectorXd &linkVectorRef() { return _linkCon; }
+    vector<pair<int, int> > &linkCurvesRef() { return _linkCurves; } //the two curves of each link, which may be the same
+    ConBlockVectorType &linkDerBlocksRef() { return _linkDerBlocks; } //derivative of each link w.r.t. its first curve
+    ConBlockVectorType &linkDerOtherBlocksRef() { return _linkDerOtherBlocks; } //...and w.r.t. its second curve
+    void clearLinks() //before the workspace hands it to a problem without links, whose eval doesn't touch them
+    {
+        _linkCon.resize(0);
+        _linkCurves.clear();
+        _linkDerBlocks.clear();
+        _linkDerOtherBlocks.clear();
+    }
 
 private:
-    void _computeIndices()
+    typedef Matrix<double, Dynamic, Dynamic, 0, 10, 6> GroupConType; //at most 4 continuity and 6 box constraints
+    typedef Matrix<double, Dynamic, Dynamic, 0, 6, 10> GroupWType;
+    typedef Matrix<double, Dynamic, 1, 0, 6, 1> BlockColType;
+    typedef Matrix<double, Dynamic, Dynamic, 0, 10, 10> GroupBlockType;
+    typedef Matrix<double, Dynamic, 1, 0, 10, 1> GroupVectorType;
+    typedef LLT<BlockType> BlockCholType;
+    typedef LLT<GroupBlockType> GroupCholType;
+
+    //builds the constraint rows of each group and their right hand sides
+    void _computeGroups(const set<LSBoxConstraint> &constraints)
     {
-        _blockIndices.resize(_errDerBlocks.size() + 1);
-        _blockSizes.resize(_errDerBlocks.size());
-        _blockIndices[0] = 0;
+        int n = (int)_errDerBlocks.size();
+        _groupSelf.resize(n);
+        _groupNext.resize(n);
+        _groupRhs.resize(n);
+
+        set<LSBoxConstraint>::const_iterator it = constraints.begin();
+        int conIdx = 0;
+        for(int g = 0; g < n; ++g)
+        {
+            int junctionRows = _groupJunctionRows(g);
+            int numBox = 0;
+            for(set<LSBoxConstraint>::const_iterator bit = it; bit != constraints.end() && bit->index < (int)_blockIndices[g + 1]; ++bit)
+                ++numBox;
 
-        for(int i = 0; i < (int)_errDerBlocks.size(); ++i)
+            int next = _next(g);
+            _groupSelf[g] = GroupConType::Zero(junctionRows + numBox, _blockSizes[g]);
+            _groupNext[g] = GroupConType::Zero(junctionRows + numBox, next >= 0 ? _blockSizes[next] : 0);
+            _groupRhs[g] = GroupVectorType::Zero(junctionRows + numBox);
+
+            if(junctionRows > 0)
+            {
+                _groupSelf[g].topRows(junctionRows) = _conDerBlocks[g];
+                _groupNext[g].topRows(junctionRows) = _conDerNextBlocks[g];
+                _groupRhs[g].head(junctionRows) = -_con.segment(conIdx, junctionRows);
+                conIdx += junctionRows;
+            }
+
+            for(int i = 0; i < numBox; ++i, ++it)
+                _groupSelf[g](junctionRows + i, it->index - _blockIndices[g]) = 1.;
+        }
+    }
+
+    int _groupJunctionRows(int g) const { return g < (int)_conDerBlocks.size() ? (int)_conDerBlocks[g].rows() : 0; }
+    //the curve other than g that group g involves, or -1
+    int _next(int g) const { return g < (int)_conDerBlocks.size() ? (g + 1) % (int)_errDerBlocks.size() : -1; }
+    //the group other than g that involves curve g, or -1
+    int _prev(int g) const { return g > 0 ? g - 1 : (_closed ? (int)_errDerBlocks.size() - 1 : -1); }
+
+    //Block Cholesky of the block tridiagonal Schur complement.  For a closed curve, the last group
+    //becomes a border: the other groups form a chain and the last row of the factor is dense.  On input,
+    //_lambda holds the right hand side, on output, the solution.
+    void _solveBlockTridiagonal()
+    {
+        int n = (int)_errDerBlocks.size();
+        int chain = _closed ? n - 1 : n;
+        int last = n - 1;
+
+        _border.resize(n);
+        _factorChain(chain);
+
+        if(_closed)
         {
-            _blockSizes[i] = _errDerBlocks[i].rows();
-            _blockIndices[i + 1] = _blockIndices[i] + _blockSizes[i];
+            GroupBlockType d = _diagonal(last);
+            for(int g = 0; g < chain; ++g)
+            {
+                GroupBlockType s = GroupBlockType::Zero(_lambda[last].size(), _lambda[g].size());
+                if(g == 0)
+                    s += _offDiagonal(last);
+                if(g == chain - 1)
+                    s += _offDiagonal(g).transpose();
+                if(g > 0)
+                    s -= _border[g - 1] * _sub[g].transpose();
+
+                _border[g] = _groupChols[g].matrixL().solve(s.transpose()).transpose();
+                d -= _border[g] * _border[g].transpose();
+            }
+            _groupChols[last].compute(d);
+        }
+
+        //forward substitution
+        for(int g = 0; g < chain; ++g)
+        {
+            if(g > 0)
+                _lambda[g] -= _sub[g] * _lambda[g - 1];
+            _groupChols[g].matrixL().solveInPlace(_lambda[g]);
+        }
+        if(_closed)
+        {
+            for(int g = 0; g < chain; ++g)
+                _lambda[last] -= _border[g] * _lambda[g];
+            _groupChols[last].matrixL().solveInPlace(_lambda[last]);
+            _groupChols[last].matrixU().solveInPlace(_lambda[last]);
+        }
+
+        //back substitution
+        for(int g = chain - 1; g >= 0; --g)
+        {
+            if(g + 1 < chain)
+                _lambda[g] -= _sub[g + 1].transpose() * _lambda[g + 1];
+            if(_closed)
+                _lambda[g] -= _border[g].transpose() * _lambda[last];
+            _groupChols[g].matrixU().solveInPlace(_lambda[g]);
         }
     }
 
-    MatrixXd _blocksToMatrix(const BlockVectorType &blocks)
+    //the block Cholesky factor of the Schur complement of the first chain groups
+    void _factorChain(int chain)
     {
-        size_t sz = _blockIndices.back();
-        MatrixXd out = MatrixXd::Zero(sz, sz);
+        int n = (int)_errDerBlocks.size();
+        _groupChols.resize(n);
+        _sub.resize(n);
 
-        for(int i = 0; i < (int)blocks.size(); ++i)
-            out.block(_blockIndices[i], _blockIndices[i], _blockSizes[i], _blockSizes[i]) = blocks[i];
+        for(int g = 0; g < chain; ++g)
+        {
+            GroupBlockType d = _diagonal(g);
+            if(g > 0)
+            {
+                _sub[g] = _groupChols[g - 1].matrixL().solve(_offDiagonal(g - 1)).transpose();
+                d -= _sub[g] * _sub[g].transpose();
+            }
+            _groupChols[g].compute(d);
+        }
+    }
 
+    //With links, the groups form an open chain and all the link rows together are the border: the factor gets
+    //a dense block of link rows for every group, and a dense link by link block at the end.  So the cost is
+    //linear in the number of curves for a given number of link rows.  The multipliers of the links are left in
+    //_linkLambda.
+    void _solveWithLinks()
+    {
+        int n = (int)_errDerBlocks.size();
+        int numLinks = (int)_linkCurves.size();
+
+        //W = L^-1 C^T for the links, and their part of the right hand side
+        _linkRows.resize(numLinks + 1);
+        _linkRows[0] = 0;
+        _linkWSelf.resize(numLinks);
+        _linkWOther.resize(numLinks);
+        _linkLambda = _linkCon;
+        for(int k = 0; k < numLinks; ++k)
+        {
+            int a = _linkCurves[k].first, b = _linkCurves[k].second;
+            int r = (int)_linkDerBlocks[k].rows();
+            _linkRows[k + 1] = _linkRows[k] + r;
+            _linkWSelf[k] = _chols[a].matrixL().solve(_linkDerBlocks[k].transpose());
+            _linkWOther[k] = _chols[b].matrixL().solve(_linkDerOtherBlocks[k].transpose());
+            _linkLambda.segment(_linkRows[k], r) += _linkDerBlocks[k] * _chols[a].solve(_err.segment(_blockIndices[a], _blockSizes[a])) +
+                _linkDerOtherBlocks[k] * _chols[b].solve(_err.segment(_blockIndices[b], _blockSizes[b]));
+        }
+        int m = _linkRows.back();
+
+        _factorChain(n);
+
+        //the border: S(links, g) goes through the factor of the chain
+        _linkBorder.resize(n);
+        MatrixXd linkDiagonal = _linkDiagonal();
+        for(int g = 0; g < n; ++g)
+        {
+            MatrixXd s = MatrixXd::Zero(m, _lambda[g].size());
+            for(int k = 0; k < numLinks; ++k)
+            {
+                for(int side = 0; side < 2; ++side)
+                {
+                    int c = side ? _linkCurves[k].second : _linkCurves[k].first;
+                    const GroupWType &w = side ? _linkWOther[k] : _linkWSelf[k];
+                    if(c == g)
+                        s.middleRows(_linkRows[k], w.cols()) += w.transpose() * _wSelf[g];
+                    if(_next(g) == c)
+                        s.middleRows(_linkRows[k], w.cols()) += w.transpose() * _wNext[g];
+                }
+            }
+            if(g > 0)
+                s -= _linkBorder[g - 1] * _sub[g].transpose();
+
+            _linkBorder[g] = _groupChols[g].matrixL().solve(s.transpose()).transpose();
+            linkDiagonal -= _linkBorder[g] * _linkBorder[g].transpose();
+        }
+        LLT<MatrixXd> linkChol(linkDiagonal);
+
+        //forward substitution
+        for(int g = 0; g < n; ++g)
+        {
+            if(g > 0)
+                _lambda[g] -= _sub[g] * _lambda[g - 1];
+            _groupChols[g].matrixL().solveInPlace(_lambda[g]);
+            _linkLambda -= _linkBorder[g] * _lambda[g];
+        }
+        linkChol.solveInPlace(_linkLambda);
+
+        //back substitution
+        for(int g = n - 1; g >= 0; --g)
+        {
+            if(g + 1 < n)
+                _lambda[g] -= _sub[g + 1].transpose() * _lambda[g + 1];
+            _lambda[g] -= _linkBorder[g].transpose() * _linkLambda;
+            _groupChols[g].matrixU().solveInPlace(_lambda[g]);
+        }
+    }
+
+    //S(links, links): links that share a curve
+    MatrixXd _linkDiagonal() const
+    {
+        int numLinks = (int)_linkCurves.size();
+        MatrixXd out = MatrixXd::Zero(_linkRows.back(), _linkRows.back());
+        for(int k = 0; k < numLinks; ++k)
+        {
+            for(int l = 0; l < numLinks; ++l)
+            {
+                for(int side = 0; side < 4; ++side)
+                {
+                    int ck = (side & 1) ? _linkCurves[k].second : _linkCurves[k].first;
+                    int cl = (side & 2) ? _linkCurves[l].second : _linkCurves[l].first;
+                    if(ck != cl)
+                        continue;
+                    const GroupWType &wk = (side & 1) ? _linkWOther[k] : _linkWSelf[k];
+                    const GroupWType &wl = (side & 2) ? _linkWOther[l] : _linkWSelf[l];
+                    out.block(_linkRows[k], _linkRows[l], wk.cols(), wl.cols()) += wk.transpose() * wl;
+                }
+            }
+        }
         return out;
     }
 
-    template<class M1, class M2> void _solveCholL(const M1 &out, const BlockCholVectorType &chols, const M2 &rhs)
+    void _addToLinkRhs(int curve, const BlockColType &v)
     {
-        for(int i = 0; i < (int)chols.size(); ++i)
-            const_cast<M1 &>(out).block(_blockIndices[i], 0, _blockSizes[i], out.cols()) =
-                chols[i].matrixL().solve(rhs.block(_blockIndices[i], 0, _blockSizes[i], rhs.cols()));
+        if(_linkRhs[curve].size() == 0)
+            _linkRhs[curve] = v;
+        else
+            _linkRhs[curve] += v;
     }
 
-    template<class M1, class M2> void _solveCholU(const M1 &out, const BlockCholVectorType &chols, const M2 &rhs)
+    //S(g, g) = W_g^T W_g
+    GroupBlockType _diagonal(int g) const
     {
-        for(int i = 0; i < (int)chols.size(); ++i)
-            const_cast<M1 &>(out).block(_blockIndices[i], 0, _blockSizes[i], out.cols()) =
-                chols[i].matrixU().solve(rhs.block(_blockIndices[i], 0, _blockSizes[i], rhs.cols()));
+        GroupBlockType out = _wSelf[g].transpose() * _wSelf[g];
+        if(_next(g) >= 0)
+            out += _wNext[g].transpose() * _wNext[g];
+        if(_closed)
+        {
+            for(int i = 0; i < _groupJunctionRows(g); ++i)
+                out(i, i) *= 1. + _closureRegularization();
+        }
+        return out;
     }
 
-    vector<size_t> _blockIndices, _blockSizes;
-    BlockVectorType _errDerBlocks;
+    //S(g, g + 1): groups g and g + 1 share curve g + 1
+    GroupBlockType _offDiagonal(int g) const
+    {
+        return _wNext[g].transpose() * _wSelf[_next(g)];
+    }
 
-    Eigen::VectorXd _err;
-    Eigen::VectorXd _con;
-    Eigen::MatrixXd _conDer;
+    //For a closed curve with one or two primitives, groups share more than one curve, so the Schur
+    //complement is formed densely--it is tiny anyway.
+    void _solveDense()
+    {
+        int n = (int)_errDerBlocks.size();
+        vector<int> groupIndices(n + 1, 0);
+        for(int g = 0; g < n; ++g)
+            groupIndices[g + 1] = groupIndices[g] + (int)_lambda[g].size();
+
+        MatrixXd W = MatrixXd::Zero(_blockIndices.back(), groupIndices.back());
+        VectorXd rhs(groupIndices.back());
+        for(int g = 0; g < n; ++g)
+        {
+            int sz = (int)_lambda[g].size();
+            W.block(_blockIndices[g], groupIndices[g], _blockSizes[g], sz) += _wSelf[g];
+            W.block(_blockIndices[_next(g)], groupIndices[g], _blockSizes[_next(g)], sz) += _wNext[g];
+            rhs.segment(groupIndices[g], sz) = _lambda[g];
+        }
+
+        MatrixXd schur = W.transpose() * W;
+        for(int g = 0; g < n; ++g)
+        {
+            for(int i = 0; i < _groupJunctionRows(g); ++i)
+                schur(groupIndices[g] + i, groupIndices[g] + i) *= 1. + _closureRegularization();
+        }
+        VectorXd result = LLT<MatrixXd>(schur).solve(rhs);
+        for(int g = 0; g < n; ++g)
+            _lambda[g] = result.segment(groupIndices[g], _lambda[g].size());
+    }
+
+#if 0
+    VectorXd _conDerTimes(const VectorXd &x) const
+    {
+        VectorXd out = VectorXd::Zero(_con.size());
+        for(int i = 0, conIdx = 0; i < (int)_conDerBlocks.size(); conIdx += _conDerBlocks[i].rows(), ++i)
+        {
+            int next = _next(i);
+            out.segment(conIdx, _conDerBlocks[i].rows()) = _conDerBlocks[i] * x.segment(_blockIndices[i], _blockSizes[i]) +
+                _conDerNextBlocks[i] * x.segment(_blockIndices[next], _blockSizes[next]);
+        }
+        return out;
+    }
+#endif
+
+    Eigen::VectorXd _linkCon;
+    vector<pair<int, int> > _linkCurves;
+    ConBlockVectorType _linkDerBlocks, _linkDerOtherBlocks;
+
+    //solver workspace, kept to avoid reallocation between iterations
+    vector<BlockCholType, aligned_allocator<BlockCholType> > _chols;
+    vector<GroupConType, aligned_allocator<GroupConType> > _groupSelf, _groupNext;
+    vector<GroupVectorType, aligned_allocator<GroupVectorType> > _groupRhs, _lambda;
+    vector<GroupWType, aligned_allocator<GroupWType> > _wSelf, _wNext;
+    vector<GroupCholType, aligned_allocator<GroupCholType> > _groupChols;
+    vector<GroupBlockType, aligned_allocator<GroupBlockType> > _sub, _border;
+    vector<int> _linkRows; //the first row of each link, and the total
+    vector<GroupWType, aligned_allocator<GroupWType> > _linkWSelf, _linkWOther;
+    vector<MatrixXd> _linkBorder;
+    vector<BlockColType, aligned_allocator<BlockColType> > _linkRhs;
+    VectorXd _linkLambda;
 };
 
 class MulticurveProblem : public LSProblem
@@ -256,16 +602,24 @@ public:
         const vector<int> &path = fitter.output<PATH_FINDING>()->path;
         _errorComputer = fitter.output<ERROR_COMPUTER>()->errorComputer;
         _closed = fitter.output<CURVE_CLOSING>()->closed;
-        _inflectionAccounting = fitter.params().get(Parameters::INFLECTION_COST) > 0.;
+        _inflectionAccounting = fitter.config().get(Parameters::INFLECTION_COST) > 0.;
 
-        for(int i = 0; i < (int)path.size(); ++i)
+        if(graph->edges[path[0]].continuity == -1) //a single primitive, only solved for with other strokes
         {
-            _primIdcs.push_back(graph->edges[path[i]].startVtx);
-            _continuities.push_back(graph->edges[path[i]].continuity);
+            _primIdcs.push_back(graph->edges[path[0]].startVtx);
+            _closed = false;
         }
-        if(!_closed)
-            _primIdcs.push_back(graph->edges[path.back()].endVtx);
-        
+        else
+        {
+            for(int i = 0; i < (int)path.size(); ++i)
+            {
+                _primIdcs.push_back(graph->edges[path[i]].startVtx);
+                _continuities.push_back(graph->edges[path[i]].continuity);
+            }
+            if(!_closed)
+                _primIdcs.push_back(graph->edges[path.back()].endVtx);
+        }
+
         _curves = VectorC<CurvePrimitivePtr>((int)_primIdcs.size(), _closed ? CIRCULAR : NOT_CIRCULAR);
         _curveRanges = VectorC<pair<int, int> >((int)_primIdcs.size(), _curves.circular());
         for(int i = 0; i < (int)_primIdcs.size(); ++i)
@@ -276,13 +630,17 @@ public:
 
         //trim curves and ranges
         const int sampledPts = fitter.output<RESAMPLING>()->output->pts().size();
+        const vector<Combination> &combinations = fitter.output<PATH_FINDING>()->combinations;
         for(int i = 0; i < (int)_continuities.size(); ++i)
         {
             if(_continuities[i] == 0)
                 continue;
 
-            //trim
+            //trim at the joint found when the edge was validated if there is one--it's closer to the
+            //solution than the midpoint and the solver takes fewer iterations from there
             Vector2d trimPt = 0.5 * (_curves[i]->endPos() + _curves[i + 1]->startPos());
+            if(i < (int)combinations.size() && combinations[i].c2)
+                trimPt = combinations[i].c2->startPos();
             if(!_primitives[_primIdcs[i]].isFixed())
                 _curves[i]->trim(0, _curves[i]->project(trimPt));
             if(_curves.circular() || !_primitives[_primIdcs[i + 1]].isFixed())
@@ -364,18 +722,21 @@ public:
         return out;
     }
 
-#if SPARSE
-    typedef MulticurveSparseEvalData EvalDataType;
-#else
-    typedef MulticurveDenseEvalData EvalDataType;
-#endif
-
     int _iter;
-    LSEvalData *createEvalData() { return new EvalDataType(); }
+    LSEvalData *createEvalData() { return createEvalData((int)_curves.size()); }
+    void releaseEvalData(LSEvalData *data) { LSWorkspace::current().give(data); }
+    //from the calling thread's workspace, so it goes back there when done
+    static MulticurveEvalData *createEvalData(int numCurves)
+    {
+        if(numCurves <= MulticurveDenseEvalData::MAX_CURVES)
+            return LSWorkspace::current().take<MulticurveDenseEvalData>();
+        return LSWorkspace::current().take<MulticurveSparseEvalData>();
+    }
+
     void eval(const Eigen::VectorXd &x, LSEvalData *data)
     {
         setParams(x);
-        EvalDataType *evalData = static_cast<EvalDataType *>(data);
+        MulticurveEvalData *evalData = static_cast<MulticurveEvalData *>(data);
         _evalError(evalData);
         _evalConstraints(evalData);
         //printf("Err: obj = %lf con = %lf\n", evalData->errVectorRef().norm(), evalData->conVectorRef().norm()); 
@@ -392,7 +753,7 @@ public:
             }
             else
             {
-                VectorXd xm = x.segment(curIdx, _curves[i]->numParams());
+                CurvePrimitive::ParamVec xm = x.segment(curIdx, _curves[i]->numParams());
                 xm(CurvePrimitive::DCURVATURE) = (xm(CurvePrimitive::DCURVATURE) - xm(CurvePrimitive::CURVATURE)) / xm(CurvePrimitive::LENGTH);
                 _curves[i]->setParams(xm);
             }
@@ -404,7 +765,7 @@ public:
             char name[100];
             sprintf(name, "Out%d", _iter);
             for(int i = 0; i < _curves.size(); ++i)
-                Debugging::get()->drawPrimitive(_curves[i], name, i, 2.);
+                CORNU_DEBUG(drawPrimitive(_curves[i], name, i, 2.));
         }
 
         ++_iter;
@@ -437,6 +798,10 @@ public:
         return out;
     }
 
+    int numCurves() const { return _curves.size(); }
+    CurvePrimitiveConstPtr curve(int i) const { return _curves[i]; }
+    bool closed() const { return _closed; }
+
     VectorC<CurvePrimitiveConstPtr> curves() const
     {
         VectorC<CurvePrimitiveConstPtr> out;
@@ -461,108 +826,86 @@ public:
     }
 
 private:
-    void _evalError(EvalDataType *evalData)
+    //The solves only need J^T J and J^T e of each curve, which are added up sample by sample, without
+    //making the error vectors and their derivatives.  J is w.r.t. the parameters made by setParams, which is
+    //(the derivative w.r.t. the curve's parameters) T for the T that CurvePrimitive::toEndCurvatureDerivative
+    //applies, so the blocks are T^T J^T J T and T^T J^T e.
+    void _evalError(MulticurveEvalData *evalData)
     {
-        vector<VectorXd> errVecs(_curves.size());
-        vector<MatrixXd> errVecDers(_curves.size());
+        MulticurveEvalData::BlockVectorType &outErrDerBlocks = evalData->errDerBlocksRef();
+        VectorXd &outErr = evalData->errVectorRef();
+        outErrDerBlocks.resize(_curves.size());
+        _footPoints.resize(_curves.size());
+
+        size_t numVar = 0;
+        for(int i = 0; i < (int)_curves.size(); ++i)
+            numVar += _curves[i]->numParams();
+        outErr.resize(numVar);
 
-        size_t numErr = 0, numVar = 0;
+        ErrorComputer::NormalVector jtE;
+        size_t curVar = 0;
         for(int i = 0; i < (int)_curves.size(); ++i)
         {
             int csz = (int)_continuities.size();
             bool firstCorner = (!_closed && i == 0) || (_continuities[(i + csz - 1) % csz] == 0);
             bool lastCorner = (!_closed && i + 1 == (int)_curves.size()) || (_continuities[i] == 0);
 
-            _errorComputer->computeErrorVector(_curves[i], _curveRanges[i].first, _curveRanges[i].second,
-                errVecs[i], &(errVecDers[i]), firstCorner, lastCorner);
-            
-            _curves[i]->toEndCurvatureDerivative(errVecDers[i]);
-
-            numErr += errVecs[i].size();
-            numVar += _curves[i]->numParams();
-        }
-
-        VectorXd &outErr = evalData->errVectorRef();
+            _errorComputer->computeErrorNormalEquations(_curves[i], _curveRanges[i].first, _curveRanges[i].second,
+                outErrDerBlocks[i], jtE, firstCorner, lastCorner, false, &(_footPoints[i]));
 
-#if SPARSE
-        EvalDataType::BlockVectorType &outErrDerBlocks = evalData->errDerBlocksRef();
-        outErrDerBlocks.resize(_curves.size());
-        outErr = VectorXd::Zero(numVar);
-#else
-        outErr = VectorXd::Zero(numErr);
-        MatrixXd &outErrDer = evalData->errDerRef();
-        outErrDer = MatrixXd::Zero(numErr, numVar);
-#endif
+            if(_curves[i]->getType() == CurvePrimitive::CLOTHOID)
+            {
+                MulticurveEvalData::BlockType &m = outErrDerBlocks[i];
+                _curves[i]->toEndCurvatureDerivative(m);
+                m.transposeInPlace();
+                _curves[i]->toEndCurvatureDerivative(m);
+
+                MulticurveEvalData::BlockType row = jtE.transpose();
+                _curves[i]->toEndCurvatureDerivative(row);
+                jtE = row.transpose();
+            }
 
-        size_t curErr = 0, curVar = 0;
-        for(int i = 0; i < (int)_curves.size(); ++i)
-        {
-            size_t nErr = errVecs[i].size();
-            size_t nVar = errVecDers[i].cols();
-#if SPARSE
-            outErrDerBlocks[i] = errVecDers[i].transpose() * errVecDers[i];
-            outErr.segment(curVar, nVar) = -errVecDers[i].transpose() * errVecs[i];
-#else
-            outErrDer.block(curErr, curVar, nErr, nVar) = errVecDers[i];
-            outErr.segment(curErr, nErr) = errVecs[i];
-#endif
-            curErr += nErr;
+            size_t nVar = jtE.size();
+            outErr.segment(curVar, nVar) = -jtE;
             curVar += nVar;
         }
     }
-
-    void _evalConstraints(EvalDataType *evalData)
+    void _evalConstraints(MulticurveEvalData *evalData)
     {
         VectorXd &outCon = evalData->conVectorRef();
-        MatrixXd &outConDer = evalData->conDerRef();
-
-        vector<VectorXd> conVecs(_continuities.size());
-        vector<MatrixXd> conVecDers(_continuities.size());
+        MulticurveEvalData::ConBlockVectorType &outConDerBlocks = evalData->conDerBlocksRef();
+        MulticurveEvalData::ConBlockVectorType &outConDerNextBlocks = evalData->conDerNextBlocksRef();
+        outConDerBlocks.resize(_continuities.size());
+        outConDerNextBlocks.resize(_continuities.size());
 
-        CurvePrimitive::EndDer endDer;
+        size_t numCon = 0;
+        for(int i = 0; i < (int)_continuities.size(); ++i)
+            numCon += 2 + _continuities[i];
+        outCon.resize(numCon);
 
-        size_t numCon = 0, numVar = 0;
+        size_t curCon = 0;
         for(int i = 0; i < (int)_continuities.size(); ++i)
         {
-            conVecs[i].resize(2 + _continuities[i]);
-            conVecs[i].head<2>() = _curves[i]->endPos() - _curves[i + 1]->startPos();
+            size_t nCon = 2 + _continuities[i];
+            outCon.segment<2>(curCon) = _curves[i]->endPos() - _curves[i + 1]->startPos();
             if(_continuities[i] >= 1)
-                conVecs[i][2] = AngleUtils::toRange(_curves[i]->endAngle() - _curves[i + 1]->startAngle(), -PI);
+                outCon[curCon + 2] = AngleUtils::toRange(_curves[i]->endAngle() - _curves[i + 1]->startAngle(), -PI);
             if(_continuities[i] == 2)
-                conVecs[i][3] = _curves[i]->endCurvature() - _curves[i + 1]->startCurvature();
-
-            _curves[i]->derivativeAtEnd(_continuities[i], endDer);
-            conVecDers[i] = endDer;
-            _curves[i]->toEndCurvatureDerivative(conVecDers[i]);
-
-            numCon += conVecs[i].size();
-            numVar += _curves[i]->numParams();
-        }
-
-        if(!_closed)
-            numVar += _curves.back()->numParams();
+                outCon[curCon + 3] = _curves[i]->endCurvature() - _curves[i + 1]->startCurvature();
 
-        outCon = VectorXd::Zero(numCon);
-        outConDer = MatrixXd::Zero(numCon, numVar);
+            _curves[i]->derivativeAtEnd(_continuities[i], outConDerBlocks[i]);
+            _curves[i]->toEndCurvatureDerivative(outConDerBlocks[i]);
 
-        size_t curCon = 0, curVar = 0;
-        for(int i = 0; i < (int)_continuities.size(); ++i)
-        {
-            size_t nCon = conVecs[i].size();
-            size_t nVar = conVecDers[i].cols();
-            outCon.segment(curCon, nCon) = conVecs[i];
-            outConDer.block(curCon, curVar, nCon, nVar) = conVecDers[i];
-
-            //now the derivatives for the second curve
-            outConDer(curCon + 0, (curVar + nVar + CurvePrimitive::X) % numVar) = -1.;
-            outConDer(curCon + 1, (curVar + nVar + CurvePrimitive::Y) % numVar) = -1.;
+            //the constraints are differences, so the derivatives for the second curve are just -1's
+            MulticurveEvalData::ConBlockType &next = outConDerNextBlocks[i];
+            next = MulticurveEvalData::ConBlockType::Zero(nCon, _curves[i + 1]->numParams());
+            next(0, CurvePrimitive::X) = next(1, CurvePrimitive::Y) = -1.;
             if(nCon > 2)
-                outConDer(curCon + 2, (curVar + nVar + CurvePrimitive::ANGLE) % numVar) = -1.;
+                next(2, CurvePrimitive::ANGLE) = -1.;
             if(nCon > 3 && _curves[i + 1]->getType() != CurvePrimitive::LINE)
-                outConDer(curCon + 3, (curVar + nVar + CurvePrimitive::CURVATURE) % numVar) = -1.;
+                next(3, CurvePrimitive::CURVATURE) = -1.;
 
             curCon += nCon;
-            curVar += nVar;
         }
     }
 
@@ -571,180 +914,504 @@ private:
     vector<int> _primIdcs;
     vector<int> _continuities; //continuity[i] is between curves i and i + 1
     VectorC<pair<int, int> > _curveRanges;
+    vector<vector<double> > _footPoints; //per curve, the samples' projections from the last evaluation
     bool _closed;
     ErrorComputerConstPtr _errorComputer;
     bool _inflectionAccounting;
 };
 
-class DefaultCombiner : public Algorithm<COMBINING>
+//The multicurve problems of several strokes solved as one, for fitting them jointly.  The variables and the
+//curves of the strokes go one after the other, with no joint between the last curve of a stroke and the first
+//of the next, so the curves form one open chain for the sparse solver.  The joint closing a closed stroke and
+//the incidences are links: an end of a stroke meeting an end of another is two rows (the difference of their
+//positions), and an end landing along another stroke is one (the distance from the end to the tangent line at
+//its projection on the nearest curve of the other stroke, which is found again at every evaluation).  That's
+//the distance to the curve, except past an end of the other stroke, where it only keeps the end on the line.
+class JointMulticurveProblem : public LSProblem
 {
 public:
-    string name() const { return "Default"; }
+    typedef MulticurveSparseEvalData EvalDataType;
 
-protected:
-    void _run(const Fitter &fitter, AlgorithmOutput<COMBINING> &out)
+    JointMulticurveProblem(const vector<const Fitter *> &fitters, const vector<StrokeIncidence> &incidences)
     {
-        smart_ptr<const AlgorithmOutput<GRAPH_CONSTRUCTION> > graph = fitter.output<GRAPH_CONSTRUCTION>();
-        const vector<FitPrimitive> &primitives = fitter.output<PRIMITIVE_FITTING>()->primitives;
-        const vector<int> &path = fitter.output<PATH_FINDING>()->path;
-        bool closed = fitter.output<CURVE_CLOSING>()->closed;
-
-        if(path.empty())
-            return; //no path
-
-        VectorC<CurvePrimitiveConstPtr> outV;
+        _curveOffsets.push_back(0);
+        _varOffsets.push_back(0);
+        for(int i = 0; i < (int)fitters.size(); ++i)
+        {
+            _problems.push_back(new MulticurveProblem(*fitters[i]));
+            _scratch.push_back(MulticurveProblem::createEvalData(_problems[i]->numCurves()));
+            _curveOffsets.push_back(_curveOffsets[i] + _problems[i]->numCurves());
+            _varOffsets.push_back(_varOffsets[i] + (int)_problems[i]->params().size());
+        }
 
-        //if a single primitive
-        if(graph->edges[path[0]].continuity == -1)
+        //an end can only land along its own stroke on another curve
+        for(int i = 0; i < (int)incidences.size(); ++i)
         {
-            outV = VectorC<CurvePrimitiveConstPtr>(1, NOT_CIRCULAR);
-            outV[0] = primitives[graph->edges[path[0]].startVtx].curve;
+            const StrokeIncidence &incidence = incidences[i];
+            if(incidence.otherPlace == StrokeIncidence::ANYWHERE && incidence.other == incidence.stroke && _problems[incidence.stroke]->numCurves() < 2)
+                continue;
+            _incidences.push_back(incidence);
         }
-        else //solve the nonlinear problem
+    }
+
+    ~JointMulticurveProblem()
+    {
+        for(int i = 0; i < (int)_problems.size(); ++i)
         {
-            MulticurveProblem problem(fitter);
-            vector<LSBoxConstraint> constraints = problem.getConstraints();
-            LSSolver solver(&problem, constraints);
-            solver.setDefaultDamping(fitter.params().get(Parameters::COMBINE_DAMPING));
-            solver.setMaxIter(50);
-            solver.setIncreaseDampingAfter(5);
-            solver.setDampingIncreaseFactor(1.5);
+            LSWorkspace::current().give(_scratch[i]);
+            delete _problems[i];
+        }
+    }
 
-            VectorXd result = solver.solve(problem.params());
-            problem.setParams(result);
-            Debugging::get()->printf("Final objective = %lf", sqrt(problem.objective()));
+    int numStrokes() const { return (int)_problems.size(); }
+    const MulticurveProblem &problem(int stroke) const { return *_problems[stroke]; }
 
-            outV = problem.curves();
+    vector<LSBoxConstraint> getConstraints() const
+    {
+        vector<LSBoxConstraint> out;
+        for(int i = 0; i < numStrokes(); ++i)
+        {
+            vector<LSBoxConstraint> stroke = _problems[i]->getConstraints();
+            for(int j = 0; j < (int)stroke.size(); ++j)
+                out.push_back(LSBoxConstraint(stroke[j].index + _varOffsets[i], stroke[j].value, stroke[j].sign));
         }
+        return out;
+    }
 
-        //==== track what happens to parameters ====
-        out.parameters = fitter.output<RESAMPLING>()->parameters;
-        PolylineConstPtr resampledCurve = fitter.output<RESAMPLING>()->output;
-        const VectorC<Vector2d> &resampled = resampledCurve->pts();
-
-        vector<int> finalPrimitives; //gather the indices of the graph vertices corresponding to the primitives
-        for(int i = 0; i < (int)path.size(); ++i)
-            finalPrimitives.push_back(graph->edges[path[i]].startVtx);
-        if(outV.size() > (int)finalPrimitives.size())
-            finalPrimitives.push_back(graph->edges[path.back()].endVtx);
+    LSEvalData *createEvalData() { return LSWorkspace::current().take<EvalDataType>(); }
+    void releaseEvalData(LSEvalData *data)
+    {
+        static_cast<EvalDataType *>(data)->clearLinks();
+        LSWorkspace::current().give(data);
+    }
 
-        assert(outV.size() == finalPrimitives.size());
+    void eval(const Eigen::VectorXd &x, LSEvalData *data)
+    {
+        EvalDataType *out = static_cast<EvalDataType *>(data);
+        int numCon = 0, numLinkRows = 2 * (int)_incidences.size();
+        for(int i = 0; i < numStrokes(); ++i)
+        {
+            _problems[i]->eval(x.segment(_varOffsets[i], _varOffsets[i + 1] - _varOffsets[i]), _scratch[i]);
+            int wrapRows = _problems[i]->closed() ? (int)_scratch[i]->conDerBlocksRef().back().rows() : 0;
+            numCon += (int)_scratch[i]->conVectorRef().size() - wrapRows;
+            numLinkRows += wrapRows;
+        }
+        for(int i = 0; i < (int)_incidences.size(); ++i)
+            if(_incidences[i].otherPlace == StrokeIncidence::ANYWHERE)
+                --numLinkRows;
+
+        VectorXd &err = out->errVectorRef();
+        VectorXd &con = out->conVectorRef();
+        EvalDataType::BlockVectorType &errDer = out->errDerBlocksRef();
+        EvalDataType::ConBlockVectorType &conDer = out->conDerBlocksRef();
+        EvalDataType::ConBlockVectorType &conDerNext = out->conDerNextBlocksRef();
+        err.resize(_varOffsets.back());
+        con.resize(numCon);
+        errDer.clear();
+        conDer.clear();
+        conDerNext.clear();
+
+        VectorXd &linkCon = out->linkVectorRef();
+        vector<pair<int, int> > &linkCurves = out->linkCurvesRef();
+        EvalDataType::ConBlockVectorType &linkDer = out->linkDerBlocksRef();
+        EvalDataType::ConBlockVectorType &linkDerOther = out->linkDerOtherBlocksRef();
+        linkCon.resize(numLinkRows);
+        linkCurves.clear();
+        linkDer.clear();
+        linkDerOther.clear();
+
+        int curCon = 0, curLinkRow = 0;
+        for(int i = 0; i < numStrokes(); ++i)
+        {
+            MulticurveEvalData &stroke = *_scratch[i];
+            int numCurves = _problems[i]->numCurves();
+            err.segment(_varOffsets[i], _varOffsets[i + 1] - _varOffsets[i]) = stroke.errVectorRef();
+            errDer.insert(errDer.end(), stroke.errDerBlocksRef().begin(), stroke.errDerBlocksRef().end());
 
-        vector<double> idxToParam(resampled.size()); //idx is the index into the resampled array
-        vector<double> idxToDistSq(resampled.size(), 1e10);
+            int strokeCon = 0;
+            for(int j = 0; j + 1 < numCurves; ++j)
+            {
+                int rows = (int)stroke.conDerBlocksRef()[j].rows();
+                conDer.push_back(stroke.conDerBlocksRef()[j]);
+                conDerNext.push_back(stroke.conDerNextBlocksRef()[j]);
+                con.segment(curCon, rows) = stroke.conVectorRef().segment(strokeCon, rows);
+                curCon += rows;
+                strokeCon += rows;
+            }
+            if(_problems[i]->closed())
+            {
+                int rows = (int)stroke.conDerBlocksRef().back().rows();
+                linkCurves.push_back(make_pair(_curveOffsets[i + 1] - 1, _curveOffsets[i]));
+                linkDer.push_back(stroke.conDerBlocksRef().back());
+                linkDerOther.push_back(stroke.conDerNextBlocksRef().back());
+                linkCon.segment(curLinkRow, rows) = stroke.conVectorRef().segment(strokeCon, rows);
+                curLinkRow += rows;
+            }
+            if(i + 1 < numStrokes()) //no joint to the next stroke
+            {
+                conDer.push_back(EvalDataType::ConBlockType::Zero(0, _problems[i]->curve(numCurves - 1)->numParams()));
+                conDerNext.push_back(EvalDataType::ConBlockType::Zero(0, _problems[i + 1]->curve(0)->numParams()));
+            }
+        }
 
-        double lenSoFar = 0;
-        for(int i = 0; i < outV.size(); ++i) //for each primitive see what projects to it
+        for(int i = 0; i < (int)_incidences.size(); ++i)
         {
-            const FitPrimitive &primitive = primitives[graph->vertices[finalPrimitives[i]].primitiveIdx];
-            for(int j = primitive.startIdx; ; ++j) //project each associated resampled point onto this primitive
+            const StrokeIncidence &incidence = _incidences[i];
+            int curve = _endCurve(incidence.stroke, incidence.place);
+            Vector2d pos;
+            CurvePrimitive::EndDer der;
+            _endWithDerivative(curve, incidence.place, pos, der);
+
+            if(incidence.otherPlace != StrokeIncidence::ANYWHERE)
             {
-                if(j == (int)resampled.size()) //be careful with starts and ends of oversketched primitives
-                {
-                    if(closed) j = 0;
-                    else
-                        break;
-                }
+                int other = _endCurve(incidence.other, incidence.otherPlace);
+                Vector2d otherPos;
+                CurvePrimitive::EndDer otherDer;
+                _endWithDerivative(other, incidence.otherPlace, otherPos, otherDer);
+
+                linkCurves.push_back(make_pair(curve, other));
+                linkDer.push_back(der);
+                linkDerOther.push_back(-otherDer);
+                linkCon.segment<2>(curLinkRow) = pos - otherPos;
+                curLinkRow += 2;
+                continue;
+            }
 
-                if(j < 0)
+            //a T-junction: project onto the nearest curve of the other stroke, other than the end's own
+            int other = -1;
+            double s = 0., bestDistSq = Parameters::infinity;
+            for(int j = _curveOffsets[incidence.other]; j < _curveOffsets[incidence.other + 1]; ++j)
+            {
+                if(j == curve)
                     continue;
-
-                double proj = outV[i]->project(resampled[j]);
-                double distSq = (resampled[j] - outV[i]->pos(proj)).squaredNorm();
-                if(distSq < idxToDistSq[j])
+                double js = _curve(j)->project(pos);
+                double distSq = (_curve(j)->pos(js) - pos).squaredNorm();
+                if(distSq < bestDistSq)
                 {
-                    idxToDistSq[j] = distSq;
-                    idxToParam[j] = proj + lenSoFar;
+                    bestDistSq = distSq;
+                    other = j;
+                    s = js;
                 }
-
-                if(j == primitive.endIdx)
-                    break;
             }
-            lenSoFar += outV[i]->length();
+            assert(other >= 0);
+
+            //at a projection inside the curve, the distance to it is along the normal, and moving the projection
+            //doesn't change it to first order.  At an end of the other stroke, the projection stays there, and
+            //the row is the distance to the tangent line, so the end can settle on that line past the stroke.
+            //(The distance to the end point instead has a kink there that stalls the solve, whose steps are only
+            //accepted if the objective, without the constraints, gets no worse.)
+            Vector2d otherPos, tangent;
+            _curve(other)->eval(s, &otherPos, &tangent);
+            Vector2d normal(-tangent[1], tangent[0]);
+            CurvePrimitive::ParamDer posDer, tanDer;
+            _curve(other)->derivativeAt(s, posDer, tanDer);
+            CurvePrimitive::EndDer otherDer = posDer;
+            _curve(other)->toEndCurvatureDerivative(otherDer);
+
+            linkCurves.push_back(make_pair(curve, other));
+            linkDer.push_back(normal.transpose() * der);
+            linkDerOther.push_back(-normal.transpose() * otherDer);
+            linkCon[curLinkRow++] = normal.dot(pos - otherPos);
         }
-        double outputLength = lenSoFar;
+    }
+
+    VectorXd params() const
+    {
+        VectorXd out(_varOffsets.back());
+        for(int i = 0; i < numStrokes(); ++i)
+            out.segment(_varOffsets[i], _varOffsets[i + 1] - _varOffsets[i]) = _problems[i]->params();
+        return out;
+    }
 
-        if(!closed)
+    void setParams(const Eigen::VectorXd &x)
+    {
+        for(int i = 0; i < numStrokes(); ++i)
+            _problems[i]->setParams(x.segment(_varOffsets[i], _varOffsets[i + 1] - _varOffsets[i]));
+    }
+
+private:
+    //the curve (in the joint numbering) with the end of the stroke at place
+    int _endCurve(int stroke, StrokeIncidence::Place place) const
+    {
+        return place == StrokeIncidence::START ? _curveOffsets[stroke] : _curveOffsets[stroke + 1] - 1;
+    }
+
+    CurvePrimitiveConstPtr _curve(int curve) const
+    {
+        int stroke = (int)(upper_bound(_curveOffsets.begin(), _curveOffsets.end(), curve) - _curveOffsets.begin()) - 1;
+        return _problems[stroke]->curve(curve - _curveOffsets[stroke]);
+    }
+
+    //the position of the curve's start or end, with its derivative w.r.t. the problem variables of the curve
+    void _endWithDerivative(int curve, StrokeIncidence::Place place, Vector2d &pos, CurvePrimitive::EndDer &der) const
+    {
+        CurvePrimitiveConstPtr c = _curve(curve);
+        if(place == StrokeIncidence::START)
         {
-            idxToParam[0] = 0;
-            idxToParam.back() = outputLength;
+            pos = c->startPos();
+            der = CurvePrimitive::EndDer::Zero(2, c->numParams());
+            der(0, CurvePrimitive::X) = der(1, CurvePrimitive::Y) = 1.;
+            return;
         }
+        pos = c->endPos();
+        c->derivativeAtEnd(0, der);
+        c->toEndCurvatureDerivative(der);
+    }
 
-        int minParamSample = min_element(idxToParam.begin(), idxToParam.end()) - idxToParam.begin();
+    vector<MulticurveProblem *> _problems;
+    vector<MulticurveEvalData *> _scratch; //for evaluating the strokes' problems
+    vector<int> _curveOffsets, _varOffsets; //of each stroke and the total
+    vector<StrokeIncidence> _incidences;
+};
 
-        PiecewiseLinearMonotone prevToFinal(PiecewiseLinearMonotone::POSITIVE);
-        //populate prevToFinal -- don't forget duplicating first point if closed
-        prevToFinal.add(0, idxToParam[minParamSample]);
-        lenSoFar = 0;
-        for(VectorC<Vector2d>::Circulator ci = resampled.circulator(minParamSample + 1); !ci.done(); ++ci)
-        {            
-            lenSoFar += (*ci - *(ci - 1)).norm();
-            double finalParam = 0;
-            if(ci.index() == minParamSample)
-                finalParam += outputLength;
-            else
-                idxToParam[ci.index()] = max(idxToParam[ci.index()], idxToParam[(ci - 1).index()]); //ensure monotonicity
-            finalParam += idxToParam[ci.index()];
-            prevToFinal.add(lenSoFar, finalParam);
+//What finding the parameters of the sketch points on the output needs: the curves solved for along the path,
+//the samples they were fitted to, and how much oversketching moves the parameters by.  Copies are kept instead
+//of the outputs of the earlier stages, so that the fitter can still reuse those.
+struct AlgorithmOutput<COMBINING>::ParameterTracking : public smart_base
+{
+    VectorC<CurvePrimitiveConstPtr> curves;
+    vector<pair<int, int> > ranges; //the resampled points of each curve's primitive
+    PolylineConstPtr resampled;
+    vector<double> resampledParameters; //of the original points on resampled
+    bool closed;
+    double shift; //added to the parameters on the curves for the parameters on the output
+};
+
+static mutex parameterTrackingMutex; //finding the parameters is rare, so all the outputs share it
+
+const vector<double> &AlgorithmOutput<COMBINING>::parameters() const
+{
+    lock_guard<mutex> lock(parameterTrackingMutex);
+    if(!parameterTracking)
+        return _parameters;
+
+    const ParameterTracking &tracking = *parameterTracking;
+    const VectorC<CurvePrimitiveConstPtr> &outV = tracking.curves;
+    const VectorC<Vector2d> &resampled = tracking.resampled->pts();
+
+    vector<double> idxToParam(resampled.size()); //idx is the index into the resampled array
+    vector<double> idxToDistSq(resampled.size(), 1e10);
+
+    double lenSoFar = 0;
+    for(int i = 0; i < outV.size(); ++i) //for each primitive see what projects to it
+    {
+        vector<int> idcs; //the resampled points associated with this primitive
+        for(int j = tracking.ranges[i].first; ; ++j)
+        {
+            if(j == (int)resampled.size()) //be careful with starts and ends of oversketched primitives
+            {
+                if(tracking.closed) j = 0;
+                else
+                    break;
+            }
+
+            if(j < 0)
+                continue;
+
+            idcs.push_back(j);
+
+            if(j == tracking.ranges[i].second)
+                break;
         }
-        //adjust parameters into range
-        for(int i = 0; i < (int)out.parameters.size(); ++i)
+
+        if(!idcs.empty()) //project them onto this primitive
         {
-            out.parameters[i] -= resampledCurve->idxToParam(minParamSample);
-            if(out.parameters[i] < 0)
-                out.parameters[i] += resampledCurve->length();
+            Curve::PointVector pts(idcs.size()), projPts(idcs.size());
+            vector<double> proj(idcs.size());
+            for(int k = 0; k < (int)idcs.size(); ++k)
+                pts[k] = resampled[idcs[k]];
+            outV[i]->projectMany(&(pts[0]), (int)pts.size(), &(proj[0]));
+            outV[i]->evalMany(&(proj[0]), (int)proj.size(), &(projPts[0]));
+
+            for(int k = 0; k < (int)idcs.size(); ++k)
+            {
+                int j = idcs[k];
+                double distSq = (pts[k] - projPts[k]).squaredNorm();
+                if(distSq < idxToDistSq[j])
+                {
+                    idxToDistSq[j] = distSq;
+                    idxToParam[j] = proj[k] + lenSoFar;
+                }
+            }
         }
-        prevToFinal.batchEval(out.parameters);
+        lenSoFar += outV[i]->length();
+    }
+    double outputLength = lenSoFar;
 
-        //==== combine with what needs to be done w.r.t. oversketching ====
-        smart_ptr<const AlgorithmOutput<OVERSKETCHING> > osOutput = fitter.output<OVERSKETCHING>();
-        VectorC<CurvePrimitiveConstPtr> outFinal(0, osOutput->finallyClose ? CIRCULAR : NOT_CIRCULAR);
+    if(!tracking.closed)
+    {
+        idxToParam[0] = 0;
+        idxToParam.back() = outputLength;
+    }
 
-        if(osOutput->toPrepend)
+    int minParamSample = min_element(idxToParam.begin(), idxToParam.end()) - idxToParam.begin();
+
+    PiecewiseLinearMonotone prevToFinal(PiecewiseLinearMonotone::POSITIVE);
+    //populate prevToFinal -- don't forget duplicating first point if closed
+    prevToFinal.add(0, idxToParam[minParamSample]);
+    lenSoFar = 0;
+    for(VectorC<Vector2d>::Circulator ci = resampled.circulator(minParamSample + 1); !ci.done(); ++ci)
+    {            
+        lenSoFar += (*ci - *(ci - 1)).norm();
+        double finalParam = 0;
+        if(ci.index() == minParamSample)
+            finalParam += outputLength;
+        else
+            idxToParam[ci.index()] = max(idxToParam[ci.index()], idxToParam[(ci - 1).index()]); //ensure monotonicity
+        finalParam += idxToParam[ci.index()];
+        prevToFinal.add(lenSoFar, finalParam);
+    }
+    //adjust parameters into range
+    _parameters = tracking.resampledParameters;
+    for(int i = 0; i < (int)_parameters.size(); ++i)
+    {
+        _parameters[i] -= tracking.resampled->idxToParam(minParamSample);
+        if(_parameters[i] < 0)
+            _parameters[i] += tracking.resampled->length();
+    }
+    prevToFinal.batchEval(_parameters);
+
+    //what oversketching did
+    for(int i = 0; i < (int)_parameters.size(); ++i)
+        _parameters[i] += tracking.shift;
+
+    parameterTracking = NULL;
+    return _parameters;
+}
+
+void AlgorithmOutput<COMBINING>::setParameters(const vector<double> &parameters)
+{
+    lock_guard<mutex> lock(parameterTrackingMutex);
+    _parameters = parameters;
+    parameterTracking = NULL;
+}
+
+//Makes the combiner's output from the curves solved for along the fitter's path: adds what oversketching keeps
+//of the base, and keeps what's needed to find the parameters of the sketch points on it
+static void _finishOutput(const Fitter &fitter, const VectorC<CurvePrimitiveConstPtr> &outV, AlgorithmOutput<COMBINING> &out)
+{
+    smart_ptr<const AlgorithmOutput<GRAPH_CONSTRUCTION> > graph = fitter.output<GRAPH_CONSTRUCTION>();
+    const vector<FitPrimitive> &primitives = fitter.output<PRIMITIVE_FITTING>()->primitives;
+    const vector<int> &path = fitter.output<PATH_FINDING>()->path;
+
+    //==== keep what's needed to track what happens to parameters ====
+    smart_ptr<AlgorithmOutput<COMBINING>::ParameterTracking> tracking = new AlgorithmOutput<COMBINING>::ParameterTracking();
+    tracking->curves = outV;
+    tracking->resampled = fitter.output<RESAMPLING>()->output;
+    tracking->resampledParameters = fitter.output<RESAMPLING>()->parameters;
+    tracking->closed = fitter.output<CURVE_CLOSING>()->closed;
+    tracking->shift = 0.;
+
+    vector<int> finalPrimitives; //gather the indices of the graph vertices corresponding to the primitives
+    for(int i = 0; i < (int)path.size(); ++i)
+        finalPrimitives.push_back(graph->edges[path[i]].startVtx);
+    if(outV.size() > (int)finalPrimitives.size())
+        finalPrimitives.push_back(graph->edges[path.back()].endVtx);
+
+    assert(outV.size() == finalPrimitives.size());
+
+    for(int i = 0; i < outV.size(); ++i)
+    {
+        const FitPrimitive &primitive = primitives[graph->vertices[finalPrimitives[i]].primitiveIdx];
+        tracking->ranges.push_back(make_pair(primitive.startIdx, primitive.endIdx));
+    }
+
+    //==== combine with what needs to be done w.r.t. oversketching ====
+    smart_ptr<const AlgorithmOutput<OVERSKETCHING> > osOutput = fitter.output<OVERSKETCHING>();
+    VectorC<CurvePrimitiveConstPtr> outFinal(0, osOutput->finallyClose ? CIRCULAR : NOT_CIRCULAR);
+
+    if(osOutput->toPrepend)
+    {
+        outFinal.insert(outFinal.end(), osOutput->toPrepend->primitives().begin(), osOutput->toPrepend->primitives().end() - 1);
+        tracking->shift += (osOutput->toPrepend->length() - osOutput->toPrepend->primitives().back()->length());
+    }
+    outFinal.insert(outFinal.end(), outV.begin(), outV.end());
+
+    if(osOutput->toAppend)
+    {
+        if(!osOutput->finallyClose)
         {
-            outFinal.insert(outFinal.end(), osOutput->toPrepend->primitives().begin(), osOutput->toPrepend->primitives().end() - 1);
-            for(int i = 0; i < (int)out.parameters.size(); ++i)
-                out.parameters[i] += (osOutput->toPrepend->length() - osOutput->toPrepend->primitives().back()->length());
+            outFinal.insert(outFinal.end(), osOutput->toAppend->primitives().begin() + 1, osOutput->toAppend->primitives().end());
         }
-        outFinal.insert(outFinal.end(), outV.begin(), outV.end());
-
-        if(osOutput->toAppend)
+        else
         {
-            if(!osOutput->finallyClose)
+            if(osOutput->toAppend->primitives().size() >= 2)
             {
-                outFinal.insert(outFinal.end(), osOutput->toAppend->primitives().begin() + 1, osOutput->toAppend->primitives().end());
+                outFinal.insert(outFinal.end(), osOutput->toAppend->primitives().begin() + 1, osOutput->toAppend->primitives().end() - 1);
             }
-            else
+            else //start and end curve is the same curve -- its original length is the one toAppend curve
             {
-                if(osOutput->toAppend->primitives().size() >= 2)
-                {
-                    outFinal.insert(outFinal.end(), osOutput->toAppend->primitives().begin() + 1, osOutput->toAppend->primitives().end() - 1);
-                }
-                else //start and end curve is the same curve -- its original length is the one toAppend curve
-                {
-                    //get rid of last curve and possibly extend the first one
-                    double lastCurveLen = outFinal.back()->length();
-                    double firstCurveLen = outFinal[0]->length();
-                    double origLen = osOutput->toAppend->primitives()[0]->length();
-                    outFinal.pop_back();
-                    //now extend the first curve to the combined length
-                    outFinal[0] = outFinal[0]->trimmed(origLen - lastCurveLen, firstCurveLen);
-                    for(int i = 0; i < (int)out.parameters.size(); ++i)
-                        out.parameters[i] -= (origLen - lastCurveLen);
-                }
+                //get rid of last curve and possibly extend the first one
+                double lastCurveLen = outFinal.back()->length();
+                double firstCurveLen = outFinal[0]->length();
+                double origLen = osOutput->toAppend->primitives()[0]->length();
+                outFinal.pop_back();
+                //now extend the first curve to the combined length
+                outFinal[0] = outFinal[0]->trimmed(origLen - lastCurveLen, firstCurveLen);
+                tracking->shift -= (origLen - lastCurveLen);
             }
         }
+    }
 
-        out.output = new PrimitiveSequence(outFinal);
+    out.output = new PrimitiveSequence(outFinal);
+    out.parameterTracking = tracking;
 
 #if 1
-        for(int i = 0; i < (int)out.parameters.size(); ++i)
+    if(Debugging::on()) //drawing the correspondence needs the parameters
+    {
+        const vector<double> &parameters = out.parameters();
+        for(int i = 0; i < (int)parameters.size(); ++i)
+            CORNU_DEBUG(drawLine(fitter.originalSketch()->pts()[i], out.output->pos(parameters[i]), Vector3d(1, 0, 1), "Correspondence"));
+    }
+#endif
+}
+
+class DefaultCombiner : public Algorithm<COMBINING>
+{
+public:
+    string name() const { return "Default"; }
+
+protected:
+    void _run(const Fitter &fitter, AlgorithmOutput<COMBINING> &out)
+    {
+        smart_ptr<const AlgorithmOutput<GRAPH_CONSTRUCTION> > graph = fitter.output<GRAPH_CONSTRUCTION>();
+        const vector<FitPrimitive> &primitives = fitter.output<PRIMITIVE_FITTING>()->primitives;
+        const vector<int> &path = fitter.output<PATH_FINDING>()->path;
+
+        if(path.empty())
+            return; //no path
+
+        VectorC<CurvePrimitiveConstPtr> outV;
+
+        //if a single primitive
+        if(graph->edges[path[0]].continuity == -1)
         {
-            double paramOrig = fitter.originalSketch()->idxToParam(i);
-            Debugging::get()->drawLine(fitter.originalSketch()->pts()[i], out.output->pos(out.parameters[i]), Vector3d(1, 0, 1), "Correspondence");
+            outV = VectorC<CurvePrimitiveConstPtr>(1, NOT_CIRCULAR);
+            outV[0] = primitives[graph->edges[path[0]].startVtx].curve;
+        }
+        else //solve the nonlinear problem
+        {
+            MulticurveProblem problem(fitter);
+            vector<LSBoxConstraint> constraints = problem.getConstraints();
+            LSSolver solver(&problem, constraints);
+            solver.setDefaultDamping(fitter.config().get(Parameters::COMBINE_DAMPING));
+            out.degraded = fitter.pastDeadline();
+            solver.setMaxIter(out.degraded ? 5 : 50); //past the time budget, the first iterations do most of the work
+            solver.setIncreaseDampingAfter(5);
+            solver.setDampingIncreaseFactor(1.5);
+            solver.setStepControl(LSSolver::TRUST_REGION); //an evaluation is the whole path's normal equations, so reuse it
+            solver.setCancellationToken(fitter.cancellationToken());
+
+            VectorXd result = solver.solve(problem.params());
+            problem.setParams(result);
+            out.lsIterations = solver.iterations();
+            out.objective = sqrt(problem.objective());
+            CORNU_DEBUG(printf("Final objective = %lf", out.objective));
+
+            outV = problem.curves();
         }
-#endif
 
+        _finishOutput(fitter, outV, out);
     }
 };
 
@@ -753,6 +1420,42 @@ void Algorithm<COMBINING>::_initialize()
     new DefaultCombiner();
 }
 
+vector<AlgorithmOutputBasePtr> combineJointly(const vector<const Fitter *> &fitters, const vector<StrokeIncidence> &incidences)
+{
+    CORNU_TRACE_SCOPE("combineJointly");
+    const Fitter &first = *fitters[0];
+    FresnelTier::Scope fresnelScope(first.fresnelTier(COMBINING));
+
+    JointMulticurveProblem problem(fitters, incidences);
+    vector<LSBoxConstraint> constraints = problem.getConstraints();
+    LSSolver solver(&problem, constraints);
+    solver.setDefaultDamping(first.config().get(Parameters::COMBINE_DAMPING));
+    solver.setIncreaseDampingAfter(5);
+    solver.setDampingIncreaseFactor(1.5);
+    solver.setStepControl(LSSolver::TRUST_REGION);
+    solver.setCancellationToken(first.cancellationToken());
+    bool degraded = false;
+    for(int i = 0; i < (int)fitters.size(); ++i)
+        degraded = degraded || fitters[i]->pastDeadline();
+    solver.setMaxIter(degraded ? 5 : 50); //like the combiner's solve past the time budget
+
+    VectorXd result = solver.solve(problem.params());
+    problem.setParams(result);
+
+    vector<AlgorithmOutputBasePtr> out;
+    for(int i = 0; i < problem.numStrokes(); ++i)
+    {
+        smart_ptr<AlgorithmOutput<COMBINING> > stroke = new AlgorithmOutput<COMBINING>();
+        stroke->degraded = degraded;
+        stroke->lsIterations = solver.iterations();
+        stroke->objective = sqrt(problem.problem(i).objective());
+        _finishOutput(*fitters[i], problem.problem(i).curves(), *stroke);
+        out.push_back(stroke);
+    }
+    CORNU_DEBUG(printf("Joint solve of %d strokes: %d iterations", problem.numStrokes(), solver.iterations()));
+    return out;
+}
+
 END_NAMESPACE_Cornu
 
 
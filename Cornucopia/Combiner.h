@@ -29,12 +29,28 @@
 NAMESPACE_Cornu
 
 CORNU_SMART_FORW_DECL(PrimitiveSequence);
+class Fitter;
 
 template<>
 struct AlgorithmOutput<COMBINING> : public AlgorithmOutputBase
 {
+    AlgorithmOutput() : lsIterations(0), objective(0.) {}
+
+    //parameters()[i] is the parameter in output of the original point with index i.  Finding them projects all
+    //the samples onto the output, and most callers only want the curve, so it's done on the first call (which
+    //may come from any thread).  setParameters gives them outright.
+    const std::vector<double> &parameters() const;
+    void setParameters(const std::vector<double> &parameters);
+
     PrimitiveSequenceConstPtr output;
-    std::vector<double> parameters; //parameters[i] is the parameter in output of the original point with index i
+    int lsIterations; //of the multicurve solve, zero if there was a single primitive
+    double objective; //square root of the multicurve problem's objective at the solution, zero if there was a single primitive
+
+    struct ParameterTracking; //what the combiner keeps for finding the parameters
+    mutable smart_ptr<ParameterTracking> parameterTracking; //NULL once the parameters are found
+
+private:
+    mutable std::vector<double> _parameters;
 };
 
 template<>
@@ -49,6 +65,31 @@ private:
     static void _initialize();
 };
 
+//Says that an end of a stroke should touch another stroke (or another place on the same stroke), for fitting
+//strokes jointly (see JointFitter.h).  With otherPlace ANYWHERE, the end lands somewhere along the other
+//stroke, like at a T-junction; otherwise it meets the other stroke's start or end.  An ANYWHERE end should land
+//between the other stroke's ends: past one, it only lands on the tangent line there, not on the stroke.
+struct StrokeIncidence
+{
+    enum Place { START, END, ANYWHERE };
+
+    StrokeIncidence(int inStroke = 0, Place inPlace = END, int inOther = 0, Place inOtherPlace = ANYWHERE)
+        : stroke(inStroke), place(inPlace), other(inOther), otherPlace(inOtherPlace) {}
+
+    int stroke;
+    Place place; //START or END
+    int other;
+    Place otherPlace;
+};
+
+//Solves for the curves along the paths of several fitters (which must have run through path finding, and have
+//paths) at once, with the incidences as constraints besides the joints, and returns the output of the combining
+//stage for each.  The strokes of the incidences index fitters, and their ends must be on open strokes.  The
+//solve is done like the combiner's, with the parameters and the cancellation token of the first fitter: once any
+//of the fitters is past its deadline, it takes few iterations and the outputs are degraded, and once the token
+//is cancelled, it stops and the outputs should be dropped.
+std::vector<AlgorithmOutputBasePtr> combineJointly(const std::vector<const Fitter *> &fitters, const std::vector<StrokeIncidence> &incidences);
+
 END_NAMESPACE_Cornu
 
 #endif //CORNUCOPIA_COMBINER_H_INCLUDED
@@ -44,7 +44,7 @@ protected:
         VectorC<double> scores = cornerScores(fitter);
 
         const double spacing = fitter.scaledParameter(Parameters::MINIMUM_CORNER_SPACING);
-        const double threshold = fitter.params().get(Parameters::CORNER_THRESHOLD);
+        const double threshold = fitter.config().get(Parameters::CORNER_THRESHOLD);
 
         for(int i = 0; i < pts.size(); ++i)
         {
@@ -77,13 +77,16 @@ protected:
             out.corners[i] = valid && scores[i] > threshold;
 
             if(out.corners[i])
-                Debugging::get()->drawPoint(pts[i], Vector3d(1, 0, 0), "Corners");
+                CORNU_DEBUG(drawPoint(pts[i], Vector3d(1, 0, 0), "Corners"));
         }
     }
 
     virtual VectorC<double> cornerScores(const Fitter &fitter) = 0;
 };
 
+//The corner score of a point is the smallest turning angle, over several smoothing scales, of a curve
+//resampled every DENSE_SAMPLING_STEP, measured at the sample nearest the point.  The whole curve is
+//resampled and smoothed once, so this is linear in the number of samples times the number of scales.
 class DefaultCornerDetector : public BaseCornerDetector
 {
 protected:
@@ -93,48 +96,53 @@ protected:
         const VectorC<Vector2d> &pts = input->pts();
         VectorC<double> out(pts.size(), pts.circular());
 
-        double offset = fitter.scaledParameter(Parameters::CORNER_NEIGHBORHOOD);
+        double neighborhood = fitter.scaledParameter(Parameters::CORNER_NEIGHBORHOOD);
+        double step = fitter.scaledParameter(Parameters::DENSE_SAMPLING_STEP);
+        int smoothingSteps = (int)fitter.config().get(Parameters::CORNER_SCALES);
 
-        for(int i = 0; i < pts.size(); ++i)
+        //resample--a closed curve gets a whole number of samples, so the sample spacing is a bit different
+        int numSamples = 1 + (int)(input->length() / step);
+        if(input->isClosed())
         {
-            double param = input->idxToParam(i);
-            double cornerParam = offset; //corner parameter on the trimmed curve
-            if(!input->isClosed())
-                cornerParam = min(param, offset);
-            out[i] = cornerScore(fitter, input->trimmed(param - offset, param + offset), cornerParam);
+            numSamples = max(3, (int)floor(input->length() / step + 0.5));
+            step = input->length() / numSamples;
         }
 
-        return out;
-    }
-
-    double cornerScore(const Fitter &fitter, PolylineConstPtr cornerPoly, double cornerParam)
-    {
-        double step = fitter.scaledParameter(Parameters::DENSE_SAMPLING_STEP);
-
-        VectorC<Vector2d> resampled(0, NOT_CIRCULAR);
-
-        for(double param = cornerParam; param >= 0.; param -= step)
-            resampled.insert(resampled.begin(), cornerPoly->pos(param));
-        int cornerIdx = resampled.size() - 1;
-        for(double param = cornerParam + step; param <= cornerPoly->length(); param += step)
-            resampled.push_back(cornerPoly->pos(param));
+        vector<VectorC<Vector2d> > smoothed(max(1, smoothingSteps), VectorC<Vector2d>(numSamples, pts.circular()));
+        Polyline::Cursor cursor(*input);
+        for(int j = 0; j < numSamples; ++j)
+            smoothed[0][j] = cursor.pos(j * step);
 
-        int smoothingSteps = (int)fitter.params().get(Parameters::CORNER_SCALES);
-        vector<VectorC<Vector2d> > smoothed(smoothingSteps, resampled);
-
-        //laplacian smooth
+        //laplacian smooth--the ends of an open curve stay put
+        int first = input->isClosed() ? 0 : 1;
+        int end = input->isClosed() ? numSamples : numSamples - 1;
         for(int i = 1; i < (int)smoothed.size(); ++i)
-            for(int j = 1; j + 1 < (int)resampled.size(); ++j)
+        {
+            smoothed[i][0] = smoothed[i - 1][0];
+            smoothed[i][numSamples - 1] = smoothed[i - 1][numSamples - 1];
+            for(int j = first; j < end; ++j)
                 smoothed[i][j] = 0.25 * (smoothed[i - 1][j - 1] + smoothed[i - 1][j + 1] + 2. * smoothed[i - 1][j]);
+        }
+
+        for(int i = 0; i < pts.size(); ++i)
+            out[i] = cornerScore(smoothed, (int)floor(input->idxToParam(i) / step + 0.5), min(neighborhood / step, numSamples * 0.5), input->isClosed());
 
+        return out;
+    }
+
+    //cornerIdx is the sample nearest the point, and the angles are measured across at most
+    //maxOffset samples on either side
+    double cornerScore(const vector<VectorC<Vector2d> > &smoothed, int cornerIdx, double maxOffset, bool closed)
+    {
+        int numSamples = smoothed[0].size();
         double maxAngle = -1e10, minAngle = 1e10;
 
         for(int i = 1; i < (int)smoothed.size(); ++i)
         {
             int offs = i + 1;
-            if(cornerIdx - offs < 0)
+            if(offs > maxOffset)
                 return 0.;
-            if(cornerIdx + offs >= resampled.size())
+            if(!closed && (cornerIdx - offs < 0 || cornerIdx + offs >= numSamples))
                 return 0.;
 
             Vector2d v1 = smoothed[i][cornerIdx] - smoothed[i][cornerIdx - offs];
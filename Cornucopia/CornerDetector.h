@@ -30,6 +30,9 @@ NAMESPACE_Cornu
 template<>
 struct AlgorithmOutput<CORNER_DETECTION> : public AlgorithmOutputBase
 {
+    //override
+    size_t memoryBytes() const { return vectorBytes(corners); }
+
     VectorC<bool> corners;
 };
 
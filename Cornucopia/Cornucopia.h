@@ -24,11 +24,14 @@
 //This file just collects the includes necessary to use Cornucopia fully
 //For a minimalistic API, see SimpleAPI.h
 #include "Fitter.h"
+#include "FitPipeline.h"
+#include "JointFitter.h"
 #include "Polyline.h"
 #include "PrimitiveSequence.h"
 #include "Line.h"
 #include "Arc.h"
 #include "Clothoid.h"
 #include "Bezier.h"
+#include "Tracing.h"
 
 #endif //CORNUCOPIA_CORNUCOPIA_H_INCLUDED
@@ -25,6 +25,9 @@
 #include "smart_ptr.h"
 #include "AngleUtils.h"
 
+#include <limits>
+#include <vector>
+
 NAMESPACE_Cornu
 
 /*
@@ -36,6 +39,8 @@ protected:
     typedef Eigen::Vector2d Vec;
 
 public:
+    typedef std::vector<Eigen::Vector2d, Eigen::aligned_allocator<Eigen::Vector2d> > PointVector;
+
     virtual double length() const = 0;
 
     virtual bool isClosed() const { return false; }
@@ -44,9 +49,42 @@ public:
     virtual void eval(double s, Vec *pos, Vec *der = NULL, Vec *der2 = NULL) const = 0;
 
     virtual double project(const Vec &point) const = 0;
+
+    //Like project, but sHint is a guess at the answer, such as the projection of a nearby point, that subclasses
+    //use to get there faster.  The result is the same closest point, possibly computed more accurately.
+    virtual double projectNear(const Vec &point, double /*sHint*/) const { return project(point); }
+
+    //batched versions of eval and project for n arguments at once, so the virtual call is made once per batch
+    //(outputs may be NULL as in eval).  Subclasses override them with implementations that give the same results.
+    virtual void evalMany(const double *s, int n, Vec *pos, Vec *der = NULL, Vec *der2 = NULL) const
+    {
+        for(int i = 0; i < n; ++i)
+            eval(s[i], pos ? pos + i : NULL, der ? der + i : NULL, der2 ? der2 + i : NULL);
+    }
+    virtual void projectMany(const Vec *points, int n, double *out) const
+    {
+        for(int i = 0; i < n; ++i)
+            out[i] = project(points[i]);
+    }
     virtual double distanceSqTo(const Vec &point) const { return (point - pos(project(point))).squaredNorm(); }
+    //squared distances for n points, which are usually consecutive samples near each other, so by default each
+    //projection is a hint for the next.  Subclasses override it with kernels that skip the projection.
+    virtual void distanceSqMany(const Vec *points, int n, double *out) const
+    {
+        double s = -1.;
+        for(int i = 0; i < n; ++i)
+        {
+            s = (i == 0) ? project(points[i]) : projectNear(points[i], s);
+            out[i] = (points[i] - pos(s)).squaredNorm();
+        }
+    }
     virtual double distanceTo(const Vec &point) const { return sqrt(distanceSqTo(point)); }
 
+    //Appends to out a polyline from startPos() to endPos() that is within tolerance of the curve, for drawing
+    //it.  By default, each step is as long as the curvature at its ends allows; subclasses that know how their
+    //curvature varies take fewer steps.
+    virtual void tessellate(double tolerance, PointVector &out) const;
+
     //derived evaluation functions--subclasses can implement them more efficiently
     virtual Vec pos(double s) const { Vec out; eval(s, &out); return out; }
     virtual Vec der(double s) const { Vec out; eval(s, NULL, &out); return out; }
@@ -64,8 +102,35 @@ public:
 
     //self-test
     virtual bool isValid() const { return true; }
+
+protected:
+    //The longest step whose chord is within tolerance of a curve whose curvature is at most curvature in absolute
+    //value--for a circle, the chord of angle theta is r (1 - cos(theta / 2)) = 2 r sin^2(theta / 4) away from it
+    //at the middle (the sine is accurate for small angles, where the cosine isn't)
+    static double _tessellationStep(double tolerance, double curvature)
+    {
+        curvature = fabs(curvature);
+        if(curvature == 0.)
+            return std::numeric_limits<double>::infinity();
+        if(tolerance * curvature >= 1.)
+            return PI / curvature; //a half circle at most, so it's tessellated by more than one chord
+        return 4. * asin(sqrt(0.5 * tolerance * curvature)) / curvature;
+    }
 };
 
+inline void Curve::tessellate(double tolerance, PointVector &out) const
+{
+    double len = length();
+    out.push_back(startPos());
+    for(double s = 0.; s < len; )
+    {
+        double step = _tessellationStep(tolerance, curvature(s));
+        step = std::min(step, _tessellationStep(tolerance, curvature(std::min(len, s + step))));
+        s = std::min(len, s + step);
+        out.push_back(pos(s));
+    }
+}
+
 END_NAMESPACE_Cornu
 
 #endif //CORNUCOPIA_CURVE_H_INCLUDED
@@ -36,6 +36,24 @@ bool CurvePrimitive::isValid() const
     return isValidImpl();
 }
 
+void CurvePrimitive::transform(const Similarity &similarity)
+{
+    _transformParams(similarity);
+    _paramsChanged();
+}
+
+void CurvePrimitive::_transformParams(const Similarity &similarity)
+{
+    double scale = similarity.scale();
+    _params.head<2>() = similarity * _startPos();
+    _params[ANGLE] += similarity.angle();
+    _params[LENGTH] *= scale;
+    if(_params.size() > CURVATURE)
+        _params[CURVATURE] /= scale;
+    if(_params.size() > DCURVATURE)
+        _params[DCURVATURE] /= scale * scale;
+}
+
 END_NAMESPACE_Cornu
 
 
@@ -23,6 +23,7 @@
 
 #include "defs.h"
 #include "Curve.h"
+#include "Similarity.h"
 
 NAMESPACE_Cornu
 
@@ -63,13 +64,23 @@ public:
     virtual void trim(double sFrom, double sTo) = 0; //this should work even for sFrom < 0 and sTo > length()
     virtual void flip() = 0;
     virtual CurvePrimitivePtr clone() const = 0;
+    //Moves the primitive without refitting it: the parameters are updated like the points (the curvatures are
+    //divided by the scale, etc.).  Subclasses override it if they can update what _paramsChanged computes for less
+    virtual void transform(const Similarity &similarity);
 
     //derivative (of curve and its tangent vector) with respect to paramters
     virtual void derivativeAt(double s, ParamDer &out, ParamDer &outTan) const = 0;
     virtual void derivativeAtEnd(int continuity, EndDer &out) const = 0; //continuity: 0 = position, 1 = +angle, 2 = +curvature
+    //evaluates the position and tangent together with derivativeAt, for subclasses that can share the work
+    virtual void evalWithDerivatives(double s, Vec *pos, Vec *tangent, ParamDer &out, ParamDer &outTan) const
+    {
+        eval(s, pos, tangent);
+        derivativeAt(s, out, outTan);
+    }
 
-    //for clothoids, converts derivative w.r.t. dcurvature into der w.r.t. end curvature
-    virtual void toEndCurvatureDerivative(Eigen::MatrixXd &) const {} 
+    //for clothoids, converts derivative w.r.t. dcurvature into der w.r.t. end curvature (in place, so it
+    //takes any matrix with a column per parameter, such as an EndDer)
+    virtual void toEndCurvatureDerivative(Eigen::Ref<Eigen::MatrixXd>) const {}
 
     void setParams(const ParamVec &params) { _params = params; _paramsChanged(); }
     const ParamVec &params() const { return _params; }
@@ -83,6 +94,8 @@ public:
     //utility functions
     CurvePrimitivePtr flipped() const { CurvePrimitivePtr out = clone(); out->flip(); return out; }
     CurvePrimitivePtr trimmed(double sFrom, double sTo) const { CurvePrimitivePtr out = clone(); out->trim(sFrom, sTo); return out; }
+    CurvePrimitivePtr transformed(const Similarity &similarity) const
+    { CurvePrimitivePtr out = clone(); out->transform(similarity); return out; }
 
 protected:
     //non-virtual inline functions -- use them in derived classes
@@ -91,6 +104,7 @@ protected:
     double _startAngle() const { return _params[ANGLE]; }
 
     virtual void _paramsChanged() = 0;
+    void _transformParams(const Similarity &similarity); //just updates _params
     virtual bool isValidImpl() const = 0;
 
     ParamVec _params;
@@ -0,0 +1,327 @@
+/*--
+    Dataset.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Dataset.h"
+#include "Fitter.h"
+#include "GraphConstructor.h"
+#include "Polyline.h"
+#include "SketchFile.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <ostream>
+
+using namespace std;
+NAMESPACE_Cornu
+
+const char *Dataset::columnName(int column)
+{
+    static const char *names[NUM_COLUMNS] = {
+        "startType", "endType", "continuity", "atCorner", "inflection", "startLength", "endLength", "startError", "endError",
+        "positionDiff", "angleDiff", "curvatureDiff", "startVertexCost", "endVertexCost", "predictedCost", "validatedCost"
+    };
+    return names[column];
+}
+
+void Dataset::addRow(const float *values)
+{
+    for(int c = 0; c < NUM_COLUMNS; ++c)
+        _columns[c].push_back(values[c]);
+}
+
+void Dataset::append(const Dataset &other)
+{
+    for(int c = 0; c < NUM_COLUMNS; ++c)
+        _columns[c].insert(_columns[c].end(), other._columns[c].begin(), other._columns[c].end());
+}
+
+void Dataset::clear()
+{
+    for(int c = 0; c < NUM_COLUMNS; ++c)
+        _columns[c].clear();
+}
+
+static const char datasetFileMagic[8] = { 'C', 'O', 'R', 'N', 'U', 'D', 'S', 'F' };
+static const uint32_t datasetFileVersion = 1;
+static const uint32_t datasetFileByteOrder = 0x01020304;
+
+static const char zeros[8] = { 0 };
+static size_t padding(uint64_t size) { return (size_t)((8 - size % 8) % 8); }
+
+DatasetFileWriter::DatasetFileWriter(ostream &out) : _out(out), _numRows(0)
+{
+    DatasetFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, datasetFileMagic, sizeof(datasetFileMagic));
+    header.version = datasetFileVersion;
+    header.byteOrder = datasetFileByteOrder;
+    header.numColumns = Dataset::NUM_COLUMNS;
+    _out.write((const char *)&header, sizeof(header));
+
+    uint64_t namesSize = 0;
+    for(int c = 0; c < Dataset::NUM_COLUMNS; ++c)
+    {
+        const char *name = Dataset::columnName(c);
+        _out.write(name, strlen(name) + 1);
+        namesSize += strlen(name) + 1;
+    }
+    _out.write(zeros, padding(namesSize));
+}
+
+void DatasetFileWriter::write(const Dataset &block)
+{
+    uint64_t numRows = block.numRows();
+    if(numRows == 0)
+        return;
+
+    lock_guard<mutex> lock(_mutex);
+    _out.write((const char *)&numRows, sizeof(numRows));
+    for(int c = 0; c < Dataset::NUM_COLUMNS; ++c)
+    {
+        _out.write((const char *)&(block.column(c)[0]), numRows * sizeof(float));
+        _out.write(zeros, padding(numRows * sizeof(float)));
+    }
+    _numRows += numRows;
+}
+
+bool DatasetFileWriter::isValid() const
+{
+    lock_guard<mutex> lock(_mutex);
+    return !_out.fail();
+}
+
+DatasetFileReader::DatasetFileReader(istream &in) : _in(in), _valid(false)
+{
+    DatasetFileHeader header;
+    if(!_in.read((char *)&header, sizeof(header)))
+        return;
+    if(memcmp(header.magic, datasetFileMagic, sizeof(datasetFileMagic)) != 0 || header.version != datasetFileVersion ||
+       header.byteOrder != datasetFileByteOrder)
+        return;
+
+    //the columns are matched by name, so files with other columns can still be read
+    uint64_t namesSize = 0;
+    for(uint32_t i = 0; i < header.numColumns; ++i)
+    {
+        string name;
+        getline(_in, name, '\0');
+        if(!_in)
+            return;
+        namesSize += name.size() + 1;
+
+        int column = -1;
+        for(int c = 0; c < Dataset::NUM_COLUMNS; ++c)
+        {
+            if(name == Dataset::columnName(c))
+                column = c;
+        }
+        _fileColumns.push_back(column);
+    }
+    _in.ignore(padding(namesSize));
+    _valid = (bool)_in;
+}
+
+//the bytes left in the stream, or -1 if it can't tell
+static long long remainingBytes(istream &in)
+{
+    streampos here = in.tellg();
+    if(here == streampos(-1))
+        return -1;
+    in.seekg(0, ios::end);
+    streampos end = in.tellg();
+    in.seekg(here);
+    return end == streampos(-1) ? -1 : (long long)(end - here);
+}
+
+bool DatasetFileReader::next(Dataset &outBlock)
+{
+    outBlock.clear();
+    uint64_t numRows;
+    if(!_valid || !_in.read((char *)&numRows, sizeof(numRows)))
+        return false;
+    if(numRows == 0)
+        return true;
+
+    //a corrupt count shouldn't make it allocate more rows than the file (or a Dataset) can hold
+    long long remaining = remainingBytes(_in);
+    uint64_t rowBytes = sizeof(float) * max((size_t)1, _fileColumns.size());
+    if(numRows > (uint64_t)numeric_limits<int>::max() || (remaining >= 0 && numRows > (uint64_t)remaining / rowBytes))
+    {
+        _valid = false;
+        return false;
+    }
+
+    //columns the file doesn't have are NaN
+    vector<float> row(Dataset::NUM_COLUMNS, numeric_limits<float>::quiet_NaN());
+    for(uint64_t r = 0; r < numRows; ++r)
+        outBlock.addRow(&(row[0]));
+
+    vector<float> values((size_t)numRows);
+    for(int i = 0; i < (int)_fileColumns.size(); ++i)
+    {
+        if(!_in.read((char *)&(values[0]), numRows * sizeof(float)))
+        {
+            _valid = false;
+            return false;
+        }
+        _in.ignore(padding(numRows * sizeof(float)));
+        if(_fileColumns[i] >= 0)
+        {
+            for(uint64_t r = 0; r < numRows; ++r)
+                outBlock.set((int)r, _fileColumns[i], values[r]);
+        }
+    }
+    return true;
+}
+
+//where generateDataset gets its sketches
+class _DatasetSource
+{
+public:
+    virtual ~_DatasetSource() {}
+
+    virtual int numSketches() const = 0;
+    virtual PolylineConstPtr sketch(int i) const = 0;
+    virtual Parameters parameters(int i) const = 0;
+};
+
+class _DatasetBody
+{
+public:
+    _DatasetBody(const _DatasetSource &source, const DatasetOptions &options, DatasetFileWriter &writer, atomic<int> &next)
+        : _source(source), _options(options), _writer(writer), _next(next) {}
+
+    //each thread takes sketches until there are none left, collecting their rows into blocks
+    void operator()(int) const
+    {
+        vector<string> names = Algorithm<GRAPH_CONSTRUCTION>::names();
+        int algorithm = (int)(find(names.begin(), names.end(), "Dataset Generation") - names.begin());
+
+        Fitter fitter;
+        Dataset block;
+        for(int i = _next++; i < _source.numSketches(); i = _next++)
+        {
+            Parameters params = _source.parameters(i);
+            params.setAlgorithm(GRAPH_CONSTRUCTION, algorithm);
+            params.set(Parameters::HIERARCHICAL_POINTS, Parameters::infinity); //so there is one graph per sketch
+            params.set(Parameters::CORNER_PIECES, 0.);
+
+            fitter.reset();
+            fitter.setParams(params);
+            fitter.setOriginalSketch(_source.sketch(i));
+            fitter.runUntil(PATH_FINDING);
+
+            smart_ptr<const AlgorithmOutput<GRAPH_CONSTRUCTION> > graph = fitter.output<GRAPH_CONSTRUCTION>();
+            if(!graph || !graph->dataset)
+                continue;
+            int firstRow = block.numRows();
+            block.append(*graph->dataset);
+            _validate(fitter, *graph, block, firstRow);
+
+            if(block.numRows() >= _options.rowsPerBlock)
+            {
+                _writer.write(block);
+                block.clear();
+            }
+        }
+        _writer.write(block);
+    }
+
+private:
+    //fills in the validated costs of the edges the options ask for, spread evenly over the graph's rows, which
+    //start at firstRow in block (the graph's own dataset is part of the fitter's output, so it's left alone)
+    void _validate(const Fitter &fitter, const AlgorithmOutput<GRAPH_CONSTRUCTION> &graph, Dataset &block, int firstRow) const
+    {
+        vector<int> rowEdges; //the rows are the edges but the dummy ones
+        for(int e = 0; e < (int)graph.edges.size(); ++e)
+        {
+            if(graph.edges[e].continuity >= 0)
+                rowEdges.push_back(e);
+        }
+
+        int numRows = (int)rowEdges.size();
+        int numValidated = _options.validatedEdgesPerStroke < 0 ? numRows : min(numRows, _options.validatedEdgesPerStroke);
+        for(int k = 0; k < numValidated; ++k)
+        {
+            int row = (int)((k + 0.5) * numRows / numValidated);
+            block.set(firstRow + row, Dataset::VALIDATED_COST, graph.edges[rowEdges[row]].validatedCost(fitter));
+        }
+    }
+
+    const _DatasetSource &_source;
+    const DatasetOptions &_options;
+    DatasetFileWriter &_writer;
+    atomic<int> &_next;
+};
+
+static long long _generateDataset(const _DatasetSource &source, ostream &out, const DatasetOptions &options)
+{
+    DatasetFileWriter writer(out);
+    int numThreads = options.numThreads > 0 ? options.numThreads : numHardwareThreads();
+    numThreads = max(1, min(numThreads, source.numSketches()));
+
+    atomic<int> next(0);
+    parallelFor(numThreads, _DatasetBody(source, options, writer, next), numThreads);
+
+    return writer.isValid() ? writer.numRows() : -1;
+}
+
+class _VectorDatasetSource : public _DatasetSource
+{
+public:
+    _VectorDatasetSource(const vector<PolylineConstPtr> &sketches, const Parameters &params) : _sketches(sketches), _params(params) {}
+
+    int numSketches() const { return (int)_sketches.size(); }
+    PolylineConstPtr sketch(int i) const { return _sketches[i]; }
+    Parameters parameters(int) const { return _params; }
+
+private:
+    const vector<PolylineConstPtr> &_sketches;
+    const Parameters &_params;
+};
+
+class _SketchFileDatasetSource : public _DatasetSource
+{
+public:
+    _SketchFileDatasetSource(const SketchFileView &sketches) : _sketches(sketches) {}
+
+    int numSketches() const { return _sketches.numSketches(); }
+    PolylineConstPtr sketch(int i) const { return _sketches.polyline(i); }
+    Parameters parameters(int i) const { return _sketches.parameters(i); }
+
+private:
+    const SketchFileView &_sketches;
+};
+
+long long generateDataset(const vector<PolylineConstPtr> &sketches, const Parameters &params, ostream &out, const DatasetOptions &options)
+{
+    return _generateDataset(_VectorDatasetSource(sketches, params), out, options);
+}
+
+long long generateDataset(const SketchFileView &sketches, ostream &out, const DatasetOptions &options)
+{
+    return _generateDataset(_SketchFileDatasetSource(sketches), out, options);
+}
+
+END_NAMESPACE_Cornu
@@ -0,0 +1,158 @@
+/*--
+    Dataset.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_DATASET_H_INCLUDED
+#define CORNUCOPIA_DATASET_H_INCLUDED
+
+#include "defs.h"
+#include "smart_ptr.h"
+
+#include <stdint.h>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <vector>
+
+NAMESPACE_Cornu
+
+CORNU_SMART_FORW_DECL(Polyline);
+class Parameters;
+class SketchFileView;
+
+//Features of the edges of fitting graphs, for learning edge costs, stored by column.  The "Dataset Generation"
+//graph constructor fills one with a row for every edge of its graph but the dummy ones, in edge order, with the
+//validated cost left -1; generateDataset fills that in.  Lengths and errors are scaled like the costs are.
+class Dataset : public smart_base
+{
+public:
+    enum Column
+    {
+        START_TYPE, //CurvePrimitive::PrimitiveType of the first primitive
+        END_TYPE,
+        CONTINUITY,
+        AT_CORNER, //1 if the primitives meet at a corner
+        INFLECTION, //1 if the curvature signs the primitives have at the joint differ
+        START_LENGTH,
+        END_LENGTH,
+        START_ERROR,
+        END_ERROR,
+        POSITION_DIFF, //the differences at the joint CostEvaluator predicts the edge cost from
+        ANGLE_DIFF,
+        CURVATURE_DIFF,
+        START_VERTEX_COST,
+        END_VERTEX_COST,
+        PREDICTED_COST, //Edge::cost
+        VALIDATED_COST, //Edge::validatedCost, or -1 if it wasn't computed (costs are never negative)
+        NUM_COLUMNS //must be last
+    };
+
+    static const char *columnName(int column);
+
+    int numRows() const { return (int)_columns[0].size(); }
+    const std::vector<float> &column(int column) const { return _columns[column]; }
+    float get(int row, int column) const { return _columns[column][row]; }
+    void set(int row, int column, float value) { _columns[column][row] = value; }
+
+    void addRow(const float *values); //NUM_COLUMNS values
+    void append(const Dataset &other);
+    void clear();
+
+private:
+    std::vector<float> _columns[NUM_COLUMNS];
+};
+
+CORNU_SMART_TYPEDEFS(Dataset);
+
+/*
+    A binary format for datasets that is written a block of rows at a time, so a large one never needs to be in
+    memory.  The numbers are in the byte order of the machine that wrote the file, and readers reject files with
+    the other byte order.  Sections are padded to multiples of 8 bytes.
+
+    Layout:
+      header  a DatasetFileHeader
+      names   numColumns zero-terminated column names (Dataset::columnName), padded
+      blocks  until the end of the file, each a uint64 row count, then numColumns arrays of that many floats,
+              each padded
+*/
+struct DatasetFileHeader
+{
+    char magic[8]; //"CORNUDSF"
+    uint32_t version;
+    uint32_t byteOrder; //0x01020304 as written
+    uint32_t numColumns;
+    uint32_t reserved;
+};
+
+//Writes the header when constructed and a block on every write.  Several threads can write at once.
+class DatasetFileWriter
+{
+public:
+    DatasetFileWriter(std::ostream &out);
+
+    void write(const Dataset &block); //does nothing for an empty block
+    bool isValid() const; //false if the stream failed
+    long long numRows() const { return _numRows; }
+
+private:
+    DatasetFileWriter(const DatasetFileWriter &); //not copyable
+    DatasetFileWriter &operator=(const DatasetFileWriter &);
+
+    std::ostream &_out;
+    long long _numRows;
+    mutable std::mutex _mutex;
+};
+
+//Reads a dataset file a block at a time
+class DatasetFileReader
+{
+public:
+    DatasetFileReader(std::istream &in); //checks the header
+
+    bool isValid() const { return _valid; }
+    //Replaces outBlock with the next block, with NaN in the columns the file doesn't have.  Returns false at the
+    //end or if the file is bad.
+    bool next(Dataset &outBlock);
+
+private:
+    std::istream &_in;
+    bool _valid;
+    std::vector<int> _fileColumns; //the Dataset column of each of the file's columns, or -1 if it has none
+};
+
+struct DatasetOptions
+{
+    DatasetOptions() : validatedEdgesPerStroke(-1), rowsPerBlock(1 << 16), numThreads(0) {}
+
+    int validatedEdgesPerStroke; //the edges whose cost is validated, spread evenly over the graph; -1 means all
+    int rowsPerBlock; //each thread writes its rows in blocks of at least this many, except for its last
+    int numThreads; //0 means one per core
+};
+
+//Builds the graphs of the sketches in parallel and writes their edges' features to out, with the validated
+//costs the options ask for.  The rows of a sketch are contiguous, but the sketches are in no particular order.
+//Returns the number of rows, or -1 if the stream failed.
+long long generateDataset(const std::vector<PolylineConstPtr> &sketches, const Parameters &params, std::ostream &out,
+                          const DatasetOptions &options = DatasetOptions());
+//the same for the sketches of a sketch file, each fitted with its own parameters
+long long generateDataset(const SketchFileView &sketches, std::ostream &out, const DatasetOptions &options = DatasetOptions());
+
+END_NAMESPACE_Cornu
+
+#endif //CORNUCOPIA_DATASET_H_INCLUDED
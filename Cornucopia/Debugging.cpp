@@ -25,7 +25,14 @@ using namespace std;
 using namespace Eigen;
 NAMESPACE_Cornu
 
-Debugging *Debugging::_currentDebugging = new Debugging();
+Debugging *Debugging::_currentDebugging = new Debugging(true);
+thread_local Debugging *Debugging::_threadDebugging = NULL;
+
+Debugging *Debugging::null()
+{
+    static Debugging nullDebugging(true);
+    return &nullDebugging;
+}
 
 void Debugging::set(Debugging *debugging)
 {
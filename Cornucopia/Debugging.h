@@ -27,6 +27,15 @@
 #include <string>
 #include <Eigen/Core>
 
+//With CORNU_DEBUGGING set to 0, CORNU_DEBUG compiles to nothing, so the library makes no debugging calls
+#ifndef CORNU_DEBUGGING
+#define CORNU_DEBUGGING 1
+#endif
+
+//Calls a Debugging method, as in CORNU_DEBUG(printf("x = %lf", x)), only if the debugging object isn't one
+//that does nothing--the arguments aren't evaluated otherwise
+#define CORNU_DEBUG(...) do { if(Debugging::on()) Debugging::get()->__VA_ARGS__; } while(0)
+
 NAMESPACE_Cornu
 
 CORNU_SMART_FORW_DECL(Curve);
@@ -46,7 +55,16 @@ public:
         DOTTED
     };
 
-    static Debugging *get() { return _currentDebugging; }
+    static Debugging *get() { return _threadDebugging ? _threadDebugging : _currentDebugging; }
+
+    //Overrides the debugging object for the calling thread only (NULL restores the global one).
+    //The caller keeps ownership.  Used to silence worker threads during parallel fitting.
+    static void setForCurrentThread(Debugging *debugging) { _threadDebugging = debugging; }
+    static Debugging *null(); //an instance that does nothing, safe to use from any thread
+
+    //False when debugging is compiled out or the calling thread's debugging object is the default or null
+    //one, so debugging calls can be skipped without making them
+    static bool on() { return CORNU_DEBUGGING && !get()->_doesNothing; }
 
     virtual ~Debugging() {}
 
@@ -69,11 +87,15 @@ public:
     void drawPrimitive(CurvePrimitiveConstPtr curve, const std::string &group, int idx = 0, double thickness = 1.);
 
 protected:
-    Debugging() {}
+    Debugging() : _doesNothing(false) {}
     static void set(Debugging *debugging);
 
 private:
+    explicit Debugging(bool doesNothing) : _doesNothing(doesNothing) {}
+
+    bool _doesNothing; //true for the base class instances
     static Debugging *_currentDebugging;
+    static thread_local Debugging *_threadDebugging;
 };
 
 END_NAMESPACE_Cornu
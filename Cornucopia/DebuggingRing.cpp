@@ -0,0 +1,167 @@
+/*--
+    DebuggingRing.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "DebuggingRing.h"
+#include "Curve.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+using namespace Eigen;
+NAMESPACE_Cornu
+
+DebuggingRing::DebuggingRing(int capacity)
+    : _records(max(1, capacity)), _head(0), _tail(0), _numDropped(0)
+{
+}
+
+DebuggingRing::Record *DebuggingRing::_startPush(RecordType type, const string &text)
+{
+    unsigned tail = _tail.load(memory_order_relaxed);
+    if(tail - _head.load(memory_order_acquire) >= _records.size())
+    {
+        _numDropped.fetch_add(1, memory_order_relaxed);
+        return NULL;
+    }
+
+    Record &record = _records[tail % _records.size()];
+    record.type = type;
+    strncpy(record.text, text.c_str(), Record::MAX_TEXT - 1);
+    record.text[Record::MAX_TEXT - 1] = 0;
+    return &record;
+}
+
+void DebuggingRing::_finishPush()
+{
+    _tail.store(_tail.load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+void DebuggingRing::printf(const char *fmt, ...)
+{
+    Record *record = _startPush(TEXT, string());
+    if(!record)
+        return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(record->text, Record::MAX_TEXT, fmt, ap);
+    va_end(ap);
+
+    _finishPush();
+}
+
+void DebuggingRing::clear(const std::string &groups)
+{
+    if(_startPush(CLEAR, groups))
+        _finishPush();
+}
+
+void DebuggingRing::drawPoint(const Vector2d &pos, const Color &color, const std::string &group)
+{
+    Record *record = _startPush(POINT, group);
+    if(!record)
+        return;
+    record->p1 = pos;
+    record->color = color;
+    _finishPush();
+}
+
+void DebuggingRing::drawLine(const Vector2d &p1, const Vector2d &p2, const Color &color, const std::string &group, double thickness, LineStyle style)
+{
+    Record *record = _startPush(LINE, group);
+    if(!record)
+        return;
+    record->p1 = p1;
+    record->p2 = p2;
+    record->color = color;
+    record->thickness = thickness;
+    record->style = style;
+    _finishPush();
+}
+
+void DebuggingRing::drawCurve(CurveConstPtr curve, const Color &color, const std::string &group, double thickness, LineStyle style)
+{
+    Record *record = _startPush(CURVE, group);
+    if(!record)
+        return;
+    record->curve = curve;
+    record->color = color;
+    record->thickness = thickness;
+    record->style = style;
+    _finishPush();
+}
+
+void DebuggingRing::drawCurvatureField(CurveConstPtr curve, const Color &color, const std::string &group, double thickness, LineStyle style)
+{
+    Record *record = _startPush(CURVATURE_FIELD, group);
+    if(!record)
+        return;
+    record->curve = curve;
+    record->color = color;
+    record->thickness = thickness;
+    record->style = style;
+    _finishPush();
+}
+
+bool DebuggingRing::pop(Record &out)
+{
+    unsigned head = _head.load(memory_order_relaxed);
+    if(head == _tail.load(memory_order_acquire))
+        return false;
+
+    Record &record = _records[head % _records.size()];
+    out = record;
+    record.curve = CurveConstPtr(); //so the ring doesn't keep curves alive
+    _head.store(head + 1, memory_order_release);
+    return true;
+}
+
+void DebuggingRing::replay(Debugging *to)
+{
+    Record record;
+    while(pop(record))
+    {
+        switch(record.type)
+        {
+        case TEXT:
+            to->printf("%s", record.text);
+            break;
+        case POINT:
+            to->drawPoint(record.p1, record.color, record.text);
+            break;
+        case LINE:
+            to->drawLine(record.p1, record.p2, record.color, record.text, record.thickness, record.style);
+            break;
+        case CURVE:
+            to->drawCurve(record.curve, record.color, record.text, record.thickness, record.style);
+            break;
+        case CURVATURE_FIELD:
+            to->drawCurvatureField(record.curve, record.color, record.text, record.thickness, record.style);
+            break;
+        case CLEAR:
+            to->clear(record.text);
+            break;
+        }
+    }
+}
+
+END_NAMESPACE_Cornu
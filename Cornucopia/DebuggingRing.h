@@ -0,0 +1,94 @@
+/*--
+    DebuggingRing.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_DEBUGGINGRING_H_INCLUDED
+#define CORNUCOPIA_DEBUGGINGRING_H_INCLUDED
+
+#include "defs.h"
+#include "Debugging.h"
+
+#include <atomic>
+#include <vector>
+#include <Eigen/StdVector>
+
+NAMESPACE_Cornu
+
+//Records debugging output in a fixed-size ring buffer that one thread writes and another thread reads, without
+//locks.  A thread fitting strokes in parallel with others (e.g., a parallelFor body) can set one with
+//Debugging::setForCurrentThread to keep its output, and another thread can collect the records while it runs,
+//or replay them to the main Debugging object afterwards.  When the buffer is full, records are dropped and counted.
+//Timing calls aren't recorded.
+class DebuggingRing : public Debugging
+{
+public:
+    enum RecordType
+    {
+        TEXT,
+        POINT,
+        LINE,
+        CURVE,
+        CURVATURE_FIELD,
+        CLEAR
+    };
+
+    struct Record
+    {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        enum { MAX_TEXT = 160 };
+
+        RecordType type;
+        char text[MAX_TEXT]; //the message for TEXT, the group otherwise (truncated if too long)
+        Vector2d p1, p2; //the point is p1
+        Color color;
+        double thickness;
+        LineStyle style;
+        CurveConstPtr curve;
+    };
+
+    DebuggingRing(int capacity = 4096);
+
+    //overrides--called by the writing thread
+    bool isDebuggingOn() const { return true; }
+    void printf(const char *fmt, ...);
+    void clear(const std::string &groups = "");
+    void drawPoint(const Vector2d &pos, const Color &color, const std::string &group = "");
+    void drawLine(const Vector2d &p1, const Vector2d &p2, const Color &color, const std::string &group = "", double thickness = 1, LineStyle style = SOLID);
+    void drawCurve(CurveConstPtr curve, const Color &color, const std::string &group = "", double thickness = 1, LineStyle style = SOLID);
+    void drawCurvatureField(CurveConstPtr curve, const Color &color, const std::string &group = "", double thickness = 1, LineStyle style = SOLID);
+
+    //called by the reading thread
+    bool pop(Record &out); //the oldest record; returns false if there is none
+    void replay(Debugging *to); //pops all the records and makes the same calls on another debugging object
+    int numDropped() const { return _numDropped.load(std::memory_order_relaxed); }
+
+private:
+    Record *_startPush(RecordType type, const std::string &text); //NULL if the buffer is full
+    void _finishPush();
+
+    std::vector<Record, Eigen::aligned_allocator<Record> > _records;
+    std::atomic<unsigned> _head; //the next record to pop, written by the reader
+    std::atomic<unsigned> _tail; //the next record to push, written by the writer
+    std::atomic<int> _numDropped;
+};
+
+END_NAMESPACE_Cornu
+
+#endif //CORNUCOPIA_DEBUGGINGRING_H_INCLUDED
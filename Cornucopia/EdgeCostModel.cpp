@@ -0,0 +1,82 @@
+/*--
+    EdgeCostModel.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "EdgeCostModel.h"
+
+#include <cassert>
+
+using namespace std;
+using namespace Eigen;
+NAMESPACE_Cornu
+
+//the features whose weights are zero are skipped, which also keeps an infinite one from making a NaN
+static void addWeighted(const Dataset &batch, const float *weights, ArrayXf::MapType out)
+{
+    for(int c = 0; c < EdgeCostModel::NUM_FEATURES; ++c)
+    {
+        if(weights[c] != 0.f)
+            out += weights[c] * Map<const ArrayXf>(&(batch.column(c)[0]), out.size());
+    }
+}
+
+LinearEdgeCostModel::LinearEdgeCostModel(const vector<float> &weights, float bias) : _weights(weights), _bias(bias)
+{
+    assert((int)_weights.size() == NUM_FEATURES);
+}
+
+void LinearEdgeCostModel::costs(const Dataset &batch, float *out) const
+{
+    if(batch.numRows() == 0)
+        return;
+    ArrayXf::MapType result(out, batch.numRows());
+    result.setConstant(_bias);
+    addWeighted(batch, &(_weights[0]), result);
+}
+
+MLPEdgeCostModel::MLPEdgeCostModel(const MatrixXf &hiddenWeights, const VectorXf &hiddenBiases, const VectorXf &outputWeights, float outputBias)
+    : _hiddenWeights(hiddenWeights), _hiddenBiases(hiddenBiases), _outputWeights(outputWeights), _outputBias(outputBias)
+{
+    assert(_hiddenWeights.cols() == NUM_FEATURES);
+    assert(_hiddenBiases.size() == _hiddenWeights.rows() && _outputWeights.size() == _hiddenWeights.rows());
+}
+
+void MLPEdgeCostModel::costs(const Dataset &batch, float *out) const
+{
+    if(batch.numRows() == 0)
+        return;
+    ArrayXf::MapType result(out, batch.numRows());
+    result.setConstant(_outputBias);
+
+    //one hidden unit at a time, over the whole batch
+    static thread_local ArrayXf hidden;
+    static thread_local vector<float> weights;
+    hidden.resize(batch.numRows());
+    weights.resize(NUM_FEATURES);
+    for(int h = 0; h < _hiddenWeights.rows(); ++h)
+    {
+        for(int c = 0; c < NUM_FEATURES; ++c)
+            weights[c] = _hiddenWeights(h, c);
+        hidden.setConstant(_hiddenBiases[h]);
+        addWeighted(batch, &(weights[0]), ArrayXf::MapType(hidden.data(), hidden.size()));
+        result += _outputWeights[h] * hidden.max(0.f);
+    }
+}
+
+END_NAMESPACE_Cornu
@@ -0,0 +1,83 @@
+/*--
+    EdgeCostModel.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_EDGECOSTMODEL_H_INCLUDED
+#define CORNUCOPIA_EDGECOSTMODEL_H_INCLUDED
+
+#include "defs.h"
+#include "smart_ptr.h"
+#include "Dataset.h"
+
+#include <Eigen/Core>
+#include <vector>
+
+NAMESPACE_Cornu
+
+//A learned replacement for the cost parameters (see Fitter::setEdgeCostModel).  A model is evaluated on a batch of
+//edges at a time--all the edges out of a vertex, or all the edges of a path--whose features are the columns of a
+//Dataset before the validated cost, so a model runs down each column of the batch with vector instructions.
+class EdgeCostModel : public smart_base
+{
+public:
+    static const int NUM_FEATURES = Dataset::VALIDATED_COST;
+
+    virtual ~EdgeCostModel() {}
+
+    //sets out[r] to the predicted cost of the edge in row r of the batch
+    virtual void costs(const Dataset &batch, float *out) const = 0;
+};
+
+CORNU_SMART_TYPEDEFS(EdgeCostModel);
+
+//bias + weights . features
+class LinearEdgeCostModel : public EdgeCostModel
+{
+public:
+    LinearEdgeCostModel(const std::vector<float> &weights, float bias); //NUM_FEATURES weights
+
+    //override
+    void costs(const Dataset &batch, float *out) const;
+
+private:
+    std::vector<float> _weights;
+    float _bias;
+};
+
+//A perceptron with one hidden layer of rectified linear units:
+//outputBias + outputWeights . max(0, hiddenWeights * features + hiddenBiases)
+class MLPEdgeCostModel : public EdgeCostModel
+{
+public:
+    //hiddenWeights has a row of NUM_FEATURES weights for each hidden unit
+    MLPEdgeCostModel(const Eigen::MatrixXf &hiddenWeights, const Eigen::VectorXf &hiddenBiases, const Eigen::VectorXf &outputWeights, float outputBias);
+
+    //override
+    void costs(const Dataset &batch, float *out) const;
+
+private:
+    Eigen::MatrixXf _hiddenWeights;
+    Eigen::VectorXf _hiddenBiases;
+    Eigen::VectorXf _outputWeights;
+    float _outputBias;
+};
+
+END_NAMESPACE_Cornu
+
+#endif //CORNUCOPIA_EDGECOSTMODEL_H_INCLUDED
@@ -57,75 +57,138 @@ public:
     double computeError(CurvePrimitiveConstPtr curve, int from, int to,
                         bool firstToEndpoint, bool lastToEndpoint, bool reversed) const
     {
-        double error = 0;
+        return _computeError(curve, from, to, firstToEndpoint, lastToEndpoint, reversed, Parameters::infinity);
+    }
 
-        if(from < 0 || to >= (int)_pts.size())
-            return 0.;
+    void computeErrorVector(CurvePrimitiveConstPtr curve, int from, int to, VectorXd &outError, MatrixXd *outErrorDer,
+                            bool firstToEndpoint, bool lastToEndpoint, bool reversed, vector<double> *ioFootPoints) const
+    {
+        int numParams = (int)curve->params().size();
+        int num = _pts.numElems(from, to) + 1; //to is inclusive
+        int numOutputs = 2 * num;
+        outError.resize(numOutputs); 
+        if(outErrorDer)
+            outErrorDer->resize(numOutputs, numParams);
 
-        bool first = true;
-        for(VectorC<Vector2d>::Circulator circ = _pts.circulator(from); ; ++circ)
+        if(from < 0 || to >= (int)_pts.size())
         {
-            int idx = circ.index();
-            bool last = (idx == to);
+            outError.setZero();
+            if(outErrorDer)
+                outErrorDer->setZero();
+            return;
+        }
 
-            bool toFirstEndpoint = first && firstToEndpoint;
-            bool toLastEndpoint = last && lastToEndpoint;
+        _VectorTerms terms(outError, outErrorDer);
+        _evalTerms(curve, from, num, outErrorDer != NULL, terms, firstToEndpoint, lastToEndpoint, reversed, ioFootPoints);
+    }
 
-            const Vector2d &pt = _pts.flatAt(idx);
+    void computeErrorNormalEquations(CurvePrimitiveConstPtr curve, int from, int to, NormalMatrix &outJtJ, NormalVector &outJtE,
+                                     bool firstToEndpoint, bool lastToEndpoint, bool reversed, vector<double> *ioFootPoints) const
+    {
+        int numParams = (int)curve->params().size();
+        outJtJ = NormalMatrix::Zero(numParams, numParams);
+        outJtE = NormalVector::Zero(numParams);
+        if(from < 0 || to >= (int)_pts.size())
+            return;
 
-            double s;
-            if(toLastEndpoint)
-                s = reversed ? 0 : curve->length();
-            else if(toFirstEndpoint)
-                s = reversed ? curve->length() : 0;
-            else
-                s = curve->project(pt);
+        _NormalTerms terms(outJtJ, outJtE);
+        _evalTerms(curve, from, _pts.numElems(from, to) + 1, true, terms, firstToEndpoint, lastToEndpoint, reversed, ioFootPoints);
+        outJtJ.triangularView<StrictlyUpper>() = outJtJ.transpose();
+    }
 
-            double distSq = (curve->pos(s) - pt).squaredNorm();
-            double weight = 0;
-            if(!toFirstEndpoint)
-                weight += _weightsLeft.flatAt(idx);
-            if(!toLastEndpoint)
-                weight += _weightsRight.flatAt(idx);
+    double computeErrorForCost(CurvePrimitiveConstPtr curve, int from, int to,
+                               bool firstToEndpoint, bool lastToEndpoint, bool reversed) const
+    {
+        return computeError(curve, from, to, firstToEndpoint, lastToEndpoint, reversed) / curve->length();
+    }
 
-            error += weight * distSq;
+    double computeErrorForCost(CurvePrimitiveConstPtr curve, int from, int to, double cutoff,
+                               bool firstToEndpoint, bool lastToEndpoint, bool reversed) const
+    {
+        double length = curve->length();
+        //the slack makes sure that stopping early gives a result greater than cutoff despite roundoff
+        return _computeError(curve, from, to, firstToEndpoint, lastToEndpoint, reversed, cutoff * length * (1. + 1e-10)) / length;
+    }
 
-            first = false;
-            if(last)
-                break;
+protected:
+    typedef Matrix<double, 1, Dynamic, RowMajor, 1, 6> ParamRow; //same bound as ParamDer, so no allocation
+
+    //the terms go into the error vector and its derivative
+    struct _VectorTerms
+    {
+        _VectorTerms(VectorXd &error, MatrixXd *errorDer) : _error(error), _errorDer(errorDer) {}
+        void error(int i, const Vector2d &err) { _error.segment<2>(2 * i) = err; }
+        void derivative(int i, const Vector2d &, const CurvePrimitive::ParamDer &der) { _errorDer->block(2 * i, 0, 2, der.cols()) = der; }
+
+        VectorXd &_error;
+        MatrixXd *_errorDer;
+    };
+
+    //the terms are added to the normal equations (only the lower triangle of J^T J)
+    struct _NormalTerms
+    {
+        _NormalTerms(NormalMatrix &jtJ, NormalVector &jtE) : _jtJ(jtJ), _jtE(jtE) {}
+        void error(int, const Vector2d &) {}
+        void derivative(int, const Vector2d &err, const CurvePrimitive::ParamDer &der)
+        {
+            _jtJ.triangularView<Lower>() += der.transpose() * der;
+            _jtE.noalias() += der.transpose() * err;
         }
 
-        return error;
-    }
+        NormalMatrix &_jtJ;
+        NormalVector &_jtE;
+    };
 
-    void computeErrorVector(CurvePrimitiveConstPtr curve, int from, int to, VectorXd &outError, MatrixXd *outErrorDer,
-                            bool firstToEndpoint, bool lastToEndpoint, bool reversed) const
+    //Projects the num samples starting at from onto the curve and gives the terms (weighted error and, if
+    //withDerivative, its derivative w.r.t. the curve parameters) of each to out
+    template<class Terms>
+    void _evalTerms(CurvePrimitiveConstPtr curve, int from, int num, bool withDerivative, Terms &out,
+                    bool firstToEndpoint, bool lastToEndpoint, bool reversed, vector<double> *footPoints) const
     {
         int numParams = (int)curve->params().size();
-        int numOutputs = 2 * (_pts.numElems(from, to) + 1); //to is inclusive
-        outError.resize(numOutputs); 
-        if(outErrorDer)
-            outErrorDer->resize(numOutputs, numParams);
 
-        if(from < 0 || to >= (int)_pts.size())
+        //project and evaluate all the samples in one batch--the arrays are kept per thread because the
+        //solvers call this many times per curve
+        static thread_local Curve::PointVector samplePts, pos, tangents, der2s;
+        static thread_local vector<double> s;
+        samplePts.resize(num);
+        pos.resize(num);
+        s.resize(num);
+        for(int i = 0; i < num; ++i)
+            samplePts[i] = _pts.flatAt(_sampleIdx(from, i));
+
+        int projFrom = firstToEndpoint ? 1 : 0, projTo = lastToEndpoint ? num - 1 : num;
+        if(projTo > projFrom)
         {
-            outError.setZero();
-            outErrorDer->setZero();
-            return;
+            if(footPoints && (int)footPoints->size() == num)
+                _projectFromFootPoints(curve, from + projFrom, &(samplePts[projFrom]), projTo - projFrom, &((*footPoints)[projFrom]), &(s[projFrom]));
+            else
+                curve->projectMany(&(samplePts[projFrom]), projTo - projFrom, &(s[projFrom]));
         }
-         
+        if(firstToEndpoint)
+            s[0] = reversed ? curve->length() : 0;
+        if(lastToEndpoint)
+            s[num - 1] = reversed ? 0 : curve->length();
+        if(footPoints)
+            footPoints->assign(s.begin(), s.end());
+
+        //with derivatives, the curve evaluates each sample together with its parameter derivatives instead
+        if(withDerivative)
+        {
+            tangents.resize(num);
+            der2s.resize(num);
+        }
+        else
+            curve->evalMany(&(s[0]), num, &(pos[0]));
+
         CurvePrimitive::ParamDer der, tanDer;
-        bool first = true;
-        int vecIdx = 0;
-        for(VectorC<Vector2d>::Circulator circ = _pts.circulator(from); ; ++circ, vecIdx += 2)
+        for(int i = 0; i < num; ++i)
         {
-            int idx = circ.index();
-            bool last = (idx == to);
+            int idx = _sampleIdx(from, i);
 
-            bool toFirstEndpoint = first && firstToEndpoint;
-            bool toLastEndpoint = last && lastToEndpoint;
+            bool toFirstEndpoint = (i == 0) && firstToEndpoint;
+            bool toLastEndpoint = (i == num - 1) && lastToEndpoint;
 
-            const Vector2d &pt = _pts.flatAt(idx);
             double weightRoot = 0;
             if(toFirstEndpoint)
                 weightRoot = _weightRightRoots.flatAt(idx);
@@ -134,51 +197,153 @@ public:
             else
                 weightRoot = _weightRoots.flatAt(idx);
 
-            double s;
-            if(toLastEndpoint)
-                s = reversed ? 0 : curve->length();
-            else if(toFirstEndpoint)
-                s = reversed ? curve->length() : 0;
-            else
-                s = curve->project(pt);
+            if(withDerivative)
+            {
+                curve->evalWithDerivatives(s[i], &(pos[i]), &(tangents[i]), der, tanDer);
+                der2s[i] = curve->curvature(s[i]) * Vector2d(-tangents[i][1], tangents[i][0]);
+            }
 
-            Vector2d err = curve->pos(s) - pt;
-            outError.segment<2>(vecIdx) = err * weightRoot;
+            Vector2d err = pos[i] - samplePts[i];
+            out.error(i, err * weightRoot);
 
-            if(outErrorDer)
+            if(withDerivative)
             {
-                curve->derivativeAt(s, der, tanDer);
-                Vector2d tangent = curve->der(s);
-                RowVectorXd ds = RowVectorXd::Zero(numParams); 
+                const Vector2d &tangent = tangents[i];
+                ParamRow ds = ParamRow::Zero(numParams);
 
                 const double tol = 1e-10;
 
-                if(s + tol >= curve->length())
+                if(s[i] + tol >= curve->length())
                     ds(CurvePrimitive::LENGTH) = 1.;
-                else if(s > tol)
+                else if(s[i] > tol)
                 {
-                    double dfds = 1. + curve->der2(s).dot(err);
+                    double dfds = 1. + der2s[i].dot(err);
                     if(fabs(dfds) < tol)
                         dfds = (dfds < 0. ? -tol : tol);
                     ds = -(err.transpose() * tanDer + tangent.transpose() * der) / dfds;
                 }
 
-                outErrorDer->block(vecIdx, 0, 2, der.cols()) = (der + tangent * ds) * weightRoot;
+                out.derivative(i, err * weightRoot, CurvePrimitive::ParamDer((der + tangent * ds) * weightRoot));
+            }
+        }
+    }
+
+    //Takes a Newton step for the distance from each of the n samples starting at from toward its previous
+    //projection in footPoints, and puts the results in out.  The Newton step is only accurate for small steps
+    //and where the distance is convex, so the samples where the step is more than half the spacing of the
+    //samples (or where it isn't convex, near the center of curvature) are projected.
+    void _projectFromFootPoints(CurvePrimitiveConstPtr curve, int from, const Vector2d *samplePts, int n,
+                                const double *footPoints, double *out) const
+    {
+        static thread_local Curve::PointVector pos, der, der2, farPts;
+        static thread_local vector<double> start, farS;
+        static thread_local vector<int> farIdcs;
+        double length = curve->length();
+        start.resize(n);
+        pos.resize(n);
+        der.resize(n);
+        der2.resize(n);
+        for(int i = 0; i < n; ++i)
+            start[i] = max(0., min(length, footPoints[i])); //the curve's length may have changed
+        curve->evalMany(&(start[0]), n, &(pos[0]), &(der[0]), &(der2[0]));
+
+        farPts.clear();
+        farIdcs.clear();
+        for(int i = 0; i < n; ++i)
+        {
+            int idx = _sampleIdx(from, i);
+            double maxStep = 0.25 * (_weightsLeft.flatAt(idx) + _weightsRight.flatAt(idx));
+            Vector2d diff = pos[i] - samplePts[i];
+            double dotDer = 1. + der2[i].dot(diff);
+            double step = der[i].dot(diff) / dotDer;
+            if(dotDer > 0.5 && fabs(step) <= maxStep)
+                out[i] = max(0., min(length, start[i] - step));
+            else
+            {
+                farPts.push_back(samplePts[i]);
+                farIdcs.push_back(i);
+            }
+        }
+
+        if(farPts.empty())
+            return;
+        farS.resize(farPts.size());
+        curve->projectMany(&(farPts[0]), (int)farPts.size(), &(farS[0]));
+        for(int i = 0; i < (int)farIdcs.size(); ++i)
+            out[farIdcs[i]] = farS[i];
+    }
+
+    //index of the k'th sample starting at from
+    int _sampleIdx(int from, int k) const
+    {
+        int idx = from + k;
+        if(idx >= (int)_pts.size())
+            idx -= (int)_pts.size();
+        return idx;
+    }
+
+    //samples are sent to CurvePrimitive::distanceSqMany in batches of this size
+    enum { BATCH_SIZE = 8 };
+
+    //Stops as soon as the error exceeds errorCutoff
+    double _computeError(CurvePrimitiveConstPtr curve, int from, int to,
+                         bool firstToEndpoint, bool lastToEndpoint, bool reversed, double errorCutoff) const
+    {
+        double error = 0;
+
+        if(from < 0 || to >= (int)_pts.size())
+            return 0.;
+
+        Vector2d batchPts[BATCH_SIZE];
+        double batchWeights[BATCH_SIZE], batchDistSq[BATCH_SIZE];
+        int batchNum = 0;
+
+        bool first = true;
+        for(VectorC<Vector2d>::Circulator circ = _pts.circulator(from); ; ++circ)
+        {
+            int idx = circ.index();
+            bool last = (idx == to);
+
+            bool toFirstEndpoint = first && firstToEndpoint;
+            bool toLastEndpoint = last && lastToEndpoint;
+
+            const Vector2d &pt = _pts.flatAt(idx);
+
+            double weight = 0;
+            if(!toFirstEndpoint)
+                weight += _weightsLeft.flatAt(idx);
+            if(!toLastEndpoint)
+                weight += _weightsRight.flatAt(idx);
+
+            if(toFirstEndpoint || toLastEndpoint)
+            {
+                double s = (toLastEndpoint != reversed) ? curve->length() : 0.;
+                error += weight * (curve->pos(s) - pt).squaredNorm();
             }
+            else
+            {
+                batchPts[batchNum] = pt;
+                batchWeights[batchNum++] = weight;
+            }
+
+            if(batchNum == BATCH_SIZE || (last && batchNum > 0))
+            {
+                curve->distanceSqMany(batchPts, batchNum, batchDistSq);
+                for(int i = 0; i < batchNum; ++i)
+                    error += batchWeights[i] * batchDistSq[i];
+                batchNum = 0;
+            }
+            if(error > errorCutoff) //the error only grows from here
+                return error;
 
             first = false;
             if(last)
                 break;
         }
-    }
 
-    double computeErrorForCost(CurvePrimitiveConstPtr curve, int from, int to,
-                               bool firstToEndpoint, bool lastToEndpoint, bool reversed) const
-    {
-        return computeError(curve, from, to, firstToEndpoint, lastToEndpoint, reversed) / curve->length();
+        return error;
     }
 
-protected:
     const VectorC<Vector2d> &_pts;
     VectorC<double> _weightsLeft, _weightsRight, _weightLeftRoots, _weightRightRoots, _weightRoots;
 };
@@ -191,67 +356,147 @@ public:
 
     double computeErrorForCost(CurvePrimitiveConstPtr curve, int from, int to,
                                bool firstToEndpoint, bool lastToEndpoint, bool reversed) const
+    {
+        return computeErrorForCost(curve, from, to, Parameters::infinity, firstToEndpoint, lastToEndpoint, reversed);
+    }
+
+    double computeErrorForCost(CurvePrimitiveConstPtr curve, int from, int to, double cutoff,
+                               bool firstToEndpoint, bool lastToEndpoint, bool reversed) const
     {
         double error = 0;
 
         if(from < 0 || to >= (int)_pts.size())
             return 0.;
 
-        bool first = true;
-        for(VectorC<Vector2d>::Circulator circ = _pts.circulator(from); ; ++circ)
+        int num = _pts.numElems(from, to) + 1; //to is inclusive
+
+        //The maximum doesn't depend on the order, so when a cutoff is given, a few samples spread over
+        //the curve are checked first--a bad fit is usually far off somewhere in the middle.
+        const int numProbes = 5;
+        int probes[numProbes] = { num / 2, num / 4, (3 * num) / 4, 0, num - 1 };
+        bool useProbes = (cutoff < Parameters::infinity && num > 2 * numProbes);
+        double prevS = -1.; //the last projection, as a hint for the next one
+        if(useProbes)
         {
-            int idx = circ.index();
-            bool last = (idx == to);
+            for(int i = 0; i < numProbes; ++i)
+            {
+                error = max(error, _distSq(curve, from, probes[i], num, firstToEndpoint, lastToEndpoint, reversed, prevS));
+                if(error > cutoff)
+                    return error;
+            }
+        }
 
-            bool toFirstEndpoint = first && firstToEndpoint;
-            bool toLastEndpoint = last && lastToEndpoint;
+        //the rest in batches, with the samples projected to the endpoints separately
+        Vector2d batchPts[BATCH_SIZE];
+        double batchDistSq[BATCH_SIZE];
+        int batchNum = 0;
+        for(int k = 0; k < num; ++k)
+        {
+            bool isProbe = useProbes && find(probes, probes + numProbes, k) != probes + numProbes; //already done
+            bool toEndpoint = (k == 0 && firstToEndpoint) || (k == num - 1 && lastToEndpoint);
+            if(toEndpoint && !isProbe)
+                error = max(error, _distSq(curve, from, k, num, firstToEndpoint, lastToEndpoint, reversed, prevS));
+            else if(!isProbe)
+                batchPts[batchNum++] = _pts.flatAt(_sampleIdx(from, k));
+
+            if(batchNum == BATCH_SIZE || (k == num - 1 && batchNum > 0))
+            {
+                curve->distanceSqMany(batchPts, batchNum, batchDistSq);
+                for(int i = 0; i < batchNum; ++i)
+                    error = max(error, batchDistSq[i]);
+                batchNum = 0;
+            }
+            if(error > cutoff)
+                return error;
+        }
 
-            const Vector2d &pt = _pts.flatAt(idx);
+        return error;
+    }
 
-            double s;
-            if(toLastEndpoint)
-                s = reversed ? 0 : curve->length();
-            else if(toFirstEndpoint)
-                s = reversed ? curve->length() : 0;
-            else
-                s = curve->project(pt);
+private:
+    //squared distance from the k'th of num samples starting at from to the curve.  If prevS isn't negative,
+    //it is used as a hint for the projection, and it's updated to the projection.
+    double _distSq(CurvePrimitiveConstPtr curve, int from, int k, int num,
+                   bool firstToEndpoint, bool lastToEndpoint, bool reversed, double &prevS) const
+    {
+        int idx = _sampleIdx(from, k);
 
-            double distSq = (curve->pos(s) - pt).squaredNorm();
+        bool toFirstEndpoint = (k == 0) && firstToEndpoint;
+        bool toLastEndpoint = (k == num - 1) && lastToEndpoint;
 
-            error = max(error, distSq);
+        const Vector2d &pt = _pts.flatAt(idx);
 
-            first = false;
-            if(last)
-                break;
+        double s;
+        if(toLastEndpoint)
+            s = reversed ? 0 : curve->length();
+        else if(toFirstEndpoint)
+            s = reversed ? curve->length() : 0;
+        else
+        {
+            s = (prevS < 0.) ? curve->project(pt) : curve->projectNear(pt, prevS);
+            prevS = s;
         }
 
-        return error;
-    }    
+        return (curve->pos(s) - pt).squaredNorm();
+    }
+};
+
+//The same errors as LInfErrorComputer, with the primitive fitter handing them over in batches.  It computes them
+//one at a time on the CPU like the default: it's the reference a backend evaluating batches on another device
+//(which would override computeErrorsForCost) has to match, and it keeps the batched fitting tested.
+class BatchedLInfErrorComputer : public LInfErrorComputer
+{
+public:
+    BatchedLInfErrorComputer(const Fitter &fitter)
+        : LInfErrorComputer(fitter) {}
+
+    int preferredBatchSize() const { return 16; }
 };
 
 class ErrorComputerCreator : public Algorithm<ERROR_COMPUTER>
 {
 public:
-    ErrorComputerCreator(bool lInf = true)
-        : _lInf(lInf) {}
+    ErrorComputerCreator(bool lInf = true, bool batched = false)
+        : _lInf(lInf), _batched(batched) {}
 
-    string name() const { return _lInf ? "L-Infinity" : "L2"; }
+    string name() const { return _batched ? "L-Infinity Batched" : (_lInf ? "L-Infinity" : "L2"); }
 
 protected:
     void _run(const Fitter &fitter, AlgorithmOutput<ERROR_COMPUTER> &out)
     {
-        out.errorComputer = _lInf ? new LInfErrorComputer(fitter) : new L2ErrorComputer(fitter);
+        if(_batched)
+            out.errorComputer = new BatchedLInfErrorComputer(fitter);
+        else
+            out.errorComputer = _lInf ? new LInfErrorComputer(fitter) : new L2ErrorComputer(fitter);
     }
 private:
     bool _lInf;
+    bool _batched;
 };
 
 void Algorithm<ERROR_COMPUTER>::_initialize()
 {
     new ErrorComputerCreator(true);
     new ErrorComputerCreator(false);
+    new ErrorComputerCreator(true, true); //last, so the algorithm numbers of the others stay the same
+}
+
+
+void ErrorComputer::computeErrorNormalEquations(CurvePrimitiveConstPtr curve, int from, int to, NormalMatrix &outJtJ, NormalVector &outJtE,
+                                                bool firstToEndpoint, bool lastToEndpoint, bool reversed, vector<double> *ioFootPoints) const
+{
+    VectorXd error;
+    MatrixXd errorDer;
+    computeErrorVector(curve, from, to, error, &errorDer, firstToEndpoint, lastToEndpoint, reversed, ioFootPoints);
+    outJtJ = errorDer.transpose() * errorDer;
+    outJtE = errorDer.transpose() * error;
 }
 
+void ErrorComputer::computeErrorsForCost(const ErrorQuery *queries, int num, double cutoff, double *out) const
+{
+    for(int i = 0; i < num; ++i)
+        out[i] = computeErrorForCost(queries[i].curve, queries[i].from, queries[i].to, cutoff);
+}
 
 END_NAMESPACE_Cornu
 
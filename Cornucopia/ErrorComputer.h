@@ -24,6 +24,9 @@
 #include "defs.h"
 #include "Algorithm.h"
 
+#include <Eigen/Core>
+#include <vector>
+
 NAMESPACE_Cornu
 
 CORNU_SMART_FORW_DECL(CurvePrimitive);
@@ -31,6 +34,9 @@ CORNU_SMART_FORW_DECL(CurvePrimitive);
 class ErrorComputer : public smart_base
 {
 public:
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, 6, 6> NormalMatrix;
+    typedef Eigen::Matrix<double, Eigen::Dynamic, 1, 0, 6, 1> NormalVector;
+
     virtual ~ErrorComputer() {}
     //Computes the summed squared distance from the samples between from and to (incl.) to the given curve, weighted by distance between samples.
     //If firstToEndpoint is true, computes the distance of the first sample to the start of the curve (end if reversed==true) instead of to the
@@ -38,12 +44,44 @@ public:
     virtual double computeError(CurvePrimitiveConstPtr curve, int from, int to,
                                 bool firstToEndpoint = true, bool lastToEndpoint = true, bool reversed = false) const = 0;
     //Computes the individual error terms in a format suitable for optimization.
+    //A solver evaluating the same curve over and over with small parameter changes can pass ioFootPoints, which
+    //keeps the samples' projections (arc length parameters) between the calls: when it has one per sample, the
+    //previous projections are updated by a Newton step instead of projecting the samples again, except where the
+    //step is large.  Either way, it's left with this call's projections.
     virtual void computeErrorVector(CurvePrimitiveConstPtr curve, int from, int to,
                                     Eigen::VectorXd &outError, Eigen::MatrixXd *outErrorDer = NULL,
-                                    bool firstToEndpoint = true, bool lastToEndpoint = true, bool reversed = false) const = 0;
+                                    bool firstToEndpoint = true, bool lastToEndpoint = true, bool reversed = false,
+                                    std::vector<double> *ioFootPoints = NULL) const = 0;
+    //Computes the normal equations of the error vector for Gauss-Newton: outJtJ = J^T J and outJtE = J^T e, where e is
+    //the error vector and J its derivative.  By default they are formed from computeErrorVector's output, but
+    //subclasses can add up the terms for each sample instead, without making e and J, which are large for long curves.
+    virtual void computeErrorNormalEquations(CurvePrimitiveConstPtr curve, int from, int to, NormalMatrix &outJtJ, NormalVector &outJtE,
+                                             bool firstToEndpoint = true, bool lastToEndpoint = true, bool reversed = false,
+                                             std::vector<double> *ioFootPoints = NULL) const;
     //Computes the error to be used in the graph weight--by default, the squared maximum distance to the curve
     virtual double computeErrorForCost(CurvePrimitiveConstPtr curve, int from, int to,
                                        bool firstToEndpoint = true, bool lastToEndpoint = true, bool reversed = false) const = 0;
+    //Same as above, but for rejecting curves: once it is known that the result is greater than cutoff, it may stop early and
+    //return any value greater than cutoff.  Results that are not greater than cutoff are exact.
+    virtual double computeErrorForCost(CurvePrimitiveConstPtr curve, int from, int to, double cutoff,
+                                       bool firstToEndpoint = true, bool lastToEndpoint = true, bool reversed = false) const
+    { return computeErrorForCost(curve, from, to, firstToEndpoint, lastToEndpoint, reversed); }
+
+    //One of a batch of curves whose errors for cost are computed together, over the samples from from to to (incl.)
+    struct ErrorQuery
+    {
+        CurvePrimitiveConstPtr curve;
+        int from;
+        int to;
+    };
+    //An error computer that evaluates many curves at once (on another device, say), with the samples it was made
+    //with already there, can be faster the more it gets per call.  The primitive fitter then fits this many
+    //candidates from a start ahead, computes their errors in one batch and takes them up to the first one over
+    //the threshold, so the ones past it are wasted.  By default, the candidates are checked one at a time.
+    virtual int preferredBatchSize() const { return 1; }
+    //Computes computeErrorForCost(curve, from, to, cutoff) of each of the num queries into out.  By default, one
+    //at a time.
+    virtual void computeErrorsForCost(const ErrorQuery *queries, int num, double cutoff, double *out) const;
 };
 
 CORNU_SMART_TYPEDEFS(ErrorComputer);
@@ -0,0 +1,313 @@
+/*--
+    FitCache.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "FitCache.h"
+#include "Fitter.h"
+#include "Polyline.h"
+#include "PrimitiveSequence.h"
+#include "Combiner.h"
+#include "Arena.h"
+
+
+using namespace std;
+using namespace Eigen;
+NAMESPACE_Cornu
+
+const double FitCache::canonicalTolerance = 1e-7;
+
+//FNV-1a on the bytes--doubles that compare equal but differ in their bits (like 0 and -0) only cost a miss
+static void hashBytes(size_t &hash, const void *data, size_t n)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for(size_t i = 0; i < n; ++i)
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+}
+
+static void hashDouble(size_t &hash, double x)
+{
+    hashBytes(hash, &x, sizeof(double));
+}
+
+void FitCache::_makeKey(const Fitter &fitter, _Key &key, Similarity &frame) const
+{
+    key.sketch = fitter.originalSketch();
+    key.params = &fitter.params();
+    key.oversketchBase = fitter.oversketchBase();
+    key.canonical = _canonicalize && !key.oversketchBase;
+
+    if(key.canonical)
+    {
+        const VectorC<Vector2d> &pts = key.sketch->pts();
+        Vector2d centroid = Vector2d::Zero();
+        for(int i = 0; i < pts.size(); ++i)
+            centroid += pts[i];
+        centroid /= pts.size();
+
+        double xx = 0., xy = 0., yy = 0.;
+        for(int i = 0; i < pts.size(); ++i)
+        {
+            Vector2d d = pts[i] - centroid;
+            xx += d[0] * d[0];
+            xy += d[0] * d[1];
+            yy += d[1] * d[1];
+        }
+
+        //the principal axis, pointing toward the first point--for a round point cloud, which has none, the first point's direction
+        Vector2d first = pts[0] - centroid;
+        double angle;
+        if(fabs(xx - yy) + fabs(xy) > 1e-3 * (xx + yy))
+        {
+            angle = 0.5 * atan2(2. * xy, xx - yy);
+            if(first.dot(Vector2d(cos(angle), sin(angle))) < 0.)
+                angle += PI;
+        }
+        else
+            angle = first.squaredNorm() > 0. ? atan2(first[1], first[0]) : 0.;
+        frame = Similarity(fitter.scale(), angle, centroid);
+
+        VectorC<Vector2d> canonical(pts.size(), pts.circular());
+        Similarity toCanonical = frame.inverse();
+        for(int i = 0; i < pts.size(); ++i)
+            canonical[i] = toCanonical * pts[i];
+        Arena::Scope heapScope(NULL); //it may be stored in the cache
+        key.sketch = new Polyline(canonical);
+    }
+
+    key.hash = _hash(key);
+}
+
+size_t FitCache::_hash(const _Key &key)
+{
+    size_t hash = 14695981039346656037ull;
+
+    const VectorC<Vector2d> &pts = key.sketch->pts();
+    int closed = pts.circular();
+    hashBytes(hash, &closed, sizeof(int));
+    hashBytes(hash, &key.canonical, sizeof(bool));
+    for(int i = 0; i < pts.size(); ++i)
+    {
+        if(key.canonical) //points that round differently only cost a miss
+        {
+            long long quantized[2] = { llround(pts[i][0] / (100. * canonicalTolerance)), llround(pts[i][1] / (100. * canonicalTolerance)) };
+            hashBytes(hash, quantized, sizeof(quantized));
+        }
+        else
+        {
+            hashDouble(hash, pts[i][0]);
+            hashDouble(hash, pts[i][1]);
+        }
+    }
+
+    const vector<Parameters::Parameter> &paramList = Parameters::parameters();
+    for(int i = 0; i < (int)paramList.size(); ++i)
+        hashDouble(hash, key.params->get(paramList[i].type));
+    for(int i = 0; i < NUM_ALGORITHM_STAGES; ++i)
+    {
+        int algorithm = key.params->getAlgorithm(i);
+        hashBytes(hash, &algorithm, sizeof(int));
+    }
+
+    if(key.oversketchBase)
+    {
+        const VectorC<CurvePrimitiveConstPtr> &primitives = key.oversketchBase->primitives();
+        for(int i = 0; i < primitives.size(); ++i)
+        {
+            const CurvePrimitive::ParamVec &primParams = primitives[i]->params();
+            for(int j = 0; j < primParams.size(); ++j)
+                hashDouble(hash, primParams[j]);
+        }
+    }
+
+    return hash;
+}
+
+static bool sameBase(PrimitiveSequenceConstPtr a, PrimitiveSequenceConstPtr b)
+{
+    if(a == b)
+        return true;
+    if(!a || !b || a->isClosed() != b->isClosed() || a->primitives().size() != b->primitives().size())
+        return false;
+    for(int i = 0; i < a->primitives().size(); ++i)
+    {
+        CurvePrimitiveConstPtr primA = a->primitives()[i], primB = b->primitives()[i];
+        if(primA->getType() != primB->getType() || primA->params() != primB->params())
+            return false;
+    }
+    return true;
+}
+
+bool FitCache::_matches(const _Entry &entry, const _Key &key)
+{
+    if(entry.canonical != key.canonical)
+        return false;
+    if(entry.sketch != key.sketch) //the same polyline object can't have changed
+    {
+        const VectorC<Vector2d> &a = entry.sketch->pts(), &b = key.sketch->pts();
+        if(a.size() != b.size() || a.circular() != b.circular())
+            return false;
+        double tolerance = key.canonical ? canonicalTolerance : 0.;
+        for(int i = 0; i < a.size(); ++i)
+            if(key.canonical ? (a[i] - b[i]).lpNorm<Infinity>() > tolerance : a[i] != b[i])
+                return false;
+    }
+    return entry.params == *key.params && sameBase(entry.oversketchBase, key.oversketchBase);
+}
+
+FitCache::_Map::iterator FitCache::_find(const _Key &key)
+{
+    pair<_Map::iterator, _Map::iterator> range = _map.equal_range(key.hash);
+    for(_Map::iterator it = range.first; it != range.second; ++it)
+        if(_matches(*(it->second), key))
+            return it;
+    return _map.end();
+}
+
+//Copies the output of the combining stage on the heap, moved by the similarity
+AlgorithmOutputBasePtr FitCache::_transformed(const AlgorithmOutputBase &combined, const Similarity &similarity)
+{
+    Arena::Scope heapScope(NULL);
+    const AlgorithmOutput<COMBINING> &output = static_cast<const AlgorithmOutput<COMBINING> &>(combined);
+    smart_ptr<AlgorithmOutput<COMBINING> > out = new AlgorithmOutput<COMBINING>(output);
+    if(output.output) //the primitives are copied even if the similarity is the identity, so they're on the heap
+        out->output = output.output->transformed(similarity);
+    if(similarity.scale() != 1.)
+    {
+        vector<double> parameters = output.parameters();
+        for(int i = 0; i < (int)parameters.size(); ++i)
+            parameters[i] *= similarity.scale();
+        out->setParameters(parameters);
+    }
+    return out;
+}
+
+AlgorithmOutputBasePtr FitCache::find(const Fitter &fitter)
+{
+    _Key key;
+    Similarity frame;
+    _makeKey(fitter, key, frame);
+
+    AlgorithmOutputBasePtr found;
+    {
+        lock_guard<mutex> lock(_mutex);
+        _Map::iterator it = _find(key);
+        if(it == _map.end())
+        {
+            ++_misses;
+            return AlgorithmOutputBasePtr();
+        }
+
+        ++_hits;
+        _entries.splice(_entries.begin(), _entries, it->second); //now the most recently used
+        found = it->second->combined;
+    }
+
+    if(!key.canonical)
+        return found;
+    return _transformed(*found, frame);
+}
+
+void FitCache::insert(const Fitter &fitter)
+{
+    _Entry entry;
+    _Key key;
+    Similarity frame;
+    _makeKey(fitter, key, frame);
+    entry.hash = key.hash;
+    entry.sketch = key.sketch;
+    entry.params = *key.params;
+    entry.oversketchBase = key.oversketchBase;
+    entry.canonical = key.canonical;
+
+    //the parameters are found now: what the combiner kept for them is in the sketch's frame, not the entry's
+    fitter.output<COMBINING>()->parameters();
+    entry.combined = _transformed(*fitter.output<COMBINING>(), frame.inverse());
+
+    //an estimate: the points, the parameters of the original points, and the primitives with their bookkeeping
+    const AlgorithmOutput<COMBINING> &output = static_cast<const AlgorithmOutput<COMBINING> &>(*entry.combined);
+    entry.bytes = sizeof(_Entry) + 2 * sizeof(void *) + entry.sketch->pts().size() * sizeof(Vector2d) +
+        output.parameters().capacity() * sizeof(double);
+    if(output.output)
+        entry.bytes += output.output->primitives().size() * 192;
+
+    lock_guard<mutex> lock(_mutex);
+    if(entry.bytes > _maxBytes)
+        return;
+    _Map::iterator existing = _find(key);
+    if(existing != _map.end()) //another thread fitted the same stroke
+        _erase(existing);
+
+    _entries.push_front(entry);
+    _map.insert(make_pair(entry.hash, _entries.begin()));
+    _bytes += entry.bytes;
+
+    while(_bytes > _maxBytes)
+    {
+        _List::iterator last = --_entries.end();
+        pair<_Map::iterator, _Map::iterator> range = _map.equal_range(last->hash);
+        for(_Map::iterator it = range.first; it != range.second; ++it)
+        {
+            if(it->second == last)
+            {
+                _erase(it);
+                break;
+            }
+        }
+    }
+}
+
+void FitCache::_erase(_Map::iterator it)
+{
+    _bytes -= it->second->bytes;
+    _entries.erase(it->second);
+    _map.erase(it);
+}
+
+void FitCache::clear()
+{
+    lock_guard<mutex> lock(_mutex);
+    _entries.clear();
+    _map.clear();
+    _bytes = 0;
+}
+
+int FitCache::size() const
+{
+    lock_guard<mutex> lock(_mutex);
+    return (int)_entries.size();
+}
+
+size_t FitCache::bytes() const
+{
+    lock_guard<mutex> lock(_mutex);
+    return _bytes;
+}
+
+long long FitCache::hits() const
+{
+    lock_guard<mutex> lock(_mutex);
+    return _hits;
+}
+
+long long FitCache::misses() const
+{
+    lock_guard<mutex> lock(_mutex);
+    return _misses;
+}
+
+END_NAMESPACE_Cornu
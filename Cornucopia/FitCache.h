@@ -0,0 +1,121 @@
+/*--
+    FitCache.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef CORNUCOPIA_FITCACHE_H_INCLUDED
+#define CORNUCOPIA_FITCACHE_H_INCLUDED
+
+#include "defs.h"
+#include "smart_ptr.h"
+#include "Parameters.h"
+#include "Algorithm.h"
+#include "Similarity.h"
+
+#include <Eigen/Core>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+
+NAMESPACE_Cornu
+
+CORNU_SMART_FORW_DECL(Polyline);
+CORNU_SMART_FORW_DECL(PrimitiveSequence);
+class Fitter;
+
+//Remembers the final outputs of fits, so a stroke that is fitted again (after an undo, when a document is
+//reloaded, or when it's pasted) gets the earlier result without running the stages (see Fitter::setCache).
+//A fit is found by the sketch's points, the parameters (as compared by Parameters::operator==) and the
+//primitives of the oversketch base, which must all be exactly the same--the hash only narrows the search.
+//The least recently used fits are dropped to keep the estimated memory under maxBytes.  Any number of
+//threads (e.g., fitBatch's workers) can share a cache.
+//
+//A canonicalizing cache also recognizes a stroke that was moved, rotated or scaled, because the fit doesn't
+//change under those, except through the detected scale: the sketch is looked up with its centroid moved to the
+//origin, its principal axis rotated onto x, and divided by the fitter's scale (see Fitter::scale), and the fit
+//found is moved back.  A scaled copy only matches if the scale detector scaled it as much, and with the default
+//detector, a rotated copy only matches if its bounding box diagonal stays the same or it wasn't rescaled.  Those
+//points must agree to within canonicalTolerance.  A moved or rotated copy gets its own fit up to rounding; a scaled
+//copy gets one about as good, but not the same, because the solvers' damping and stopping tolerances aren't
+//relative to the scale.  Strokes with an oversketch base are looked up as they are.
+class FitCache : public smart_base
+{
+public:
+    FitCache(size_t maxBytes = 16 << 20, bool canonicalize = false)
+        : _maxBytes(maxBytes), _canonicalize(canonicalize), _bytes(0), _hits(0), _misses(0) {}
+
+    bool canonicalizes() const { return _canonicalize; }
+    static const double canonicalTolerance; //in units of the fitter's scale
+
+    //The fitter must have scale detection done.  Returns the output of the combining stage
+    //(for the fitter's sketch, even if it was found canonicalized), or NULL if the fit isn't cached.
+    AlgorithmOutputBasePtr find(const Fitter &fitter);
+    //Stores a copy of the fitter's output of the combining stage.  The copy is on the heap, so it doesn't keep
+    //the fitter's arena blocks (see Arena.h) around, and the fits that find it share it.
+    void insert(const Fitter &fitter);
+    void clear();
+
+    int size() const;
+    size_t bytes() const; //the estimated memory used by the cached fits
+    long long hits() const;
+    long long misses() const;
+
+private:
+    struct _Key
+    {
+        PolylineConstPtr sketch; //canonicalized, if the cache canonicalizes and there is no oversketch base
+        const Parameters *params;
+        PrimitiveSequenceConstPtr oversketchBase;
+        bool canonical;
+        size_t hash;
+    };
+
+    struct _Entry
+    {
+        size_t hash;
+        size_t bytes;
+        PolylineConstPtr sketch;
+        Parameters params;
+        PrimitiveSequenceConstPtr oversketchBase;
+        bool canonical;
+        AlgorithmOutputBasePtr combined; //for the sketch, as stored
+    };
+    typedef std::list<_Entry> _List; //most recently used first
+    typedef std::unordered_multimap<size_t, _List::iterator> _Map;
+
+    void _makeKey(const Fitter &fitter, _Key &key, Similarity &frame) const; //frame takes canonical coordinates to the sketch's
+    static size_t _hash(const _Key &key);
+    static bool _matches(const _Entry &entry, const _Key &key);
+    static AlgorithmOutputBasePtr _transformed(const AlgorithmOutputBase &combined, const Similarity &similarity);
+    _Map::iterator _find(const _Key &key);
+    void _erase(_Map::iterator it);
+
+    size_t _maxBytes;
+    bool _canonicalize;
+    size_t _bytes;
+    long long _hits;
+    long long _misses;
+    _List _entries;
+    _Map _map;
+    mutable std::mutex _mutex; //guards everything above but _maxBytes and _canonicalize
+};
+
+CORNU_SMART_TYPEDEFS(FitCache);
+
+END_NAMESPACE_Cornu
+
+#endif //CORNUCOPIA_FITCACHE_H_INCLUDED
@@ -0,0 +1,56 @@
+/*--
+    FitConfig.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef CORNUCOPIA_FITCONFIG_H_INCLUDED
+#define CORNUCOPIA_FITCONFIG_H_INCLUDED
+
+#include "defs.h"
+#include "Parameters.h"
+
+NAMESPACE_Cornu
+
+//The parameters of a fit resolved for the stages: the values, and the values times the fitter's scale, in
+//fixed-size arrays.  The fitter makes one after scale detection (see Fitter::config), so the stages' loops
+//read a number instead of going through the Parameters object and recomputing the scale.
+class FitConfig
+{
+public:
+    FitConfig() : _scale(0.) {}
+    FitConfig(const Parameters &params, double scale) : _scale(scale)
+    {
+        for(int i = 0; i < Parameters::NUM_PARAMETER_TYPES; ++i)
+        {
+            _values[i] = params.get(Parameters::ParameterType(i));
+            _scaled[i] = _values[i] * scale;
+        }
+    }
+
+    double get(Parameters::ParameterType param) const { return _values[param]; }
+    double scaled(Parameters::ParameterType param) const { return _scaled[param]; } //for the parameters in "pixels"
+    double scale() const { return _scale; } //pixel size * detected scale
+
+private:
+    double _values[Parameters::NUM_PARAMETER_TYPES];
+    double _scaled[Parameters::NUM_PARAMETER_TYPES];
+    double _scale;
+};
+
+END_NAMESPACE_Cornu
+
+#endif //CORNUCOPIA_FITCONFIG_H_INCLUDED
@@ -0,0 +1,157 @@
+/*--
+    FitPipeline.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "FitPipeline.h"
+#include "Parallel.h"
+#include "Debugging.h"
+
+using namespace std;
+NAMESPACE_Cornu
+
+FitPipeline::FitPipeline(const Parameters &params, const vector<AlgorithmStage> &threadFirstStages, int maxInFlight)
+: _firstStages(threadFirstStages), _numPending(0), _numFitting(0), _stopping(false)
+{
+    assert(!_firstStages.empty() && _firstStages[0] == SCALE_DETECTION);
+    for(int i = 1; i < (int)_firstStages.size(); ++i)
+        assert(_firstStages[i] > _firstStages[i - 1] && _firstStages[i] < NUM_ALGORITHM_STAGES);
+
+    int numThreads = (int)_firstStages.size();
+    if(maxInFlight <= 0)
+        maxInFlight = 2 * numThreads;
+
+    _fitters.resize(maxInFlight);
+    for(int i = maxInFlight - 1; i >= 0; --i)
+    {
+        _fitters[i].setParams(params);
+        _freeFitters.push_back(i);
+    }
+
+    _queues.resize(numThreads);
+    for(int i = 0; i < numThreads; ++i)
+        _threads.push_back(thread(&FitPipeline::_work, this, i));
+}
+
+FitPipeline::~FitPipeline()
+{
+    {
+        unique_lock<mutex> lock(_mutex);
+        while(_numFitting > 0)
+            _changed.wait(lock);
+        _stopping = true;
+    }
+    _changed.notify_all();
+
+    for(int i = 0; i < (int)_threads.size(); ++i)
+        _threads[i].join();
+}
+
+void FitPipeline::submit(PolylineConstPtr sketch)
+{
+    unique_lock<mutex> lock(_mutex);
+    while(_freeFitters.empty())
+        _changed.wait(lock);
+    int fitter = _freeFitters.back();
+    _freeFitters.pop_back();
+
+    _fitters[fitter].setOriginalSketch(sketch); //no thread has it until it's queued
+    _queues[0].push_back(fitter);
+    ++_numPending;
+    ++_numFitting;
+    lock.unlock();
+    _changed.notify_all();
+}
+
+bool FitPipeline::takeResult(Result &out)
+{
+    unique_lock<mutex> lock(_mutex);
+    while(_results.empty() && _numPending > 0)
+        _changed.wait(lock);
+    if(_results.empty())
+        return false;
+
+    out = _results.front();
+    _results.pop_front();
+    --_numPending;
+    return true;
+}
+
+void FitPipeline::_work(int thread)
+{
+    Debugging::setForCurrentThread(Debugging::null()); //Debugging implementations are generally not thread-safe
+    _inParallelFor() = true; //the pipeline keeps the cores busy, so the stages shouldn't start more threads
+
+    bool last = (thread + 1 == (int)_firstStages.size());
+    AlgorithmStage endStage = last ? NUM_ALGORITHM_STAGES : _firstStages[thread + 1];
+
+    unique_lock<mutex> lock(_mutex);
+    while(true)
+    {
+        while(_queues[thread].empty() && !_stopping)
+            _changed.wait(lock);
+        if(_queues[thread].empty())
+            break;
+
+        int fitterIdx = _queues[thread].front();
+        _queues[thread].pop_front();
+        lock.unlock();
+
+        Fitter &fitter = _fitters[fitterIdx];
+        fitter.runUntil(endStage);
+        Result result;
+        if(last)
+        {
+            result.curve = fitter.finalOutput();
+            result.stats = fitter.stats();
+            fitter.reset(); //keeps the memory of the outputs for the next stroke
+        }
+
+        lock.lock();
+        if(last)
+        {
+            _results.push_back(result);
+            _freeFitters.push_back(fitterIdx);
+            --_numFitting;
+        }
+        else
+            _queues[thread + 1].push_back(fitterIdx);
+        _changed.notify_all();
+    }
+
+    _inParallelFor() = false;
+    Debugging::setForCurrentThread(NULL);
+}
+
+vector<AlgorithmStage> FitPipeline::defaultThreadFirstStages()
+{
+    vector<AlgorithmStage> out;
+    out.push_back(SCALE_DETECTION);
+    for(int i = PRIMITIVE_FITTING; i < NUM_ALGORITHM_STAGES; ++i)
+        out.push_back((AlgorithmStage)i);
+    return out;
+}
+
+vector<AlgorithmStage> FitPipeline::everyStage()
+{
+    vector<AlgorithmStage> out;
+    for(int i = 0; i < NUM_ALGORITHM_STAGES; ++i)
+        out.push_back((AlgorithmStage)i);
+    return out;
+}
+
+END_NAMESPACE_Cornu
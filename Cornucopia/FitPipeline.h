@@ -0,0 +1,84 @@
+/*--
+    FitPipeline.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef CORNUCOPIA_FITPIPELINE_H_INCLUDED
+#define CORNUCOPIA_FITPIPELINE_H_INCLUDED
+
+#include "defs.h"
+#include "Fitter.h"
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+NAMESPACE_Cornu
+
+//Fits a stream of independent strokes with the stages split between threads, like an assembly line: while one
+//thread is combining the primitives of a stroke, another is fitting the candidate primitives of the next one.
+//Each thread keeps running the same stages, so their code and tables stay hot in its core's caches, and a stroke
+//only waits for the few strokes ahead of it.  The results come out in the order the strokes went in and are the
+//same as Fitter::run gives.  Throughput is limited by the slowest thread's stages, so for a batch that is all
+//there at once, fitBatch (see SimpleAPI.h) scales further.  Stages that use parallelFor run serially here.
+class FitPipeline
+{
+public:
+    struct Result
+    {
+        PrimitiveSequenceConstPtr curve; //NULL if the fit failed
+        FitStats stats;
+    };
+
+    //Each thread runs the stages from its first stage to the first stage of the next thread.  At most maxInFlight
+    //strokes (0 means two per thread) are fitted at a time, and submit waits for one to finish if needed.
+    FitPipeline(const Parameters &params, const std::vector<AlgorithmStage> &threadFirstStages = defaultThreadFirstStages(),
+                int maxInFlight = 0);
+    ~FitPipeline(); //finishes the strokes that were submitted and drops the results that weren't taken
+
+    void submit(PolylineConstPtr sketch);
+    //Waits for the result of the earliest submitted stroke whose result hasn't been taken.  Returns false if there is none.
+    bool takeResult(Result &out);
+
+    //the cheap stages before the primitive fitter share a thread, and every stage after has one of its own
+    static std::vector<AlgorithmStage> defaultThreadFirstStages();
+    static std::vector<AlgorithmStage> everyStage(); //a thread for every stage
+
+private:
+    FitPipeline(const FitPipeline &); //not copyable
+    FitPipeline &operator=(const FitPipeline &);
+
+    void _work(int thread);
+
+    std::vector<AlgorithmStage> _firstStages;
+    std::vector<Fitter> _fitters;
+    std::vector<int> _freeFitters;
+    std::vector<std::deque<int> > _queues; //of the fitters waiting for each thread
+    std::deque<Result> _results;
+    int _numPending; //strokes submitted whose results haven't been taken
+    int _numFitting; //strokes in the queues or being fitted
+    bool _stopping;
+    std::mutex _mutex; //guards everything above but the fitters, each of which is used by one thread at a time
+    std::condition_variable _changed;
+    std::vector<std::thread> _threads;
+};
+
+END_NAMESPACE_Cornu
+
+#endif //CORNUCOPIA_FITPIPELINE_H_INCLUDED
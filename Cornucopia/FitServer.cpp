@@ -0,0 +1,254 @@
+/*--
+    FitServer.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FitServer.h"
+#include "SketchFile.h"
+#include "Fitter.h"
+#include "FitCache.h"
+#include "Polyline.h"
+#include "PrimitiveSequence.h"
+#include "CurvePrimitive.h"
+#include "Parallel.h"
+#include "Debugging.h"
+
+#include <atomic>
+#include <cstring>
+#include <future>
+
+using namespace std;
+using namespace Eigen;
+NAMESPACE_Cornu
+
+static const char replyMagic[8] = { 'C', 'O', 'R', 'N', 'U', 'F', 'I', 'T' };
+static const uint32_t replyVersion = 1;
+
+bool readFitReply(const void *data, size_t size, vector<vector<BasicPrimitive> > &outStrokes, vector<bool> *outClosed)
+{
+    if(size < sizeof(FitReplyHeader))
+        return false;
+    const char *bytes = (const char *)data;
+    FitReplyHeader header;
+    memcpy(&header, bytes, sizeof(header));
+    if(memcmp(header.magic, replyMagic, sizeof(replyMagic)) || header.version != replyVersion)
+        return false;
+    size_t strokesSize = header.numStrokes * sizeof(FitReplyStroke);
+    if(size != sizeof(header) + strokesSize + header.numPrimitives * sizeof(FitReplyPrimitive))
+        return false;
+
+    const char *strokes = bytes + sizeof(header), *primitives = strokes + strokesSize;
+    outStrokes.assign(header.numStrokes, vector<BasicPrimitive>());
+    if(outClosed)
+        outClosed->assign(header.numStrokes, false);
+    uint64_t next = 0;
+    for(uint32_t i = 0; i < header.numStrokes; ++i)
+    {
+        FitReplyStroke stroke;
+        memcpy(&stroke, strokes + i * sizeof(FitReplyStroke), sizeof(stroke));
+        if(next + stroke.numPrimitives > header.numPrimitives)
+            return false;
+        if(outClosed)
+            (*outClosed)[i] = (stroke.flags & FitReplyStroke::CLOSED_CURVE) != 0;
+        outStrokes[i].resize(stroke.numPrimitives);
+        for(uint32_t j = 0; j < stroke.numPrimitives; ++j, ++next)
+        {
+            FitReplyPrimitive record;
+            memcpy(&record, primitives + next * sizeof(FitReplyPrimitive), sizeof(record));
+            BasicPrimitive &out = outStrokes[i][j];
+            out.type = (BasicPrimitive::PrimitiveType)record.type;
+            out.start = Point(record.start[0], record.start[1]);
+            out.length = record.length;
+            out.startAngle = record.startAngle;
+            out.startCurvature = record.startCurvature;
+            out.curvatureDerivative = record.curvatureDerivative;
+        }
+    }
+    return next == header.numPrimitives;
+}
+
+//A request being fitted: the copy of its sketch file, and the fits of the sketches as they're done
+class FitServer::_Request : public smart_base
+{
+public:
+    _Request(const void *data, size_t size, ReplyCallback inDone)
+        : storage(_copy(data, size)), view(storage.data(), size), remaining(0), done(inDone)
+    {
+        if(view.isValid())
+        {
+            fits.resize(view.numSketches());
+            remaining = view.numSketches();
+        }
+    }
+
+    vector<char> reply() const
+    {
+        vector<char> out(sizeof(FitReplyHeader) + fits.size() * sizeof(FitReplyStroke));
+        FitReplyHeader header;
+        memcpy(header.magic, replyMagic, sizeof(replyMagic));
+        header.version = replyVersion;
+        header.numStrokes = (uint32_t)fits.size();
+        header.numPrimitives = 0;
+
+        for(int i = 0; i < (int)fits.size(); ++i)
+        {
+            FitReplyStroke stroke;
+            stroke.numPrimitives = fits[i] ? (uint32_t)fits[i]->primitives().size() : 0;
+            stroke.flags = !fits[i] ? FitReplyStroke::FAILED : (fits[i]->isClosed() ? FitReplyStroke::CLOSED_CURVE : 0);
+            memcpy(&(out[sizeof(header) + i * sizeof(stroke)]), &stroke, sizeof(stroke));
+
+            for(int j = 0; j < (int)stroke.numPrimitives; ++j)
+            {
+                const CurvePrimitive &primitive = *fits[i]->primitives()[j];
+                FitReplyPrimitive record;
+                record.type = (uint32_t)primitive.getType();
+                record.reserved = 0;
+                record.start[0] = primitive.startPos()[0];
+                record.start[1] = primitive.startPos()[1];
+                record.length = primitive.length();
+                record.startAngle = primitive.startAngle();
+                record.startCurvature = primitive.startCurvature();
+                record.curvatureDerivative = primitive.getType() == CurvePrimitive::CLOTHOID ? primitive.params()[CurvePrimitive::DCURVATURE] : 0.;
+                const char *bytes = (const char *)&record;
+                out.insert(out.end(), bytes, bytes + sizeof(record));
+            }
+            header.numPrimitives += stroke.numPrimitives;
+        }
+        memcpy(&(out[0]), &header, sizeof(header));
+        return out;
+    }
+
+    vector<uint64_t> storage; //8-byte aligned, as the view needs
+    SketchFileView view;
+    vector<PrimitiveSequenceConstPtr> fits; //NULL where the fit failed
+    atomic<int> remaining;
+    ReplyCallback done;
+
+private:
+    static vector<uint64_t> _copy(const void *data, size_t size)
+    {
+        vector<uint64_t> out((size + 7) / 8, 0);
+        if(size > 0)
+            memcpy(out.data(), data, size);
+        return out;
+    }
+};
+
+FitServer::FitServer(int numThreads, FitCachePtr cache)
+: _cache(cache), _numFitting(0), _stopping(false)
+{
+    if(numThreads <= 0)
+        numThreads = numHardwareThreads();
+    for(int i = 0; i < numThreads; ++i)
+        _threads.push_back(thread(&FitServer::_work, this));
+}
+
+FitServer::~FitServer()
+{
+    {
+        unique_lock<mutex> lock(_mutex);
+        while(_numFitting > 0)
+            _changed.wait(lock);
+        _stopping = true;
+    }
+    _changed.notify_all();
+
+    for(int i = 0; i < (int)_threads.size(); ++i)
+        _threads[i].join();
+}
+
+bool FitServer::submit(const void *request, size_t size, ReplyCallback done)
+{
+    _RequestPtr queued = new _Request(request, size, done);
+    if(!queued->view.isValid())
+        return false;
+    if(queued->fits.empty())
+    {
+        done(queued->reply());
+        return true;
+    }
+
+    unique_lock<mutex> lock(_mutex);
+    for(int i = 0; i < (int)queued->fits.size(); ++i)
+        _queue.push_back(make_pair(queued, i));
+    _numFitting += (int)queued->fits.size();
+    lock.unlock();
+    _changed.notify_all();
+    return true;
+}
+
+vector<char> FitServer::fit(const void *request, size_t size)
+{
+    promise<vector<char> > reply;
+    if(!submit(request, size, [&reply](const vector<char> &out) { reply.set_value(out); }))
+        return vector<char>();
+    return reply.get_future().get();
+}
+
+void FitServer::_work()
+{
+    Debugging::setForCurrentThread(Debugging::null()); //Debugging implementations are generally not thread-safe
+    _inParallelFor() = true; //the strokes keep the threads busy, so the stages shouldn't start more
+
+    //the first fit of a Fitter allocates its outputs, so it's done before any request needs it;
+    //the cache is set afterwards so the warmup stroke doesn't take up an entry
+    Fitter fitter;
+    VectorC<Vector2d> warmup(20, NOT_CIRCULAR);
+    for(int i = 0; i < warmup.size(); ++i)
+        warmup[i] = Vector2d(10. * i, 20. * sin(0.3 * i));
+    fitter.setOriginalSketch(new Polyline(warmup));
+    fitter.run();
+    fitter.reset();
+    fitter.setCache(_cache);
+
+    unique_lock<mutex> lock(_mutex);
+    while(true)
+    {
+        while(_queue.empty() && !_stopping)
+            _changed.wait(lock);
+        if(_queue.empty())
+            break;
+
+        pair<_RequestPtr, int> next = _queue.front();
+        _queue.pop_front();
+        lock.unlock();
+
+        _Request &request = *next.first;
+        const SketchFileView &view = request.view;
+        if(view.sketch(next.second).numPoints >= 2)
+        {
+            fitter.setParams(view.parameters(next.second));
+            fitter.setOriginalSketch(view.polyline(next.second));
+            fitter.run();
+            request.fits[next.second] = fitter.finalOutput();
+            fitter.reset(); //keeps the memory of the outputs for the next stroke
+        }
+        if(--request.remaining == 0) //the other threads are done with the request's fits
+            request.done(request.reply());
+
+        lock.lock();
+        next.first = _RequestPtr(); //under the lock, in case the reference counts aren't atomic
+        --_numFitting;
+        _changed.notify_all();
+    }
+
+    _inParallelFor() = false;
+    Debugging::setForCurrentThread(NULL);
+}
+
+END_NAMESPACE_Cornu
@@ -0,0 +1,125 @@
+/*--
+    FitServer.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_FITSERVER_H_INCLUDED
+#define CORNUCOPIA_FITSERVER_H_INCLUDED
+
+#include "defs.h"
+#include "smart_ptr.h"
+#include "SimpleAPI.h"
+
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+NAMESPACE_Cornu
+
+CORNU_SMART_FORW_DECL(FitCache);
+
+/*
+    The replies of a FitServer, to requests that are sketch files (see SketchFile.h): the fits of the sketches
+    in order, with the primitives as in BasicPrimitive.  Like a sketch file, they're fixed-size records in the
+    byte order of the machine that wrote them.
+
+    Layout, in this order:
+      header     a FitReplyHeader
+      strokes    numStrokes FitReplyStroke records
+      primitives numPrimitives FitReplyPrimitive records, the ones of each stroke after those of the strokes before
+*/
+struct FitReplyHeader
+{
+    char magic[8]; //"CORNUFIT"
+    uint32_t version;
+    uint32_t numStrokes;
+    uint64_t numPrimitives;
+};
+
+struct FitReplyStroke
+{
+    enum Flags { CLOSED_CURVE = 1, FAILED = 2 };
+
+    uint32_t numPrimitives;
+    uint32_t flags;
+};
+
+struct FitReplyPrimitive
+{
+    uint32_t type; //BasicPrimitive::PrimitiveType
+    uint32_t reserved;
+    double start[2];
+    double length;
+    double startAngle;
+    double startCurvature;
+    double curvatureDerivative;
+};
+
+//Reads the primitives of each stroke (and optionally whether it's closed) from a reply.  Returns false if it
+//isn't a valid one.
+bool readFitReply(const void *data, size_t size, std::vector<std::vector<BasicPrimitive> > &outStrokes,
+                  std::vector<bool> *outClosed = NULL);
+
+//Fits the sketches of requests on threads that live as long as the server, so a process that fits strokes as
+//they come (such as CornucopiaServer) only starts up once.  Each thread fits a small stroke when it starts and
+//keeps its Fitter for all the strokes it fits (see Fitter::reset), so the memory of the outputs is reused.  The
+//strokes of all the requests are queued together and an idle thread takes the next one, so a request with many
+//strokes is spread over the threads and one with few shares them with the others.  The fits are the same as
+//Fitter::run gives with each sketch's parameters (an oversketch is fitted as a stroke of its own).  Stages that
+//use parallelFor run serially here.
+class FitServer
+{
+public:
+    typedef std::function<void(const std::vector<char> &reply)> ReplyCallback;
+
+    FitServer(int numThreads = 0, FitCachePtr cache = FitCachePtr()); //0 threads means one per core
+    ~FitServer(); //finishes the requests that were submitted
+
+    //Queues the sketches of a request, a sketch file in memory that is copied, so it needn't be aligned or kept.
+    //done is called with the reply on the thread that fits the last of them.  Returns false, without calling
+    //done, if the request isn't a valid sketch file.
+    bool submit(const void *request, size_t size, ReplyCallback done);
+    //Fits a request and waits for the reply, which is empty if the request isn't a valid sketch file
+    std::vector<char> fit(const void *request, size_t size);
+
+    int numThreads() const { return (int)_threads.size(); }
+
+private:
+    FitServer(const FitServer &); //not copyable
+    FitServer &operator=(const FitServer &);
+
+    CORNU_SMART_FORW_DECL(_Request);
+
+    void _work();
+
+    FitCachePtr _cache;
+    std::deque<std::pair<_RequestPtr, int> > _queue; //the sketches waiting, by request and index
+    int _numFitting; //sketches in the queue or being fitted
+    bool _stopping;
+    std::mutex _mutex; //guards the queue and the counts and flags above
+    std::condition_variable _changed;
+    std::vector<std::thread> _threads;
+};
+
+END_NAMESPACE_Cornu
+
+#endif //CORNUCOPIA_FITSERVER_H_INCLUDED
@@ -22,75 +22,408 @@
 #include "Preprocessing.h"
 #include "Polyline.h"
 #include "Resampler.h"
+#include "PrimitiveFitter.h"
+#include "GraphConstructor.h"
+#include "PathFinder.h"
 #include "Combiner.h"
+#include "PieceFitter.h"
+#include "SimpleStrokeFitter.h"
 #include "PrimitiveSequence.h"
+#include "EdgeCostModel.h"
+#include "Fresnel.h"
+#include "Tracing.h"
+
+#include <chrono>
 
 using namespace std;
 using namespace Eigen;
 NAMESPACE_Cornu
 
-void Fitter::run()
+typedef chrono::steady_clock Clock;
+
+static long long nanosecondsSince(Clock::time_point start)
 {
-    Debugging::get()->clear();
-    Debugging::get()->printf("============= Starting =============");
-    Debugging::get()->drawCurve(_originalSketch, Vector3d(0, 0, 0), "Original Sketch", 2., Debugging::DOTTED);
-    Debugging::get()->startTiming("Total");
+    return chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start).count();
+}
 
+void FitStats::clear()
+{
     for(int i = 0; i < NUM_ALGORITHM_STAGES; ++i)
+        stageNanoseconds[i] = stageBytes[i] = 0;
+    totalNanoseconds = peakBytes = 0;
+    numResampledPoints = numCandidatePrimitives = numGraphVertices = numGraphEdges = numValidatedEdges = numLSIterations = 0;
+    degraded = cancelled = cached = false;
+    counters.clear();
+}
+
+const char *WorkCounters::name(Counter counter)
+{
+    static const char *names[NUM_COUNTERS] = { "Line projections", "Arc projections", "Clothoid projections",
+        "Fresnel values", "Approximate Fresnel values", "Table Fresnel values", "LS solves", "LS iterations",
+        "LS evaluations", "LS damping increases", "Edge validations", "Edge invalidations", "Graph reductions" };
+    return names[counter];
+}
+
+const FitStats &Fitter::runUntil(AlgorithmStage endStage)
+{
+    CORNU_TRACE_SCOPE("Fitter::run");
+    Clock::time_point totalStart = Clock::now();
+    WorkCounters startCounters = WorkCounters::current();
+    bool starting = !_continuing;
+    if(starting)
     {
-        if(!(_outputs[i]))
+        _stats.clear();
+        _deadline = totalStart + chrono::duration_cast<Clock::duration>(chrono::duration<double, milli>(_timeBudget));
+
+        //the stages that cut their work short last time get another chance
+        for(int i = 0; i < NUM_ALGORITHM_STAGES; ++i)
+        {
+            if(_outputs[i] && _outputs[i]->degraded)
+            {
+                _clearBefore((AlgorithmStage)i);
+                break;
+            }
+        }
+        //a graph put together from pieces can't be searched again, so the pieces are fitted again instead
+        if(_outputs[GRAPH_CONSTRUCTION] && !_outputs[PATH_FINDING] && !output<GRAPH_CONSTRUCTION>()->costEvaluator)
+            _clearBefore(PRIMITIVE_FITTING);
+    }
+    bool hadFinalOutput = (bool)_outputs[COMBINING]; //the stages before it may be missing if the fit came from the cache
+    bool finished = hadFinalOutput;
+
+    Arena::Scope arenaScope(&_arena);
+
+    if(starting)
+    {
+        CORNU_DEBUG(clear());
+        CORNU_DEBUG(printf("============= Starting ============="));
+        CORNU_DEBUG(drawCurve(_originalSketch, Vector3d(0, 0, 0), "Original Sketch", 2., Debugging::DOTTED));
+    }
+    CORNU_DEBUG(startTiming("Total"));
+
+    bool debugging = Debugging::on(); //the stage names are only made for debugging
+    int end = min(_endStage, (int)endStage);
+    for(int i = 0; i < end && !finished && !_checkCancelled(); ++i)
+    {
+        FresnelTier::Scope fresnelScope(fresnelTier((AlgorithmStage)i));
+        if(i == PRELIM_RESAMPLING && !_outputs[i] && _cache && _endStage == NUM_ALGORITHM_STAGES) //a canonicalizing cache needs the scale
+        {
+            _outputs[COMBINING] = _cache->find(*this);
+            if((_stats.cached = finished = (bool)_outputs[COMBINING]))
+                break;
+        }
+        //these fill in the outputs through PATH_FINDING if the curve is fitted as one primitive or in pieces
+        if(i == PRIMITIVE_FITTING && !_outputs[i] && !SimpleStrokeFitter::run(*this))
+            PieceFitter::run(*this);
+        if(!(_outputs[i]) && !_checkCancelled())
         {
-            std::string stageName = AlgorithmBase::get((AlgorithmStage)i, 0)->stageName();
-            Debugging::get()->startTiming(stageName);
+            std::string stageName;
+            if(debugging)
+            {
+                stageName = AlgorithmBase::get((AlgorithmStage)i, 0)->stageName();
+                Debugging::get()->startTiming(stageName);
+            }
+            Clock::time_point stageStart = Clock::now();
             _runStage((AlgorithmStage)i);
-            if(Debugging::get()->getTimeElapsed(stageName) > 0.001) //only print significant times
+            _stats.stageNanoseconds[i] = nanosecondsSince(stageStart);
+            if(_checkCancelled())
+                _clearBefore((AlgorithmStage)i); //the stage may have stopped partway
+            if(debugging && Debugging::get()->getTimeElapsed(stageName) > 0.001) //only print significant times
                 Debugging::get()->elapsedTime(stageName);
         }
+        if(i == SCALE_DETECTION && _outputs[i])
+            _resolveConfig();
+        _stats.peakBytes = max(_stats.peakBytes, _outputBytes());
+        if(_releaseIntermediateOutputs && _outputs[i] && i < COMBINING && !_stats.cancelled)
+            _releaseAfter((AlgorithmStage)i); //the rest wait for the end of the run
     }
-    Debugging::get()->elapsedTime("Total");
+    CORNU_DEBUG(elapsedTime("Total"));
+    _stats.totalNanoseconds += nanosecondsSince(totalStart);
+    _stats.counters += WorkCounters::current() - startCounters;
+
+    _continuing = end < _endStage && !_stats.cancelled;
+    if(_continuing)
+        return _stats;
+
+    if(!_stats.cancelled)
+        _clearPrevious(); //the stages that could use them have run
+    _collectCounts();
 
-    if(Debugging::get()->isDebuggingOn() && finalOutput())
+    if(_cache && !hadFinalOutput && !_stats.cached && _outputs[COMBINING] && !_stats.degraded && !_stats.cancelled)
+        _cache->insert(*this);
+    if(_releaseIntermediateOutputs && _outputs[COMBINING] && !_stats.degraded)
+        _releaseAfter(COMBINING); //after the cache and the counts have read them
+
+    if(Debugging::on() && Debugging::get()->isDebuggingOn() && finalOutput())
     {
         // Now output some the final curve and a normal field for debugging
         PrimitiveSequenceConstPtr out = finalOutput();
         for(int i = 0; i < out->primitives().size(); ++i)
         {
-            Debugging::get()->drawPrimitive(out->primitives()[i], "Final Result Color", i, 3.);
-            Debugging::get()->drawCurve(out->primitives()[i], Vector3d(0, 0, 0), "Final Result");
-            Debugging::get()->drawCurvatureField(out->primitives()[i], Vector3d(1, 0, 0), "Normal Field");
+            CORNU_DEBUG(drawPrimitive(out->primitives()[i], "Final Result Color", i, 3.));
+            CORNU_DEBUG(drawCurve(out->primitives()[i], Vector3d(0, 0, 0), "Final Result"));
+            CORNU_DEBUG(drawCurvatureField(out->primitives()[i], Vector3d(1, 0, 0), "Normal Field"));
         }
     }
+
+    return _stats;
 }
 
-void Fitter::_runStage(AlgorithmStage stage)
+void Fitter::_collectCounts()
 {
-    _outputs[stage] = AlgorithmBase::get(stage, _params.getAlgorithm(stage))->run(*this);
+    if(output<RESAMPLING>() && output<RESAMPLING>()->output)
+        _stats.numResampledPoints = output<RESAMPLING>()->output->pts().size();
+    if(output<PRIMITIVE_FITTING>())
+        _stats.numCandidatePrimitives = (int)output<PRIMITIVE_FITTING>()->primitives.size();
+    if(output<GRAPH_CONSTRUCTION>())
+    {
+        _stats.numGraphVertices = (int)output<GRAPH_CONSTRUCTION>()->vertices.size();
+        _stats.numGraphEdges = (int)output<GRAPH_CONSTRUCTION>()->edges.size();
+    }
+    if(output<PATH_FINDING>())
+        _stats.numValidatedEdges = output<PATH_FINDING>()->numValidated;
+    if(output<COMBINING>())
+        _stats.numLSIterations = output<COMBINING>()->lsIterations;
+    for(int i = 0; i < NUM_ALGORITHM_STAGES; ++i)
+    {
+        _stats.degraded = _stats.degraded || (_outputs[i] && _outputs[i]->degraded);
+        _stats.stageBytes[i] = _outputs[i] ? (long long)_outputs[i]->memoryBytes() : 0;
+    }
 }
 
-void Fitter::_clearBefore(AlgorithmStage stage)
+long long Fitter::_outputBytes() const
 {
-    for(int i = stage; i < NUM_ALGORITHM_STAGES; ++i)
-        _outputs[i] = AlgorithmOutputBasePtr();
+    long long out = 0;
+    for(int i = 0; i < NUM_ALGORITHM_STAGES; ++i)
+        if(_outputs[i])
+            out += _outputs[i]->memoryBytes();
+    return out;
+}
+
+//the last stage that reads each stage's output, COMBINING for the ones the combiner reads and NUM_ALGORITHM_STAGES
+//for the ones that are kept--this needs to be updated when a stage reads another's output
+static const AlgorithmStage lastReader[NUM_ALGORITHM_STAGES] = {
+    NUM_ALGORITHM_STAGES, //SCALE_DETECTION, for the config
+    PRIMITIVE_FITTING, //PRELIM_RESAMPLING, which the pieces of a curve fitted in pieces are given (see PieceFitter)
+    COMBINING, //CURVE_CLOSING, for whether the curve is closed
+    COMBINING, //OVERSKETCHING
+    PRIMITIVE_FITTING, //CORNER_DETECTION, also given to the pieces
+    COMBINING, //RESAMPLING
+    COMBINING, //ERROR_COMPUTER
+    COMBINING, //PRIMITIVE_FITTING
+    COMBINING, //GRAPH_CONSTRUCTION
+    COMBINING, //PATH_FINDING
+    NUM_ALGORITHM_STAGES //COMBINING, the final output
+};
+
+void Fitter::_releaseAfter(AlgorithmStage stage)
+{
+    for(int i = 0; i < NUM_ALGORITHM_STAGES; ++i)
+        if(lastReader[i] <= stage)
+            _outputs[i] = _spareOutputs[i] = AlgorithmOutputBasePtr();
+    //the combiner reads the graph's vertices and edges but not the cost evaluator, which only searching the graph
+    //again would need (a run without it fits the candidates again, as for a graph put together from pieces)
+    if(stage == PATH_FINDING && _outputs[GRAPH_CONSTRUCTION])
+        static_pointer_cast<AlgorithmOutput<GRAPH_CONSTRUCTION> >(_outputs[GRAPH_CONSTRUCTION])->costEvaluator = CostEvaluatorPtr();
+}
+
+void Fitter::setParams(const Parameters &params)
+{
+    AlgorithmStage stage = _firstAffectedStage(_params, params);
+    _params = params;
+    if(stage < NUM_ALGORITHM_STAGES)
+    {
+        _clearBefore(stage);
+        _clearPrevious();
+        _continuing = false;
+    }
+    if(_outputs[SCALE_DETECTION])
+        _resolveConfig();
+}
+
+void Fitter::setEdgeCostModel(EdgeCostModelConstPtr model)
+{
+    _edgeCostModel = model;
+    //the candidates of a simple stroke fitted as one primitive are only good for the graph costs they were picked with
+    _clearBefore(_params.get(Parameters::FAST_SIMPLE_STROKES) > 0.5 ? PRIMITIVE_FITTING : GRAPH_CONSTRUCTION);
+    _clearPrevious();
+    _continuing = false;
+}
+
+void Fitter::setValidatedCostModel(EdgeCostModelConstPtr model)
+{
+    _validatedCostModel = model;
+    _clearBefore(PATH_FINDING);
+    _clearPrevious();
+    _continuing = false;
+}
+
+//the first stage that reads a parameter--this needs to be updated when parameters are added or used elsewhere
+static AlgorithmStage firstStageUsing(Parameters::ParameterType param, double oldVal, double newVal)
+{
+    switch(param)
+    {
+    case Parameters::LINE_COST:
+    case Parameters::ARC_COST:
+    case Parameters::CLOTHOID_COST:
+        //the primitive fitter only checks whether a type is used at all, unless it prunes (see _firstAffectedStage)
+        if((oldVal < Parameters::infinity) != (newVal < Parameters::infinity))
+            return PRIMITIVE_FITTING;
+        return GRAPH_CONSTRUCTION;
+    case Parameters::INFLECTION_COST:
+        //the primitive fitter only checks whether inflections are accounted for
+        if((oldVal > 0.) != (newVal > 0.))
+            return PRIMITIVE_FITTING;
+        return GRAPH_CONSTRUCTION;
+    case Parameters::G0_COST:
+    case Parameters::G1_COST:
+    case Parameters::G2_COST:
+    case Parameters::ERROR_COST:
+    case Parameters::SHORTNESS_COST:
+    case Parameters::SHORTNESS_THRESHOLD:
+    case Parameters::MAX_EDGES_PER_VERTEX:
+        return GRAPH_CONSTRUCTION;
+    case Parameters::INTERNAL_PARAMETERS_MARKER:
+    case Parameters::RESAMPLING_THREADS: //the threads don't change the output
+        return NUM_ALGORITHM_STAGES;
+    case Parameters::MIN_PRELIM_LENGTH:
+    case Parameters::DP_CUTOFF:
+        return PRELIM_RESAMPLING;
+    case Parameters::CLOSEDNESS_THRESHOLD:
+        return CURVE_CLOSING;
+    case Parameters::OVERSKETCH_THRESHOLD:
+        return OVERSKETCHING;
+    case Parameters::MINIMUM_CORNER_SPACING:
+    case Parameters::CORNER_NEIGHBORHOOD:
+    case Parameters::DENSE_SAMPLING_STEP:
+    case Parameters::CORNER_SCALES:
+    case Parameters::CORNER_THRESHOLD:
+        return CORNER_DETECTION;
+    case Parameters::MAX_SAMPLING_INTERVAL:
+    case Parameters::CURVATURE_ESTIMATE_REGION:
+    case Parameters::POINTS_PER_CIRCLE:
+    case Parameters::MAX_SAMPLE_RATE_SLOPE:
+        return RESAMPLING;
+    case Parameters::ERROR_THRESHOLD:
+    case Parameters::CURVE_ADJUST_DAMPING:
+    case Parameters::DOMINANCE_PRUNING:
+    case Parameters::CANDIDATE_LENGTHS_PER_DOUBLING:
+    case Parameters::FAST_SIMPLE_STROKES:
+        return PRIMITIVE_FITTING;
+    case Parameters::TWO_CURVE_CURVATURE_ADJUST:
+    case Parameters::REDUCE_GRAPH_EVERY:
+    case Parameters::PATH_VALIDATION_STOP:
+    case Parameters::VALIDATION_EARLY_STOP: //the first stage that validates edges, unless it's run in pieces (see _firstAffectedStage)
+        return PATH_FINDING;
+    case Parameters::COMBINE_DAMPING:
+        return COMBINING;
+    case Parameters::FRESNEL_TIER:
+        return PRIMITIVE_FITTING; //the first stage that evaluates clothoids
+    case Parameters::HIERARCHICAL_POINTS:
+    case Parameters::CORNER_PIECES:
+        return PRIMITIVE_FITTING; //the first stage that is run in pieces
+    default: //the scale, or anything not listed, affects everything
+        return SCALE_DETECTION;
+    }
+}
+
+AlgorithmStage Fitter::_firstAffectedStage(const Parameters &oldParams, const Parameters &newParams)
+{
+    int out = NUM_ALGORITHM_STAGES;
+    for(int i = 0; i < NUM_ALGORITHM_STAGES; ++i)
+        if(oldParams.getAlgorithm(i) != newParams.getAlgorithm(i))
+            out = min(out, i);
+
+    const vector<Parameters::Parameter> &params = Parameters::parameters();
+    for(int i = 0; i < (int)params.size(); ++i)
+    {
+        Parameters::ParameterType type = params[i].type;
+        double oldVal = oldParams.get(type), newVal = newParams.get(type);
+        if(oldVal != newVal)
+            out = min(out, (int)firstStageUsing(type, oldVal, newVal));
+    }
+    //the candidates of a simple stroke fitted as one primitive are only good for the graph costs they were picked with
+    if(out == GRAPH_CONSTRUCTION && newParams.get(Parameters::FAST_SIMPLE_STROKES) > 0.5)
+        out = PRIMITIVE_FITTING;
+    //and the candidates left after dominance pruning are only good for the type costs they were compared with
+    if(out > PRIMITIVE_FITTING && newParams.get(Parameters::DOMINANCE_PRUNING) > 0.5)
+    {
+        for(int i = Parameters::LINE_COST; i <= Parameters::CLOTHOID_COST; ++i)
+            if(oldParams.get((Parameters::ParameterType)i) != newParams.get((Parameters::ParameterType)i))
+                out = PRIMITIVE_FITTING;
+    }
+    //the pieces are joined by validating edges between them
+    if(out > PRIMITIVE_FITTING && oldParams.get(Parameters::VALIDATION_EARLY_STOP) != newParams.get(Parameters::VALIDATION_EARLY_STOP) &&
+       (newParams.get(Parameters::HIERARCHICAL_POINTS) < Parameters::infinity || newParams.get(Parameters::CORNER_PIECES) > 0.5))
+        out = PRIMITIVE_FITTING;
+
+    return (AlgorithmStage)out;
 }
 
-double Fitter::scale() const
+void Fitter::appendPoints(const VectorC<Vector2d> &pts)
 {
-    return output<SCALE_DETECTION>()->scale * _params.get(Parameters::PIXEL_SIZE);
+    if(!_originalSketch)
+    {
+        setOriginalSketch(new Polyline(pts));
+        return;
+    }
+
+    const VectorC<Vector2d> &oldPts = _originalSketch->pts();
+    VectorC<Vector2d> newPts(oldPts.size() + pts.size(), NOT_CIRCULAR);
+    for(int i = 0; i < oldPts.size(); ++i)
+        newPts[i] = oldPts[i];
+    for(int i = 0; i < pts.size(); ++i)
+        newPts[oldPts.size() + i] = pts[i];
+    _originalSketch = new Polyline(newPts);
+
+    if(_outputs[PRIMITIVE_FITTING]) //if the fitter hasn't run since the last append, keep the older outputs
+        _previousOutputs = _outputs;
+    _clearBefore(SCALE_DETECTION);
+    _continuing = false;
+}
+
+void Fitter::_resolveConfig()
+{
+    _config = FitConfig(_params, output<SCALE_DETECTION>()->scale * _params.get(Parameters::PIXEL_SIZE));
+}
+
+void Fitter::_runStage(AlgorithmStage stage)
+{
+    AlgorithmBase *algorithm = AlgorithmBase::get(stage, _params.getAlgorithm(stage));
+    TraceScope trace(Tracing::on() ? algorithm->stageName() : string());
+    _outputs[stage] = algorithm->run(*this, std::move(_spareOutputs[stage]));
+}
+
+void Fitter::_clearBefore(AlgorithmStage stage)
+{
+    for(int i = stage; i < NUM_ALGORITHM_STAGES; ++i)
+    {
+        if(!_outputs[i])
+            continue;
+        _spareOutputs[i] = std::move(_outputs[i]);
+        if(_spareOutputs[i].unique()) //clearing it now releases what it points to (otherwise run clears it if it can)
+            AlgorithmBase::get((AlgorithmStage)i, 0)->clearOutput(*_spareOutputs[i]);
+    }
 }
 
-double Fitter::scaledParameter(Parameters::ParameterType param) const
+FresnelTier::Tier Fitter::fresnelTier(AlgorithmStage stage) const
 {
-    return _params.get(param) * scale();
+    int tier = (int)(_params.get(Parameters::FRESNEL_TIER) + 0.5);
+    if(tier == 2) //the search gets the cheap approximations, the final solve full precision
+        return stage < COMBINING ? FresnelTier::APPROX : FresnelTier::FULL;
+    return tier == 1 ? FresnelTier::TABLE : FresnelTier::FULL;
 }
 
 PrimitiveSequenceConstPtr Fitter::finalOutput() const
 {
+    if(!_outputs[COMBINING]) //the run was cancelled
+        return PrimitiveSequenceConstPtr();
     return output<COMBINING>()->output;
 }
 
 const vector<double> &Fitter::originalSketchToFinalParameters() const
 {
-    return output<COMBINING>()->parameters;
+    return output<COMBINING>()->parameters();
 }
 
 
@@ -24,25 +24,73 @@
 #include "defs.h"
 #include "Parameters.h"
 #include "Algorithm.h"
+#include "Arena.h"
+#include "VectorC.h"
+#include "WorkCounters.h"
+#include "CancellationToken.h"
+#include "FitCache.h"
+#include "FitConfig.h"
+#include "Fresnel.h"
+
+#include <chrono>
 
 NAMESPACE_Cornu
 
 CORNU_SMART_FORW_DECL(Polyline);
 CORNU_SMART_FORW_DECL(PrimitiveSequence);
+CORNU_SMART_FORW_DECL(EdgeCostModel);
+
+//What the last Fitter::run did: the time each stage took and the sizes of the intermediate results.
+//The sizes come from the current outputs even if a stage was reused from an earlier run.
+struct FitStats
+{
+    FitStats() { clear(); }
+    void clear();
+
+    long long stageNanoseconds[NUM_ALGORITHM_STAGES]; //zero for the stages that didn't need to run, summed over the pieces for a curve fitted in pieces
+    long long totalNanoseconds;
+    //About how much memory each stage's output held when the run ended (see AlgorithmOutputBase::memoryBytes), zero
+    //for the stages without one, and the most all of them held at once, checked after each stage.  An object that
+    //two outputs share counts in both.
+    long long stageBytes[NUM_ALGORITHM_STAGES];
+    long long peakBytes;
+
+    int numResampledPoints;
+    int numCandidatePrimitives;
+    int numGraphVertices;
+    int numGraphEdges;
+    int numValidatedEdges; //two-curve problems solved while finding the path
+    int numLSIterations; //of the final multicurve solve
+    bool degraded; //whether some stage cut its work short to meet the time budget, so the fit may be worse
+    bool cancelled; //whether the run stopped early because its cancellation token was cancelled
+    bool cached; //whether the final output was found in the fitter's cache, so no stages ran
+
+    WorkCounters counters; //of the work done by the run, all zero unless CORNU_COUNTERS is on
+};
 
 class Fitter
 {
 public:
-    Fitter() : _outputs(NUM_ALGORITHM_STAGES) {}
+    Fitter() : _outputs(NUM_ALGORITHM_STAGES), _previousOutputs(NUM_ALGORITHM_STAGES), _spareOutputs(NUM_ALGORITHM_STAGES), _timeBudget(0.), _endStage(NUM_ALGORITHM_STAGES), _continuing(false), _releaseIntermediateOutputs(false) {}
 
     const Parameters &params() const { return _params; }
-    void setParams(const Parameters &params) { _params = params; _clearBefore(SCALE_DETECTION); }
+    void setParams(const Parameters &params); //only the stages affected by the changed parameters will rerun
 
     PolylineConstPtr originalSketch() const { return _originalSketch; }
-    void setOriginalSketch(PolylineConstPtr originalSketch) { _originalSketch = originalSketch; _clearBefore(SCALE_DETECTION); }
+    void setOriginalSketch(PolylineConstPtr originalSketch) { _originalSketch = originalSketch; _restart(); }
+
+    //Extends the original sketch with more points, for fitting while the curve is being drawn.  The outputs
+    //of the last run are kept (see previousOutput) so the next run can reuse the parts they don't affect.
+    void appendPoints(const VectorC<Eigen::Vector2d> &pts);
 
     PrimitiveSequenceConstPtr oversketchBase() const { return _oversketchBase; }
-    void setOversketchBase(PrimitiveSequenceConstPtr oversketchBase) { _oversketchBase = oversketchBase; _clearBefore(SCALE_DETECTION); }
+    void setOversketchBase(PrimitiveSequenceConstPtr oversketchBase) { _oversketchBase = oversketchBase; _restart(); }
+
+    //Forgets the sketch, the oversketch base and the outputs, to fit another stroke.  A Fitter keeps the stage
+    //outputs it clears (here, or because the sketch or parameters changed) and fills them again in the next run,
+    //so fitting many strokes with one Fitter reuses the memory of the resampled points, candidate primitives, graph
+    //and so on: only the outputs a caller still holds pointers to are replaced with new ones.
+    void reset() { _originalSketch = PolylineConstPtr(); _oversketchBase = PrimitiveSequenceConstPtr(); _restart(); }
 
     template<int AlgStage>
     smart_ptr<const AlgorithmOutput<AlgStage> > output() const
@@ -50,23 +98,107 @@ public:
         return static_pointer_cast<const AlgorithmOutput<AlgStage> >(_outputs[AlgStage]);
     }
 
-    void run();
+    //the output of the run before the points were appended--NULL if there is none
+    template<int AlgStage>
+    smart_ptr<const AlgorithmOutput<AlgStage> > previousOutput() const
+    {
+        return static_pointer_cast<const AlgorithmOutput<AlgStage> >(_previousOutputs[AlgStage]);
+    }
+
+    const FitStats &run() { return runUntil(NUM_ALGORITHM_STAGES); }
+    //Runs only the stages before endStage, so the stages of one fit can be run at different times or on different
+    //threads (see FitPipeline).  The next runUntil or run continues the same fit: the stats add up and the time
+    //budget is counted from the start of the first one.  Changing the sketch, the base or the parameters starts over.
+    const FitStats &runUntil(AlgorithmStage endStage);
+    const FitStats &stats() const { return _stats; } //of the last run
+
+    //For interactive use, a time for run to aim for, in milliseconds (zero, the default, for none).  Once it has
+    //passed, the primitive fitter stops adjusting candidates, the path finder takes the first path whose edges
+    //could all be combined even if validation made a cheaper one possible, and the combiner's solve takes few
+    //iterations.  The stages that did are marked degraded (see FitStats::degraded) and run again in the next run.
+    //The stages before those don't check the budget, since they are quick, so run can take longer.
+    void setTimeBudget(double milliseconds) { _timeBudget = milliseconds; }
+    double timeBudget() const { return _timeBudget; }
+    bool pastDeadline() const { return _timeBudget > 0. && std::chrono::steady_clock::now() > _deadline; } //for the stages
+
+    //Once the token is cancelled (from any thread), run stops: it checks between stages, and the primitive
+    //fitter, the path finder and the combiner's solve check as they go, so a stale fit stops soon after.  The
+    //stage that was cut short has no output, and neither do the ones after it, so finalOutput is NULL unless
+    //the run had nothing left to do.  The next run (after the token is reset) picks up where this one stopped.
+    void setCancellationToken(CancellationTokenConstPtr token) { _cancellationToken = token; }
+    CancellationTokenConstPtr cancellationToken() const { return _cancellationToken; }
+    bool cancelled() const { return _cancellationToken && _cancellationToken->isCancelled(); } //for the stages
+
+    //With a cache (which may be shared by many fitters), run looks the fit up in it after scale detection, and stores
+    //the fits it makes unless they were degraded or cancelled.  After a fit is found, only the scale and the final
+    //output (and the parameters of the sketch points in it) are there: the outputs of the other stages are NULL.
+    void setCache(FitCachePtr cache) { _cache = cache; }
+    FitCachePtr cache() const { return _cache; }
+
+    //With this on (it's off by default), run lets go of the stage outputs as soon as no later stage reads them: the
+    //preliminary resampling and the corners once the candidates are fitted, the graph's cost evaluator once the path is
+    //found, and the outputs of all the stages but scale detection once the final output is made (unless the run was
+    //degraded).  Their spare memory goes too, so a Fitter kept between fits holds little.  But output() is NULL for
+    //the released stages, and a run after the parameters change or points are appended makes them again rather than
+    //reusing them.
+    void setReleaseIntermediateOutputs(bool release) { _releaseIntermediateOutputs = release; }
+    bool releaseIntermediateOutputs() const { return _releaseIntermediateOutputs; }
+
+    //Learned models, both NULL by default (see EdgeCostModel).  With an edge cost model, the graph constructor
+    //predicts the costs of the edges with it rather than with the cost parameters--the edges those make infinitely
+    //costly are still left out.  With a validated cost model, the path finder skips the two-curve solve of an edge
+    //on a path when the model predicts that validation would not raise its cost.  Fitters that share a cache
+    //should have the same models.
+    void setEdgeCostModel(EdgeCostModelConstPtr model);
+    EdgeCostModelConstPtr edgeCostModel() const { return _edgeCostModel; }
+    void setValidatedCostModel(EdgeCostModelConstPtr model);
+    EdgeCostModelConstPtr validatedCostModel() const { return _validatedCostModel; }
 
     PrimitiveSequenceConstPtr finalOutput() const; //returns null if fitting failed for some reason
     const std::vector<double> &originalSketchToFinalParameters() const; //returns a vector that for each original sketch point has the final parameter value
 
-    double scale() const;  //returns the scale (pixel size * detected scale)
-    double scaledParameter(Parameters::ParameterType param) const;
+    //The parameters resolved with the detected scale, for the stages.  Made after scale detection in every run
+    //(and when the parameters are set after it), so it's only meaningful from then on.
+    const FitConfig &config() const { return _config; }
+    double scale() const { return _config.scale(); } //returns the scale (pixel size * detected scale)
+    double scaledParameter(Parameters::ParameterType param) const { return _config.scaled(param); }
+    FresnelTier::Tier fresnelTier(AlgorithmStage stage) const; //the one run evaluates clothoids with in the stage (see Parameters::FRESNEL_TIER)
 
 private:
+    friend class PieceFitter; //sets up the fitters for the pieces and fills in the outputs from them
+    friend class JointFitter; //fills in the outputs of combining strokes fitted jointly
+    friend class SimpleStrokeFitter; //fills in the outputs of a curve fitted as one primitive
+
     void _runStage(AlgorithmStage stage);
     void _clearBefore(AlgorithmStage stage);
+    static AlgorithmStage _firstAffectedStage(const Parameters &oldParams, const Parameters &newParams);
+    void _clearPrevious() { _previousOutputs = std::vector<AlgorithmOutputBasePtr>(NUM_ALGORITHM_STAGES); }
+    void _restart() { _clearBefore(SCALE_DETECTION); _clearPrevious(); _continuing = false; }
+    void _collectCounts();
+    bool _checkCancelled() { return _stats.cancelled = _stats.cancelled || cancelled(); }
+    void _resolveConfig();
+    void _releaseAfter(AlgorithmStage stage); //the outputs that only stages up to this one read
+    long long _outputBytes() const;
 
     PrimitiveSequenceConstPtr _oversketchBase;
     PolylineConstPtr _originalSketch;
     Parameters _params;
+    FitConfig _config;
 
     std::vector<AlgorithmOutputBasePtr> _outputs;
+    std::vector<AlgorithmOutputBasePtr> _previousOutputs; //kept by appendPoints until the next run
+    std::vector<AlgorithmOutputBasePtr> _spareOutputs; //cleared outputs, for the next run to fill (see reset)
+    Arena _arena; //the stage outputs are allocated here while the fitter runs
+    FitStats _stats;
+    double _timeBudget;
+    std::chrono::steady_clock::time_point _deadline; //of the current run
+    CancellationTokenConstPtr _cancellationToken;
+    FitCachePtr _cache;
+    EdgeCostModelConstPtr _edgeCostModel;
+    EdgeCostModelConstPtr _validatedCostModel;
+    int _endStage; //run stops before this stage
+    bool _continuing; //the last runUntil stopped before the end, so the next one continues its fit
+    bool _releaseIntermediateOutputs;
 };
 
 END_NAMESPACE_Cornu
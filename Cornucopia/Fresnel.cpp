@@ -25,6 +25,7 @@ Copyright 1984, 1987, 1989, 2000 by Stephen L. Moshier
 */
 
 #include "Fresnel.h"
+#include "WorkCounters.h"
 #include <vector>
 #include <iostream>
 
@@ -33,188 +34,621 @@ using namespace Eigen;
 using namespace internal; //use Eigen's internal namespace for packet math
 NAMESPACE_Cornu
 
-//Polynomial evaluation routines
-template<typename Scalar>
-static Scalar polevl( const Scalar &x, const Matrix<Scalar, Dynamic, 1> &coefVec ) //regular
+//Polynomial evaluation routines.  The degree is a template parameter, so Horner<> unrolls them
+//into straight-line code: Horner<K, N> applies coefficients K through N - 1.
+template<int K, int N>
+struct Horner
 {
-    int i = (int)coefVec.size() - 1;
-    const Scalar *coef = &(coefVec[0]);
-    Scalar ans = *coef++;
-
-    do
+    template<typename Scalar>
+    static Scalar eval(const Scalar &x, const Scalar (&coefs)[N], const Scalar &ans)
     {
-        ans = ans * x  +  *coef++;
-    } while( --i );
-
-    return ans;
-}
+        return Horner<K + 1, N>::eval(x, coefs, ans * x + coefs[K]);
+    }
+};
 
-template<typename Scalar>
-static Scalar p1evl( const Scalar &x, const Matrix<Scalar, Dynamic, 1> &coefVec ) //leading coef is 1
+template<int N>
+struct Horner<N, N>
 {
-    int i = (int)coefVec.size() - 1;
-    const Scalar *coef = &(coefVec[0]);
+    template<typename Scalar>
+    static Scalar eval(const Scalar &, const Scalar (&)[N], const Scalar &ans) { return ans; }
+};
 
-    Scalar ans = x + *coef++;
-
-    do
-    {
-        ans = ans * x  + *coef++;
-    } while( --i );
+template<typename Scalar, int N>
+static Scalar polevl( const Scalar &x, const Scalar (&coefs)[N] ) //regular
+{
+    return Horner<1, N>::eval(x, coefs, coefs[0]);
+}
 
-    return ans;
+template<typename Scalar, int N>
+static Scalar p1evl( const Scalar &x, const Scalar (&coefs)[N] ) //leading coef is 1
+{
+    return Horner<1, N>::eval(x, coefs, x + coefs[0]);
 }
 
 //==================Coefficients===========================
+//These are constexpr arrays, so they are ready before any code (including static initializers) runs
+//and their sizes fix the degrees of the polynomial evaluations at compile time
 
 //double precision rational coefficients for s, c, f, and g
-static VectorXd dsn(6), dsd(6);
-static VectorXd dcn(6), dcd(7);
-static VectorXd dfn(10), dfd(10);
-static VectorXd dgn(11), dgd(11);
-//single precision polynomial coefficients
-static VectorXf ssn(7);
-static VectorXf scn(7);
-static VectorXf sfn(8);
-static VectorXf sgn(8);
+static constexpr double dsn[] = {
+    -2.99181919401019853726E3,
+    7.08840045257738576863E5,
+    -6.29741486205862506537E7,
+    2.54890880573376359104E9,
+    -4.42979518059697779103E10,
+    3.18016297876567817986E11
+};
+static constexpr double dsd[] = {
+    /* 1.00000000000000000000E0,*/
+    2.81376268889994315696E2,
+    4.55847810806532581675E4,
+    5.17343888770096400730E6,
+    4.19320245898111231129E8,
+    2.24411795645340920940E10,
+    6.07366389490084639049E11
+};
+static constexpr double dcn[] = {
+    -4.98843114573573548651E-8,
+    9.50428062829859605134E-6,
+    -6.45191435683965050962E-4,
+    1.88843319396703850064E-2,
+    -2.05525900955013891793E-1,
+    9.99999999999999998822E-1
+};
+static constexpr double dcd[] = {
+    3.99982968972495980367E-12,
+    9.15439215774657478799E-10,
+    1.25001862479598821474E-7,
+    1.22262789024179030997E-5,
+    8.68029542941784300606E-4,
+    4.12142090722199792936E-2,
+    1.00000000000000000118E0
+};
+static constexpr double dfn[] = {
+    4.21543555043677546506E-1,
+    1.43407919780758885261E-1,
+    1.15220955073585758835E-2,
+    3.45017939782574027900E-4,
+    4.63613749287867322088E-6,
+    3.05568983790257605827E-8,
+    1.02304514164907233465E-10,
+    1.72010743268161828879E-13,
+    1.34283276233062758925E-16,
+    3.76329711269987889006E-20
+};
+static constexpr double dfd[] = {
+    /*  1.00000000000000000000E0,*/
+    7.51586398353378947175E-1,
+    1.16888925859191382142E-1,
+    6.44051526508858611005E-3,
+    1.55934409164153020873E-4,
+    1.84627567348930545870E-6,
+    1.12699224763999035261E-8,
+    3.60140029589371370404E-11,
+    5.88754533621578410010E-14,
+    4.52001434074129701496E-17,
+    1.25443237090011264384E-20
+};
+static constexpr double dgn[] = {
+    5.04442073643383265887E-1,
+    1.97102833525523411709E-1,
+    1.87648584092575249293E-2,
+    6.84079380915393090172E-4,
+    1.15138826111884280931E-5,
+    9.82852443688422223854E-8,
+    4.45344415861750144738E-10,
+    1.08268041139020870318E-12,
+    1.37555460633261799868E-15,
+    8.36354435630677421531E-19,
+    1.86958710162783235106E-22
+};
+static constexpr double dgd[] = {
+    /*  1.00000000000000000000E0,*/
+    1.47495759925128324529E0,
+    3.37748989120019970451E-1,
+    2.53603741420338795122E-2,
+    8.14679107184306179049E-4,
+    1.27545075667729118702E-5,
+    1.04314589657571990585E-7,
+    4.60680728146520428211E-10,
+    1.10273215066240270757E-12,
+    1.38796531259578871258E-15,
+    8.39158816283118707363E-19,
+    1.86958710162783236342E-22
+};
 //double precision polynomial coefficients
-static VectorXd dssn(7);
-static VectorXd dscn(7);
-static VectorXd dsfn(8);
-static VectorXd dsgn(8);
-
-struct InitCoefs
+static constexpr double dssn[] = {
+    1.647629463788700E-009,
+    -1.522754752581096E-007,
+    8.424748808502400E-006,
+    -3.120693124703272E-004,
+    7.244727626597022E-003,
+    -9.228055941124598E-002,
+    5.235987735681432E-001
+};
+static constexpr double dscn[] = {
+    1.416802502367354E-008,
+    -1.157231412229871E-006,
+    5.387223446683264E-005,
+    -1.604381798862293E-003,
+    2.818489036795073E-002,
+    -2.467398198317899E-001,
+    9.999999760004487E-001
+};
+static constexpr double dsfn[] = {
+    -1.903009855649792E+012,
+    1.355942388050252E+011,
+    -4.158143148511033E+009,
+    7.343848463587323E+007,
+    -8.732356681548485E+005,
+    8.560515466275470E+003,
+    -1.032877601091159E+002,
+    2.999401847870011E+000
+};
+static constexpr double dsgn[] = {
+    -1.860843997624650E+011,
+    1.278350673393208E+010,
+    -3.779387713202229E+008,
+    6.492611570598858E+006,
+    -7.787789623358162E+004,
+    8.602931494734327E+002,
+    -1.493439396592284E+001,
+    9.999841934744914E-001
+};
+//single precision polynomial coefficients (the same as above)
+static constexpr float ssn[] = {
+    1.647629463788700E-009,
+    -1.522754752581096E-007,
+    8.424748808502400E-006,
+    -3.120693124703272E-004,
+    7.244727626597022E-003,
+    -9.228055941124598E-002,
+    5.235987735681432E-001
+};
+static constexpr float scn[] = {
+    1.416802502367354E-008,
+    -1.157231412229871E-006,
+    5.387223446683264E-005,
+    -1.604381798862293E-003,
+    2.818489036795073E-002,
+    -2.467398198317899E-001,
+    9.999999760004487E-001
+};
+static constexpr float sfn[] = {
+    -1.903009855649792E+012,
+    1.355942388050252E+011,
+    -4.158143148511033E+009,
+    7.343848463587323E+007,
+    -8.732356681548485E+005,
+    8.560515466275470E+003,
+    -1.032877601091159E+002,
+    2.999401847870011E+000
+};
+static constexpr float sgn[] = {
+    -1.860843997624650E+011,
+    1.278350673393208E+010,
+    -3.779387713202229E+008,
+    6.492611570598858E+006,
+    -7.787789623358162E+004,
+    8.602931494734327E+002,
+    -1.493439396592284E+001,
+    9.999841934744914E-001
+};
+
+//Piecewise polynomial tables: accurate to about 1e-10 (3e-11 measured against fresnel), with no divisions
+//For x^2 < 0.5, the Taylor series s = x^3 tsn(x^4), c = x tcn(x^4), truncated after seven terms
+static constexpr double tsn[] = {
+    2.1082121933214533e-09,
+    -1.5647144500922104e-07,
+    8.444272883545251e-06,
+    -0.00031211694235457911,
+    0.0072447842041970028,
+    -0.092280585358035169,
+    0.52359877559829882
+};
+static constexpr double tcn[] = {
+    1.8843499115272676e-08,
+    -1.2000972558600284e-06,
+    5.4074133814083896e-05,
+    -0.0016048831356425351,
+    0.028185500877894218,
+    -0.24674011002723395,
+    1
+};
+
+//For 0.5 <= x^2 < 64, interval i covers 0.5 (i + 1) <= x^2 < 0.5 (i + 2), so each one spans the same change in
+//the phase of the integrands.  In each, s and c are polynomials in u = (x - center) * invHalfWidth, which is in
+//[-1, 1].  They were obtained by Chebyshev interpolation of fresnel at 40 points, truncated to degree 8, and
+//converted to monomials.
+struct FresnelInterval
 {
-    InitCoefs()
-    {
-        initPolynomial();
-        initRational();
-        ssn = dssn.cast<float>();
-        scn = dscn.cast<float>();
-        sfn = dsfn.cast<float>();
-        sgn = dsgn.cast<float>();
-    }
-
-    void initPolynomial()
-    {
-        dssn <<
-            1.647629463788700E-009,
-            -1.522754752581096E-007,
-            8.424748808502400E-006,
-            -3.120693124703272E-004,
-            7.244727626597022E-003,
-            -9.228055941124598E-002,
-            5.235987735681432E-001;
-        dscn <<
-            1.416802502367354E-008,
-            -1.157231412229871E-006,
-            5.387223446683264E-005,
-            -1.604381798862293E-003,
-            2.818489036795073E-002,
-            -2.467398198317899E-001,
-            9.999999760004487E-001;
-        dsfn <<
-            -1.903009855649792E+012,
-            1.355942388050252E+011,
-            -4.158143148511033E+009,
-            7.343848463587323E+007,
-            -8.732356681548485E+005,
-            8.560515466275470E+003,
-            -1.032877601091159E+002,
-            2.999401847870011E+000;
-        dsgn <<
-            -1.860843997624650E+011,
-            1.278350673393208E+010,
-            -3.779387713202229E+008,
-            6.492611570598858E+006,
-            -7.787789623358162E+004,
-            8.602931494734327E+002,
-            -1.493439396592284E+001,
-            9.999841934744914E-001;
-    }
-
-    void initRational()
-    {
-        dsn <<
-            -2.99181919401019853726E3,
-            7.08840045257738576863E5,
-            -6.29741486205862506537E7,
-            2.54890880573376359104E9,
-            -4.42979518059697779103E10,
-            3.18016297876567817986E11;
-        dsd <<
-            /* 1.00000000000000000000E0,*/
-            2.81376268889994315696E2,
-            4.55847810806532581675E4,
-            5.17343888770096400730E6,
-            4.19320245898111231129E8,
-            2.24411795645340920940E10,
-            6.07366389490084639049E11;
-        dcn <<
-            -4.98843114573573548651E-8,
-            9.50428062829859605134E-6,
-            -6.45191435683965050962E-4,
-            1.88843319396703850064E-2,
-            -2.05525900955013891793E-1,
-            9.99999999999999998822E-1;
-        dcd <<
-            3.99982968972495980367E-12,
-            9.15439215774657478799E-10,
-            1.25001862479598821474E-7,
-            1.22262789024179030997E-5,
-            8.68029542941784300606E-4,
-            4.12142090722199792936E-2,
-            1.00000000000000000118E0;
-        dfn <<
-            4.21543555043677546506E-1,
-            1.43407919780758885261E-1,
-            1.15220955073585758835E-2,
-            3.45017939782574027900E-4,
-            4.63613749287867322088E-6,
-            3.05568983790257605827E-8,
-            1.02304514164907233465E-10,
-            1.72010743268161828879E-13,
-            1.34283276233062758925E-16,
-            3.76329711269987889006E-20;
-        dfd <<
-            /*  1.00000000000000000000E0,*/
-            7.51586398353378947175E-1,
-            1.16888925859191382142E-1,
-            6.44051526508858611005E-3,
-            1.55934409164153020873E-4,
-            1.84627567348930545870E-6,
-            1.12699224763999035261E-8,
-            3.60140029589371370404E-11,
-            5.88754533621578410010E-14,
-            4.52001434074129701496E-17,
-            1.25443237090011264384E-20;
-        dgn <<
-            5.04442073643383265887E-1,
-            1.97102833525523411709E-1,
-            1.87648584092575249293E-2,
-            6.84079380915393090172E-4,
-            1.15138826111884280931E-5,
-            9.82852443688422223854E-8,
-            4.45344415861750144738E-10,
-            1.08268041139020870318E-12,
-            1.37555460633261799868E-15,
-            8.36354435630677421531E-19,
-            1.86958710162783235106E-22;
-        dgd <<
-            /*  1.00000000000000000000E0,*/
-            1.47495759925128324529E0,
-            3.37748989120019970451E-1,
-            2.53603741420338795122E-2,
-            8.14679107184306179049E-4,
-            1.27545075667729118702E-5,
-            1.04314589657571990585E-7,
-            4.60680728146520428211E-10,
-            1.10273215066240270757E-12,
-            1.38796531259578871258E-15,
-            8.39158816283118707363E-19,
-            1.86958710162783236342E-22;
-    }
-} init;
+    double center, invHalfWidth;
+    double s[9], c[9]; //highest degree first, as polevl takes them
+};
+
+static constexpr FresnelInterval fresnelIntervals[] = {
+    {0.85355339059327373, 6.8284271247461916,
+     {3.7051834045342957e-08, 9.5829504620503769e-07, 6.094152573743461e-06, -2.0165083909090553e-05, -0.00059381431874910851, -0.0027468382396282701, 0.011892502759699213, 0.13333463375483989, 0.29638573904106741},
+     {-9.1653646450140513e-08, -1.9790184069279348e-07, 6.6549697028683852e-06, 7.441225128668183e-05, 0.00013612406867058446, -0.0030539990675222117, -0.026180194079029051, 0.060568019048544627, 0.74834267277148636}},
+    {1.1123724356957945, 8.8989794855663611,
+     {-2.2277277800242246e-08, 3.8757436371383847e-08, 3.4880378626533926e-06, 2.9147249801464437e-05, -0.00010049779003426518, -0.0029604095053946261, -0.0080376605210982291, 0.10465109509508724, 0.54811371153006927},
+     {-1.6556354509589255e-08, -3.3148219147349778e-07, -1.3762305097753114e-06, 2.5507902606580757e-05, 0.00034378077484170655, 0.00036019796135861037, -0.020548194472830184, -0.040935468932442688, 0.75954911231392042}},
+    {1.3194792168823422, 10.555833735058725,
+     {-1.1946460709566509e-08, -1.5405103104271234e-07, 3.2610377487252151e-07, 2.559782914957065e-05, 0.00016765847165728376, -0.001372239843387496, -0.017083072000995389, 0.037483457791901972, 0.69475065166718275},
+     {6.6518310859464691e-09, -1.0209030509855666e-07, -2.3057132254589163e-06, -7.3660100956551844e-06, 0.00021499420678361414, 0.0020600312867389836, -0.0073598597298430019, -0.087003371275364283, 0.62098956778098224}},
+    {1.4976761962286425, 11.98140956982914,
+     {-4.063593905812013e-11, -1.1433452540288158e-07, -1.2735680612330214e-06, 7.2790675256229065e-06, 0.00022884296627195821, 0.00051667803869601125, -0.015208113662129194, -0.031094126454056695, 0.69838247464598968},
+     {8.6047804437328068e-09, 5.3034418412423179e-08, -1.1441705677350811e-06, -1.9669774217911939e-05, 4.7452568688322039e-06, 0.0021041500982734579, 0.0061053174508590574, -0.077454286857288848, 0.44741291447148429}},
+    {1.6565948188265334, 13.252758550612285,
+     {5.1952806501276427e-09, -1.6196441077198642e-08, -1.3502708389179219e-06, -9.1404349418233721e-06, 0.00013541232636182787, 0.001697103094091823, -0.0057919314764694613, -0.069451208862629815, 0.59072624848800093},
+     {3.3659586229362048e-09, 9.476707552025232e-08, 2.7530127044705921e-07, -1.5188334632709743e-05, -0.00014934600344712612, 0.00096520749509007575, 0.013636712971460532, -0.029498064779182442, 0.33611649162790119}},
+    {1.801439750477924, 14.411518003823385,
+     {4.4800190224236758e-09, 5.4185800069106449e-08, -5.2878294243274837e-07, -1.5416721894034868e-05, -1.8030677800789929e-05, 0.0017185187942431596, 0.0051185174953183865, -0.06430601956483821, 0.44960229604238477},
+     {-1.8178716310046639e-09, 5.6807049064744319e-08, 1.0453999714221673e-06, -2.4826135636146773e-06, -0.00018161916311021375, -0.00050789466807288353, 0.012626457415981999, 0.026068395544922775, 0.33416837964497875}},
+    {1.9354143466934852, 15.48331477354788,
+     {1.0046297127530579e-09, 6.6729324732506257e-08, 4.1153283092398851e-07, -1.0880218436148947e-05, -0.00013400160868137778, 0.00077525114303214626, 0.011684002956382368, -0.025106296096521905, 0.35620712292184614},
+     {-3.8584841988154039e-09, -6.4030312163509961e-09, 9.4625290736338741e-07, 9.0007820521820214e-06, -0.00010162903272983859, -0.0014745980347017351, 0.0049296097116367232, 0.059506138419254812, 0.42538394823892828}},
+    {2.060660171779821, 16.485281374238596,
+     {-2.075275062907167e-09, 3.2869079680253321e-08, 8.8978732415423423e-07, -5.4721031511606455e-07, -0.00015473710172311805, -0.00048007170709636615, 0.011030117846001553, 0.022889330550904627, 0.35494815440926714},
+     {-2.7123254753291803e-09, -4.904328743116082e-08, 2.743155110840334e-07, 1.2985376140361993e-05, 2.5879601996930957e-05, -0.0014879390647638963, -0.0044943095436941263, 0.056175928896252642, 0.54742249057838566}},
+    {2.1786941605297159, 17.429553284237684,
+     {-3.0056712674308983e-09, -1.46261587286034e-08, 7.2893873215296168e-07, 8.5682656310592797e-06, -8.294207002745857e-05, -0.0013211275411853796, 0.0043648098279840813, 0.052892259701993516, 0.43553025947652541},
+     {-8.347900148919507e-11, -5.11137119296734e-08, -4.4643193153337535e-07, 8.5633457572731331e-06, 0.00012217838788736168, -0.00066251512284705438, -0.010385370907072845, 0.022229793910637407, 0.62949468845943468}},
+    {2.2906379287057526, 18.32510342964602,
+     {-1.7879293601197332e-09, -4.4133467103080193e-08, 1.4443657558871337e-07, 1.1389398053396338e-05, 2.8901428834132714e-05, -0.0013304878577276025, -0.0040540211811016455, 0.050513192371467668, 0.54461156584982739},
+     {2.0261903266316494e-09, -2.0521671251216844e-08, -7.8149013393868927e-07, -4.0304842136018593e-07, 0.00013694142920189778, 0.00045190930531829876, -0.0099182421293331768, -0.020646960332899058, 0.630393446012119}},
+    {2.3973488113474462, 19.178790490779626,
+     {3.4630787126843643e-10, -4.134973830005606e-08, -4.5020700845110895e-07, 7.1249124578010026e-06, 0.00011288425767871924, -0.00058657924962150776, -0.009441720828718754, 0.020159005694074424, 0.61868943496419959},
+     {2.4425639288949696e-09, 1.8055336337141625e-08, -5.9487904080501863e-07, -8.1144475385097614e-06, 7.1027534838452588e-05, 0.0012072221152962803, -0.0039582115123582493, -0.048086289317275592, 0.55741650407072996}},
+    {2.4994997497897851, 19.995997998318273,
+     {1.9124755112898129e-09, -1.3295144318803409e-08, -7.0216108338794214e-07, -9.239609652933467e-07, 0.00012408446600109535, 0.00042661565364979226, -0.0090866738688513207, -0.018956341657712362, 0.61937228493173269},
+     {1.2414242966940492e-09, 4.0090488484523235e-08, -6.9519015766239534e-08, -1.0248243418720104e-05, -2.998370374049375e-05, 0.0012142665203129233, 0.0037220689805458063, -0.046278049998151952, 0.45787555543235603}},
+    {2.5976305339304915, 20.781044271443868,
+     {2.0506725206814735e-09, 1.9522764738155729e-08, -5.0451522015659833e-07, -7.6965442185605859e-06, 6.2725987916512072e-05, 0.0011184062735370426, -0.00364750895908552, -0.044390525239581882, 0.55218382146865508},
+     {-5.68407987344699e-10, 3.4736327592099769e-08, 4.4289884726378403e-07, -6.146723930233744e-06, -0.00010537685744793635, 0.00053127905626212946, 0.0087160592489840885, -0.018576610584495647, 0.38983101256229241}},
+    {2.6921820492952104, 21.537456394361708,
+     {8.9053564522600936e-10, 3.6812718873235895e-08, -2.2722970949295984e-08, -9.3839720740618304e-06, -3.0186860678516059e-05, 0.0011239600986553688, 0.0034602504215346039, -0.04295633214618079, 0.46004697910985271},
+     {-1.7927854756294437e-09, 8.6988203307214462e-09, 6.4144198541615793e-07, 1.2291423679422486e-06, -0.00011425039210005705, -0.00040445744681159856, 0.0084344560937501672, 0.01762291068599357, 0.38928953949729495}},
+    {2.7835199561360104, 22.268159649088041,
+     {-6.8993699642305728e-10, 2.9990326666506917e-08, 4.3155309303877232e-07, -5.4383469837437914e-06, -9.9165383029786724e-05, 0.00048882312342206358, 0.008135579728614159, -0.01731656926342505, 0.39676530192535375},
+     {-1.76522174655247e-09, -2.0082161045209546e-08, 4.3970870600151812e-07, 7.3238701726596744e-06, -5.6580599652023e-05, -0.0010466600229517842, 0.0034001004241972846, 0.041434167318595463, 0.45188092924393675}},
+    {2.8719515360844206, 22.975612288675375,
+     {-1.6822769843827245e-09, 5.5984008540121977e-09, 5.9331772439552566e-07, 1.4150899951270723e-06, -0.00010642057266829763, -0.00038508437635709214, 0.0079051695221375451, 0.016536341707733646, 0.39632233007174694},
+     {-6.5151040118394121e-10, -3.4129761905532519e-08, -8.1719951916525702e-09, 8.7018997705357037e-06, 2.9964494938999886e-05, -0.0010511865046044372, -0.0032469031015799274, 0.040260697772416296, 0.53805482456391063}},
+    {2.9577379737113252, 23.661903789690641,
+     {-1.5494219240963503e-09, -2.0187878480015797e-08, 3.9105369087355513e-07, 6.9936973635109645e-06, -5.1827333012594012e-05, -0.00098714149077153146, 0.0031970529306167353, 0.038999493126774774, 0.45514805871993397},
+     {7.5803185950462648e-10, -2.6432902311412931e-08, -4.18963901349656e-07, 4.9012237666179459e-06, 9.3922542326652092e-05, -0.00045496509871294222, -0.0076575325689334645, 0.016282456870452294, 0.59745245096725075}},
+    {3.0411035007422438, 24.328828005938018,
+     {-4.8128345753184476e-10, -3.1900842634158266e-08, -2.9404133128352328e-08, 8.1467750888131185e-06, 2.9531261793086516e-05, -0.00099092387426720496, -0.0030687065454968188, 0.038016293455737857, 0.5363856885924706},
+     {1.5840386780041626e-09, -3.4138474269695962e-09, -5.5410645427578231e-07, -1.5305120529829352e-06, 9.9998361080405607e-05, 0.00036806283084821201, -0.0074644817650569018, -0.015628794099865707, 0.59782356002931059}},
+    {3.1222423308264338, 24.977938646611342,
+     {7.9579587364264626e-10, -2.3674481708368944e-08, -4.0631203146457295e-07, 4.4794329130959376e-06, 8.9423682748834832e-05, -0.00042717948016993135, -0.0072549448287433371, 0.015413933407505836, 0.59253710422760597},
+     {1.3812919696931658e-09, 2.005678112482201e-08, -3.5321737512639118e-07, -6.7006256402879494e-06, 4.8026877689733016e-05, 0.00093673407912056583, -0.0030265187474273481, -0.036949130602639296, 0.54215602552150011}},
+    {3.2013240046861551, 25.610592037489276,
+     {1.4976238027486488e-09, -1.8222376940713048e-09, -5.2143971762674823e-07, -1.6020723410670179e-06, 9.4608616575092563e-05, 0.00035300314114783404, -0.007090142651530483, -0.014855953809934316, 0.59285388666521965},
+     {3.5580827173475882e-10, 3.0021091168563885e-08, 4.4436154200688804e-08, -7.6840527594157493e-06, -2.8996029388300704e-05, 0.00093995679634356621, 0.0029169597094301641, -0.036109800005883014, 0.46509259900974426}},
+    {3.278497569779665, 26.227980558237359,
+     {1.2470264820763077e-09, 1.9800223904908876e-08, -3.2296374929963179e-07, -6.4392236430177441e-06, 4.4908540484334125e-05, 0.00089332970484053142, -0.0028806542672646721, -0.035191549985947063, 0.539884705863797},
+     {-8.1549877961606398e-10, 2.1476870282199911e-08, 3.9410232510750376e-07, -4.1389620915599501e-06, -8.5509836227487535e-05, 0.00040386269808412312, 0.0069098446816468137, -0.014671051710341713, 0.41170707561031306}},
+    {3.3538948909590172, 26.831159127672123,
+     {2.6076252268580902e-10, 2.8413810859717614e-08, 5.5317455061043574e-08, -7.2909455990921579e-06, -2.8416665291630672e-05, 0.00089611878710363357, 0.0027857062681328898, -0.034464121248416954, 0.46641138854126185},
+     {-1.4216396948540932e-09, 6.3167071573388966e-10, 4.9372720589690999e-07, 1.6452984215598043e-06, -9.0002330155436461e-05, -0.00033958199758363228, 0.0067670143831026763, 0.01418748552252088, 0.41143254234125382}},
+    {3.427633303350194, 27.42106642680163,
+     {-8.2404794099488754e-10, 1.968689233855514e-08, 3.8253734990778554e-07, -3.857967510401128e-06, -8.2065332579678296e-05, 0.00038394344172548722, 0.0066097339900854785, -0.014026173559371708, 0.41541934995967694},
+     {-1.137565153186415e-09, -1.9478447743637162e-08, 2.982213304081327e-07, 6.204724540492812e-06, -4.2296273173203502e-05, -0.00085544496390266289, 0.002754032738402086, 0.033663098784782693, 0.46206140167279214}},
+    {3.4998177605352461, 27.998542084281841,
+     {-1.3545515820112541e-09, -2.7792368406664991e-10, 4.6986154966788263e-07, 1.669682945182327e-06, -8.6006981146607986e-05, -0.0003275374887787702, 0.0064843919477311981, 0.013601830307194314, 0.41517844068177345},
+     {-1.8713919303081639e-10, -2.702253176778413e-08, -6.3324093857453079e-08, 6.9517660521989377e-06, 2.7824829480938007e-05, -0.00085788989767109081, -0.0026707131355167141, 0.033024737004696436, 0.53240399795691618}},
+    {3.5705425906983637, 28.56434072558703,
+     {-1.0467626765375826e-09, -1.9125303785116898e-08, 2.7760556609024434e-07, 5.9931277590630216e-06, -4.007051136001305e-05, -0.00082200182258687637, 0.0026427639846959838, 0.032317955278760441, 0.46375221380532333},
+     {8.2553386349104585e-10, -1.8201870899403616e-08, -3.7167932387394131e-07, 3.6217920297842987e-06, 7.9003908329239314e-05, -0.00036667627161622585, -0.0063456156802991215, 0.013459486450181048, 0.58129821438511853}},
+    {3.639892944819378, 29.119143558554903,
+     {-1.2904033397376224e-10, -2.5805140468904142e-08, -6.9283931924957187e-08, 6.6553308826766688e-06, 2.7238046597349852e-05, -0.00082416815815011812, -0.002568878244571908, 0.031751856754955496, 0.53133313902992441},
+     {1.2950116534682365e-09, 9.8489727484718514e-10, -4.4904760920783104e-07, -1.6812602021132328e-06, 8.2498819253012945e-05, 0.00031665840973529868, -0.0062344624951307451, -0.013083189466424918, 0.58151184562483038}},
+    {3.7079460004743545, 29.663568003794911,
+     {8.2250739552591767e-10, -1.6950562731210539e-08, -3.615247087251916e-07, 3.4202397075633328e-06, 7.6259830213948332e-05, -0.0003515249394258485, -0.0061108258401586096, 0.012956367186042251, 0.57836891978984961},
+     {9.7030072865322836e-10, 1.8760262232575542e-08, -2.601573921845457e-07, -5.801125705084953e-06, 3.8147114189313047e-05, 0.00079219556022273874, -0.0025439767481813536, -0.031122180442092199, 0.53476154443807233}},
+    {3.7747719698529476, 30.198175758823474,
+     {1.24186616545785e-09, 1.5421828258865844e-09, -4.3069914534843434e-07, -1.6839902949317143e-06, 7.938649148114818e-05, 0.00030677389781477715, -0.006011372415620872, -0.012619685666670311, 0.57856005977815572},
+     {8.2466478090736928e-11, 2.4729717384985861e-08, 7.3752649654146296e-08, -6.3934332769077784e-06, -2.6665933564790079e-05, 0.00079413257347664412, 0.0024778694863140729, -0.03061566830992828, 0.4696405065414665}},
+    {3.8404349495696857, 30.723479596557507,
+     {9.0509466588173382e-10, 1.8394679557331983e-08, -2.4519232466602148e-07, -5.6259917651790836e-06, 3.646508574689511e-05, 0.0007654117238473368, -0.0024554993793144547, -0.030050028274334784, 0.53344210461292041},
+     {-8.1656015282760563e-10, 1.5882102299968892e-08, 3.5203990611520908e-07, -3.2460006382240003e-06, -7.3782056522087025e-05, 0.00033809283329304385, 0.0059003092542959656, -0.012505755646672053, 0.42426610813589094}},
+    {3.9049936416066613, 31.239949132853329,
+     {4.4658055031732147e-11, 2.3771712820419566e-08, 7.7113964103148191e-08, -6.1599014372637484e-06, -2.6113563964591524e-05, 0.00076715727524333255, 0.0023958952211356743, -0.029593334875771055, 0.47053042933817701},
+     {-1.1941696520523237e-09, -1.9866017719749607e-09, 4.1437408726530123e-07, 1.6805414299048138e-06, -7.6600912430141443e-05, -0.00029774482933953017, 0.0058106377152218683, 0.01220219416234666, 0.42409377153000516}},
+    {3.9685019685029528, 31.748015748023647,
+     {-8.0872197827375203e-10, 1.4959257610414056e-08, 3.4317898689462112e-07, -3.0936978763773659e-06, -7.1530292413995999e-05, 0.00032607965236898517, 0.0057101521990545745, -0.012099111001875155, 0.42665290005831202},
+     {-8.4888363005575229e-10, -1.8035172244523778e-08, 2.3220923106581637e-07, 5.465472652954606e-06, -3.4979082247615922e-05, -0.00074117196335035662, 0.0023756548900129154, 0.029081566344579587, 0.46773928405123089}},
+    {4.0310096011589902, 32.248076809271801,
+     {-1.1511049891055336e-09, -2.3444122199123285e-09, 3.9973235221868464e-07, 1.672751182124621e-06, -7.4088749491163508e-05, -0.00028945704191378485, 0.0056287577215008225, 0.011823573413737645, 0.42649647347223263},
+     {-1.3632206474767372e-11, -2.291195677628366e-08, -7.9639415617727138e-08, 5.9499957567044071e-06, 2.5583354654745705e-05, -0.00074275569172878309, -0.0023215532109919848, 0.028667027674194143, 0.52865228161402533}},
+    {4.0925624139678209, 32.740499311742667,
+     {-7.9992412693741244e-10, -1.7685500397490728e-08, 2.2083295680985771e-07, 5.3176969159740572e-06, -3.3654660026583016e-05, -0.00071909758661949097, 0.0023031249139588636, 0.028201089927349078, 0.46880492986935579},
+     {7.9968121013962445e-10, -1.4154166505520038e-08, -3.3489251127782893e-07, 2.9592880637641095e-06, 6.9472259249192536e-05, -0.00031525340084130604, -0.0055372710588005719, 0.011729718867147819, 0.57117197466384884}},
+    {4.1532028791440192, 33.225623033152132,
+     {1.2109424574191507e-11, -2.2135258070932196e-08, -8.1525303285978623e-08, 5.7600099468424482e-06, 2.5076155833386737e-05, -0.00072054307349435354, -0.0022537281499431863, 0.02782259689694443, 0.52789843771422273},
+     {1.1120109277840129e-09, 2.6347439785467941e-09, -3.8650784284222084e-07, -1.6619084380886662e-06, 7.1808092938913104e-05, 0.00028181609324429147, -0.0054629541261020514, -0.011478143214306177, 0.57131479740608959}},
+    {4.2129704098948313, 33.703763279158906,
+     {7.8993966923235348e-10, -1.3445608848527968e-08, -3.2713189834776557e-07, 2.839671849552694e-06, 6.7581762527774147e-05, -0.0003054317020776548, -0.0053791988452961126, 0.011392217966872561, 0.56917905182116291},
+     {7.5691986012316193e-10, 1.7347706160464327e-08, -2.1077735024022104e-07, -5.18110078906453e-06, 3.2465160920841507e-05, 0.00069888436990157843, -0.0022368567671486247, -0.027396034754714218, 0.53022756707100127}},
+    {4.2719016603202995, 34.175213282562204,
+     {1.0763732127827552e-09, 2.8718136757532875e-09, -3.7448920842120259e-07, -1.6489311470135881e-06, 6.9725495404793225e-05, 0.00027474322617423996, -0.0053109899721365053, -0.011161321414068781, 0.56931013452997514},
+     {-3.3635316754043743e-11, 2.1429449770238307e-08, 8.2915969645824816e-08, -5.5869996175017533e-06, -2.4591895824710441e-05, 0.00070021064512129638, 0.0021915203349347975, -0.027048649816113976, 0.47279963524353308}},
+    {4.3300307885309941, 34.640246308247669,
+     {7.1885297714402441e-10, 1.7022757203832839e-08, -2.0182036142291082e-07, -5.0543690833237953e-06, 3.1389611494597736e-05, 0.00068028473465471528, -0.0021759983476642639, -0.026656213096795431, 0.52934411652228686},
+     {-7.797900103412303e-10, 1.2817115591090555e-08, 3.1985128301492693e-07, -2.7324331398626001e-06, -6.58372976603816e-05, 0.00029646898499278984, 0.0052339352024498229, -0.011082268581639625, 0.43265570563453476}},
+    {4.3873896883522985, 35.099117506818381,
+     {-5.1753268337506597e-11, 2.0784672871698717e-08, 8.3919349247452146e-08, -5.4285928623998281e-06, -2.4129969742464619e-05, 0.00068150734812595648, 0.0021341948770508337, -0.026335896392616395, 0.47344839534825467},
+     {-1.043743313999812e-09, -3.0663509509309961e-09, 3.6350621679392958e-07, 1.6344813417168425e-06, -6.7813897105084564e-05, -0.00026817225570816006, 0.0051710411646885834, 0.010869365254463505, 0.43253483808168275}},
+    {4.4440081940817517, 35.552065552654156,
+     {-7.6944761673303219e-10, 1.2255767289914843e-08, 3.1300851077720182e-07, -2.6356603529120726e-06, -6.4221026115363067e-05, 0.00028824748458936011, 0.0050998387255315122, -0.010796315173937508, 0.4343521262377496},
+     {-6.8495920046984793e-10, -1.671097571431801e-08, 1.9378720383933512e-07, 4.9363884810360581e-06, -3.041127048589165e-05, -0.00066309487399190958, 0.0021198515273559912, 0.025973265347925593, 0.47146670901791915}},
+    {4.4999142620341441, 35.999314096273075,
+     {-1.0137100048268621e-09, -3.2265579097412456e-09, 3.5342008508632006e-07, 1.6190413900663003e-06, -6.6051140180323209e-05, -0.00026204715457582572, 0.005041603393275064, 0.010599183480273909, 0.4342402125632141},
+     {6.709566235940656e-11, -2.0192827854259576e-08, -8.4617270523779098e-08, 5.2828551605488272e-06, 2.3689476500915463e-05, -0.00066422667400130309, -0.0020811448097440288, 0.025676675236060358, 0.52594668363657937}},
+    {4.5551341320122738, 36.441073056098531,
+     {-6.5454797137931564e-10, -1.6412273984300896e-08, 1.8653823130598823e-07, 4.8262105086238627e-06, -2.9516601765089412e-05, -0.00064714528255042925, 0.0020678381318390351, 0.025340258765061831, 0.47221428523031439},
+     {7.5906525509594758e-10, -1.1751251749458902e-08, -3.065652853795342e-07, 2.5478208280360626e-06, 6.2718011193729772e-05, -0.00028067078652400934, -0.0049755481736303078, 0.010531413125842774, 0.5640732693554088}},
+    {4.6096924713518455, 36.877539770814586,
+     {8.0194073603934157e-11, -1.9647235394160134e-08, -8.5072612399095249e-08, 5.1481912849982159e-06, 2.3269364580552621e-05, -0.00064819699125777397, -0.0020318638127429442, 0.02506460396891182, 0.52538093088739435},
+     {9.8597885411777497e-10, 3.3588203329770749e-09, -3.4411655924770912e-07, -1.6029656584870544e-06, 6.4418884272776644e-05, 0.00025632016767146437, -0.0049214234810004767, -0.010348197423518012, 0.56417728266040168}},
+    {4.6636125037856413, 37.308900030285066,
+     {7.4875883271374732e-10, -1.1295254509491315e-08, -3.0048707533314456e-07, 2.4676710794757639e-06, 6.1315639426323676e-05, -0.00027365910921359204, -0.0048599238381124843, 0.010285100080351668, 0.56260659225277787},
+     {6.2711924542213637e-10, 1.6126314505982009e-08, -1.799607648456103e-07, -4.7230222039451597e-06, 2.8694534249723569e-05, 0.00063229367539405223, -0.0020194746784489084, -0.024751388859807742, 0.52709361546783484}},
+    {4.716916125037999, 37.735329000304077,
+     {9.6028829332794885e-10, 3.4681408855874452e-09, -3.355005611105355e-07, -1.5865160021832914e-06, 6.2901801262588153e-05, 0.00025095032827436581, -0.0048094479286191344, -0.01011423665540433, 0.56270359295549843},
+     {-9.1411322955536889e-11, 1.9142282647877096e-08, 8.5334084132249188e-08, -5.0232726120369442e-06, -2.2868521541763442e-05, 0.00063327432110386883, 0.0019859257233484709, -0.02449431716359135, 0.47514966449210411}},
+    {4.7696240067826441, 38.156992054261515,
+     {6.0226845732813672e-10, 1.5852646306768747e-08, -1.7396281115633627e-07, -4.6261227629740276e-06, 2.7935918767429957e-05, 0.00061841961500325171, -0.0019743533264500734, -0.02420175378352063, 0.52645048924235149},
+     {-7.3860517701973549e-10, 1.0881012091346065e-08, 2.9474284413133489e-07, -2.3941914233382988e-06, -6.0003176672374092e-05, 0.00026714579760711565, 0.0047520032432465664, -0.010055298921663625, 0.43876392945820081}},
+    {4.8217556903645242, 38.574045522915632,
+     {-1.010485028984931e-10, 1.8673289803317061e-08, 8.543988405662617e-08, -4.9069827425807233e-06, -2.2485828781171335e-05, 0.00061933686161576296, 0.001942968925329476, -0.0239612670563813, 0.47564856709560821},
+     {-9.3641849829850798e-10, -3.5584983848480078e-09, 3.2749230605144675e-07, 1.569886695307332e-06, -6.1486968243595896e-05, -0.000245902281427679, 0.0047047837848154042, 0.0098954594795846035, 0.4386731872483261}},
+    {4.8733296714913426, 38.986637371931316,
+     {-7.2863670652623114e-10, 1.0502957170643867e-08, 2.8930472140142882e-07, -2.326537545727092e-06, -5.8771423449621718e-05, 0.00026107467793143324, 0.004650967214328415, -0.0098402435920820347, 0.44004834771079526},
+     {-5.7964699706758438e-10, -1.5590714497193403e-08, 1.6846850858787121e-07, 4.5349046550180461e-06, -2.7233123344017063e-05, -0.00060542037984562258, 0.0019321273112230114, 0.023687181513681516, 0.47414915251829409}},
+    {4.9243634769360938, 39.394907815488416,
+     {-9.1414786851373719e-10, -3.6330662922523516e-09, 3.2002423666632751e-07, 1.5532220701830468e-06, -6.0163403428070694e-05, -0.00024114534360453188, 0.0046066684983593273, 0.0096902915671154416, 0.43996321873640704},
+     {1.0934764205217107e-10, -1.8236263388260454e-08, -8.5420214679388096e-08, 4.7983758419412048e-06, 2.2120194251268321e-05, -0.0006062807811796217, -0.0019026842999185223, 0.023461570005765438, 0.52388121382378594}},
+    {4.9748737341529168, 39.798989873223334,
+     {-5.5895421624541086e-10, -1.5339914005707556e-08, 1.6341475717052134e-07, 4.4488385019803012e-06, -2.657972728420388e-05, -0.00059320774928563191, 0.0018924996661736845, 0.023204095832166375, 0.47470997754083871},
+     {7.1887518160451691e-10, -1.0156462781907294e-08, -2.8414771202633915e-07, 2.2640041513199982e-06, 5.761244435797952e-05, -0.00025539803470393807, -0.004556113562571934, 0.0096384216531269218, 0.55874469578484653}},
+    {5.0248762345905194, 40.199009876724375,
+     {1.1654721632226028e-10, -1.7827806564341131e-08, -8.5299214469536366e-08, 4.6966446806129269e-06, 2.1770571354107204e-05, -0.00059401694773489333, -0.0018648058165590259, 0.022991886781828941, 0.52343705099611149},
+     {8.9331875230413971e-10, 3.6944185488607673e-09, -3.1303882808142447e-07, -1.5366293033003409e-06, 5.8921707007997259e-05, 0.00023665274564618755, -0.004514446412993145, -0.0094973780354802445, 0.5588247673307839}},
+    {5.0743859913869116, 40.59508793109535,
+     {7.0936057028347932e-10, -9.8376555790480325e-09, -2.792494233627707e-07, 2.2059973215360351e-06, 5.6519353530126715e-05, -0.00025007504441756923, -0.0044668364452042156, 0.0094485293000377314, 0.55760772526649049},
+     {5.3995785620486458e-10, 1.5099675954033387e-08, -1.5874865766374313e-07, -4.3674608702914952e-06, 2.5970286843146617e-05, 0.0005817054739504085, -0.0018552143898332291, -0.022749411207093884, 0.52476401647180115}},
+    {5.1234172920431424, 40.987338336344649,
+     {8.7380058744201961e-10, 3.7446543643682162e-09, -3.0648671633937141e-07, -1.5201876762960254e-06, 5.7753779895947099e-05, 0.00023240101876931263, -0.0044275502417304713, -0.0093155456238799596, 0.5576832210767525},
+     {-1.2280487737825752e-10, 1.7444978128722255e-08, 8.5096199309298015e-08, -4.6010955889186356e-06, -2.1435968926397653e-05, 0.00058246835727554513, 0.0018291031060317445, -0.022549328215693769, 0.47698336044597694}},
+    {5.1719837466000662, 41.375869972800615,
+     {5.2246873494254942e-10, 1.4869415920770734e-08, -1.5442553258360192e-07, -4.2903640994906844e-06, 2.5400153693011518e-05, 0.00057084726520446882, -0.0018200494553845745, -0.022320449488802199, 0.52426938344022078},
+     {-7.0010841568546311e-10, 9.5432730606859195e-09, 2.7458972040594887e-07, -2.1520132346131149e-06, -5.5486142896910007e-05, 0.00024507054907262071, 0.0043826100087736297, -0.0092694357595284604, 0.44346576361128798}},
+    {5.2200983317786953, 41.760786654229705,
+     {-1.2823608841472378e-10, 1.7085263648297655e-08, 8.4826748736333002e-08, -4.5111288561883178e-06, -2.1115455743458966e-05, 0.00057156809164671252, 0.0017953755405663505, -0.02213138009477968, 0.47738205168685871},
+     {-8.5545970307521202e-10, -3.7854861467678802e-09, 3.0032526010526084e-07, 1.5039553692974827e-06, -5.6652601272660918e-05, -0.00022836949316359934, 0.0043454863200867375, 0.0091437725434910314, 0.44339442371786481}},
+    {5.2677734314899691, 42.142187451919511,
+     {-6.9110406286654325e-10, 9.2705487730881941e-09, 2.7015045012124261e-07, -2.1016215995817156e-06, -5.4507543524373592e-05, 0.00024035408584335838, 0.0043029753032735804, -0.0091001548421152344, 0.44448146009680461},
+     {-5.0630655223926624e-10, -1.4648559698571262e-08, 1.5040734424598412e-07, 4.2171880736963097e-06, -2.4865332674955942e-05, -0.00056057518248545102, 0.0017868112249730672, 0.021914873264103497, 0.47619686495460795}},
+    {5.3150208740724185, 42.520166992579568,
+     {-8.3818418872283473e-10, -3.8183367578881189e-09, 2.945174378821136e-07, 1.4879745593443516e-06, -5.5612050886055808e-05, -0.0002245398858747305, 0.0042678227597260296, 0.0089811642276015416, 0.44441390831834737},
+     {1.3295764489384965e-10, -1.674646066263108e-08, -8.4503561148530082e-08, 4.4262229124125696e-06, 2.0808161562080318e-05, -0.00056125768132687937, -0.0017634474724056506, 0.021735842829844379, 0.52223917967575162}},
+    {5.3618519665750792, 42.894815732600911,
+     {-4.9130388646290157e-10, -1.4436597695066666e-08, 1.4666151659792348e-07, 4.1476134474693893e-06, -2.4362369290098496e-05, -0.00055083832866746618, 0.0017553299469265857, 0.021530632069854054, 0.47663733437470029},
+     {6.8236083450301521e-10, -9.0171314859333052e-09, -2.6591529123098923e-07, 2.0544526206367486e-06, 5.3578912833585068e-05, -0.00023589911206951808, -0.0042275297212084756, 0.0089398220096296339, 0.55455563499386817}},
+    {5.4082775263673053, 43.266220210938279,
+     {1.3708278956414688e-10, -1.6426642934774804e-08, -8.4137014022545031e-08, 4.3459217772823244e-06, 2.051327592944574e-05, -0.00055148578183526753, -0.0017331643720573733, 0.021360782578563907, 0.52187873642876281},
+     {8.2185946936874643e-10, 3.8443754846184675e-09, -2.890308926639662e-07, -1.4722751963125447e-06, 5.4626765839199676e-05, 0.00022089595993809996, -0.0041941798515936907, -0.0088269336640034307, 0.55461972244559432}},
+    {5.454307910325884, 43.634463282606916,
+     {6.7386229929411456e-10, -8.7809668425364862e-09, -2.6186944546147117e-07, 2.0101865641497518e-06, 5.2696142057745421e-05, -0.00023168238077149461, -0.0041559184052716233, 0.0087876757372299281, 0.55364110584565396},
+     {4.7736392616570811e-10, 1.4232986789153301e-08, -1.4316007812542608e-07, -4.0813558040420084e-06, 2.3888259884308205e-05, 0.00054159178615381665, -0.0017254560961988685, -0.021165918632660308, 0.52294569156550219}},
+    {5.4999530418226463, 43.999624334581036,
+     {8.0642914568329616e-10, 3.8646050803947674e-09, -2.8383731398573531e-07, -1.4568779368451246e-06, 5.369202433017084e-05, 0.00021742324079489228, -0.0041242222305392512, -0.0086803853202732512, 0.55370201529327301},
+     {-1.4069101439417864e-10, 1.6124144242013472e-08, 8.3735607558921288e-08, -4.2698249034800462e-06, -2.0230045804453534e-05, 0.00054220709503959019, 0.0017043896720514221, -0.021004491340251331, 0.4784648059097627}},
+    {5.5452224357118265, 44.361779485695195,
+     {4.6436676726102633e-10, 1.4037275342104749e-08, -1.3987873470622247e-07, -4.0181611113965232e-06, 2.3440379193634397e-05, 0.0005327957431414676, -0.0016970573775353451, -0.020819132998271424, 0.52255020199698921},
+     {-6.656386553061111e-10, 8.5603111266152609e-09, 2.5799961200778654e-07, -1.9685456069118423e-06, -5.1855579997622803e-05, 0.00022768343351697862, 0.0040878272051837958, -0.0086430422507402516, 0.44722896342304708}},
+    {5.5901252214954669, 44.721001771963195,
+     {-1.4384138324885498e-10, 1.5837456679435036e-08, 8.3306346376765816e-08, -4.1975786917447522e-06, -1.9957772454726186e-05, 0.00053338148344166114, 0.0016770021687176132, -0.020665454138411348, 0.47879272225009317},
+     {-7.918221633929079e-10, -3.8798391166494639e-09, 2.7891171294758266e-07, 1.4417962140855778e-06, -5.2803650371274768e-05, -0.00021410877893915381, 0.0040576524316251611, 0.0085409019111444585, 0.44717097772704961}},
+    {5.6346701648266464, 45.077361318612915,
+     {-6.5764460543960013e-10, 8.3536382255999797e-09, 2.5429360928086453e-07, -1.929287056001705e-06, -5.1053969486875017e-05, 0.00022388418526923803, 0.0040229768640126853, -0.0085053229398732132, 0.44805805919391944},
+     {-4.5222803279898471e-10, -1.3849000835008951e-08, 1.3679637600461092e-07, 3.9578015449959203e-06, -2.3016421671878673e-05, -0.00052441477085266031, 0.0016700162540762009, 0.02048885292280447, 0.47782558160484118}},
+    {5.6788656874940351, 45.430925499952991,
+     {-7.7794615194193284e-10, -3.8907757016204414e-09, 2.742319323845166e-07, 1.4270379928293941e-06, -5.1957935307073155e-05, -0.00021094095037287042, 0.0039942055551255018, 0.0084079334326127055, 0.44800277059197019},
+     {1.4657608460311167e-10, -1.5565284616769759e-08, -8.2854972216495071e-08, 4.1288698094388288e-06, 1.9695807934538845e-05, -0.00052497323821357189, -0.0016508938690092678, 0.020342321849818313, 0.52089384257173299}},
+    {5.7227198860168595, 45.781759088134599,
+     {-4.4084824679657686e-10, -1.3667745601964043e-08, 1.3389452224732423e-07, 3.9000722264481702e-06, -2.2614353463984438e-05, -0.00051641722212730778, 0.0016442278958664555, 0.020173809273631445, 0.47818323875526347},
+     {6.4988592285430968e-10, -8.1596236434222646e-09, -2.5074044418538222e-07, 1.8921979477171114e-06, 5.0288394473185782e-05, -0.00022026858231082025, -0.003961118188150127, 0.0083739839100203245, 0.55115070296888014}},
+    {5.7662405489665707, 46.129924391732516,
+     {1.4897283406867246e-10, -1.5306470091402957e-08, -8.2386336308637453e-08, 4.0634193911315286e-06, 1.9443551672937431e-05, -0.00051695047008309958, -0.0016259681950774457, 0.020033888566670436, 0.52059385729784147},
+     {7.6474782062518898e-10, 3.8980187966330959e-09, -2.6977831102392713e-07, -1.4126070421727199e-06, 5.1151572693169944e-05, 0.00020790928786137974, -0.0039336448215949171, -0.0082809880176989113, 0.5512034972743487}},
+    {5.8094351731202067, 46.475481384961363,
+     {6.4236438390707917e-10, -7.9770934302558771e-09, -2.4733009418298479e-07, 1.8570905431780638e-06, 4.9556235418440897e-05, -0.00021682231842373723, -0.003902028010097966, 0.0082485472560254458, 0.55039452914025766},
+     {4.301567990694366e-10, 1.3493106187922876e-08, -1.3115695529641869e-07, -3.8447882948489109e-06, 2.2232372839048331e-05, 0.00050877472779098376, -0.0016195984664500243, -0.019872865468034753, 0.52147582235787648}},
+    {5.8523109785403324, 46.818487828323249,
+     {7.5219075412746861e-10, 3.9020631170672004e-09, -2.6553334320222888e-07, -1.3985038914143821e-06, 5.0381603951404896e-05, 0.0002050043376062155, -0.003875757846680393, -0.0081596242667216629, 0.55044501122190126},
+     {-1.51071155585214e-10, 1.5059937075179164e-08, 8.1904427906565047e-08, -4.0009783023875478e-06, -1.9200446862155385e-05, 0.00050928459966026463, 0.0016021384782975989, -0.019739072624326059, 0.47969360977397396}},
+    {5.8948749226674906, 47.158999381339534,
+     {4.2011460976709714e-10, 1.3324721548357843e-08, -1.2856940090344438e-07, -3.7917825286282181e-06, 2.1868877431330258e-05, 0.00050146177272021586, -0.0015960436836471512, -0.019585000189036309, 0.52115034174833186},
+     {-6.350764358842298e-10, 7.8050146345987059e-09, 2.4405341092492705e-07, -1.8237986916247451e-06, -4.885513167324218e-05, 0.00021353259806682068, 0.0038455057947381771, -0.008128583732301721, 0.4503290944062121}},
+    {5.9371337135030542, 47.497069708024789,
+     {-1.5288836863192046e-10, 1.4824756755515978e-08, 8.1412542041192637e-08, -3.9413232654772479e-06, -1.8965977096940811e-05, 0.00050194992847352182, 0.0015793266892412949, -0.019456900613182955, 0.47996940276345612},
+     {-7.4021011542413362e-10, -3.9033347665196061e-09, 2.6148128606795495e-07, 1.3847266110422751e-06, -4.964537263471569e-05, -0.00020221753693235034, 0.0038203535018484086, 0.008043444779065264, 0.45028076055475774}},
+    {5.9790938219532457, 47.83275057562571,
+     {-6.279949893439607e-10, 7.6424961914511869e-09, 2.4090199712833993e-07, -1.7921748230453893e-06, -4.8182949487912685e-05, 0.00021038793758669516, 0.0037913707712548261, -0.0080137065626722064, 0.45102243629864835},
+     {-4.106501805267726e-10, -1.3162257506138531e-08, 1.2611917188376509e-07, 3.7409032326296554e-06, -2.1522436918691712e-05, -0.00049445533699321587, 0.0015734876041351223, 0.019309292778426981, 0.47916081179724851}},
+    {6.0207614933986431, 48.166091947188988,
+     {-7.2877703871654376e-10, -3.9022254316734006e-09, 2.576080704308481e-07, 1.3712714679869897e-06, -4.8940485991993965e-05, -0.00019954110953136761, 0.0037672592551859299, 0.0079320906701747414, 0.45097610251834508},
+     {1.5445333900743208e-10, -1.4600145759047223e-08, -8.091344905203357e-08, 3.8842535858840677e-06, 1.8739663202649304e-05, -0.0004949232761147504, -0.001557462361089515, 0.019186493835397524, 0.51976571152523299}},
+    {6.0621427585477523, 48.497142068382587,
+     {-4.0169734205619534e-10, -1.3005387655695699e-08, 1.2379497860148803e-07, 3.6920123916983627e-06, -2.1191770111117503e-05, -0.00048773459065939995, 0.0015518615917892928, 0.019044910830335181, 0.47945865712856023},
+     {6.2111693566180293e-10, -7.488729414362183e-09, -2.3786819447479957e-07, 1.7620873142831783e-06, 4.7537754763765649e-05, -0.00020737799738038132, -0.0037394594971388792, 0.0079035661862367976, 0.54831245005816975}},
+    {6.1032434436280827, 48.825947549024356,
+     {1.5579892931327777e-10, -1.4385279412110208e-08, -8.0409462532848863e-08, 3.8295880028793583e-06, 1.8521060222376207e-05, -0.00048818367149160158, -0.0015364816726018624, 0.018927056776498905, 0.51951103476420224},
+     {7.1783023969373971e-10, 3.8990253248272211e-09, -2.5390095403921009e-07, -1.3581332626855236e-06, 4.8264782171902887e-05, 0.0001969679752196335, -0.0037163189077929065, -0.0078252369011712654, 0.54835691800477004}},
+    {6.144069179963461, 49.152553439708093,
+     {6.1444094257012694e-10, -7.3429944347225273e-09, -2.3494496315112912e-07, 1.7334184037043343e-06, 4.6917789643857732e-05, -0.00020449343962314348, -0.0036896237793825337, 0.0077978457764939155, 0.54767370093862966},
+     {3.9322900491356449e-10, 1.2853804909340738e-08, -1.2158682416441025e-07, -3.6449841754881973e-06, 2.0875725721958283e-05, 0.00048128063301579316, -0.0015311034378791902, -0.018791099603994724, 0.52025588534011769}},
+    {6.1846254129822018, 49.477003303856847,
+     {7.0735772794705554e-10, 3.8940242141904946e-09, -2.5034847406235627e-07, -1.3453058508305915e-06, 4.7616302390168785e-05, 0.00019449167212115537, -0.0036673906580937179, -0.0077225882825144587, 0.5477164250053026},
+     {-1.5699397337698429e-10, 1.4179518004198144e-08, 7.9902625182981524e-08, -3.7771627068305946e-06, -1.8309754748063733e-05, 0.00048171208946691524, 0.0015163266634642888, -0.018677867247026612, 0.48073407053769474}},
+    {6.2249174106969134, 49.799339285575421,
+     {3.8520919787288221e-10, 1.2707244589904576e-08, -1.1948571820852294e-07, -3.5997036193502474e-06, 2.057326591461961e-05, 0.0004750762687928678, -0.0015111566073281665, -0.018547172948592854, 0.51998198175188892},
+     {-6.0797722412075927e-10, 7.2046555388283195e-09, 2.3212586541809799e-07, -1.7060624000753144e-06, -4.6321452447622979e-05, 0.00020172580698547826, 0.0036417288925928507, -0.0076962574026960516, 0.45294037963960798}},
+    {6.2649502716933334, 50.119602173546468,
+     {-1.5798518049336963e-10, 1.398222715387476e-08, 7.9394413599054303e-08, -3.7268289905800778e-06, -1.8105362105974576e-05, 0.00047549122457948845, 0.0014969445598986206, -0.018438267915530968, 0.48097018766163258},
+     {-6.9733419039152977e-10, -3.8874607977135156e-09, 2.4694024414184668e-07, 1.3327823292219598e-06, -4.699326707588436e-05, -0.00019210628908315763, 0.0036203454393658671, 0.007623876039652859, 0.45289928837437221}},
+    {6.3047289326625133, 50.437831461299943,
+     {-6.0168181548192479e-10, 7.0731374091081989e-09, 2.2940488153544436e-07, -1.6799241476794791e-06, -4.5747280211561048e-05, 0.00019906741881858814, 0.0035956520451319932, -0.0075985387274346665, 0.45353133883019936},
+     {-3.7760639060024914e-10, -1.2565451790180759e-08, 1.1748359740604286e-07, 3.5560654144117798e-06, -2.0283452454916695e-05, -0.0004691058152794525, 0.0014919695903043012, 0.018312505491461611, 0.48028112536743428}},
+    {6.3442581755078429, 50.75406540406339,
+     {-6.8769523409173416e-10, -3.8795329171392723e-09, 2.4366674555853507e-07, 1.3205552628625661e-06, -4.6394055261411715e-05, -0.00018980640691887429, 0.0035750654859988337, 0.0075288548496014081, 0.453491778947268},
+     {1.588444931144295e-10, -1.3792853525984583e-08, -7.8886297050217991e-08, 3.6784516209142915e-06, 1.7907524334365155e-05, -0.0004695052962759988, -0.0014782871928644206, 0.018207659006707611, 0.51880214855282025}},
+    {6.3835426340558881, 51.068341072447154,
+     {-3.7039038502939547e-10, -1.2428170270695205e-08, 1.155732297641876e-07, 3.5139728649657975e-06, -2.0005434842568226e-05, -0.00046335493543064876, 0.0014734953421333546, 0.018086525886857472, 0.48053412586157973},
+     {5.9554849940468557e-10, -6.9479284547924181e-09, -2.2677650912683589e-07, 1.6549177295210882e-06, 4.5193933678661091e-05, -0.00019651128187937739, -0.0035512810535243064, 0.0075044501540964745, 0.54589940866905073}},
+    {6.4225868003977062, 51.380694403181025,
+     {1.595665821696457e-10, -1.3610890636783779e-08, -7.8379356338587058e-08, 3.6319072709289912e-06, 1.7715907756482574e-05, -0.00046373988037308467, -0.0014603104939832703, 0.017985491979777425, 0.51858244666984965},
+     {6.7843819451240961e-10, 3.8704273119805066e-09, -2.4051941105440733e-07, -1.3086169171061535e-06, 4.5817186966778944e-05, 0.00018758704714511021, -0.0035314430922693124, -0.0074373002739948658, 0.54593752998324641}},
+    {6.4613950308852122, 51.691160247081918,
+     {5.8961058257978038e-10, -6.8285674892365478e-09, -2.2423573298180344e-07, 1.6309653548263192e-06, 4.4660184196687602e-05, -0.00019405101329221519, -0.0035085131925076327, 0.0074137723535335834, 0.54535056639126644},
+     {3.634883505299058e-10, 1.2295180207289036e-08, -1.1374796016205835e-07, -3.4733370628536875e-06, 1.9738439957645015e-05, 0.00045781049299618848, -0.0014556907976209649, -0.017868710959284408, 0.51922235049747589}},
+    {6.4999715518052543, 51.999772414441644,
+     {6.695382026578045e-10, 3.8602923080333085e-09, -2.3749036681675051e-07, -1.2969593328748807e-06, 4.5261307733357459e-05, 0.00018544362702867245, -0.0034893795337351055, -0.0073490065273890091, 0.54538733426133756},
+     {-1.6016565851373343e-10, 1.3435841106357316e-08, 7.7874538040312302e-08, -3.5870831638917799e-06, -1.7530201158161285e-05, 0.00045818176275273792, 0.00144297405737321, -0.017771264035305056, 0.48162974575649325}},
+    {6.5383204647523243, 52.306563718019596,
+     {3.5694469602276513e-10, 1.2166266882829291e-08, -1.1200200211725075e-07, -3.4340760875495313e-06, 1.9481763533280017e-05, 0.00045246042625157745, -0.0014385164485141919, -0.017658580604549962, 0.51898772745690669},
+     {-5.8382587653227347e-10, 6.7146248561300581e-09, 2.2177777370124829e-07, -1.607996391761457e-06, -4.4144902134335418e-05, 0.00019168077378574344, 0.0034672541938333967, -0.0073263041117660188, 0.45517905630162797}},
+    {6.5764457517192305, 52.611566013753162,
+     {-1.606639266071852e-10, 1.3267335008393388e-08, 7.7372662499186617e-08, -3.5438761264439123e-06, -1.7350113992981031e-05, 0.00045281881197405116, 0.0014262407573753452, -0.017564513325131089, 0.48183484606120658},
+     {-6.60994814438709e-10, -3.8492822262981008e-09, 2.3457244602287375e-07, 1.2855745065154522e-06, -4.4725175313953258e-05, -0.00018337192015507875, 0.0034487841267206443, 0.0072637845302941581, 0.45514356363998815}},
+    {6.6143512799236301, 52.914810239389418,
+     {-5.7820015442189288e-10, 6.6057308512057489e-09, 2.193983051901327e-07, -1.5859466057643878e-06, -4.3647047005768158e-05, 0.00018939520967165002, 0.0034274173716816042, -0.0072418604506022562, 0.45569055506787176},
+     {-3.506923640372861e-10, -1.2041232011483771e-08, 1.1032987523584836e-07, 3.3961142957283919e-06, -1.9234762213188317e-05, -0.00044729363753730211, 0.0014219359744132853, 0.017455693335349135, 0.48123852341781992}},
+    {6.6520408063869834, 53.216326451095405,
+     {-6.5274186056285544e-10, -3.8375007616053836e-09, 2.317589784528451e-07, 1.2744543639309214e-06, -4.4207647953542484e-05, -0.00018136802160692578, 0.0034095734054336788, 0.0071814602049501512, 0.45565626556729294},
+     {1.6105605737948281e-10, -1.310494690542896e-08, -7.6874350218858467e-08, 3.5021913007415861e-06, 1.717537464857033e-05, -0.00044763986772303199, -0.001410076413894179, 0.017364814761461018, 0.51796676011291931}},
+    {6.6895179822812683, 53.516143858250032,
+     {-3.4472069643243231e-10, -1.1919901510282216e-08, 1.0872672395745298e-07, 3.3593817521104796e-06, -1.8996847213986756e-05, -0.00044229989643145007, 0.0014059159195598803, 0.017259642377274762, 0.48145688771967821},
+     {5.727200935723431e-10, -6.5015455241734799e-09, -2.1709325648266997e-07, 1.5647573945454241e-06, 4.3165658512422933e-05, -0.000187189402149332, -0.0033889228560812154, 0.0071602709812019667, 0.54381505989365619}},
+    {6.7267863570576951, 53.814290856461895,
+     {1.613549294177119e-10, -1.294831064591051e-08, -7.638013854727177e-08, 3.4619414590042474e-06, 1.7005729022412375e-05, -0.00044263464315440204, -0.0013944494985985226, 0.017171776338519469, 0.51777471579380208},
+     {6.4477756467340441e-10, 3.8250573819453848e-09, -2.2904392549261132e-07, -1.2635909260594325e-06, 4.3707674236753702e-05, 0.00017942831729457487, -0.0033716703997217559, -0.0071018729788974722, 0.54384821270765571}},
+    {6.763849382370644, 54.110795058965294,
+     {5.6738302944836505e-10, -6.4017469103561098e-09, -2.1485885892680301e-07, 1.544375162865208e-06, 4.2699848821603492e-05, -0.00018505882295467846, -0.0033516969190117568, 0.0070813784572071985, 0.54333685546346533},
+     {3.3900038332035365e-10, 1.1802090194024117e-08, -1.0718805931730913e-07, -3.3238136364910353e-06, 1.8767478389331016e-05, 0.00043746975449332481, -0.0013904254086961471, -0.017070052236613512, 0.5183321874411333}},
+    {6.8007104158090979, 54.405683326473337,
+     {6.3710547948403473e-10, 3.8120491208104568e-09, -2.2642172881059963e-07, -1.2529763280255679e-06, 4.3224284070192409e-05, 0.00017754945673523204, -0.0033350039992400202, -0.0070248744670318303, 0.543368933034726},
+     {-1.6160850435653629e-10, 1.2797119808283242e-08, 7.5890552508894871e-08, -3.4230462638840109e-06, -1.6840939204149086e-05, 0.00043779363895181389, 0.0013793308761515521, -0.016985035894302444, 0.4824113099975082}},
+    {6.8373727244469862, 54.698981795575648,
+     {3.3353853012840773e-10, 1.1687635526058671e-08, -1.0570984643187842e-07, -3.2893498211339356e-06, 1.8546159308213683e-05, 0.00043279447008097438, -0.0013754358967014366, -0.016886575674015594, 0.51812828960782076},
+     {-5.6219917610178527e-10, 6.3060507926593345e-09, 2.1269162819859133e-07, -1.5247508308169344e-06, -4.2248795692478858e-05, 0.00018299929543398596, 0.003315671380186215, -0.0070050374994806638, 0.45712603179598132}},
+    {6.8738394882230773, 54.990715905784484,
+     {-1.6175594197420651e-10, 1.2651040881550557e-08, 7.5405823030116892e-08, -3.3854314442360867e-06, -1.6680782040368047e-05, 0.00043310806739260688, 0.0013646935756051123, -0.016804258251484835, 0.48259162462566785},
+     {-6.2971139414003119e-10, -3.7985505851878543e-09, 2.2388724119082326e-07, 1.2426028203615935e-06, -4.2756580774044872e-05, -0.00017572832885022482, 0.0032995083920779669, 0.0069503273075138608, 0.45709497257513748}},
+    {6.9101138031603098, 55.280910425282897,
+     {-5.5713345048502561e-10, 6.2141936041371082e-09, 2.1058825394604241e-07, -1.5058393477151988e-06, -4.1811736352093121e-05, 0.00018100696023568008, 0.0032807830816213024, -0.0069311134688954598, 0.4575744021884296},
+     {-3.2829783336296714e-10, -1.1576383407430058e-08, 1.0428830188313754e-07, 3.2559344333993323e-06, -1.8332432724865733e-05, -0.0004282659417992607, 0.0013609209472334877, 0.016708891028491161, 0.48206896239724983}},
+    {6.9461986844337842, 55.569589475469762,
+     {-6.2254423838226103e-10, -3.784636604109437e-09, 2.214356338292589e-07, 1.2324628378967972e-06, -4.2303734052423492e-05, -0.00017396204047220865, 0.0032651225677331128, 0.0068781041307643676, 0.45754430855269024},
+     {1.6185586204642277e-10, -1.2509817404193768e-08, -7.492635167860584e-08, 3.3490283852799507e-06, 1.6525048276955223e-05, -0.00042856978533696577, -0.0013505125880149682, 0.016629132686159506, 0.51723348604032982}},
+    {6.9820970692960298, 55.856776554368132,
+     {-3.2327207577509398e-10, -1.1468196836617039e-08, 1.0292003993495058e-07, 3.2235154703297297e-06, -1.8125876840913158e-05, -0.0004238766494190499, 0.0013468560366059271, 0.01653669984478786, 0.48225992145417873},
+     {5.5219295802544366e-10, -6.1259479711139875e-09, -2.0854569549033641e-07, 1.4875992907503743e-06, 4.1387962093547559e-05, -0.00017907824498700209, -0.0032469734217618965, 0.0068594814672732068, 0.54199100130445388}},
+    {7.0178118198675721, 56.142494558940861,
+     {1.6188206330980393e-10, -1.2373183366776175e-08, -7.4452290999005299e-08, 3.3137734607446845e-06, 1.6373541245617851e-05, -0.00042417123462436257, -0.0013367646866192032, 0.016459370680842755, 0.51706375573583119},
+     {6.156124499057114e-10, 3.7703720145998432e-09, -2.1906254121795143e-07, -1.2225490117478977e-06, 4.1864973902322467e-05, 0.00017224789713872479, -0.0032317898759350316, -0.0068080866439196135, 0.54202017837048966}},
+    {7.0533457258003098, 56.426765806401775,
+     {5.4738658050723643e-10, -6.0410907387620227e-09, -2.0656111876515837e-07, 1.4699924671957021e-06, 4.0976813458243333e-05, -0.00017720983744695662, -0.0032141879413852478, 0.0067900254496213591, 0.54156948785192094},
+     {3.1843816472587605e-10, 1.1362955243399142e-08, -1.0160188335106568e-07, -3.1920444873989595e-06, 1.7926101728266142e-05, 0.00041961960139166865, -0.001333218379431525, -0.016369724764353773, 0.51755508521264593}},
+    {7.088701506820712, 56.709612054566392,
+     {6.0891114372907396e-10, 3.7558169907470074e-09, -2.1676388217706233e-07, -1.2128541801992299e-06, 4.1439585020952574e-05, 0.00017058338590383859, -0.0031994576339933536, -0.0067401648157675818, 0.54159779394956453},
+     {-1.6188783646953198e-10, 1.2240903846105766e-08, 7.3983917547870703e-08, -3.2796076377961114e-06, -1.6226076158698532e-05, 0.00041990538915456788, 0.0013234282668482394, -0.016294703924802836, 0.48310106389170299}},
+    {7.1238818151593986, 56.991054521274215,
+     {3.1379432385847394e-10, 1.1260489651832017e-08, -1.0033094000050369e-07, -3.1614761694109816e-06, 1.7732746388027243e-05, 0.00041548828792604964, -0.0013199867733639375, -0.016207707645914299, 0.51737575368773336},
+     {-5.4270321570015767e-10, 5.9593978640748446e-09, 2.0463183669772178e-07, -1.4529835888343889e-06, -4.0577675890274278e-05, 0.00017539866165638962, 0.0031823759545685157, -0.0067226374332917428, 0.45883958583823797}},
+    {7.1588892378732556, 57.271113902987111,
+     {-1.6182077899884462e-10, 1.2112720160217805e-08, 7.3521271404253241e-08, -3.2464759743278115e-06, -1.6082479028567409e-05, 0.00041576570764843834, 0.0013104832034742317, -0.016134882530155856, 0.48326120480008949},
+     {-6.0242166810553499e-10, -3.741008836044557e-09, 2.145358384275653e-07, 1.2033713632231269e-06, -4.1026901917845526e-05, -0.00016896615991809916, 0.0031680767765339402, 0.0066742361493883247, 0.45881210822197999}},
+    {7.19372629906582, 57.549810392526751,
+     {-5.3812687639265278e-10, 5.8807154701412401e-09, 2.0275533485492048e-07, -1.4365401272420364e-06, -4.01899759150115e-05, 0.00017364185678933608, 0.0031514902190812114, -0.0066572167918167967, 0.45923681964324831},
+     {-3.0934899086787482e-10, -1.1160719237679473e-08, 9.9104587758525042e-08, 3.1317683228393456e-06, -1.7545476087899026e-05, -0.00041147663927845746, 0.0013071414604501411, 0.016050407886756199, 0.48279819872543123}},
+    {7.2283954620113491, 57.827163696090665,
+     {-5.961324767156384e-10, -3.7260026175545136e-09, 2.1237489211678451e-07, 1.1940938413612656e-06, -4.062630459272798e-05, -0.00016739402463199216, 0.0031376015423103462, 0.0066102050315740776, 0.45921013086745316},
+     {1.6170753625033285e-10, -1.1988461778855708e-08, -7.3064497341235324e-08, 3.2143274559248702e-06, 1.5942586050449181e-05, -0.00041174609156723052, -0.0012979107228923842, 0.015979673436761804, 0.51658311608412777}},
+    {7.2628991311876181, 58.103193049500874,
+     {-3.0504043735390951e-10, -1.1063517213472096e-08, 9.7920252462024848e-08, 3.1028813372580011e-06, -1.7363979821688469e-05, -0.00040757898805689197, 0.0012946640030007533, 0.015897600919781766, 0.48296703536997737},
+     {5.3365578622788234e-10, -5.8048634787866149e-09, -2.0092926322767823e-07, 1.4206318719733879e-06, 3.9813177657110899e-05, -0.00017193675809755449, -0.0031214866412786896, 0.0065936696228738288, 0.54037722627985796}},
+    {7.2972396542222073, 58.377917233777509,
+     {1.6157297721974828e-10, -1.186792419893834e-08, -7.2613691282086279e-08, 3.1831144196581285e-06, 1.5806242779831114e-05, -0.00040784084717887525, -0.0012856932885854655, 0.015828858982701949, 0.51643169563804792},
+     {5.9002269736652124e-10, 3.7108263128970975e-09, -2.1027772789672383e-07, -1.1850150711811835e-06, 4.023721454779472e-05, 0.00016586492528851415, -0.0031079891935037879, -0.0065479821495978904, 0.54040316325055338}},
+    {7.331419323756716, 58.651354590053096,
+     {5.2929216565189563e-10, -5.7316684731745227e-09, -1.9915141780124657e-07, 1.4052307943379638e-06, 3.9446779728447012e-05, -0.00017028088002332686, -0.0030923240113325534, 0.0065319081813995268, 0.54000202817653276},
+     {3.0089175595549023e-10, 1.0968767227836906e-08, -9.677572065935891e-08, -3.0747781404327768e-06, 1.7187968405413256e-05, 0.00040379003568977168, -0.0012825371723275691, -0.015749076865087669, 0.51686899809520481}},
+    {7.3654403792331173, 58.923523033865592,
+     {5.8410165593159036e-10, 3.6955303261976269e-09, -2.0824129987051521e-07, -1.1761287915246221e-06, 3.9859091330363139e-05, 0.00016437693575944989, -0.0030791997636508972, -0.0064874839672900315, 0.54002724798806345},
+     {-1.6140333514158556e-10, 1.1750928896603341e-08, 7.2168870657307593e-08, -3.1527924213570202e-06, -1.5673303483898504e-05, 0.00040404465176628601, 0.0012738144982662736, -0.015682235620480663, 0.48371565656503646}},
+    {7.3993050086061816, 59.194440068849147,
+     {2.9690250258340711e-10, 1.0876381351110354e-08, -9.5668864608100534e-08, -3.0474239913202972e-06, 1.7017172370598077e-05, 0.00040010482210969811, -0.0012707448486393297, -0.015604639317566147, 0.51670967219880526},
+     {-5.2504001146758128e-10, 5.6609925636053049e-09, 1.9741974521814143e-07, -1.3903108941337727e-06, -3.9090312460493548e-05, 0.00016867190103092566, 0.003063963765195972, -0.0064718503700438093, 0.46036290429056725}},
+    {7.4330153499856664, 59.464122799885551,
+     {-1.6121148860293033e-10, 1.163728513553508e-08, 7.1730078987641832e-08, -3.1233198518054728e-06, -1.5543630562747657e-05, 0.00040035252302206281, 0.0012622589912616375, -0.015539612761629483, 0.48385911925657865},
+     {-5.7834981248561235e-10, -3.6801290903554218e-09, 2.0626272401180756e-07, 1.1674288926122323e-06, -3.9491429359495012e-05, -0.00016292824831082298, 0.0030511958307985684, 0.0064286322533708383, 0.46033836918707227}},
+    {7.4665734932117758, 59.732587945694249,
+     {-5.2087445467918769e-10, 5.5927127373678331e-09, 1.9573225040758757e-07, -1.3758479899261822e-06, -3.8743335298546677e-05, 0.00016710764993836669, 0.0030363697701104586, -0.0064134192802182723, 0.46071803073307166},
+     {-2.9307134497003062e-10, -1.0786280313368479e-08, 9.4597745525781818e-08, 3.0207862677378294e-06, -1.6851340410017901e-05, -0.00039651869842820264, 0.0012592719309832204, 0.01546410425462285, 0.48344522768775472}},
+    {7.4999814813671684, 59.99985185093729,
+     {-5.7277160792068571e-10, -3.6646634615777884e-09, 2.0433934855290659e-07, 1.1589095328390364e-06, -3.9133755108555768e-05, -0.00016151716447659892, 0.0030239423129250972, 0.0063713536560331581, 0.46069414990570445},
+     {1.6095880184252565e-10, -1.1526873233691504e-08, -7.1297240777923321e-08, 3.0946578856716478e-06, 1.5417093910841118e-05, -0.00039675979167036468, -0.0012510123649740676, 0.015400811734874349, 0.51600113962093297}},
+    {7.5332413122286024, 60.265930497828442,
+     {-2.89338331072031e-10, -1.0698338437364896e-08, 9.3560432512518332e-08, 2.9948342088470525e-06, -1.6690237687216891e-05, -0.00039302730223643445, 0.0012481042558695199, 0.015327299050203459, 0.48359590256119578},
+     {5.1681103840905962e-10, -5.5266882181825849e-09, -1.9408714102553404e-07, 1.3618195040532299e-06, 3.8405434629795732e-05, -0.00016558609360869947, -0.0030095081310404989, 0.006356542777927944, 0.53893621753183341}},
+    {7.5663549396611502, 60.530839517289209,
+     {1.6070034192239291e-10, -1.1419526435574312e-08, -7.0870430191050104e-08, 3.0667700338660175e-06, 1.5293570539282042e-05, -0.00039326207651024792, -0.0012400610994063865, 0.015265664844857651, 0.51586496209194643},
+     {5.6734172915184899e-10, 3.649147650719442e-09, -2.0246863308148733e-07, -1.1505650449605831e-06, 3.8785624491860515e-05, 0.00016014208668722885, -0.0029974062831250592, -0.0063155793184899583, 0.53895947265448163}},
+    {7.5993242749577297, 60.794594199661375,
+     {5.1282711410749471e-10, -5.4628086498809125e-09, -1.9248262916882197e-07, 1.3482044045609598e-06, 3.8076221560656709e-05, -0.00016410532590628579, -0.0029833470155517863, 0.0063011531293082935, 0.53859943528114651},
+     {2.8575053434565234e-10, 1.0612497547413113e-08, -9.2555332287247438e-08, -2.9695389785477921e-06, 1.6533644695004845e-05, 0.00038962653540254577, -0.0012372285238007527, -0.01519406158312268, 0.516257459121233}},
+    {7.6321511881265431, 61.057209505012317,
+     {5.6205529119779385e-10, 3.6336038622408751e-09, -2.0064821171228431e-07, -1.1423899839435592e-06, 3.8446620569232426e-05, 0.0001588015107150953, -0.0029715568023172961, -0.006261244530901381, 0.53862209155371821},
+     {-1.6043388839648287e-10, 1.1315093306762947e-08, 7.0449607481037901e-08, -3.0396220663808649e-06, -1.5172943973629227e-05, 0.00038985526200566167, 0.0012293924888103144, -0.015134014520170016, 0.4842678005990127}},
+    {7.6648375091288923, 61.318700073032524,
+     {2.8227598036778545e-10, 1.0528663274556038e-08, -9.1580793171175401e-08, -2.9448733407377858e-06, 1.6381355762845606e-05, 0.0003863125437492676, -0.0012266322326133436, -0.015064239429186332, 0.51611468045439091},
+     {-5.0895199166234306e-10, 5.4009559047329958e-09, 1.9091714142938088e-07, -1.3349830207398661e-06, -3.7755330209859883e-05, 0.00016266355766239582, 0.0029578564952334671, -0.0062471866614370181, 0.4617287586086834}},
+    {7.6973850290696824, 61.579080232557224,
+     {-1.6013279591220453e-10, 1.1213474815363611e-08, 7.0034694155118871e-08, -3.013181927469244e-06, -1.5055103866928876e-05, 0.00038653547799664956, 0.0012189945797097881, -0.015005712540858224, 0.48439728866700649},
+     {-5.5693893941111128e-10, -3.61806917759111e-09, 1.988759412707708e-07, 1.1343791422868676e-06, -3.8116351520206537e-05, -0.00015749401880675584, 0.0029463647675897417, 0.0062082884146997183, 0.46170667591792314}},
+    {7.729795501342795, 61.838364010741394,
+     {-5.0514259442024922e-10, 5.3410338374249022e-09, 1.8938906576337899e-07, -1.3221369792870696e-06, -3.7442415841720811e-05, 0.00016125910763124807, 0.0029330084016987515, -0.0061945834545693614, 0.46204872297328403},
+     {-2.7892044229815838e-10, -1.0446753018200639e-08, 9.06353490037759e-08, 2.9208116176793197e-06, -1.623317811555447e-05, -0.00038308169872254549, 0.0012163036170932673, 0.014937689127985092, 0.48402440480879128}},
+    {7.7620706427334287, 62.096565141868425,
+     {-5.5193538628373062e-10, -3.6025258332017529e-09, 1.9714965926453942e-07, 1.1265274050265006e-06, -3.7794448593558849e-05, -0.00015621827332011617, 0.0029218027743952227, 0.0061566536357746116, 0.46202719006396142},
+     {1.5979750855876773e-10, -1.1114503095654982e-08, -6.9625626597513701e-08, 2.987419326916374e-06, 1.4939945588016146e-05, -0.00038329908105656785, -0.0012088561145751145, 0.014880619336731432, 0.51547636559382093}},
+    {7.7942121344793378, 62.353697075835044,
+     {-2.7566748883600667e-10, -1.0366737690503669e-08, 8.971761766840558e-08, 2.8973296720691266e-06, -1.6088930829688541e-05, -0.00037993058075451447, 0.0012062315940453983, 0.014814275516333953, 0.48415995306827625},
+     {5.014175741280269e-10, -5.2829616237204391e-09, -1.878969763113858e-07, 1.3096490933950378e-06, 3.7137153423766334e-05, -0.00015989039426729523, -0.0029087761957149738, 0.0061432870624080517, 0.53763920399177179}},
+    {7.8262216232928576, 62.609772986341369,
+     {1.5946088893770138e-10, -1.1018100432025335e-08, -6.9222406251512325e-08, 2.9623058939165503e-06, 1.4827369910541677e-05, -0.00038014263784884317, -0.0011989664805952954, 0.014758603349017935, 0.51535303724472881},
+     {5.4705129315379963e-10, 3.5870137971016902e-09, -1.9546743090792518e-07, -1.1188299529618639e-06, 3.7480564510500303e-05, 0.00015497301110961592, -0.002897844991229373, -0.0061062861434995203, 0.53766020955999005}},
+    {7.8581007223454362, 62.864805778763959,
+     {4.9777471033962684e-10, -5.2266253547372798e-09, -1.8643948562768742e-07, 1.2975031711826013e-06, 3.6839236150720822e-05, -0.00015855592819813413, -0.0028851348480312539, 0.0060932442574303629, 0.53733470322957544},
+     {2.7250512957266437e-10, 1.0288484730835989e-08, -8.8826280886245002e-08, -2.8744044950901326e-06, 1.594844385408023e-05, 0.00037685596386599629, -0.001196405712265397, -0.014693871121283127, 0.51570788838621395}},
+    {7.8898510122163792, 63.118808097731623,
+     {5.4230531176813201e-10, 3.5715406188074894e-09, -1.9382745763962816e-07, -1.1112821031722397e-06, 3.7174371855908106e-05, 0.00015375703821446374, -0.0028744670454054697, -0.0060571349328451193, 0.53735520263529601},
+     {-1.5911716388927744e-10, 1.0924153359681554e-08, 6.8824944854384285e-08, -2.9378148292402706e-06, -1.4717282563803114e-05, 0.00037706290970765388, 0.0011893156629495319, -0.014639540448630934, 0.48476739181460871}},
+    {7.9214740418073601, 63.371792334457744,
+     {2.6944579900600729e-10, 1.0211959278194627e-08, -8.7960154049326889e-08, -2.8520145038402056e-06, 1.5811557259354236e-05, 0.00037385480200370635, -0.0011868161069670882, -0.014576355606576961, 0.51557898070459152},
+     {-4.9421489123346873e-10, 5.1719508675773795e-09, 1.8501528298298098e-07, -1.285684077534377e-06, -3.6548374158035246e-05, 0.00015725430551037645, 0.0028620607306746593, -0.006044404798693042, 0.46296252654818465}},
+    {7.9529713292241926, 63.623770633793839,
+     {-1.5873924397169503e-10, 1.0832568619889571e-08, 6.8433125499645087e-08, -2.9139208762574142e-06, -1.4609593975090096e-05, 0.00037405683870572748, 0.0011798942021882877, -0.014523313405265425, 0.4848850333194144},
+     {-5.3770499164329522e-10, -3.5561273925566184e-09, 1.9222802571938757e-07, 1.1038793643058931e-06, -3.6875561617716324e-05, -0.00015256922508119497, 0.0028516459188081197, 0.006009151827231142, 0.46294251329831015}},
+    {7.984344362627307, 63.874754901018925,
+     {-4.9073012320377529e-10, 5.1188757677067542e-09, 1.8362312825814797e-07, -1.2741776106994784e-06, -3.6264293362398003e-05, 0.00015598420153355164, 0.002839531517683791, -0.0059967212197696643, 0.46325277011331278},
+     {-2.6650193163391123e-10, -1.0137126471576607e-08, 8.7118125158269777e-08, 2.8301392666629788e-06, -1.5678120449225119e-05, -0.0003709242162521359, 0.0011774534581418666, 0.014461615267011035, 0.48454680713489862}}
+};
 
 //full double precision accuracy using rational functions
 void fresnel( double xxa, double *ssa, double *cca )
@@ -222,6 +656,8 @@ void fresnel( double xxa, double *ssa, double *cca )
     double f, g, cc, ss, c, s, t, u;
     double x, x2;
 
+    CORNU_COUNT(FRESNEL_VALUES, 1);
+
     x = fabs(xxa);
     x2 = x * x;
     if( x2 < 2.5625 )
@@ -273,6 +709,8 @@ void fresnelApprox( double xxa, double *ssa, double *cca )
     double f, g, cc, ss, c, s, t, u;
     double x, x2;
 
+    CORNU_COUNT(FRESNEL_APPROX_VALUES, 1);
+
     x = fabs(xxa);
     x2 = x * x;
     if( x2 < 2.5625 )
@@ -318,84 +756,237 @@ done:
     *ssa = ss;
 }
 
-//The double precision version is not vectorized because the scalar version is actually faster
-void fresnel(const VectorXd &t, VectorXd *s, VectorXd *c)
+//accurate to about 1e-10 using the tables, except beyond the tables it's fresnel
+void fresnelTable( double xxa, double *ssa, double *cca )
+{
+    double cc, ss;
+    double x = fabs(xxa);
+    double x2 = x * x;
+
+    CORNU_COUNT(FRESNEL_TABLE_VALUES, 1); //past the tables, fresnel counts too
+    if( x2 < 0.5 )
+    {
+        double t = x2 * x2;
+        ss = x * x2 * polevl( t, tsn );
+        cc = x * polevl( t, tcn );
+    }
+    else if( x2 < 64. )
+    {
+        const FresnelInterval &interval = fresnelIntervals[(int)(x2 * 2.) - 1];
+        double u = (x - interval.center) * interval.invHalfWidth;
+        ss = polevl( u, interval.s );
+        cc = polevl( u, interval.c );
+    }
+    else
+        fresnel( x, &ss, &cc );
+
+    if( xxa < 0.0 )
+    {
+        cc = -cc;
+        ss = -ss;
+    }
+
+    *cca = cc;
+    *ssa = ss;
+}
+
+void fresnelTable(const VectorXd &t, VectorXd *s, VectorXd *c)
 {
     s->resize(t.size());
     c->resize(t.size());
     for(int i = 0; i < t.size(); ++i)
-        fresnel(t[i], &((*s)[i]), &((*c)[i]));
+        fresnelTable(t[i], &((*s)[i]), &((*c)[i]));
 }
 
-//Vectorization stuff
-#ifdef EIGEN_VECTORIZE_SSE
-typedef Packet4f PSETParam;
+thread_local FresnelTier::Tier FresnelTier::_current = FresnelTier::FULL;
 
-//vectorized polynomial evaluation
-template<typename Packet>
-static Packet vecpolevl( const Packet &x, const Matrix<typename unpacket_traits<Packet>::type, Dynamic, 1> &coefVec )
+void fresnelCurve(const VectorXd &t, VectorXd *s, VectorXd *c)
+{
+    if(FresnelTier::current() == FresnelTier::TABLE)
+        fresnelTable(t, s, c);
+    else if(FresnelTier::current() == FresnelTier::APPROX)
+        fresnelApprox(t, s, c);
+    else
+        fresnel(t, s, c);
+}
+
+//The integral is integral_0^s e^(iku) * e^(idu^2 / 2) du.  Expanding the second exponential, whose exponent is
+//small, gives s * sum_m (ids^2 / 2)^m / m! * J_2m(ks), where J_n(x) = integral_0^1 v^n e^(ixv) dv.
+void fresnelNearArc(double curvature, double dCurvature, double s, double *c, double *sn)
 {
-    int i = (int)coefVec.size() - 1;
-    const typename unpacket_traits<Packet>::type *coef = &(coefVec[0]);
-    Packet ans = pset1<PSETParam>(*coef++);
+    const int terms = 7; //enough for |dCurvature| * s^2 / 2 up to 1e-2
+    //J_n as real and imaginary parts
+    const int maxN = 2 * terms - 2;
+    double re[maxN + 1], im[maxN + 1];
+
+    double x = curvature * s;
+    double cosX = cos(x), sinX = sin(x);
+    if(fabs(x) >= 0.5)
+    {
+        //Integrating by parts, J_n = (e^(ix) - n * J_(n - 1)) / (ix).  The error in J_n grows like n! / x^n, but
+        //it is multiplied by the much smaller deviation from the arc.
+        double invX = 1. / x;
+        re[0] = sinX * invX;
+        im[0] = (cosX > 0. ? sinX * sinX / (1. + cosX) : 1. - cosX) * invX; //1 - cos(x), without cancellation
+        for(int n = 1; n <= maxN; ++n)
+        {
+            re[n] = (sinX - n * im[n - 1]) * invX;
+            im[n] = (n * re[n - 1] - cosX) * invX;
+        }
+    }
+    else
+    {
+        //Sum the series J_maxN = sum_j (ix)^j / (j! * (maxN + j + 1)), and go down with
+        //J_(n - 1) = (e^(ix) - ix * J_n) / n, which is stable for |x| < n.
+        double termRe = 1., termIm = 0.;
+        re[maxN] = im[maxN] = 0.;
+        for(int j = 0; j < 16; ++j)
+        {
+            re[maxN] += termRe / (maxN + j + 1);
+            im[maxN] += termIm / (maxN + j + 1);
+            double newRe = -termIm * x / (j + 1);
+            termIm = termRe * x / (j + 1);
+            termRe = newRe;
+        }
+        for(int n = maxN; n > 0; --n)
+        {
+            re[n - 1] = (cosX + x * im[n]) / n;
+            im[n - 1] = (sinX - x * re[n]) / n;
+        }
+    }
 
-    do
+    //sum_m (i * factor)^m / m! * J_2m
+    double factor = 0.5 * dCurvature * s * s;
+    double powerRe = 1., powerIm = 0., zRe = 0., zIm = 0.;
+    for(int m = 0; m < terms; ++m)
     {
-        ans = padd(pmul(ans, x), pset1<PSETParam>(*coef++));
-    } while(--i);
+        zRe += powerRe * re[2 * m] - powerIm * im[2 * m];
+        zIm += powerRe * im[2 * m] + powerIm * re[2 * m];
+        double newRe = -powerIm * factor / (m + 1);
+        powerIm = powerRe * factor / (m + 1);
+        powerRe = newRe;
+    }
+    *c = zRe * s;
+    *sn = zIm * s;
+}
 
-    return ans;
+//Vectorization stuff.  Everything is written with Eigen's generic packet math, so it is vectorized
+//for whatever instruction set Eigen is compiled for (SSE, AVX, AVX-512, NEON...).
+
+//vectorized polynomial evaluation, unrolled the same way as the scalar version
+template<int K, int N>
+struct VecHorner
+{
+    template<typename Packet>
+    static Packet eval(const Packet &x, const typename unpacket_traits<Packet>::type (&coefs)[N], const Packet &ans)
+    {
+        return VecHorner<K + 1, N>::eval(x, coefs, padd(pmul(ans, x), pset1<Packet>(coefs[K])));
+    }
+};
+
+template<int N>
+struct VecHorner<N, N>
+{
+    template<typename Packet>
+    static Packet eval(const Packet &, const typename unpacket_traits<Packet>::type (&)[N], const Packet &ans) { return ans; }
+};
+
+template<typename Packet, int N>
+static Packet vecpolevl( const Packet &x, const typename unpacket_traits<Packet>::type (&coefs)[N] )
+{
+    return VecHorner<1, N>::eval(x, coefs, pset1<Packet>(coefs[0]));
 }
 
+template<typename Packet, int N>
+static Packet vecp1evl( const Packet &x, const typename unpacket_traits<Packet>::type (&coefs)[N] )
+{
+    return VecHorner<1, N>::eval(x, coefs, padd(x, pset1<Packet>(coefs[0])));
+}
+
+//Vectorized double precision for the low branch (the same operations as the scalar version).
+//Both functions are odd there, so the sign comes out right without special handling.
 template<typename Packet>
-static Packet vecp1evl( const Packet &x, const Matrix<typename unpacket_traits<Packet>::type, Dynamic, 1> &coefVec )
+static void fresnelLowDouble( const Packet &x, Packet *ssa, Packet *cca )
+{
+    Packet x2 = pmul(x, x);
+    Packet t = pmul(x2, x2);
+    *ssa = pdiv(pmul(pmul(x, x2), vecpolevl( t, dsn)), vecp1evl( t, dsd));
+    *cca = pdiv(pmul(x, vecpolevl( t, dcn)), vecpolevl( t, dcd));
+}
+
+//Only the low branch is vectorized: Eigen has no vectorized double precision sin and cos for the others
+void fresnel(const VectorXd &t, VectorXd *s, VectorXd *c)
 {
-    int i = (int)coefVec.size() - 1;
-    const typename unpacket_traits<Packet>::type *coef = &(coefVec[0]);
-    Packet ans = padd(x, pset1<PSETParam>(*coef++));
+    typedef packet_traits<double>::type Packet;
+    const int packetSize = packet_traits<double>::size;
+
+    s->resize(t.size());
+    c->resize(t.size());
+
+    if(packetSize == 1)
+    {
+        for(int i = 0; i < t.size(); ++i)
+            fresnel(t[i], &((*s)[i]), &((*c)[i]));
+        return;
+    }
 
-    do
+    double lowVal[packetSize], vs[packetSize], vc[packetSize];
+    int lowIdx[packetSize];
+    int lowNum = 0;
+
+    for(int i = 0; i < t.size(); ++i)
     {
-        ans = padd(pmul(ans, x), pset1<PSETParam>(*coef++));
-    } while(--i);
+        if(t[i] * t[i] >= 2.5625)
+        {
+            fresnel(t[i], &((*s)[i]), &((*c)[i]));
+            continue;
+        }
+
+        lowVal[lowNum] = t[i];
+        lowIdx[lowNum++] = i;
 
-    return ans;
+        if(lowNum == packetSize)
+        {
+            Packet ps, pc;
+            fresnelLowDouble(ploadu<Packet>(lowVal), &ps, &pc);
+            CORNU_COUNT(FRESNEL_VALUES, packetSize);
+            pstoreu(vs, ps);
+            pstoreu(vc, pc);
+            for(int j = 0; j < packetSize; ++j)
+            {
+                (*s)[lowIdx[j]] = vs[j];
+                (*c)[lowIdx[j]] = vc[j];
+            }
+            lowNum = 0;
+        }
+    }
+
+    //finish up
+    for(int i = 0; i < lowNum; ++i)
+        fresnel(lowVal[i], &((*s)[lowIdx[i]]), &((*c)[lowIdx[i]]));
 }
 
+#if defined(EIGEN_VECTORIZE_SSE) || defined(EIGEN_VECTORIZE_NEON)
+
 //other vectorized utilities
 EIGEN_STRONG_INLINE Packet4f packetTransferSign(const Packet4f& to, const Packet4f& from)
 {
-  const Packet4f mask = _mm_and_ps(from, _mm_castsi128_ps(_mm_setr_epi32(0x80000000,0x80000000,0x80000000,0x80000000)));
-  return _mm_or_ps(to, mask);
-}
-EIGEN_STRONG_INLINE Packet2d packetTransferSign(const Packet2d& to, const Packet2d from)
-{
-  const Packet2d mask = _mm_and_pd(from, _mm_castsi128_pd(_mm_setr_epi32(0x00000000,0x80000000,0x00000000,0x80000000)));
-  return _mm_or_pd(to, mask);
+    return pselect(pcmp_lt(from, pzero(from)), pnegate(to), to);
 }
 
 EIGEN_STRONG_INLINE Packet4f packetFmod(const Packet4f &a, const Packet4f &b)
 {
-    Packet4f div = pdiv(a, b);
-    div = _mm_cvtepi32_ps(_mm_cvtps_epi32(div));
+    Packet4f div = pfloor(padd(pdiv(a, b), pset1<Packet4f>(0.5f))); //round to nearest
     return psub(a, pmul(div, b));
 }
 
-//vectorized for the low branch of the Fresnel approximation
-void fresnelLow( const Packet4f &xxa, Packet4f *ssa, Packet4f *cca )
+//vectorized for the low branch of the Fresnel approximation (odd functions, as above)
+void fresnelLow( const Packet4f &x, Packet4f *ssa, Packet4f *cca )
 {
-    Packet4f cc, ss, t;
-    Packet4f x, x2;
-
-    x = pabs(xxa);
-    x2 = pmul(x, x);
-
-    t = pmul(x2, x2);
-    ss = pmul(x, pmul(x2, vecpolevl( t, ssn)));
-    cc = pmul(x, vecpolevl( t, scn));
-
-    *ssa = packetTransferSign(ss, xxa);
-    *cca = packetTransferSign(cc, xxa);
+    Packet4f x2 = pmul(x, x);
+    Packet4f t = pmul(x2, x2);
+    *ssa = pmul(x, pmul(x2, vecpolevl( t, ssn)));
+    *cca = pmul(x, vecpolevl( t, scn));
 }
 
 //vectorized for the high branch
@@ -407,24 +998,24 @@ void fresnelMed( const Packet4f &xxa, Packet4f *ssa, Packet4f *cca )
     x = pabs(xxa);
     x2 = pmul(x, x);
 
-    t = pmul(pset1<PSETParam>(float(PI)), x2);
-    t = pdiv(pset1<PSETParam>(float(1.0)), t);
+    t = pmul(pset1<Packet4f>(float(PI)), x2);
+    t = pdiv(pset1<Packet4f>(float(1.0)), t);
     u = pmul(t, t);
-    f = psub(pset1<PSETParam>(float(1.0)), pmul(u, vecpolevl( u, sfn)));
+    f = psub(pset1<Packet4f>(float(1.0)), pmul(u, vecpolevl( u, sfn)));
     g = pmul(t, vecpolevl( u, sgn));
 
-    t = pmul(pset1<PSETParam>(float(HALFPI)), x2);
+    t = pmul(pset1<Packet4f>(float(HALFPI)), x2);
 
     //The following line is necessary because Eigen's psin and pcos don't handle large
     //inputs well.
-    t = packetFmod(t, pset1<PSETParam>(float(TWOPI))); 
+    t = packetFmod(t, pset1<Packet4f>(float(TWOPI))); 
 
     c = pcos(t);
     s = psin(t);
 
-    t = pdiv(pset1<PSETParam>(float(1. / PI)), x);
-    cc = padd(pset1<PSETParam>(float(0.5)), pmul(t, psub(pmul(f, s), pmul(g, c))));
-    ss = psub(pset1<PSETParam>(float(0.5)), pmul(t, padd(pmul(f, c), pmul(g, s))));
+    t = pdiv(pset1<Packet4f>(float(1. / PI)), x);
+    cc = padd(pset1<Packet4f>(float(0.5)), pmul(t, psub(pmul(f, s), pmul(g, c))));
+    ss = psub(pset1<Packet4f>(float(0.5)), pmul(t, padd(pmul(f, c), pmul(g, s))));
 
     *ssa = packetTransferSign(ss, xxa);
     *cca = packetTransferSign(cc, xxa);
@@ -468,10 +1059,11 @@ void fresnelApprox(const VectorXd &t, VectorXd *s, VectorXd *c)
 
             if(lowNum == packetSize)
             {
-                pval = lowVal.packet<Aligned>(0);
+                pval = ploadu<Packet>(lowVal.data());
                 fresnelLow(pval, &ps, &pc);
-                vs.writePacket<Aligned>(0, ps);
-                vc.writePacket<Aligned>(0, pc);
+                CORNU_COUNT(FRESNEL_APPROX_VALUES, packetSize);
+                pstoreu(vs.data(), ps);
+                pstoreu(vc.data(), pc);
                 for(int j = 0; j < packetSize; ++j)
                 {
                     (*s)[lowIdx[j]] = vs[j];
@@ -487,10 +1079,11 @@ void fresnelApprox(const VectorXd &t, VectorXd *s, VectorXd *c)
 
             if(medNum == packetSize)
             {
-                pval = medVal.packet<Aligned>(0);
+                pval = ploadu<Packet>(medVal.data());
                 fresnelMed(pval, &ps, &pc);
-                vs.writePacket<Aligned>(0, ps);
-                vc.writePacket<Aligned>(0, pc);
+                CORNU_COUNT(FRESNEL_APPROX_VALUES, packetSize);
+                pstoreu(vs.data(), ps);
+                pstoreu(vc.data(), pc);
                 for(int j = 0; j < packetSize; ++j)
                 {
                     (*s)[medIdx[j]] = vs[j];
@@ -508,7 +1101,7 @@ void fresnelApprox(const VectorXd &t, VectorXd *s, VectorXd *c)
         fresnelApprox(medVal[i], &((*s)[medIdx[i]]), &((*c)[medIdx[i]]));
 }
 
-#else //EIGEN_VECTORIZE_SSE
+#else //SSE or NEON
 
 //The unvectorized version
 void fresnelApprox(const VectorXd &t, VectorXd *s, VectorXd *c)
@@ -519,7 +1112,7 @@ void fresnelApprox(const VectorXd &t, VectorXd *s, VectorXd *c)
         fresnelApprox(t[i], &((*s)[i]), &((*c)[i]));
 }
 
-#endif //EIGEN_VECTORIZE_SSE
+#endif //SSE or NEON
 
 END_NAMESPACE_Cornu
 
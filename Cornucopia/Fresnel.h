@@ -28,11 +28,54 @@ NAMESPACE_Cornu
 
 //almost full double-precision accuracy, using rational approximations
 void fresnel(double xxa, double *ssa, double *cca);
-void fresnel(const Eigen::VectorXd &t, Eigen::VectorXd *s, Eigen::VectorXd *c);
+void fresnel(const Eigen::VectorXd &t, Eigen::VectorXd *s, Eigen::VectorXd *c); //vectorized, same results as the scalar version
 
 //roughly single-precision accuracy, using polynomial approximations
 void fresnelApprox(double xxa, double *ssa, double *cca);
-void fresnelApprox(const Eigen::VectorXd &t, Eigen::VectorXd *s, Eigen::VectorXd *c); //sse vectorized
+void fresnelApprox(const Eigen::VectorXd &t, Eigen::VectorXd *s, Eigen::VectorXd *c); //vectorized with SSE or NEON
+
+//accurate to about 1e-10, using piecewise polynomial tables with no divisions (for |xxa| >= 8 it calls fresnel)
+void fresnelTable(double xxa, double *ssa, double *cca);
+void fresnelTable(const Eigen::VectorXd &t, Eigen::VectorXd *s, Eigen::VectorXd *c);
+
+//Clothoids are evaluated with fresnelCurve, which uses fresnel, or fresnelTable or fresnelApprox while a Scope
+//selects them for the calling thread.  The Fitter does that for each stage of a run, according to
+//Parameters::FRESNEL_TIER, and parallelFor passes the calling thread's tier on to its workers.
+class FresnelTier
+{
+public:
+    enum Tier { FULL, TABLE, APPROX };
+
+    class Scope
+    {
+    public:
+        Scope(Tier tier) : _prev(_current) { _current = tier; }
+        ~Scope() { _current = _prev; }
+    private:
+        Tier _prev;
+    };
+
+    static Tier current() { return _current; }
+
+private:
+    static thread_local Tier _current;
+};
+
+inline void fresnelCurve(double xxa, double *ssa, double *cca)
+{
+    if(FresnelTier::current() == FresnelTier::TABLE)
+        fresnelTable(xxa, ssa, cca);
+    else if(FresnelTier::current() == FresnelTier::APPROX)
+        fresnelApprox(xxa, ssa, cca);
+    else
+        fresnel(xxa, ssa, cca);
+}
+void fresnelCurve(const Eigen::VectorXd &t, Eigen::VectorXd *s, Eigen::VectorXd *c);
+
+//The integrals of cos and sin of curvature * u + dCurvature * u^2 / 2 from 0 to s, to almost full double
+//precision when |dCurvature| * s^2 / 2 < 1e-2--the Fresnel integrals are inaccurate for such clothoids because
+//the canonical parameter is huge
+void fresnelNearArc(double curvature, double dCurvature, double s, double *c, double *sn);
 
 END_NAMESPACE_Cornu
 
@@ -27,69 +27,134 @@
 #include "Preprocessing.h"
 #include "TwoCurveCombine.h"
 #include "Oversketcher.h"
+#include "WorkCounters.h"
+#include "Parallel.h"
+#include "Dataset.h"
+#include "EdgeCostModel.h"
+
+#include <algorithm>
 
 using namespace std;
 using namespace Eigen;
 NAMESPACE_Cornu
 
-struct PrimitiveCacheData
-{
-    double x, y, angle, curvature, param;
-
-    static PrimitiveCacheData make(CurvePrimitiveConstPtr curve, double param)
-    {
-        PrimitiveCacheData out;
-        Vector2d pos = curve->pos(param);
-        out.param = param;
-        out.x = pos[0];
-        out.y = pos[1];
-        out.angle = curve->angle(param);
-        out.curvature = curve->curvature(param);
-        return out;
-    }
-};
-
+//The values of the primitives at their first and last few points, by field, so the costs of the edges out
+//of a vertex are computed in loops over the second primitives, which read each field contiguously.  start(k)
+//has the values at the k'th point from the start of each primitive, end(k) from the end.
 class PrimitiveCache
 {
 public:
-    PrimitiveCache(const PrimitiveCache &other)
+    struct Values
     {
-        _numVals = other._numVals;
-        for(int i = 0; i < 3; ++i)
+        vector<double> x, y, angle, curvature, param; //indexed by primitive
+
+        void resize(int size)
         {
-            _startData[i] = other._startData[i];
-            _endData[i] = other._endData[i];
+            x.resize(size);
+            y.resize(size);
+            angle.resize(size);
+            curvature.resize(size);
+            param.resize(size);
         }
-    }
 
-    PrimitiveCache(const Fitter &fitter, const FitPrimitive &primitive)
+        size_t memoryBytes() const
+        {
+            return vectorBytes(x) + vectorBytes(y) + vectorBytes(angle) + vectorBytes(curvature) + vectorBytes(param);
+        }
+
+        void set(int idx, const PrimitiveValue &value, double inParam)
+        {
+            Vector2d pos = value.pos(inParam);
+            param[idx] = inParam;
+            x[idx] = pos[0];
+            y[idx] = pos[1];
+            angle[idx] = value.angle(inParam);
+            curvature[idx] = value.curvature(inParam);
+        }
+    };
+
+    PrimitiveCache(const Fitter &fitter)
     {
+        const vector<FitPrimitive> &primitives = fitter.output<PRIMITIVE_FITTING>()->primitives;
+        const vector<PrimitiveValue> &values = fitter.output<PRIMITIVE_FITTING>()->values;
         const VectorC<Vector2d> &pts = fitter.output<RESAMPLING>()->output->pts();
-        CurvePrimitiveConstPtr curve = primitive.curve;
 
-        _numVals = min(3, primitive.numPts);
+        int size = (int)primitives.size();
+        _numVals.resize(size);
+        for(int i = 0; i < 3; ++i)
+        {
+            _startData[i].resize(size);
+            _endData[i].resize(size);
+        }
+
+        //the primitives' values are independent, so chunks of them are computed in parallel
+        int numChunks = (size + primitivesPerChunk - 1) / primitivesPerChunk;
+        parallelFor(numChunks, _ChunkBody(*this, primitives, values, pts));
+    }
+
+    int numVals(int primitive) const { return _numVals[primitive]; } //start(k) and end(k) are set for k below this
+    const Values &start(int offs) const { return _startData[offs]; }
+    const Values &end(int offs) const { return _endData[offs]; }
 
+    size_t memoryBytes() const
+    {
+        size_t out = vectorBytes(_numVals);
         for(int i = 0; i < 3; ++i)
+            out += _startData[i].memoryBytes() + _endData[i].memoryBytes();
+        return out;
+    }
+
+private:
+    static const int primitivesPerChunk = 128; //starting threads only pays off for this many primitives
+
+    class _ChunkBody
+    {
+    public:
+        _ChunkBody(PrimitiveCache &cache, const vector<FitPrimitive> &primitives, const vector<PrimitiveValue> &values,
+                   const VectorC<Vector2d> &pts)
+            : _cache(cache), _primitives(primitives), _values(values), _pts(pts) {}
+
+        void operator()(int c) const
         {
-            if(i >= primitive.numPts)
-                break;
+            int end = min((int)_primitives.size(), (c + 1) * primitivesPerChunk);
+            for(int p = c * primitivesPerChunk; p < end; ++p)
+                _cache._set(p, _primitives[p], _values[p], _pts);
+        }
+
+    private:
+        PrimitiveCache &_cache;
+        const vector<FitPrimitive> &_primitives;
+        const vector<PrimitiveValue> &_values;
+        const VectorC<Vector2d> &_pts;
+    };
+
+    void _set(int p, const FitPrimitive &primitive, const PrimitiveValue &value, const VectorC<Vector2d> &pts)
+    {
+        int numVals = _numVals[p] = min(3, primitive.numPts);
 
-            int realStartIdx = primitive.isFixed() ? 0 : primitive.startIdx;
-            double startParam = (i == 0 ? 0. : curve->project(pts[realStartIdx + i]));
-            _startData[i] = PrimitiveCacheData::make(curve, startParam);
+        int realStartIdx = primitive.isFixed() ? 0 : primitive.startIdx;
+        int realEndIdx = primitive.isFixed() ? (pts.size() - 1) : primitive.endIdx;
 
-            int realEndIdx = primitive.isFixed() ? (pts.size() - 1) : primitive.endIdx;
-            double endParam = (i == 0 ? curve->length() : curve->project(pts[realEndIdx - i]));
-            _endData[i] = PrimitiveCacheData::make(curve, endParam);
+        //the first values are at the endpoints, the rest are at the projections of the next points
+        Vector2d startPts[2], endPts[2];
+        double startParams[3] = { 0., 0., 0. }, endParams[3] = { value.length(), 0., 0. };
+        for(int i = 1; i < numVals; ++i)
+        {
+            startPts[i - 1] = pts[realStartIdx + i];
+            endPts[i - 1] = pts[realEndIdx - i];
         }
-    }
+        primitive.curve->projectMany(startPts, numVals - 1, startParams + 1);
+        primitive.curve->projectMany(endPts, numVals - 1, endParams + 1);
 
-    const PrimitiveCacheData &start(int offs) const { assert(offs < _numVals); return _startData[offs]; }
-    const PrimitiveCacheData &end(int offs) const { assert(offs < _numVals); return _endData[offs]; }
+        for(int i = 0; i < numVals; ++i)
+        {
+            _startData[i].set(p, value, startParams[i]);
+            _endData[i].set(p, value, endParams[i]);
+        }
+    }
 
-private:
-    int _numVals;
-    PrimitiveCacheData _startData[3], _endData[3];
+    vector<int> _numVals;
+    Values _startData[3], _endData[3];
 };
 
 class CostEvaluator : public smart_base
@@ -97,30 +162,31 @@ class CostEvaluator : public smart_base
 public:
     CostEvaluator(const Fitter &fitter) :
         _primitives(fitter.output<PRIMITIVE_FITTING>()->primitives),
-        _corners(fitter.output<RESAMPLING>()->corners)
+        _values(fitter.output<PRIMITIVE_FITTING>()->values),
+        _corners(fitter.output<RESAMPLING>()->corners),
+        _primitiveCache(fitter)
     {
         for(int i = 0; i < 3; ++i)
         {
-            _curveCost[i] = fitter.params().get(Parameters::ParameterType(i + Parameters::LINE_COST));
-            _continuityCost[i] = fitter.params().get(Parameters::ParameterType(i + Parameters::G0_COST));
+            _curveCost[i] = fitter.config().get(Parameters::ParameterType(i + Parameters::LINE_COST));
+            _continuityCost[i] = fitter.config().get(Parameters::ParameterType(i + Parameters::G0_COST));
         }
-        _errorCostFactor = fitter.params().get(Parameters::ERROR_COST);
-        _inflectionCost = fitter.params().get(Parameters::INFLECTION_COST);
-        _lengthScale = 1. / (fitter.output<SCALE_DETECTION>()->scale * fitter.params().get(Parameters::PIXEL_SIZE));
-        _shortnessCostFactor = fitter.params().get(Parameters::SHORTNESS_COST);
+        _errorCostFactor = fitter.config().get(Parameters::ERROR_COST);
+        _inflectionCost = fitter.config().get(Parameters::INFLECTION_COST);
+        _lengthScale = 1. / fitter.scale();
+        _shortnessCostFactor = fitter.config().get(Parameters::SHORTNESS_COST);
         _shortnessThreshold = fitter.scaledParameter(Parameters::SHORTNESS_THRESHOLD);
-
-        for(int i = 0; i < (int)_primitives.size(); ++i)
-            _primitiveCache.push_back(PrimitiveCache(fitter, _primitives[i]));
     }
 
+    size_t memoryBytes() const { return sizeof(*this) + _primitiveCache.memoryBytes(); }
+
     double vertexCost(int p) const
     {
         if(_primitives[p].isFixed())
             return 0.;
 
         //complexity
-        double out = _curveCost[_primitives[p].curve->getType()];
+        double out = _curveCost[_values[p].getType()];
 
         //error
         out += _errorCost(_primitives[p].error);
@@ -130,15 +196,15 @@ public:
             out += _inflectionCost;
 
         //shortness
-        double len = _primitives[p].curve->length();
+        double len = _values[p].length();
         if(_continuityCost[0] == Parameters::infinity)
         {
             //figure out how much we expect the length to decrease when we join things up
             double lenDecrease = 0;
             if(!_corners[_primitives[p].startIdx])
-                lenDecrease += _primitiveCache[p].start(1).param;
+                lenDecrease += _primitiveCache.start(1).param[p];
             if(!_corners[_primitives[p].endIdx])
-                lenDecrease += len - _primitiveCache[p].end(1).param;
+                lenDecrease += len - _primitiveCache.end(1).param[p];
             if(_continuityCost[1] != Parameters::infinity)
                 lenDecrease *= 0.5;
             len -= lenDecrease;
@@ -151,65 +217,111 @@ public:
 
     double edgeCost(int p1, int p2, int continuity, double error1 = -1., double error2 = -1.) const
     {
-        double out = 0.;
-
-        //continuity
-        if(!_corners[_primitives[p1].endIdx]) //no primitive spans a corner, so the start index is also there
-            out += _continuityCost[continuity];
-
-        //inflection
-        if(continuity > 1 && _primitives[p1].endCurvSign != _primitives[p2].startCurvSign)
-            out += _inflectionCost;
-
-        //error
-        double err1 = _primitives[p1].error;
-        double err2 = _primitives[p2].error;
-
         if(error1 < 0.) //we need to predict the error
         {
-            double extra1, extra2;
-            _getExtraError(p1, p2, continuity, extra1, extra2);
-        
-            out += _errorCost(extra1 + err1) - _errorCost(err1);
-            out += _errorCost(extra2 + err2) - _errorCost(err2);
+            double out;
+            edgeCosts(p1, continuity, &p2, 1, &out);
+            return out;
         }
-        else //the error has been passed in
+
+        //the error has been passed in
+        double out = _fixedEdgeCost(p1, p2, continuity);
+        out += max(0., _errorCost(error1) - _errorCost(_primitives[p1].error));
+        out += max(0., _errorCost(error2) - _errorCost(_primitives[p2].error));
+        return out;
+    }
+
+    //The predicted costs of the edges from p1 to each of the num primitives in p2 (the same as edgeCost's)
+    void edgeCosts(int p1, int continuity, const int *p2, int num, double *out) const
+    {
+        double len1 = _values[p1].length();
+        double err1 = _primitives[p1].error;
+        for(int n = 0; n < num; ++n)
         {
-            out += max(0., _errorCost(error1) - _errorCost(err1));
-            out += max(0., _errorCost(error2) - _errorCost(err2));
+            Vector3d diffs = edgeDiffs(p1, p2[n], continuity);
+
+            double len2 = _values[p2[n]].length();
+            double extra1 = diffs[0] * 0.5 + len1 * diffs[1] * 0.25 + SQR(len1) * diffs[2] * 0.125;
+            double extra2 = diffs[0] * 0.5 + len2 * diffs[1] * 0.25 + SQR(len2) * diffs[2] * 0.125;
+
+            double err2 = _primitives[p2[n]].error;
+            double cost = _fixedEdgeCost(p1, p2[n], continuity);
+            cost += _errorCost(extra1 + err1) - _errorCost(err1);
+            cost += _errorCost(extra2 + err2) - _errorCost(err2);
+            out[n] = cost;
         }
+    }
 
+    //The differences in position, angle and curvature between p1 and p2 at their joint that the predicted cost of
+    //the edge between them comes from.  The ones the continuity doesn't constrain are zero.
+    Vector3d edgeDiffs(int p1, int p2, int continuity) const
+    {
+        //one of the curve is a start or an end curve
+        int offset = (continuity > 0 && _primitives[p1].endIdx == _primitives[p2].startIdx) ? 0 : continuity;
+
+        Vector3d out = _getDiffs(p1, p2, offset);
+        for(int i = continuity + 1; i < 3; ++i)
+            out[i] = 0.; //don't count more than necessary
         return out;
     }
 
+    //The features of the edge as Dataset records them, with its cost as the predicted cost and no validated cost.
+    //Lengths and errors are scaled like the costs are.
+    void edgeFeatures(const Edge &edge, const vector<Vertex> &vertices, float *outRow) const
+    {
+        int p1 = vertices[edge.startVtx].primitiveIdx, p2 = vertices[edge.endVtx].primitiveIdx;
+        Vector3d diffs = edgeDiffs(p1, p2, edge.continuity);
+
+        outRow[Dataset::START_TYPE] = (float)_values[p1].getType();
+        outRow[Dataset::END_TYPE] = (float)_values[p2].getType();
+        outRow[Dataset::CONTINUITY] = edge.continuity;
+        outRow[Dataset::AT_CORNER] = _corners[_primitives[p1].endIdx] ? 1.f : 0.f;
+        outRow[Dataset::INFLECTION] = (_primitives[p1].endCurvSign != _primitives[p2].startCurvSign) ? 1.f : 0.f;
+        outRow[Dataset::START_LENGTH] = (float)(_values[p1].length() * _lengthScale);
+        outRow[Dataset::END_LENGTH] = (float)(_values[p2].length() * _lengthScale);
+        outRow[Dataset::START_ERROR] = (float)(_primitives[p1].error * SQR(_lengthScale));
+        outRow[Dataset::END_ERROR] = (float)(_primitives[p2].error * SQR(_lengthScale));
+        outRow[Dataset::POSITION_DIFF] = (float)(diffs[0] * _lengthScale);
+        outRow[Dataset::ANGLE_DIFF] = (float)diffs[1];
+        outRow[Dataset::CURVATURE_DIFF] = (float)(diffs[2] / _lengthScale);
+        outRow[Dataset::START_VERTEX_COST] = vertices[edge.startVtx].cost;
+        outRow[Dataset::END_VERTEX_COST] = vertices[edge.endVtx].cost;
+        outRow[Dataset::PREDICTED_COST] = edge.cost;
+        outRow[Dataset::VALIDATED_COST] = -1.f;
+    }
+
+    //false if every edge of this continuity out of p1 has infinite cost, so they need not be enumerated
+    bool continuityAllowed(int p1, int continuity) const
+    {
+        return _corners[_primitives[p1].endIdx] || _continuityCost[continuity] < Parameters::infinity;
+    }
+
 private:
     double _errorCost(double error) const
     {
         return _errorCostFactor * (error * SQR(_lengthScale)); //simple for now
     }
 
-    void _getExtraError(int p1, int p2, int continuity, double &outExtra1, double &outExtra2) const
+    //the continuity and inflection costs
+    double _fixedEdgeCost(int p1, int p2, int continuity) const
     {
-        //outExtra1 = outExtra2 = 0.;  return;
-        int offset = continuity;
-        if(continuity > 0 && _primitives[p1].endIdx == _primitives[p2].startIdx)
-            offset = 0; //one of the curve is a start or an end curve
-        Vector3d diffs = _getDiffs(p1, p2, offset);
-        for(int i = continuity + 1; i < 3; ++i)
-            diffs[i] = 0.; //don't count more than necessary
+        double out = 0.;
+
+        //continuity
+        if(!_corners[_primitives[p1].endIdx]) //no primitive spans a corner, so the start index is also there
+            out += _continuityCost[continuity];
 
-        double len1 = _primitives[p1].curve->length();
-        double len2 = _primitives[p2].curve->length();
+        //inflection
+        if(continuity > 1 && _primitives[p1].endCurvSign != _primitives[p2].startCurvSign)
+            out += _inflectionCost;
 
-        outExtra1 = diffs[0] * 0.5 + len1 * diffs[1] * 0.25 + SQR(len1) * diffs[2] * 0.125;
-        outExtra2 = diffs[0] * 0.5 + len2 * diffs[1] * 0.25 + SQR(len2) * diffs[2] * 0.125;
+        return out;
     }
 
     Vector3d _getDiffs(int p1, int p2, int offset) const
     {
         Vector3d out;
-        const PrimitiveCache &cache1 = _primitiveCache[p1];
-        const PrimitiveCache &cache2 = _primitiveCache[p2];
+        assert(offset < _primitiveCache.numVals(p1) && offset < _primitiveCache.numVals(p2));
 
         double minDistSq = Parameters::infinity;
         double minAngleDiff = TWOPI;
@@ -218,19 +330,19 @@ private:
         double maxCurvatureDiff = -minCurvatureDiff;
         for(int i = 0; i <= offset; ++i)
         {
-            const PrimitiveCacheData &d1 = cache1.end(offset - i);
-            const PrimitiveCacheData &d2 = cache2.start(i);
+            const PrimitiveCache::Values &d1 = _primitiveCache.end(offset - i);
+            const PrimitiveCache::Values &d2 = _primitiveCache.start(i);
 
             //position
-            minDistSq = min(minDistSq, Vector2d(d1.x - d2.x, d1.y - d2.y).squaredNorm());
+            minDistSq = min(minDistSq, Vector2d(d1.x[p1] - d2.x[p2], d1.y[p1] - d2.y[p2]).squaredNorm());
 
             //angle
-            double angleDiff = AngleUtils::toRange(d1.angle - d2.angle, -PI);
+            double angleDiff = AngleUtils::toRange(d1.angle[p1] - d2.angle[p2], -PI);
             minAngleDiff = min(angleDiff, minAngleDiff);
             maxAngleDiff = max(angleDiff, maxAngleDiff);
 
             //curvature
-            double cDiff = d1.curvature - d2.curvature;
+            double cDiff = d1.curvature[p1] - d2.curvature[p2];
             minCurvatureDiff = min(cDiff, minCurvatureDiff);
             maxCurvatureDiff = max(cDiff, maxCurvatureDiff);
         }
@@ -248,8 +360,9 @@ private:
     };
 
     const vector<FitPrimitive> &_primitives;
-    vector<PrimitiveCache> _primitiveCache;
+    const vector<PrimitiveValue> &_values;
     const VectorC<bool> &_corners;
+    PrimitiveCache _primitiveCache;
 
     double _curveCost[3];
     double _continuityCost[3];
@@ -270,7 +383,6 @@ protected:
     {
         const vector<FitPrimitive> &primitives = fitter.output<PRIMITIVE_FITTING>()->primitives;
         PolylineConstPtr poly = fitter.output<RESAMPLING>()->output;
-        VectorC<bool> corners = fitter.output<RESAMPLING>()->corners;
         smart_ptr<const AlgorithmOutput<OVERSKETCHING> > osOutput = fitter.output<OVERSKETCHING>();
         const VectorC<Vector2d> &pts = poly->pts();
         bool closed = poly->isClosed();
@@ -297,16 +409,6 @@ protected:
             }
 
             out.vertices[i].cost = (float)out.costEvaluator->vertexCost(i);
-
-            if(out.vertices[i].source && out.vertices[i].target) //one primitive over the entire curve--create dummy edge
-            {
-                Edge e;
-                e.continuity = -1;
-                e.startVtx = e.endVtx = i;
-                e.cost = out.vertices[i].cost;
-                out.vertices[i].edges.push_back((int)out.edges.size());
-                out.edges.push_back(e);
-            }
         }
 
         //create edges
@@ -315,86 +417,281 @@ protected:
             if(!primitives[i].isStartCurve())
                 curvesStartingAt[primitives[i].startIdx].push_back(i);
 
-        for(int i = 0; i < (int)primitives.size(); ++i)
+        //edges are created vertex by vertex, so the edges of each vertex are contiguous.  The vertices' edges
+        //are independent, so chunks of vertices get their edges in parallel, which are concatenated in order.
+        //A single chunk writes its edges straight into the output.
+        int numChunks = ((int)primitives.size() + verticesPerChunk - 1) / verticesPerChunk;
+        vector<vector<Edge> > chunkEdges(numChunks > 1 ? numChunks : 0);
+        out.edgeOffsets.resize(primitives.size() + 1);
+        parallelFor(numChunks, _EdgeChunkBody(fitter, out, curvesStartingAt, chunkEdges));
+
+        size_t numEdges = 0;
+        for(int c = 0; c < (int)chunkEdges.size(); ++c)
+            numEdges += chunkEdges[c].size();
+        out.edges.reserve(numEdges);
+        for(int c = 0; c < (int)chunkEdges.size(); ++c)
+        {
+            int offset = (int)out.edges.size(); //the chunk body left offsets within the chunk
+            for(int i = c * verticesPerChunk; i < min((int)primitives.size(), (c + 1) * verticesPerChunk); ++i)
+                out.edgeOffsets[i] += offset;
+            out.edges.insert(out.edges.end(), chunkEdges[c].begin(), chunkEdges[c].end());
+        }
+        out.edgeOffsets.back() = (int)out.edges.size();
+
+        CORNU_DEBUG(printf("Graph vertices = %d edges = %d", out.vertices.size(), out.edges.size()));
+    }
+
+private:
+    static const int verticesPerChunk = 128; //starting threads only pays off for this many vertices
+
+    class _EdgeChunkBody
+    {
+    public:
+        _EdgeChunkBody(const Fitter &fitter, AlgorithmOutput<GRAPH_CONSTRUCTION> &out, const VectorC<vector<int> > &curvesStartingAt,
+                       vector<vector<Edge> > &outEdges)
+            : _fitter(fitter), _out(out), _curvesStartingAt(curvesStartingAt), _outEdges(outEdges) {}
+
+        void operator()(int c) const
+        {
+            vector<int> seconds;
+            vector<double> costs;
+            vector<Edge> &edges = _outEdges.empty() ? _out.edges : _outEdges[c];
+            int end = min((int)_out.vertices.size(), (c + 1) * verticesPerChunk);
+            for(int i = c * verticesPerChunk; i < end; ++i)
+            {
+                _out.edgeOffsets[i] = (int)edges.size();
+                if(_fitter.cancelled())
+                    continue; //the output is discarded
+                _addEdges(_fitter, _out, i, _curvesStartingAt, edges, seconds, costs);
+            }
+        }
+
+    private:
+        const Fitter &_fitter;
+        AlgorithmOutput<GRAPH_CONSTRUCTION> &_out; //only the edge offsets of the chunk's vertices are written, and
+                                                   //the edges if there's a single chunk
+        const VectorC<vector<int> > &_curvesStartingAt;
+        vector<vector<Edge> > &_outEdges; //empty if there's a single chunk
+    };
+
+    //appends the edges out of vertex i; seconds and costs are scratch space
+    static void _addEdges(const Fitter &fitter, const AlgorithmOutput<GRAPH_CONSTRUCTION> &out, int i,
+                          const VectorC<vector<int> > &curvesStartingAt, vector<Edge> &edges, vector<int> &seconds, vector<double> &costs)
+    {
+        const vector<FitPrimitive> &primitives = fitter.output<PRIMITIVE_FITTING>()->primitives;
+        const vector<PrimitiveValue> &values = fitter.output<PRIMITIVE_FITTING>()->values;
+        bool closed = fitter.output<RESAMPLING>()->output->isClosed();
+        int maxEdges = (int)fitter.config().get(Parameters::MAX_EDGES_PER_VERTEX);
+        int begin = (int)edges.size();
+
+        if(out.vertices[i].source && out.vertices[i].target) //one primitive over the entire curve--create dummy edge
         {
-            if(primitives[i].isEndCurve()) //no edges from end curves
+            Edge e;
+            e.continuity = -1;
+            e.startVtx = e.endVtx = i;
+            e.cost = out.vertices[i].cost;
+            edges.push_back(e);
+        }
+
+        if(primitives[i].isEndCurve()) //no edges from end curves
+            return;
+
+        int endIdx = primitives[i].endIdx;
+        int curve1len = primitives[i].numPts - 1;
+
+        for(int continuity = 0; continuity <= 2; ++continuity)
+        {
+            if(!out.costEvaluator->continuityAllowed(i, continuity))
                 continue;
 
-            int endIdx = primitives[i].endIdx;
-            int curve1len = primitives[i].numPts - 1;
+            int offset = continuity;
+            int startIdx = endIdx - offset;
+            if(!closed && startIdx < 0)
+                continue;
+            if(curve1len <= offset * 2) //if the first curve is already too short
+                continue;
 
-            for(int continuity = 0; continuity <= 2; ++continuity)
+            bool firstCurveConstrained = (values[i].getType() < continuity) || primitives[i].isFixed();
+
+            seconds.clear();
+            for(int j = 0; j < (int)curvesStartingAt[startIdx].size(); ++j)
             {
-                int offset = continuity;
-                int startIdx = endIdx - offset;
-                if(!closed && startIdx < 0)
+                int k = curvesStartingAt[startIdx][j]; //index of the second primitive
+                int curve2len = primitives[k].numPts - 1;
+                if(curve2len <= offset * 2)
                     continue;
-                if(curve1len <= offset * 2) //if the first curve is already too short
+
+                bool secondCurveConstrained = (values[k].getType() < continuity) || primitives[k].isFixed();
+                if(firstCurveConstrained && secondCurveConstrained)
                     continue;
+                seconds.push_back(k);
+            }
+            costs.resize(seconds.size());
+            out.costEvaluator->edgeCosts(i, continuity, seconds.data(), (int)seconds.size(), costs.data());
+
+            for(int j = 0; j < (int)seconds.size(); ++j)
+            {
+                int k = seconds[j];
 
-                bool firstCurveConstrained = (primitives[i].curve->getType() < continuity) || primitives[i].isFixed();
-                int minType = firstCurveConstrained ? continuity : 0;
-
-                for(int j = 0; j < (int)curvesStartingAt[startIdx].size(); ++j)
-                {
-                    int k = curvesStartingAt[startIdx][j]; //index of the second primitive
-                    int curve2len = primitives[k].numPts - 1;
-                    if(curve2len <= offset * 2)
-                        continue;
-
-                    bool secondCurveConstrained = (primitives[k].curve->getType() < continuity) || primitives[k].isFixed();
-                    if(firstCurveConstrained && secondCurveConstrained)
-                        continue;
-
-                    //create edge
-                    Edge e;
-                    e.startVtx = i;
-                    e.endVtx = k;
-                    e.continuity = continuity;
-                    e.cost = (float)out.costEvaluator->edgeCost(i, k, continuity);
-                    e.cost += out.vertices[i].cost * (out.vertices[i].source ? 1.f : 0.5f);
-                    e.cost += out.vertices[k].cost * (out.vertices[k].target ? 1.f : 0.5f);
-                    if(e.cost >= Parameters::infinity)
-                        continue;
-                    out.vertices[i].edges.push_back((int)out.edges.size());
-                    out.edges.push_back(e);
-
-                    if(e.cost != e.cost)
-                        Debugging::get()->printf("Error! Nan cost for edge");
-                }
+                //create edge
+                Edge e;
+                e.startVtx = i;
+                e.endVtx = k;
+                e.continuity = continuity;
+                e.cost = (float)costs[j];
+                e.cost += out.vertices[i].cost * (out.vertices[i].source ? 1.f : 0.5f);
+                e.cost += out.vertices[k].cost * (out.vertices[k].target ? 1.f : 0.5f);
+                if(e.cost >= Parameters::infinity)
+                    continue;
+                edges.push_back(e);
+
+                if(e.cost != e.cost)
+                    CORNU_DEBUG(printf("Error! Nan cost for edge"));
             }
         }
 
-        Debugging::get()->printf("Graph vertices = %d edges = %d", out.vertices.size(), out.edges.size());
+        if(fitter.edgeCostModel())
+            _modelCosts(*fitter.edgeCostModel(), out, edges, begin);
+        if(maxEdges > 0)
+            _keepCheapest(edges, begin, maxEdges);
+    }
+
+    //replaces the costs of the edges from begin on (other than a dummy edge) with the model's, in one batch
+    static void _modelCosts(const EdgeCostModel &model, const AlgorithmOutput<GRAPH_CONSTRUCTION> &out, vector<Edge> &edges, int begin)
+    {
+        if(begin < (int)edges.size() && edges[begin].continuity < 0)
+            ++begin;
+
+        static thread_local Dataset batch;
+        static thread_local vector<float> costs;
+        batch.clear();
+        float row[Dataset::NUM_COLUMNS];
+        for(int i = begin; i < (int)edges.size(); ++i)
+        {
+            out.costEvaluator->edgeFeatures(edges[i], out.vertices, row);
+            batch.addRow(row);
+        }
+        costs.resize(batch.numRows());
+        model.costs(batch, costs.data());
+        for(int i = begin; i < (int)edges.size(); ++i)
+            edges[i].cost = max(0.f, costs[i - begin]); //the path search needs costs that aren't negative
     }
+
+    //removes all but the maxEdges cheapest edges from begin on (other than a dummy edge), keeping their order
+    static void _keepCheapest(vector<Edge> &edges, int begin, int maxEdges)
+    {
+        if(begin < (int)edges.size() && edges[begin].continuity < 0)
+            ++begin; //the dummy edge stays
+        if((int)edges.size() - begin <= maxEdges)
+            return;
+
+        vector<float> costs;
+        for(int i = begin; i < (int)edges.size(); ++i)
+            costs.push_back(edges[i].cost);
+        nth_element(costs.begin(), costs.begin() + (maxEdges - 1), costs.end());
+        float maxCost = costs[maxEdges - 1];
+
+        //keep the ones cheaper than the maxEdges'th cost and ties in order until there are maxEdges
+        int numCheaper = 0;
+        for(int i = 0; i < maxEdges; ++i)
+            numCheaper += (costs[i] < maxCost);
+        int tiesLeft = maxEdges - numCheaper;
+
+        int kept = begin;
+        for(int i = begin; i < (int)edges.size(); ++i)
+        {
+            if(edges[i].cost > maxCost || (edges[i].cost == maxCost && tiesLeft-- <= 0))
+                continue;
+            edges[kept++] = edges[i];
+        }
+        edges.resize(kept);
+    }
+};
+
+//Decides once the combination costs clearly less than predicted: then the edge is valid and its cost stays the
+//same.  The solve minimizes the point errors rather than the cost, so a cost just under the prediction may end up
+//over it.  A cost over the prediction isn't final--it becomes the edge's cost for the rest of the search.
+class EdgeCostDecider : public CombinationDecider
+{
+public:
+    EdgeCostDecider(const Edge &edge, const CostEvaluator &costEvaluator) : _edge(edge), _costEvaluator(costEvaluator) {}
+
+    bool decided(double err1, double err2) const
+    {
+        return _costEvaluator.edgeCost(_edge.startVtx, _edge.endVtx, _edge.continuity, err1, err2) <= 0.9 * _edge.cost;
+    }
+
+private:
+    const Edge &_edge;
+    const CostEvaluator &_costEvaluator;
 };
 
-float Edge::validatedCost(const Fitter &fitter) const
+//Builds the same graph as the default, along with the features of its edges for learning edge costs
+class DatasetGraphConstructor : public DefaultGraphConstructor
+{
+public:
+    string name() const { return "Dataset Generation"; }
+
+protected:
+    void _run(const Fitter &fitter, AlgorithmOutput<GRAPH_CONSTRUCTION> &out)
+    {
+        DefaultGraphConstructor::_run(fitter, out);
+
+        out.dataset = new Dataset();
+        float row[Dataset::NUM_COLUMNS];
+        for(int e = 0; e < (int)out.edges.size(); ++e)
+        {
+            if(out.edges[e].continuity < 0) //dummy edge
+                continue;
+            out.costEvaluator->edgeFeatures(out.edges[e], out.vertices, row); //the validated cost is left for generateDataset
+            out.dataset->addRow(row);
+        }
+    }
+};
+
+float Edge::validatedCost(const Fitter &fitter, Combination *outCombination) const
 {
     if(continuity < 0) //dummy edge
         return cost;
 
+    CORNU_COUNT(EDGE_VALIDATIONS, 1);
+    EdgeCostDecider decider(*this, *fitter.output<GRAPH_CONSTRUCTION>()->costEvaluator);
     Combination comb;
-    comb = twoCurveCombine(startVtx, endVtx, continuity, fitter);
+    comb = twoCurveCombine(startVtx, endVtx, continuity, fitter, &decider);
 
 #if 0
     if(fitter.output<GRAPH_CONSTRUCTION>()->vertices[startVtx].source)
     {
-        Debugging::get()->drawCurve(comb.c1, Debugging::Color(1, 0, 0), "Combined");
-        Debugging::get()->drawCurve(comb.c2, Debugging::Color(0.8, 0.5, 0), "Combined");
+        CORNU_DEBUG(drawCurve(comb.c1, Debugging::Color(1, 0, 0), "Combined"));
+        CORNU_DEBUG(drawCurve(comb.c2, Debugging::Color(0.8, 0.5, 0), "Combined"));
     }
 #endif
     
     float newCost;
      newCost = (float)fitter.output<GRAPH_CONSTRUCTION>()->costEvaluator->edgeCost(startVtx, endVtx, continuity, comb.err1, comb.err2);
 
+    if(outCombination)
+        *outCombination = comb;
+
     //only increase cost
     return max(newCost, cost);
 }
 
+void Edge::features(const Fitter &fitter, float *outRow) const
+{
+    smart_ptr<const AlgorithmOutput<GRAPH_CONSTRUCTION> > graph = fitter.output<GRAPH_CONSTRUCTION>();
+    graph->costEvaluator->edgeFeatures(*this, graph->vertices, outRow);
+}
+
+size_t AlgorithmOutput<GRAPH_CONSTRUCTION>::memoryBytes() const
+{
+    return vectorBytes(vertices) + vectorBytes(edges) + vectorBytes(edgeOffsets) + (costEvaluator ? costEvaluator->memoryBytes() : 0);
+}
+
 void Algorithm<GRAPH_CONSTRUCTION>::_initialize()
 {
     new DefaultGraphConstructor();
+    new DatasetGraphConstructor();
 }
 
 END_NAMESPACE_Cornu
@@ -32,10 +32,10 @@ struct Vertex
     bool source;
     bool target;
     float cost;
-
-    std::vector<int> edges; //edges that start at this vertex
 };
 
+struct Combination;
+
 struct Edge
 {
     int startVtx;
@@ -43,7 +43,10 @@ struct Edge
     char continuity; //continuity = -1 for a dummy edge from a vertex to itself
     float cost; //includes the half the cost of the vertex behind and the vertex in front (full cost for source and target vertices).
 
-    float validatedCost(const Fitter &fitter) const;
+    //if outCombination is not NULL, the two-curve combination used for validation is returned in it
+    float validatedCost(const Fitter &fitter, Combination *outCombination = NULL) const;
+    //the features of the edge as Dataset records them (NUM_COLUMNS of them), with no validated cost
+    void features(const Fitter &fitter, float *outRow) const;
 };
 
 CORNU_SMART_FORW_DECL(Dataset);
@@ -52,8 +55,12 @@ CORNU_SMART_FORW_DECL(CostEvaluator);
 template<>
 struct AlgorithmOutput<GRAPH_CONSTRUCTION> : public AlgorithmOutputBase
 {
+    //override
+    size_t memoryBytes() const;
+
     std::vector<Vertex> vertices;
-    std::vector<Edge> edges;
+    std::vector<Edge> edges; //sorted by start vertex
+    std::vector<int> edgeOffsets; //the edges that start at vertex i are edgeOffsets[i] through edgeOffsets[i + 1] - 1
     CostEvaluatorPtr costEvaluator;
     DatasetPtr dataset; //only if the algorithm selected is dataset generation
 };
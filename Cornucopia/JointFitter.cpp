@@ -0,0 +1,196 @@
+/*--
+    JointFitter.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "JointFitter.h"
+#include "Preprocessing.h"
+#include "PathFinder.h"
+#include "Polyline.h"
+#include "PrimitiveSequence.h"
+#include "Parallel.h"
+#include "Tracing.h"
+
+#include <chrono>
+
+using namespace std;
+using namespace Eigen;
+NAMESPACE_Cornu
+
+typedef chrono::steady_clock Clock;
+
+//runs the fitter of each stroke up to combining
+class _StrokeBody
+{
+public:
+    _StrokeBody(vector<Fitter> &fitters) : _fitters(fitters) {}
+
+    void operator()(int i) const
+    {
+        CORNU_TRACE_SCOPE("Stroke");
+        _fitters[i].runUntil(COMBINING);
+    }
+
+private:
+    vector<Fitter> &_fitters;
+};
+
+class JointFitter::_ComponentBody
+{
+public:
+    _ComponentBody(JointFitter &fitter, const vector<vector<int> > &strokes, const vector<vector<StrokeIncidence> > &incidences)
+        : _fitter(fitter), _strokes(strokes), _incidences(incidences) {}
+
+    void operator()(int i) const { _fitter._runComponent(_strokes[i], _incidences[i]); }
+
+private:
+    JointFitter &_fitter;
+    const vector<vector<int> > &_strokes;
+    const vector<vector<StrokeIncidence> > &_incidences;
+};
+
+static int findRoot(vector<int> &parents, int i)
+{
+    while(parents[i] != i)
+        i = parents[i] = parents[parents[i]];
+    return i;
+}
+
+void JointFitter::clear()
+{
+    _sketches.clear();
+    _incidences.clear();
+    _fitters.clear();
+}
+
+void JointFitter::run(int numThreads)
+{
+    CORNU_TRACE_SCOPE("JointFitter::run");
+    int n = numStrokes();
+    vector<Fitter>(n).swap(_fitters);
+    for(int i = 0; i < n; ++i)
+    {
+        _fitters[i].setParams(_params);
+        _fitters[i].setOriginalSketch(_sketches[i]);
+        _fitters[i].setTimeBudget(_timeBudget);
+        _fitters[i].setCancellationToken(_cancellationToken);
+    }
+    parallelFor(n, _StrokeBody(_fitters), numThreads);
+
+    //the strokes joined by incidences are solved for together
+    vector<StrokeIncidence> incidences = _usableIncidences();
+    vector<int> parents(n);
+    for(int i = 0; i < n; ++i)
+        parents[i] = i;
+    for(int i = 0; i < (int)incidences.size(); ++i)
+        parents[findRoot(parents, incidences[i].stroke)] = findRoot(parents, incidences[i].other);
+
+    vector<int> componentOf(n, -1), indexInComponent(n);
+    vector<vector<int> > componentStrokes;
+    for(int i = 0; i < n; ++i)
+    {
+        int root = findRoot(parents, i);
+        if(componentOf[root] < 0)
+        {
+            componentOf[root] = (int)componentStrokes.size();
+            componentStrokes.push_back(vector<int>());
+        }
+        componentOf[i] = componentOf[root];
+        indexInComponent[i] = (int)componentStrokes[componentOf[i]].size();
+        componentStrokes[componentOf[i]].push_back(i);
+    }
+
+    vector<vector<StrokeIncidence> > componentIncidences(componentStrokes.size());
+    for(int i = 0; i < (int)incidences.size(); ++i)
+    {
+        StrokeIncidence incidence = incidences[i];
+        int component = componentOf[incidence.stroke];
+        incidence.stroke = indexInComponent[incidence.stroke];
+        incidence.other = indexInComponent[incidence.other];
+        componentIncidences[component].push_back(incidence);
+    }
+
+    parallelFor((int)componentStrokes.size(), _ComponentBody(*this, componentStrokes, componentIncidences), numThreads);
+}
+
+vector<StrokeIncidence> JointFitter::_usableIncidences() const
+{
+    int n = numStrokes();
+    vector<char> fitted(n), closed(n);
+    for(int i = 0; i < n; ++i)
+    {
+        fitted[i] = _fitters[i].output<PATH_FINDING>() && !_fitters[i].output<PATH_FINDING>()->path.empty();
+        closed[i] = fitted[i] && _fitters[i].output<CURVE_CLOSING>()->closed;
+    }
+
+    //ends that already meet (through end to end incidences) are in the same set
+    vector<int> parents(2 * n);
+    for(int i = 0; i < 2 * n; ++i)
+        parents[i] = i;
+
+    vector<StrokeIncidence> out;
+    for(int i = 0; i < (int)_incidences.size(); ++i)
+    {
+        const StrokeIncidence &incidence = _incidences[i];
+        if(incidence.stroke < 0 || incidence.stroke >= n || incidence.other < 0 || incidence.other >= n)
+            continue;
+        if(incidence.place == StrokeIncidence::ANYWHERE || !fitted[incidence.stroke] || !fitted[incidence.other] || closed[incidence.stroke])
+            continue;
+        if(incidence.otherPlace != StrokeIncidence::ANYWHERE)
+        {
+            if(closed[incidence.other])
+                continue;
+            int end = findRoot(parents, 2 * incidence.stroke + incidence.place);
+            int otherEnd = findRoot(parents, 2 * incidence.other + incidence.otherPlace);
+            if(end == otherEnd)
+                continue;
+            parents[end] = otherEnd;
+        }
+        out.push_back(incidence);
+    }
+    return out;
+}
+
+void JointFitter::_runComponent(const vector<int> &strokes, const vector<StrokeIncidence> &incidences)
+{
+    if(incidences.empty())
+    {
+        _fitters[strokes[0]].run();
+        return;
+    }
+
+    CORNU_TRACE_SCOPE("Joint combining");
+    Clock::time_point start = Clock::now();
+    vector<const Fitter *> fitters;
+    for(int i = 0; i < (int)strokes.size(); ++i)
+        fitters.push_back(&(_fitters[strokes[i]]));
+    vector<AlgorithmOutputBasePtr> outputs = combineJointly(fitters, incidences);
+    long long nanoseconds = chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start).count();
+
+    for(int i = 0; i < (int)strokes.size(); ++i)
+    {
+        Fitter &fitter = _fitters[strokes[i]];
+        if(!fitter.cancelled()) //otherwise the solve may have stopped partway, and run stops without a fit
+            fitter._outputs[COMBINING] = outputs[i];
+        fitter._stats.stageNanoseconds[COMBINING] += nanoseconds;
+        fitter._stats.totalNanoseconds += nanoseconds;
+        fitter.run(); //finishes the fit with the output there
+    }
+}
+
+END_NAMESPACE_Cornu
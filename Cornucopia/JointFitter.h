@@ -0,0 +1,87 @@
+/*--
+    JointFitter.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_JOINTFITTER_H_INCLUDED
+#define CORNUCOPIA_JOINTFITTER_H_INCLUDED
+
+#include "defs.h"
+#include "Fitter.h"
+#include "Combiner.h"
+
+#include <vector>
+
+NAMESPACE_Cornu
+
+//Fits several strokes together, so that the ends that should touch another stroke do, instead of snapping
+//the separate fits afterwards.  Each stroke gets its own fitter, and the fitters run (in parallel) through
+//path finding as if the strokes were alone.  The strokes joined by incidences, directly or through other
+//strokes, are then combined in one solve (see combineJointly in Combiner.h): their curves are solved for
+//together, with the incidences as constraints like the joints between the curves.  That solve is linear in
+//the total number of primitives, with a dense part that grows with the square of the number of incidences.
+//The strokes without incidences are combined alone and get the fits Fitter::run gives them.
+//Incidences that can't be used are ignored: ones with an end of a closed stroke (only ANYWHERE works on
+//those), ones with a stroke that couldn't be fitted, and ones that only say again that ends already joined
+//by other incidences meet.  There is no oversketching here.
+class JointFitter
+{
+public:
+    JointFitter() : _timeBudget(0.) {}
+
+    const Parameters &params() const { return _params; }
+    void setParams(const Parameters &params) { _params = params; }
+
+    //Given to every stroke's fitter (see Fitter::setTimeBudget and Fitter::setCancellationToken).  The joint
+    //solves check them too: past the deadline they take few iterations, and once the token is cancelled they
+    //stop, and their strokes are left without fits.
+    void setTimeBudget(double milliseconds) { _timeBudget = milliseconds; }
+    void setCancellationToken(CancellationTokenConstPtr token) { _cancellationToken = token; }
+
+    int addStroke(PolylineConstPtr sketch) { _sketches.push_back(sketch); return (int)_sketches.size() - 1; } //returns the stroke's index
+    void addIncidence(const StrokeIncidence &incidence) { _incidences.push_back(incidence); }
+    void clear(); //forgets the strokes, the incidences and the fits
+
+    int numStrokes() const { return (int)_sketches.size(); }
+    const std::vector<StrokeIncidence> &incidences() const { return _incidences; }
+
+    //Fits all the strokes from scratch, using up to numThreads threads (0 means one per core).  The time of a
+    //joint solve is counted in the combining time of each of its strokes.
+    void run(int numThreads = 0);
+
+    //after run
+    const Fitter &fitter(int stroke) const { return _fitters[stroke]; }
+    PrimitiveSequenceConstPtr output(int stroke) const { return _fitters[stroke].finalOutput(); } //null if the fit failed
+
+private:
+    class _ComponentBody;
+
+    std::vector<StrokeIncidence> _usableIncidences() const;
+    void _runComponent(const std::vector<int> &strokes, const std::vector<StrokeIncidence> &incidences); //incidences index strokes
+
+    Parameters _params;
+    double _timeBudget;
+    CancellationTokenConstPtr _cancellationToken;
+    std::vector<PolylineConstPtr> _sketches;
+    std::vector<StrokeIncidence> _incidences;
+    std::vector<Fitter> _fitters;
+};
+
+END_NAMESPACE_Cornu
+
+#endif //CORNUCOPIA_JOINTFITTER_H_INCLUDED
@@ -19,6 +19,7 @@
 */
 
 #include "Line.h"
+#include "WorkCounters.h"
 
 using namespace std;
 using namespace Eigen;
@@ -56,6 +57,7 @@ bool Line::isValidImpl() const
 
 double Line::project(const Vec &point) const
 {
+    CORNU_COUNT(LINE_PROJECTIONS, 1);
     return min(_length(), max(0., _der.dot(point - _startPos())));
 }
 
@@ -69,6 +71,39 @@ void Line::eval(double s, Vec *pos, Vec *der, Vec *der2) const
         *der2 = Vec::Zero();
 }
 
+void Line::evalMany(const double *s, int n, Vec *pos, Vec *der, Vec *der2) const
+{
+    for(int i = 0; i < n; ++i)
+        Line::eval(s[i], pos ? pos + i : NULL, der ? der + i : NULL, der2 ? der2 + i : NULL);
+}
+
+void Line::projectMany(const Vec *points, int n, double *out) const
+{
+    for(int i = 0; i < n; ++i)
+        out[i] = Line::project(points[i]);
+}
+
+double Line::distanceSqTo(const Vec &point) const
+{
+    double out;
+    Line::distanceSqMany(&point, 1, &out);
+    return out;
+}
+
+//The loop has no branches or calls, so the compiler vectorizes it
+void Line::distanceSqMany(const Vec *points, int n, double *out) const
+{
+    const double startX = _params[X], startY = _params[Y], dirX = _der[0], dirY = _der[1], length = _length();
+    for(int i = 0; i < n; ++i)
+    {
+        double x = points[i][0] - startX, y = points[i][1] - startY;
+        double t = min(length, max(0., dirX * x + dirY * y));
+        x -= t * dirX;
+        y -= t * dirY;
+        out[i] = x * x + y * y;
+    }
+}
+
 void Line::trim(double sFrom, double sTo)
 {
     Vec newStart = _startPos() + sFrom * _der;
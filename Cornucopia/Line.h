@@ -38,6 +38,11 @@ public:
     void eval(double s, Vec *pos, Vec *der = NULL, Vec *der2 = NULL) const;
 
     double project(const Vec &point) const;
+    void evalMany(const double *s, int n, Vec *pos, Vec *der = NULL, Vec *der2 = NULL) const;
+    void projectMany(const Vec *points, int n, double *out) const;
+    double distanceSqTo(const Vec &point) const;
+    void distanceSqMany(const Vec *points, int n, double *out) const;
+    void tessellate(double tolerance, PointVector &out) const { out.push_back(_startPos()); out.push_back(pos(_length())); }
 
     Vec pos(double s) const { return _startPos() + s * _der; }
     Vec der(double s) const { return _der; }
@@ -58,13 +63,14 @@ public:
     void derivativeAt(double s, ParamDer &out, ParamDer &outTan) const;
     void derivativeAtEnd(int continuity, EndDer &out) const;
 
-    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 protected:
     //override
     void _paramsChanged() { _der = Vec(cos(_startAngle()), sin(_startAngle())); }
     bool isValidImpl() const;
 
 private:
+    friend struct PrimitiveValue;
+
     Vec _der;
 };
 
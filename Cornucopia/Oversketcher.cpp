@@ -50,8 +50,9 @@ protected:
             return;
         }
 
-        const double threshold = fitter.params().get(Parameters::OVERSKETCH_THRESHOLD);
+        const double threshold = fitter.config().get(Parameters::OVERSKETCH_THRESHOLD);
         const double peelback = 2. * threshold;
+        //the base curve keeps a tree of its primitives' bounding boxes, so these don't try every primitive
         double startParam = base->project(curve->startPos());
         double endParam = base->project(curve->endPos());
         Vector2d startOnBase = base->pos(startParam);
@@ -118,7 +119,10 @@ protected:
         PiecewiseLinearMonotone prevToCur(PiecewiseLinearMonotone::POSITIVE);
 
         //construct the transitions
-        VectorC<Vector2d> cur = curve->trimmed(startSketchTransition, endSketchTransition)->pts();
+        PolylineView kept = curve->trimmedView(startSketchTransition, endSketchTransition); //only its points are needed
+        VectorC<Vector2d> cur(kept.numPts(), kept.isClosed() ? CIRCULAR : NOT_CIRCULAR);
+        for(int i = 0; i < kept.numPts(); ++i)
+            cur[i] = kept.pt(i);
         VectorC<Vector2d> pre, post;
         if(startClose)
         {
@@ -145,6 +149,7 @@ protected:
         pre.insert(pre.end(), cur.begin(), cur.end());
         pre.insert(pre.end(), post.begin(), post.end());
         out.output = new Polyline(pre);
+        prevToCur.freeze();
         prevToCur.batchEval(out.parameters);
 
         //construct the trimmed toAppend and toPrepend curves
@@ -170,28 +175,39 @@ protected:
             }
         }
 
-        Debugging::get()->drawCurve(base, Debugging::Color(0, 0, 0), "Base Curve", 1., Debugging::DASHED);
-        Debugging::get()->drawCurve(out.output, Debugging::Color(1, 0, 1), "Oversketch Modified");
+        CORNU_DEBUG(drawCurve(base, Debugging::Color(0, 0, 0), "Base Curve", 1., Debugging::DASHED));
+        CORNU_DEBUG(drawCurve(out.output, Debugging::Color(1, 0, 1), "Oversketch Modified"));
         if(out.startCurve)
-            Debugging::get()->drawPrimitive(out.startCurve, "Start Curve", 0, 2);
+            CORNU_DEBUG(drawPrimitive(out.startCurve, "Start Curve", 0, 2));
         if(out.endCurve)
-            Debugging::get()->drawPrimitive(out.endCurve, "End Curve", 0, 2);
+            CORNU_DEBUG(drawPrimitive(out.endCurve, "End Curve", 0, 2));
         if(out.toAppend)
-            Debugging::get()->drawCurve(out.toAppend, Debugging::Color(1, 0, 0), "To Append");
+            CORNU_DEBUG(drawCurve(out.toAppend, Debugging::Color(1, 0, 0), "To Append"));
         if(out.toPrepend)
-            Debugging::get()->drawCurve(out.toPrepend, Debugging::Color(1, 0, 0), "To Prepend");
+            CORNU_DEBUG(drawCurve(out.toPrepend, Debugging::Color(1, 0, 0), "To Prepend"));
     }
 
     static VectorC<Vector2d> buildTransition(CurveConstPtr from, CurveConstPtr to, double fromStart, double fromEnd, double toStart, double toEnd, int numSteps)
     {
+        vector<double> fromT(numSteps), toT(numSteps);
+        for(int i = 0; i < numSteps; ++i)
+        {
+            double t = double(i) / double(numSteps - 1);
+            fromT[i] = fromStart + t * (fromEnd - fromStart);
+            toT[i] = toStart + t * (toEnd - toStart);
+        }
+
+        //the parameters increase, so batch evaluation doesn't search the base curve for each one
+        Curve::PointVector fromPos(numSteps), toPos(numSteps);
+        from->evalMany(&(fromT[0]), numSteps, &(fromPos[0]));
+        to->evalMany(&(toT[0]), numSteps, &(toPos[0]));
+
         VectorC<Vector2d> out(numSteps, NOT_CIRCULAR);
         for(int i = 0; i < numSteps; ++i)
         {
             double t = double(i) / double(numSteps - 1);
-            double fromT = fromStart + t * (fromEnd - fromStart);
-            double toT = toStart + t * (toEnd - toStart);
             double smoothT = t * t * (3. - 2. * t);
-            out[i] = from->pos(fromT) * (1. - smoothT) + to->pos(toT) * smoothT;
+            out[i] = fromPos[i] * (1. - smoothT) + toPos[i] * smoothT;
         }
 
         return out;
@@ -206,6 +222,11 @@ protected:
     }
 };
 
+size_t AlgorithmOutput<OVERSKETCHING>::memoryBytes() const
+{
+    return (output ? output->memoryBytes() : 0) + vectorBytes(parameters);
+}
+
 void Algorithm<OVERSKETCHING>::_initialize()
 {
     new DefaultOversketcher();
@@ -29,9 +29,16 @@ NAMESPACE_Cornu
 CORNU_SMART_FORW_DECL(Polyline);
 CORNU_SMART_FORW_DECL(PrimitiveSequence);
 
+//When oversketching, output is only the new stroke with transitions to the base, and the rest of the fit works
+//on it alone, between fixed copies of the base primitives where the transitions start (startCurve and endCurve).
+//The combiner splices the result between toPrepend and toAppend, the parts of the base left as they were, so an
+//edit of a long base takes about as long as fitting the stroke.
 template<>
 struct AlgorithmOutput<OVERSKETCHING> : public AlgorithmOutputBase
 {
+    //override
+    size_t memoryBytes() const;
+
     PolylineConstPtr output;
     std::vector<double> parameters; //parameters[i] is the parameter in output of the original point with index i
     CurvePrimitiveConstPtr startCurve;
@@ -0,0 +1,263 @@
+/*--
+    PackedPrimitiveSequence.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PackedPrimitiveSequence.h"
+#include "PrimitiveSequence.h"
+#include "BoxTree.h"
+#include "Line.h"
+#include "Arc.h"
+#include "Clothoid.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace Eigen;
+NAMESPACE_Cornu
+
+static atomic<uint64_t> nextPackedId(1);
+
+PackedPrimitiveSequence::PackedPrimitiveSequence(const PrimitiveSequence &sequence)
+    : _closed(sequence.isClosed()), _id(nextPackedId++), _tree(NULL)
+{
+    const VectorC<CurvePrimitiveConstPtr> &primitives = sequence.primitives();
+    int n = primitives.size();
+    assert(n > 0 && "a PrimitiveSequence has at least one primitive");
+    _origin = n > 0 ? primitives[0]->startPos() : Vec(0., 0.); //without asserts, an empty one packs to an empty one
+    _x.resize(n);
+    _y.resize(n);
+    _angle.resize(n);
+    _curvature.resize(n, 0.f);
+    _dcurvature.resize(n, 0.f);
+    _lengths.resize(n + 1, 0.);
+    _types.resize((n + 3) / 4, 0);
+    for(int i = 0; i < n; ++i)
+    {
+        const CurvePrimitive::ParamVec &params = primitives[i]->params();
+        _x[i] = (float)(params[CurvePrimitive::X] - _origin[0]);
+        _y[i] = (float)(params[CurvePrimitive::Y] - _origin[1]);
+        _angle[i] = (float)params[CurvePrimitive::ANGLE];
+        if(params.size() > CurvePrimitive::CURVATURE)
+            _curvature[i] = (float)params[CurvePrimitive::CURVATURE];
+        if(params.size() > CurvePrimitive::DCURVATURE)
+            _dcurvature[i] = (float)params[CurvePrimitive::DCURVATURE];
+        _lengths[i + 1] = _lengths[i] + params[CurvePrimitive::LENGTH];
+        _types[i / 4] |= (uint8_t)(primitives[i]->getType() << (2 * (i % 4)));
+    }
+}
+
+PackedPrimitiveSequence::~PackedPrimitiveSequence()
+{
+    delete _tree.load();
+}
+
+PrimitiveSequencePtr PackedPrimitiveSequence::unpacked() const
+{
+    VectorC<CurvePrimitiveConstPtr> primitives(numPrimitives(), _closed ? CIRCULAR : NOT_CIRCULAR);
+    for(int i = 0; i < numPrimitives(); ++i)
+        primitives[i] = primitive(i);
+    return new PrimitiveSequence(primitives);
+}
+
+//One primitive of each type per thread, of which only the last one set up is current
+struct PackedPrimitiveCache
+{
+    PackedPrimitiveCache() : id(0), idx(-1) {}
+
+    uint64_t id;
+    int idx;
+    CurvePrimitive *current;
+    Line line;
+    Arc arc;
+    Clothoid clothoid;
+};
+
+const CurvePrimitive &PackedPrimitiveSequence::_primitive(int i) const
+{
+    static thread_local PackedPrimitiveCache cache;
+    if(cache.id == _id && cache.idx == i)
+        return *cache.current;
+
+    CurvePrimitive::PrimitiveType primitiveType = type(i);
+    CurvePrimitive::ParamVec params(4 + primitiveType);
+    params[CurvePrimitive::X] = _origin[0] + _x[i];
+    params[CurvePrimitive::Y] = _origin[1] + _y[i];
+    params[CurvePrimitive::ANGLE] = _angle[i];
+    params[CurvePrimitive::LENGTH] = _lengths[i + 1] - _lengths[i];
+    if(primitiveType >= CurvePrimitive::ARC)
+        params[CurvePrimitive::CURVATURE] = _curvature[i];
+    if(primitiveType == CurvePrimitive::CLOTHOID)
+        params[CurvePrimitive::DCURVATURE] = _dcurvature[i];
+
+    if(primitiveType == CurvePrimitive::LINE)
+        cache.current = &cache.line;
+    else if(primitiveType == CurvePrimitive::ARC)
+        cache.current = &cache.arc;
+    else
+        cache.current = &cache.clothoid;
+    cache.current->setParams(params);
+    cache.id = _id;
+    cache.idx = i;
+    return *cache.current;
+}
+
+int PackedPrimitiveSequence::paramToIdx(double param, double *outParam) const
+{
+    int idx = (int)min(std::upper_bound(_lengths.begin(), _lengths.end(), param) - _lengths.begin(), (ptrdiff_t)_lengths.size() - 1) - 1;
+    if(outParam)
+        *outParam = param - _lengths[idx];
+    return idx;
+}
+
+double PackedPrimitiveSequence::_wrap(double s) const
+{
+    if(!_closed)
+        return s;
+    s = fmod(s, _lengths.back());
+    return s < 0. ? s + _lengths.back() : s;
+}
+
+void PackedPrimitiveSequence::eval(double s, Vec *pos, Vec *der, Vec *der2) const
+{
+    double localS;
+    int idx = paramToIdx(_wrap(s), &localS);
+    _primitive(idx).eval(localS, pos, der, der2);
+}
+
+void PackedPrimitiveSequence::evalMany(const double *s, int n, Vec *pos, Vec *der, Vec *der2) const
+{
+    static thread_local vector<double> localS;
+    static thread_local vector<int> idcs;
+    localS.resize(n);
+    idcs.resize(n);
+    for(int i = 0; i < n; ++i)
+        idcs[i] = max(0, paramToIdx(_wrap(s[i]), &(localS[i])));
+
+    //consecutive arguments on the same primitive are passed to it as one batch
+    for(int start = 0; start < n; )
+    {
+        int end = start + 1;
+        while(end < n && idcs[end] == idcs[start])
+            ++end;
+        _primitive(idcs[start]).evalMany(&(localS[start]), end - start,
+                                         pos ? pos + start : NULL, der ? der + start : NULL, der2 ? der2 + start : NULL);
+        start = end;
+    }
+}
+
+const BoxTree *PackedPrimitiveSequence::_primitiveTree() const
+{
+    BoxTree *tree = _tree.load(memory_order_acquire);
+    if(tree)
+        return tree;
+
+    //the same boxes as PrimitiveSequence's
+    const int numSamples = 8;
+    vector<BoxTree::Box> boxes(numPrimitives());
+    for(int i = 0; i < (int)boxes.size(); ++i)
+    {
+        const CurvePrimitive &curve = _primitive(i);
+        boxes[i].extend(curve.startPos());
+        boxes[i].extend(curve.endPos());
+        if(curve.getType() == CurvePrimitive::LINE)
+            continue;
+        for(int j = 1; j < numSamples; ++j)
+            boxes[i].extend(curve.pos(curve.length() * double(j) / double(numSamples)));
+        boxes[i].inflate(0.5 * curve.length() / double(numSamples));
+    }
+
+    BoxTree *newTree = new BoxTree(boxes);
+    if(_tree.compare_exchange_strong(tree, newTree, memory_order_acq_rel))
+        return newTree;
+    delete newTree;
+    return tree;
+}
+
+double PackedPrimitiveSequence::_closest(const Vec &point, double *outDistSq, int startIdx, double localS) const
+{
+    double bestS = 0.;
+    double minDistSq = 1e50;
+    int bestIdx = startIdx;
+    if(startIdx >= 0)
+    {
+        bestS = _lengths[startIdx] + localS;
+        minDistSq = (_primitive(startIdx).pos(localS) - point).squaredNorm();
+    }
+
+    _primitiveTree()->visit(point, minDistSq, [&](int i)
+    {
+        if(i == startIdx)
+            return;
+        const CurvePrimitive &primitive = _primitive(i);
+        double localS = primitive.project(point);
+        double distSq = (primitive.pos(localS) - point).squaredNorm();
+        if(distSq < minDistSq || (distSq == minDistSq && bestIdx > i))
+        {
+            minDistSq = distSq;
+            bestS = _lengths[i] + localS;
+            bestIdx = i;
+        }
+    });
+
+    if(outDistSq)
+        *outDistSq = minDistSq;
+    return bestS;
+}
+
+double PackedPrimitiveSequence::project(const Vec &point) const
+{
+    return _closest(point, NULL);
+}
+
+double PackedPrimitiveSequence::projectNear(const Vec &point, double sHint) const
+{
+    sHint = _wrap(sHint);
+    int idx = max(0, paramToIdx(sHint));
+    double localS = _primitive(idx).projectNear(point, sHint - _lengths[idx]);
+    return _closest(point, NULL, idx, localS);
+}
+
+double PackedPrimitiveSequence::distanceSqTo(const Vec &point) const
+{
+    double distSq;
+    _closest(point, &distSq);
+    return distSq;
+}
+
+void PackedPrimitiveSequence::tessellate(double tolerance, PointVector &out) const
+{
+    for(int i = 0; i < numPrimitives(); ++i)
+    {
+        size_t first = out.size();
+        _primitive(i).tessellate(tolerance, out);
+        if(i > 0) //the joint is the end of the previous primitive
+            out.erase(out.begin() + first);
+    }
+}
+
+size_t PackedPrimitiveSequence::memoryUsage() const
+{
+    size_t out = sizeof(*this);
+    out += (_x.capacity() + _y.capacity() + _angle.capacity() + _curvature.capacity() + _dcurvature.capacity()) * sizeof(float);
+    out += _lengths.capacity() * sizeof(double);
+    out += _types.capacity();
+    return out;
+}
+
+END_NAMESPACE_Cornu
@@ -0,0 +1,94 @@
+/*--
+    PackedPrimitiveSequence.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_PACKEDPRIMITIVESEQUENCE_H_INCLUDED
+#define CORNUCOPIA_PACKEDPRIMITIVESEQUENCE_H_INCLUDED
+
+#include "defs.h"
+#include "CurvePrimitive.h"
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+
+NAMESPACE_Cornu
+
+CORNU_SMART_FORW_DECL(PrimitiveSequence);
+CORNU_SMART_FORW_DECL(PackedPrimitiveSequence);
+class BoxTree;
+
+/*
+    An immutable PrimitiveSequence stored compactly, for keeping many fitted curves in memory.  The parameters are in
+    an array each: the start points as floats relative to the first one, the angles and curvatures as floats, and the
+    lengths as the doubles that sum them up.  The types take 2 bits each.  That's under 30 bytes a primitive, where a
+    PrimitiveSequence has a primitive object of 100 to 200 bytes, plus its pointer and length.
+
+    The primitives are made from the parameters when they're needed, one at a time: each thread keeps the one it made
+    last, so evaluating the curve at increasing parameters makes each primitive once.  The bounding box tree for
+    projection is built when first needed, as in PrimitiveSequence.  Packing rounds the positions, angles and
+    curvatures to floats, which moves the curve by about 1e-7 of its extent.
+*/
+class PackedPrimitiveSequence : public Curve
+{
+public:
+    PackedPrimitiveSequence(const PrimitiveSequence &sequence);
+    ~PackedPrimitiveSequence();
+
+    PrimitiveSequencePtr unpacked() const;
+
+    int numPrimitives() const { return (int)_lengths.size() - 1; }
+    CurvePrimitive::PrimitiveType type(int i) const { return CurvePrimitive::PrimitiveType((_types[i / 4] >> (2 * (i % 4))) & 3); }
+    CurvePrimitivePtr primitive(int i) const { return _primitive(i).clone(); }
+
+    //overrides
+    double length() const { return _lengths.back(); }
+    bool isClosed() const { return _closed; }
+
+    void eval(double s, Vec *pos, Vec *der = NULL, Vec *der2 = NULL) const;
+    void evalMany(const double *s, int n, Vec *pos, Vec *der = NULL, Vec *der2 = NULL) const;
+    double project(const Vec &point) const;
+    double projectNear(const Vec &point, double sHint) const;
+    double distanceSqTo(const Vec &point) const;
+    void tessellate(double tolerance, PointVector &out) const; //each primitive's, without repeating the joints
+
+    int paramToIdx(double param, double *outParam = NULL) const; //as in PrimitiveSequence
+    size_t memoryUsage() const; //in bytes, not counting the box tree
+
+private:
+    PackedPrimitiveSequence(const PackedPrimitiveSequence &); //immutable, so there's no reason to copy
+    PackedPrimitiveSequence &operator=(const PackedPrimitiveSequence &);
+
+    const CurvePrimitive &_primitive(int i) const; //the calling thread's, valid until it makes another
+    double _wrap(double s) const;
+    double _closest(const Vec &point, double *outDistSq, int startIdx = -1, double localS = 0.) const;
+    const BoxTree *_primitiveTree() const;
+
+    Eigen::Vector2d _origin;
+    std::vector<float> _x, _y; //relative to _origin
+    std::vector<float> _angle, _curvature, _dcurvature;
+    std::vector<double> _lengths; //as in PrimitiveSequence
+    std::vector<uint8_t> _types; //four to a byte, from the low bits
+    bool _closed;
+    uint64_t _id; //unique, for the threads' primitives to know whose they are
+    mutable std::atomic<BoxTree *> _tree;
+};
+
+END_NAMESPACE_Cornu
+
+#endif //CORNUCOPIA_PACKEDPRIMITIVESEQUENCE_H_INCLUDED
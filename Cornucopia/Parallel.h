@@ -0,0 +1,111 @@
+/*--
+    Parallel.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_PARALLEL_H_INCLUDED
+#define CORNUCOPIA_PARALLEL_H_INCLUDED
+
+#include "defs.h"
+#include "WorkCounters.h"
+#include "Fresnel.h"
+
+#include <vector>
+#include <thread>
+#include <atomic>
+
+NAMESPACE_Cornu
+
+inline int numHardwareThreads()
+{
+    int out = (int)std::thread::hardware_concurrency();
+    return out > 0 ? out : 1;
+}
+
+//True on a thread that is running parallelFor work.  Used to run nested parallelFor's serially,
+//so fitting many strokes in parallel doesn't multiply the thread count.
+inline bool &_inParallelFor()
+{
+    static thread_local bool inParallelFor = false;
+    return inParallelFor;
+}
+
+//Calls body(i) for every i in [0, num) using up to numThreads threads (0 means one per core).
+//Indices are handed out one at a time from a shared counter, so threads that get cheap items
+//simply take more of them and uneven workloads balance themselves.
+//Worker threads have their debugging output discarded (see Debugging::setForCurrentThread)
+//because Debugging implementations are generally not thread-safe.  The calling thread takes
+//part in the work and keeps its debugging output.  Calls from inside a body run serially.
+//A body that wants its output can set a DebuggingRing for its thread while it runs.
+//The work counted on the worker threads (see WorkCounters.h) is added to the calling thread's counts.
+//The workers evaluate clothoids with the calling thread's Fresnel tier (see Fresnel.h).
+template<class Body>
+void parallelFor(int num, const Body &body, int numThreads = 0)
+{
+    if(numThreads <= 0)
+        numThreads = numHardwareThreads();
+    if(numThreads > num)
+        numThreads = num;
+
+    if(numThreads <= 1 || _inParallelFor())
+    {
+        for(int i = 0; i < num; ++i)
+            body(i);
+        return;
+    }
+
+    std::atomic<int> next(0);
+
+    struct Worker
+    {
+        //worker threads (but not the calling thread) return the work they counted in outCounters
+        static void work(const Body &body, std::atomic<int> &next, int num, FresnelTier::Tier tier, WorkCounters *outCounters)
+        {
+            FresnelTier::Scope fresnelScope(tier);
+            bool quiet = (outCounters != NULL);
+            WorkCounters startCounters = WorkCounters::current();
+            if(quiet)
+                Debugging::setForCurrentThread(Debugging::null());
+            _inParallelFor() = true;
+            for(int i = next++; i < num; i = next++)
+                body(i);
+            _inParallelFor() = false;
+            if(quiet)
+                Debugging::setForCurrentThread(NULL);
+            if(outCounters)
+                *outCounters = WorkCounters::current() - startCounters;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    std::vector<WorkCounters> workerCounters(numThreads - 1);
+    for(int i = 1; i < numThreads; ++i)
+        threads.push_back(std::thread(&Worker::work, std::cref(body), std::ref(next), num, FresnelTier::current(), &(workerCounters[i - 1])));
+
+    Worker::work(body, next, num, FresnelTier::current(), NULL);
+
+    for(int i = 0; i < (int)threads.size(); ++i)
+    {
+        threads[i].join();
+        WorkCounters::current() += workerCounters[i];
+    }
+}
+
+END_NAMESPACE_Cornu
+
+#endif //CORNUCOPIA_PARALLEL_H_INCLUDED
@@ -28,76 +28,91 @@ NAMESPACE_Cornu
 Parameters::Parameters(const string &name)
 : _name(name), _algorithms(NUM_ALGORITHM_STAGES, 0)
 {
-    _initializeParameters();
-    _values.resize(_parameters.size());
-    for(int i = 0; i < (int)_parameters.size(); ++i)
-        _values[i] = _parameters[i].defaultVal;
+    const vector<Parameter> &params = parameters();
+    _values.resize(params.size());
+    for(int i = 0; i < (int)params.size(); ++i)
+        _values[i] = params[i].defaultVal;
 }
 
-void Parameters::_initializeParameters()
+//function-local statics are initialized exactly once, even if several threads get there at the same time
+const vector<Parameters::Parameter> &Parameters::parameters()
 {
-    static bool initialized = false;
-    if(initialized)
-        return;
-    initialized = true;
-
-    _parameters.push_back(Parameter(LINE_COST, "Line cost", 0., 20., 7.5));
-    _parameters.push_back(Parameter(ARC_COST, "Arc cost", 0., 30., 9.));
-    _parameters.push_back(Parameter(CLOTHOID_COST, "Clothoid cost", 0., 50., 15.));
-    _parameters.push_back(Parameter(G0_COST, "G0 cost", 0., 50., infinity));
-    _parameters.push_back(Parameter(G1_COST, "G1 cost", 0., 50., infinity));
-    _parameters.push_back(Parameter(G2_COST, "G2 cost", 0., 50., 0.));
-    _parameters.push_back(Parameter(ERROR_COST, "Error cost", 0., 10., 1.));
-    _parameters.push_back(Parameter(SHORTNESS_COST, "Shortness cost", 0., 10., 2.));
-    _parameters.push_back(Parameter(INFLECTION_COST, "Inflection cost", 0., 100., 20.));
-
-    _parameters.push_back(Parameter(INTERNAL_PARAMETERS_MARKER, "NOT A PARAMETER", 0., 0., 0.));
-    _parameters.push_back(Parameter(PIXEL_SIZE, "Pixel size", 1.));
-    _parameters.push_back(Parameter(SMALL_CURVE_PIXELS, "Small curve pixels", 200.));
-    _parameters.push_back(Parameter(LARGE_CURVE_PIXELS, "Large curve pixels", 500.));
-    _parameters.push_back(Parameter(MAX_RESCALE, "Max rescale", 2.));
-    _parameters.push_back(Parameter(MIN_PRELIM_LENGTH, "Min prelim length", 2.));
-    _parameters.push_back(Parameter(DP_CUTOFF, "Douglas-Peucker cutoff", 3.));
-    _parameters.push_back(Parameter(CLOSEDNESS_THRESHOLD, "Closedness threshold", 20.));
-    _parameters.push_back(Parameter(MINIMUM_CORNER_SPACING, "Min corner spacing", 5.));
-    _parameters.push_back(Parameter(CORNER_NEIGHBORHOOD, "Corner neighborhood", 15.));
-    _parameters.push_back(Parameter(DENSE_SAMPLING_STEP, "Dense sampling step", 1.));
-    _parameters.push_back(Parameter(CORNER_SCALES, "Num corner scales (int)", 5.));
-    _parameters.push_back(Parameter(CORNER_THRESHOLD, "Corner angle threshold", PI * 0.25));
-    _parameters.push_back(Parameter(MAX_SAMPLING_INTERVAL, "Maximum sampling interval", 50.));
-    _parameters.push_back(Parameter(CURVATURE_ESTIMATE_REGION, "Curvature estimate region", 20.));
-    _parameters.push_back(Parameter(POINTS_PER_CIRCLE, "Points per circle", 20.));
-    _parameters.push_back(Parameter(MAX_SAMPLE_RATE_SLOPE, "Max sample rate slope", 0.4));
-    _parameters.push_back(Parameter(ERROR_THRESHOLD, "Error Threshold", 4.));
-    _parameters.push_back(Parameter(SHORTNESS_THRESHOLD, "Shortness Threshold", 50.));
-    _parameters.push_back(Parameter(TWO_CURVE_CURVATURE_ADJUST, "Two-Curve Adjustment Point", 2.));
-    _parameters.push_back(Parameter(CURVE_ADJUST_DAMPING, "Curve Adjust Damping", 1.));
-    _parameters.push_back(Parameter(REDUCE_GRAPH_EVERY, "Reduce Graph Every", 10.));
-    _parameters.push_back(Parameter(COMBINE_DAMPING, "Combine Damping", 2.));
-    _parameters.push_back(Parameter(OVERSKETCH_THRESHOLD, "Oversketch Threshold", 15.));
+    static const vector<Parameter> params = _makeParameters();
+    return params;
 }
 
-void Parameters::_initializePresets()
+const vector<Parameters> &Parameters::presets()
 {
-    static bool initialized = false;
-    if(initialized)
-        return;
-    initialized = true;
+    static const vector<Parameters> presets = _makePresets();
+    return presets;
+}
 
-    _initializeParameters();
+vector<Parameters::Parameter> Parameters::_makeParameters()
+{
+    vector<Parameter> out;
+
+    out.push_back(Parameter(LINE_COST, "Line cost", 0., 20., 7.5));
+    out.push_back(Parameter(ARC_COST, "Arc cost", 0., 30., 9.));
+    out.push_back(Parameter(CLOTHOID_COST, "Clothoid cost", 0., 50., 15.));
+    out.push_back(Parameter(G0_COST, "G0 cost", 0., 50., infinity));
+    out.push_back(Parameter(G1_COST, "G1 cost", 0., 50., infinity));
+    out.push_back(Parameter(G2_COST, "G2 cost", 0., 50., 0.));
+    out.push_back(Parameter(ERROR_COST, "Error cost", 0., 10., 1.));
+    out.push_back(Parameter(SHORTNESS_COST, "Shortness cost", 0., 10., 2.));
+    out.push_back(Parameter(INFLECTION_COST, "Inflection cost", 0., 100., 20.));
+
+    out.push_back(Parameter(INTERNAL_PARAMETERS_MARKER, "NOT A PARAMETER", 0., 0., 0.));
+    out.push_back(Parameter(PIXEL_SIZE, "Pixel size", 1.));
+    out.push_back(Parameter(SMALL_CURVE_PIXELS, "Small curve pixels", 200.));
+    out.push_back(Parameter(LARGE_CURVE_PIXELS, "Large curve pixels", 500.));
+    out.push_back(Parameter(MAX_RESCALE, "Max rescale", 2.));
+    out.push_back(Parameter(MIN_PRELIM_LENGTH, "Min prelim length", 2.));
+    out.push_back(Parameter(DP_CUTOFF, "Douglas-Peucker cutoff", 3.));
+    out.push_back(Parameter(CLOSEDNESS_THRESHOLD, "Closedness threshold", 20.));
+    out.push_back(Parameter(MINIMUM_CORNER_SPACING, "Min corner spacing", 5.));
+    out.push_back(Parameter(CORNER_NEIGHBORHOOD, "Corner neighborhood", 15.));
+    out.push_back(Parameter(DENSE_SAMPLING_STEP, "Dense sampling step", 1.));
+    out.push_back(Parameter(CORNER_SCALES, "Num corner scales (int)", 5.));
+    out.push_back(Parameter(CORNER_THRESHOLD, "Corner angle threshold", PI * 0.25));
+    out.push_back(Parameter(MAX_SAMPLING_INTERVAL, "Maximum sampling interval", 50.));
+    out.push_back(Parameter(CURVATURE_ESTIMATE_REGION, "Curvature estimate region", 20.));
+    out.push_back(Parameter(POINTS_PER_CIRCLE, "Points per circle", 20.));
+    out.push_back(Parameter(MAX_SAMPLE_RATE_SLOPE, "Max sample rate slope", 0.4));
+    out.push_back(Parameter(ERROR_THRESHOLD, "Error Threshold", 4.));
+    out.push_back(Parameter(SHORTNESS_THRESHOLD, "Shortness Threshold", 50.));
+    out.push_back(Parameter(TWO_CURVE_CURVATURE_ADJUST, "Two-Curve Adjustment Point", 2.));
+    out.push_back(Parameter(CURVE_ADJUST_DAMPING, "Curve Adjust Damping", 1.));
+    out.push_back(Parameter(REDUCE_GRAPH_EVERY, "Reduce Graph Every", 10.));
+    out.push_back(Parameter(COMBINE_DAMPING, "Combine Damping", 2.));
+    out.push_back(Parameter(OVERSKETCH_THRESHOLD, "Oversketch Threshold", 15.));
+    out.push_back(Parameter(MAX_EDGES_PER_VERTEX, "Max edges per vertex (int)", 0.));
+    out.push_back(Parameter(FRESNEL_TIER, "Fresnel tier (int)", 0.));
+    out.push_back(Parameter(HIERARCHICAL_POINTS, "Hierarchical fitting points (int)", infinity));
+    out.push_back(Parameter(CORNER_PIECES, "Fit corner pieces (int)", 0.));
+    out.push_back(Parameter(VALIDATION_EARLY_STOP, "Validation early stop (int)", 0.));
+    out.push_back(Parameter(DOMINANCE_PRUNING, "Dominance pruning (int)", 0.));
+    out.push_back(Parameter(CANDIDATE_LENGTHS_PER_DOUBLING, "Candidate lengths per doubling (int)", 0.));
+    out.push_back(Parameter(FAST_SIMPLE_STROKES, "Fast simple strokes (int)", 0.));
+    out.push_back(Parameter(PATH_VALIDATION_STOP, "Path validation stop (int)", 1.));
+    out.push_back(Parameter(RESAMPLING_THREADS, "Resampling threads (int)", 0.));
+
+    return out;
+}
 
-    _presets.resize(NUM_PRESETS);
+vector<Parameters> Parameters::_makePresets()
+{
+    vector<Parameters> out(NUM_PRESETS);
 
     //default
     Parameters defaultParams("Default (G2)");
-    _presets[DEFAULT] = defaultParams;
+    out[DEFAULT] = defaultParams;
 
     //Loose
     Parameters loose = defaultParams;
     loose._name = "Loose (G2)";
     loose.set(ERROR_COST, 0.2);
     loose.set(ERROR_THRESHOLD, 8.);
-    _presets[LOOSE] = loose;
+    out[LOOSE] = loose;
 
     //Accurate
     Parameters accurate = defaultParams;
@@ -107,7 +122,7 @@ void Parameters::_initializePresets()
     accurate.set(CURVATURE_ESTIMATE_REGION, 10.);
     accurate.set(POINTS_PER_CIRCLE, 30.);
     accurate.set(ERROR_THRESHOLD, 2.);
-    _presets[ACCURATE] = accurate;
+    out[ACCURATE] = accurate;
 
     //polyline
     Parameters polyline = defaultParams;
@@ -119,7 +134,7 @@ void Parameters::_initializePresets()
     polyline.set(G1_COST, infinity);
     polyline.set(G2_COST, infinity);
     polyline.set(SHORTNESS_COST, 0);
-    _presets[POLYLINE] = polyline;
+    out[POLYLINE] = polyline;
 
     //lines and arcs
     Parameters linesarcs = defaultParams;
@@ -130,19 +145,19 @@ void Parameters::_initializePresets()
     linesarcs.set(G1_COST, 0.);
     linesarcs.set(G2_COST, infinity);
     linesarcs.set(SHORTNESS_COST, 0);
-    _presets[LINES_AND_ARCS] = linesarcs;
+    out[LINES_AND_ARCS] = linesarcs;
 
     //Clothoid only
     Parameters co = defaultParams;
     co._name = "Clothoid Only";
     co.set(LINE_COST, infinity);
     co.set(ARC_COST, infinity);
-    _presets[CLOTHOID_ONLY] = co;
+    out[CLOTHOID_ONLY] = co;
+
+    return out;
 }
 
 const double Parameters::infinity = 1e30;
-vector<Parameters::Parameter> Parameters::_parameters;
-vector<Parameters> Parameters::_presets;
 
 END_NAMESPACE_Cornu
 
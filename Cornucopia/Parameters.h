@@ -32,7 +32,7 @@ namespace Cornu
  * shortest path graph, and it specifies many internal parameters.  It also specifies the choice of
  * different algorithms for fitting stages.  Using the Parameters object, you can make the fitter
  * use only arcs, increase the tolerance, etc.  The default constructor provides reasonable parameters
- * for the G2 clothoid fit.  Several presets (defined in void Parameters::_initializePresets) allow
+ * for the G2 clothoid fit.  Several presets (defined in Parameters::_makePresets) allow
  * other useful behaviors.
  */
 class Parameters
@@ -73,9 +73,20 @@ public:
         SHORTNESS_THRESHOLD, //Primitives below this length are considered "short" for the purposes of the shortness cost
         TWO_CURVE_CURVATURE_ADJUST, //When combining two curves and matching their curvature, how much to compensate with the curvature at the opposite endpoints
         CURVE_ADJUST_DAMPING, //How much regularization is added to the solver for edge validation--increasing this makes the solver more stable, but converge slower
-        REDUCE_GRAPH_EVERY, //How many invalid paths are found before the A* heuristic is recomputed.  Setting this too high or too low hurts performance.
+        REDUCE_GRAPH_EVERY, //How many invalid paths are found before the A* heuristic is recomputed.  Setting this too high or too low hurts performance.  Open curves whose primitives are in order don't use the heuristic.
         COMBINE_DAMPING, //How much regularization is added to the solver for the final combine--increasing this makes the solver more stable, but converge slower
-        OVERSKETCH_THRESHOLD //How far the endpoints need to be from the base curve for them to be considered on the curve
+        OVERSKETCH_THRESHOLD, //How far the endpoints need to be from the base curve for them to be considered on the curve
+        MAX_EDGES_PER_VERTEX, //Only this many of the cheapest edges out of each graph vertex are kept (0 means all).  Decreasing this speeds up path finding on long curves, but may hurt quality
+        FRESNEL_TIER, //0 evaluates clothoids with full precision Fresnel integrals, 1 with tables accurate to about 1e-10, which are faster, 2 with the roughly single precision approximations up to path finding (fitting the candidates, their errors and validating edges) and with full precision when combining, so the final curve keeps its accuracy
+        HIERARCHICAL_POINTS, //Open curves resampled to more points than this are fitted coarse-to-fine in pieces of about this many points (see PieceFitter.h).  Lowering it speeds up long curves, but may hurt quality at the joints
+        CORNER_PIECES, //1 fits the pieces of open curves between corners separately (in parallel) and joins them G0 at the corners.  This speeds up curves with many corners, but the primitives at a corner are picked without seeing the other side of it
+        VALIDATION_EARLY_STOP, //1 stops the solve that validates an edge once it's clear whether the edge costs more than predicted, or once the solve stalls.  This speeds up path finding, but changes the fits slightly
+        DOMINANCE_PRUNING, //1 drops candidate primitives that cost at least as much and fit no better than another over the same points with the same curvature signs.  This shrinks the graph, but a dropped candidate might have joined its neighbors better
+        CANDIDATE_LENGTHS_PER_DOUBLING, //0 fits candidate primitives of every length.  k > 0 grows them geometrically, fitting about k lengths per doubling, and bisects back to the longest one within the error threshold.  Lowering it speeds up long smooth curves, but leaves the path fewer places to end primitives
+        FAST_SIMPLE_STROKES, //1 tries a single line, arc or clothoid over an open curve without corners first, and takes it without building the full graph and searching it if no path of more primitives could cost less.  This speeds up simple strokes, but the one primitive isn't adjusted and has no inflection variants
+        PATH_VALIDATION_STOP, //1 stops validating the edges of an open curve's path once an edge on it costs more and the path can't be the cheapest any more.  This usually validates fewer edges, and the path found is the same except, rarely, where other paths cost about as much
+        RESAMPLING_THREADS, //0 resamples the segments between corners with one thread per few hundred points, up to the number of cores.  n > 0 uses up to n threads however long the curve is.  The output is the same either way
+        NUM_PARAMETER_TYPES //must be last
     };
 
     enum Preset
@@ -126,14 +137,13 @@ public:
 
     static const double infinity;
 
-    static const std::vector<Parameter> &parameters() { _initializeParameters(); return _parameters; }
-    static const std::vector<Parameters> &presets() { _initializePresets(); return _presets; }
+    //These are built on first use (safe to call from multiple threads and during static initialization)
+    static const std::vector<Parameter> &parameters();
+    static const std::vector<Parameters> &presets();
 
 private:
-    static void _initializeParameters(); 
-    static void _initializePresets(); 
-    static std::vector<Parameter> _parameters;
-    static std::vector<Parameters> _presets;
+    static std::vector<Parameter> _makeParameters();
+    static std::vector<Parameters> _makePresets();
 };
 
 } //end of namespace Cornu
@@ -24,8 +24,13 @@
 #include "CurvePrimitive.h"
 #include "Preprocessing.h"
 #include "Fitter.h"
+#include "Parallel.h"
+#include "Tracing.h"
+#include "Dataset.h"
+#include "EdgeCostModel.h"
 
-#include <queue>
+#include <algorithm>
+#include <unordered_map>
 
 using namespace std;
 using namespace Eigen;
@@ -48,24 +53,25 @@ struct PathFindingVertexData
     CurvePrimitive::PrimitiveType primitiveType;
 };
 
+//Kept for every edge, so it's small: the combinations of the few edges validated are kept by the graph
 class PathFindingEdgeData
 {
 public:
-    PathFindingEdgeData(const Edge *edge)
-        : _edge(edge), _validated(false), _cost(_edge->cost), _reducedCost(0)
+    PathFindingEdgeData(float cost)
+        : _validated(false), _cost(cost), _reducedCost(0)
     {
         _ignore = _cost >= Parameters::infinity;
     }
 
-    bool validate(const Fitter &fitter)
+    bool validated() const { return _validated; }
+    //the validated cost is computed elsewhere (many edges are validated at once) and passed here
+    bool setValidatedCost(float newCost)
     {
-        if(_validated)
-            return true;
         _validated = true;
-        float newCost = _edge->validatedCost(fitter);
         if(newCost > _cost)
         {
             //Debugging::get()->printf("Inv");
+            CORNU_COUNT(EDGE_INVALIDATIONS, 1);
             _reducedCost += newCost - _cost;
             _cost = newCost;
             return false;
@@ -81,33 +87,126 @@ public:
     void reduce(double by) { _reducedCost = _cost - (float)by; }
 
 private:
-    const Edge *_edge; //the actual edge in the graph
     bool _validated;
     bool _ignore;
     float _cost;
     float _reducedCost;
 };
 
+//A d-ary min-heap of the integers 0..size-1 keyed by doubles that supports changing the key of an
+//element already in it, so there are never duplicate entries.  Ties are broken by the smaller element.
+template<int D>
+class IndexedHeap
+{
+public:
+    IndexedHeap(int size) : _pos(size, -1), _key(size) {}
+
+    bool empty() const { return _heap.empty(); }
+    int top() const { return _heap[0]; }
+    double topKey() const { return _key[_heap[0]]; }
+
+    //inserts the element or lowers its key if it's already in the heap
+    void push(int element, double key)
+    {
+        if(_pos[element] < 0)
+        {
+            _pos[element] = (int)_heap.size();
+            _heap.push_back(element);
+        }
+        else if(!(key < _key[element]))
+            return;
+        _key[element] = key;
+        _up(_pos[element]);
+    }
+
+    void pop()
+    {
+        _pos[_heap[0]] = -1;
+        if(_heap.size() > 1)
+        {
+            _heap[0] = _heap.back();
+            _pos[_heap[0]] = 0;
+            _heap.pop_back();
+            _down(0);
+        }
+        else
+            _heap.pop_back();
+    }
+
+private:
+    bool _less(int a, int b) const { return _key[a] < _key[b] || (_key[a] == _key[b] && a < b); }
+
+    void _up(int i)
+    {
+        int element = _heap[i];
+        while(i > 0)
+        {
+            int parent = (i - 1) / D;
+            if(!_less(element, _heap[parent]))
+                break;
+            _heap[i] = _heap[parent];
+            _pos[_heap[i]] = i;
+            i = parent;
+        }
+        _heap[i] = element;
+        _pos[element] = i;
+    }
+
+    void _down(int i)
+    {
+        int element = _heap[i];
+        int size = (int)_heap.size();
+        while(true)
+        {
+            int first = i * D + 1;
+            if(first >= size)
+                break;
+            int best = first;
+            for(int c = first + 1; c < first + D && c < size; ++c)
+                if(_less(_heap[c], _heap[best]))
+                    best = c;
+            if(!_less(_heap[best], element))
+                break;
+            _heap[i] = _heap[best];
+            _pos[_heap[i]] = i;
+            i = best;
+        }
+        _heap[i] = element;
+        _pos[element] = i;
+    }
+
+    vector<int> _heap;
+    vector<int> _pos; //position of each element in _heap, -1 if it's not there
+    vector<double> _key;
+};
+
 class PathFindingGraph
 {
 public:
-    PathFindingGraph(const vector<Vertex> &vertices, const vector<Edge> &edges, const Fitter &fitter)
-        : _vertices(vertices), _edges(edges), _fitter(fitter)
+    PathFindingGraph(const vector<Vertex> &vertices, const vector<Edge> &edges, const vector<int> &edgeOffsets, const Fitter &fitter)
+        : _vertices(vertices), _edges(edges), _edgeOffsets(edgeOffsets), _fitter(fitter), _numValidated(0), _degraded(false)
     {
         const vector<FitPrimitive> &primitives = _fitter.output<PRIMITIVE_FITTING>()->primitives;
+        const vector<PrimitiveValue> &values = _fitter.output<PRIMITIVE_FITTING>()->values;
 
         _vData.resize(vertices.size());
         _eData.reserve(edges.size());
         for(size_t i = 0; i < edges.size(); ++i)
-            _eData.push_back(PathFindingEdgeData(&(edges[i])));
+            _eData.push_back(PathFindingEdgeData(edges[i].cost));
         for(size_t i = 0; i < vertices.size(); ++i)
         {
-            _vData[i].numOutgoing = (int)vertices[i].edges.size();
+            _vData[i].numOutgoing = edgeOffsets[i + 1] - edgeOffsets[i];
             _vData[i].fixed = primitives[i].isFixed();
-            _vData[i].primitiveType = primitives[i].curve->getType();
+            _vData[i].primitiveType = values[i].getType();
         }
         for(size_t i = 0; i < edges.size(); ++i)
             _vData[edges[i].endVtx].numIncoming++;
+
+        //for open curves, edges go from a primitive to one that starts later, so the vertex order
+        //is a topological order (other than dummy edges)--but check in case the primitives aren't sorted
+        _topological = !_fitter.output<CURVE_CLOSING>()->closed;
+        for(size_t i = 0; _topological && i < edges.size(); ++i)
+            _topological = edges[i].endVtx > edges[i].startVtx || edges[i].continuity < 0;
     }
 
     vector<int> shortestPath()
@@ -121,29 +220,47 @@ public:
             _vData[i].target = _vertices[i].target;
         }
 
-        int reduceEvery = max(1, (int)_fitter.params().get(Parameters::REDUCE_GRAPH_EVERY));
+        int reduceEvery = max(1, (int)_fitter.config().get(Parameters::REDUCE_GRAPH_EVERY));
         vector<int> sp;
 
         for(int i = 0; i < _maxIter; ++i)
         {
-            if(i % reduceEvery == 0)
+            if(!_topological && i % reduceEvery == 0) //the search in a DAG doesn't need the A* heuristic
                 _reduceForPath(sources);
 
-            sp = _shortestPath(sources);
+            sp = _topological ? _shortestPathInDAG(sources) : _shortestPath(sources);
 
-            if(_validatePath(sp))
+            if(_validatePath(sp) || _acceptPastDeadline(sp))
                 break;
+            if(_fitter.cancelled())
+                return vector<int>();
         }
 
         //debugging output
         double total = 0;
         for(int j = 0; j < (int)sp.size(); ++j)
             total += _eData[sp[j]].cost();
-        Debugging::get()->printf("Found path, len = %d, cost = %lf", sp.size(), total);
+        CORNU_DEBUG(printf("Found path, len = %d, cost = %lf", sp.size(), total));
 
         return sp;
     }
 
+    //the combinations computed when the edges of a path were validated
+    vector<Combination> combinations(const vector<int> &path) const
+    {
+        vector<Combination> out(path.size());
+        for(int i = 0; i < (int)path.size(); ++i)
+        {
+            unordered_map<int, Combination>::const_iterator it = _combinations.find(path[i]);
+            if(it != _combinations.end())
+                out[i] = it->second;
+        }
+        return out;
+    }
+
+    int numValidated() const { return _numValidated; }
+    bool degraded() const { return _degraded; } //whether a path was taken without checking for a cheaper one, because of the time budget
+
     vector<int> shortestCycle()
     {
         //start with the vertex that has an edge both cheap and with very connected vertices
@@ -162,9 +279,17 @@ public:
 
         vector<int> sources(1, _edges[bestEdge].startVtx);
 
-        int reduceEvery = max(1, (int)_fitter.params().get(Parameters::REDUCE_GRAPH_EVERY));
+        //The cycle is forced through the source, and through a poor one, many cycles are validated (and their
+        //two-curve problems solved) before one holds up.  So the source is first moved to the middlemost vertex of
+        //the cheapest cycle through it by the costs before validation, which takes no two-curve problems at all.
+        _vData[sources[0]].source = _vData[sources[0]].target = true;
+        _reduceForCycle(sources[0]);
+        vector<int> sp = _shortestPath(sources);
+        _vData[sources[0]].source = _vData[sources[0]].target = false;
+        if(!sp.empty())
+            sources[0] = _edges[sp[sp.size() / 2]].endVtx;
 
-        vector<int> sp;
+        int reduceEvery = max(1, (int)_fitter.config().get(Parameters::REDUCE_GRAPH_EVERY));
 
         for(int iter = 0; iter < 2; ++iter)
         {
@@ -180,8 +305,10 @@ public:
                 if(sp.empty()) //should not happen
                     return sp;
 
-                if(_validatePath(sp))
+                if(_validatePath(sp) || _acceptPastDeadline(sp))
                     break;
+                if(_fitter.cancelled())
+                    return vector<int>();
             }
 
             _vData[sources[0]].source = _vData[sources[0]].target = false;
@@ -192,7 +319,7 @@ public:
             double total = 0;
             for(int j = 0; j < (int)sp.size(); ++j)
                 total += _eData[sp[j]].cost();
-            Debugging::get()->printf("Found cycle, len = %d, cost = %lf", sp.size(), total);
+            CORNU_DEBUG(printf("Found cycle, len = %d, cost = %lf", sp.size(), total));
         }
 
         return sp;
@@ -201,11 +328,99 @@ public:
 private:
     static const int _maxIter = 10000;
 
+    class _ValidateBody
+    {
+    public:
+        _ValidateBody(const vector<const Edge *> &edges, vector<float> &outCosts, vector<Combination> &outCombinations, const Fitter &fitter)
+            : _edges(edges), _outCosts(outCosts), _outCombinations(outCombinations), _fitter(fitter) {}
+
+        void operator()(int i) const { _outCosts[i] = _edges[i]->validatedCost(_fitter, &(_outCombinations[i])); }
+
+    private:
+        const vector<const Edge *> &_edges;
+        vector<float> &_outCosts;
+        vector<Combination> &_outCombinations;
+        const Fitter &_fitter;
+    };
+
+    //A two-curve solve takes about as long as relaxing this many edges in a search
+    static const int edgesPerValidation = 4000;
+
+    struct _HigherCost
+    {
+        _HigherCost(const vector<PathFindingEdgeData> &eData) : _eData(eData) {}
+        bool operator()(int a, int b) const { return _eData[a].cost() > _eData[b].cost(); }
+        const vector<PathFindingEdgeData> &_eData;
+    };
+
+    //Past the time budget, a path that failed validation is taken anyway if all its edges could be combined
+    bool _acceptPastDeadline(const vector<int> &path)
+    {
+        if(path.empty() || !_fitter.pastDeadline())
+            return false;
+        for(int i = 0; i < (int)path.size(); ++i)
+            if(!(_eData[path[i]].cost() < Parameters::infinity))
+                return false;
+        _degraded = true;
+        return true;
+    }
+
     bool _validatePath(const vector<int> &path)
     {
-        bool valid = true;
+        //Validation of an edge solves a two-curve problem and doesn't depend on other edges, so the edges on
+        //the path that need it are validated in parallel, a batch of one per thread at a time.  The path is
+        //rejected once one edge costs more, and the rest need only be validated if they're on a later path--the
+        //one found is the same.  So the edges most likely to be invalidated go first: the ones the validated cost
+        //model predicts the largest increases for, or without one, the ones whose predicted costs are highest.
+        vector<int> toValidate;
+        double pathCost = 0.;
         for(int i = 0; i < (int)path.size(); ++i)
-            valid = _eData[path[i]].validate(_fitter) && valid;
+        {
+            pathCost += _eData[path[i]].cost();
+            if(_eData[path[i]].validated() || find(toValidate.begin(), toValidate.end(), path[i]) != toValidate.end())
+                continue;
+            toValidate.push_back(path[i]);
+        }
+        stable_sort(toValidate.begin(), toValidate.end(), _HigherCost(_eData));
+        if(_fitter.validatedCostModel())
+            _skipPredictedValid(*_fitter.validatedCostModel(), toValidate);
+
+        int batchSize = _inParallelFor() ? 1 : numHardwareThreads();
+        bool valid = true;
+        double increase = 0., otherPathCost = -1.; //the second is found once the path is invalidated
+        for(int start = 0; start < (int)toValidate.size(); start += batchSize)
+        {
+            //Past an invalid edge, in a DAG (with PATH_VALIDATION_STOP), the rest are validated only while the path
+            //costs no more than the cheapest other one: it's then found again by the next search, which needs them
+            //validated.  Otherwise they're still validated if their solves cost less than the search that would find
+            //the next path--most of them will be on it anyway.
+            if(!valid && _topological && _fitter.config().get(Parameters::PATH_VALIDATION_STOP) > 0.5)
+            {
+                if(otherPathCost < 0.)
+                    otherPathCost = _otherPathCost(path);
+                if(pathCost + increase > otherPathCost)
+                    break;
+            }
+            else if(!valid && (double)((int)toValidate.size() - start) * edgesPerValidation > (double)_edges.size())
+                break;
+            int num = min(batchSize, (int)toValidate.size() - start);
+            vector<const Edge *> edges(num);
+            for(int i = 0; i < num; ++i)
+                edges[i] = &(_edges[toValidate[start + i]]);
+
+            vector<float> newCosts(num);
+            vector<Combination> combinations(num);
+            parallelFor(num, _ValidateBody(edges, newCosts, combinations, _fitter));
+            _numValidated += num;
+
+            for(int i = 0; i < num; ++i)
+            {
+                _combinations[toValidate[start + i]] = combinations[i];
+                double oldCost = _eData[toValidate[start + i]].cost();
+                valid = _eData[toValidate[start + i]].setValidatedCost(newCosts[i]) && valid;
+                increase += _eData[toValidate[start + i]].cost() - oldCost;
+            }
+        }
 
         //line-clothoid-line
         if(valid)
@@ -234,8 +449,87 @@ private:
         return valid;
     }
 
+    //Takes the edges the model predicts validation wouldn't make costlier as valid without solving their two-curve
+    //problems, and leaves the rest in toValidate, the ones with the largest predicted increases first.  The edges
+    //skipped keep no combination.
+    void _skipPredictedValid(const EdgeCostModel &model, vector<int> &toValidate)
+    {
+        const double tolerance = 0.02; //a predicted increase of at most this fraction of the cost counts as none
+
+        static thread_local Dataset batch;
+        static thread_local vector<float> predicted;
+        batch.clear();
+        float row[Dataset::NUM_COLUMNS];
+        for(int i = 0; i < (int)toValidate.size(); ++i)
+        {
+            _edges[toValidate[i]].features(_fitter, row);
+            batch.addRow(row);
+        }
+        predicted.resize(batch.numRows());
+        model.costs(batch, predicted.data());
+
+        static thread_local vector<pair<double, int> > increases;
+        increases.clear();
+        for(int i = 0; i < (int)toValidate.size(); ++i)
+        {
+            double cost = _eData[toValidate[i]].cost();
+            if(predicted[i] <= cost * (1. + tolerance))
+                _eData[toValidate[i]].setValidatedCost((float)cost);
+            else
+                increases.push_back(make_pair(cost - predicted[i], toValidate[i])); //negated, so the sort puts the largest first
+        }
+        stable_sort(increases.begin(), increases.end(), _FirstLess());
+        toValidate.resize(increases.size());
+        for(int i = 0; i < (int)increases.size(); ++i)
+            toValidate[i] = increases[i].second;
+    }
+
+    struct _FirstLess
+    {
+        bool operator()(const pair<double, int> &a, const pair<double, int> &b) const { return a.first < b.first; }
+    };
+
+    //For a DAG, right after _shortestPathInDAG found path (which leaves the distances from the sources to the
+    //vertices in _vData): the cost of the cheapest other path, which leaves it over some edge not on it
+    double _otherPathCost(const vector<int> &path)
+    {
+        static thread_local vector<double> toTarget;
+        static thread_local vector<char> onPath;
+        toTarget.assign(_vertices.size(), Parameters::infinity);
+        onPath.assign(_edges.size(), 0);
+        for(int i = 0; i < (int)path.size(); ++i)
+            onPath[path[i]] = 1;
+
+        double out = Parameters::infinity;
+        for(int v = (int)_vertices.size() - 1; v >= 0; --v)
+        {
+            double fromSource = _vData[v].source ? 0. : _vData[v].distance;
+            if(_vData[v].target)
+                toTarget[v] = 0.;
+            for(int e = _edgeOffsets[v]; e < _edgeOffsets[v + 1]; ++e)
+            {
+                if(_eData[e].ignore())
+                    continue;
+                if(_edges[e].continuity < 0) //dummy edge: the path is just this primitive
+                {
+                    if(!onPath[e])
+                        out = min(out, _eData[e].cost());
+                    continue;
+                }
+                double rest = _eData[e].cost() + toTarget[_edges[e].endVtx];
+                toTarget[v] = min(toTarget[v], rest);
+                if(!onPath[e])
+                    out = min(out, fromSource + rest);
+            }
+        }
+        return out;
+    }
+
     void _reduceForPath(const vector<int> &sourceVertices)
     {
+        CORNU_TRACE_SCOPE("reduceForPath");
+        CORNU_COUNT(GRAPH_REDUCTIONS, 1);
+
         //compute distances
         for(int i = 0; i < (int)_vertices.size(); ++i)
             _vData[i].distance = _vData[i].target ? 0. : Parameters::infinity;
@@ -269,7 +563,7 @@ private:
                 _eData[i].reduce(_vData[src].distance - _vData[tgt].distance - reductionTol);
 
             if(_eData[i].reducedCost() < 0.)
-                Debugging::get()->printf("Reducing error!");
+                CORNU_DEBUG(printf("Reducing error!"));
         }
     }
 
@@ -280,8 +574,8 @@ private:
             _vData[i].distance = Parameters::infinity;
         _vData[vertex].distance = 0.;
 
-        int startEdge = _vertices[vertex].edges[0] - 1;
-        int lastSourceEdge = _vertices[vertex].edges.back();
+        int startEdge = _edgeOffsets[vertex] - 1;
+        int lastSourceEdge = _edgeOffsets[vertex + 1] - 1;
 
         size_t count = 0;
 
@@ -332,12 +626,13 @@ private:
             }
 
             if(_eData[i].reducedCost() < 0.)
-                Debugging::get()->printf("Reducing error!");
+                CORNU_DEBUG(printf("Reducing error!"));
         }
     }
 
     vector<int> _shortestPath(const vector<int> &sourceVertices)
     {
+        CORNU_TRACE_SCOPE("Dijkstra");
         for(size_t i = 0; i < _vertices.size(); ++i)
         {
             _vData[i].prevEdge = -1;
@@ -345,17 +640,17 @@ private:
             _vData[i].finished = false;
         }
 
-        priority_queue<pair<double, int>, vector<pair<double, int> >, greater<pair<double, int> > > todo;
+        IndexedHeap<4> todo((int)_vertices.size());
 
         //initialize
         for(int i = 0; i < (int)sourceVertices.size(); ++i)
-            todo.push(make_pair(0., sourceVertices[i]));
+            todo.push(sourceVertices[i], 0.);
 
         //run
         while(!todo.empty())
         {
-            double curDistance = todo.top().first;
-            int v = todo.top().second;
+            double curDistance = todo.topKey();
+            int v = todo.top();
             todo.pop();
 
             if(_vData[v].target && _vData[v].prevEdge >= 0) //done, now traverse the edges backwards
@@ -377,9 +672,8 @@ private:
                 continue;
             _vData[v].finished = true;
 
-            for(int i = 0; i < (int)_vertices[v].edges.size(); ++i)
+            for(int e = _edgeOffsets[v]; e < _edgeOffsets[v + 1]; ++e)
             {
-                int e = _vertices[v].edges[i];
                 if(_eData[e].ignore())
                     continue;
                 int tgt = _edges[e].endVtx;
@@ -389,7 +683,7 @@ private:
                 {
                     _vData[tgt].distance = newDist;
                     _vData[tgt].prevEdge = e;
-                    todo.push(make_pair(newDist, tgt));
+                    todo.push(tgt, newDist);
                 }
             }
         }
@@ -398,11 +692,72 @@ private:
         return vector<int>();
     }
 
+    //Same result as _shortestPath, but only for a graph whose vertex order is topological: relaxes
+    //the edges vertex by vertex, in time linear in the number of edges and without a heap.  Every edge is
+    //relaxed anyway, so it uses the costs themselves, and the graph doesn't need to be reduced.
+    vector<int> _shortestPathInDAG(const vector<int> &sourceVertices)
+    {
+        CORNU_TRACE_SCOPE("shortestPathInDAG");
+        for(size_t i = 0; i < _vertices.size(); ++i)
+        {
+            _vData[i].prevEdge = -1;
+            _vData[i].distance = Parameters::infinity;
+        }
+        vector<bool> isSource(_vertices.size(), false);
+        for(int i = 0; i < (int)sourceVertices.size(); ++i)
+            isSource[sourceVertices[i]] = true;
+
+        int best = -1;
+        for(int v = 0; v < (int)_vertices.size(); ++v)
+        {
+            //paths leave sources with distance 0, just like they do in _shortestPath
+            double curDistance = isSource[v] ? 0. : _vData[v].distance;
+            if(curDistance >= Parameters::infinity)
+                continue;
+
+            for(int e = _edgeOffsets[v]; e < _edgeOffsets[v + 1]; ++e)
+            {
+                if(_eData[e].ignore())
+                    continue;
+                int tgt = _edges[e].endVtx;
+                double newDist = curDistance + _eData[e].cost();
+
+                if(newDist < _vData[tgt].distance)
+                {
+                    _vData[tgt].distance = newDist;
+                    _vData[tgt].prevEdge = e;
+                }
+            }
+
+            if(_vData[v].target && _vData[v].prevEdge >= 0 && (best < 0 || _vData[v].distance < _vData[best].distance))
+                best = v;
+        }
+
+        if(best < 0) //no path
+            return vector<int>();
+
+        vector<int> out;
+        int cur = best;
+        do
+        {
+            out.push_back(_vData[cur].prevEdge);
+            cur = _edges[out.back()].startVtx;
+        } while(_vData[cur].prevEdge >= 0 && cur != best);
+
+        reverse(out.begin(), out.end());
+        return out;
+    }
+
     const vector<Vertex> &_vertices;
     const vector<Edge> &_edges;
+    const vector<int> &_edgeOffsets;
     vector<PathFindingEdgeData> _eData;
+    unordered_map<int, Combination> _combinations; //of the edges validated, by edge
     vector<PathFindingVertexData> _vData;
     const Fitter &_fitter;
+    bool _topological; //whether the vertex order is a topological order of the graph
+    int _numValidated;
+    bool _degraded;
 };
 
 class DefaultPathFinder : public Algorithm<PATH_FINDING>
@@ -417,7 +772,7 @@ protected:
         const vector<FitPrimitive> &primitives = fitter.output<PRIMITIVE_FITTING>()->primitives;
 
         //construct the path finding graph
-        PathFindingGraph pfgraph(graph->vertices, graph->edges, fitter);
+        PathFindingGraph pfgraph(graph->vertices, graph->edges, graph->edgeOffsets, fitter);
         
         bool closed = fitter.output<CURVE_CLOSING>()->closed;
 
@@ -439,16 +794,19 @@ protected:
             if(!closed && i + 1 == (int)shortestPath.size())
                 ss << curveTypes[primitives[graph->edges[shortestPath[i]].endVtx].curve->getType()];
         }
-        Debugging::get()->printf("Curves = %s", ss.str().c_str());
+        CORNU_DEBUG(printf("Curves = %s", ss.str().c_str()));
 
         for(int i = 0; i < (int)shortestPath.size(); ++i)
         {
-            Debugging::get()->drawPrimitive(primitives[graph->edges[shortestPath[i]].startVtx].curve, "Path", i);
+            CORNU_DEBUG(drawPrimitive(primitives[graph->edges[shortestPath[i]].startVtx].curve, "Path", i));
         }
         if(shortestPath.size() > 0 && graph->edges[shortestPath[0]].continuity != -1)
-            Debugging::get()->drawPrimitive(primitives[graph->edges[shortestPath.back()].endVtx].curve, "Path", (int)shortestPath.size());
+            CORNU_DEBUG(drawPrimitive(primitives[graph->edges[shortestPath.back()].endVtx].curve, "Path", (int)shortestPath.size()));
 
         out.path = shortestPath;
+        out.combinations = pfgraph.combinations(shortestPath);
+        out.numValidated = pfgraph.numValidated();
+        out.degraded = pfgraph.degraded();
     }
 };
 
@@ -23,13 +23,21 @@
 
 #include "defs.h"
 #include "Algorithm.h"
+#include "TwoCurveCombine.h"
 
 NAMESPACE_Cornu
 
 template<>
 struct AlgorithmOutput<PATH_FINDING> : public AlgorithmOutputBase
 {
+    AlgorithmOutput() : numValidated(0) {}
+
+    //override
+    size_t memoryBytes() const { return vectorBytes(path) + vectorBytes(combinations); }
+
     std::vector<int> path; //list of edges
+    std::vector<Combination> combinations; //for each path edge, the two-curve combination from its validation (NULL curves for dummy edges)
+    int numValidated; //the number of edges whose two-curve problems were solved while searching
 };
 
 template<>
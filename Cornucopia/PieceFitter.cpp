@@ -0,0 +1,526 @@
+/*--
+    PieceFitter.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PieceFitter.h"
+#include "Fitter.h"
+#include "Preprocessing.h"
+#include "Oversketcher.h"
+#include "Resampler.h"
+#include "PrimitiveFitter.h"
+#include "GraphConstructor.h"
+#include "PathFinder.h"
+#include "Combiner.h"
+#include "PrimitiveSequence.h"
+#include "Polyline.h"
+#include "Parallel.h"
+#include "Tracing.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+using namespace Eigen;
+NAMESPACE_Cornu
+
+typedef chrono::steady_clock Clock;
+
+//the coarse fit of the hierarchical mode samples about this many times less densely
+static const double coarseness = 2.;
+//pieces are never split to fewer resampled points than this
+static const int minPiecePoints = 8;
+
+class _PieceBody
+{
+public:
+    _PieceBody(vector<Fitter> &pieces) : _pieces(pieces) {}
+
+    void operator()(int i) const
+    {
+        CORNU_TRACE_SCOPE("Piece");
+        _pieces[i].run();
+    }
+
+private:
+    vector<Fitter> &_pieces;
+};
+
+bool PieceFitter::run(Fitter &fitter)
+{
+    smart_ptr<const AlgorithmOutput<OVERSKETCHING> > osOutput = fitter.output<OVERSKETCHING>();
+    if(fitter.output<CURVE_CLOSING>()->closed || osOutput->startCurve || osOutput->endCurve)
+        return false;
+
+    //with both modes, the curve is split at the corners and the pieces between are fitted hierarchically
+    Clock::time_point start = Clock::now();
+    vector<PieceSplit> splits;
+    bool atCorners = fitter.config().get(Parameters::CORNER_PIECES) > 0.5;
+    if(atCorners)
+        splits = cornerSplits(fitter);
+    if(splits.empty() && fitter.output<RESAMPLING>()->output->pts().size() > fitter.config().get(Parameters::HIERARCHICAL_POINTS))
+    {
+        atCorners = false;
+        splits = coarseSplits(fitter);
+    }
+    long long splitNanoseconds = chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start).count();
+
+    if(splits.empty() || !fit(fitter, splits, atCorners))
+        return false;
+    fitter._stats.stageNanoseconds[PRIMITIVE_FITTING] += splitNanoseconds;
+    return true;
+}
+
+//The path of a piece as the vertices along it: the edge at pathIdx[j] of the path goes from vertices[j] to
+//vertices[j + 1].  A path that is a single primitive (a dummy edge) has just its vertex.
+struct _PiecePath
+{
+    _PiecePath(const Fitter &piece)
+    {
+        smart_ptr<const AlgorithmOutput<GRAPH_CONSTRUCTION> > graph = piece.output<GRAPH_CONSTRUCTION>();
+        const vector<int> &path = piece.output<PATH_FINDING>()->path;
+        costBefore.push_back(0.);
+        for(int i = 0; i < (int)path.size(); ++i)
+        {
+            const Edge &edge = graph->edges[path[i]];
+            vertices.push_back(edge.startVtx);
+            if(edge.continuity < 0)
+                break;
+            pathIdx.push_back(i);
+            costBefore.push_back(costBefore.back() + edge.cost);
+            if(i + 1 == (int)path.size())
+                vertices.push_back(edge.endVtx);
+        }
+    }
+
+    int size() const { return (int)vertices.size(); }
+    double costAfter(int j) const { return costBefore.back() - costBefore[j]; }
+
+    vector<int> vertices;
+    vector<int> pathIdx;
+    vector<double> costBefore; //the cost of the path up to each vertex
+};
+
+//An edge from the path of a piece to the path of the next one: the merged path leaves the first path at its
+//vertex from and continues along the second one from its vertex to
+struct _Join
+{
+    Edge edge; //in the graph of the piece owner, with the cost of the path through it
+    int owner;
+    int from;
+    int to;
+    double cost;
+    bool validated;
+    Combination combination;
+};
+
+//whether two candidates (of pieces starting at the given resampled points) are the same one
+static bool samePrimitive(const FitPrimitive &p1, int from1, const FitPrimitive &p2, int from2)
+{
+    if(p1.startIdx + from1 != p2.startIdx + from2 || p1.endIdx + from1 != p2.endIdx + from2 || p1.curve->getType() != p2.curve->getType())
+        return false;
+    const CurvePrimitive::ParamVec &params1 = p1.curve->params(), &params2 = p2.curve->params();
+    return (params1 - params2).norm() <= 1e-8 * (1. + params1.norm());
+}
+
+//Finds the cheapest way to get from the path of piece i (past its vertex first) to the path of piece i + 1
+//over an edge of either graph: the edges out of the first path's vertices to a candidate the same as one on
+//the second path, and the edges to the second path's vertices out of a candidate the same as one on the
+//first path.  Returns false if there is none that validates.
+static bool findJoin(const vector<Fitter> &pieces, const vector<_PiecePath> &paths, const vector<int> &from, int i, int first, _Join &out)
+{
+    const vector<FitPrimitive> *prims[2] = { &(pieces[i].output<PRIMITIVE_FITTING>()->primitives), &(pieces[i + 1].output<PRIMITIVE_FITTING>()->primitives) };
+    const AlgorithmOutput<GRAPH_CONSTRUCTION> *graphs[2] = { pieces[i].output<GRAPH_CONSTRUCTION>().get(), pieces[i + 1].output<GRAPH_CONSTRUCTION>().get() };
+    const _PiecePath &path1 = paths[i], &path2 = paths[i + 1];
+
+    vector<_Join> joins;
+    _Join join;
+    join.validated = false;
+    for(int j = first; j < path1.size(); ++j)
+    {
+        const FitPrimitive &prim1 = (*prims[0])[path1.vertices[j]];
+        join.from = j;
+
+        //out of a candidate of the second piece that's on the first path
+        join.owner = i + 1;
+        for(int v = 0; prim1.startIdx + from[i] >= from[i + 1] && v < (int)prims[1]->size(); ++v)
+        {
+            if(!samePrimitive(prim1, from[i], (*prims[1])[v], from[i + 1]))
+                continue;
+            for(int e = graphs[1]->edgeOffsets[v]; e < graphs[1]->edgeOffsets[v + 1]; ++e)
+            {
+                join.edge = graphs[1]->edges[e];
+                join.to = (int)(find(path2.vertices.begin(), path2.vertices.end(), join.edge.endVtx) - path2.vertices.begin());
+                if(join.edge.continuity < 0 || join.to == path2.size())
+                    continue;
+                join.cost = path1.costBefore[j] + join.edge.cost + path2.costAfter(join.to);
+                joins.push_back(join);
+            }
+        }
+
+        //out of the first path to a candidate of the first piece that's on the second path
+        join.owner = i;
+        for(int e = graphs[0]->edgeOffsets[path1.vertices[j]]; e < graphs[0]->edgeOffsets[path1.vertices[j] + 1]; ++e)
+        {
+            join.edge = graphs[0]->edges[e];
+            if(join.edge.continuity < 0)
+                continue;
+            const FitPrimitive &prim2 = (*prims[0])[join.edge.endVtx];
+            for(join.to = 0; join.to < path2.size(); ++join.to)
+            {
+                if(samePrimitive(prim2, from[i], (*prims[1])[path2.vertices[join.to]], from[i + 1]))
+                    break;
+            }
+            if(join.to == path2.size())
+                continue;
+            join.cost = path1.costBefore[j] + join.edge.cost + path2.costAfter(join.to);
+            joins.push_back(join);
+        }
+    }
+
+    //validating only increases costs, so the cheapest join is the first one that's still cheapest validated
+    while(!joins.empty())
+    {
+        vector<_Join>::iterator best = joins.begin();
+        for(vector<_Join>::iterator it = joins.begin(); it != joins.end(); ++it)
+        {
+            if(it->cost < best->cost)
+                best = it;
+        }
+        if(best->validated)
+        {
+            out = *best;
+            return true;
+        }
+
+        float cost = best->edge.validatedCost(pieces[best->owner], &(best->combination));
+        best->cost += cost - best->edge.cost;
+        best->validated = true;
+        if(!(best->cost < Parameters::infinity))
+            joins.erase(best);
+    }
+    return false;
+}
+
+bool PieceFitter::fit(Fitter &fitter, const vector<PieceSplit> &splits, bool hierarchicalPieces)
+{
+    CORNU_TRACE_SCOPE("PieceFitter::fit");
+    int numPieces = (int)splits.size() + 1;
+    int numPts = fitter.output<RESAMPLING>()->output->pts().size();
+
+    vector<int> from(numPieces, 0), to(numPieces, numPts - 1);
+    for(int i = 0; i < (int)splits.size(); ++i)
+    {
+        to[i] = min(numPts - 1, splits[i].idx + splits[i].overlap);
+        from[i + 1] = max(0, splits[i].idx - splits[i].overlap);
+    }
+
+    vector<Fitter> pieces(numPieces);
+    for(int i = 0; i < numPieces; ++i)
+        _setUpPiece(pieces[i], fitter, from[i], to[i], hierarchicalPieces);
+    parallelFor(numPieces, _PieceBody(pieces));
+    if(fitter.cancelled())
+        return false; //the pieces stopped partway
+
+    vector<_PiecePath> paths;
+    for(int i = 0; i < numPieces; ++i)
+    {
+        if(pieces[i].output<PATH_FINDING>()->path.empty())
+        {
+            CORNU_DEBUG(printf("Piece %d of %d could not be fitted", i, numPieces));
+            return false;
+        }
+        paths.push_back(_PiecePath(pieces[i]));
+    }
+
+    //The merged path goes along the path of piece i from its vertex first[i] to its vertex last[i], and then
+    //over joins[i] to the next piece.  At a corner, the join is a G0 edge from the end of one path to the
+    //start of the next.
+    vector<int> first(numPieces, 0), last(numPieces);
+    vector<_Join> joins(splits.size());
+    for(int i = 0; i < numPieces; ++i)
+        last[i] = paths[i].size() - 1;
+    for(int i = 0; i < (int)splits.size(); ++i)
+    {
+        _Join &join = joins[i];
+        if(splits[i].overlap == 0)
+        {
+            join.owner = i;
+            join.edge.continuity = 0;
+            join.edge.cost = 0.f;
+            join.from = last[i];
+            join.to = 0;
+            join.combination = Combination(); //G0 joints need none
+        }
+        else if(!findJoin(pieces, paths, from, i, first[i], join))
+        {
+            CORNU_DEBUG(printf("The paths of pieces %d and %d could not be joined", i, i + 1));
+            return false;
+        }
+        last[i] = join.from;
+        first[i + 1] = join.to;
+    }
+
+    smart_ptr<AlgorithmOutput<PRIMITIVE_FITTING> > primitives = new AlgorithmOutput<PRIMITIVE_FITTING>();
+    smart_ptr<AlgorithmOutput<GRAPH_CONSTRUCTION> > graph = new AlgorithmOutput<GRAPH_CONSTRUCTION>();
+    smart_ptr<AlgorithmOutput<PATH_FINDING> > path = new AlgorithmOutput<PATH_FINDING>();
+
+    //the merged indices of the vertices and edges of each piece (-1 for dropped dummy edges), and of the joins
+    vector<int> vertexOffsets(numPieces + 1, 0);
+    for(int i = 0; i < numPieces; ++i)
+        vertexOffsets[i + 1] = vertexOffsets[i] + (int)pieces[i].output<GRAPH_CONSTRUCTION>()->vertices.size();
+    vector<vector<int> > edgeMaps(numPieces);
+    vector<int> joinEdges(splits.size());
+
+    for(int i = 0; i < numPieces; ++i)
+    {
+        smart_ptr<const AlgorithmOutput<PRIMITIVE_FITTING> > piecePrimitives = pieces[i].output<PRIMITIVE_FITTING>();
+        smart_ptr<const AlgorithmOutput<GRAPH_CONSTRUCTION> > pieceGraph = pieces[i].output<GRAPH_CONSTRUCTION>();
+
+        int primitiveOffset = (int)primitives->primitives.size();
+        for(int j = 0; j < (int)piecePrimitives->primitives.size(); ++j)
+        {
+            FitPrimitive primitive = piecePrimitives->primitives[j];
+            primitive.startIdx += from[i];
+            primitive.endIdx += from[i];
+            primitives->primitives.push_back(primitive);
+        }
+        primitives->values.insert(primitives->values.end(), piecePrimitives->values.begin(), piecePrimitives->values.end());
+        primitives->degraded = primitives->degraded || piecePrimitives->degraded;
+        graph->degraded = graph->degraded || pieceGraph->degraded;
+
+        int joinVertex = (i + 1 < numPieces) ? paths[i].vertices[last[i]] : -1;
+        edgeMaps[i].resize(pieceGraph->edges.size(), -1);
+        for(int v = 0; v < (int)pieceGraph->vertices.size(); ++v)
+        {
+            Vertex vertex = pieceGraph->vertices[v];
+            vertex.primitiveIdx += primitiveOffset;
+            vertex.source = vertex.source && i == 0;
+            vertex.target = vertex.target && i + 1 == numPieces;
+            graph->vertices.push_back(vertex);
+            graph->edgeOffsets.push_back((int)graph->edges.size());
+
+            for(int e = pieceGraph->edgeOffsets[v]; e < pieceGraph->edgeOffsets[v + 1]; ++e)
+            {
+                Edge edge = pieceGraph->edges[e];
+                if(edge.continuity < 0 && numPieces > 1) //a single primitive over the piece isn't one over the curve
+                    continue;
+                edge.startVtx += vertexOffsets[i];
+                edge.endVtx += vertexOffsets[i];
+                edgeMaps[i][e] = (int)graph->edges.size();
+                graph->edges.push_back(edge);
+            }
+
+            if(v == joinVertex)
+            {
+                Edge edge = joins[i].edge;
+                edge.startVtx = vertexOffsets[i] + v;
+                edge.endVtx = vertexOffsets[i + 1] + paths[i + 1].vertices[first[i + 1]];
+                joinEdges[i] = (int)graph->edges.size();
+                graph->edges.push_back(edge);
+            }
+        }
+    }
+    graph->edgeOffsets.push_back((int)graph->edges.size());
+
+    for(int i = 0; i < numPieces; ++i)
+    {
+        smart_ptr<const AlgorithmOutput<PATH_FINDING> > piecePath = pieces[i].output<PATH_FINDING>();
+        for(int j = first[i]; j < last[i]; ++j)
+        {
+            int pathIdx = paths[i].pathIdx[j];
+            path->path.push_back(edgeMaps[i][piecePath->path[pathIdx]]);
+            path->combinations.push_back(piecePath->combinations[pathIdx]);
+        }
+        if(i + 1 < numPieces)
+        {
+            path->path.push_back(joinEdges[i]);
+            path->combinations.push_back(joins[i].combination);
+        }
+        path->numValidated += piecePath->numValidated;
+        path->degraded = path->degraded || piecePath->degraded;
+    }
+
+    fitter._outputs[PRIMITIVE_FITTING] = primitives;
+    fitter._outputs[GRAPH_CONSTRUCTION] = graph;
+    fitter._outputs[PATH_FINDING] = path;
+
+    //the error computers of the pieces are part of fitting their primitives
+    for(int i = 0; i < numPieces; ++i)
+    {
+        const FitStats &stats = pieces[i].stats();
+        fitter._stats.stageNanoseconds[PRIMITIVE_FITTING] += stats.stageNanoseconds[ERROR_COMPUTER];
+        for(int stage = PRIMITIVE_FITTING; stage <= PATH_FINDING; ++stage)
+            fitter._stats.stageNanoseconds[stage] += stats.stageNanoseconds[stage];
+    }
+
+    CORNU_DEBUG(printf("Fitted in %d pieces", numPieces));
+    return true;
+}
+
+vector<PieceSplit> PieceFitter::cornerSplits(const Fitter &fitter)
+{
+    vector<PieceSplit> out;
+    const VectorC<bool> &corners = fitter.output<RESAMPLING>()->corners;
+    int last = 0;
+    for(int i = minPiecePoints; i + minPiecePoints < corners.size(); ++i)
+    {
+        if(corners[i] && i - last >= minPiecePoints)
+        {
+            out.push_back(PieceSplit(i, 0));
+            last = i;
+        }
+    }
+    return out;
+}
+
+vector<PieceSplit> PieceFitter::coarseSplits(const Fitter &fitter)
+{
+    CORNU_TRACE_SCOPE("PieceFitter::coarseSplits");
+    vector<PieceSplit> out;
+
+    Parameters params = fitter.params();
+    params.set(Parameters::POINTS_PER_CIRCLE, params.get(Parameters::POINTS_PER_CIRCLE) / coarseness);
+    params.set(Parameters::MAX_SAMPLING_INTERVAL, params.get(Parameters::MAX_SAMPLING_INTERVAL) * coarseness);
+
+    Fitter coarse;
+    coarse.setParams(params);
+    coarse.setTimeBudget(_remainingBudget(fitter));
+    coarse.setCancellationToken(fitter.cancellationToken());
+    coarse.setEdgeCostModel(fitter.edgeCostModel());
+    coarse.setValidatedCostModel(fitter.validatedCostModel());
+    coarse.setOriginalSketch(fitter.originalSketch());
+    coarse.run();
+    if(!coarse.finalOutput() || coarse.output<CURVE_CLOSING>()->closed)
+        return out;
+
+    //The joints of the coarse fit as resampled points of the curve: the original point whose parameter on
+    //the coarse fit is nearest the joint is found, and the resampled point nearest that one is taken
+    smart_ptr<const AlgorithmOutput<GRAPH_CONSTRUCTION> > coarseGraph = coarse.output<GRAPH_CONSTRUCTION>();
+    const vector<int> &coarsePath = coarse.output<PATH_FINDING>()->path;
+    const VectorC<CurvePrimitiveConstPtr> &coarsePrimitives = coarse.finalOutput()->primitives();
+    const vector<double> &coarseParams = coarse.originalSketchToFinalParameters();
+    const vector<double> &resampledParams = fitter.output<RESAMPLING>()->parameters;
+    PolylineConstPtr resampled = fitter.output<RESAMPLING>()->output;
+    int numPts = resampled->pts().size();
+
+    //A joint at a corner splits the curve there, and other joints are overlapped
+    const VectorC<bool> &corners = fitter.output<RESAMPLING>()->corners;
+    int maxPts = (int)min(fitter.config().get(Parameters::HIERARCHICAL_POINTS), (double)numPts);
+    int minPts = max(maxPts / 4, minPiecePoints);
+    int overlap = max(2 * minPiecePoints, maxPts / 8);
+
+    vector<PieceSplit> joints;
+    double jointParam = 0.;
+    for(int i = 0; i + 1 < coarsePrimitives.size() && i < (int)coarsePath.size(); ++i)
+    {
+        jointParam += coarsePrimitives[i]->length();
+        int orig = (int)(lower_bound(coarseParams.begin(), coarseParams.end(), jointParam) - coarseParams.begin());
+        if(orig == (int)coarseParams.size() || (orig > 0 && jointParam - coarseParams[orig - 1] < coarseParams[orig] - jointParam))
+            --orig;
+
+        double offset;
+        int idx = resampled->paramToIdx(resampledParams[orig], &offset);
+        if(idx + 1 < numPts && 2. * offset > resampled->lengthFromTo(idx, idx + 1))
+            ++idx;
+
+        int continuity = coarseGraph->edges[coarsePath[i]].continuity;
+        if(continuity < 0)
+            continue;
+        PieceSplit joint(idx, overlap);
+        for(int j = max(0, idx - 2); continuity == 0 && j <= min(numPts - 1, idx + 2); ++j)
+        {
+            if(corners[j] && (joint.overlap > 0 || abs(j - idx) < abs(joint.idx - idx)))
+                joint = PieceSplit(j, 0);
+        }
+        if(joints.empty() || joint.idx > joints.back().idx)
+            joints.push_back(joint);
+    }
+
+    //Each split is at the last joint that keeps the piece before it at most maxPts long, or if there is
+    //none, at the first one after that.  No piece is made shorter than minPts past its overlaps.
+    int start = 0, next = 0;
+    while(numPts - 1 - start > maxPts)
+    {
+        int best = -1;
+        for(int k = next; k < (int)joints.size(); ++k)
+        {
+            int idx = joints[k].idx;
+            if(numPts - 1 - idx - joints[k].overlap < minPts)
+                break;
+            if(idx - joints[k].overlap - start < minPts)
+                continue;
+            if(best >= 0 && idx - start > maxPts)
+                break;
+            best = k;
+            if(idx - start > maxPts)
+                break;
+        }
+        if(best < 0)
+            break;
+
+        out.push_back(joints[best]);
+        start = joints[best].idx + joints[best].overlap;
+        next = best + 1;
+    }
+
+    CORNU_DEBUG(printf("Coarse fit has %d primitives, splitting at %d of its joints", (int)coarsePrimitives.size(), (int)out.size()));
+    return out;
+}
+
+void PieceFitter::_setUpPiece(Fitter &piece, const Fitter &fitter, int from, int to, bool hierarchical)
+{
+    piece._params = fitter._params;
+    piece._params.set(Parameters::CORNER_PIECES, 0.); //a piece has no corners left to split at
+    if(!hierarchical)
+        piece._params.set(Parameters::HIERARCHICAL_POINTS, Parameters::infinity);
+    piece.setTimeBudget(_remainingBudget(fitter));
+    piece.setCancellationToken(fitter.cancellationToken());
+    piece.setEdgeCostModel(fitter.edgeCostModel());
+    piece.setValidatedCostModel(fitter.validatedCostModel());
+
+    //the stages through corner detection don't depend on the resampled curve
+    for(int i = 0; i < RESAMPLING; ++i)
+        piece._outputs[i] = fitter._outputs[i];
+
+    const AlgorithmOutput<RESAMPLING> &resampling = *fitter.output<RESAMPLING>();
+    smart_ptr<AlgorithmOutput<RESAMPLING> > out = new AlgorithmOutput<RESAMPLING>();
+    VectorC<Vector2d> pts(to - from + 1, NOT_CIRCULAR);
+    out->corners = VectorC<bool>(pts.size(), NOT_CIRCULAR);
+    for(int i = 0; i < pts.size(); ++i)
+    {
+        pts[i] = resampling.output->pts()[from + i];
+        out->corners[i] = resampling.corners[from + i];
+    }
+    out->corners[0] = out->corners[pts.size() - 1] = true; //like the resampler does at the ends of an open curve
+    out->output = new Polyline(pts);
+
+    piece._outputs[RESAMPLING] = out;
+    piece._originalSketch = out->output;
+    piece._endStage = COMBINING;
+}
+
+double PieceFitter::_remainingBudget(const Fitter &fitter)
+{
+    if(fitter._timeBudget <= 0.)
+        return 0.;
+    double out = chrono::duration<double, milli>(fitter._deadline - Clock::now()).count();
+    return max(out, 1e-6); //a budget that's used up, but still a budget
+}
+
+END_NAMESPACE_Cornu
@@ -0,0 +1,86 @@
+/*--
+    PieceFitter.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_PIECEFITTER_H_INCLUDED
+#define CORNUCOPIA_PIECEFITTER_H_INCLUDED
+
+#include "defs.h"
+
+#include <vector>
+
+NAMESPACE_Cornu
+
+class Fitter;
+
+//A place where an open curve is split for fitting the pieces on its two sides separately.  With no overlap,
+//the pieces share the resampled point idx, which should be a corner (no candidate primitive crosses those),
+//and are joined G0 there.  Otherwise, each piece goes on for overlap resampled points past idx, and the curve
+//switches from the path of the piece before to the path of the one after somewhere in the overlap.
+struct PieceSplit
+{
+    PieceSplit(int inIdx = 0, int inOverlap = 0) : idx(inIdx), overlap(inOverlap) {}
+
+    int idx;
+    int overlap;
+};
+
+//Fitting can take more than linear time in the number of resampled points, and pieces can be fitted in
+//parallel, so a long curve may be fitted faster in pieces.  Each piece gets its own fitter, which shares the
+//outputs of the fitter up to the corner detection, has the piece of the resampled curve, and runs the stages
+//from the error computer through path finding.  The pieces run in parallel.  Their candidates, graphs and paths are then put
+//together as the outputs of those stages of the whole curve's fitter, and the combiner solves for the whole
+//curve, enforcing continuity where the paths meet like at any other joint.
+//Candidates that are fitted to the same points are the same in both pieces, so where the paths of two
+//overlapping pieces meet, or an edge of either graph goes from a primitive of one path to one of the other,
+//the curve can switch paths.  The cheapest switch (the cost of the first path up to it, the edge and the
+//second path from it) that validates is taken.  Away from the ends of the pieces, that is usually the path
+//fitting the whole curve would find.
+//The graph put together has no cost evaluator (it's only good for the path already found in it).
+class PieceFitter
+{
+public:
+    //Called by the fitter before primitive fitting (with the outputs of the stages before it): if the curve
+    //should be fitted in pieces, does that and fills in the outputs and statistics of the stages from primitive
+    //fitting through path finding.  Returns false, leaving those outputs unset, if the curve isn't fitted in
+    //pieces, a piece could not be fitted, or the paths of overlapping pieces could not be joined.
+    static bool run(Fitter &fitter);
+
+    //Fits the pieces between the splits, which must be in order with the pieces between them longer than the
+    //overlaps, and puts the results together as above.  If hierarchicalPieces is true, pieces longer than
+    //Parameters::HIERARCHICAL_POINTS are themselves fitted in pieces.
+    static bool fit(Fitter &fitter, const std::vector<PieceSplit> &splits, bool hierarchicalPieces = false);
+
+    //For Parameters::CORNER_PIECES: splits at the corners, other than ones that would leave very short pieces
+    static std::vector<PieceSplit> cornerSplits(const Fitter &fitter);
+
+    //For the hierarchical mode (see Parameters::HIERARCHICAL_POINTS): fits the original sketch at a coarser
+    //resampling and returns some of the joints of that fit as splits, so the pieces between them have
+    //at most about HIERARCHICAL_POINTS resampled points where possible.  The splits overlap, except at corners.
+    //The coarse fit is itself done in pieces if it's still too long.
+    static std::vector<PieceSplit> coarseSplits(const Fitter &fitter);
+
+private:
+    static void _setUpPiece(Fitter &piece, const Fitter &fitter, int from, int to, bool hierarchical);
+    static double _remainingBudget(const Fitter &fitter); //in milliseconds, zero if the fitter has no budget
+};
+
+END_NAMESPACE_Cornu
+
+#endif //CORNUCOPIA_PIECEFITTER_H_INCLUDED
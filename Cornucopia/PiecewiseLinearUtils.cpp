@@ -20,6 +20,7 @@
 
 #include "PiecewiseLinearUtils.h"
 #include <limits>
+#include <algorithm>
 
 using namespace std;
 using namespace Eigen;
@@ -29,22 +30,47 @@ void PiecewiseLinearMonotone::add(double x, double y)
 {
     const double tol = 1e-8;
 
+    if(_frozen)
+    {
+        CORNU_DEBUG(printf("ERROR: Adding to a frozen function!"));
+        return;
+    }
+
     y *= _sign;
 
-    set<PLPoint>::const_iterator it = _points.insert(PLPoint(x, y)).first;
+    //the points usually come in order, and inserting at the end is then constant time
+    set<PLPoint>::const_iterator it = _points.insert(_points.end(), PLPoint(x, y));
     set<PLPoint>::const_iterator it2 = it;
 
     //self test
     if(it != _points.begin() && y + tol < (--it)->y)
-        Debugging::get()->printf("ERROR: Not monotone w.r.t. prev!");
+        CORNU_DEBUG(printf("ERROR: Not monotone w.r.t. prev!"));
     if(++it2 != _points.end() && y - tol > it2->y)
-        Debugging::get()->printf("ERROR: Not monotone w.r.t. next!");        
+        CORNU_DEBUG(printf("ERROR: Not monotone w.r.t. next!"));        
+}
+
+void PiecewiseLinearMonotone::freeze()
+{
+    if(_frozen)
+        return;
+    _xs.reserve(_points.size());
+    _ys.reserve(_points.size());
+    for(set<PLPoint>::const_iterator it = _points.begin(); it != _points.end(); ++it)
+    {
+        _xs.push_back(it->x);
+        _ys.push_back(it->y);
+    }
+    _points.clear();
+    _frozen = true;
 }
 
 bool PiecewiseLinearMonotone::eval(double x, double &outY) const
 {
     const double tol = 1e-8;
 
+    if(_frozen)
+        return _evalFrozen(x, (int)(lower_bound(_xs.begin(), _xs.end(), x) - _xs.begin()), outY);
+
     if(_points.empty())
         return false;
 
@@ -97,6 +123,9 @@ bool PiecewiseLinearMonotone::invert(double y, double &outX) const
 
     const double tol = 1e-8;
 
+    if(_frozen)
+        return _invertFrozen(y, (int)(lower_bound(_ys.begin(), _ys.end(), y) - _ys.begin()), outX);
+
     if(_points.empty())
         return false;
 
@@ -142,8 +171,95 @@ bool PiecewiseLinearMonotone::invert(double y, double &outX) const
     return true;
 }
 
+//mirrors eval
+bool PiecewiseLinearMonotone::_evalFrozen(double x, int idx, double &outY) const
+{
+    const double tol = 1e-8;
+
+    if(_xs.empty())
+        return false;
+
+    //check if we're near the ends of the range
+    if(fabs(x - _xs.front()) < tol)
+    {
+        outY = _sign * _ys.front();
+        return true;
+    }
+    if(fabs(x - _xs.back()) < tol)
+    {
+        outY = _sign * _ys.back();
+        return true;
+    }
+
+    //check if we're out of range
+    if(idx == 0)
+    {
+        outY = _sign * _ys[0];
+        return false;
+    }
+    if(idx == (int)_xs.size())
+    {
+        outY = _sign * _ys.back();
+        return false;
+    }
+
+    if(_xs[idx] - _xs[idx - 1] < tol) //if the slope is infinite or somehow negative
+    {
+        outY = _sign * _ys[idx - 1];
+        return true;
+    }
+
+    outY = _ys[idx - 1] + (_ys[idx] - _ys[idx - 1]) * (x - _xs[idx - 1]) / (_xs[idx] - _xs[idx - 1]);
+    outY *= _sign;
+    return true;
+}
+
+//mirrors invert, y is already multiplied by _sign
+bool PiecewiseLinearMonotone::_invertFrozen(double y, int idx, double &outX) const
+{
+    const double tol = 1e-8;
+
+    if(_ys.empty())
+        return false;
+
+    //check if we're near the ends of the range
+    if(fabs(y - _ys.front()) < tol)
+    {
+        outX = _xs.front();
+        return true;
+    }
+    if(fabs(y - _ys.back()) < tol)
+    {
+        outX = _xs.back();
+        return true;
+    }
+
+    //check if we're out of range
+    if(idx == 0)
+    {
+        outX = _xs[0];
+        return false;
+    }
+    if(idx == (int)_ys.size())
+    {
+        outX = _xs.back();
+        return false;
+    }
+
+    if(_ys[idx] - _ys[idx - 1] < tol) //if the slope is small or somehow negative
+    {
+        outX = _xs[idx - 1];
+        return true;
+    }
+
+    outX = _xs[idx - 1] + (_xs[idx] - _xs[idx - 1]) * (y - _ys[idx - 1]) / (_ys[idx] - _ys[idx - 1]);
+    return true;
+}
+
 double PiecewiseLinearMonotone::minX() const
 {
+    if(_frozen)
+        return _xs.empty() ? numeric_limits<double>::max() : _xs.front();
     if(_points.empty())
         return numeric_limits<double>::max();
     return _points.begin()->x;
@@ -151,6 +267,8 @@ double PiecewiseLinearMonotone::minX() const
 
 double PiecewiseLinearMonotone::maxX() const
 {
+    if(_frozen)
+        return _xs.empty() ? -numeric_limits<double>::max() : _xs.back();
     if(_points.empty())
         return -numeric_limits<double>::max();
     return (--_points.end())->x;
@@ -158,17 +276,29 @@ double PiecewiseLinearMonotone::maxX() const
 
 bool PiecewiseLinearMonotone::batchEval(vector<double> &inXoutY) const
 {
-    const double tol = 1e-8;
-
-    if(_points.empty())
+    if(_frozen ? _xs.empty() : _points.empty())
         return false;
 
     bool allGood = true;
+    int idx = 0; //of the first point whose x isn't less than the current one, when frozen
     for(int i = 0; i < (int)inXoutY.size(); ++i)
     {
-        if(!eval(inXoutY[i], inXoutY[i]))
+        bool good;
+        if(_frozen)
+        {
+            double x = inXoutY[i];
+            if(idx > 0 && _xs[idx - 1] >= x) //the x's went back, so search for it
+                idx = (int)(lower_bound(_xs.begin(), _xs.begin() + idx, x) - _xs.begin());
+            else
+                while(idx < (int)_xs.size() && _xs[idx] < x)
+                    ++idx;
+            good = _evalFrozen(x, idx, inXoutY[i]);
+        }
+        else
+            good = eval(inXoutY[i], inXoutY[i]);
+        if(!good)
         {
-            Debugging::get()->printf("PiecewiseLinearMonotone evaluation error!");
+            CORNU_DEBUG(printf("PiecewiseLinearMonotone evaluation error!"));
             allGood = false;
         }
     }
@@ -30,14 +30,20 @@ NAMESPACE_Cornu
 //Approximates a monotone function piecewise-linearly.  Supports adding points and solving for x given y.
 //Used for solving for the adjustment to the sampling rate that leads to an integer number of samples and
 //other resampling stuff.
+//Once all the points are added, freeze() compacts them into sorted arrays of x's and y's, which are faster to
+//search, and batchEval() then sweeps through them instead of searching anew for every x--so it's fastest if
+//the x's are mostly increasing.  No points can be added to a frozen function.
 class PiecewiseLinearMonotone
 {
 public:
     enum Sign { POSITIVE, NEGATIVE };
 
-    PiecewiseLinearMonotone(Sign sign) : _sign(sign ? -1. : 1.) {}
+    PiecewiseLinearMonotone(Sign sign) : _sign(sign ? -1. : 1.), _frozen(false) {}
 
     void add(double x, double y);
+    void freeze();
+    bool frozen() const { return _frozen; }
+
     bool eval(double x, double &outY) const; //returns true if evaluation is successful
     bool invert(double y, double &outX) const; //returns true if inversion is successful
 
@@ -57,8 +63,14 @@ private:
         bool compareByY;
     };
 
+    //the evaluation and inversion on the frozen arrays, given the index of the first x (or y) that isn't less
+    bool _evalFrozen(double x, int idx, double &outY) const;
+    bool _invertFrozen(double y, int idx, double &outX) const;
+
     double _sign;
-    std::set<PLPoint> _points;
+    std::set<PLPoint> _points; //empty once frozen
+    bool _frozen;
+    std::vector<double> _xs, _ys; //the points, in order, once frozen (the y's are multiplied by _sign, like in _points)
 };
 
 END_NAMESPACE_Cornu
@@ -19,18 +19,40 @@
 */
 
 #include "Polyline.h"
+#include "BoxTree.h"
 
 using namespace std;
 using namespace Eigen;
 NAMESPACE_Cornu
 
-Polyline::Polyline(const VectorC<Eigen::Vector2d> &pts) : _pts(pts)
+Polyline::Polyline(const VectorC<Eigen::Vector2d> &pts) : _pts(pts), _tree(NULL)
+{
+    _init();
+}
+
+Polyline::Polyline(const double *xy, int numPts, int stride) : _pts(numPts, NOT_CIRCULAR), _tree(NULL)
+{
+    for(int i = 0; i < numPts; ++i, xy += stride)
+        _pts[i] = Vector2d(xy[0], xy[1]);
+    _init();
+}
+
+void Polyline::_init()
 {
     assert(_pts.size() > 1);
-    _lengths.reserve(pts.size() + 1);
-    _lengths.push_back(0);
-    for(int i = 0; i < pts.endIdx(1); ++i)
-        _lengths.push_back(_lengths.back() + (pts[i] - pts[i + 1]).norm());
+    //one pass over the points for both, with the coordinates of a point in one SSE register
+    _lengths.resize(_pts.endIdx(1) + 1);
+    _lengths[0] = 0;
+    Vector2d lo = _pts.flatAt(0), hi = lo;
+    for(int i = 0; i < _pts.endIdx(1); ++i)
+    {
+        const Vector2d &next = _pts[i + 1];
+        _lengths[i + 1] = _lengths[i] + (_pts.flatAt(i) - next).norm();
+        lo = lo.cwiseMin(next);
+        hi = hi.cwiseMax(next);
+    }
+    _bounds.extend(lo);
+    _bounds.extend(hi);
 }
 
 int Polyline::paramToIdx(double param, double *outParam) const
@@ -41,7 +63,7 @@ int Polyline::paramToIdx(double param, double *outParam) const
     return idx;
 }
 
-void Polyline::eval(double s, Vec *pos, Vec *der, Vec *der2) const
+double Polyline::_wrap(double s) const
 {
     if(_pts.circular())
     {
@@ -49,8 +71,11 @@ void Polyline::eval(double s, Vec *pos, Vec *der, Vec *der2) const
         if(s < 0.)
             s += _lengths.back();
     }
-    double cParam;
-    int idx = paramToIdx(s, &cParam);
+    return s;
+}
+
+void Polyline::_evalSegment(int idx, double cParam, Vec *pos, Vec *der, Vec *der2) const
+{
     int nidx = (idx + 1) % _pts.size();
     double invLength = (1. / (_lengths[idx + 1] - _lengths[idx]));
     if(pos)
@@ -61,12 +86,85 @@ void Polyline::eval(double s, Vec *pos, Vec *der, Vec *der2) const
         (*der2) = Vec();
 }
 
-double Polyline::project(const Vector2d &point) const
+void Polyline::eval(double s, Vec *pos, Vec *der, Vec *der2) const
+{
+    double cParam;
+    int idx = paramToIdx(_wrap(s), &cParam);
+    _evalSegment(idx, cParam, pos, der, der2);
+}
+
+int Polyline::Cursor::advanceTo(double s, double *outParam)
+{
+    const vector<double> &lengths = _polyline->_lengths;
+    s = _polyline->_wrap(s + _offset);
+
+    //walk forward a few segments, and if that's not enough, search
+    const int lastIdx = (int)lengths.size() - 2;
+    for(int steps = 0; steps < 4 && _idx < lastIdx && lengths[_idx + 1] <= s; ++steps)
+        ++_idx;
+    if(lengths[_idx] > s || (_idx < lastIdx && lengths[_idx + 1] <= s))
+        _idx = max(0, _polyline->paramToIdx(s));
+
+    if(outParam)
+        *outParam = s - lengths[_idx];
+    return _idx;
+}
+
+void Polyline::Cursor::eval(double s, Vec *pos, Vec *der, Vec *der2)
+{
+    double cParam;
+    int idx = advanceTo(s, &cParam);
+    _polyline->_evalSegment(idx, cParam, pos, der, der2);
+}
+
+Polyline::Polyline(const Polyline &other)
+    : Curve(other), _pts(other._pts), _lengths(other._lengths), _bounds(other._bounds), _tree(NULL)
+{
+}
+
+Polyline::~Polyline()
+{
+    delete _tree.load();
+}
+
+Polyline &Polyline::operator=(const Polyline &other)
+{
+    _pts = other._pts;
+    _lengths = other._lengths;
+    _bounds = other._bounds;
+    delete _tree.exchange(NULL);
+    return *this;
+}
+
+const BoxTree *Polyline::_segmentTree() const
+{
+    BoxTree *tree = _tree.load(memory_order_acquire);
+    if(tree || _pts.endIdx(1) <= 64)
+        return tree;
+
+    vector<BoxTree::Box> boxes(_pts.endIdx(1));
+    for(int i = 0; i < (int)boxes.size(); ++i)
+    {
+        boxes[i].extend(_pts[i]);
+        boxes[i].extend(_pts[i + 1]);
+    }
+
+    //if several threads build the tree at once, the first one to finish wins
+    BoxTree *newTree = new BoxTree(boxes);
+    if(_tree.compare_exchange_strong(tree, newTree, memory_order_acq_rel))
+        return newTree;
+    delete newTree;
+    return tree;
+}
+
+double Polyline::_closest(const Vector2d &point, double *outDistSq) const
 {
     double bestS = 0.;
     double minDistSq = (point - _pts[0]).squaredNorm();
+    int bestIdx = -1;
 
-    for(int i = 0; i < _pts.endIdx(1); ++i)
+    //among equally close segments, the first one wins, the same as scanning them in order
+    auto trySegment = [&](int i)
     {
         double len = (_lengths[i + 1] - _lengths[i]);
         double invLen = 1. / len;
@@ -79,16 +177,60 @@ double Polyline::project(const Vector2d &point) const
 
         Vector2d ptOnLine = _pts[i] + (_pts[i + 1] - _pts[i]) * (dot * invLen);
         double distSq = (ptOnLine - point).squaredNorm();
-        if(distSq < minDistSq)
+        if(distSq < minDistSq || (distSq == minDistSq && bestIdx > i))
         {
             minDistSq = distSq;
             bestS = _lengths[i] + dot;
+            bestIdx = i;
         }
+    };
+
+    const BoxTree *tree = _segmentTree();
+    if(tree)
+        tree->visit(point, minDistSq, trySegment);
+    else
+    {
+        for(int i = 0; i < _pts.endIdx(1); ++i)
+            trySegment(i);
     }
 
+    if(outDistSq)
+        *outDistSq = minDistSq;
     return bestS;
 }
 
+double Polyline::project(const Vector2d &point) const
+{
+    return _closest(point, NULL);
+}
+
+double Polyline::distanceSqTo(const Vector2d &point) const
+{
+    double distSq;
+    _closest(point, &distSq);
+    return distSq;
+}
+
+void Polyline::evalMany(const double *s, int n, Vec *pos, Vec *der, Vec *der2) const
+{
+    Cursor cursor(*this);
+    for(int i = 0; i < n; ++i)
+        cursor.eval(s[i], pos ? pos + i : NULL, der ? der + i : NULL, der2 ? der2 + i : NULL);
+}
+
+void Polyline::projectMany(const Vec *points, int n, double *out) const
+{
+    for(int i = 0; i < n; ++i)
+        out[i] = Polyline::project(points[i]);
+}
+
+void Polyline::tessellate(double, PointVector &out) const
+{
+    out.insert(out.end(), _pts.begin(), _pts.end());
+    if(isClosed() && !_pts.empty())
+        out.push_back(_pts[0]);
+}
+
 double Polyline::lengthFromTo(int fromIdx, int toIdx) const
 {
     double out = _lengths[toIdx] - _lengths[fromIdx];
@@ -98,6 +240,11 @@ double Polyline::lengthFromTo(int fromIdx, int toIdx) const
 }
 
 PolylinePtr Polyline::trimmed(double from, double to) const
+{
+    return trimmedView(from, to).toPolyline();
+}
+
+PolylineView Polyline::trimmedView(double from, double to) const
 {
     double len = length();
 
@@ -128,29 +275,81 @@ PolylinePtr Polyline::trimmed(double from, double to) const
             swap(from, to);
     }
 
-    VectorC<Vector2d> out(0, NOT_CIRCULAR);
+    PolylineView out;
+    out._parent = this;
+    out._from = from;
+    out._to = to;
+    out._length = max(0., (to + tol < from) ? to + len - from : to - from);
+    out._closed = false;
+    out._startAdded = true; //the first point is there no matter what
 
     double paramRemainder;
     int startIdx = paramToIdx(from, &paramRemainder);
+    int endIdx = paramToIdx(to, &paramRemainder);
 
-    out.push_back(pos(from)); //push the first point no matter what
+    //points from the existing polyline if necessary
+    int numInner = 0;
+    if(startIdx != endIdx || (to + tol < from))
+        numInner = isClosed() ? (endIdx - startIdx + _pts.size() - 1) % _pts.size() + 1 : endIdx - startIdx;
+    out._firstIdx = startIdx + 1;
 
-    int endIdx = paramToIdx(to, &paramRemainder);
+    out._endAdded = (paramRemainder > tol); //if there's something leftover at the end, add the endpoint
+    out._numPts = 1 + numInner + (out._endAdded ? 1 : 0);
 
-    if(startIdx != endIdx || (to + tol < from)) //add points from existing polyline if necessary
-    {
-        for(VectorC<Vector2d>::Circulator circ = _pts.circulator(startIdx + 1); !circ.done() ; ++circ)
-        {
-            out.push_back(*circ);
+    return out;
+}
 
-            if(circ.index() == endIdx)
-                break;
-        }
+PolylineView::PolylineView(const Polyline &parent)
+    : _parent(&parent), _from(0), _to(parent.length()), _length(parent.length()), _closed(parent.isClosed()),
+      _startAdded(false), _endAdded(false), _firstIdx(0), _numPts(parent.pts().size())
+{
+}
+
+PolylineView::PolylineView(const Polyline &parent, int fromIdx, int toIdx)
+    : _parent(&parent), _closed(false), _startAdded(false), _endAdded(false), _firstIdx(fromIdx)
+{
+    _from = parent.idxToParam(fromIdx);
+    _to = parent.idxToParam(toIdx);
+    _length = _to - _from;
+    _numPts = toIdx - fromIdx + 1;
+    if(toIdx <= fromIdx) //wrapped around a closed polyline
+    {
+        _length += parent.length();
+        _numPts += parent.pts().size();
     }
+}
 
-    if(paramRemainder > tol) //if there's something leftover at the end, add the endpoint
-        out.push_back(pos(to));
+PolylineView::Vec PolylineView::pt(int idx) const
+{
+    if(_startAdded && idx == 0)
+        return _parent->pos(_from);
+    int parentIdx = _firstIdx + idx - (_startAdded ? 1 : 0);
+    if(_endAdded && idx + 1 == _numPts)
+        return _parent->pos(_to);
+    return _parent->pts()[parentIdx];
+}
 
+double PolylineView::idxToParam(int idx) const
+{
+    if(_startAdded && idx == 0)
+        return 0.;
+    if(idx + 1 >= _numPts && (_endAdded || idx == _numPts))
+        return _length;
+
+    //_firstIdx + idx may be past the end of a closed parent
+    int size = _parent->pts().size();
+    int parentIdx = _firstIdx + idx - (_startAdded ? 1 : 0);
+    double out = _parent->idxToParam(parentIdx % size) - _from;
+    if(parentIdx >= size)
+        out += _parent->length();
+    return out;
+}
+
+PolylinePtr PolylineView::toPolyline() const
+{
+    VectorC<Vector2d> out(_numPts, _closed ? CIRCULAR : NOT_CIRCULAR);
+    for(int i = 0; i < _numPts; ++i)
+        out[i] = pt(i);
     return new Polyline(out);
 }
 
@@ -24,16 +24,25 @@
 #include "defs.h"
 #include "Curve.h"
 #include "VectorC.h"
+#include "BoxTree.h"
+#include <atomic>
 
 NAMESPACE_Cornu
 
 CORNU_SMART_FORW_DECL(Polyline);
+class PolylineView;
 
 //A polyline must have at least two points
 class Polyline : public Curve
 {
 public:
     Polyline(const VectorC<Eigen::Vector2d> &pts);
+    //reads numPts open polyline points from interleaved coordinates: point i is at (xy[i * stride], xy[i * stride + 1])
+    Polyline(const double *xy, int numPts, int stride = 2);
+    Polyline(const Polyline &other);
+    ~Polyline();
+
+    Polyline &operator=(const Polyline &other);
 
     //overrides
     double length() const { return _lengths.back(); }
@@ -42,6 +51,10 @@ public:
     void eval(double s, Vec *pos, Vec *der = NULL, Vec *der2 = NULL) const;
 
     double project(const Vec &point) const;
+    void evalMany(const double *s, int n, Vec *pos, Vec *der = NULL, Vec *der2 = NULL) const;
+    void projectMany(const Vec *points, int n, double *out) const;
+    void tessellate(double tolerance, PointVector &out) const; //the points, with the first again at the end if closed
+    double distanceSqTo(const Vec &point) const;
 
     //utility functions
     int paramToIdx(double param, double *outParam = NULL) const;
@@ -53,14 +66,85 @@ public:
     //the length of the original curve.  Arguments can be negative and to can be smaller
     //than from for a closed polyline.
     PolylinePtr trimmed(double from, double to) const;
+    //Same as trimmed, but without copying the points
+    PolylineView trimmedView(double from, double to) const;
 
     const VectorC<Eigen::Vector2d> &pts() const { return _pts; }
+    const BoxTree::Box &bounds() const { return _bounds; } //of the points
+    size_t memoryBytes() const { return _pts.capacity() * sizeof(Eigen::Vector2d) + _lengths.capacity() * sizeof(double); } //without the segment tree
+
+    //Evaluates the polyline at parameters that mostly increase, as when sampling it, by walking from the
+    //segment of the previous parameter instead of searching for the segment every time.  Gives the same
+    //results as eval.  The offset is added to every parameter.
+    class Cursor
+    {
+    public:
+        Cursor(const Polyline &polyline, double offset = 0.) : _polyline(&polyline), _offset(offset), _idx(0) {}
+
+        //moves to the segment containing s (wrapped around a closed polyline) and returns it, like paramToIdx
+        int advanceTo(double s, double *outParam = NULL);
+
+        void eval(double s, Vec *pos, Vec *der = NULL, Vec *der2 = NULL);
+        Vec pos(double s) { Vec out; eval(s, &out); return out; }
+
+    private:
+        const Polyline *_polyline;
+        double _offset;
+        int _idx;
+    };
 
 private:
+    void _init(); //computes the lengths and the bounds
+    double _wrap(double s) const; //brings a parameter of a closed polyline into [0, length)
+    void _evalSegment(int idx, double cParam, Vec *pos, Vec *der, Vec *der2) const;
+    double _closest(const Vec &point, double *outDistSq) const; //returns the parameter of the closest point
+    const BoxTree *_segmentTree() const; //NULL if the polyline is too short to need one
+
     VectorC<Eigen::Vector2d> _pts;
     //lengths[x] = \sum_{i=1}^{i=x} ||pts[i]-pts[i-1]||, i.e., length up to point x
     //For closed curves, _lengths has a last member which is the total curve length.
     std::vector<double> _lengths; 
+    BoxTree::Box _bounds;
+    //bounding boxes of the segments for projecting onto long polylines, built by the first projection
+    mutable std::atomic<BoxTree *> _tree;
+};
+
+//A piece of a polyline that refers to its points instead of copying them.  Its points are those of
+//the polyline that trimmed() would return: the polyline's points in the range, plus the endpoints of
+//the range if they are not points of the polyline.  The parent polyline must outlive the view.
+class PolylineView
+{
+public:
+    typedef Eigen::Vector2d Vec;
+
+    PolylineView(const Polyline &parent); //the whole polyline
+    //The part between two of the parent's points.  For closed polylines, toIdx may be smaller than
+    //fromIdx, and if they are equal, the view goes all the way around (but is not closed).
+    PolylineView(const Polyline &parent, int fromIdx, int toIdx);
+
+    double length() const { return _length; }
+    bool isClosed() const { return _closed; }
+    bool isParamValid(double param) const { return _closed || (param >= 0 && param <= _length); }
+    Vec pos(double s) const { return _parent->pos(_from + s); }
+
+    int numPts() const { return _numPts; }
+    Vec pt(int idx) const;
+    double idxToParam(int idx) const; //idx can be numPts() for a closed view--that's the total length
+
+    PolylinePtr toPolyline() const;
+    Polyline::Cursor cursor() const { return Polyline::Cursor(*_parent, _from); } //for evaluating like pos
+
+private:
+    friend class Polyline;
+    PolylineView() {}
+
+    const Polyline *_parent;
+    double _from, _to; //parent parameters of the ends
+    double _length;
+    bool _closed;
+    bool _startAdded, _endAdded; //whether the range endpoints are extra points
+    int _firstIdx; //the parent index of the first point of the parent that's in the view
+    int _numPts;
 };
 
 END_NAMESPACE_Cornu
@@ -54,12 +54,9 @@ protected:
     {
         double pixel = fitter.params().get(Parameters::PIXEL_SIZE);
 
-        //compute the diagonal length of the bounding box of the curve
-        const VectorC<Vector2d> &pts = fitter.originalSketch()->pts();
-        AlignedBox<double, 2> boundingBox(pts[0]);
-        for(int i = 1; i < (int)pts.size(); ++i)
-            boundingBox.extend(pts[i]);
-        double diag = boundingBox.diagonal().norm();
+        //the diagonal length of the bounding box of the curve, which the polyline found along with its lengths
+        const BoxTree::Box &bounds = fitter.originalSketch()->bounds();
+        double diag = Vector2d(bounds.max[0] - bounds.min[0], bounds.max[1] - bounds.min[1]).norm();
 
         const double smallCurvePixels = fitter.params().get(Parameters::SMALL_CURVE_PIXELS);
         const double largeCurvePixels = fitter.params().get(Parameters::LARGE_CURVE_PIXELS);
@@ -82,112 +79,126 @@ void Algorithm<SCALE_DETECTION>::_initialize()
 
 //========================Preliminary Resampling=============================
 
-class DefaultPrelimResampling : public Algorithm<PRELIM_RESAMPLING>
+RadiusResampler::RadiusResampler(double radius)
+    : _radius(radius), _outPts(0, NOT_CIRCULAR), _inputToOutput(PiecewiseLinearMonotone::POSITIVE), _lengthSoFar(0), _prevParam(0)
 {
-public:
-    string name() const { return "Default"; }
+}
 
-protected:
-    void _run(const Fitter &fitter, AlgorithmOutput<PRELIM_RESAMPLING> &out)
+void RadiusResampler::addPoint(const Vector2d &curPt, double param, bool keep)
+{
+    if(_outPts.empty())
     {
-        const VectorC<Vector2d> &pts = fitter.originalSketch()->pts();
-        VectorC<Vector2d> outPts(0, NOT_CIRCULAR);
-        PiecewiseLinearMonotone origToCur(PiecewiseLinearMonotone::POSITIVE);
+        _outPts.push_back(curPt);
+        _inputToOutput.add(param, 0);
+        _prevPt = curPt;
+        _prevParam = param;
+        return;
+    }
 
-        const double radius = fitter.scaledParameter(Parameters::MIN_PRELIM_LENGTH);
+    while(true) //a point may subdivide the segment to it several times
+    {
+        Vector2d curResampled = _outPts.back();
 
-        //First mark the points on the original curve we definitely want to keep (e.g., corners) using Douglas-Peucker
-        vector<bool> keep = _markDouglasPeucker(pts, fitter.scaledParameter(Parameters::DP_CUTOFF));
+        double distSqToCur = (curPt - curResampled).squaredNorm();
 
-        //Go through the points and resample them at the rate of radius, discarding those that are too close
-        //to the previous output point, and subdiving the line segments between points that are too far.
-        //Note that we don't want to simply resample the curve by the arclength parameterization, because
-        //noisy regions with too much arclength will get too many samples.
-        outPts.push_back(pts[0]);
-        origToCur.add(0, 0);
-        double lengthSoFar = 0;
-        for(int idx = 1; idx < pts.size(); ++idx)
+        //If it was marked for keeping, just output it
+        if(keep)
         {
-            Vector2d curResampled = outPts.back();
-            Vector2d curPt = pts[idx];
+            _lengthSoFar += sqrt(distSqToCur);
+            _inputToOutput.add(param, _lengthSoFar);
+            if(distSqToCur > 1e-16)
+                _outPts.push_back(curPt);
+            break;
+        }
 
-            double distSqToCur = (curPt - curResampled).squaredNorm();
+        //If this point is within radius of the last output point (i.e., too close), discard it.
+        if(distSqToCur < SQR(_radius))
+            break;
 
-            //If it's the last point or was marked for keeping, just output it
-            if(idx + 1 == pts.size() || keep[idx])
-            {
-                lengthSoFar += sqrt(distSqToCur);
-                origToCur.add(fitter.originalSketch()->idxToParam(idx), lengthSoFar);
-                if(distSqToCur > 1e-16)
-                    outPts.push_back(curPt);
-                continue;
-            }
+        //The previous point has to be within radius of the previous output point
+        //Find the intersection of the line segment between the previous and the current point with the circle
+        //centered at the last output point whose radius is "radius".
+        ParametrizedLine<double, 2> line = ParametrizedLine<double, 2>::Through(_prevPt, curPt);
 
-            //If this point is within radius of the last output point (i.e., too close), discard it.
-            if(distSqToCur < SQR(radius))
-                continue;
+        double projectedLineParam = line.direction().dot(curResampled - line.origin());
+        Vector2d closestOnLine = line.origin() + line.direction() * projectedLineParam;
+        double distSqToLine = (curResampled - closestOnLine).squaredNorm();
+        if(distSqToLine < 1e-16)
+        {
+            _lengthSoFar += sqrt(distSqToCur);
+            _inputToOutput.add(param, _lengthSoFar);
+            _outPts.push_back(curPt);
+            break;
+        }
+        double y = sqrt(max(0., _radius * _radius - distSqToLine));
+        Vector2d newPt = closestOnLine + y * line.direction(); //y is positive, so this will find the correct point
 
-            //The previous point has to be within radius of the previous output point
-            Vector2d prevPt = pts[idx - 1];
-            
-            //Find the intersection of the line segment between the previous and the current point with the circle
-            //centered at the last output point whose radius is "radius".
-            ParametrizedLine<double, 2> line = ParametrizedLine<double, 2>::Through(prevPt, curPt);
-
-            double projectedLineParam = line.direction().dot(curResampled - line.origin());
-            Vector2d closestOnLine = line.origin() + line.direction() * projectedLineParam;
-            double distSqToLine = (curResampled - closestOnLine).squaredNorm();
-            if(distSqToLine < 1e-16)
-            {
-                lengthSoFar += sqrt(distSqToCur);
-                origToCur.add(fitter.originalSketch()->idxToParam(idx), lengthSoFar);
-                outPts.push_back(curPt);
-                continue;
-            }
-            double y = sqrt(max(0., radius * radius - distSqToLine));
-            Vector2d newPt = closestOnLine + y * line.direction(); //y is positive, so this will find the correct point
+        _lengthSoFar += (curResampled - newPt).norm();
+        _inputToOutput.add(_prevParam + projectedLineParam + y, _lengthSoFar);
+        _outPts.push_back(newPt);
+    }
 
-            lengthSoFar += (curResampled - newPt).norm();
-            origToCur.add(fitter.originalSketch()->idxToParam(idx - 1) + projectedLineParam + y, lengthSoFar);
-            outPts.push_back(newPt);
-            --idx;
-        }
+    _prevPt = curPt;
+    _prevParam = param;
+}
 
-        out.output = new Polyline(outPts);
-        out.parameters.resize(pts.size());
-        for(int i = 0; i < pts.size(); ++i)
+//marks the points to keep between start and end - 1 (which are kept)
+static void dpHelper(const Vector2d *pts, vector<bool> &out, double cutoff, int start, int end)
+{
+    Line cur(pts[start], pts[end - 1]);
+    double maxDist = cutoff;
+    int mid = -1;
+    for(int i = start; i < end; ++i)
+    {
+        double dist = cur.distanceTo(pts[i]);
+        if(dist > maxDist)
         {
-            double paramOrig = fitter.originalSketch()->idxToParam(i);
-            double paramNew;
-            if(!origToCur.eval(paramOrig, paramNew))
-                Debugging::get()->printf("Evaluation error!");
-            out.parameters[i] = paramNew;
-            //Debugging::get()->drawLine(pts[i], out.output->pos(paramNew), Vector3d(1, 0, 1), "Correspondence");
+            maxDist = dist;
+            mid = i;
         }
-
-        for(int i = 0; i < (int)outPts.size(); ++i)
-            Debugging::get()->drawPoint(outPts[i], Vector3d(0, (i % 10 == 0) ? 0.6 : 0, 1), "Prelim resampled");
-        Debugging::get()->drawCurve(out.output, Vector3d(0, 0, 1), "Prelim resampled curve");
     }
+    if(mid < 0)
+        return;
+    out[mid] = true;
+    dpHelper(pts, out, cutoff, start, mid + 1);
+    dpHelper(pts, out, cutoff, mid, end);
+}
 
-private:
-    vector<bool> _markDouglasPeucker(const VectorC<Vector2d> &pts, double cutoff)
-    {
-        vector<bool> out(pts.size(), false);
-        out.front() = out.back() = true;
+static vector<bool> markDouglasPeucker(const Vector2d *pts, int num, double cutoff)
+{
+    vector<bool> out(num, false);
+    out.front() = out.back() = true;
 
-        _dpHelper(pts, out, cutoff, 0, pts.size());
-        return out;
+    dpHelper(pts, out, cutoff, 0, num);
+    return out;
+}
+
+StreamingPrelimResampler::StreamingPrelimResampler(double cutoff, double radius, int maxPending)
+    : _cutoff(cutoff), _maxPending(maxPending), _numPoints(0), _resampler(radius)
+{
+}
+
+void StreamingPrelimResampler::addPoint(const Vector2d &pt, double param)
+{
+    ++_numPoints;
+    _pending.push_back(pt);
+    _pendingParams.push_back(param);
+    if(_pending.size() == 1) //the first point is kept
+    {
+        _resampler.addPoint(pt, param, true);
+        return;
     }
 
-    void _dpHelper(const VectorC<Vector2d> &pts, vector<bool> &out, double cutoff, int start, int end)
+    while(true)
     {
-        Line cur(pts[start], pts[end - 1]);
-        double maxDist = cutoff;
+        //find the point farthest from the segment between the last kept point and the new one
+        int last = (int)_pending.size() - 1;
+        Line cur(_pending[0], _pending[last]);
+        double maxDist = _cutoff;
         int mid = -1;
-        for(int i = start; i < end; ++i)
+        for(int i = 1; i < last; ++i)
         {
-            double dist = cur.distanceTo(pts[i]);
+            double dist = cur.distanceTo(_pending[i]);
             if(dist > maxDist)
             {
                 maxDist = dist;
@@ -195,10 +206,108 @@ private:
             }
         }
         if(mid < 0)
-            return;
-        out[mid] = true;
-        _dpHelper(pts, out, cutoff, start, mid + 1);
-        _dpHelper(pts, out, cutoff, mid, end);
+            break;
+        _decide(mid);
+    }
+
+    if((int)_pending.size() > _maxPending) //don't let points wait too long
+        _decide((int)_pending.size() - 2);
+}
+
+void StreamingPrelimResampler::finish()
+{
+    if((int)_pending.size() > 1)
+        _decide((int)_pending.size() - 1);
+}
+
+void StreamingPrelimResampler::_decide(int last)
+{
+    vector<bool> keep = markDouglasPeucker(&(_pending[0]), last + 1, _cutoff);
+    for(int i = 1; i <= last; ++i)
+        _resampler.addPoint(_pending[i], _pendingParams[i], keep[i]);
+
+    _pending.erase(_pending.begin(), _pending.begin() + last);
+    _pendingParams.erase(_pendingParams.begin(), _pendingParams.begin() + last);
+}
+
+//sets the output from the resampled points of the original sketch, after which no points can be added to the resampler
+static void setOutput(const Fitter &fitter, RadiusResampler &resampler, AlgorithmOutput<PRELIM_RESAMPLING> &out)
+{
+    const VectorC<Vector2d> &outPts = resampler.output();
+    out.output = new Polyline(outPts);
+
+    //the original parameters increase, so the frozen map takes them all in one sweep instead of a search each
+    resampler.freeze();
+    out.parameters.resize(fitter.originalSketch()->pts().size());
+    for(int i = 0; i < (int)out.parameters.size(); ++i)
+        out.parameters[i] = fitter.originalSketch()->idxToParam(i);
+    if(!resampler.inputToOutput().batchEval(out.parameters))
+        CORNU_DEBUG(printf("Evaluation error!"));
+
+    for(int i = 0; i < (int)outPts.size(); ++i)
+        CORNU_DEBUG(drawPoint(outPts[i], Vector3d(0, (i % 10 == 0) ? 0.6 : 0, 1), "Prelim resampled"));
+    CORNU_DEBUG(drawCurve(out.output, Vector3d(0, 0, 1), "Prelim resampled curve"));
+}
+
+class DefaultPrelimResampling : public Algorithm<PRELIM_RESAMPLING>
+{
+public:
+    string name() const { return "Default"; }
+
+protected:
+    void _run(const Fitter &fitter, AlgorithmOutput<PRELIM_RESAMPLING> &out)
+    {
+        const VectorC<Vector2d> &pts = fitter.originalSketch()->pts();
+
+        //First mark the points on the original curve we definitely want to keep (e.g., corners) using Douglas-Peucker
+        vector<bool> keep = markDouglasPeucker(&(pts[0]), pts.size(), fitter.scaledParameter(Parameters::DP_CUTOFF));
+
+        //Go through the points and resample them at the rate of radius, discarding those that are too close
+        //to the previous output point, and subdiving the line segments between points that are too far.
+        //Note that we don't want to simply resample the curve by the arclength parameterization, because
+        //noisy regions with too much arclength will get too many samples.
+        //A repeated point (tablets report many while the pen is still) changes nothing, because the resampler
+        //leaves every point it's given within radius of its last output point, so it's skipped.
+        RadiusResampler resampler(fitter.scaledParameter(Parameters::MIN_PRELIM_LENGTH));
+        for(int idx = 0; idx < pts.size(); ++idx)
+        {
+            bool last = idx + 1 == pts.size(); //the last point is always output
+            if(idx > 0 && !last && !keep[idx] && pts[idx] == pts[idx - 1])
+                continue;
+            resampler.addPoint(pts[idx], fitter.originalSketch()->idxToParam(idx), last || keep[idx]);
+        }
+
+        setOutput(fitter, resampler, out);
+    }
+};
+
+//Same as the default, but the corners are marked by the online version of Douglas-Peucker, so when points are
+//appended to the sketch, it continues from where the previous run left off.
+class StreamingPrelimResampling : public Algorithm<PRELIM_RESAMPLING>
+{
+public:
+    string name() const { return "Streaming"; }
+
+protected:
+    void _run(const Fitter &fitter, AlgorithmOutput<PRELIM_RESAMPLING> &out)
+    {
+        const VectorC<Vector2d> &pts = fitter.originalSketch()->pts();
+
+        StreamingPrelimResamplerPtr streaming;
+        smart_ptr<const AlgorithmOutput<PRELIM_RESAMPLING> > previous = fitter.previousOutput<PRELIM_RESAMPLING>();
+        if(previous && previous->streaming && previous->streaming->numPoints() <= pts.size() &&
+           fitter.previousOutput<SCALE_DETECTION>()->scale == fitter.output<SCALE_DETECTION>()->scale)
+            streaming = new StreamingPrelimResampler(*previous->streaming);
+        else
+            streaming = new StreamingPrelimResampler(fitter.scaledParameter(Parameters::DP_CUTOFF), fitter.scaledParameter(Parameters::MIN_PRELIM_LENGTH));
+
+        for(int idx = streaming->numPoints(); idx < pts.size(); ++idx)
+            streaming->addPoint(pts[idx], fitter.originalSketch()->idxToParam(idx));
+        out.streaming = streaming;
+
+        StreamingPrelimResampler finished(*streaming);
+        finished.finish();
+        setOutput(fitter, finished.finishedResampler(), out);
     }
 };
 
@@ -217,19 +326,23 @@ protected:
     }
 };
 
+size_t AlgorithmOutput<PRELIM_RESAMPLING>::memoryBytes() const
+{
+    return (output ? output->memoryBytes() : 0) + vectorBytes(parameters);
+}
+
 void Algorithm<PRELIM_RESAMPLING>::_initialize()
 {
     new DefaultPrelimResampling();
     new NoPrelimResampling();
+    new StreamingPrelimResampling();
 }
 
 //========================Curve Closer=============================
 
-class OldCurveCloser : public Algorithm<CURVE_CLOSING>
+//The closers differ only in how they find the closest pair of points near the start and the end of the curve
+class CurveCloserBase : public Algorithm<CURVE_CLOSING>
 {
-public:
-    string name() const { return "Old"; }
-
 protected:
     void _run(const Fitter &fitter, AlgorithmOutput<CURVE_CLOSING> &out)
     {
@@ -272,23 +385,7 @@ protected:
         //now find the points closest to each other that are within tol of each
         //other and of the segment connecting the start and end points
         int closest0 = 0, closest1 = (int)pts.size() - 1;
-        double minDistSq = tolSq;
-        for(int i = 0; i < farthest; ++i) {
-            double t = startEnd.project(pts[i]);
-            if((pts[i] - startEnd.pos(t)).squaredNorm() > tolSq)
-                break;
-            for(int j = (int)pts.size() - 1; j > farthest; --j) {
-                double t2 = startEnd.project(pts[j]);
-                if((pts[j] - startEnd.pos(t2)).squaredNorm() > tolSq)
-                    break;
-                double distSq = (pts[i] - pts[j]).squaredNorm();
-                if(distSq > minDistSq)
-                    continue;
-                minDistSq = distSq;
-                closest0 = i;
-                closest1 = j;
-            }
-        }
+        double minDistSq = _closestPair(pts, startEnd, farthest, tolSq, closest0, closest1);
 
         if(minDistSq == tolSq)
             return;
@@ -333,15 +430,174 @@ protected:
 
 #if 0
         for(int i = 0; i < (int)out.parameters.size(); ++i)
-            Debugging::get()->drawLine(fitter.originalSketch()->pts()[i], out.output->pos(out.parameters[i]), Vector3d(1, 0, 1), "Closed Correspondence");
+            CORNU_DEBUG(drawLine(fitter.originalSketch()->pts()[i], out.output->pos(out.parameters[i]), Vector3d(1, 0, 1), "Closed Correspondence"));
 #endif
 
-        Debugging::get()->drawCurve(out.output, Debugging::Color(0., 0., 0.), "Closed", 2., Debugging::DOTTED);
+        CORNU_DEBUG(drawCurve(out.output, Debugging::Color(0., 0., 0.), "Closed", 2., Debugging::DOTTED));
+    }
+
+    //Considers the points before farthest and after farthest, stopping at the first one on either side
+    //that is more than tol away from startEnd.  Returns the smallest squared distance (at most tolSq)
+    //between such points and sets closest0 and closest1 to the pair.  Among equally close pairs,
+    //the one with the largest closest0 and then the smallest closest1 is chosen.
+    virtual double _closestPair(const VectorC<Vector2d> &pts, const Line &startEnd, int farthest, double tolSq,
+                                int &closest0, int &closest1) const = 0;
+};
+
+class OldCurveCloser : public CurveCloserBase
+{
+public:
+    string name() const { return "Old"; }
+
+protected:
+    double _closestPair(const VectorC<Vector2d> &pts, const Line &startEnd, int farthest, double tolSq,
+                        int &closest0, int &closest1) const
+    {
+        double minDistSq = tolSq;
+        for(int i = 0; i < farthest; ++i) {
+            double t = startEnd.project(pts[i]);
+            if((pts[i] - startEnd.pos(t)).squaredNorm() > tolSq)
+                break;
+            for(int j = (int)pts.size() - 1; j > farthest; --j) {
+                double t2 = startEnd.project(pts[j]);
+                if((pts[j] - startEnd.pos(t2)).squaredNorm() > tolSq)
+                    break;
+                double distSq = (pts[i] - pts[j]).squaredNorm();
+                if(distSq > minDistSq)
+                    continue;
+                minDistSq = distSq;
+                closest0 = i;
+                closest1 = j;
+            }
+        }
+        return minDistSq;
+    }
+};
+
+//Buckets points into a uniform grid with about one point per cell for nearest neighbor queries
+class PointGrid
+{
+public:
+    PointGrid(const VectorC<Vector2d> &pts, const vector<int> &indices)
+        : _pts(pts)
+    {
+        AlignedBox<double, 2> box;
+        for(int i = 0; i < (int)indices.size(); ++i)
+            box.extend(pts[indices[i]]);
+
+        _min = box.min();
+        Vector2d size = box.sizes();
+        _cellSize = max(1e-10, sqrt(size[0] * size[1] / double(indices.size())));
+        _cellSize = max(_cellSize, max(size[0], size[1]) / double(indices.size()));
+        _dims[0] = 1 + (int)(size[0] / _cellSize);
+        _dims[1] = 1 + (int)(size[1] / _cellSize);
+
+        //counting sort of the indices by cell
+        _cellStart.assign(_dims[0] * _dims[1] + 1, 0);
+        for(int i = 0; i < (int)indices.size(); ++i)
+            _cellStart[_cell(pts[indices[i]]) + 1]++;
+        for(int c = 0; c + 1 < (int)_cellStart.size(); ++c)
+            _cellStart[c + 1] += _cellStart[c];
+        _indices.resize(indices.size());
+        vector<int> fill(_cellStart.begin(), _cellStart.end() - 1);
+        for(int i = 0; i < (int)indices.size(); ++i)
+            _indices[fill[_cell(pts[indices[i]])]++] = indices[i];
+    }
+
+    //Finds the point closest to pt among those closer than sqrt(maxDistSq).  Ties go to the smaller index.
+    //Returns the squared distance and sets idx, or returns maxDistSq and leaves idx alone if there is no such point.
+    double closest(const Vector2d &pt, double maxDistSq, int &idx) const
+    {
+        int cx = _coord(pt[0], 0), cy = _coord(pt[1], 1);
+        double bestSq = maxDistSq;
+        int maxRing = max(max(cx, _dims[0] - 1 - cx), max(cy, _dims[1] - 1 - cy));
+        for(int ring = 0; ring <= maxRing; ++ring)
+        {
+            //points in this ring are at least (ring - 1) cells away
+            double ringDist = max(0, ring - 1) * _cellSize;
+            if(SQR(ringDist) > bestSq)
+                break;
+
+            for(int y = max(0, cy - ring); y <= min(_dims[1] - 1, cy + ring); ++y)
+            {
+                bool edgeRow = (y == cy - ring || y == cy + ring);
+                int xStep = edgeRow ? 1 : 2 * ring;
+                for(int x = cx - ring; x <= cx + ring; x += max(1, xStep))
+                {
+                    if(x < 0 || x >= _dims[0])
+                        continue;
+                    int c = y * _dims[0] + x;
+                    for(int k = _cellStart[c]; k < _cellStart[c + 1]; ++k)
+                    {
+                        double distSq = (_pts[_indices[k]] - pt).squaredNorm();
+                        if(distSq < bestSq || (distSq == bestSq && distSq < maxDistSq && _indices[k] < idx))
+                        {
+                            bestSq = distSq;
+                            idx = _indices[k];
+                        }
+                    }
+                }
+            }
+        }
+        return bestSq;
+    }
+
+private:
+    int _coord(double x, int axis) const { return max(0, min(_dims[axis] - 1, (int)floor((x - _min[axis]) / _cellSize))); }
+    int _cell(const Vector2d &pt) const { return _coord(pt[1], 1) * _dims[0] + _coord(pt[0], 0); }
+
+    const VectorC<Vector2d> &_pts;
+    Vector2d _min;
+    double _cellSize;
+    int _dims[2];
+    vector<int> _cellStart; //_indices[_cellStart[c]] through _indices[_cellStart[c + 1] - 1] are in cell c
+    vector<int> _indices;
+};
+
+//Finds the same pair as OldCurveCloser, but puts the end points in a grid instead of comparing every pair
+class DefaultCurveCloser : public CurveCloserBase
+{
+protected:
+    double _closestPair(const VectorC<Vector2d> &pts, const Line &startEnd, int farthest, double tolSq,
+                        int &closest0, int &closest1) const
+    {
+        vector<int> endIndices;
+        for(int j = (int)pts.size() - 1; j > farthest; --j) {
+            double t = startEnd.project(pts[j]);
+            if((pts[j] - startEnd.pos(t)).squaredNorm() > tolSq)
+                break;
+            endIndices.push_back(j);
+        }
+        if(endIndices.empty())
+            return tolSq;
+
+        PointGrid grid(pts, endIndices);
+
+        double minDistSq = tolSq;
+        for(int i = 0; i < farthest; ++i) {
+            double t = startEnd.project(pts[i]);
+            if((pts[i] - startEnd.pos(t)).squaredNorm() > tolSq)
+                break;
+            int j = -1;
+            double distSq = grid.closest(pts[i], tolSq, j);
+            if(j < 0 || distSq > minDistSq)
+                continue;
+            minDistSq = distSq;
+            closest0 = i;
+            closest1 = j;
+        }
+        return minDistSq;
     }
 };
 
+size_t AlgorithmOutput<CURVE_CLOSING>::memoryBytes() const
+{
+    return (output ? output->memoryBytes() : 0) + vectorBytes(parameters);
+}
+
 void Algorithm<CURVE_CLOSING>::_initialize()
 {
+    new DefaultCurveCloser();
     new OldCurveCloser();
 }
 
@@ -23,11 +23,68 @@
 
 #include "defs.h"
 #include "Algorithm.h"
+#include "VectorC.h"
+#include "PiecewiseLinearUtils.h"
+#include <Eigen/Core>
+#include <Eigen/StdVector>
 
 NAMESPACE_Cornu
 
 CORNU_SMART_FORW_DECL(Polyline)
 
+//Resamples points at the rate of radius, discarding those that are too close to the previous output point
+//and subdividing the segments between points that are too far.  The points marked for keeping (e.g., corners)
+//are output exactly.  Points are added in order.
+class RadiusResampler
+{
+public:
+    RadiusResampler(double radius);
+
+    void addPoint(const Eigen::Vector2d &pt, double param, bool keep); //param is pt's parameter on the input
+
+    const VectorC<Eigen::Vector2d> &output() const { return _outPts; }
+    const PiecewiseLinearMonotone &inputToOutput() const { return _inputToOutput; } //maps input to output parameters
+    void freeze() { _inputToOutput.freeze(); } //makes inputToOutput faster to evaluate, once all the points are added
+
+private:
+    double _radius;
+    VectorC<Eigen::Vector2d> _outPts;
+    PiecewiseLinearMonotone _inputToOutput;
+    double _lengthSoFar;
+    Eigen::Vector2d _prevPt;
+    double _prevParam;
+};
+
+//Preliminary resampling for points that arrive one at a time, for example, as the pen moves.  The points
+//to keep are found by an online version of Douglas-Peucker: as soon as a point since the last kept one is
+//farther than cutoff from the segment between that one and the newest point, the farthest one is kept (that's
+//where Douglas-Peucker would split) and the points before it are marked by Douglas-Peucker.  Points more than
+//maxPending behind the newest one are always decided, so the output lags the input by a bounded amount.
+//Decided points are passed on to a RadiusResampler.
+class StreamingPrelimResampler : public smart_base
+{
+public:
+    StreamingPrelimResampler(double cutoff, double radius, int maxPending = 64);
+
+    void addPoint(const Eigen::Vector2d &pt, double param); //param is pt's parameter on the input
+    void finish(); //decides the remaining points--the last one is kept
+
+    int numPoints() const { return _numPoints; } //the number of points added
+    const RadiusResampler &resampler() const { return _resampler; } //has the output so far
+    RadiusResampler &finishedResampler() { return _resampler; } //after finish, for freezing
+
+private:
+    void _decide(int last); //passes on the points up to last, which becomes the last one kept
+
+    double _cutoff;
+    int _maxPending;
+    int _numPoints;
+    std::vector<Eigen::Vector2d, Eigen::aligned_allocator<Eigen::Vector2d> > _pending; //_pending[0] is the last kept point
+    std::vector<double> _pendingParams;
+    RadiusResampler _resampler;
+};
+CORNU_SMART_TYPEDEFS(StreamingPrelimResampler);
+
 template<>
 struct AlgorithmOutput<SCALE_DETECTION> : public AlgorithmOutputBase
 {
@@ -39,13 +96,20 @@ struct AlgorithmOutput<SCALE_DETECTION> : public AlgorithmOutputBase
 template<>
 struct AlgorithmOutput<PRELIM_RESAMPLING> : public AlgorithmOutputBase
 {
+    //override
+    size_t memoryBytes() const;
+
     PolylineConstPtr output;
     std::vector<double> parameters; //parameters[i] is the parameter in output of the original point with index i
+    StreamingPrelimResamplerConstPtr streaming; //for the streaming algorithm, its state before finishing, to continue when points are appended
 };
 
 template<>
 struct AlgorithmOutput<CURVE_CLOSING> : public AlgorithmOutputBase
 {
+    //override
+    size_t memoryBytes() const;
+
     PolylineConstPtr output;
     bool closed;
     std::vector<double> parameters; //parameters[i] is the parameter in output of the original point with index i
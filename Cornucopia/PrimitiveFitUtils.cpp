@@ -80,17 +80,14 @@ void ArcFitter::addPointW(const Vector2d &pt, double weight)
     _squaredSum += weight * pt3 * pt3.transpose();
 }
 
-ArcPtr ArcFitter::getCurve() const
+//Fits a circle to points given their sums of (x, y, x^2 + y^2) and of its outer products
+static void fitCircle(double totWeight, const Vector3d &sum, const Matrix3d &squaredSum, Vector2d &outCenter, double &outRadius)
 {
-    if((int)_pts.size() < 2)
-        return ArcPtr();
-
-    double factor = 1. / _totWeight;
-    Vector3d pt = _sum * factor;
-    Matrix3d cov = factor * _squaredSum - pt * pt.transpose();
+    double factor = 1. / totWeight;
+    Vector3d pt = sum * factor;
+    Matrix3d cov = factor * squaredSum - pt * pt.transpose();
 
     SelfAdjointEigenSolver<Matrix3d> eigenSolver(cov);
-    Vector3d eigVs = eigenSolver.eigenvalues();
 
     Vector3d dir = eigenSolver.eigenvectors().col(0); //0 is the index of the smallest eigenvalue
     dir /= (1e-16 + dir[2]);
@@ -98,8 +95,18 @@ ArcPtr ArcFitter::getCurve() const
     double dot = dir.dot(pt);
     //circle equation is:
     //dir[0] * x + dir[1] * y + (x^2+y^2) = dot
-    Vector2d center = -0.5 * Vector2d(dir[0], dir[1]);
-    double radius = sqrt(1e-16 + dot + center.squaredNorm());
+    outCenter = -0.5 * Vector2d(dir[0], dir[1]);
+    outRadius = sqrt(1e-16 + dot + outCenter.squaredNorm());
+}
+
+ArcPtr ArcFitter::getCurve() const
+{
+    if((int)_pts.size() < 2)
+        return ArcPtr();
+
+    Vector2d center;
+    double radius;
+    fitCircle(_totWeight, _sum, _squaredSum, center, radius);
     center += _pts[0];
 
     //TODO: convert code to use AngleUtils
@@ -131,14 +138,84 @@ ArcPtr ArcFitter::getCurve() const
     }
 }
 
-void ClothoidFitter::addPoint(const Vector2d &pt)
+void SlidingArcFitter::pushBack(const Vector2d &pt)
 {
     _pts.push_back(pt);
+    if(_pts.size() == 1 || (pt - _origin).squaredNorm() > _recenterDistance * _recenterDistance)
+    {
+        //move the origin to the new point and recompute the sums, so they don't lose precision
+        _origin = pt;
+        for(int a = 0; a <= 4; ++a)
+            for(int b = 0; a + b <= 4; ++b)
+                _moments[a][b] = 0.;
+        for(int i = 0; i < (int)_pts.size(); ++i)
+            _addMoments(_pts[i], 1.);
+        return;
+    }
+    _addMoments(pt, 1.);
+}
 
+void SlidingArcFitter::popFront()
+{
+    _addMoments(_pts.front(), -1.);
+    _pts.pop_front();
+}
+
+double SlidingArcFitter::curvatureMagnitude(const Vector2d &center) const
+{
     if((int)_pts.size() < 2)
+        return 0.;
+
+    //translate the moments so that center is the origin: sum (x + d)^a (y + d)^b
+    static const double binomial[5][5] = { { 1 }, { 1, 1 }, { 1, 2, 1 }, { 1, 3, 3, 1 }, { 1, 4, 6, 4, 1 } };
+    Vector2d d = _origin - center;
+    double dPow[2][5] = { { 1., d[0], d[0] * d[0], d[0] * d[0] * d[0], d[0] * d[0] * d[0] * d[0] },
+                          { 1., d[1], d[1] * d[1], d[1] * d[1] * d[1], d[1] * d[1] * d[1] * d[1] } };
+    double m[5][5];
+    for(int a = 0; a <= 4; ++a)
+        for(int b = 0; a + b <= 4; ++b)
+        {
+            m[a][b] = 0.;
+            for(int i = 0; i <= a; ++i)
+                for(int j = 0; j <= b; ++j)
+                    m[a][b] += binomial[a][i] * binomial[b][j] * dPow[0][a - i] * dPow[1][b - j] * _moments[i][j];
+        }
+
+    //these are what ArcFitter would have accumulated
+    Vector3d sum(m[1][0], m[0][1], m[2][0] + m[0][2]);
+    Matrix3d squaredSum;
+    squaredSum << m[2][0], m[1][1], m[3][0] + m[1][2],
+                  m[1][1], m[0][2], m[2][1] + m[0][3],
+                  m[3][0] + m[1][2], m[2][1] + m[0][3], m[4][0] + 2. * m[2][2] + m[0][4];
+
+    Vector2d circleCenter;
+    double radius;
+    fitCircle(m[0][0], sum, squaredSum, circleCenter, radius);
+    return 1. / radius;
+}
+
+void SlidingArcFitter::_addMoments(const Vector2d &pt, double weight)
+{
+    Vector2d rel = pt - _origin;
+    double xPow[5] = { weight, weight * rel[0], 0, 0, 0 };
+    for(int a = 2; a <= 4; ++a)
+        xPow[a] = xPow[a - 1] * rel[0];
+
+    for(int a = 0; a <= 4; ++a)
+    {
+        double cur = xPow[a];
+        for(int b = 0; a + b <= 4; ++b, cur *= rel[1])
+            _moments[a][b] += cur;
+    }
+}
+
+void ClothoidFitter::addPoint(const Vector2d &pt)
+{
+    Vector2d prevPt = _prevPt;
+    _prevPt = pt;
+    if(++_numPts < 2)
         return;
 
-    const Vector2d &prevPt = _pts[_pts.size() - 2];
     double segmentLength = (pt - prevPt).norm();
     _centerOfMass += (pt + prevPt) * (0.5 * segmentLength);
 
@@ -161,30 +238,21 @@ void ClothoidFitter::addPoint(const Vector2d &pt)
 
 ClothoidPtr ClothoidFitter::getCurve() const
 {
-    Matrix4d lhs;
-
-    lhs = _getLhs(_totalLength);
-
-    Vector4d abcd = lhs.inverse() * _rhs;
-    return getClothoidWithParams(abcd);
+    return getClothoidWithParams(_solve(_rhs));
 }
 
 ClothoidPtr ClothoidFitter::getCurveWithZeroCurvature(double param) const
 {
-    Matrix<double, 5, 5> lhs;
-    Matrix<double, 5, 1> rhs;
-
     Vector4d constraint;
     constraint << 6 * param, 2, 0, 0; // second derivative of ax^3+bx^2+cx+d is 6ax+2b
 
-    //For constrained least squares,
-    //lhs is now [A^T A    C]
-    //           [ C^T     0]
-    lhs << _getLhs(_totalLength),   constraint,
-           constraint.transpose(),  0;
-    rhs << _rhs, 0;
-
-    Vector4d abcd = (lhs.inverse() * rhs).head<4>();
+    //For constrained least squares, the solution of
+    //[A^T A    C] [abcd]   [rhs]
+    //[ C^T     0] [ l  ] = [ 0 ]
+    //is the unconstrained solution minus the multiple of (A^T A)^-1 C that satisfies the constraint
+    Vector4d unconstrained = _solve(_rhs);
+    Vector4d correction = _solve(constraint);
+    Vector4d abcd = unconstrained - correction * (constraint.dot(unconstrained) / constraint.dot(correction));
     return getClothoidWithParams(abcd);
 }
 
@@ -273,6 +341,18 @@ Matrix4d ClothoidFitter::_getLhs(double x)
     return out;
 }
 
+//_getLhs(x) = x * D * _getLhs(1) * D, where D = diag(x^3, x^2, x, 1), so it is solved with the inverse of the
+//constant (and much better conditioned) _getLhs(1), without factoring a matrix for every curve.
+Vector4d ClothoidFitter::_solve(const Vector4d &rhs) const
+{
+    //solve rather than invert: the vectorized 4x4 inverse in newer Eigen versions is wrong under -ffast-math
+    static const Matrix4d unitInverse = _getLhs(1.).partialPivLu().solve(Matrix4d::Identity());
+
+    double x = _totalLength;
+    Vector4d invD(1. / (x * x * x), 1. / (x * x), 1. / x, 1.);
+    return invD.cwiseProduct(unitInverse * invD.cwiseProduct(rhs)) / x;
+}
+
 Vector4d ClothoidFitter::_getRhs(double x, double y, double z)
 {
     double xp[6] = {1, x, 0, 0, 0, 0 }; //powers of totalLength
@@ -24,8 +24,10 @@
 #include "defs.h"
 #include "smart_ptr.h"
 #include <vector>
+#include <deque>
 #include <Eigen/Core>
 #include <Eigen/StdVector>
+#include <Eigen/StdDeque>
 #include "Line.h"
 #include "Arc.h"
 #include "Clothoid.h"
@@ -67,6 +69,9 @@ private:
     double _crossSum;
 };
 
+//The sums are relative to the first point.  They aren't looked up in prefix sums over the whole curve, which
+//wouldn't be faster for the candidates (each start extends its fit a point at a time) and would lose the
+//precision of short arcs: the fourth moments of the curve around one origin are much larger than theirs.
 class ArcFitter : public FitterBase
 {
 public:
@@ -85,14 +90,42 @@ private:
     double _totWeight;
 };
 
+//Fits the same circle as ArcFitter, but points can also be removed, so the fit can follow a window
+//sliding along a curve.  It keeps the moments of the points up to fourth order, which determine ArcFitter's
+//sums around any center.  Only the curvature magnitude is available.
+class SlidingArcFitter
+{
+public:
+    //The moments are taken around a recent point, which is moved whenever a point farther than
+    //recenterDistance from it is added
+    SlidingArcFitter(double recenterDistance) : _recenterDistance(recenterDistance), _origin(Eigen::Vector2d::Zero()) {}
+
+    void pushBack(const Eigen::Vector2d &pt);
+    void popFront();
+    int size() const { return (int)_pts.size(); }
+
+    //The magnitude of the curvature ArcFitter would fit to the current points using center as the origin
+    //(ArcFitter uses its first point)
+    double curvatureMagnitude(const Eigen::Vector2d &center) const;
+
+private:
+    void _addMoments(const Eigen::Vector2d &pt, double weight);
+
+    double _recenterDistance;
+    Eigen::Vector2d _origin;
+    std::deque<Eigen::Vector2d, Eigen::aligned_allocator<Eigen::Vector2d> > _pts;
+    double _moments[5][5]; //_moments[a][b] is the sum of x^a y^b relative to _origin, for a + b <= 4
+};
+
 //This fits a clothoid by fitting a cubic polynomial to the integral of the angle function,
 //using its derivative as the angle function of the clothoid,
-//and making the clothoid center of mass align with that of the input
+//and making the clothoid center of mass align with that of the input.
+//It only keeps sums over the points, so adding a point and getting the curve don't allocate.
 class ClothoidFitter : public FitterBase
 {
 public:
-    ClothoidFitter() : _totalLength(0), _prevAngle(0), _angleIntegral(0),
-                       _centerOfMass(_centerOfMass.Zero()), _rhs(_rhs.Zero()) {}
+    ClothoidFitter() : _centerOfMass(_centerOfMass.Zero()), _rhs(_rhs.Zero()), _prevPt(_prevPt.Zero()),
+                       _numPts(0), _prevAngle(0), _angleIntegral(0), _totalLength(0) {}
 
     ClothoidPtr getCurve() const;
     ClothoidPtr getCurveWithZeroCurvature(double param) const;
@@ -108,10 +141,12 @@ private:
 
     static Eigen::Matrix4d _getLhs(double x);
     static Eigen::Vector4d _getRhs(double x, double y, double z);
+    Eigen::Vector4d _solve(const Eigen::Vector4d &rhs) const; //solves _getLhs(_totalLength) * x = rhs
 
     Eigen::Vector2d _centerOfMass;
     Eigen::Vector4d _rhs;
-    std::vector<Eigen::Vector2d, Eigen::aligned_allocator<Eigen::Vector2d> > _pts;
+    Eigen::Vector2d _prevPt;
+    int _numPts;
     double _prevAngle;
     double _angleIntegral;
 
@@ -26,6 +26,11 @@
 #include "ErrorComputer.h"
 #include "Solver.h"
 #include "Oversketcher.h"
+#include "Preprocessing.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
 
 using namespace std;
 using namespace Eigen;
@@ -46,7 +51,11 @@ public:
 
     LSEvalData *createEvalData()
     {
-        return new LSDenseEvalData();
+        return LSWorkspace::current().take<LSDenseEvalData>();
+    }
+    void releaseEvalData(LSEvalData *data)
+    {
+        LSWorkspace::current().give(data);
     }
     void eval(const VectorXd &x, LSEvalData *data)
     {
@@ -54,7 +63,7 @@ public:
         setParams(x);
         MatrixXd &errDer = curveData->errDerRef();
         _errorComputer->computeErrorVector(_primitive.curve, _primitive.startIdx, _primitive.endIdx,
-                                           curveData->errVectorRef(), &errDer);
+                                           curveData->errVectorRef(), &errDer, true, true, false, &_footPoints);
 
         _primitive.curve->toEndCurvatureDerivative(errDer);
     }
@@ -76,7 +85,7 @@ public:
             return;
         }
 
-        VectorXd xm = x;
+        CurvePrimitive::ParamVec xm = x;
         xm(CurvePrimitive::DCURVATURE) = (xm(CurvePrimitive::DCURVATURE) - xm(CurvePrimitive::CURVATURE)) / xm(CurvePrimitive::LENGTH);
         _primitive.curve->setParams(xm);
     }
@@ -84,6 +93,7 @@ public:
 private:
     FitPrimitive _primitive;
     ErrorComputerConstPtr _errorComputer;
+    vector<double> _footPoints; //the samples' projections from the last evaluation
 };
 
 class DefaultPrimitiveFitter : public Algorithm<PRIMITIVE_FITTING>
@@ -96,6 +106,40 @@ public:
 private:
     bool _adjust;
 
+    //starting points are split among threads only if there are at least this many per thread
+    static const int pointsPerThread = 16;
+
+    class _StartPointBody
+    {
+    public:
+        _StartPointBody(const DefaultPrimitiveFitter &primitiveFitter, const Fitter &fitter, const vector<int> &starts,
+                        vector<vector<FitPrimitive> > &out, vector<int> &outLastPointUsed, atomic<bool> &outSkippedAdjusting)
+            : _primitiveFitter(primitiveFitter), _fitter(fitter), _starts(starts), _out(out), _outLastPointUsed(outLastPointUsed),
+              _outSkippedAdjusting(outSkippedAdjusting) {}
+
+        void operator()(int i) const
+        {
+            int start = _starts[i];
+            if(_fitter.cancelled())
+                return; //the output is discarded
+            //past the time budget, the candidates are left as fitted
+            bool adjust = _primitiveFitter._adjust && !_fitter.pastDeadline();
+            if(_primitiveFitter._adjust && !adjust)
+                _outSkippedAdjusting = true;
+            _primitiveFitter._fitFromStart(_fitter, start, adjust, _out[start], _outLastPointUsed[start]);
+            if(_fitter.config().get(Parameters::DOMINANCE_PRUNING) > 0.5)
+                _pruneDominated(_fitter, _out[start]);
+        }
+
+    private:
+        const DefaultPrimitiveFitter &_primitiveFitter;
+        const Fitter &_fitter;
+        const vector<int> &_starts;
+        vector<vector<FitPrimitive> > &_out;
+        vector<int> &_outLastPointUsed;
+        atomic<bool> &_outSkippedAdjusting;
+    };
+
 protected:
 
     void _run(const Fitter &fitter, AlgorithmOutput<PRIMITIVE_FITTING> &out)
@@ -108,8 +152,6 @@ protected:
         const VectorC<Vector2d> &pts = poly->pts();
 
         const double errorThreshold = fitter.scaledParameter(Parameters::ERROR_THRESHOLD);
-        std::string typeNames[3] = { "Lines", "Arcs", "Clothoids" };
-        bool inflectionAccounting = fitter.params().get(Parameters::INFLECTION_COST) > 0.;
 
         if(osOutput->startCurve)
         {
@@ -134,7 +176,7 @@ protected:
                 fit.curve->trim(0, fit.curve->project(pts[i]));
 
                 fit.endCurvSign = (fit.curve->endCurvature() >= 0) ? 1 : -1;
-                fit.error = errorComputer->computeErrorForCost(fit.curve, 0, fit.endIdx, false);
+                fit.error = errorComputer->computeErrorForCost(fit.curve, 0, fit.endIdx, errorThreshold * errorThreshold, false);
 
                 fit.numPts++;
 
@@ -173,7 +215,7 @@ protected:
                 fit.curve->trim(fit.curve->project(pts[i]), fit.curve->length());
 
                 fit.startCurvSign = (fit.curve->startCurvature() >= 0) ? 1 : -1;
-                fit.error = errorComputer->computeErrorForCost(fit.curve, fit.startIdx, (int)pts.size() - 1, true, false);
+                fit.error = errorComputer->computeErrorForCost(fit.curve, fit.startIdx, (int)pts.size() - 1, errorThreshold * errorThreshold, true, false);
 
                 fit.numPts++;
 
@@ -189,108 +231,427 @@ protected:
             }
         }
 
-        for(int i = 0; i < pts.size(); ++i) //iterate over start points
+        //if points were appended since the last run, candidates that only looked at points that haven't
+        //changed are copied from it
+        vector<vector<FitPrimitive> > fromStart(pts.size());
+        out.lastPointUsed.resize(pts.size());
+        vector<int> starts;
+        smart_ptr<const AlgorithmOutput<PRIMITIVE_FITTING> > previous = fitter.previousOutput<PRIMITIVE_FITTING>();
+        int stablePts = _numStablePoints(fitter);
+        for(int i = 0; i < (int)pts.size(); ++i)
+        {
+            //the error weight of a point depends on the next point, so the last stable point isn't usable
+            if(i < stablePts && previous->lastPointUsed[i] < stablePts - 1)
+            {
+                fromStart[i].assign(previous->primitives.begin() + previous->startOffsets[i], previous->primitives.begin() + previous->startOffsets[i + 1]);
+                out.lastPointUsed[i] = previous->lastPointUsed[i];
+            }
+            else
+                starts.push_back(i);
+        }
+
+        //candidates starting at different points are independent, so they are fitted in parallel
+        //and concatenated in order, which gives the same output as fitting them one after another
+        int numThreads = min(numHardwareThreads(), ((int)starts.size() + pointsPerThread - 1) / pointsPerThread);
+        atomic<bool> skippedAdjusting(false);
+        parallelFor((int)starts.size(), _StartPointBody(*this, fitter, starts, fromStart, out.lastPointUsed, skippedAdjusting), numThreads);
+        out.degraded = skippedAdjusting;
+
+        out.startOffsets.resize(pts.size() + 1);
+        for(int i = 0; i < (int)fromStart.size(); ++i)
         {
-            FitterBasePtr fitters[3];
-            fitters[0] = new LineFitter();
-            fitters[1] = new ArcFitter();
-            fitters[2] = new ClothoidFitter();
+            out.startOffsets[i] = (int)out.primitives.size();
+            out.primitives.insert(out.primitives.end(), fromStart[i].begin(), fromStart[i].end());
+        }
+        out.startOffsets.back() = (int)out.primitives.size();
+
+        out.values.reserve(out.primitives.size());
+        for(int i = 0; i < (int)out.primitives.size(); ++i)
+            out.values.push_back(PrimitiveValue::make(*out.primitives[i].curve));
+    }
+
+    //Returns how many resampled points at the start of the curve are the same as in the previous run
+    //(before points were appended), with everything else the fit depends on also unchanged
+    int _numStablePoints(const Fitter &fitter) const
+    {
+        smart_ptr<const AlgorithmOutput<PRIMITIVE_FITTING> > previous = fitter.previousOutput<PRIMITIVE_FITTING>();
+        smart_ptr<const AlgorithmOutput<RESAMPLING> > prevResampling = fitter.previousOutput<RESAMPLING>();
+        if(!previous || !prevResampling || previous->lastPointUsed.empty() || previous->degraded)
+            return 0;
+        if(fitter.previousOutput<SCALE_DETECTION>()->scale != fitter.output<SCALE_DETECTION>()->scale)
+            return 0; //the error threshold is scaled
+        if(fitter.previousOutput<CURVE_CLOSING>()->closed || fitter.output<CURVE_CLOSING>()->closed)
+            return 0;
+
+        const VectorC<Vector2d> &pts = fitter.output<RESAMPLING>()->output->pts();
+        const VectorC<Vector2d> &prevPts = prevResampling->output->pts();
+        const VectorC<bool> &corners = fitter.output<RESAMPLING>()->corners;
+        const VectorC<bool> &prevCorners = prevResampling->corners;
+
+        int out = 0;
+        while(out < pts.size() && out < prevPts.size() && pts[out] == prevPts[out] && corners[out] == prevCorners[out])
+            ++out;
+        return out;
+    }
+
+    //what fitting the candidates from one start point needs, looked up once
+    struct _StartContext
+    {
+        _StartContext(const Fitter &inFitter, bool inAdjust) : fitter(inFitter), adjust(inAdjust),
+            poly(inFitter.output<RESAMPLING>()->output), errorComputer(inFitter.output<ERROR_COMPUTER>()->errorComputer),
+            errorThreshold(inFitter.scaledParameter(Parameters::ERROR_THRESHOLD)),
+            inflectionAccounting(inFitter.config().get(Parameters::INFLECTION_COST) > 0.) {}
+
+        const Fitter &fitter;
+        bool adjust;
+        PolylineConstPtr poly;
+        ErrorComputerConstPtr errorComputer;
+        double errorThreshold;
+        bool inflectionAccounting;
+    };
+
+    //fits all the candidates that start at point i and returns the last point any of them looked at
+    void _fitFromStart(const Fitter &fitter, int i, bool adjust, vector<FitPrimitive> &out, int &outLastPointUsed) const
+    {
+        outLastPointUsed = i;
 
-            for(int type = 0; type <= 2; ++type) //iterate over lines, arcs, clothoids
+        const VectorC<bool> &corners = fitter.output<RESAMPLING>()->corners;
+        _StartContext context(fitter, adjust);
+        const VectorC<Vector2d> &pts = context.poly->pts();
+        int lengthsPerDoubling = (int)fitter.config().get(Parameters::CANDIDATE_LENGTHS_PER_DOUBLING);
+        int batchSize = adjust ? 1 : context.errorComputer->preferredBatchSize(); //adjusting changes the candidates after they're fitted
+
+        //the fitters only keep running sums, so they live on the stack (the arc fitter also keeps its points)
+        LineFitter lineFitter;
+        ArcFitter arcFitter;
+        ClothoidFitter clothoidFitter;
+        FitterBase *fitters[3] = { &lineFitter, &arcFitter, &clothoidFitter };
+
+        //the points the candidates can cover: up to the first corner after the start
+        static thread_local vector<int> span;
+        if(lengthsPerDoubling > 0)
+        {
+            span.clear();
+            for(VectorC<Vector2d>::Circulator circ = pts.circulator(i); !circ.done(); ++circ)
             {
-                int fitSoFar = 0;
+                span.push_back(circ.index());
+                if(span.size() > 1 && corners[circ.index()])
+                    break;
+            }
+        }
 
-                bool needType = fitter.params().get(Parameters::ParameterType(Parameters::LINE_COST + type)) < Parameters::infinity;
+        for(int type = 0; type <= 2; ++type) //iterate over lines, arcs, clothoids
+        {
+            int fitSoFar = 0;
 
-                for(VectorC<Vector2d>::Circulator circ = pts.circulator(i); !circ.done(); ++circ)
-                {
-                    ++fitSoFar;
+            bool needType = fitter.config().get(Parameters::ParameterType(Parameters::LINE_COST + type)) < Parameters::infinity;
 
-                    if(!needType && (type == 2 || fitSoFar >= 3 + type)) //if we don't need primitives of this type
-                        break;
+            if(lengthsPerDoubling > 0)
+            {
+                if(!needType && type == 2)
+                    continue;
+                int maxPts = needType ? (int)span.size() : min((int)span.size(), 2 + type); //just the shortest one for a type we don't need
+                if(type == 0)
+                    _fitGeometric(context, lineFitter, type, span, maxPts, lengthsPerDoubling, out, outLastPointUsed);
+                else if(type == 1)
+                    _fitGeometric(context, arcFitter, type, span, maxPts, lengthsPerDoubling, out, outLastPointUsed);
+                else
+                    _fitGeometric(context, clothoidFitter, type, span, maxPts, lengthsPerDoubling, out, outLastPointUsed);
+                continue;
+            }
+
+            if(needType && batchSize > 1)
+            {
+                _fitBatched(context, *fitters[type], type, i, batchSize, out, outLastPointUsed);
+                continue;
+            }
+
+            for(VectorC<Vector2d>::Circulator circ = pts.circulator(i); !circ.done(); ++circ)
+            {
+                ++fitSoFar;
 
-                    fitters[type]->addPoint(*circ);
-                    if(fitSoFar >= 2 + type) //at least two points per line, etc.
-                    {
-                        CurvePrimitivePtr curve = fitters[type]->getPrimitive();
-                        Vector3d color(0, 0, 0);
-                        color[type] = 1;
-
-                        FitPrimitive fit;
-                        fit.curve = curve;
-                        fit.startIdx = i;
-                        fit.endIdx = circ.index();
-                        fit.numPts = fitSoFar;
-                        fit.startCurvSign = (curve->startCurvature() >= 0) ? 1 : -1;
-                        fit.endCurvSign = (curve->endCurvature() >= 0) ? 1 : -1;
-
-                        if(_adjust)
-                            adjustPrimitive(fit, fitter);
-
-                        fit.error = errorComputer->computeErrorForCost(curve, i, fit.endIdx);
-
-                        double length = poly->lengthFromTo(i, fit.endIdx);
-                        if(fit.error > errorThreshold * errorThreshold)
-                            break;
-
-                        //Debugging::get()->drawCurve(curve, color, typeNames[type]);
-                        out.primitives.push_back(fit);
-
-                        if(type == 0 && inflectionAccounting) //line with "opposite" curvature
-                        {
-                            fit.startCurvSign = -fit.startCurvSign;
-                            fit.endCurvSign = -fit.endCurvSign;
-                            out.primitives.push_back(fit);
-                        }
-
-                        //if different start and end curvatures
-                        if(fit.startCurvSign != fit.endCurvSign && inflectionAccounting)
-                        {
-                            double start = poly->idxToParam(i);
-                            double end = poly->idxToParam(fit.endIdx);
-                            CurvePrimitivePtr startNoCurv = static_pointer_cast<ClothoidFitter>(fitters[2])->getCurveWithZeroCurvature(0);
-                            CurvePrimitivePtr endNoCurv = static_pointer_cast<ClothoidFitter>(fitters[2])->getCurveWithZeroCurvature(end - start);
-
-                            fit.curve = startNoCurv;
-                            fit.startCurvSign = fit.endCurvSign = (startNoCurv->endCurvature() > 0. ? 1 : -1);
-
-                            if(_adjust)
-                                adjustPrimitive(fit, fitter);
-
-                            fit.error = errorComputer->computeErrorForCost(fit.curve, i, fit.endIdx);
-
-                            if(fit.error < errorThreshold * errorThreshold)
-                            {
-                                out.primitives.push_back(fit);
-                                //Debugging::get()->drawCurve(fit.curve, color, typeNames[type]);
-                            }
-
-                            fit.curve = endNoCurv;
-                            fit.startCurvSign = fit.endCurvSign = (endNoCurv->startCurvature() > 0. ? 1 : -1);
-
-                            if(_adjust)
-                                adjustPrimitive(fit, fitter);
-
-                            fit.error = errorComputer->computeErrorForCost(fit.curve, i, fit.endIdx);
-
-                            if(fit.error < errorThreshold * errorThreshold)
-                            {
-                                out.primitives.push_back(fit);
-                                //Debugging::get()->drawCurve(fit.curve, color, typeNames[type]);
-                            }
-                        }
-                    }
-                    if(fitSoFar > 1 && corners[circ.index()])
+                if(!needType && (type == 2 || fitSoFar >= 3 + type)) //if we don't need primitives of this type
+                    break;
+
+                fitters[type]->addPoint(*circ);
+                outLastPointUsed = max(outLastPointUsed, circ.index());
+                if(fitSoFar >= 2 + type) //at least two points per line, etc.
+                {
+                    if(!_addCandidate(context, fitters[type]->getPrimitive(), type, i, circ.index(), fitSoFar,
+                                      type == 2 ? &clothoidFitter : NULL, out))
                         break;
                 }
+                if(fitSoFar > 1 && corners[circ.index()])
+                    break;
+            }
+        }
+    }
+
+    //For Parameters::CANDIDATE_LENGTHS_PER_DOUBLING: grows the candidates of one type over the first maxPts
+    //points of span (the indices of the points from the start) geometrically, then bisects back to the longest one within the error threshold.  The error
+    //grows about monotonically with the length, so this finds about the same longest candidate as growing a
+    //point at a time.  The fitter starts empty and is copied to back up.
+    template<typename FitterType>
+    void _fitGeometric(const _StartContext &context, FitterType &fitter, int type, const vector<int> &span, int maxPts,
+                       int lengthsPerDoubling, vector<FitPrimitive> &out, int &outLastPointUsed) const
+    {
+        const VectorC<Vector2d> &pts = context.poly->pts();
+        int minPts = 2 + type; //at least two points per line, etc.
+        if(maxPts < minPts)
+            return;
+
+        FitterType good = fitter; //fitted to goodPts points, which gave a candidate within the threshold
+        int goodPts = 0, badPts = -1, fitPts = 0;
+        double growth = pow(2., 1. / lengthsPerDoubling);
+        for(int numPts = minPts; ; numPts = min(maxPts, max(numPts + 1, (int)ceil(numPts * growth))))
+        {
+            for(; fitPts < numPts; ++fitPts)
+            {
+                fitter.addPoint(pts[span[fitPts]]);
+                outLastPointUsed = max(outLastPointUsed, span[fitPts]);
+            }
+            if(!_addCandidate(context, fitter.getPrimitive(), type, span[0], span[numPts - 1], numPts, _asClothoidFitter(fitter), out))
+            {
+                badPts = numPts;
+                break;
+            }
+            good = fitter;
+            goodPts = numPts;
+            if(numPts == maxPts)
+                break;
+        }
+        if(badPts < 0 || goodPts == 0)
+            return; //reached the end of the span, or even the shortest candidate is too far
+
+        //only the longest of the lengths tried while bisecting is kept
+        vector<FitPrimitive> longest, trial;
+        while(badPts - goodPts > 1)
+        {
+            int numPts = (goodPts + badPts) / 2;
+            fitter = good;
+            for(int k = goodPts; k < numPts; ++k)
+                fitter.addPoint(pts[span[k]]);
+
+            trial.clear();
+            if(_addCandidate(context, fitter.getPrimitive(), type, span[0], span[numPts - 1], numPts, _asClothoidFitter(fitter), trial))
+            {
+                longest.swap(trial);
+                good = fitter;
+                goodPts = numPts;
+            }
+            else
+                badPts = numPts;
+        }
+        out.insert(out.end(), longest.begin(), longest.end());
+    }
+
+    //a candidate fitted ahead by _fitBatched, with the clothoid fitter at its length for the inflection variants
+    struct _PendingCandidate
+    {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        CurvePrimitivePtr curve;
+        int endIdx;
+        int numPts;
+        ClothoidFitter clothoidFitter;
+    };
+
+    //For an error computer that prefers batches: grows the candidates of one type from point i a point at a time
+    //like _fitFromStart, but fits batchSize of them ahead and computes their errors in one call.  They're then
+    //taken in order up to the first one over the threshold, which ends the growing.
+    void _fitBatched(const _StartContext &context, FitterBase &fitter, int type, int i, int batchSize,
+                     vector<FitPrimitive> &out, int &outLastPointUsed) const
+    {
+        const VectorC<Vector2d> &pts = context.poly->pts();
+        const VectorC<bool> &corners = context.fitter.output<RESAMPLING>()->corners;
+        const double cutoff = context.errorThreshold * context.errorThreshold;
+        static thread_local vector<_PendingCandidate, aligned_allocator<_PendingCandidate> > pending;
+        static thread_local vector<ErrorComputer::ErrorQuery> queries;
+        static thread_local vector<double> errors;
+
+        int fitSoFar = 0;
+        bool done = false;
+        VectorC<Vector2d>::Circulator circ = pts.circulator(i);
+        while(!done)
+        {
+            pending.clear();
+            queries.clear();
+            for(; (int)pending.size() < batchSize && !done; ++circ)
+            {
+                done = circ.done();
+                if(done)
+                    break;
+                ++fitSoFar;
+                fitter.addPoint(*circ);
+                outLastPointUsed = max(outLastPointUsed, circ.index());
+                if(fitSoFar >= 2 + type) //at least two points per line, etc.
+                {
+                    _PendingCandidate candidate;
+                    candidate.curve = fitter.getPrimitive();
+                    candidate.endIdx = circ.index();
+                    candidate.numPts = fitSoFar;
+                    if(type == 2)
+                        candidate.clothoidFitter = static_cast<const ClothoidFitter &>(fitter);
+                    pending.push_back(candidate);
+
+                    ErrorComputer::ErrorQuery query;
+                    query.curve = candidate.curve;
+                    query.from = i;
+                    query.to = candidate.endIdx;
+                    queries.push_back(query);
+                }
+                done = fitSoFar > 1 && corners[circ.index()];
+            }
+
+            errors.resize(queries.size());
+            if(!queries.empty())
+                context.errorComputer->computeErrorsForCost(queries.data(), (int)queries.size(), cutoff, errors.data());
+            for(int j = 0; j < (int)pending.size(); ++j)
+            {
+                const _PendingCandidate &candidate = pending[j];
+                if(!_addCandidate(context, candidate.curve, type, i, candidate.endIdx, candidate.numPts,
+                                  type == 2 ? &candidate.clothoidFitter : NULL, out, errors[j]))
+                {
+                    done = true;
+                    break;
+                }
             }
         }
     }
 
-    void adjustPrimitive(const FitPrimitive &primitive, const Fitter &fitter)
+    static const ClothoidFitter *_asClothoidFitter(const ClothoidFitter &fitter) { return &fitter; }
+    static const ClothoidFitter *_asClothoidFitter(const FitterBase &) { return NULL; }
+
+    //Adds the candidate fit to the points from startIdx to endIdx, and the variants inflection accounting needs,
+    //to out.  Returns false, adding nothing, if its error is over the threshold.  The variants with zero
+    //curvature at one end come from clothoidFitter, if it's given.  The error of the candidate can be passed in if
+    //it's already known (and the candidate isn't adjusted).
+    bool _addCandidate(const _StartContext &context, CurvePrimitivePtr curve, int type, int startIdx, int endIdx, int numPts,
+                       const ClothoidFitter *clothoidFitter, vector<FitPrimitive> &out, double knownError = -1.) const
+    {
+        const double errorThreshold = context.errorThreshold;
+        std::string typeNames[3] = { "Lines", "Arcs", "Clothoids" };
+        Vector3d color(0, 0, 0);
+        color[type] = 1;
+
+        FitPrimitive fit;
+        fit.curve = curve;
+        fit.startIdx = startIdx;
+        fit.endIdx = endIdx;
+        fit.numPts = numPts;
+        fit.startCurvSign = (curve->startCurvature() >= 0) ? 1 : -1;
+        fit.endCurvSign = (curve->endCurvature() >= 0) ? 1 : -1;
+
+        if(context.adjust)
+            adjustPrimitive(fit, context.fitter);
+
+        if(knownError >= 0.)
+            fit.error = knownError;
+        else
+            fit.error = context.errorComputer->computeErrorForCost(curve, startIdx, fit.endIdx, errorThreshold * errorThreshold);
+
+        if(fit.error > errorThreshold * errorThreshold)
+            return false;
+
+        //Debugging::get()->drawCurve(curve, color, typeNames[type]);
+        out.push_back(fit);
+
+        if(type == 0 && context.inflectionAccounting) //line with "opposite" curvature
+        {
+            fit.startCurvSign = -fit.startCurvSign;
+            fit.endCurvSign = -fit.endCurvSign;
+            out.push_back(fit);
+        }
+
+        //if different start and end curvatures
+        if(fit.startCurvSign != fit.endCurvSign && context.inflectionAccounting && clothoidFitter)
+        {
+            double start = context.poly->idxToParam(startIdx);
+            double end = context.poly->idxToParam(fit.endIdx);
+            CurvePrimitivePtr startNoCurv = clothoidFitter->getCurveWithZeroCurvature(0);
+            CurvePrimitivePtr endNoCurv = clothoidFitter->getCurveWithZeroCurvature(end - start);
+
+            fit.curve = startNoCurv;
+            fit.startCurvSign = fit.endCurvSign = (startNoCurv->endCurvature() > 0. ? 1 : -1);
+
+            if(context.adjust)
+                adjustPrimitive(fit, context.fitter);
+
+            fit.error = context.errorComputer->computeErrorForCost(fit.curve, startIdx, fit.endIdx, errorThreshold * errorThreshold);
+
+            if(fit.error < errorThreshold * errorThreshold)
+            {
+                out.push_back(fit);
+                //Debugging::get()->drawCurve(fit.curve, color, typeNames[type]);
+            }
+
+            fit.curve = endNoCurv;
+            fit.startCurvSign = fit.endCurvSign = (endNoCurv->startCurvature() > 0. ? 1 : -1);
+
+            if(context.adjust)
+                adjustPrimitive(fit, context.fitter);
+
+            fit.error = context.errorComputer->computeErrorForCost(fit.curve, startIdx, fit.endIdx, errorThreshold * errorThreshold);
+
+            if(fit.error < errorThreshold * errorThreshold)
+            {
+                out.push_back(fit);
+                //Debugging::get()->drawCurve(fit.curve, color, typeNames[type]);
+            }
+        }
+        return true;
+    }
+
+    //Drops the candidates that another one over the same points with the same curvature signs dominates: its
+    //type costs no more and its error is no larger.  The candidates all start at the same point and their
+    //order is kept.
+    static void _pruneDominated(const Fitter &fitter, vector<FitPrimitive> &candidates)
+    {
+        double typeCost[3];
+        for(int i = 0; i < 3; ++i)
+            typeCost[i] = fitter.config().get(Parameters::ParameterType(Parameters::LINE_COST + i));
+
+        //only candidates in the same group can dominate each other, so the groups are made contiguous
+        vector<pair<int, int> > order(candidates.size()); //(group key, index)
+        for(int i = 0; i < (int)candidates.size(); ++i)
+            order[i] = make_pair(4 * candidates[i].endIdx + (candidates[i].startCurvSign > 0 ? 2 : 0) + (candidates[i].endCurvSign > 0 ? 1 : 0), i);
+        sort(order.begin(), order.end());
+
+        vector<bool> dominated(candidates.size(), false);
+        for(int groupStart = 0, groupEnd = 0; groupStart < (int)order.size(); groupStart = groupEnd)
+        {
+            while(groupEnd < (int)order.size() && order[groupEnd].first == order[groupStart].first)
+                ++groupEnd;
+
+            for(int a = groupStart; a < groupEnd; ++a)
+            {
+                int i = order[a].second;
+                double cost = typeCost[candidates[i].curve->getType()];
+                for(int b = groupStart; b < groupEnd && !dominated[i]; ++b)
+                {
+                    int j = order[b].second;
+                    double otherCost = typeCost[candidates[j].curve->getType()];
+                    if(j == i || otherCost > cost || candidates[j].error > candidates[i].error)
+                        continue;
+                    //of two that are equally good, the first one stays
+                    dominated[i] = otherCost < cost || candidates[j].error < candidates[i].error || j < i;
+                }
+            }
+        }
+
+        int kept = 0;
+        for(int i = 0; i < (int)candidates.size(); ++i)
+        {
+            if(!dominated[i])
+                candidates[kept++] = candidates[i];
+        }
+        candidates.erase(candidates.begin() + kept, candidates.end());
+    }
+
+    void adjustPrimitive(const FitPrimitive &primitive, const Fitter &fitter) const
     {
         ErrorComputerConstPtr errorComputer = fitter.output<ERROR_COMPUTER>()->errorComputer;
-        bool inflectionAccounting = fitter.params().get(Parameters::INFLECTION_COST) > 0.;
+        bool inflectionAccounting = fitter.config().get(Parameters::INFLECTION_COST) > 0.;
 
         vector<LSBoxConstraint> constraints;
 
@@ -308,13 +669,20 @@ protected:
 
         //solve
         OneCurveProblem problem(primitive, errorComputer);
-        LSSolver solver(&problem, constraints);
-        solver.setDefaultDamping(fitter.params().get(Parameters::CURVE_ADJUST_DAMPING));
+        LSSolverFixed<6> solver(&problem, constraints);
+        solver.setDefaultDamping(fitter.config().get(Parameters::CURVE_ADJUST_DAMPING));
         solver.setMaxIter(1);
         problem.setParams(solver.solve(problem.params()));
     }
 };
 
+size_t AlgorithmOutput<PRIMITIVE_FITTING>::memoryBytes() const
+{
+    //the curves are counted as clothoids, the largest of them
+    return vectorBytes(primitives) + primitives.size() * sizeof(Clothoid) + vectorBytes(values) +
+           vectorBytes(startOffsets) + vectorBytes(lastPointUsed);
+}
+
 void Algorithm<PRIMITIVE_FITTING>::_initialize()
 {
     new DefaultPrimitiveFitter(false);
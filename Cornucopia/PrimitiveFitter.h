@@ -23,6 +23,7 @@
 
 #include "defs.h"
 #include "Algorithm.h"
+#include "PrimitiveValue.h"
 
 NAMESPACE_Cornu
 
@@ -49,7 +50,16 @@ struct FitPrimitive
 template<>
 struct AlgorithmOutput<PRIMITIVE_FITTING> : public AlgorithmOutputBase
 {
+    //override
+    size_t memoryBytes() const;
+
     std::vector<FitPrimitive> primitives;
+    std::vector<PrimitiveValue> values; //values[i] is a copy of primitives[i].curve for fast evaluation
+
+    //for reuse after points are appended: the candidates starting at resampled point i are primitives
+    //startOffsets[i] through startOffsets[i + 1] - 1, and fitting them looked at points up to lastPointUsed[i]
+    std::vector<int> startOffsets;
+    std::vector<int> lastPointUsed;
 };
 
 template<>
@@ -20,12 +20,14 @@
 
 #include "PrimitiveSequence.h"
 #include "Bezier.h"
+#include "BoxTree.h"
+#include "Parallel.h"
 
 using namespace std;
 using namespace Eigen;
 NAMESPACE_Cornu
 
-PrimitiveSequence::PrimitiveSequence(const VectorC<CurvePrimitiveConstPtr> &primitives) : _primitives(primitives)
+PrimitiveSequence::PrimitiveSequence(const VectorC<CurvePrimitiveConstPtr> &primitives) : _primitives(primitives), _tree(NULL)
 {
     assert(_primitives.size() > 0);
     _lengths.resize(_primitives.size() + 1, 0);
@@ -54,27 +56,208 @@ void PrimitiveSequence::eval(double s, Vec *pos, Vec *der, Vec *der2) const
     _primitives[idx]->eval(cParam, pos, der, der2);
 }
 
-double PrimitiveSequence::project(const Vector2d &point) const
+PrimitiveSequence::PrimitiveSequence(const PrimitiveSequence &other)
+    : Curve(other), _primitives(other._primitives), _lengths(other._lengths), _tree(NULL)
+{
+}
+
+PrimitiveSequence::~PrimitiveSequence()
+{
+    delete _tree.load();
+}
+
+PrimitiveSequence &PrimitiveSequence::operator=(const PrimitiveSequence &other)
+{
+    _primitives = other._primitives;
+    _lengths = other._lengths;
+    delete _tree.exchange(NULL);
+    return *this;
+}
+
+const BoxTree *PrimitiveSequence::_primitiveTree() const
+{
+    BoxTree *tree = _tree.load(memory_order_acquire);
+    if(tree)
+        return tree;
+
+    //Every point of a primitive is within 1/16 of its length of one of these samples.  Lines are exact.
+    const int numSamples = 8;
+    vector<BoxTree::Box> boxes(_primitives.size());
+    for(int i = 0; i < (int)boxes.size(); ++i)
+    {
+        const CurvePrimitive &curve = *(_primitives[i]);
+        boxes[i].extend(curve.startPos());
+        boxes[i].extend(curve.endPos());
+        if(curve.getType() == CurvePrimitive::LINE)
+            continue;
+        for(int j = 1; j < numSamples; ++j)
+            boxes[i].extend(curve.pos(curve.length() * double(j) / double(numSamples)));
+        boxes[i].inflate(0.5 * curve.length() / double(numSamples));
+    }
+
+    //if several threads build the tree at once, the first one to finish wins
+    BoxTree *newTree = new BoxTree(boxes);
+    if(_tree.compare_exchange_strong(tree, newTree, memory_order_acq_rel))
+        return newTree;
+    delete newTree;
+    return tree;
+}
+
+double PrimitiveSequence::_closest(const Vector2d &point, double *outDistSq, int startIdx, double localS) const
 {
     double bestS = 0.;
     double minDistSq = 1e50;
+    int bestIdx = startIdx;
+    if(startIdx >= 0)
+    {
+        bestS = _lengths[startIdx] + localS;
+        minDistSq = (_primitives[startIdx]->pos(localS) - point).squaredNorm();
+    }
 
-    for(int i = 0; i < _primitives.size(); ++i)
+    //among equally close primitives, the first one wins, the same as trying them in order
+    _primitiveTree()->visit(point, minDistSq, [&](int i)
     {
+        if(i == startIdx)
+            return;
         double localS = _primitives[i]->project(point);
         Vector2d pt = _primitives[i]->pos(localS);
         double distSq = (pt - point).squaredNorm();
-        if(distSq < minDistSq)
+        if(distSq < minDistSq || (distSq == minDistSq && bestIdx > i))
         {
             minDistSq = distSq;
             bestS = _lengths[i] + localS;
+            bestIdx = i;
         }
-    }
+    });
 
+    if(outDistSq)
+        *outDistSq = minDistSq;
     return bestS;
 }
 
+double PrimitiveSequence::project(const Vector2d &point) const
+{
+    return _closest(point, NULL);
+}
+
+//The projection onto the primitive at the hint is usually the answer, and the tree search starting from it
+//only needs to look at primitives that might be closer
+double PrimitiveSequence::projectNear(const Vector2d &point, double sHint) const
+{
+    if(_primitives.circular())
+    {
+        sHint = fmod(sHint, _lengths.back());
+        if(sHint < 0.)
+            sHint += _lengths.back();
+    }
+    int idx = max(0, paramToIdx(sHint));
+    double localS = _primitives[idx]->projectNear(point, sHint - _lengths[idx]);
+    return _closest(point, NULL, idx, localS);
+}
+
+double PrimitiveSequence::distanceSqTo(const Vector2d &point) const
+{
+    double distSq;
+    _closest(point, &distSq);
+    return distSq;
+}
+
+double PrimitiveSequence::boundsDistanceSq(const Vector2d &point) const
+{
+    return _primitiveTree()->bounds().distanceSq(point);
+}
+
+void PrimitiveSequence::tessellate(double tolerance, PointVector &out) const
+{
+    for(int i = 0; i < _primitives.size(); ++i)
+    {
+        size_t first = out.size();
+        _primitives[i]->tessellate(tolerance, out);
+        if(i > 0) //the joint is the end of the previous primitive
+            out.erase(out.begin() + first);
+    }
+}
+
+void PrimitiveSequence::evalMany(const double *s, int n, Vec *pos, Vec *der, Vec *der2) const
+{
+    if(n == 0)
+        return;
+
+    vector<double> localS(n);
+    vector<int> idcs(n);
+    const int lastIdx = (int)_lengths.size() - 2;
+    int idx = 0;
+    for(int i = 0; i < n; ++i)
+    {
+        double cs = s[i];
+        if(_primitives.circular())
+        {
+            cs = fmod(cs, _lengths.back());
+            if(cs < 0.)
+                cs += _lengths.back();
+        }
+
+        //the arguments usually increase, so try the primitive of the previous one and the one after it before searching
+        if(idx < lastIdx && _lengths[idx + 1] <= cs)
+            ++idx;
+        if(_lengths[idx] > cs || (idx < lastIdx && _lengths[idx + 1] <= cs))
+            idx = max(0, paramToIdx(cs));
+        idcs[i] = idx;
+        localS[i] = cs - _lengths[idx];
+    }
+
+    //consecutive arguments on the same primitive are passed to it as one batch
+    for(int start = 0; start < n; )
+    {
+        int end = start + 1;
+        while(end < n && idcs[end] == idcs[start])
+            ++end;
+
+        _primitives[idcs[start]]->evalMany(&(localS[start]), end - start,
+                                           pos ? pos + start : NULL, der ? der + start : NULL, der2 ? der2 + start : NULL);
+        start = end;
+    }
+}
+
+void PrimitiveSequence::projectMany(const Vec *points, int n, double *out) const
+{
+    if(n == 0)
+        return;
+
+    vector<double> minDistSq(n, 1e50);
+    vector<double> localS(n);
+    PointVector pts(n);
+
+    for(int i = 0; i < n; ++i)
+        out[i] = 0.;
+
+    for(int i = 0; i < _primitives.size(); ++i)
+    {
+        _primitives[i]->projectMany(points, n, &(localS[0]));
+        _primitives[i]->evalMany(&(localS[0]), n, &(pts[0]));
+        for(int j = 0; j < n; ++j)
+        {
+            double distSq = (pts[j] - points[j]).squaredNorm();
+            if(distSq < minDistSq[j])
+            {
+                minDistSq[j] = distSq;
+                out[j] = _lengths[i] + localS[j];
+            }
+        }
+    }
+}
+
 PrimitiveSequencePtr PrimitiveSequence::trimmed(double from, double to) const
+{
+    return trimmedView(from, to).toSequence();
+}
+
+PrimitiveSequencePtr PrimitiveSequence::flipped() const
+{
+    return flippedView().toSequence();
+}
+
+PrimitiveSequenceView PrimitiveSequence::trimmedView(double from, double to) const
 {
     double len = length();
 
@@ -105,8 +288,6 @@ PrimitiveSequencePtr PrimitiveSequence::trimmed(double from, double to) const
             swap(from, to);
     }
 
-    VectorC<CurvePrimitiveConstPtr> out(0, NOT_CIRCULAR);
-
     double startParamRemainder, endParamRemainder;
     int startIdx = paramToIdx(from, &startParamRemainder);
 
@@ -123,95 +304,276 @@ PrimitiveSequencePtr PrimitiveSequence::trimmed(double from, double to) const
         endParamRemainder = _primitives[endIdx]->length();
     }
 
+    PrimitiveSequenceView out;
+    out._parent = this;
+    out._startIdx = startIdx;
+    out._from = _lengths[startIdx] + startParamRemainder;
+    out._closed = out._flipped = false;
+
     if(startIdx == endIdx && startParamRemainder < endParamRemainder)
     {
-        out.push_back(_primitives[startIdx]->trimmed(startParamRemainder, endParamRemainder));
+        out._numPrimitives = 1;
+        out._first = out._last = _primitives[startIdx]->trimmed(startParamRemainder, endParamRemainder);
+        out._lastFrom = 0.;
+        out._length = out._first->length();
+        return out;
     }
-    else
-    {
-        out.push_back(_primitives[startIdx]->trimmed(startParamRemainder, _primitives[startIdx]->length()));
 
-        for(VectorC<CurvePrimitiveConstPtr>::Circulator circ = _primitives.circulator(startIdx + 1); !circ.done() ; ++circ)
-        {
-            if(circ.index() == endIdx)
-                break;
+    //the primitives strictly between the ends, going around a closed curve if need be
+    int size = _primitives.size();
+    int numInterior = endIdx - startIdx - 1;
+    if(numInterior < 0)
+        numInterior = isClosed() ? numInterior + size : size - startIdx - 1;
+    int interiorEnd = startIdx + 1 + numInterior;
+    double interiorLength = _lengths[min(interiorEnd, size)] - _lengths[startIdx + 1];
+    if(interiorEnd > size)
+        interiorLength += _lengths[interiorEnd - size];
+
+    out._numPrimitives = numInterior + 2;
+    out._first = _primitives[startIdx]->trimmed(startParamRemainder, _primitives[startIdx]->length());
+    out._last = _primitives[endIdx]->trimmed(0, endParamRemainder);
+    out._lastFrom = out._first->length() + interiorLength;
+    out._length = out._lastFrom + out._last->length();
+    return out;
+}
 
-            out.push_back(*circ);
-        }
+PrimitiveSequenceView PrimitiveSequence::flippedView() const
+{
+    return PrimitiveSequenceView(*this).flipped();
+}
 
-        out.push_back(_primitives[endIdx]->trimmed(0, endParamRemainder));
-    }
+PrimitiveSequencePtr PrimitiveSequence::transformed(const Similarity &similarity) const
+{
+    VectorC<CurvePrimitiveConstPtr> out = _primitives;
+    for(int i = 0; i < (int)out.size(); ++i)
+        out.flatAt(i) = out.flatAt(i)->transformed(similarity);
 
     return new PrimitiveSequence(out);
 }
 
-PrimitiveSequencePtr PrimitiveSequence::flipped() const
+static const int bezierTolerancePts = 3; //compute the difference at this many points
+
+//Evaluates the primitive at the ends of numSegments equal pieces and at numTestPts points inside
+//each piece in one batch.  The values for piece k start at index k * (2 + numTestPts): start, end, test points.
+//The output arrays must have room for numSegments * (2 + numTestPts) values.
+static void evalSegments(const CurvePrimitive &primitive, int numSegments, int numTestPts, Vector2d *pos, Vector2d *der)
 {
-    VectorC<CurvePrimitiveConstPtr> out = _primitives;
-    reverse(out.begin(), out.end());
+    double s[PrimitiveSequence::maxBezierPieces * (2 + bezierTolerancePts)];
+    int num = 0;
 
-    for(int i = 0; i < (int)out.size(); ++i)
-        out.flatAt(i) = out.flatAt(i)->flipped();
+    double step = primitive.length() / numSegments;
+    for(int k = 0; k < numSegments; ++k)
+    {
+        double start = step * k;
+        s[num++] = start;
+        s[num++] = start + step;
+        for(int m = 0; m < numTestPts; ++m)
+            s[num++] = start + step * (double(m + 1) / double(numTestPts + 1));
+    }
 
-    return new PrimitiveSequence(out);
+    primitive.evalMany(s, num, pos, der);
 }
 
-BezierSplinePtr PrimitiveSequence::toBezierSpline(double tolerance) const
+//Estimates the number of pieces a primitive needs for its Hermite cubics to be within tolerance.  Fitting
+//the error at the test points of a single cubic over a primitive of length L, turning theta, with the curvature
+//changing by delta * L (both in radians) gives about L * (theta^3 / 384 + theta * delta / 128 + delta^2 / 4550).
+//Splitting into j pieces divides L and theta by j and delta by j^2.  The fit overestimates the error by up to a factor
+//of 1.8, and it's scaled down by that so that the estimate doesn't exceed the number of pieces actually needed.
+static int estimateBezierPieces(const CurvePrimitive &primitive, double tolerance, int maxPieces)
 {
-    BezierSpline::PrimitiveVector segments;
+    double length = primitive.length();
+    double k0 = primitive.startCurvature(), k1 = primitive.endCurvature();
+    double theta = fabs(0.5 * (k0 + k1)) * length, delta = fabs(k1 - k0) * length;
+
+    int j;
+    for(j = 1; j < maxPieces; ++j)
+    {
+        double pieceTheta = theta / j, pieceDelta = delta / (j * j);
+        double err = 0.55 * (length / j) * (CUBE(pieceTheta) / 384. + pieceTheta * pieceDelta / 128. + SQR(pieceDelta) / 4550.);
+        if(err <= tolerance)
+            break;
+    }
+    return j;
+}
 
-    const int tolerancePts = 3; //compute difference at this many points
-    const int maxBeziers = 5; //every primitive will be represented by at most this many beziers
+//Checks the estimated number of pieces and adds pieces until the error is low enough
+int PrimitiveSequence::primitiveToBezier(const CurvePrimitive &primitive, double tolerance, CubicBezier *out)
+{
+    const int tolerancePts = bezierTolerancePts;
+    Vector2d pos[maxBezierPieces * (2 + tolerancePts)], der[maxBezierPieces * (2 + tolerancePts)];
 
-    for(int i = 0; i < (int)_primitives.size(); ++i) //loop over primitives
+    int j;
+    for(j = estimateBezierPieces(primitive, tolerance, maxBezierPieces); j < maxBezierPieces; ++j)
     {
-        int j;
-        for(j = 1; j < maxBeziers; ++j) //determine how many bezier segments we need
+        double step = primitive.length() / j;
+        bool errorTooHigh = false;
+
+        evalSegments(primitive, j, tolerancePts, pos, der);
+
+        for(int k = 0; k < j; ++k) //for each bezier segment
         {
-            double step = _primitives[i]->length() / j;
-            bool errorTooHigh = false;
+            int base = k * (2 + tolerancePts);
+            CubicBezier cur = CubicBezier::hermite(pos[base], pos[base + 1], der[base] * step, der[base + 1] * step);
 
-            for(int k = 0; k < j; ++k) //for each bezier segment
+            for(int m = 0; m < tolerancePts; ++m) //for each tolerance test point
             {
-                double start = step * k;
-                double end = start + step;
-                CubicBezier cur = CubicBezier::hermite(_primitives[i]->pos(start), _primitives[i]->pos(end),
-                                                       _primitives[i]->der(start) * step, _primitives[i]->der(end) * step);
-
-                for(int m = 0; m < tolerancePts; ++m) //for each tolerance test point
+                double t = double(m + 1) / double(tolerancePts + 1);
+                Vector2d splinePt;
+                cur.eval(t, &splinePt);
+                if((splinePt - pos[base + 2 + m]).squaredNorm() > tolerance * tolerance)
                 {
-                    double t = double(m + 1) / double(tolerancePts + 1);
-                    Vector2d splinePt;
-                    cur.eval(t, &splinePt);
-                    if((splinePt - _primitives[i]->pos(start + step * t)).squaredNorm() > tolerance * tolerance)
-                    {
-                        errorTooHigh = true;
-                        break;
-                    }
-                }
-
-                if(errorTooHigh)
+                    errorTooHigh = true;
                     break;
+                }
             }
 
-            if(!errorTooHigh)
-                break; //j now contains the right number of segments
+            if(errorTooHigh)
+                break;
         }
 
-        double step = _primitives[i]->length() / j;
-        for(int k = 0; k < j; ++k) //for each bezier segment
-        {
-            double start = step * k;
-            double end = start + step;
-            CubicBezier cur = CubicBezier::hermite(_primitives[i]->pos(start), _primitives[i]->pos(end),
-                                                    _primitives[i]->der(start) * step, _primitives[i]->der(end) * step);
-            segments.push_back(cur);
-        }
+        if(!errorTooHigh)
+            break; //j now contains the right number of segments
+    }
+
+    double step = primitive.length() / j;
+    evalSegments(primitive, j, 0, pos, der);
+    for(int k = 0; k < j; ++k) //for each bezier segment
+        out[k] = CubicBezier::hermite(pos[2 * k], pos[2 * k + 1], der[2 * k] * step, der[2 * k + 1] * step);
+    return j;
+}
+
+static void toBezierPieces(const VectorC<CurvePrimitiveConstPtr> &primitives, int from, int to, double tolerance,
+                           BezierSpline::PrimitiveVector &out)
+{
+    CubicBezier pieces[PrimitiveSequence::maxBezierPieces];
+    for(int i = from; i < to; ++i) //loop over primitives
+    {
+        int num = PrimitiveSequence::primitiveToBezier(*primitives[i], tolerance, pieces);
+        out.insert(out.end(), pieces, pieces + num);
+    }
+}
+
+class _BezierChunkBody
+{
+public:
+    _BezierChunkBody(const VectorC<CurvePrimitiveConstPtr> &primitives, int chunkSize, double tolerance,
+                     vector<BezierSpline::PrimitiveVector> &out)
+        : _primitives(primitives), _chunkSize(chunkSize), _tolerance(tolerance), _out(out) {}
+
+    void operator()(int i) const
+    {
+        int from = i * _chunkSize, to = min((int)_primitives.size(), from + _chunkSize);
+        toBezierPieces(_primitives, from, to, _tolerance, _out[i]);
+    }
+
+private:
+    const VectorC<CurvePrimitiveConstPtr> &_primitives;
+    int _chunkSize;
+    double _tolerance;
+    vector<BezierSpline::PrimitiveVector> &_out;
+};
+
+//The primitives are converted independently, so long sequences are split into chunks that are converted in parallel
+BezierSplinePtr PrimitiveSequence::toBezierSpline(double tolerance) const
+{
+    const int chunkSize = 256; //starting threads only pays off for this many primitives
+    int numPrimitives = (int)_primitives.size();
+
+    BezierSpline::PrimitiveVector segments;
+    if(numPrimitives <= chunkSize)
+        toBezierPieces(_primitives, 0, numPrimitives, tolerance, segments);
+    else
+    {
+        int numChunks = (numPrimitives + chunkSize - 1) / chunkSize;
+        vector<BezierSpline::PrimitiveVector> chunks(numChunks);
+        parallelFor(numChunks, _BezierChunkBody(_primitives, chunkSize, tolerance, chunks));
+        for(int i = 0; i < numChunks; ++i)
+            segments.insert(segments.end(), chunks[i].begin(), chunks[i].end());
     }
 
     return new BezierSpline(segments);
 }
 
+//============================PrimitiveSequenceView==============================
+
+PrimitiveSequenceView::PrimitiveSequenceView(const PrimitiveSequence &parent)
+    : _parent(&parent), _startIdx(0), _numPrimitives(parent.primitives().size()), _from(0.), _lastFrom(0.), _length(parent.length()),
+      _closed(parent.isClosed()), _flipped(false)
+{
+}
+
+void PrimitiveSequenceView::_evalUnflipped(double s, Vec *pos, Vec *der, Vec *der2) const
+{
+    if(!_first) //the whole sequence
+        _parent->eval(s, pos, der, der2);
+    else if(_numPrimitives == 1 || s < _first->length())
+        _first->eval(s, pos, der, der2);
+    else if(s >= _lastFrom)
+        _last->eval(s - _lastFrom, pos, der, der2);
+    else //the parent wraps the parameter around a closed curve
+        _parent->eval(_from + s, pos, der, der2);
+}
+
+void PrimitiveSequenceView::eval(double s, Vec *pos, Vec *der, Vec *der2) const
+{
+    if(!_flipped)
+    {
+        _evalUnflipped(s, pos, der, der2);
+        return;
+    }
+    //running the other way negates the tangent, but not the second derivative
+    _evalUnflipped(_length - s, pos, der, der2);
+    if(der)
+        *der = -*der;
+}
+
+CurvePrimitiveConstPtr PrimitiveSequenceView::_unflippedPrimitive(int idx) const
+{
+    if(_first && idx == 0)
+        return _first;
+    if(_first && idx + 1 == _numPrimitives)
+        return _last;
+    const VectorC<CurvePrimitiveConstPtr> &primitives = _parent->primitives();
+    return primitives.flatAt((_startIdx + idx) % primitives.size());
+}
+
+CurvePrimitiveConstPtr PrimitiveSequenceView::primitive(int idx) const
+{
+    if(!_flipped)
+        return _unflippedPrimitive(idx);
+    return _unflippedPrimitive(_numPrimitives - 1 - idx)->flipped();
+}
+
+PrimitiveSequenceView PrimitiveSequenceView::trimmed(double from, double to) const
+{
+    if(!_closed)
+    {
+        from = max(0., from);
+        to = min(_length, to);
+        if(from > to)
+            swap(from, to);
+    }
+    if(_flipped)
+    {
+        double unflippedFrom = _length - to;
+        to = _length - from;
+        from = unflippedFrom;
+    }
+
+    PrimitiveSequenceView out = _parent->trimmedView(_from + from, _from + to);
+    out._flipped = _flipped;
+    return out;
+}
+
+PrimitiveSequencePtr PrimitiveSequenceView::toSequence() const
+{
+    VectorC<CurvePrimitiveConstPtr> out(_numPrimitives, _closed ? CIRCULAR : NOT_CIRCULAR);
+    for(int i = 0; i < _numPrimitives; ++i)
+        out.flatAt(i) = primitive(i);
+
+    return new PrimitiveSequence(out);
+}
+
 END_NAMESPACE_Cornu
 
 
@@ -24,16 +24,24 @@
 #include "defs.h"
 #include "CurvePrimitive.h"
 #include "VectorC.h"
+#include <atomic>
 
 NAMESPACE_Cornu
 
 CORNU_SMART_FORW_DECL(PrimitiveSequence);
 CORNU_SMART_FORW_DECL(BezierSpline);
+class PrimitiveSequenceView;
+class BoxTree;
+class CubicBezier;
 
 class PrimitiveSequence : public Curve
 {
 public:
     PrimitiveSequence(const VectorC<CurvePrimitiveConstPtr> &primitives);
+    PrimitiveSequence(const PrimitiveSequence &other);
+    ~PrimitiveSequence();
+
+    PrimitiveSequence &operator=(const PrimitiveSequence &other);
 
     //overrides
     double length() const { return _lengths.back(); }
@@ -42,6 +50,14 @@ public:
     void eval(double s, Vec *pos, Vec *der = NULL, Vec *der2 = NULL) const;
 
     double project(const Vec &point) const;
+    double projectNear(const Vec &point, double sHint) const;
+    void evalMany(const double *s, int n, Vec *pos, Vec *der = NULL, Vec *der2 = NULL) const;
+    void projectMany(const Vec *points, int n, double *out) const;
+    double distanceSqTo(const Vec &point) const;
+    void tessellate(double tolerance, PointVector &out) const; //each primitive's, without repeating the joints
+
+    //A lower bound on distanceSqTo from the bounding box, for quickly rejecting far away curves in hit testing
+    double boundsDistanceSq(const Vec &point) const;
 
     //utility functions
     int paramToIdx(double param, double *outParam = NULL) const;
@@ -52,15 +68,76 @@ public:
     //than from for a closed curve.
     PrimitiveSequencePtr trimmed(double from, double to) const;
     PrimitiveSequencePtr flipped() const;
+    //Same as trimmed and flipped, but without copying the primitives
+    PrimitiveSequenceView trimmedView(double from, double to) const;
+    PrimitiveSequenceView flippedView() const;
+    PrimitiveSequencePtr transformed(const Similarity &similarity) const; //see CurvePrimitive::transform
 
     const VectorC<CurvePrimitiveConstPtr> &primitives() const { return _primitives; }
 
     BezierSplinePtr toBezierSpline(double tolerance) const;
 
+    //Writes the Hermite cubics for one primitive that are within tolerance of it to out, which needs room for
+    //maxBezierPieces of them, and returns how many there are
+    static const int maxBezierPieces = 5;
+    static int primitiveToBezier(const CurvePrimitive &primitive, double tolerance, CubicBezier *out);
+
 private:
+    //returns the parameter of the closest point--the search starts from the candidate at localS on primitive startIdx, if given
+    double _closest(const Vec &point, double *outDistSq, int startIdx = -1, double localS = 0.) const;
+    const BoxTree *_primitiveTree() const;
+
     VectorC<CurvePrimitiveConstPtr> _primitives;
     //lengths[x] = \sum_{i=1}^{i=x} _primitives[i-1]->length(), i.e., length up to the start of the primitive at x
     std::vector<double> _lengths; 
+    //bounding boxes of the primitives for projection, built when first needed
+    mutable std::atomic<BoxTree *> _tree;
+};
+
+//A trimmed or flipped PrimitiveSequence that refers to the parent's primitives instead of copying them: only the end
+//primitives the trimming cuts are new, so making one allocates two primitives however long the parent is.  Its
+//primitives are those of the sequence that trimmed (and flipped) would return, which toSequence makes.  The parent
+//must outlive the view.
+class PrimitiveSequenceView
+{
+public:
+    typedef Eigen::Vector2d Vec;
+
+    PrimitiveSequenceView(const PrimitiveSequence &parent); //the whole sequence
+
+    double length() const { return _length; }
+    bool isClosed() const { return _closed; } //only the whole sequence can be
+    bool isFlipped() const { return _flipped; }
+    const PrimitiveSequence &parent() const { return *_parent; }
+
+    void eval(double s, Vec *pos, Vec *der = NULL, Vec *der2 = NULL) const;
+    Vec pos(double s) const { Vec out; eval(s, &out); return out; }
+
+    int numPrimitives() const { return _numPrimitives; }
+    CurvePrimitiveConstPtr primitive(int idx) const; //a flipped view makes a flipped copy of the parent's primitive
+
+    //like PrimitiveSequence's, with the view's parameters--the result is a view of the same parent
+    PrimitiveSequenceView trimmed(double from, double to) const;
+    PrimitiveSequenceView flipped() const { PrimitiveSequenceView out(*this); out._flipped = !_flipped; return out; }
+
+    PrimitiveSequencePtr toSequence() const;
+
+private:
+    friend class PrimitiveSequence;
+    PrimitiveSequenceView() {}
+
+    CurvePrimitiveConstPtr _unflippedPrimitive(int idx) const;
+    void _evalUnflipped(double s, Vec *pos, Vec *der, Vec *der2) const;
+
+    const PrimitiveSequence *_parent;
+    int _startIdx; //the parent index of the first primitive
+    int _numPrimitives;
+    CurvePrimitiveConstPtr _first, _last; //the trimmed end primitives (the same one if there's one primitive), NULL for the whole sequence
+    double _from; //the parent parameter of the start
+    double _lastFrom; //the (unflipped) parameter where _last starts
+    double _length;
+    bool _closed;
+    bool _flipped;
 };
 
 END_NAMESPACE_Cornu
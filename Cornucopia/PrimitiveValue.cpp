@@ -0,0 +1,81 @@
+/*--
+    PrimitiveValue.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PrimitiveValue.h"
+#include "Line.h"
+#include "Arc.h"
+#include "Clothoid.h"
+
+using namespace std;
+using namespace Eigen;
+NAMESPACE_Cornu
+
+PrimitiveValue PrimitiveValue::make(const CurvePrimitive &curve)
+{
+    PrimitiveValue out;
+    out.type = curve.getType();
+    out.flat = out.arc = out.nearArc = false;
+    for(int i = 0; i < 6; ++i)
+        out.params[i] = 0.;
+    out.vec1 = out.vec2 = StoredVec::Zero();
+    out.mat = StoredMat::Zero();
+    out.radius = out.t1 = out.tdiff = 0.;
+
+    const CurvePrimitive::ParamVec &params = curve.params();
+    for(int i = 0; i < (int)params.size(); ++i)
+        out.params[i] = params[i];
+
+    switch(out.type)
+    {
+    case CurvePrimitive::LINE:
+        {
+            const Line &line = static_cast<const Line &>(curve);
+            out.vec1 = line._der;
+        }
+        break;
+    case CurvePrimitive::ARC:
+        {
+            const Arc &arc = static_cast<const Arc &>(curve);
+            out.flat = arc._flat;
+            out.vec1 = arc._tangent;
+            out.vec2 = arc._center;
+            out.radius = arc._radius;
+        }
+        break;
+    case CurvePrimitive::CLOTHOID:
+        {
+            const Clothoid &clothoid = static_cast<const Clothoid &>(curve);
+            out.flat = clothoid._flat;
+            out.arc = clothoid._arc;
+            out.nearArc = (clothoid._evalPos == &Clothoid::_nearArcPos);
+            if(out.nearArc)
+                out.vec2 = StoredVec(clothoid._cosStart, clothoid._sinStart);
+            out.vec1 = clothoid._startShift;
+            out.mat = clothoid._mat;
+            out.t1 = clothoid._t1;
+            out.tdiff = clothoid._tdiff;
+        }
+        break;
+    }
+
+    return out;
+}
+
+END_NAMESPACE_Cornu
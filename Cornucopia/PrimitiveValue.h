@@ -0,0 +1,131 @@
+/*--
+    PrimitiveValue.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_PRIMITIVEVALUE_H_INCLUDED
+#define CORNUCOPIA_PRIMITIVEVALUE_H_INCLUDED
+
+#include "defs.h"
+#include "CurvePrimitive.h"
+#include "Fresnel.h"
+
+NAMESPACE_Cornu
+
+/*
+    A PrimitiveValue is a plain copy of a line, arc, or clothoid (its parameters plus the data
+    the primitive caches for evaluation).  It is not reference counted, can be stored contiguously,
+    and evaluates without virtual calls.  The evaluation code mirrors that of Line, Arc, and Clothoid
+    exactly, so it gives the same results.  It does not support projection or modification--
+    use the CurvePrimitive for that.
+*/
+struct PrimitiveValue
+{
+    typedef Eigen::Vector2d Vec;
+    typedef Eigen::Matrix<double, 2, 1, Eigen::DontAlign> StoredVec;
+    typedef Eigen::Matrix<double, 2, 2, Eigen::DontAlign> StoredMat;
+
+    static PrimitiveValue make(const CurvePrimitive &curve);
+
+    CurvePrimitive::PrimitiveType getType() const { return type; }
+    double length() const { return params[CurvePrimitive::LENGTH]; }
+    Vec startPos() const { return Vec(params[CurvePrimitive::X], params[CurvePrimitive::Y]); }
+    double startAngle() const { return params[CurvePrimitive::ANGLE]; }
+
+    Vec pos(double s) const
+    {
+        switch(type)
+        {
+        case CurvePrimitive::LINE:
+            return startPos() + s * Vec(vec1);
+        case CurvePrimitive::ARC:
+            if(flat)
+                return startPos() + Vec(vec1) * s;
+            else
+            {
+                double a = params[CurvePrimitive::ANGLE] + s * params[CurvePrimitive::CURVATURE];
+                return Vec(vec2) + radius * Vec(sin(a), -cos(a));
+            }
+        default: //clothoid
+            {
+                double t = t1 + s * tdiff;
+
+                Vec cs;
+                if(flat)
+                    cs = Vec(t, 0);
+                else if(arc)
+                    cs = Vec(cos(t), sin(t));
+                else if(nearArc)
+                {
+                    fresnelNearArc(params[CurvePrimitive::CURVATURE], params[CurvePrimitive::DCURVATURE], s, &(cs[0]), &(cs[1]));
+                    return startPos() + Vec(vec2[0] * cs[0] - vec2[1] * cs[1], vec2[1] * cs[0] + vec2[0] * cs[1]);
+                }
+                else
+                    fresnelCurve(t, &(cs[1]), &(cs[0]));
+
+                return Vec(vec1) + Eigen::Matrix2d(mat) * cs;
+            }
+        }
+    }
+
+    double angle(double s) const
+    {
+        switch(type)
+        {
+        case CurvePrimitive::LINE:
+            return params[CurvePrimitive::ANGLE];
+        case CurvePrimitive::ARC:
+            return params[CurvePrimitive::ANGLE] + s * params[CurvePrimitive::CURVATURE];
+        default:
+            return params[CurvePrimitive::ANGLE] + s * (params[CurvePrimitive::CURVATURE] + 0.5 * s * params[CurvePrimitive::DCURVATURE]);
+        }
+    }
+
+    double curvature(double s) const
+    {
+        switch(type)
+        {
+        case CurvePrimitive::LINE:
+            return 0;
+        case CurvePrimitive::ARC:
+            return params[CurvePrimitive::CURVATURE];
+        default:
+            return params[CurvePrimitive::CURVATURE] + s * params[CurvePrimitive::DCURVATURE];
+        }
+    }
+
+    double startCurvature() const { return curvature(0); }
+    double endCurvature() const { return curvature(length()); }
+
+    CurvePrimitive::PrimitiveType type;
+    bool flat; //arcs and clothoids
+    bool arc; //clothoids with constant curvature
+    bool nearArc; //clothoids with almost constant curvature
+    double params[6]; //as in CurvePrimitive, unused ones are zero
+
+    //cached evaluation data: the meaning depends on the type
+    StoredVec vec1; //line, arc: start tangent, clothoid: translation from the canonical clothoid
+    StoredVec vec2; //arc: center, near-arc clothoid: cosine and sine of the start angle
+    StoredMat mat; //clothoid: rotation and scale from the canonical clothoid
+    double radius; //arc
+    double t1, tdiff; //clothoid: canonical parameter range
+};
+
+END_NAMESPACE_Cornu
+
+#endif //CORNUCOPIA_PRIMITIVEVALUE_H_INCLUDED
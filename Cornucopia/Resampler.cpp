@@ -27,6 +27,7 @@
 #include "PrimitiveFitUtils.h"
 #include "PiecewiseLinearUtils.h"
 #include "Arc.h"
+#include "Parallel.h"
 
 #include <iterator>
 #include <map>
@@ -61,47 +62,55 @@ protected:
 
         if(!anyCorners) //also implies curve is closed
         {
-            vector<double> samples = _resample(fitter, poly);
-            out.output = _processSamples(samples, poly, 0, 0, prevToCur);
+            vector<double> samples = _resample(fitter, PolylineView(*poly));
+            out.output = _processSamples(samples, PolylineView(*poly), 0, 0, prevToCur);
             out.corners = VectorC<bool>(vector<bool>(out.output->pts().size(), false), CIRCULAR);
+            prevToCur.freeze();
             prevToCur.batchEval(out.parameters);
             displayOutput(out, fitter);
             return;
         }
 
-        out.corners = VectorC<bool>(0, pts.circular());
-        VectorC<Vector2d> outputPts(0, pts.circular());
-
-        double lengthSoFar = 0;
-
+        //the segments between corners are resampled independently, so that's done in parallel, and the results
+        //are put together in order
+        vector<_Segment> segments;
         for(int idx = 0; idx < pts.endIdx(1); ++idx) //go through all possible segment starting points
         {
             if(!corners[idx])
                 continue;
 
-            int segmentStartIdx = idx;
-            bool denseNearStart = (idx == 0) && osOutput->startCurve;
+            _Segment segment;
+            segment.startIdx = idx;
+            segment.denseNearStart = (idx == 0) && osOutput->startCurve;
 
-            VectorC<Vector2d> segment(0, NOT_CIRCULAR);
-            for(VectorC<Vector2d>::Circulator circ = pts.circulator(idx); ; ++circ, ++idx)
-            {
-                segment.push_back(*circ);
-                if(segment.size() > 1 && corners[circ.index()])
-                    break;
-            }
+            for(++idx; !corners[idx]; ++idx) //find the next corner
+                ;
+
+            segment.endIdx = pts.toLinearIdx(idx);
+            segment.denseNearEnd = (idx + 1 == pts.size()) && osOutput->endCurve;
+            segments.push_back(segment);
 
-            bool denseNearEnd = (idx + 1 == pts.size()) && osOutput->endCurve;
+            --idx; //we should start the next segment from the last point of the current one
+        }
+        int numThreads = (int)fitter.config().get(Parameters::RESAMPLING_THREADS);
+        if(numThreads <= 0)
+            numThreads = min(numHardwareThreads(), max(1, pts.size() / pointsPerThread)); //starting threads only pays off for long curves
+        parallelFor((int)segments.size(), _SegmentBody(*this, fitter, *poly, segments), numThreads);
 
-            PolylineConstPtr segmentPoly = new Polyline(segment);
-            vector<double> samples = _resample(fitter, segmentPoly, denseNearStart, denseNearEnd);
-            PolylineConstPtr resampled = _processSamples(samples, segmentPoly, poly->idxToParam(segmentStartIdx), lengthSoFar, prevToCur);
+        out.corners = VectorC<bool>(0, pts.circular());
+        VectorC<Vector2d> outputPts(0, pts.circular());
+
+        double lengthSoFar = 0;
+
+        for(int i = 0; i < (int)segments.size(); ++i)
+        {
+            PolylineView segmentPoly(*poly, segments[i].startIdx, segments[i].endIdx);
+            PolylineConstPtr resampled = _processSamples(segments[i].samples, segmentPoly, poly->idxToParam(segments[i].startIdx), lengthSoFar, prevToCur);
             int startIdx = outputPts.empty() ? 0 : 1;
             copy(resampled->pts().begin() + startIdx, resampled->pts().end(), back_inserter(outputPts));
             out.corners.insert(out.corners.end(), resampled->pts().end() - (resampled->pts().begin() + startIdx), false);
             out.corners[0] = out.corners.back() = true;
             lengthSoFar += resampled->length();
-
-            --idx; //we should start the next segment from the last point of the current one
         }
 
         if(poly->isClosed())
@@ -111,6 +120,7 @@ protected:
         }
 
         out.output = new Polyline(outputPts);
+        prevToCur.freeze();
         //adjust the parameters into the range that the PiecewiseLinearMontone object uses
         for(int i = 0; i < (int)out.parameters.size(); ++i)
             if(out.parameters[i] < prevToCur.minX())
@@ -119,23 +129,56 @@ protected:
         displayOutput(out, fitter);
     }
 
-    virtual vector<double> _resample(const Fitter &fitter, PolylineConstPtr poly, bool denseNearStart = false, bool denseNearEnd = false) = 0;
+    //called for the segments from different threads at once
+    virtual vector<double> _resample(const Fitter &fitter, const PolylineView &poly, bool denseNearStart = false, bool denseNearEnd = false) = 0;
 
 private:
-    PolylineConstPtr _processSamples(const vector<double> &samples, PolylineConstPtr prev, double offsetPrev,
+    static const int pointsPerThread = 500;
+
+    struct _Segment
+    {
+        int startIdx;
+        int endIdx;
+        bool denseNearStart;
+        bool denseNearEnd;
+        vector<double> samples;
+    };
+
+    class _SegmentBody
+    {
+    public:
+        _SegmentBody(BaseResampler &resampler, const Fitter &fitter, const Polyline &poly, vector<_Segment> &segments)
+            : _resampler(resampler), _fitter(fitter), _poly(poly), _segments(segments) {}
+
+        void operator()(int i) const
+        {
+            _Segment &segment = _segments[i];
+            segment.samples = _resampler._resample(_fitter, PolylineView(_poly, segment.startIdx, segment.endIdx),
+                                                   segment.denseNearStart, segment.denseNearEnd);
+        }
+
+    private:
+        BaseResampler &_resampler;
+        const Fitter &_fitter;
+        const Polyline &_poly;
+        vector<_Segment> &_segments;
+    };
+
+    PolylineConstPtr _processSamples(const vector<double> &samples, const PolylineView &prev, double offsetPrev,
                                      double offsetCur, PiecewiseLinearMonotone &prevToCur)
     {
-        VectorC<Vector2d> out(samples.size(), prev->pts().circular());
+        VectorC<Vector2d> out(samples.size(), prev.isClosed() ? CIRCULAR : NOT_CIRCULAR);
+        Polyline::Cursor cursor = prev.cursor();
         double lenSoFar = 0;
         for(int i = 0; i < (int)samples.size(); ++i)
         {
-            out[i] = prev->pos(samples[i]);
+            out[i] = cursor.pos(samples[i]);
             if(i > 0)
                 lenSoFar += (out[i] - out[i - 1]).norm();
             prevToCur.add(offsetPrev + samples[i], offsetCur + lenSoFar);
         }
-        if(prev->isClosed())
-            prevToCur.add(offsetPrev + prev->length(), offsetCur + lenSoFar + (out.back() - out[0]).norm());
+        if(prev.isClosed())
+            prevToCur.add(offsetPrev + prev.length(), offsetCur + lenSoFar + (out.back() - out[0]).norm());
 
         return new Polyline(out);
     }
@@ -144,17 +187,17 @@ private:
     {
         for(int i = 0; i < out.output->pts().size(); ++i)
         {
-            Debugging::get()->drawPoint(out.output->pts()[i], Vector3d(0, (i % 10 == 0) ? 0.6 : 0, 0), "Resampled");
+            CORNU_DEBUG(drawPoint(out.output->pts()[i], Vector3d(0, (i % 10 == 0) ? 0.6 : 0, 0), "Resampled"));
             if(out.corners[i])
-                Debugging::get()->drawPoint(out.output->pts()[i], Vector3d(0, 0, 0), "Resampled Corners");
+                CORNU_DEBUG(drawPoint(out.output->pts()[i], Vector3d(0, 0, 0), "Resampled Corners"));
         }
-        Debugging::get()->printf("Num samples = %d", out.output->pts().size());
+        CORNU_DEBUG(printf("Num samples = %d", out.output->pts().size()));
 
 #if 0
-        Debugging::get()->drawCurve(out.output, Vector3d(0, 0, 0), "Resampled curve");
+        CORNU_DEBUG(drawCurve(out.output, Vector3d(0, 0, 0), "Resampled curve"));
         for(int i = 0; i < (int)out.parameters.size(); ++i)
         {
-            Debugging::get()->drawLine(fitter.originalSketch()->pts()[i], out.output->pos(out.parameters[i]), Vector3d(1, 0, 1), "Resampled Correspondence");
+            CORNU_DEBUG(drawLine(fitter.originalSketch()->pts()[i], out.output->pos(out.parameters[i]), Vector3d(1, 0, 1), "Resampled Correspondence"));
         }
 #endif
     }
@@ -165,12 +208,12 @@ private:
 class SampleSpacingFunction
 {
 public:
-    SampleSpacingFunction(PolylineConstPtr poly)
-        : _values(vector<double>(poly->pts().size(), 0.), poly->pts().circular()), _maxSlope(1e10), _basePoly(poly)
+    SampleSpacingFunction(const PolylineView &poly)
+        : _maxSlope(1e10), _values(vector<double>(poly.numPts(), 0.), poly.isClosed() ? CIRCULAR : NOT_CIRCULAR)
     {
-        _lengths.resize(1 + poly->pts().endIdx(1), 0.);
+        _lengths.resize(1 + _values.endIdx(1), 0.);
         for(int i = 0; i < (int)_lengths.size(); ++i)
-            _lengths[i] = poly->idxToParam(i);
+            _lengths[i] = poly.idxToParam(i);
     }
 
     VectorC<double> &values() { return _values; }
@@ -211,37 +254,66 @@ public:
     }
 
     //Returns the maximum step we can take starting at s.  It's the side length of the largest square
-    //we can inscribe under the function plot with a corner at s.
-    double evalStep(double s)
+    //we can inscribe under the function plot with a corner at s.  The function is linear between
+    //points, so this walks the segments after s until the square's top edge runs into one.
+    double evalStep(double s) const
     {
         double maxStep = eval(s);
-        SampleSpacingFunction tr = trimmed(s, s + maxStep);
+        double length = _lengths.back();
+        double to = s + maxStep;
+        if(isClosed())
+        {
+            s = fmod(s, length);
+            if(s < 0.)
+                s += length;
+            to = s + min(maxStep, length);
+        }
+        else
+            to = min(to, length);
+
+        int idx = paramToIdx(s, NULL);
+        double offset = 0.; //added to _lengths after wrapping around a closed curve
+        double cur = s, curValue = maxStep;
 
         double out = 0;
         double minSoFar = maxStep;
-        for(int i = 0; i + 1 < tr._values.size(); ++i)
+        while(true)
         {
-            //consider the segment from i to i + 1
-            double len = tr._lengths[i + 1] - tr._lengths[i];
-            double r1 = tr._values[i], r2 = tr._values[i + 1];
+            //consider the segment from cur to next
+            bool last = _lengths[idx + 1] + offset >= to;
+            double next = last ? to : _lengths[idx + 1] + offset;
+            double nextValue = last ? eval(to) : _values.flatAt((idx + 1) % _values.size());
+            double len = next - cur;
 
             //check if we get this entire segment
-            if(min(minSoFar, r2) >= out + len)
+            if(min(minSoFar, nextValue) >= out + len)
             {
-                minSoFar = min(minSoFar, r2);
+                minSoFar = min(minSoFar, nextValue);
                 out += len;
-                continue;
             }
+            else
+            {
+                double maxFromBefore = minSoFar;
+                double curSlope = (nextValue - curValue) / (len + 1e-16);
+                double curYIntercept = curValue - curSlope * (cur - s);
+                double maxFromCurrent = curYIntercept / (1. - curSlope);
 
-            double maxFromBefore = minSoFar;
-            double curSlope = (r2 - r1) / (len + 1e-16);
-            double curYIntercept = r1 - curSlope * tr._lengths[i];
-            double maxFromCurrent = curYIntercept / (1. - curSlope);
+                return min(maxFromBefore, maxFromCurrent);
+            }
 
-            return min(maxFromBefore, maxFromCurrent);
-        }
+            if(last)
+                return minSoFar;
 
-        return minSoFar;
+            cur = next;
+            curValue = nextValue;
+            if(++idx + 1 == (int)_lengths.size())
+            {
+                if(!isClosed())
+                    return minSoFar;
+                idx = 0;
+                offset += length;
+            }
+        }
     }
 
     int paramToIdx(double param, double *outParam) const
@@ -252,18 +324,6 @@ public:
         return idx;
     }
 
-    SampleSpacingFunction trimmed(double from, double to)
-    {
-        //Trim the base polyline and evaluate the function on it.  Not the fastest way to do it, but it works
-        PolylineConstPtr trimmedPoly = _basePoly->trimmed(from, to);
-        SampleSpacingFunction out(trimmedPoly);
-
-        for(int i = 0; i < trimmedPoly->pts().size(); ++i)
-            out.values()[i] = eval(from + trimmedPoly->idxToParam(i));
-
-        return out;
-    }
-
     void draw()
     {
         char name[100];
@@ -271,9 +331,9 @@ public:
         ++cnt;
         sprintf(name, "Func %d", cnt);
         Vector2d offs(10, 20 + 50 * cnt);
-        Debugging::get()->drawLine(offs, offs + Vector2d(_lengths.back(), 0), Vector3d(0, 0, 0), name);
+        CORNU_DEBUG(drawLine(offs, offs + Vector2d(_lengths.back(), 0), Vector3d(0, 0, 0), name));
         for(int i = 0; i < _values.endIdx(1); ++i)
-            Debugging::get()->drawLine(offs + Vector2d(_lengths[i], -_values[i]), offs + Vector2d(_lengths[i + 1], -_values[i + 1]), Vector3d(1, 0, 0), name);
+            CORNU_DEBUG(drawLine(offs + Vector2d(_lengths[i], -_values[i]), offs + Vector2d(_lengths[i + 1], -_values[i + 1]), Vector3d(1, 0, 0), name));
 
         //draw the inscribed squares
         double param = 0;
@@ -281,9 +341,9 @@ public:
         {
             double step = evalStep(param);
             Vector2d corner = offs + Vector2d(param, 0);
-            Debugging::get()->drawLine(corner, corner + Vector2d(0, -step), Vector3d(0, 1, 0), name);
-            Debugging::get()->drawLine(corner + Vector2d(0, -step), corner + Vector2d(step, -step), Vector3d(0, 1, 0), name);
-            Debugging::get()->drawLine(corner + Vector2d(step, -step), corner + Vector2d(step, 0), Vector3d(0, 1, 0), name);
+            CORNU_DEBUG(drawLine(corner, corner + Vector2d(0, -step), Vector3d(0, 1, 0), name));
+            CORNU_DEBUG(drawLine(corner + Vector2d(0, -step), corner + Vector2d(step, -step), Vector3d(0, 1, 0), name));
+            CORNU_DEBUG(drawLine(corner + Vector2d(step, -step), corner + Vector2d(step, 0), Vector3d(0, 1, 0), name));
             param += step;
         }
     }
@@ -336,7 +396,6 @@ private:
     //organized like Polyline
     VectorC<double> _values;
     vector<double> _lengths;
-    PolylineConstPtr _basePoly;
 };
 
 class DefaultResampler : public BaseResampler
@@ -345,43 +404,48 @@ public:
     string name() const { return "Default"; }
 
 protected:
-    vector<double> _resample(const Fitter &fitter, PolylineConstPtr poly, bool denseNearStart = false, bool denseNearEnd = false)
+    vector<double> _resample(const Fitter &fitter, const PolylineView &poly, bool denseNearStart = false, bool denseNearEnd = false)
     {
         vector<double> outSamples;
-        const VectorC<Vector2d> pts = poly->pts();
         SampleSpacingFunction spacing(poly);
 
         //estimate the sample spacing from the curvatures
         double step = fitter.scaledParameter(Parameters::DENSE_SAMPLING_STEP);
         double regionSize = fitter.scaledParameter(Parameters::CURVATURE_ESTIMATE_REGION);
         double maxInterval = fitter.scaledParameter(Parameters::MAX_SAMPLING_INTERVAL);
-        double pointsPerCircle = fitter.params().get(Parameters::POINTS_PER_CIRCLE);
+        double pointsPerCircle = fitter.config().get(Parameters::POINTS_PER_CIRCLE);
         double arcFitterScale = 1. / fitter.scale(); //our ArcFitter is approximate and not scale-invariant, so we scale its input and output
 
-        for(int i = 0; i < pts.size(); ++i)
+        //The curvature at each point is estimated by fitting an arc to samples every step within regionSize of it.
+        //The samples are on a fixed grid, so as the region slides along the curve, each one is added and removed once.
+        SlidingArcFitter arcFitter(regionSize * arcFitterScale);
+        //the region has samples firstSample * step, ..., (endSample - 1) * step
+        int firstSample = poly.isClosed() ? (int)floor(-regionSize / step) + 1 : 0;
+        int endSample = firstSample;
+        Polyline::Cursor cursor = poly.cursor();
+        for(int i = 0; i < poly.numPts(); ++i)
         {
-            ArcFitter arcFitter;
-            //step forward
-            double startParam = poly->idxToParam(i);
-            for(double param = startParam; poly->isParamValid(param) && param < startParam + regionSize; param += step)
-                arcFitter.addPoint(poly->pos(param) * arcFitterScale);
-            //step backward
-            for(double param = startParam; poly->isParamValid(param) && param > startParam - regionSize; param -= step)
-                arcFitter.addPoint(poly->pos(param) * arcFitterScale);
-
-            double curvature = fabs(arcFitter.getCurve()->startCurvature()) * arcFitterScale;
+            double centerParam = poly.idxToParam(i);
+            if(arcFitter.size() == 0) //skip samples that would be removed right away
+                firstSample = endSample = max(endSample, (int)floor((centerParam - regionSize) / step) + 1);
+            for(; poly.isParamValid(endSample * step) && endSample * step < centerParam + regionSize; ++endSample)
+                arcFitter.pushBack(cursor.pos(endSample * step) * arcFitterScale);
+            for(; firstSample < endSample && firstSample * step <= centerParam - regionSize; ++firstSample)
+                arcFitter.popFront();
+
+            double curvature = arcFitter.curvatureMagnitude(poly.pt(i) * arcFitterScale) * arcFitterScale;
             spacing.values()[i] = TWOPI / max(pointsPerCircle * curvature, TWOPI / maxInterval);
-            if((i == 0 && denseNearStart) || ((i + 1) == pts.size() && denseNearEnd))
+            if((i == 0 && denseNearStart) || ((i + 1) == poly.numPts() && denseNearEnd))
                 spacing.values()[i] = 1;
         }
 
         //Make sure the sample spacing doesn't vary more than allowed
-        double maxSlope = fitter.params().get(Parameters::MAX_SAMPLE_RATE_SLOPE);
+        double maxSlope = fitter.config().get(Parameters::MAX_SAMPLE_RATE_SLOPE);
         spacing.enforceMaxSlope(maxSlope);
 
 #if RESAMPLING_DEBUG
         if(!spacing.selfTest())
-            Debugging::get()->printf("Error: spacing self-test failed");
+            CORNU_DEBUG(printf("Error: spacing self-test failed"));
 #endif
 
         //We need for the last sample to end precisely at the end of the curve.  This won't happen naturally,
@@ -395,7 +459,7 @@ protected:
             double step = spacing.evalStep(param);
             param += step;
             ++numPts;
-            if(param + step * 0.5 > poly->length())
+            if(param + step * 0.5 > poly.length())
                 break;
         }
 
@@ -404,10 +468,10 @@ protected:
         //It is guaranteed to be monotone--reducing the sampling spacing must reduce the last parameter.
         PiecewiseLinearMonotone pl(PiecewiseLinearMonotone::NEGATIVE);
 
-        double scale = poly->length() / param;
+        double scale = poly.length() / param;
         pl.add(1., scale);
 #if RESAMPLING_DEBUG
-        Debugging::get()->printf("Log scale error at 1 = %lf", log(scale));
+        CORNU_DEBUG(printf("Log scale error at 1 = %lf", log(scale)));
 #endif
 
         for(int iters = 0; iters < 3; ++iters) //three iterations have been sufficient for convergence
@@ -419,10 +483,10 @@ protected:
             for(int i = 0; i < numPts; ++i)
                 param += scaledSpacing.evalStep(param);
 
-            double y = poly->length() / param;
+            double y = poly.length() / param;
             pl.add(scale, y);
 #if RESAMPLING_DEBUG
-            Debugging::get()->printf("Log scale error at %lf = %lf", scale, log(y));
+            CORNU_DEBUG(printf("Log scale error at %lf = %lf", scale, log(y)));
 #endif
 
             //scale = pl.invert(1.);
@@ -445,12 +509,12 @@ protected:
 
 #if RESAMPLING_DEBUG
         //DBG:
-        Debugging::get()->printf("Log scale error Final = %lf", log(poly->length() / param));
+        CORNU_DEBUG(printf("Log scale error Final = %lf", log(poly.length() / param)));
         spacing.draw();
 #endif
 
-        if(!poly->isClosed())
-            outSamples.push_back(poly->length());
+        if(!poly.isClosed())
+            outSamples.push_back(poly.length());
 
         return outSamples;
     }
@@ -462,21 +526,26 @@ public:
     string name() const { return "Length"; }
 
 protected:
-    vector<double> _resample(const Fitter &fitter, PolylineConstPtr poly, bool denseNearStart = false, bool denseNearEnd = false)
+    vector<double> _resample(const Fitter &fitter, const PolylineView &poly, bool denseNearStart = false, bool denseNearEnd = false)
     {
         vector<double> outSamples;
-        int numPts = 2 + int(poly->length() / fitter.scaledParameter(Parameters::MAX_SAMPLING_INTERVAL));
+        int numPts = 2 + int(poly.length() / fitter.scaledParameter(Parameters::MAX_SAMPLING_INTERVAL));
 
         for(int i = 0; i < numPts; ++i)
         {
-            double param = double(i) / (poly->isClosed() ? numPts : numPts - 1);
-            outSamples.push_back(param * poly->length());
+            double param = double(i) / (poly.isClosed() ? numPts : numPts - 1);
+            outSamples.push_back(param * poly.length());
         }
 
         return outSamples;
     }
 };
 
+size_t AlgorithmOutput<RESAMPLING>::memoryBytes() const
+{
+    return vectorBytes(corners) + (output ? output->memoryBytes() : 0) + vectorBytes(parameters);
+}
+
 void Algorithm<RESAMPLING>::_initialize()
 {
     new DefaultResampler();
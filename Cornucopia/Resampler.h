@@ -32,6 +32,9 @@ CORNU_SMART_FORW_DECL(Polyline);
 template<>
 struct AlgorithmOutput<RESAMPLING> : public AlgorithmOutputBase
 {
+    //override
+    size_t memoryBytes() const;
+
     VectorC<bool> corners;
     PolylineConstPtr output;
     std::vector<double> parameters; //parameters[i] is the parameter in output of the original point with index i
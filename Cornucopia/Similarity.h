@@ -0,0 +1,73 @@
+/*--
+    Similarity.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef CORNUCOPIA_SIMILARITY_H_INCLUDED
+#define CORNUCOPIA_SIMILARITY_H_INCLUDED
+
+#include "defs.h"
+
+#include <Eigen/Core>
+#include <cmath>
+
+NAMESPACE_Cornu
+
+//A transformation that keeps shapes: p -> scale * R(angle) * p + translation, with scale > 0.  Primitives and
+//sequences can be moved by one without refitting (see CurvePrimitive::transform).
+class Similarity
+{
+public:
+    typedef Eigen::Vector2d Vec;
+
+    Similarity() : _scale(1.), _angle(0.), _cos(1.), _sin(0.), _translation(0., 0.) {} //the identity
+    Similarity(double scale, double angle, const Vec &translation)
+        : _scale(scale), _angle(angle), _cos(std::cos(angle)), _sin(std::sin(angle)), _translation(translation) {}
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    static Similarity translation(const Vec &translation) { return Similarity(1., 0., translation); }
+    static Similarity rotation(double angle, const Vec &center = Vec::Zero())
+    { return translation(center) * Similarity(1., angle, Vec::Zero()) * translation(-center); }
+    static Similarity scaling(double scale, const Vec &center = Vec::Zero())
+    { return translation(center) * Similarity(scale, 0., Vec::Zero()) * translation(-center); }
+
+    double scale() const { return _scale; }
+    double angle() const { return _angle; }
+    const Vec &translation() const { return _translation; }
+    bool isIdentity() const { return _scale == 1. && _angle == 0. && _translation.isZero(0.); }
+
+    Vec rotate(const Vec &v) const { return Vec(_cos * v[0] - _sin * v[1], _sin * v[0] + _cos * v[1]); }
+    Vec operator*(const Vec &p) const { return _scale * rotate(p) + _translation; }
+    //applies other first
+    Similarity operator*(const Similarity &other) const
+    { return Similarity(_scale * other._scale, _angle + other._angle, (*this) * other._translation); }
+    Similarity inverse() const
+    {
+        Similarity rotationBack(1. / _scale, -_angle, Vec::Zero());
+        return Similarity(rotationBack._scale, rotationBack._angle, -(rotationBack * _translation));
+    }
+
+private:
+    double _scale;
+    double _angle;
+    double _cos, _sin;
+    Vec _translation;
+};
+
+END_NAMESPACE_Cornu
+
+#endif //CORNUCOPIA_SIMILARITY_H_INCLUDED
@@ -20,45 +20,161 @@
 
 #include "SimpleAPI.h"
 #include "Cornucopia.h"
+#include "Parallel.h"
 
 using namespace std;
 using namespace Eigen;
 NAMESPACE_Cornu
 
-vector<BasicPrimitive> fit(const vector<Point> &points, const Parameters &parameters, bool *outClosed)
+static void _toBasicPrimitive(const CurvePrimitive &cur, BasicPrimitive &out)
 {
-    Fitter fitter;
-    fitter.setParams(parameters);
+    out.type = (BasicPrimitive::PrimitiveType)cur.getType();
+    out.start = Point(cur.startPos()[0], cur.startPos()[1]);
+    out.length = cur.length();
+    out.startAngle = cur.startAngle();
+    out.startCurvature = cur.startCurvature();
+    out.curvatureDerivative = 0;
+    if(cur.getType() == CurvePrimitive::CLOTHOID)
+        out.curvatureDerivative = cur.params()[CurvePrimitive::DCURVATURE];
+}
 
-    VectorC<Vector2d> pts((int)points.size(), NOT_CIRCULAR);
-    for(int i = 0; i < pts.size(); ++i)
-        pts[i] = Vector2d(points[i].x, points[i].y);
+//A Fitter taken from the ones the current thread keeps between fits.  A Fitter keeps the memory of its stage outputs
+//when it's reset (see Fitter::reset), and only reruns the stages parameters affect, so fitting with one again mostly
+//fills what the last fit left.  There's a list rather than a single Fitter per thread in case a fit calls fit again
+//(e.g., from a Debugging implementation).
+class _PooledFitter
+{
+public:
+    _PooledFitter()
+    {
+        vector<Fitter *> &pool = _pool().free;
+        if(pool.empty())
+        {
+            _fitter = new Fitter();
+            _pool().all.push_back(_fitter);
+        }
+        else
+        {
+            _fitter = pool.back();
+            pool.pop_back();
+        }
+    }
 
-    //pass it to the fitter and process it
-    fitter.setOriginalSketch(new Cornu::Polyline(pts));
-    fitter.run();
+    ~_PooledFitter()
+    {
+        _fitter->reset();
+        _fitter->setCache(FitCachePtr()); //so the pool doesn't keep the caller's cache alive
+        _pool().free.push_back(_fitter);
+    }
+
+    Fitter &operator*() const { return *_fitter; }
+    Fitter *operator->() const { return _fitter; }
+
+private:
+    struct _Pool
+    {
+        ~_Pool() { for(int i = 0; i < (int)all.size(); ++i) delete all[i]; }
+
+        vector<Fitter *> all;
+        vector<Fitter *> free;
+    };
+
+    static _Pool &_pool() { static thread_local _Pool pool; return pool; }
 
-    //process the output -- count the number of primitives of each type
-    PrimitiveSequenceConstPtr output = fitter.finalOutput();
+    Fitter *_fitter;
+};
 
+//the fit shared by the overloads of fit(...): passes the fit to output, unless it fails, and returns whether it didn't.
+//The output is read before the Fitter goes back to the pool, so the Fitter can reuse it for the next fit.
+template<typename Output>
+static bool _fit(const double *xy, size_t numPoints, size_t stride, const Parameters &parameters,
+                 const FitCachePtr &cache, bool *outClosed, const Output &output)
+{
     if(outClosed)
-        (*outClosed) = output->isClosed();
+        (*outClosed) = false;
+    if(numPoints < 2)
+        return false;
 
-    vector<BasicPrimitive> out(output->primitives().size());
+    _PooledFitter fitter;
+    fitter->setParams(parameters);
+    fitter->setCache(cache);
+
+    //pass it to the fitter and process it
+    fitter->setOriginalSketch(new Cornu::Polyline(xy, (int)numPoints, (int)stride));
+    fitter->run();
 
-    for(int i = 0; i < (int)out.size(); ++i)
+    PrimitiveSequenceConstPtr result = fitter->finalOutput();
+    if(!result) //the fit can fail, e.g., on degenerate input
+        return false;
+    if(outClosed)
+        (*outClosed) = result->isClosed();
+    output(*result);
+    return true;
+}
+
+vector<BasicPrimitive> fit(const vector<Point> &points, const Parameters &parameters, bool *outClosed, const FitCachePtr &cache)
+{
+    vector<BasicPrimitive> out;
+    //a Point is just its two coordinates, so the vector is read in place
+    _fit(points.empty() ? NULL : &points[0].x, points.size(), sizeof(Point) / sizeof(double), parameters, cache, outClosed,
+         [&out](const PrimitiveSequence &output)
+         {
+             out.resize(output.primitives().size());
+             for(int i = 0; i < (int)out.size(); ++i)
+                 _toBasicPrimitive(*output.primitives()[i], out[i]);
+         });
+
+    return out;
+}
+
+size_t fit(const double *xy, size_t numPoints, size_t stride, const Parameters &parameters,
+           BasicPrimitive *out, size_t outCapacity, bool *outClosed, const FitCachePtr &cache)
+{
+    size_t size = 0;
+    _fit(xy, numPoints, stride, parameters, cache, outClosed,
+         [&size, out, outCapacity](const PrimitiveSequence &output)
+         {
+             size = output.primitives().size();
+             for(size_t i = 0; i < size && i < outCapacity; ++i)
+                 _toBasicPrimitive(*output.primitives()[(int)i], out[i]);
+         });
+
+    return size;
+}
+
+class _BatchFitBody
+{
+public:
+    _BatchFitBody(const vector<vector<Point> > &strokes, const Parameters &parameters, const FitCachePtr &cache,
+                  vector<vector<BasicPrimitive> > &out, vector<char> &closed)
+        : _strokes(strokes), _parameters(parameters), _cache(cache), _out(out), _closed(closed) {}
+
+    void operator()(int i) const
     {
-        CurvePrimitiveConstPtr cur = output->primitives()[i];
-        out[i].type = (BasicPrimitive::PrimitiveType)cur->getType();
-        out[i].start = Point(cur->startPos()[0], cur->startPos()[1]);
-        out[i].length = cur->length();
-        out[i].startAngle = cur->startAngle();
-        out[i].startCurvature = cur->startCurvature();
-        out[i].curvatureDerivative = 0;
-        if(cur->getType() == CurvePrimitive::CLOTHOID)
-            out[i].curvatureDerivative = cur->params()[CurvePrimitive::DCURVATURE];
+        bool closed = false;
+        _out[i] = fit(_strokes[i], _parameters, &closed, _cache);
+        _closed[i] = closed;
     }
 
+private:
+    const vector<vector<Point> > &_strokes;
+    const Parameters &_parameters;
+    const FitCachePtr &_cache;
+    vector<vector<BasicPrimitive> > &_out;
+    vector<char> &_closed; //not vector<bool> so that different threads can write neighboring elements
+};
+
+vector<vector<BasicPrimitive> > fitBatch(const vector<vector<Point> > &strokes, const Parameters &parameters,
+                                         vector<bool> *outClosed, int numThreads, const FitCachePtr &cache)
+{
+    vector<vector<BasicPrimitive> > out(strokes.size());
+    vector<char> closed(strokes.size(), 0);
+
+    parallelFor((int)strokes.size(), _BatchFitBody(strokes, parameters, cache, out, closed), numThreads);
+
+    if(outClosed)
+        outClosed->assign(closed.begin(), closed.end());
+
     return out;
 }
 
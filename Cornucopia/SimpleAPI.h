@@ -24,11 +24,17 @@
 //The point of this file is to provide a minimalistic API without dependencies on Eigen or anything else.
 //To use Cornucopia, you only need to include this file, construct a vector of Points, Parameters, and run the fit(...) function.
 
+#include "defs.h"
+#include "smart_ptr.h"
 #include "Parameters.h"
 
+#include <cstddef>
+
 namespace Cornu
 {
 
+CORNU_SMART_FORW_DECL(FitCache); //see FitCache.h
+
 struct Point //basic point class
 {
     Point() : x(0), y(0) {}
@@ -60,8 +66,28 @@ struct BasicPrimitive
 };
 
 //The basic API function: takes a vector of points and a Parameters object (see Parameters.h)
-//and returns a vector of primitives and (optionally) whether the curve is closed
-std::vector<BasicPrimitive> fit(const std::vector<Point> &points, const Parameters &parameters, bool *outClosed = NULL);
+//and returns a vector of primitives and (optionally) whether the curve is closed.
+//An optional cache returns the earlier result for a stroke fitted before.
+//Each thread keeps the fitters it fits with between calls, so fitting many strokes reuses their memory.
+std::vector<BasicPrimitive> fit(const std::vector<Point> &points, const Parameters &parameters, bool *outClosed = NULL,
+                                const FitCachePtr &cache = FitCachePtr());
+
+//The same fit, for callers (e.g., C or Python bindings) that keep the points and the primitives in their own buffers,
+//so nothing is copied in between: point i is at (xy[i * stride], xy[i * stride + 1]), and the primitives are written
+//to out, which has room for outCapacity of them.  Returns the number of primitives in the fit (0 if it fails or
+//there are fewer than two points).  If that's more than outCapacity, only the first outCapacity are written: a caller
+//who can't guess the size can ask with outCapacity = 0 and call again with a big enough buffer (with a cache, the
+//second call doesn't fit again).
+size_t fit(const double *xy, size_t numPoints, size_t stride, const Parameters &parameters,
+           BasicPrimitive *out, size_t outCapacity, bool *outClosed = NULL, const FitCachePtr &cache = FitCachePtr());
+
+//Fits many independent strokes with the same parameters, spreading them over numThreads threads
+//(0 means one per core).  The results (and optionally closedness) are returned in input order and are
+//identical to calling fit(...) on each stroke.  Debugging output from the worker threads is discarded.
+//The threads share the cache, if there is one.
+std::vector<std::vector<BasicPrimitive> > fitBatch(const std::vector<std::vector<Point> > &strokes, const Parameters &parameters,
+                                                   std::vector<bool> *outClosed = NULL, int numThreads = 0,
+                                                   const FitCachePtr &cache = FitCachePtr());
 
 struct BasicBezier
 {
@@ -0,0 +1,134 @@
+/*--
+    SimpleStrokeFitter.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SimpleStrokeFitter.h"
+#include "Fitter.h"
+#include "Preprocessing.h"
+#include "Oversketcher.h"
+#include "Resampler.h"
+#include "ErrorComputer.h"
+#include "PrimitiveFitter.h"
+#include "PrimitiveFitUtils.h"
+#include "GraphConstructor.h"
+#include "PathFinder.h"
+#include "TwoCurveCombine.h"
+#include "Polyline.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+using namespace Eigen;
+NAMESPACE_Cornu
+
+typedef chrono::steady_clock Clock;
+
+static long long nanosecondsSince(Clock::time_point start)
+{
+    return chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+bool SimpleStrokeFitter::run(Fitter &fitter)
+{
+    const FitConfig &config = fitter.config();
+    if(config.get(Parameters::FAST_SIMPLE_STROKES) < 0.5 || fitter.edgeCostModel())
+        return false;
+    smart_ptr<const AlgorithmOutput<OVERSKETCHING> > osOutput = fitter.output<OVERSKETCHING>();
+    if(fitter.output<CURVE_CLOSING>()->closed || osOutput->startCurve || osOutput->endCurve)
+        return false;
+
+    Clock::time_point start = Clock::now();
+    const VectorC<Vector2d> &pts = fitter.output<RESAMPLING>()->output->pts();
+    const VectorC<bool> &corners = fitter.output<RESAMPLING>()->corners;
+    int n = (int)pts.size();
+    for(int i = 1; i < n - 1; ++i)
+    {
+        if(corners[i])
+            return false;
+    }
+
+    //the bound on the cost of longer paths needs the costs it's made of to be nonnegative
+    double minCurveCost = Parameters::infinity, minContinuityCost = Parameters::infinity;
+    for(int i = 0; i < 3; ++i)
+    {
+        minCurveCost = min(minCurveCost, config.get(Parameters::ParameterType(i + Parameters::LINE_COST)));
+        minContinuityCost = min(minContinuityCost, config.get(Parameters::ParameterType(i + Parameters::G0_COST)));
+    }
+    if(minCurveCost < 0. || minContinuityCost < 0.)
+        return false;
+
+    ErrorComputerConstPtr errorComputer = fitter.output<ERROR_COMPUTER>()->errorComputer;
+    double errorThreshold = fitter.scaledParameter(Parameters::ERROR_THRESHOLD);
+    LineFitter lineFitter;
+    ArcFitter arcFitter;
+    ClothoidFitter clothoidFitter;
+    FitterBase *fitters[3] = { &lineFitter, &arcFitter, &clothoidFitter };
+
+    smart_ptr<AlgorithmOutput<PRIMITIVE_FITTING> > primitives = new AlgorithmOutput<PRIMITIVE_FITTING>();
+    for(int type = 0; type <= 2; ++type) //iterate over lines, arcs, clothoids
+    {
+        if(config.get(Parameters::ParameterType(Parameters::LINE_COST + type)) >= Parameters::infinity || n < 2 + type)
+            continue;
+        for(int i = 0; i < n; ++i)
+            fitters[type]->addPoint(pts[i]);
+
+        FitPrimitive fit;
+        fit.curve = fitters[type]->getPrimitive();
+        fit.startIdx = 0;
+        fit.endIdx = n - 1;
+        fit.numPts = n;
+        fit.startCurvSign = (fit.curve->startCurvature() >= 0) ? 1 : -1;
+        fit.endCurvSign = (fit.curve->endCurvature() >= 0) ? 1 : -1;
+        fit.error = errorComputer->computeErrorForCost(fit.curve, 0, n - 1, errorThreshold * errorThreshold);
+        if(fit.error <= errorThreshold * errorThreshold)
+            primitives->primitives.push_back(fit);
+    }
+    if(primitives->primitives.empty())
+        return false;
+    for(int i = 0; i < (int)primitives->primitives.size(); ++i)
+        primitives->values.push_back(PrimitiveValue::make(*primitives->primitives[i].curve));
+    fitter._outputs[PRIMITIVE_FITTING] = primitives;
+    fitter._stats.stageNanoseconds[PRIMITIVE_FITTING] += nanosecondsSince(start);
+
+    //every candidate covers the whole curve, so the graph has just their dummy edges
+    start = Clock::now();
+    fitter._runStage(GRAPH_CONSTRUCTION);
+    fitter._stats.stageNanoseconds[GRAPH_CONSTRUCTION] += nanosecondsSince(start);
+    smart_ptr<const AlgorithmOutput<GRAPH_CONSTRUCTION> > graph = fitter.output<GRAPH_CONSTRUCTION>();
+    int best = -1;
+    for(int e = 0; e < (int)graph->edges.size(); ++e)
+    {
+        if(graph->edges[e].continuity < 0 && (best < 0 || graph->edges[e].cost < graph->edges[best].cost))
+            best = e;
+    }
+    if(best < 0 || graph->edges[best].cost > 2. * minCurveCost + minContinuityCost)
+    {
+        fitter._clearBefore(PRIMITIVE_FITTING);
+        return false;
+    }
+
+    smart_ptr<AlgorithmOutput<PATH_FINDING> > path = new AlgorithmOutput<PATH_FINDING>();
+    path->path.push_back(best);
+    path->combinations.push_back(Combination());
+    fitter._outputs[PATH_FINDING] = path;
+    return true;
+}
+
+END_NAMESPACE_Cornu
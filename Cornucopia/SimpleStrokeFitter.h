@@ -0,0 +1,47 @@
+/*--
+    SimpleStrokeFitter.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_SIMPLESTROKEFITTER_H_INCLUDED
+#define CORNUCOPIA_SIMPLESTROKEFITTER_H_INCLUDED
+
+#include "defs.h"
+
+NAMESPACE_Cornu
+
+class Fitter;
+
+//For Parameters::FAST_SIMPLE_STROKES: many strokes are a single line, arc or clothoid, and for those most of
+//the time goes into fitting the candidates and searching the graph of a path that ends up being just one of
+//them.  Before primitive fitting, this fits one primitive of each type over the whole (open, corner-free)
+//curve.  The candidates that are within the error threshold get a graph of their own.  The cheapest one is
+//taken as the path if it costs no more than any path of two or more primitives could, which is at least
+//two curve costs and a continuity cost.  Otherwise, the curve is fitted as usual.
+class SimpleStrokeFitter
+{
+public:
+    //Called by the fitter before primitive fitting (with the outputs of the stages before it): if the curve is
+    //fitted as one primitive, fills in the outputs and statistics of the stages from primitive fitting through
+    //path finding and returns true.  Returns false, leaving those outputs unset, otherwise.
+    static bool run(Fitter &fitter);
+};
+
+END_NAMESPACE_Cornu
+
+#endif //CORNUCOPIA_SIMPLESTROKEFITTER_H_INCLUDED
@@ -0,0 +1,374 @@
+/*--
+    SketchFile.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SketchFile.h"
+#include "Algorithm.h"
+#include "Polyline.h"
+#include "PrimitiveSequence.h"
+#include "Line.h"
+#include "Arc.h"
+#include "Clothoid.h"
+
+#include <ostream>
+#include <fstream>
+#include <map>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace Eigen;
+NAMESPACE_Cornu
+
+static const char sketchFileMagic[8] = { 'C', 'O', 'R', 'N', 'U', 'S', 'K', 'F' };
+static const uint32_t sketchFileVersion = 1;
+static const uint32_t sketchFileByteOrder = 0x01020304;
+
+static uint64_t parameterSetSize(uint32_t numParameters, uint32_t numStages)
+{
+    return (8 * (uint64_t)numParameters + 4 * (uint64_t)numStages + 7) / 8 * 8;
+}
+
+//Whether count records of recordSize bytes fit between start and end, which bound a section, and if so, where
+//they end.  Nothing is multiplied before the count is bounded, so huge counts and offsets in a damaged (or
+//malicious) file can't wrap around.
+static bool sectionFits(uint64_t start, uint64_t count, uint64_t recordSize, uint64_t end, uint64_t &outEnd)
+{
+    if(start > end || (recordSize == 0 ? count > 0 : count > (end - start) / recordSize))
+        return false;
+    outEnd = start + count * recordSize;
+    return true;
+}
+
+//whether [first, first + num) is in [0, total)
+static bool rangeFits(uint64_t first, uint64_t num, uint64_t total)
+{
+    return first <= total && total - first >= num;
+}
+
+static void writePadding(ostream &out, uint64_t &offset)
+{
+    static const char zeros[8] = { 0 };
+    out.write(zeros, (8 - offset % 8) % 8);
+    offset += (8 - offset % 8) % 8;
+}
+
+bool writeSketchFile(ostream &out, const vector<SketchFileEntry> &sketches)
+{
+    const vector<Parameters::Parameter> &paramDescs = Parameters::parameters();
+    SketchFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, sketchFileMagic, sizeof(sketchFileMagic));
+    header.version = sketchFileVersion;
+    header.byteOrder = sketchFileByteOrder;
+    header.numSketches = (uint32_t)sketches.size();
+    header.numParameters = (uint32_t)paramDescs.size();
+    header.numStages = NUM_ALGORITHM_STAGES;
+
+    //the sketch records, with parameter sets shared between sketches that have the same ones
+    vector<SketchFileSketch> records(sketches.size());
+    vector<const Parameters *> parameterSets;
+    map<vector<double>, int> setIndices;
+    for(int i = 0; i < (int)sketches.size(); ++i)
+    {
+        const SketchFileEntry &entry = sketches[i];
+        SketchFileSketch &record = records[i];
+        memset(&record, 0, sizeof(record));
+
+        record.firstPoint = header.numPoints;
+        record.numPoints = (uint32_t)entry.pts->pts().size();
+        header.numPoints += record.numPoints;
+
+        record.firstPrimitive = header.numPrimitives;
+        if(entry.curve)
+        {
+            record.numPrimitives = (uint32_t)entry.curve->primitives().size();
+            record.flags |= SketchFileSketch::HAS_CURVE;
+            if(entry.curve->isClosed())
+                record.flags |= SketchFileSketch::CLOSED_CURVE;
+        }
+        header.numPrimitives += record.numPrimitives;
+        record.oversketch = entry.oversketch;
+
+        vector<double> key;
+        for(int j = 0; j < (int)paramDescs.size(); ++j)
+            key.push_back(entry.params.get(paramDescs[j].type));
+        for(int j = 0; j < NUM_ALGORITHM_STAGES; ++j)
+            key.push_back(entry.params.getAlgorithm(j));
+        map<vector<double>, int>::iterator it = setIndices.find(key);
+        if(it == setIndices.end())
+        {
+            it = setIndices.insert(make_pair(key, (int)parameterSets.size())).first;
+            parameterSets.push_back(&entry.params);
+        }
+        record.parameterSet = it->second;
+    }
+    header.numParameterSets = (uint32_t)parameterSets.size();
+
+    header.sketchesOffset = sizeof(SketchFileHeader);
+    header.parameterSetsOffset = header.sketchesOffset + sizeof(SketchFileSketch) * header.numSketches;
+    header.pointsOffset = header.parameterSetsOffset + parameterSetSize(header.numParameters, header.numStages) * header.numParameterSets;
+    header.primitivesOffset = header.pointsOffset + 16 * header.numPoints;
+    header.namesOffset = header.primitivesOffset + sizeof(SketchFilePrimitive) * header.numPrimitives;
+    header.fileSize = header.namesOffset;
+    for(int j = 0; j < (int)paramDescs.size(); ++j)
+        header.fileSize += paramDescs[j].typeName.size() + 1;
+
+    out.write((const char *)&header, sizeof(header));
+    if(!records.empty())
+        out.write((const char *)&(records[0]), sizeof(SketchFileSketch) * records.size());
+
+    uint64_t offset = header.parameterSetsOffset;
+    for(int i = 0; i < (int)parameterSets.size(); ++i)
+    {
+        for(int j = 0; j < (int)paramDescs.size(); ++j)
+        {
+            double value = parameterSets[i]->get(paramDescs[j].type);
+            out.write((const char *)&value, sizeof(value));
+        }
+        for(int j = 0; j < NUM_ALGORITHM_STAGES; ++j)
+        {
+            int32_t algorithm = parameterSets[i]->getAlgorithm(j);
+            out.write((const char *)&algorithm, sizeof(algorithm));
+        }
+        offset += 8 * paramDescs.size() + 4 * NUM_ALGORITHM_STAGES;
+        writePadding(out, offset);
+    }
+
+    for(int i = 0; i < (int)sketches.size(); ++i)
+    {
+        const VectorC<Vector2d> &pts = sketches[i].pts->pts();
+        for(int j = 0; j < pts.size(); ++j)
+            out.write((const char *)pts[j].data(), 2 * sizeof(double));
+    }
+
+    for(int i = 0; i < (int)sketches.size(); ++i)
+    {
+        if(!sketches[i].curve)
+            continue;
+
+        const VectorC<CurvePrimitiveConstPtr> &primitives = sketches[i].curve->primitives();
+        for(int j = 0; j < primitives.size(); ++j)
+        {
+            SketchFilePrimitive record;
+            memset(&record, 0, sizeof(record));
+            record.type = primitives[j]->getType();
+            const CurvePrimitive::ParamVec &params = primitives[j]->params();
+            for(int k = 0; k < (int)params.size() && k < 6; ++k)
+                record.params[k] = params[k];
+            out.write((const char *)&record, sizeof(record));
+        }
+    }
+
+    for(int j = 0; j < (int)paramDescs.size(); ++j)
+        out.write(paramDescs[j].typeName.c_str(), paramDescs[j].typeName.size() + 1);
+
+    return !out.fail();
+}
+
+SketchFileView::SketchFileView(const void *data, size_t size)
+    : _header(NULL), _sketches(NULL), _points(NULL), _primitives(NULL)
+{
+    const char *bytes = (const char *)data;
+    const SketchFileHeader *header = (const SketchFileHeader *)data;
+    if(size < sizeof(SketchFileHeader) || ((size_t)bytes) % 8 != 0)
+        return;
+    if(memcmp(header->magic, sketchFileMagic, sizeof(sketchFileMagic)) != 0 || header->version != sketchFileVersion ||
+       header->byteOrder != sketchFileByteOrder || header->fileSize > size)
+        return;
+
+    //the sections must be in order and fit
+    uint64_t setSize = parameterSetSize(header->numParameters, header->numStages);
+    uint64_t end = header->fileSize, sectionEnd;
+    if(header->sketchesOffset < sizeof(SketchFileHeader) ||
+       !sectionFits(header->sketchesOffset, header->numSketches, sizeof(SketchFileSketch), end, sectionEnd) ||
+       header->parameterSetsOffset < sectionEnd ||
+       !sectionFits(header->parameterSetsOffset, header->numParameterSets, setSize, end, sectionEnd) ||
+       header->pointsOffset < sectionEnd ||
+       !sectionFits(header->pointsOffset, header->numPoints, 16, end, sectionEnd) ||
+       header->primitivesOffset < sectionEnd ||
+       !sectionFits(header->primitivesOffset, header->numPrimitives, sizeof(SketchFilePrimitive), end, sectionEnd) ||
+       header->namesOffset < sectionEnd ||
+       !sectionFits(header->namesOffset, header->numParameters, 1, end, sectionEnd) || //each name takes at least a byte
+       (header->sketchesOffset | header->parameterSetsOffset | header->pointsOffset | header->primitivesOffset) % 8 != 0)
+        return;
+
+    const SketchFileSketch *sketches = (const SketchFileSketch *)(bytes + header->sketchesOffset);
+    for(uint32_t i = 0; i < header->numSketches; ++i)
+    {
+        const SketchFileSketch &sketch = sketches[i];
+        if(!rangeFits(sketch.firstPoint, sketch.numPoints, header->numPoints) || sketch.numPoints == 0 ||
+           !rangeFits(sketch.firstPrimitive, sketch.numPrimitives, header->numPrimitives) ||
+           sketch.parameterSet >= header->numParameterSets ||
+           sketch.oversketch < -1 || sketch.oversketch >= (int64_t)header->numSketches)
+            return;
+        if((sketch.flags & SketchFileSketch::HAS_CURVE) && sketch.numPrimitives == 0)
+            return;
+    }
+
+    const SketchFilePrimitive *primitives = (const SketchFilePrimitive *)(bytes + header->primitivesOffset);
+    for(uint64_t i = 0; i < header->numPrimitives; ++i)
+        if(primitives[i].type > CurvePrimitive::CLOTHOID)
+            return;
+
+    //match the parameters by name
+    const vector<Parameters::Parameter> &paramDescs = Parameters::parameters();
+    vector<int> paramTypes(header->numParameters, -1);
+    const char *name = bytes + header->namesOffset, *namesEnd = bytes + header->fileSize;
+    for(uint32_t j = 0; j < header->numParameters; ++j)
+    {
+        const char *nameEnd = (const char *)memchr(name, 0, namesEnd - name);
+        if(nameEnd == NULL)
+            return;
+        for(int k = 0; k < (int)paramDescs.size(); ++k)
+            if(paramDescs[k].typeName == name)
+                paramTypes[j] = paramDescs[k].type;
+        name = nameEnd + 1;
+    }
+
+    _parameterSets.resize(header->numParameterSets);
+    for(uint32_t i = 0; i < header->numParameterSets; ++i)
+    {
+        const char *set = bytes + header->parameterSetsOffset + setSize * i;
+        const double *values = (const double *)set;
+        const int32_t *algorithms = (const int32_t *)(set + 8 * header->numParameters);
+        for(uint32_t j = 0; j < header->numParameters; ++j)
+            if(paramTypes[j] >= 0)
+                _parameterSets[i].set((Parameters::ParameterType)paramTypes[j], values[j]);
+        for(uint32_t j = 0; j < header->numStages && j < (uint32_t)NUM_ALGORITHM_STAGES; ++j)
+            if(algorithms[j] >= 0 && algorithms[j] < AlgorithmBase::numAlgorithmsForStage((AlgorithmStage)j))
+                _parameterSets[i].setAlgorithm(j, algorithms[j]);
+    }
+
+    _header = header;
+    _sketches = sketches;
+    _points = (const double *)(bytes + header->pointsOffset);
+    _primitives = primitives;
+}
+
+PolylinePtr SketchFileView::polyline(int i) const
+{
+    const double *pts = points(i);
+    VectorC<Vector2d> out(_sketches[i].numPoints, NOT_CIRCULAR);
+    for(int j = 0; j < out.size(); ++j)
+        out[j] = Vector2d(pts[2 * j], pts[2 * j + 1]);
+    return new Polyline(out);
+}
+
+PrimitiveSequencePtr SketchFileView::curve(int i) const
+{
+    const SketchFileSketch &sketch = _sketches[i];
+    if(!(sketch.flags & SketchFileSketch::HAS_CURVE))
+        return PrimitiveSequencePtr();
+
+    VectorC<CurvePrimitiveConstPtr> primitives(sketch.numPrimitives, (sketch.flags & SketchFileSketch::CLOSED_CURVE) ? CIRCULAR : NOT_CIRCULAR);
+    for(int j = 0; j < primitives.size(); ++j)
+    {
+        const SketchFilePrimitive &record = _primitives[sketch.firstPrimitive + j];
+        CurvePrimitivePtr primitive;
+        int numParams = 6;
+        if(record.type == CurvePrimitive::LINE)
+        {
+            primitive = new Line();
+            numParams = 4;
+        }
+        else if(record.type == CurvePrimitive::ARC)
+        {
+            primitive = new Arc();
+            numParams = 5;
+        }
+        else
+            primitive = new Clothoid();
+
+        CurvePrimitive::ParamVec params(numParams);
+        for(int k = 0; k < numParams; ++k)
+            params[k] = record.params[k];
+        primitive->setParams(params);
+        primitives[j] = primitive;
+    }
+
+    return new PrimitiveSequence(primitives);
+}
+
+SketchFileEntry SketchFileView::entry(int i) const
+{
+    SketchFileEntry out;
+    out.pts = polyline(i);
+    out.params = parameters(i);
+    out.curve = curve(i);
+    out.oversketch = _sketches[i].oversketch;
+    return out;
+}
+
+MappedFile::MappedFile(const string &fileName)
+    : _data(NULL), _size(0), _mapped(false)
+{
+#ifndef _WIN32
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if(fd < 0)
+        return;
+    struct stat st;
+    if(fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data != MAP_FAILED)
+        {
+            _data = data;
+            _size = (size_t)st.st_size;
+            _mapped = true;
+        }
+    }
+    close(fd);
+#else
+    ifstream in(fileName.c_str(), ios::binary);
+    in.seekg(0, ios::end);
+    streamoff size = in.tellg();
+    if(!in || size <= 0)
+        return;
+    in.seekg(0, ios::beg);
+    _data = new double[((size_t)size + 7) / 8]; //doubles, so the data is 8-byte aligned
+    _size = (size_t)size;
+    if(!in.read((char *)_data, size))
+    {
+        delete[] (double *)_data;
+        _data = NULL;
+        _size = 0;
+    }
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    if(!_data)
+        return;
+#ifndef _WIN32
+    if(_mapped)
+        munmap(_data, _size);
+#endif
+    if(!_mapped)
+        delete[] (double *)_data;
+}
+
+END_NAMESPACE_Cornu
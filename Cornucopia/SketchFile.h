@@ -0,0 +1,158 @@
+/*--
+    SketchFile.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_SKETCHFILE_H_INCLUDED
+#define CORNUCOPIA_SKETCHFILE_H_INCLUDED
+
+#include "defs.h"
+#include "Parameters.h"
+#include "smart_ptr.h"
+
+#include <stdint.h>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+NAMESPACE_Cornu
+
+CORNU_SMART_FORW_DECL(Polyline);
+CORNU_SMART_FORW_DECL(PrimitiveSequence);
+
+/*
+    A binary format for sketches: the points, the parameters they're fitted with, and optionally the fitted
+    curves.  Everything is in flat arrays of fixed-size records at offsets (multiples of 8) given in the
+    header, so a file can be memory mapped and read in place.  The numbers are in the byte order of the
+    machine that wrote the file, and readers reject files with the other byte order.  Sketches that share
+    parameters share one parameter set.
+
+    Layout, in this order after the header:
+      sketches       numSketches SketchFileSketch records
+      parameter sets numParameterSets times (numParameters doubles, then numStages int32's, padded to 8 bytes)
+      points         numPoints x, y pairs of doubles
+      primitives     numPrimitives SketchFilePrimitive records
+      names          numParameters zero-terminated parameter names (Parameters::Parameter::typeName), so the
+                     parameters are found by name even if they are renumbered later
+*/
+struct SketchFileHeader
+{
+    char magic[8]; //"CORNUSKF"
+    uint32_t version;
+    uint32_t byteOrder; //0x01020304 as written
+    uint32_t numSketches;
+    uint32_t numParameterSets;
+    uint32_t numParameters;
+    uint32_t numStages;
+    uint64_t numPoints;
+    uint64_t numPrimitives;
+    uint64_t sketchesOffset;
+    uint64_t parameterSetsOffset;
+    uint64_t pointsOffset;
+    uint64_t primitivesOffset;
+    uint64_t namesOffset;
+    uint64_t fileSize;
+};
+
+struct SketchFileSketch
+{
+    enum Flags { CLOSED_CURVE = 1, HAS_CURVE = 2 };
+
+    uint64_t firstPoint;
+    uint64_t firstPrimitive;
+    uint32_t numPoints;
+    uint32_t numPrimitives;
+    int32_t oversketch; //index of the sketch this one oversketches or -1
+    uint32_t parameterSet;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+struct SketchFilePrimitive
+{
+    uint32_t type; //CurvePrimitive::PrimitiveType
+    uint32_t reserved;
+    double params[6]; //CurvePrimitive::params(), zero past the ones the type has
+};
+
+//A sketch for writing and the result of reading one
+struct SketchFileEntry
+{
+    SketchFileEntry() : oversketch(-1) {}
+
+    PolylineConstPtr pts;
+    Parameters params;
+    PrimitiveSequenceConstPtr curve; //may be NULL
+    int oversketch;
+};
+
+//Returns false if the stream fails
+bool writeSketchFile(std::ostream &out, const std::vector<SketchFileEntry> &sketches);
+
+//Reads a sketch file in memory (for example, memory mapped) in place.  The data must be 8-byte aligned and
+//stay valid while the view is used.  Construction checks the header and the sketch records, which is quick,
+//and the accessors just index into the data.
+class SketchFileView
+{
+public:
+    SketchFileView(const void *data, size_t size);
+
+    bool isValid() const { return _header != NULL; }
+
+    int numSketches() const { return (int)_header->numSketches; }
+    const SketchFileSketch &sketch(int i) const { return _sketches[i]; }
+    const double *points(int i) const { return _points + 2 * _sketches[i].firstPoint; } //numPoints interleaved x, y pairs
+    const SketchFilePrimitive *primitives(int i) const { return _primitives + _sketches[i].firstPrimitive; }
+
+    //building objects from the records
+    PolylinePtr polyline(int i) const;
+    PrimitiveSequencePtr curve(int i) const; //NULL if the sketch has no curve
+    Parameters parameters(int i) const { return _parameterSets[_sketches[i].parameterSet]; }
+    SketchFileEntry entry(int i) const;
+
+private:
+    const SketchFileHeader *_header;
+    const SketchFileSketch *_sketches;
+    const double *_points;
+    const SketchFilePrimitive *_primitives;
+    std::vector<Parameters> _parameterSets; //decoded once, since there are usually few
+};
+
+//A read-only file in memory, memory mapped where available
+class MappedFile
+{
+public:
+    MappedFile(const std::string &fileName);
+    ~MappedFile();
+
+    bool isOpen() const { return _data != NULL; }
+    const void *data() const { return _data; }
+    size_t size() const { return _size; }
+
+private:
+    MappedFile(const MappedFile &); //not copyable
+    MappedFile &operator=(const MappedFile &);
+
+    void *_data;
+    size_t _size;
+    bool _mapped; //otherwise _data was allocated and read
+};
+
+END_NAMESPACE_Cornu
+
+#endif //CORNUCOPIA_SKETCHFILE_H_INCLUDED
@@ -26,80 +26,148 @@ using namespace std;
 using namespace Eigen;
 NAMESPACE_Cornu
 
+LSWorkspace::~LSWorkspace()
+{
+    for(int i = 0; i < (int)_free.size(); ++i)
+        delete _free[i];
+}
+
+LSWorkspace &LSWorkspace::current()
+{
+    static thread_local LSWorkspace workspace;
+    return workspace;
+}
+
+void LSWorkspace::give(LSEvalData *data)
+{
+    if((int)_free.size() >= maxFree)
+    {
+        delete _free.front(); //the least recently given
+        _free.erase(_free.begin());
+    }
+    _free.push_back(data);
+}
+
 LSSolver::LSSolver(LSProblem *problem, const vector<LSBoxConstraint> &constraints)
-: _problem(problem), _constraints(constraints), _damping(1.), _maxIter(100),
-  _increaseDampingAfter(0), _dampingIncreaseFactor(1.)
+: LSSolverBase<LSSolver>(problem, constraints), _stepControl(HALVING)
 {
 };
 
 VectorXd LSSolver::solve(const VectorXd &guess)
 {
+    if(_stepControl == TRUST_REGION)
+        return _solveTrustRegion(guess);
+    return _solveHalving(guess, "LSSolver::solve");
+}
+
+//In solve, every halving of a step is an evaluation, and the evaluation of the point that a step lands on is
+//done again at the start of the next iteration.  Here the damping does the job of a trust region radius: a step
+//that increases the error is solved for again from the same evaluation (reusing its Jacobian) with the damping
+//raised, which also shortens it and turns it toward the gradient, and the evaluation of an accepted point is the
+//next iteration's.  So every trial costs one evaluation.  After an accepted step, the damping comes back down,
+//but not below the default damping, which still grows after setIncreaseDampingAfter iterations.  As in solve, a
+//step shorter than 1e-4 is taken even if it increases the error (a problem whose error is only its constraint
+//violation needs those to make progress on the rest once the constraints are met).
+VectorXd LSSolver::_solveTrustRegion(const VectorXd &guess)
+{
+    const double dampingUp = 4., dampingDown = 0.5;
+    const int maxTrials = 12;
+
+    TraceScope trace("LSSolver::solve");
     VectorXd best;
     double bestError = 1e100;
     VectorXd x = guess;
     LSEvalData *evalData = _problem->createEvalData();
+    LSEvalData *trialData = _problem->createEvalData();
 
     set<LSBoxConstraint> activeSet = _clamp(x);
+    _problem->eval(x, evalData);
+    CORNU_COUNT(LS_EVALUATIONS, 1);
+    double error = evalData->error();
+    double minDamping = _damping, damping = _damping;
 
-    VectorXd delta;
+    VectorXd delta, trial;
     int iter;
     for(iter = 0; iter < _maxIter; ++iter)
     {
-        if(iter > _increaseDampingAfter)
-            _damping *= _dampingIncreaseFactor;
-        _problem->eval(x, evalData);
+        if(_cancellationToken && _cancellationToken->isCancelled())
+            break;
+        if(iter > _increaseDampingAfter && _dampingIncreaseFactor != 1.)
+        {
+            minDamping *= _dampingIncreaseFactor;
+            damping = max(damping, minDamping);
+            CORNU_COUNT(LS_DAMPING_INCREASES, 1);
+        }
 
-        double error = evalData->error();
-        //printf("Iter = %d, error = %lf\n", iter, error);
+        if(_minImprovement > 0. && error >= bestError * (1. - _minImprovement))
+            break; //stalled
         if(error < bestError)
         {
             bestError = error;
             best = x;
 
-            if(error < 1e-10)
+            if(error < 1e-10 || _problem->decided(x))
                 break;
         }
 
-        set<LSBoxConstraint> prevActiveSet = activeSet;
-        evalData->solveForDelta(_damping, delta, activeSet);
-
-        if(delta.squaredNorm() < 1e-14)
-            break;
-
-        int newConstraint = _project(x, delta, prevActiveSet);
+        _savedActive.assign(activeSet.begin(), activeSet.end());
+        bool accepted = false;
+        for(int i = 0; i < maxTrials && !accepted; ++i)
+        {
+            if(i > 0) //the last trial was rejected
+            {
+                damping *= dampingUp;
+                activeSet.clear();
+                activeSet.insert(_savedActive.begin(), _savedActive.end());
+            }
 
-        if(newConstraint != -1)
-            activeSet.insert(_constraints[newConstraint]);
+            _markActive(activeSet, (int)x.size());
+            evalData->solveForDelta(damping, delta, activeSet);
+            if(delta.squaredNorm() < 1e-14)
+                break;
 
-        x += delta;
+            int newConstraint = _project(x, delta);
+            if(newConstraint != -1)
+                activeSet.insert(_constraints[newConstraint]);
 
-        int halvings = 0;
-        while(_problem->error(x, evalData) > error && delta.squaredNorm() > 1e-8)
-        {
-            //printf("Halving\n");
-            delta *= 0.5;
-            x -= delta;
-            ++halvings;
-        }
-        if(halvings > 0) //halve again -- won't hurt and may actually help
-        {
-            delta *= 0.5;
-            x -= delta;
+            trial = x + delta;
+            _problem->eval(trial, trialData);
+            CORNU_COUNT(LS_EVALUATIONS, 1);
+            double trialError = trialData->error();
+            accepted = (trialError <= error || delta.squaredNorm() <= 1e-8);
+            if(accepted)
+            {
+                x = trial;
+                error = trialError;
+                swap(evalData, trialData);
+                damping = max(damping * dampingDown, minDamping);
+            }
         }
+        if(!accepted)
+            break;
     }
 
-    double error = _problem->error(x, evalData);
+    _iterations = iter;
+    trace.setArg("iterations", iter);
+    CORNU_COUNT(LS_SOLVES, 1);
+    CORNU_COUNT(LS_ITERATIONS, iter);
     if(iter > 5)
-        Debugging::get()->printf("After %d iterations, error = %lf", iter, sqrt(error));
+        CORNU_DEBUG(printf("After %d iterations, error = %lf", iter, sqrt(error)));
     if(error < bestError)
-    {
         best = x;
-    }
 
-    delete evalData;
+    _problem->releaseEvalData(trialData);
+    _problem->releaseEvalData(evalData);
     return best;
 }
 
+void LSSolver::_markActive(const set<LSBoxConstraint> &activeSet, int numVars)
+{
+    _wasActive.assign(numVars, 0);
+    for(set<LSBoxConstraint>::const_iterator it = activeSet.begin(); it != activeSet.end(); ++it)
+        _wasActive[it->index] = 1;
+}
+
 set<LSBoxConstraint> LSSolver::_clamp(VectorXd &x)
 {
     set<LSBoxConstraint> out;
@@ -116,7 +184,7 @@ set<LSBoxConstraint> LSSolver::_clamp(VectorXd &x)
     return out;
 }
 
-int LSSolver::_project(const VectorXd &from, VectorXd &delta, const set<LSBoxConstraint> &activeSet)
+int LSSolver::_project(const VectorXd &from, VectorXd &delta)
 {
     int closestConstraint = -1;
     double minScale = 1.;
@@ -128,7 +196,7 @@ int LSSolver::_project(const VectorXd &from, VectorXd &delta, const set<LSBoxCon
         if(c.sign == 0)
             delta[c.index] = 0; //just in case
 
-        if(activeSet.count(c))
+        if(_wasActive[c.index])
             continue; //already constrained
         
         double scale = (c.value - from[c.index]) / delta[c.index];
@@ -178,86 +246,147 @@ bool LSSolver::verifyDerivatives(const Eigen::VectorXd &pt, double eps) const
     double err = (numDer - exactDer).norm();
 
     //TODO: just print the error for now
-    Debugging::get()->printf("Derivative Error = %lf", err);
+    CORNU_DEBUG(printf("Derivative Error = %lf", err));
 #if 0
     for(int i = 0; i < numDer.cols(); ++i)
-        Debugging::get()->printf("Col %d err = %lf", i, (numDer.col(i) - exactDer.col(i)).norm());
+        CORNU_DEBUG(printf("Col %d err = %lf", i, (numDer.col(i) - exactDer.col(i)).norm()));
     for(int i = 0; i < numDer.rows(); ++i)
-        Debugging::get()->printf("Row %d err = %lf", i, (numDer.row(i) - exactDer.row(i)).norm());
+        CORNU_DEBUG(printf("Row %d err = %lf", i, (numDer.row(i) - exactDer.row(i)).norm()));
 #endif
-    delete evalData;
+    _problem->releaseEvalData(evalData);
 
     return true;
 }
 
-void LSDenseEvalData::solveForDelta(double damping, VectorXd &out, set<LSBoxConstraint> &constraints)
+//Problems with one or two primitives have at most maxSmallVars variables.  For them, the normal equations
+//are formed once in matrices that don't need heap allocation.  The constrained system is then the
+//submatrix for the free variables, instead of the product of a copy of the free Jacobian columns.
+typedef Matrix<double, Dynamic, Dynamic, 0, LSDenseEvalData::maxSmallVars, LSDenseEvalData::maxSmallVars> SmallMatrix;
+typedef Matrix<double, Dynamic, 1, 0, LSDenseEvalData::maxSmallVars, 1> SmallVector;
+
+void LSDenseEvalData::solveForDeltaSmall(double damping, VectorXd &out, unsigned &activeVars, const int *signs)
 {
     int vars = (int)_errDer.cols();
-    if(constraints.empty())
-    {
-        LDLT<MatrixXd> ldlt(MatrixXd::Identity(vars, vars) * damping + _errDer.transpose() * _errDer);
-        out = ldlt.solve(-_errDer.transpose() * _err);
-    }
-    else
-    {
-        VectorXd rhs = -_err;
+    assert(vars <= maxSmallVars);
 
-        vector<bool> constraintIndices(vars, false);
-        for(set<LSBoxConstraint>::const_iterator it = constraints.begin(); it != constraints.end(); ++it)
-            constraintIndices[it->index] = true;
+    SmallMatrix JtJ(vars, vars);
+    JtJ.noalias() = _errDer.transpose() * _errDer;
+    SmallVector Jte(vars);
+    Jte.noalias() = _errDer.transpose() * _err;
+
+    int freeVars[maxSmallVars];
+    int numFree = 0;
+    for(int i = 0; i < vars; ++i)
+        if(!(activeVars & (1u << i)))
+            freeVars[numFree++] = i;
 
-        if(vars > (int)constraints.size())
+    SmallVector delta = SmallVector::Zero(vars);
+    if(numFree > 0)
+    {
+        SmallMatrix lhs(numFree, numFree);
+        SmallVector rhs(numFree);
+        for(int i = 0; i < numFree; ++i)
         {
-            MatrixXd lhs(_errDer.rows(), vars - (int)constraints.size());
-            int offs = 0;
-            for(int i = 0; i < vars; ++i)
-            {
-                if(constraintIndices[i])
-                {
-                    ++offs;
-                    continue;
-                }
-                lhs.col(i - offs) = _errDer.col(i);
-            }
+            for(int j = 0; j < numFree; ++j)
+                lhs(i, j) = JtJ(freeVars[i], freeVars[j]);
+            lhs(i, i) += damping;
+            rhs[i] = -Jte[freeVars[i]];
+        }
 
-            LDLT<MatrixXd> ldlt(MatrixXd::Identity(lhs.cols(), lhs.cols()) * damping + lhs.transpose() * lhs);
-            VectorXd x = ldlt.solve(lhs.transpose() * rhs);
-            
-            out.resize(_errDer.cols());
-            offs = 0;
+        SmallVector x = LDLT<SmallMatrix>(lhs).solve(rhs);
+        for(int i = 0; i < numFree; ++i)
+            delta[freeVars[i]] = x[i];
+    }
+    out = delta;
 
-            for(int i = 0; i < vars; ++i)
-            {
-                if(constraintIndices[i])
-                {
-                    out[i] = 0.;
-                    ++offs;
-                    continue;
-                }
-                out[i] = x[i - offs];
-            }
-        }
-        else //as many variables as constraints
+    if(!activeVars)
+        return;
+
+    //check which constraints we don't need
+    SmallVector gradient = JtJ * delta + Jte;
+    for(int i = 0; i < vars; ++i)
+        if((activeVars & (1u << i)) && gradient[i] * signs[i] < 0) //if sign is zero, constraint will not get erased
+            activeVars &= ~(1u << i);
+}
+
+void LSDenseEvalData::solveForDelta(double damping, VectorXd &out, set<LSBoxConstraint> &constraints)
+{
+    int vars = (int)_errDer.cols();
+    if(vars <= maxSmallVars)
+    {
+        unsigned activeVars = 0;
+        int signs[maxSmallVars];
+        for(set<LSBoxConstraint>::const_iterator it = constraints.begin(); it != constraints.end(); ++it)
         {
-            out = VectorXd::Zero(_errDer.cols());
+            activeVars |= 1u << it->index;
+            signs[it->index] = it->sign;
         }
 
-        //check which constraints we don't need
-        VectorXd gradient = _errDer.transpose() * (_errDer * out - rhs);
+        solveForDeltaSmall(damping, out, activeVars, signs);
+
         for(set<LSBoxConstraint>::iterator it = constraints.begin(); it != constraints.end(); )
         {
             set<LSBoxConstraint>::iterator next = it;
             ++next;
-            if(gradient[it->index] * it->sign < 0) //if sign is zero, constraint will not get erased
-            {
-                //cout << "Unsetting constraint on variable at index " << it->index << endl;
+            if(!(activeVars & (1u << it->index)))
                 constraints.erase(it);
-            }
             it = next;
         }
+        return;
     }
-}
 
+    //the normal equations, restricted to the free variables
+    _jtJ.noalias() = _errDer.transpose() * _errDer;
+    _jtE.noalias() = _errDer.transpose() * _err;
+
+    _freeVars.clear();
+    set<LSBoxConstraint>::const_iterator cit = constraints.begin();
+    for(int i = 0; i < vars; ++i)
+    {
+        if(cit != constraints.end() && cit->index == i)
+            ++cit;
+        else
+            _freeVars.push_back(i);
+    }
+
+    int numFree = (int)_freeVars.size();
+    out.setZero(vars);
+    if(numFree > 0)
+    {
+        _lhs.resize(numFree, numFree);
+        _rhs.resize(numFree);
+        for(int j = 0; j < numFree; ++j)
+        {
+            for(int i = 0; i < numFree; ++i)
+                _lhs(i, j) = _jtJ(_freeVars[i], _freeVars[j]);
+            _lhs(j, j) += damping;
+            _rhs[j] = -_jtE[_freeVars[j]];
+        }
+
+        _ldlt.compute(_lhs);
+        _ldlt.solveInPlace(_rhs);
+        for(int i = 0; i < numFree; ++i)
+            out[_freeVars[i]] = _rhs[i];
+    }
+
+    if(constraints.empty())
+        return;
+
+    //check which constraints we don't need
+    _gradient.noalias() = _jtJ * out;
+    _gradient += _jtE;
+    for(set<LSBoxConstraint>::iterator it = constraints.begin(); it != constraints.end(); )
+    {
+        set<LSBoxConstraint>::iterator next = it;
+        ++next;
+        if(_gradient[it->index] * it->sign < 0) //if sign is zero, constraint will not get erased
+        {
+            //cout << "Unsetting constraint on variable at index " << it->index << endl;
+            constraints.erase(it);
+        }
+        it = next;
+    }
+}
 
 END_NAMESPACE_Cornu
 
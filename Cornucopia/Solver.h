@@ -22,9 +22,15 @@
 #define CORNUCOPIA_SOLVER_H_INCLUDED
 
 #include "defs.h"
+#include "WorkCounters.h"
+#include "Tracing.h"
+#include "CancellationToken.h"
+#include "Arena.h"
 #include <vector>
 #include <set>
+#include <typeinfo>
 #include <Eigen/Core>
+#include <Eigen/Cholesky>
 
 NAMESPACE_Cornu
 
@@ -43,6 +49,8 @@ class LSEvalData
 public:
     virtual ~LSEvalData() {}
 
+    CORNU_ARENA_OPERATOR_NEW //solves happen all the time during a fit
+
     virtual double error() const = 0;
     virtual void solveForDelta(double damping, Eigen::VectorXd &out, std::set<LSBoxConstraint> &constraints) = 0;
 
@@ -58,25 +66,151 @@ public:
 
     virtual double error(const Eigen::VectorXd &x, LSEvalData *data) { eval(x, data); return data->error(); }
     virtual LSEvalData *createEvalData() = 0;
+    //The solvers give their eval data back here when they're done (see LSWorkspace)
+    virtual void releaseEvalData(LSEvalData *data) { delete data; }
     virtual void eval(const Eigen::VectorXd &x, LSEvalData *data) = 0;
+    //Called with each new best point, right after it's evaluated: a problem whose caller only needs to know
+    //something about the solution can return true once that's clear, and the solve returns that point
+    virtual bool decided(const Eigen::VectorXd &/*x*/) { return false; }
 };
 
-class LSSolver
+//The eval data that the solves on one thread reuse.  A fit runs thousands of solves, so the problems take their
+//eval data from the calling thread's workspace in createEvalData and give it back in releaseEvalData, and the next
+//solve with the same kind of eval data gets it with its buffers.  The iterations of a solve reuse the buffers too,
+//so a solve only allocates when it needs other sizes than the one before (Eigen reallocates a vector or matrix
+//whose size changes; the std::vectors of blocks keep their capacity).
+class LSWorkspace
 {
 public:
-    LSSolver(LSProblem *problem, const std::vector<LSBoxConstraint> &constraints);
+    ~LSWorkspace();
 
-    Eigen::VectorXd solve(const Eigen::VectorXd &guess);
+    static LSWorkspace &current(); //of the calling thread
+
+    //An EvalData given back earlier on this thread, or a new one.  An eval may run a solve of its own, so
+    //several can be taken at once.
+    template<class EvalData> EvalData *take()
+    {
+        for(int i = (int)_free.size() - 1; i >= 0; --i)
+        {
+            if(typeid(*_free[i]) == typeid(EvalData))
+            {
+                EvalData *out = static_cast<EvalData *>(_free[i]);
+                _free.erase(_free.begin() + i);
+                return out;
+            }
+        }
+        Arena::Scope heap(NULL); //it outlives the fit whose arena is current
+        return new EvalData();
+    }
+    void give(LSEvalData *data);
+
+private:
+    enum { maxFree = 8 };
+    std::vector<LSEvalData *> _free;
+};
+
+//The settings and the iterations that LSSolver (with HALVING step control) and LSSolverFixed share.  They differ
+//in how they keep the active constraints, which Derived does in _clampGuess(x), which clamps the guess to the
+//constraints and makes the ones it's on active, _solveForDelta(evalData, delta), which solves for the step with
+//the active set and may release some of it, and _projectStep(x, delta), which shortens the step to the first
+//constraint that wasn't active before the solve that it crosses and makes that one active.
+template<typename Derived>
+class LSSolverBase
+{
+public:
     void setDefaultDamping(double damping) { _damping = damping; }
     void setMaxIter(int maxIter) { _maxIter = maxIter; }
     void setIncreaseDampingAfter(int iter) { _increaseDampingAfter = iter; }
     void setDampingIncreaseFactor(double factor) { _dampingIncreaseFactor = factor; }
+    void setMinImprovement(double fraction) { _minImprovement = fraction; } //stops once an iteration lowers the error by less than this fraction
+    void setCancellationToken(CancellationTokenConstPtr token) { _cancellationToken = token; } //solve returns the best so far once it's cancelled
+    int iterations() const { return _iterations; } //taken by the last solve
 
-    bool verifyDerivatives(const Eigen::VectorXd &pt, double eps = 1e-6) const;
+protected:
+    LSSolverBase(LSProblem *problem, const std::vector<LSBoxConstraint> &constraints)
+        : _problem(problem), _constraints(constraints), _damping(1.), _maxIter(100),
+          _increaseDampingAfter(0), _dampingIncreaseFactor(1.), _minImprovement(0.), _iterations(0) {}
 
-private:
-    int _project(const Eigen::VectorXd &from, Eigen::VectorXd &x, const std::set<LSBoxConstraint> &activeSet); //returns the index of the constraint
-    std::set<LSBoxConstraint> _clamp(Eigen::VectorXd &x);
+    //Each iteration steps to the solution of the linearized problem, halving the step until it doesn't increase
+    //the error, and then once more if it was halved
+    Eigen::VectorXd _solveHalving(const Eigen::VectorXd &guess, const char *traceName)
+    {
+        Derived &derived = static_cast<Derived &>(*this);
+        TraceScope trace(traceName);
+        Eigen::VectorXd best;
+        double bestError = 1e100;
+        Eigen::VectorXd x = guess;
+        Eigen::VectorXd delta(guess.size());
+        LSEvalData *evalData = _problem->createEvalData();
+
+        derived._clampGuess(x);
+
+        int iter;
+        for(iter = 0; iter < _maxIter; ++iter)
+        {
+            if(_cancellationToken && _cancellationToken->isCancelled())
+                break;
+            if(iter > _increaseDampingAfter && _dampingIncreaseFactor != 1.)
+            {
+                _damping *= _dampingIncreaseFactor;
+                CORNU_COUNT(LS_DAMPING_INCREASES, 1);
+            }
+            _problem->eval(x, evalData);
+            CORNU_COUNT(LS_EVALUATIONS, 1);
+
+            double error = evalData->error();
+            if(_minImprovement > 0. && error >= bestError * (1. - _minImprovement))
+                break; //stalled
+            if(error < bestError)
+            {
+                bestError = error;
+                best = x;
+
+                if(error < 1e-10 || _problem->decided(x))
+                    break;
+            }
+
+            derived._solveForDelta(evalData, delta);
+
+            if(delta.squaredNorm() < 1e-14)
+                break;
+
+            derived._projectStep(x, delta);
+
+            x += delta;
+
+            int halvings = 0;
+            while(_problem->error(x, evalData) > error && delta.squaredNorm() > 1e-8)
+            {
+                CORNU_COUNT(LS_EVALUATIONS, 1);
+                delta *= 0.5;
+                x -= delta;
+                ++halvings;
+            }
+            CORNU_COUNT(LS_EVALUATIONS, 1);
+            if(halvings > 0) //halve again -- won't hurt and may actually help
+            {
+                delta *= 0.5;
+                x -= delta;
+            }
+        }
+
+        _iterations = iter;
+        trace.setArg("iterations", iter);
+        CORNU_COUNT(LS_SOLVES, 1);
+        CORNU_COUNT(LS_ITERATIONS, iter);
+        CORNU_COUNT(LS_EVALUATIONS, 1);
+        double error = _problem->error(x, evalData);
+        if(iter > 5)
+            CORNU_DEBUG(printf("After %d iterations, error = %lf", iter, sqrt(error)));
+        if(error < bestError)
+        {
+            best = x;
+        }
+
+        _problem->releaseEvalData(evalData);
+        return best;
+    }
 
     LSProblem *_problem;
     std::vector<LSBoxConstraint> _constraints;
@@ -84,11 +218,61 @@ private:
     int _maxIter;
     int _increaseDampingAfter;
     double _dampingIncreaseFactor;
+    double _minImprovement;
+    int _iterations;
+    CancellationTokenConstPtr _cancellationToken;
+};
+
+class LSSolver : public LSSolverBase<LSSolver>
+{
+public:
+    //How the solver handles a step that increases the error
+    enum StepControl
+    {
+        HALVING, //halve it until it doesn't, evaluating each halved point (the default)
+        TRUST_REGION //solve for it again from the same evaluation with more damping (see _solveTrustRegion)
+    };
+
+    LSSolver(LSProblem *problem, const std::vector<LSBoxConstraint> &constraints);
+
+    Eigen::VectorXd solve(const Eigen::VectorXd &guess);
+    void setStepControl(StepControl control) { _stepControl = control; }
+
+    bool verifyDerivatives(const Eigen::VectorXd &pt, double eps = 1e-6) const;
+
+private:
+    friend class LSSolverBase<LSSolver>;
+
+    Eigen::VectorXd _solveTrustRegion(const Eigen::VectorXd &guess);
+    void _markActive(const std::set<LSBoxConstraint> &activeSet, int numVars); //fills _wasActive
+    int _project(const Eigen::VectorXd &from, Eigen::VectorXd &x); //returns the index of the constraint
+    std::set<LSBoxConstraint> _clamp(Eigen::VectorXd &x);
+
+    //for _solveHalving
+    void _clampGuess(Eigen::VectorXd &x) { _activeSet = _clamp(x); }
+    void _solveForDelta(LSEvalData *evalData, Eigen::VectorXd &delta)
+    {
+        _markActive(_activeSet, (int)delta.size());
+        evalData->solveForDelta(_damping, delta, _activeSet);
+    }
+    void _projectStep(const Eigen::VectorXd &x, Eigen::VectorXd &delta)
+    {
+        int newConstraint = _project(x, delta);
+        if(newConstraint != -1)
+            _activeSet.insert(_constraints[newConstraint]);
+    }
+
+    StepControl _stepControl;
+    std::set<LSBoxConstraint> _activeSet; //of the solve with HALVING
+    std::vector<char> _wasActive; //per variable, whether it was in the active set before solveForDelta released any
+    std::vector<LSBoxConstraint> _savedActive; //the active set to go back to when a trust region step is rejected
 };
 
 class LSDenseEvalData : public LSEvalData
 {
 public:
+    enum { maxSmallVars = 12 }; //problems with at most this many variables are solved without heap allocation
+
     //overrides
     double error() const { return _err.squaredNorm(); }
     void solveForDelta(double damping, Eigen::VectorXd &out, std::set<LSBoxConstraint> &constraints);
@@ -97,11 +281,111 @@ public:
 
     Eigen::VectorXd &errVectorRef() { return _err; }
     Eigen::MatrixXd &errDerRef() { return _errDer; }
+
+    //Same as solveForDelta for at most maxSmallVars variables, with the active constraints given by a bit
+    //per variable (and the constraint signs indexed by variable)
+    void solveForDeltaSmall(double damping, Eigen::VectorXd &out, unsigned &activeVars, const int *signs);
+
 private:
     Eigen::VectorXd _err;
     Eigen::MatrixXd _errDer;
+
+    //for solveForDelta with more than maxSmallVars variables, kept between iterations
+    Eigen::MatrixXd _jtJ, _lhs;
+    Eigen::VectorXd _jtE, _rhs, _gradient;
+    Eigen::LDLT<Eigen::MatrixXd> _ldlt;
+    std::vector<int> _freeVars;
 };
 
+//LSSolverFixed does the same thing as LSSolver for problems that have at most MaxVars variables and use
+//LSDenseEvalData.  The active set is a bitmask instead of a std::set and the vectors are allocated once
+//per solve, so the iterations don't allocate.  One and two-curve problems are solved this way.
+template<int MaxVars>
+class LSSolverFixed : public LSSolverBase<LSSolverFixed<MaxVars> >
+{
+public:
+    LSSolverFixed(LSProblem *problem, const std::vector<LSBoxConstraint> &constraints)
+        : LSSolverBase<LSSolverFixed<MaxVars> >(problem, constraints), _activeVars(0), _prevActiveVars(0)
+    {
+        static_assert(MaxVars <= LSDenseEvalData::maxSmallVars, "too many variables for LSSolverFixed");
+    }
+
+    Eigen::VectorXd solve(const Eigen::VectorXd &guess)
+    {
+        assert(guess.size() <= MaxVars);
+        return this->_solveHalving(guess, "LSSolverFixed::solve");
+    }
+
+private:
+    friend class LSSolverBase<LSSolverFixed<MaxVars> >;
+
+    //like inserting into the std::set in LSSolver: a variable keeps the first constraint that activated it
+    void _activate(const LSBoxConstraint &c)
+    {
+        if(_activeVars & (1u << c.index))
+            return;
+        _activeVars |= 1u << c.index;
+        _signs[c.index] = c.sign;
+    }
+
+    void _clampGuess(Eigen::VectorXd &x)
+    {
+        _activeVars = 0;
+        for(int i = 0; i < (int)this->_constraints.size(); ++i)
+        {
+            const LSBoxConstraint &c = this->_constraints[i];
+            if(c.sign == 0 || (x[c.index] - c.value) * c.sign < 0.)
+            {
+                x[c.index] = c.value;
+                _activate(c);
+            }
+        }
+    }
+
+    void _solveForDelta(LSEvalData *evalData, Eigen::VectorXd &delta)
+    {
+        _prevActiveVars = _activeVars;
+        static_cast<LSDenseEvalData *>(evalData)->solveForDeltaSmall(this->_damping, delta, _activeVars, _signs);
+    }
+
+    void _projectStep(const Eigen::VectorXd &from, Eigen::VectorXd &delta)
+    {
+        int closestConstraint = -1;
+        double minScale = 1.;
+
+        for(int i = 0; i < (int)this->_constraints.size(); ++i)
+        {
+            const LSBoxConstraint &c = this->_constraints[i];
+
+            if(c.sign == 0)
+                delta[c.index] = 0; //just in case
+
+            if(_prevActiveVars & (1u << c.index))
+                continue; //already constrained
+
+            double scale = (c.value - from[c.index]) / delta[c.index];
+
+            if((from[c.index] + delta[c.index] - c.value) * c.sign >= 0.)
+                continue;
+
+            if(scale < minScale)
+            {
+                minScale = scale;
+                closestConstraint = i;
+            }
+        }
+
+        if(closestConstraint >= 0)
+        {
+            delta *= minScale;
+            _activate(this->_constraints[closestConstraint]);
+        }
+    }
+
+    unsigned _activeVars; //a bit per variable
+    unsigned _prevActiveVars; //before the last solve for a step released any
+    int _signs[MaxVars]; //of the constraint that activated each active variable
+};
 
 END_NAMESPACE_Cornu
 
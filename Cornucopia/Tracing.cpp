@@ -0,0 +1,187 @@
+/*--
+    Tracing.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Tracing.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+using namespace std;
+NAMESPACE_Cornu
+
+namespace
+{
+
+struct TraceEvent
+{
+    string name;
+    Tracing::Clock::time_point start;
+    Tracing::Clock::duration duration;
+    const char *argName; //NULL if there's no argument
+    long long arg;
+    int thread;
+};
+
+class ThreadTrace;
+
+mutex traceMutex; //guards TraceData
+
+//The events of threads that finished, and the buffers of the ones still running
+struct TraceData
+{
+    TraceData() : numThreads(0) {}
+
+    vector<TraceEvent> finishedEvents;
+    vector<ThreadTrace *> threads;
+    int numThreads; //for numbering them in the trace
+    Tracing::Clock::time_point startTime;
+};
+
+TraceData &traceData()
+{
+    static TraceData *data = new TraceData(); //never destroyed, since threads may finish during static destruction
+    return *data;
+}
+
+//A thread's buffer registers itself on the first event and hands its events over when the thread finishes.
+//Its own lock is only contended while the trace is started or written.
+class ThreadTrace
+{
+public:
+    ThreadTrace() : _thread(-1) {}
+    ~ThreadTrace()
+    {
+        if(_thread < 0)
+            return;
+        lock_guard<mutex> lock(traceMutex);
+        TraceData &data = traceData();
+        data.finishedEvents.insert(data.finishedEvents.end(), _events.begin(), _events.end());
+        data.threads.erase(find(data.threads.begin(), data.threads.end(), this));
+    }
+
+    void add(TraceEvent &event)
+    {
+        if(_thread < 0)
+        {
+            lock_guard<mutex> lock(traceMutex);
+            _thread = traceData().numThreads++;
+            traceData().threads.push_back(this);
+        }
+        event.thread = _thread;
+        lock_guard<mutex> lock(_mutex);
+        _events.push_back(event);
+    }
+
+    //called with traceMutex locked
+    void clear() { lock_guard<mutex> lock(_mutex); _events.clear(); }
+    void appendTo(vector<TraceEvent> &out) { lock_guard<mutex> lock(_mutex); out.insert(out.end(), _events.begin(), _events.end()); }
+    size_t size() { lock_guard<mutex> lock(_mutex); return _events.size(); }
+
+private:
+    mutex _mutex;
+    vector<TraceEvent> _events;
+    int _thread;
+};
+
+thread_local ThreadTrace threadTrace;
+
+void writeJsonString(ostream &out, const string &str)
+{
+    out << '"';
+    for(int i = 0; i < (int)str.size(); ++i)
+    {
+        if(str[i] == '"' || str[i] == '\\')
+            out << '\\';
+        out << (((unsigned char)str[i] < 0x20) ? ' ' : str[i]);
+    }
+    out << '"';
+}
+
+} //namespace
+
+atomic<bool> Tracing::_on(false);
+
+void Tracing::start()
+{
+    lock_guard<mutex> lock(traceMutex);
+    TraceData &data = traceData();
+    data.finishedEvents.clear();
+    for(int i = 0; i < (int)data.threads.size(); ++i)
+        data.threads[i]->clear();
+    data.startTime = Clock::now();
+    _on = true;
+}
+
+void Tracing::stop()
+{
+    _on = false;
+}
+
+int Tracing::numEvents()
+{
+    lock_guard<mutex> lock(traceMutex);
+    TraceData &data = traceData();
+    size_t out = data.finishedEvents.size();
+    for(int i = 0; i < (int)data.threads.size(); ++i)
+        out += data.threads[i]->size();
+    return (int)out;
+}
+
+bool Tracing::writeChromeTrace(std::ostream &out)
+{
+    lock_guard<mutex> lock(traceMutex);
+    TraceData &data = traceData();
+    vector<TraceEvent> events = data.finishedEvents;
+    for(int i = 0; i < (int)data.threads.size(); ++i)
+        data.threads[i]->appendTo(events);
+
+    out << "{\"traceEvents\":[";
+    for(int i = 0; i < (int)events.size(); ++i)
+    {
+        const TraceEvent &event = events[i];
+        char times[100]; //in microseconds
+        sprintf(times, "\"ts\":%.3f,\"dur\":%.3f", chrono::duration<double, micro>(event.start - data.startTime).count(),
+                chrono::duration<double, micro>(event.duration).count());
+        out << (i == 0 ? "\n" : ",\n") << "{\"name\":";
+        writeJsonString(out, event.name);
+        out << ",\"cat\":\"Cornucopia\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << "," << times;
+        if(event.argName)
+            out << ",\"args\":{\"" << event.argName << "\":" << event.arg << "}";
+        out << "}";
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return bool(out);
+}
+
+void Tracing::_record(const std::string &name, Clock::time_point start, Clock::time_point end, const char *argName, long long arg)
+{
+    TraceEvent event;
+    event.name = name;
+    event.start = start;
+    event.duration = end - start;
+    event.argName = argName;
+    event.arg = arg;
+    threadTrace.add(event);
+}
+
+END_NAMESPACE_Cornu
@@ -0,0 +1,95 @@
+/*--
+    Tracing.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_TRACING_H_INCLUDED
+#define CORNUCOPIA_TRACING_H_INCLUDED
+
+#include "defs.h"
+
+#include <atomic>
+#include <chrono>
+#include <iosfwd>
+#include <string>
+
+//Tracing is compiled in unless CORNU_TRACING is 0 (see the CMake option); when compiled in, a traced scope that
+//runs while tracing is off costs a relaxed atomic load.
+#ifndef CORNU_TRACING
+#define CORNU_TRACING 1
+#endif
+
+#define CORNU_TRACE_CONCAT_(A, B) A##B
+#define CORNU_TRACE_CONCAT(A, B) CORNU_TRACE_CONCAT_(A, B)
+#if CORNU_TRACING
+#define CORNU_TRACE_SCOPE(NAME) TraceScope CORNU_TRACE_CONCAT(_traceScope, __LINE__)(NAME)
+#else
+#define CORNU_TRACE_SCOPE(NAME) ((void)0)
+#endif
+
+NAMESPACE_Cornu
+
+//Records when traced scopes (the fitting stages, two-curve combinations, path searches and graph reductions,
+//and least squares solves) start and end on every thread, for writing in the Chrome trace event format, which
+//chrome://tracing and Perfetto (ui.perfetto.dev) show as a flame graph per thread.  Each thread appends to its
+//own buffer, whose lock is only contended while the trace is started or written, so those can be called any time.
+//Events of thread pools' worker threads are kept after the threads finish.
+class Tracing
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static void start(); //discards what was recorded before
+    static void stop();
+    static bool on() { return CORNU_TRACING && _on.load(std::memory_order_relaxed); }
+
+    static int numEvents();
+    static bool writeChromeTrace(std::ostream &out); //returns false if the stream fails
+
+private:
+    friend class TraceScope;
+
+    static void _record(const std::string &name, Clock::time_point start, Clock::time_point end, const char *argName, long long arg);
+
+    static std::atomic<bool> _on;
+};
+
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name) : _argName(NULL), _arg(0) { if(Tracing::on()) _begin(name); }
+    explicit TraceScope(const std::string &name) : _argName(NULL), _arg(0) { if(Tracing::on()) _begin(name); }
+    ~TraceScope() { if(!_name.empty()) Tracing::_record(_name, _start, Tracing::Clock::now(), _argName, _arg); }
+
+    void setArg(const char *name, long long value) { _argName = name; _arg = value; } //shown with the event
+
+private:
+    TraceScope(const TraceScope &); //not copyable
+    TraceScope &operator=(const TraceScope &);
+
+    void _begin(const std::string &name) { _name = name; _start = Tracing::Clock::now(); }
+
+    std::string _name; //empty if tracing was off when the scope started
+    Tracing::Clock::time_point _start;
+    const char *_argName;
+    long long _arg;
+};
+
+END_NAMESPACE_Cornu
+
+#endif //CORNUCOPIA_TRACING_H_INCLUDED
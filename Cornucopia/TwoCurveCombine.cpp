@@ -19,6 +19,7 @@
 */
 
 #include "TwoCurveCombine.h"
+#include "Tracing.h"
 #include "Resampler.h"
 #include "PrimitiveFitter.h"
 #include "CurvePrimitive.h"
@@ -43,7 +44,7 @@ public:
     {
         _errorComputer = fitter.output<ERROR_COMPUTER>()->errorComputer;
         int sampledPts = fitter.output<RESAMPLING>()->output->pts().size();
-        double adjustmentPoint = fitter.params().get(Parameters::TWO_CURVE_CURVATURE_ADJUST);
+        double adjustmentPoint = fitter.config().get(Parameters::TWO_CURVE_CURVATURE_ADJUST);
 
         CurvePrimitive::ParamVec v[2];
         for(int i = 0; i < 2; ++i)
@@ -258,62 +259,66 @@ public:
 #if 0
         char name[100];
         sprintf(name, "Curves %d", const_cast<CombinedCurve *>(this)->_evalCount++);
-        Debugging::get()->drawCurve(_c[0], Vector3d(1, 0, 0), name);
-        Debugging::get()->drawCurve(_c[1], Vector3d(0, 0, 1), name);
+        CORNU_DEBUG(drawCurve(_c[0], Vector3d(1, 0, 0), name));
+        CORNU_DEBUG(drawCurve(_c[1], Vector3d(0, 0, 1), name));
 #endif
-        VectorXd err[2];
-        MatrixXd errDer[2];
+        //The solver evaluates the same two curves many times, so the point errors, their derivatives and the two
+        //end rows (on the end angle and curvature) of each curve go into buffers kept between evaluations, as do
+        //the samples' projections.  Each curve's block of the output is its point errors followed by its end rows.
+        VectorXd *err = _err;
+        MatrixXd *errDer = _errDer;
 
         //perhaps it should be whether that point is a corner, rather than continuity
-        _errorComputer->computeErrorVector(_c[0], _from[0], _to[0], err[0], errDer + 0, true, _continuity == 0, true);
-        _errorComputer->computeErrorVector(_c[1], _from[1], _to[1], err[1], errDer + 1, _continuity == 0, true);
+        _errorComputer->computeErrorVector(_c[0], _from[0], _to[0], err[0], errDer + 0, true, _continuity == 0, true, _footPoints + 0);
+        _errorComputer->computeErrorVector(_c[1], _from[1], _to[1], err[1], errDer + 1, _continuity == 0, true, false, _footPoints + 1);
 
-#if 1
         CurvePrimitive::EndDer endDer;
+        Vector2d endErr[2];
         for(int c = 0; c < 2; ++c)
         {
-            size_t offs = err[c].size();
-            err[c].conservativeResize(offs + 2);
-            errDer[c].conservativeResize(offs + 2, NoChange);
+            endErr[c][0] = _angleWeight[c] * AngleUtils::toRange(_c[c]->endAngle() - _origEndAngle[c], -PI);
+            endErr[c][1] = _curvatureWeight[c] * (_c[c]->endCurvature() - _origEndCurvature[c]);
 
-            err[c][offs] = _angleWeight[c] * AngleUtils::toRange(_c[c]->endAngle() - _origEndAngle[c], -PI);
-            err[c][offs + 1] = _curvatureWeight[c] * (_c[c]->endCurvature() - _origEndCurvature[c]);
-            
             _c[c]->derivativeAtEnd(2, endDer);
-            endDer.row(2) *= _angleWeight[c];
-            endDer.row(3) *= _curvatureWeight[c];
-            errDer[c].block(offs, 0, 2, errDer[c].cols()) = endDer.block(2, 0, 2, errDer[c].cols());
-        }
-#endif
+            _endDer[c] = endDer.block(2, 0, 2, errDer[c].cols());
+            _endDer[c].row(0) *= _angleWeight[c];
+            _endDer[c].row(1) *= _curvatureWeight[c];
 
-        _c[0]->toEndCurvatureDerivative(errDer[0]);
-        _c[1]->toEndCurvatureDerivative(errDer[1]);
+            //this only combines columns, so it can be applied to the point rows and end rows separately
+            _c[c]->toEndCurvatureDerivative(errDer[c]);
+            _c[c]->toEndCurvatureDerivative(_endDer[c]);
+        }
 
-        outError.resize(err[0].size() + err[1].size());
-        outError.segment(0, err[0].size()) = err[0];
-        outError.segment(err[0].size(), err[1].size()) = err[1];
+        MatrixXd::Index size0 = err[0].size(), size1 = err[1].size();
+        outError.resize(size0 + size1 + 4);
+        outError.segment(0, size0) = err[0];
+        outError.segment(size0, 2) = endErr[0];
+        outError.segment(size0 + 2, size1) = err[1];
+        outError.segment(size0 + 2 + size1, 2) = endErr[1];
 
-        outErrorDer = MatrixXd::Zero(outError.size(), numParams());
+        outErrorDer.setZero(outError.size(), numParams());
 
         for(int i = 0; i < (int)_mapping.size(); ++i)
         {
             const MappingElement &elem = _mapping[i];
-            MatrixXd::Index offset = elem.curveIdx ? err[0].size() : 0;
+            MatrixXd::Index offset = elem.curveIdx ? size0 + 2 : 0;
             MatrixXd::Index colSize = err[elem.curveIdx].size();
+            double sign = 1.;
 
             switch(elem.type)
             {
-            case MappingElement::Normal:    
+            case MappingElement::Normal:
             case MappingElement::PlusPi:
             case MappingElement::EndCurvature:
-                outErrorDer.col(elem.paramIdx).segment(offset, colSize) += errDer[elem.curveIdx].col(elem.parameter);
                 break;
             case MappingElement::Negative:
-                outErrorDer.col(elem.paramIdx).segment(offset, colSize) -= errDer[elem.curveIdx].col(elem.parameter);
+                sign = -1.;
                 break;
             case MappingElement::Zero:
-                break;
+                continue;
             }
+            outErrorDer.col(elem.paramIdx).segment(offset, colSize) += sign * errDer[elem.curveIdx].col(elem.parameter);
+            outErrorDer.col(elem.paramIdx).segment(offset + colSize, 2) += sign * _endDer[elem.curveIdx].col(elem.parameter);
         }
     }
 
@@ -375,12 +380,18 @@ private:
     double _curvatureWeight[2];
     double _origEndAngle[2];
     double _origEndCurvature[2];
+
+    //for computeErrorVector
+    mutable VectorXd _err[2];
+    mutable MatrixXd _errDer[2];
+    mutable MatrixXd _endDer[2];
+    mutable vector<double> _footPoints[2];
 };
 
 class TwoCurveProblem : public LSProblem
 {
 public:
-    TwoCurveProblem(CombinedCurve &curves) : _curves(curves) {}
+    TwoCurveProblem(CombinedCurve &curves, const CombinationDecider *decider) : _curves(curves), _decider(decider) {}
 
     //overrides
     double error(const Eigen::VectorXd &x, LSEvalData *)
@@ -390,7 +401,11 @@ public:
     }
     LSEvalData *createEvalData()
     {
-        return new LSDenseEvalData();
+        return LSWorkspace::current().take<LSDenseEvalData>();
+    }
+    void releaseEvalData(LSEvalData *data)
+    {
+        LSWorkspace::current().give(data);
     }
     void eval(const Eigen::VectorXd &x, LSEvalData *data)
     {
@@ -399,13 +414,19 @@ public:
         _curves.computeErrorVector(twoCurveData->errVectorRef(), twoCurveData->errDerRef());
         //cout << "Err = " << twoCurveData->error() << endl;
     }
+    bool decided(const Eigen::VectorXd &) //the curves have x's parameters, since it was just evaluated
+    {
+        return _decider && _decider->decided(_curves.computeErrorForCost(0), _curves.computeErrorForCost(1));
+    }
 
 private:
     CombinedCurve &_curves;
+    const CombinationDecider *_decider;
 };
 
-Combination twoCurveCombine(int p1, int p2, int continuity, const Fitter &fitter)
+Combination twoCurveCombine(int p1, int p2, int continuity, const Fitter &fitter, const CombinationDecider *decider)
 {
+    CORNU_TRACE_SCOPE("twoCurveCombine");
     const vector<FitPrimitive> &primitives = fitter.output<PRIMITIVE_FITTING>()->primitives;
     const VectorC<Vector2d> &pts = fitter.output<RESAMPLING>()->output->pts();
     ErrorComputerConstPtr errorComputer = fitter.output<ERROR_COMPUTER>()->errorComputer;
@@ -455,8 +476,8 @@ Combination twoCurveCombine(int p1, int p2, int continuity, const Fitter &fitter
     bool origDrawn = !constraints.empty() && !(cnt++);
     if(origDrawn)
     {
-        Debugging::get()->drawCurve(primitives[p1].curve, Vector3d(1, 0, 0), "Curves Orig");
-        Debugging::get()->drawCurve(primitives[p2].curve, Vector3d(0, 0, 1), "Curves Orig");
+        CORNU_DEBUG(drawCurve(primitives[p1].curve, Vector3d(1, 0, 0), "Curves Orig"));
+        CORNU_DEBUG(drawCurve(primitives[p2].curve, Vector3d(0, 0, 1), "Curves Orig"));
     }
 #endif
 
@@ -467,7 +488,7 @@ Combination twoCurveCombine(int p1, int p2, int continuity, const Fitter &fitter
             constraints.push_back(LSBoxConstraint(combined.getParamIndex(curveIdx, CurvePrimitive::LENGTH),
                                                   combined.getCurve(curveIdx)->length() * 0.5, 1));
 
-        bool inflectionAccounting = fitter.params().get(Parameters::INFLECTION_COST) > 0.;
+        bool inflectionAccounting = fitter.config().get(Parameters::INFLECTION_COST) > 0.;
 
         if(inflectionAccounting)
         {
@@ -497,10 +518,13 @@ Combination twoCurveCombine(int p1, int p2, int continuity, const Fitter &fitter
         }
     }
 
-    TwoCurveProblem problem(combined);
-    LSSolver solver(&problem, constraints);
-    solver.setDefaultDamping(fitter.params().get(Parameters::CURVE_ADJUST_DAMPING));
+    bool earlyStop = fitter.config().get(Parameters::VALIDATION_EARLY_STOP) > 0.5;
+    TwoCurveProblem problem(combined, earlyStop ? decider : NULL);
+    LSSolverFixed<12> solver(&problem, constraints);
+    solver.setDefaultDamping(fitter.config().get(Parameters::CURVE_ADJUST_DAMPING));
     solver.setMaxIter(5);
+    if(earlyStop)
+        solver.setMinImprovement(0.01);
     //solver.verifyDerivatives(x);
     x = solver.solve(x);
     combined.setParams(x);
@@ -508,8 +532,8 @@ Combination twoCurveCombine(int p1, int p2, int continuity, const Fitter &fitter
 #if 0
     if(origDrawn)
     {
-        Debugging::get()->drawCurve(combined.getCurve(0), Vector3d(1, 0, 0), "Curves Final");
-        Debugging::get()->drawCurve(combined.getCurve(1), Vector3d(0, 0, 1), "Curves Final");
+        CORNU_DEBUG(drawCurve(combined.getCurve(0), Vector3d(1, 0, 0), "Curves Final"));
+        CORNU_DEBUG(drawCurve(combined.getCurve(1), Vector3d(0, 0, 1), "Curves Final"));
     }
 #endif
 
@@ -37,7 +37,18 @@ struct Combination
     double err2;
 };
 
-Combination twoCurveCombine(int p1, int p2, int continuity, const Fitter &fitter);
+//Edge validation only needs to know whether a combination costs more than the edge was predicted to, which
+//is often clear before the solve converges.  With Parameters::VALIDATION_EARLY_STOP on, twoCurveCombine
+//stops once the decider returns true of the errors (as in Combination) so far, or once an iteration improves
+//the error by less than 1%.
+class CombinationDecider
+{
+public:
+    virtual ~CombinationDecider() {}
+    virtual bool decided(double err1, double err2) const = 0;
+};
+
+Combination twoCurveCombine(int p1, int p2, int continuity, const Fitter &fitter, const CombinationDecider *decider = NULL);
 
 END_NAMESPACE_Cornu
 
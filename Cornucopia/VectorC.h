@@ -74,31 +74,33 @@ public:
     //returns the size for iteration where at each iteration we access elements i, i+1, ..., i+offset
     int endIdx(int offset) const { return _circular ? (int)Base::size() : std::max(0, (int)size() - offset); }
 
+    //Walks the elements from a start index.  On a circular vector, it keeps its index in range, wrapping it
+    //with a compare when it steps past an end, and counts its steps to know when it's gone all the way around.
     class Circulator
     {
     public:
-        Circulator(const VectorC<T> *ptr, int idx) : _ptr(ptr), _idx(idx), _startIdx(idx) {}
+        Circulator(const VectorC<T> *ptr, int idx) : _ptr(ptr), _idx(idx), _steps(0), _size(ptr->size()), _circular(ptr->circular()) {}
 
-        const_reference operator*() const { return (*_ptr)[_idx]; }
-        bool operator==(const Circulator &other) const { return _ptr == other._ptr && _ptr->toLinearIdx(_idx) == _ptr->toLinearIdx(other._idx); }
+        const_reference operator*() const { return _ptr->flatAt(_idx); }
+        bool operator==(const Circulator &other) const { return _ptr == other._ptr && _idx == other._idx; }
         bool operator!=(const Circulator &other) const { return !(*this == other); }
 
-        Circulator &operator++() { ++_idx; return *this; }
-        Circulator &operator--() { --_idx; return *this; }
-        Circulator &operator+=(int x) { _idx += x; return *this; }
-        Circulator &operator-=(int x) { _idx -= x; return *this; }
-        Circulator operator+(int x) const { return Circulator(_ptr, _idx + x, _startIdx); }
-        Circulator operator-(int x) const { return Circulator(_ptr, _idx - x, _startIdx); }
+        Circulator &operator++() { ++_steps; if(++_idx == _size && _circular) _idx = 0; return *this; }
+        Circulator &operator--() { --_steps; if(--_idx < 0 && _circular) _idx = _size - 1; return *this; }
+        Circulator &operator+=(int x) { _steps += x; _idx = _ptr->toLinearIdx(_idx + x); return *this; }
+        Circulator &operator-=(int x) { return *this += -x; }
+        Circulator operator+(int x) const { Circulator out = *this; return out += x; }
+        Circulator operator-(int x) const { Circulator out = *this; return out += -x; }
 
-        bool done() const { if(_ptr->circular()) return abs(_idx - _startIdx) >= _ptr->size(); else return _idx < 0 || _idx >= _ptr->size(); }
-        int index() const { return _ptr->toLinearIdx(_idx); }
+        bool done() const { if(_circular) return abs(_steps) >= _size; else return _idx < 0 || _idx >= _size; }
+        int index() const { return _idx; }
 
     private:
-        Circulator(const VectorC<T> *ptr, int idx, int startIdx) : _ptr(ptr), _idx(idx), _startIdx(startIdx) {}
-
         const VectorC<T> *_ptr;
-        int _idx;
-        int _startIdx;
+        int _idx; //linear if the vector is circular--otherwise it may be out of range, and then the circulator is done
+        int _steps;
+        int _size;
+        bool _circular;
     };
 
     Circulator beginCirculator() const { return Circulator(this, 0); }
@@ -108,10 +110,26 @@ public:
     {
         if(!_circular)
             return idx;
-        int out = idx % size();
+        //indices are almost always within a size of the range, and those don't need a division
+        int n = size();
+        if(idx >= n)
+        {
+            idx -= n;
+            if(idx < n)
+                return idx;
+        }
+        else if(idx < 0)
+        {
+            idx += n;
+            if(idx >= 0)
+                return idx;
+        }
+        else
+            return idx;
+        int out = idx % n;
         if(out >= 0)
             return out;
-        return out + size();
+        return out + n;
     }
 
     int numElems(int from, int to) const //returns the number of elements between from (inclusive) and to (exclusive)
@@ -0,0 +1,97 @@
+/*--
+    WorkCounters.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_WORKCOUNTERS_H_INCLUDED
+#define CORNUCOPIA_WORKCOUNTERS_H_INCLUDED
+
+#include "defs.h"
+
+//Counting the work done in the inner loops is compiled in only if CORNU_COUNTERS is 1 (see the CMake option),
+//since the counts are incremented on hot paths.  The counts are per thread and Fitter::run reports the ones
+//its run caused in FitStats::counters (parallelFor adds the counts of its worker threads to the caller's).
+#ifndef CORNU_COUNTERS
+#define CORNU_COUNTERS 0
+#endif
+
+#if CORNU_COUNTERS
+#define CORNU_COUNT(COUNTER, NUM) (WorkCounters::current().counts[WorkCounters::COUNTER] += (NUM))
+#else
+#define CORNU_COUNT(COUNTER, NUM) ((void)0)
+#endif
+
+NAMESPACE_Cornu
+
+struct WorkCounters
+{
+    enum Counter
+    {
+        LINE_PROJECTIONS,
+        ARC_PROJECTIONS,
+        CLOTHOID_PROJECTIONS,
+        FRESNEL_VALUES, //the values evaluated by fresnel, scalar or vectorized
+        FRESNEL_APPROX_VALUES,
+        FRESNEL_TABLE_VALUES,
+        LS_SOLVES,
+        LS_ITERATIONS,
+        LS_EVALUATIONS, //of LSProblem::eval or error, which go over all the samples
+        LS_DAMPING_INCREASES,
+        EDGE_VALIDATIONS, //calls to Edge::validatedCost for non-dummy edges
+        EDGE_INVALIDATIONS, //validations that raised an edge's cost, so the path had to be searched again
+        GRAPH_REDUCTIONS, //path finding graph reductions
+        NUM_COUNTERS //must be last
+    };
+
+    WorkCounters() { clear(); }
+    void clear()
+    {
+        for(int i = 0; i < NUM_COUNTERS; ++i)
+            counts[i] = 0;
+    }
+
+    long long operator[](Counter counter) const { return counts[counter]; }
+    WorkCounters &operator+=(const WorkCounters &other)
+    {
+        for(int i = 0; i < NUM_COUNTERS; ++i)
+            counts[i] += other.counts[i];
+        return *this;
+    }
+    WorkCounters operator-(const WorkCounters &other) const
+    {
+        WorkCounters out;
+        for(int i = 0; i < NUM_COUNTERS; ++i)
+            out.counts[i] = counts[i] - other.counts[i];
+        return out;
+    }
+
+    static const char *name(Counter counter);
+
+    //the counts of the calling thread
+    static WorkCounters &current()
+    {
+        static thread_local WorkCounters counters;
+        return counters;
+    }
+
+    long long counts[NUM_COUNTERS];
+};
+
+END_NAMESPACE_Cornu
+
+#endif //CORNUCOPIA_WORKCOUNTERS_H_INCLUDED
@@ -22,7 +22,21 @@
 #define CORNUCOPIA_SMART_PTR_H_INCLUDED
 
 #include "defs.h"
+#include "Arena.h"
 #include <algorithm>
+#include <utility>
+
+//Reference counting policy.  By default, reference counts are atomic, so that smart pointers to the same
+//object may be copied and released from different threads (e.g., the output of a Fitter handed to another thread).
+//If Cornucopia is only ever used from one thread at a time, define CORNU_ATOMIC_REFCOUNT to 0 (for the library
+//and everything that includes it--see the CMake option) to use plain integer reference counts.
+#ifndef CORNU_ATOMIC_REFCOUNT
+#define CORNU_ATOMIC_REFCOUNT 1
+#endif
+
+#if CORNU_ATOMIC_REFCOUNT
+#include <atomic>
+#endif
 
 NAMESPACE_Cornu
 
@@ -31,7 +45,11 @@ template<typename T> class smart_ptr;
 class smart_base
 {
 private:
+#if CORNU_ATOMIC_REFCOUNT
+    mutable std::atomic<int> _refCount;
+#else
     mutable int _refCount;
+#endif
 
 public:
     smart_base() : _refCount(0) {}
@@ -41,17 +59,28 @@ public:
     //assigning to a smart_base should not change the reference count
     smart_base &operator=(const smart_base &) { return *this; }
 
+    //objects created while a Fitter runs come out of its arena (this also aligns them for Eigen members)
+    CORNU_ARENA_OPERATOR_NEW
+
 protected:
     template<class U> friend class smart_ptr;
 
-    virtual void addRef() const
+    //not virtual, so the common case of copying a pointer does not need an indirect call
+    void addRef() const
     {
+#if CORNU_ATOMIC_REFCOUNT
+        _refCount.fetch_add(1, std::memory_order_relaxed);
+#else
         ++_refCount;
+#endif
     }
-    virtual void releaseRef() const
+    void releaseRef() const
     {
-        bool free = false;
-        free = (--_refCount <= 0);
+#if CORNU_ATOMIC_REFCOUNT
+        bool free = (_refCount.fetch_sub(1, std::memory_order_acq_rel) <= 1);
+#else
+        bool free = (--_refCount <= 0);
+#endif
         if (free)
             const_cast<smart_base *>(this)->freeRef();
     }
@@ -95,6 +124,20 @@ public:
             ptr->addRef(); 
     }
 
+    //moving takes over the reference, so the count is not touched
+    template<class U>
+    smart_ptr(smart_ptr<U> &&smartPtr) noexcept : ptr(smartPtr.ptr), typedPtr(smartPtr.typedPtr)
+    {
+        smartPtr.ptr = 0;
+        smartPtr.typedPtr = 0;
+    }
+
+    smart_ptr(smart_ptr &&smartPtr) noexcept : ptr(smartPtr.ptr), typedPtr(smartPtr.typedPtr)
+    {
+        smartPtr.ptr = 0;
+        smartPtr.typedPtr = 0;
+    }
+
     ~smart_ptr()
     {
         if(ptr)
@@ -118,6 +161,19 @@ public:
         return *this;
     }
 
+    template<class U>
+    smart_ptr<T> &operator=(smart_ptr<U> &&other) noexcept
+    {
+        smart_ptr<T>(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    smart_ptr<T> &operator=(smart_ptr &&other) noexcept
+    {
+        smart_ptr<T>(std::move(other)).swap(*this);
+        return *this;
+    }
+
     smart_ptr<T> &operator=(T *other)
     {
         smart_ptr<T>(other).swap(*this);
@@ -138,6 +194,7 @@ public:
     }
 
     T *get() const { return typedPtr; }
+    bool unique() const { return ptr && ptr->getRefCount() == 1; } //whether this is the only pointer to the object
     void reset() 
     {
         if(ptr)
@@ -45,6 +45,7 @@ DemoUIWindow::DemoUIWindow()
     addDockWidget(Qt::RightDockWidgetArea, paramWidget);
     
     connect(paramWidget, SIGNAL(rerunClicked()), mainView->document(), SLOT(refitSelected()));
+    connect(paramWidget, SIGNAL(compareClicked()), mainView->document(), SLOT(compareSelected()));
 
     _debugWindow = new DebugWindow();
 
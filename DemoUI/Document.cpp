@@ -28,6 +28,9 @@
 #include "GraphConstructor.h"
 #include "PrimitiveSequence.h"
 #include "Bezier.h"
+#include "Similarity.h"
+#include "Debugging.h"
+#include "FitService.h"
 
 #include <QFileDialog>
 #include <QFile>
@@ -35,6 +38,7 @@
 #include <QDataStream>
 #include <QTextStream>
 #include <QMessageBox>
+#include <QSet>
 #include <QScriptEngine>
 #include <QScriptValueIterator>
 
@@ -42,13 +46,18 @@ using namespace std;
 using namespace Eigen;
 
 Document::Document(MainView *view)
-    : QObject(view), _view(view), _sketchIdx(0)
+    : QObject(view), _view(view), _fitService(new FitService(this)), _compareService(new FitService(this)), _sketchIdx(0), _nextSketchId(0)
 {
+    connect(_fitService, SIGNAL(fitted(int, Cornu::PrimitiveSequenceConstPtr, const Cornu::FitStats &)),
+            this, SLOT(_sketchFitted(int, Cornu::PrimitiveSequenceConstPtr)));
+    connect(_compareService, SIGNAL(fitted(int, Cornu::PrimitiveSequenceConstPtr, const Cornu::FitStats &)),
+            this, SLOT(_comparisonFitted(int, Cornu::PrimitiveSequenceConstPtr, const Cornu::FitStats &)));
 }
 
 void Document::curveDrawn(Cornu::PolylineConstPtr polyline)
 {
     Sketch sketch; //selected by default
+    sketch.id = _nextSketchId++;
     sketch.pts = polyline;
     sketch.name = _getNextSketchName();
     sketch.params = _view->paramWidget()->parameters();
@@ -103,6 +112,108 @@ void Document::refitSelected()
     _selectionChanged();
 }
 
+void Document::compareSelected()
+{
+    _clearComparison();
+    _comparison.presets = _view->paramWidget()->checkedPresets();
+
+    vector<int> sketches;
+    for(int i = 0; i < (int)_sketches.size(); ++i)
+    {
+        if(_sketches[i].selected && _sketches[i].sceneItem)
+        {
+            sketches.push_back(i);
+            _comparison.bounds |= _sketches[i].sceneItem->rect();
+        }
+    }
+    int numPresets = (int)_comparison.presets.size();
+    if(sketches.empty() || numPresets == 0)
+        return;
+
+    _comparison.numSketches = (int)sketches.size();
+    _comparison.numLeft.assign(numPresets, _comparison.numSketches);
+    _comparison.numFailed.assign(numPresets, 0);
+    _comparison.numPrimitives.assign(numPresets, 0);
+    _comparison.stats.assign(numPresets, Cornu::FitStats());
+    for(int p = 0; p < numPresets; ++p)
+    {
+        _showComparisonLabel(p);
+        for(int k = 0; k < _comparison.numSketches; ++k)
+        {
+            const Sketch &sketch = _sketches[sketches[k]];
+            FitService::Request request;
+            request.pts = sketch.pts;
+            request.params = _comparison.presets[p];
+            if(sketch.oversketch >= 0) //over the base as it is now, fitted with its own parameters
+                request.oversketchBase = _sketches[sketch.oversketch].curve;
+            request.timed = true;
+            _compareService->submit(p * _comparison.numSketches + k, request);
+        }
+    }
+}
+
+void Document::_clearComparison()
+{
+    _compareService->cancelAll();
+    _view->scene()->clearGroups("Comparison.*");
+    _comparison = Comparison();
+}
+
+void Document::_showComparisonLabel(int preset)
+{
+    QString group = QString("Comparison Label %1").arg(preset);
+    _view->scene()->clearGroups(group);
+
+    QString text = _comparison.presets[preset].name().c_str();
+    if(_comparison.numLeft[preset] > 0)
+        text += QString(": fitting %1").arg(_comparison.numLeft[preset]);
+    else
+    {
+        text += QString(": %1 ms, %2 primitives").arg(_comparison.stats[preset].totalNanoseconds * 1e-6, 0, 'f', 1).arg(_comparison.numPrimitives[preset]);
+        if(_comparison.numFailed[preset] > 0)
+            text += QString(", %1 failed").arg(_comparison.numFailed[preset]);
+        if(_comparison.stats[preset].degraded)
+            text += ", degraded";
+    }
+
+    double shift = _comparison.bounds.width() * 1.2 + 20.;
+    Vector2d pos(_comparison.bounds.left() + shift * (preset + 1), _comparison.bounds.top());
+    _view->scene()->addItem(new TextSceneItem(pos, text, group));
+}
+
+void Document::_comparisonFitted(int jobId, Cornu::PrimitiveSequenceConstPtr curve, const Cornu::FitStats &stats)
+{
+    int preset = jobId / _comparison.numSketches;
+    int numPresets = (int)_comparison.presets.size();
+    QColor color = QColor::fromHsv(360 * preset / numPresets, 255, 200);
+    if(curve)
+    {
+        double shift = _comparison.bounds.width() * 1.2 + 20.;
+        Cornu::PrimitiveSequenceConstPtr moved = curve->transformed(Cornu::Similarity::translation(Vector2d(shift * (preset + 1), 0.)));
+        _view->scene()->addItem(new CurveSceneItem(moved, "Comparison Curves", QPen(color)));
+        _comparison.numPrimitives[preset] += moved->primitives().size();
+    }
+    else
+        ++_comparison.numFailed[preset];
+
+    Cornu::FitStats &sum = _comparison.stats[preset];
+    sum.totalNanoseconds += stats.totalNanoseconds;
+    for(int i = 0; i < Cornu::NUM_ALGORITHM_STAGES; ++i)
+        sum.stageNanoseconds[i] += stats.stageNanoseconds[i];
+    sum.degraded = sum.degraded || stats.degraded;
+    if(--_comparison.numLeft[preset] > 0)
+        return;
+
+    _showComparisonLabel(preset);
+    Cornu::Debugging::get()->printf("%s: %.1f ms", _comparison.presets[preset].name().c_str(), sum.totalNanoseconds * 1e-6);
+    for(int i = 0; i < Cornu::NUM_ALGORITHM_STAGES; ++i)
+    {
+        Cornu::AlgorithmStage stage = (Cornu::AlgorithmStage)i;
+        string stageName = Cornu::AlgorithmBase::get(stage, _comparison.presets[preset].getAlgorithm(stage))->stageName();
+        Cornu::Debugging::get()->printf("    %s: %.2f ms", stageName.c_str(), sum.stageNanoseconds[i] * 1e-6);
+    }
+}
+
 void Document::selectAll()
 {
     for(int i = 0; i < (int)_sketches.size(); ++i)
@@ -124,16 +235,20 @@ void Document::deleteItem()
         if(_sketches[i].selected)
         {
             swap(_sketches[i], _sketches.back());
+            _fitService->cancel(_sketches.back().id);
             _view->scene()->clearGroups(_sketches.back().name);
             _sketches.pop_back();
             --i;
         }
     }
+    _resumeWaiting(); //a deleted sketch's fit was cancelled, and the sketches waiting for it shouldn't wait forever
     _selectionChanged();
 }
 
 void Document::deleteAll()
 {
+    _clearComparison();
+    _fitService->cancelAll();
     _view->scene()->clearGroups("");
     _sketches.clear();
     _sketchIdx = 0;
@@ -162,13 +277,22 @@ void Document::selectAt(const Eigen::Vector2d &point, bool shift, double radius)
     if(!shift)
         clearSelection();
 
+    //only the sketches whose items are near the point need their curves looked at
+    vector<SceneItemPtr> near;
+    _view->scene()->itemsIn(QRectF(point[0] - radius, point[1] - radius, 2. * radius, 2. * radius), near);
+    QSet<const SceneItem *> nearItems;
+    for(int i = 0; i < (int)near.size(); ++i)
+        nearItems.insert(near[i].get());
+
     int closestSketch = -1;
     double minDistSq = radius * radius;
-    for(int i = 0; i < (int)_sketches.size(); ++i)
+    for(int i = 0; i < (int)_sketches.size() && !nearItems.isEmpty(); ++i)
     {
-        if(!_sketches[i].sceneItem)
+        if(!_sketches[i].sceneItem || !nearItems.contains(_sketches[i].sceneItem.get()))
             continue;
-        Cornu::CurveConstPtr curve = _sketches[i].sceneItem->curve();
+        Cornu::PrimitiveSequenceConstPtr curve = _sketches[i].curve;
+        if(curve->boundsDistanceSq(point) >= minDistSq)
+            continue; //can't be closer than what we have
         double distSq = curve->distanceSqTo(point);
         if(distSq < minDistSq)
         {
@@ -185,17 +309,42 @@ void Document::selectAt(const Eigen::Vector2d &point, bool shift, double radius)
 
 void Document::_processSketch(int idx)
 {
-    _view->scene()->clearGroups(_sketches[idx].name);
+    Sketch &sketch = _sketches[idx];
+    sketch.waitingForBase = false;
+    if(sketch.oversketch >= 0 && (_fitService->isPending(_sketches[sketch.oversketch].id) || _sketches[sketch.oversketch].waitingForBase))
+    {
+        _fitService->cancel(sketch.id); //a fit in flight would be over the old base
+        sketch.waitingForBase = true;
+        return;
+    }
 
-    Cornu::Fitter fitter;
+    FitService::Request request;
+    request.pts = sketch.pts;
+    request.params = sketch.params;
+    if(sketch.oversketch >= 0)
+        request.oversketchBase = _sketches[sketch.oversketch].curve;
+    _fitService->submit(sketch.id, request); //supersedes a fit of this sketch in flight
+}
 
-    fitter.setParams(_sketches[idx].params);
-    fitter.setOriginalSketch(_sketches[idx].pts);
-    if(_sketches[idx].oversketch >= 0)
-        fitter.setOversketchBase(_sketches[_sketches[idx].oversketch].curve);
-    fitter.run();
+int Document::_findSketch(int sketchId) const
+{
+    for(int i = 0; i < (int)_sketches.size(); ++i)
+    {
+        if(_sketches[i].id == sketchId)
+            return i;
+    }
+    return -1;
+}
+
+void Document::_sketchFitted(int sketchId, Cornu::PrimitiveSequenceConstPtr curve)
+{
+    int idx = _findSketch(sketchId);
+    if(idx < 0)
+        return;
 
-    _sketches[idx].curve = fitter.finalOutput();
+    _view->scene()->clearGroups(_sketches[idx].name);
+    _sketches[idx].sceneItem = CurveSceneItemPtr();
+    _sketches[idx].curve = curve;
     if(_sketches[idx].curve)
     {
         _sketches[idx].sceneItem = new CurveSceneItem(_sketches[idx].curve, _sketches[idx].name);
@@ -228,6 +377,23 @@ void Document::_processSketch(int idx)
 #endif
 
     }
+
+    _resumeWaiting(); //the sketches over this one can be fitted now, even if its fit failed
+    _selectionChanged();
+}
+
+void Document::_resumeWaiting()
+{
+    for(int i = 0; i < (int)_sketches.size(); ++i)
+    {
+        Sketch &sketch = _sketches[i];
+        if(!sketch.waitingForBase)
+            continue;
+        if(sketch.oversketch >= (int)_sketches.size())
+            sketch.oversketch = -1; //its base was deleted, so it's fitted as a new curve
+        if(sketch.oversketch < 0 || (!_fitService->isPending(_sketches[sketch.oversketch].id) && !_sketches[sketch.oversketch].waitingForBase))
+            _processSketch(i);
+    }
 }
 
 void Document::_selectionChanged() const
@@ -304,11 +470,12 @@ bool Document::_readFile(const QString &message, bool clear) //returns true on s
     for(int i = 0; i < (int)sketches.size(); ++i)
     {
         _sketches.push_back(sketches[i]);
+        _sketches.back().id = _nextSketchId++;
 
         if(sketches[i].oversketch >= 0)
             _sketches.back().oversketch += idxOffset;
 
-        _processSketch(i);
+        _processSketch(idxOffset + i);
     }
 
     _selectionChanged();
@@ -23,9 +23,11 @@
 
 #include "defs.h"
 #include "Parameters.h"
+#include "Fitter.h"
 #include <vector>
 
 #include <QObject>
+#include <QRectF>
 
 class QDataStream;
 class QTextStream;
@@ -37,6 +39,7 @@ namespace Cornu
     CORNU_SMART_FORW_DECL(PrimitiveSequence);
 }
 class MainView;
+class FitService;
 
 class Document : public QObject
 {
@@ -50,6 +53,7 @@ public:
 
 public slots:
     void refitSelected();
+    void compareSelected(); //fits the selected sketches with the presets checked in the parameter widget
     void deleteAll();
     void clearSelection();
     void open();
@@ -58,11 +62,16 @@ public slots:
     void selectAll();
     void deleteItem();
 
+private slots:
+    void _sketchFitted(int sketchId, Cornu::PrimitiveSequenceConstPtr curve);
+    void _comparisonFitted(int jobId, Cornu::PrimitiveSequenceConstPtr curve, const Cornu::FitStats &stats);
+
 private:
     struct Sketch
     {
-        Sketch() : selected(true), oversketch(-1) {}
+        Sketch() : id(-1), selected(true), oversketch(-1), waitingForBase(false) {}
 
+        int id; //stays the same as sketches are deleted, unlike the index
         Cornu::PolylineConstPtr pts;
         QString name;
         Cornu::Parameters params;
@@ -70,10 +79,30 @@ private:
         CurveSceneItemPtr sceneItem;
         bool selected;
         int oversketch; //index of the sketch over which this one is sketched, or -1 if this is a new curve
+        bool waitingForBase; //to be fitted when the sketch it oversketches is
+    };
+
+    //The fits of the selected sketches with each of the compared presets, all at once on the comparison's fit
+    //service, so each preset's timing is of fits that ran side by side with the others'.  Each preset's curves
+    //are drawn in a column to the right of the sketches, under a label with its total time when they're done.
+    struct Comparison
+    {
+        Comparison() : numSketches(0) {}
+
+        std::vector<Cornu::Parameters> presets;
+        int numSketches; //the fit of sketch k with preset p has the job id p * numSketches + k
+        QRectF bounds; //of the sketches' curves
+        std::vector<int> numLeft, numFailed, numPrimitives; //by preset
+        std::vector<Cornu::FitStats> stats; //summed over the fits of each preset
     };
 
+    void _clearComparison();
+    void _showComparisonLabel(int preset);
+
     void _selectionChanged() const;
-    void _processSketch(int idx);
+    void _processSketch(int idx); //starts fitting the sketch in the background
+    void _resumeWaiting(); //fits the sketches waiting for a base that is no longer being fitted
+    int _findSketch(int sketchId) const; //-1 if it was deleted
 
     bool _readFile(const QString &message, bool clear); //returns true on success
     Cornu::PolylineConstPtr _readPts(QDataStream &stream);
@@ -84,7 +113,11 @@ private:
 
     std::vector<Sketch> _sketches;
     MainView *_view;
+    FitService *_fitService;
+    FitService *_compareService;
+    Comparison _comparison;
     int _sketchIdx;
+    int _nextSketchId;
 };
 
 #endif //CORNUCOPIA_DOCUMENT_H_INCLUDED
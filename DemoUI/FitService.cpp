@@ -0,0 +1,110 @@
+/*--
+    FitService.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FitService.h"
+#include "Polyline.h"
+#include "PrimitiveSequence.h"
+#include "DebuggingRing.h"
+
+#include <QtConcurrentRun>
+
+FitService::~FitService()
+{
+    cancelAll(); //the fits still running stop on the pool, and their results are dropped
+}
+
+void FitService::submit(int sketchId, const Request &request)
+{
+    cancel(sketchId);
+
+    Job job;
+    job.cancelled = new Cornu::CancellationToken();
+    job.watcher = new QFutureWatcher<Result>(this);
+    connect(job.watcher, SIGNAL(finished()), this, SLOT(_jobFinished()));
+    job.watcher->setFuture(QtConcurrent::run(&FitService::_fit, request, job.cancelled, _cache));
+    _jobs.insert(sketchId, job);
+}
+
+void FitService::cancel(int sketchId)
+{
+    QMap<int, Job>::iterator it = _jobs.find(sketchId);
+    if(it == _jobs.end())
+        return;
+    it->cancelled->cancel();
+    it->watcher->disconnect(this);
+    it->watcher->deleteLater(); //the future keeps running until the fit stops
+    _jobs.erase(it);
+}
+
+void FitService::cancelAll()
+{
+    while(!_jobs.isEmpty())
+        cancel(_jobs.begin().key());
+}
+
+void FitService::_jobFinished()
+{
+    QFutureWatcher<Result> *watcher = static_cast<QFutureWatcher<Result> *>(sender());
+    int sketchId = -1;
+    for(QMap<int, Job>::iterator it = _jobs.begin(); it != _jobs.end(); ++it)
+    {
+        if(it->watcher == watcher)
+        {
+            sketchId = it.key();
+            _jobs.erase(it);
+            break;
+        }
+    }
+    Result result = watcher->result();
+    watcher->deleteLater();
+    if(sketchId < 0)
+        return; //superseded
+
+    if(result.debugging)
+        result.debugging->replay(Cornu::Debugging::get());
+    emit fitted(sketchId, result.curve, result.stats);
+}
+
+FitService::Result FitService::_fit(Request request, Cornu::CancellationTokenPtr cancelled, Cornu::FitCachePtr cache)
+{
+    Result out;
+    if(cancelled->isCancelled())
+        return out;
+
+    if(Cornu::Debugging::on()) //the main debugging object isn't thread safe, so the output is kept for later
+        out.debugging = QSharedPointer<Cornu::DebuggingRing>(new Cornu::DebuggingRing());
+    Cornu::Debugging::setForCurrentThread(out.debugging ? out.debugging.data() : Cornu::Debugging::null());
+
+    Cornu::Fitter fitter;
+    fitter.setParams(request.params);
+    fitter.setOriginalSketch(request.pts);
+    fitter.setCancellationToken(cancelled);
+    if(!out.debugging && !request.timed)
+        fitter.setCache(cache);
+    if(request.oversketchBase)
+        fitter.setOversketchBase(request.oversketchBase);
+    out.stats = fitter.run();
+    out.curve = fitter.finalOutput();
+
+    Cornu::Debugging::setForCurrentThread(NULL);
+    return out;
+}
+
+#include "FitService.moc"
@@ -0,0 +1,101 @@
+/*--
+    FitService.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_FITSERVICE_H_INCLUDED
+#define CORNUCOPIA_FITSERVICE_H_INCLUDED
+
+#include "defs.h"
+#include "Parameters.h"
+#include "smart_ptr.h"
+#include "CancellationToken.h"
+#include "FitCache.h"
+#include "Fitter.h"
+
+#include <QObject>
+#include <QMap>
+#include <QSharedPointer>
+#include <QFutureWatcher>
+
+namespace Cornu
+{
+    CORNU_SMART_FORW_DECL(Polyline);
+    CORNU_SMART_FORW_DECL(PrimitiveSequence);
+    class DebuggingRing;
+}
+
+//Fits sketches on QtConcurrent's thread pool, so the GUI stays responsive while many curves are refitted.
+//Each sketch (by its id) has at most one fit that counts: submitting a sketch again cancels the fit in
+//flight for it, which stops soon after (see Fitter::setCancellationToken), and its result is dropped.  A
+//cancelled fit that hasn't started yet is skipped.
+//The debugging output of a fit is recorded on its thread and replayed to the main Debugging object, in the
+//GUI thread, when its result is published.  The fits share a cache (see FitCache.h), so undoing, reloading or
+//pasting a sketch doesn't fit it again--except with debugging on, so every fit shows its debugging output, and
+//for requests that are timed.
+class FitService : public QObject
+{
+    Q_OBJECT
+public:
+    struct Request
+    {
+        Request() : timed(false) {}
+
+        Cornu::PolylineConstPtr pts;
+        Cornu::Parameters params;
+        Cornu::PrimitiveSequenceConstPtr oversketchBase; //may be NULL
+        bool timed; //fitted without the cache, so the stats are of a real fit
+    };
+
+    FitService(QObject *parent = NULL) : QObject(parent), _cache(new Cornu::FitCache()) {}
+    ~FitService();
+
+    void submit(int sketchId, const Request &request);
+    void cancel(int sketchId);
+    void cancelAll();
+    bool isPending(int sketchId) const { return _jobs.contains(sketchId); }
+
+signals:
+    //emitted in the GUI thread as the fits complete; curve is NULL if the fit failed
+    void fitted(int sketchId, Cornu::PrimitiveSequenceConstPtr curve, const Cornu::FitStats &stats);
+
+private slots:
+    void _jobFinished();
+
+private:
+    struct Result
+    {
+        Cornu::PrimitiveSequenceConstPtr curve;
+        Cornu::FitStats stats;
+        QSharedPointer<Cornu::DebuggingRing> debugging; //NULL if the fit was skipped or debugging is off
+    };
+
+    struct Job
+    {
+        QFutureWatcher<Result> *watcher;
+        Cornu::CancellationTokenPtr cancelled;
+    };
+
+    //runs on a pool thread
+    static Result _fit(Request request, Cornu::CancellationTokenPtr cancelled, Cornu::FitCachePtr cache);
+
+    QMap<int, Job> _jobs;
+    Cornu::FitCachePtr _cache;
+};
+
+#endif //CORNUCOPIA_FITSERVICE_H_INCLUDED
@@ -71,6 +71,7 @@ ParamWidget::ParamWidget(QWidget *parent)
 
     connect(_ui->presetButton, SIGNAL(clicked()), this, SLOT(makePreset()));
     connect(_ui->rerunButton, SIGNAL(clicked()), this, SIGNAL(rerunClicked()));
+    connect(_ui->compareButton, SIGNAL(clicked()), this, SIGNAL(compareClicked()));
 
     _parametersChanged();
 }
@@ -84,6 +85,19 @@ void ParamWidget::_addPreset(const Cornu::Parameters &params)
 {
     _presets.push_back(params);
     QListWidgetItem *item = new QListWidgetItem(params.name().c_str(), _ui->presetList);
+    item->setFlags(item->flags() | Qt::ItemIsUserCheckable); //checked to be compared
+    item->setCheckState(Qt::Unchecked);
+}
+
+vector<Cornu::Parameters> ParamWidget::checkedPresets() const
+{
+    vector<Cornu::Parameters> out;
+    for(int i = 0; i < (int)_presets.size(); ++i)
+    {
+        if(_ui->presetList->item(i)->checkState() == Qt::Checked)
+            out.push_back(_presets[i]);
+    }
+    return out;
 }
 
 void ParamWidget::setParameter(Cornu::Parameters::ParameterType param, double value)
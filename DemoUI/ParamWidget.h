@@ -42,6 +42,7 @@ public:
     ~ParamWidget();
 
     const Cornu::Parameters &parameters() const { return _parameters; }
+    std::vector<Cornu::Parameters> checkedPresets() const; //the presets to compare
 
 public slots:
     void setParameter(Cornu::Parameters::ParameterType parameter, double value);
@@ -52,6 +53,7 @@ public slots:
 signals:
     void parametersChanged();
     void rerunClicked();
+    void compareClicked();
 
 private:
     void _parametersChanged();
@@ -0,0 +1,142 @@
+/*--
+    SceneIndex.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SceneIndex.h"
+
+#include <algorithm>
+
+using namespace std;
+
+static const int maxNodeEntries = 8; //a node with more is split
+static const double minNodeSize = 1.; //unless it is this small
+
+//QRectF::intersects and contains ignore rectangles with no area, like those of horizontal lines
+static bool touches(const QRectF &a, const QRectF &b)
+{
+    return a.left() <= b.right() && b.left() <= a.right() && a.top() <= b.bottom() && b.top() <= a.bottom();
+}
+
+static bool inside(const QRectF &inner, const QRectF &outer)
+{
+    return inner.left() >= outer.left() && inner.right() <= outer.right() && inner.top() >= outer.top() && inner.bottom() <= outer.bottom();
+}
+
+SceneIndex::Node *SceneIndex::Node::childContaining(const QRectF &rect) const
+{
+    if(!children[0])
+        return NULL;
+    for(int i = 0; i < 4; ++i)
+    {
+        if(inside(rect, children[i]->bounds))
+            return children[i];
+    }
+    return NULL;
+}
+
+void SceneIndex::Node::split()
+{
+    QSizeF half = bounds.size() / 2.;
+    for(int i = 0; i < 4; ++i)
+        children[i] = new Node(QRectF(bounds.topLeft() + QPointF((i % 2) * half.width(), (i / 2) * half.height()), half));
+
+    int kept = 0;
+    for(int i = 0; i < (int)entries.size(); ++i)
+    {
+        Node *child = childContaining(entries[i].rect);
+        if(child)
+            child->entries.push_back(entries[i]);
+        else
+            entries[kept++] = entries[i];
+    }
+    entries.erase(entries.begin() + kept, entries.end());
+}
+
+void SceneIndex::Node::query(const QRectF &rect, vector<int> &out) const
+{
+    for(int i = 0; i < (int)entries.size(); ++i)
+    {
+        if(touches(entries[i].rect, rect))
+            out.push_back(entries[i].key);
+    }
+    if(!children[0])
+        return;
+    for(int i = 0; i < 4; ++i)
+    {
+        if(touches(children[i]->bounds, rect))
+            children[i]->query(rect, out);
+    }
+}
+
+void SceneIndex::_growToContain(const QRectF &rect)
+{
+    if(!_root)
+    {
+        double size = max(minNodeSize, 2. * max(rect.width(), rect.height()));
+        _root = new Node(QRectF(rect.center() - QPointF(size, size) / 2., QSizeF(size, size)));
+    }
+
+    //double the root towards the rectangle, keeping the old root as one of the quadrants
+    while(!inside(rect, _root->bounds))
+    {
+        QRectF old = _root->bounds;
+        int quadrant = (rect.center().x() < old.center().x() ? 1 : 0) + (rect.center().y() < old.center().y() ? 2 : 0);
+        QPointF topLeft = old.topLeft() - QPointF((quadrant % 2) * old.width(), (quadrant / 2) * old.height());
+
+        Node *root = new Node(QRectF(topLeft, old.size() * 2.));
+        QSizeF half = old.size();
+        for(int i = 0; i < 4; ++i)
+            root->children[i] = (i == quadrant) ? _root : new Node(QRectF(topLeft + QPointF((i % 2) * half.width(), (i / 2) * half.height()), half));
+        _root = root;
+    }
+}
+
+void SceneIndex::insert(int key, const QRectF &rect)
+{
+    _growToContain(rect);
+
+    Node *node = _root;
+    while(Node *child = node->childContaining(rect))
+        node = child;
+
+    node->entries.push_back(Entry(key, rect));
+    if(!node->children[0] && (int)node->entries.size() > maxNodeEntries && node->bounds.width() > minNodeSize)
+        node->split();
+}
+
+void SceneIndex::remove(int key, const QRectF &rect)
+{
+    for(Node *node = _root; node; node = node->childContaining(rect))
+    {
+        for(int i = 0; i < (int)node->entries.size(); ++i)
+        {
+            if(node->entries[i].key != key)
+                continue;
+            node->entries[i] = node->entries.back();
+            node->entries.pop_back();
+            return;
+        }
+    }
+}
+
+void SceneIndex::query(const QRectF &rect, vector<int> &out) const
+{
+    if(_root)
+        _root->query(rect, out);
+}
@@ -0,0 +1,76 @@
+/*--
+    SceneIndex.h
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CORNUCOPIA_SCENEINDEX_H_INCLUDED
+#define CORNUCOPIA_SCENEINDEX_H_INCLUDED
+
+#include "defs.h"
+
+#include <vector>
+
+#include <QRectF>
+
+//A quadtree of rectangles, each with an integer key, for finding the ones in a region without looking at all
+//of them.  A rectangle is stored in the deepest node that contains it, and the root grows to fit new ones.
+class SceneIndex
+{
+public:
+    SceneIndex() : _root(NULL) {}
+    ~SceneIndex() { delete _root; }
+
+    void insert(int key, const QRectF &rect);
+    void remove(int key, const QRectF &rect); //rect must be the one the key was inserted with
+    void clear() { delete _root; _root = NULL; }
+
+    //appends the keys of the rectangles that touch rect, in no particular order
+    void query(const QRectF &rect, std::vector<int> &out) const;
+
+private:
+    SceneIndex(const SceneIndex &); //not copyable
+    SceneIndex &operator=(const SceneIndex &);
+
+    struct Entry
+    {
+        Entry(int inKey, const QRectF &inRect) : key(inKey), rect(inRect) {}
+
+        int key;
+        QRectF rect;
+    };
+
+    struct Node
+    {
+        Node(const QRectF &inBounds) : bounds(inBounds) { children[0] = children[1] = children[2] = children[3] = NULL; }
+        ~Node() { for(int i = 0; i < 4; ++i) delete children[i]; }
+
+        Node *childContaining(const QRectF &rect) const; //NULL if there are no children or it straddles them
+        void split();
+        void query(const QRectF &rect, std::vector<int> &out) const;
+
+        QRectF bounds;
+        std::vector<Entry> entries;
+        Node *children[4];
+    };
+
+    void _growToContain(const QRectF &rect);
+
+    Node *_root;
+};
+
+#endif //CORNUCOPIA_SCENEINDEX_H_INCLUDED
@@ -20,7 +20,6 @@
 
 #include "SceneItem.h"
 #include "Curve.h"
-#include "Polyline.h"
 
 #include <QPainter>
 
@@ -60,44 +59,53 @@ QRectF LineSceneItem::rect() const
     return QRectF(_p1, _p2).normalized();
 }
 
+TextSceneItem::TextSceneItem(const Vector2d &pos, QString text, QString group, QPen pen)
+: SceneItem(group, pen), _pos(pos[0], pos[1]), _text(text)
+{
+}
+
+void TextSceneItem::draw(QPainter *p, const QTransform &transform) const
+{
+    p->setPen(_pen);
+    p->drawText(transform.map(_pos) - QPointF(0, 4), _text);
+}
+
+QRectF TextSceneItem::rect() const
+{
+    return QRectF(_pos, QSizeF(1, 1)); //drawn when its corner is in view
+}
+
 CurveSceneItem::CurveSceneItem(Cornu::CurveConstPtr curve, QString group, QPen pen, QBrush brush)
 : SceneItem(group, pen, brush), _curve(curve)
 {
-    Vector2d pt;
-
-    //dynamically check if it's a polyline
-    Cornu::PolylineConstPtr polyline = Cornu::dynamic_pointer_cast<const Cornu::Polyline>(curve);
-    if(polyline)
-    {
-        for(int i = 0; i < (int)polyline->pts().size(); ++i)
-        {
-            pt = polyline->pts()[i];
-            _curveTess.push_back(QPointF(pt[0], pt[1]));
-        }
-        if(polyline->isClosed())
-        {
-            pt = polyline->pts()[0];
-            _curveTess.push_back(QPointF(pt[0], pt[1]));
-        }
-    }
-    else
-    {
-        for(double s = 0; s < curve->length(); s += 2.) //skip pixels
-        {
-             pt = curve->pos(s);
-            _curveTess.push_back(QPointF(pt[0], pt[1]));
-        }
-        pt = curve->endPos();
-        _curveTess.push_back(QPointF(pt[0], pt[1]));
-    }
-
-    _rect = _curveTess.boundingRect();
+    _rect = _tessellation(0).boundingRect();
 }
 
 void CurveSceneItem::draw(QPainter *p, const QTransform &transform) const
 {
+    const int maxLevel = 8; //beyond the zoom range either way
+    double scale = max(1e-6, sqrt(fabs(transform.determinant()))); //also right for rotated or flipped views
+    int level = (int)ceil(log(scale) / log(4.));
+    level = max(-maxLevel, min(maxLevel, level));
+
     p->setPen(_pen);
-    p->drawPolyline(transform.map(_curveTess));
+    p->drawPolyline(transform.map(_tessellation(level)));
+}
+
+const QPolygonF &CurveSceneItem::_tessellation(int level) const
+{
+    map<int, QPolygonF>::iterator it = _tessellations.find(level);
+    if(it != _tessellations.end())
+        return it->second;
+
+    //half a pixel at the largest zoom of the level
+    Cornu::Curve::PointVector pts;
+    _curve->tessellate(0.5 * pow(4., -level), pts);
+
+    QPolygonF &out = _tessellations[level];
+    for(int i = 0; i < (int)pts.size(); ++i)
+        out.push_back(QPointF(pts[i][0], pts[i][1]));
+    return out;
 }
 
 void ImageSceneItem::draw(QPainter *p, const QTransform &transform) const
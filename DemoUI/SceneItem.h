@@ -31,6 +31,8 @@
 
 #include <Eigen/Core>
 
+#include <map>
+
 class SceneItem : public Cornu::smart_base
 {
 public:
@@ -81,6 +83,21 @@ private:
     QPointF _p1, _p2;
 };
 
+//a line of text whose size doesn't change with the zoom, with its baseline a little above pos
+class TextSceneItem : public SceneItem
+{
+public:
+    TextSceneItem(const Eigen::Vector2d &pos, QString text, QString group, QPen pen = QPen());
+
+    //overrides
+    void draw(QPainter *p, const QTransform &transform) const;
+    QRectF rect() const;
+
+private:
+    QPointF _pos;
+    QString _text;
+};
+
 class CurveSceneItem : public SceneItem
 {
 public:
@@ -93,9 +110,11 @@ public:
     QRectF rect() const { return _rect; }
 
 private:
+    const QPolygonF &_tessellation(int level) const; //built on first use
+
     Cornu::CurveConstPtr _curve;
     QRectF _rect;
-    QPolygonF _curveTess;
+    mutable std::map<int, QPolygonF> _tessellations; //level l is for zooms up to 4^l
 };
 
 class ImageSceneItem : public SceneItem
@@ -21,17 +21,21 @@
 #include "ScrollScene.h"
 #include "SceneItem.h"
 
+#include <algorithm>
+
+#include <QPainter>
+
 using namespace std;
 using namespace Eigen;
 
 QRectF ScrollScene::rect() const
 {
     QRectF out;
-    for(int i = 0; i < (int)_items.size(); ++i)
+    for(map<int, SceneItemPtr>::const_iterator it = _items.begin(); it != _items.end(); ++it)
     {
-        if(_invisibleGroups.contains(_items[i]->group()))
+        if(_invisibleGroups.contains(it->second->group()))
             continue;
-        out |= _items[i]->rect();
+        out |= it->second->rect();
     }
 
     return out;
@@ -39,43 +43,60 @@ QRectF ScrollScene::rect() const
 
 void ScrollScene::draw(QPainter *p, const QTransform &transform) const
 {
-    for(int i = 0; i < (int)_items.size(); ++i)
+    //only the items near the viewport--the slack is for pens and points, whose sizes are in pixels
+    const double slack = 10.;
+    QRectF visible = transform.inverted().mapRect(QRectF(p->viewport()).adjusted(-slack, -slack, slack, slack));
+
+    vector<SceneItemPtr> items;
+    itemsIn(visible, items);
+    for(int i = 0; i < (int)items.size(); ++i)
     {
-        if(_invisibleGroups.contains(_items[i]->group()))
+        if(_invisibleGroups.contains(items[i]->group()))
             continue;
-        _items[i]->draw(p, transform);
+        items[i]->draw(p, transform);
     }
 }
 
 void ScrollScene::addItem(SceneItemPtr item)
 {
-    if(item->addToBeginning())
-        _items.insert(_items.begin(), item);
-    else
-        _items.push_back(item);
+    int key = item->addToBeginning() ? --_firstKey : _nextKey++;
+    _items[key] = item;
+    _index.insert(key, item->rect());
     emit sceneChanged();
 }
 
+void ScrollScene::itemsIn(const QRectF &rect, vector<SceneItemPtr> &out) const
+{
+    vector<int> keys;
+    _index.query(rect, keys);
+    sort(keys.begin(), keys.end());
+
+    for(int i = 0; i < (int)keys.size(); ++i)
+        out.push_back(_items.find(keys[i])->second);
+}
+
 void ScrollScene::clearGroups(QString groups)
 {
     if(groups.isEmpty())
     {
         _items.clear();
+        _index.clear();
         emit sceneChanged();
         return;
     }
 
     QRegExp groupExp(groups);
 
-    int deleted = 0;
-    for(int i = 0; i < (int)_items.size(); ++i)
+    for(map<int, SceneItemPtr>::iterator it = _items.begin(); it != _items.end(); )
     {
-        if(groupExp.exactMatch(_items[i]->group()))
-            ++deleted;
+        if(groupExp.exactMatch(it->second->group()))
+        {
+            _index.remove(it->first, it->second->rect());
+            _items.erase(it++);
+        }
         else
-            _items[i - deleted] = _items[i];
+            ++it;
     }
-    _items.resize((int)_items.size() - deleted);
 
     emit sceneChanged();
 }
@@ -101,8 +122,8 @@ QSet<QString> ScrollScene::getAllGroups() const
 {
     QSet<QString> out;
 
-    for(int i = 0; i < (int)_items.size(); ++i)
-        out.insert(_items[i]->group());
+    for(map<int, SceneItemPtr>::const_iterator it = _items.begin(); it != _items.end(); ++it)
+        out.insert(it->second->group());
 
     return out;
 }
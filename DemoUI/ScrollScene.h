@@ -23,7 +23,9 @@
 
 #include "defs.h"
 #include "smart_ptr.h"
+#include "SceneIndex.h"
 
+#include <map>
 #include <vector>
 
 #include <QObject>
@@ -38,13 +40,16 @@ class ScrollScene : public QObject
 {
     Q_OBJECT
 public:
-    ScrollScene(QObject *parent = NULL) : QObject(parent) {}
+    ScrollScene(QObject *parent = NULL) : QObject(parent), _firstKey(0), _nextKey(0) {}
 
     QRectF rect() const;
     void draw(QPainter *p, const QTransform &transform) const;
 
     void addItem(SceneItemPtr item);
 
+    //appends the items, visible or not, whose rectangles touch rect, in drawing order
+    void itemsIn(const QRectF &rect, std::vector<SceneItemPtr> &out) const;
+
     void clearGroups(QString groups);
     bool isGroupVisible(QString group) const;
     QSet<QString> getAllGroups() const;
@@ -57,7 +62,9 @@ signals:
 
 protected:
     QSet<QString> _invisibleGroups;
-    std::vector<SceneItemPtr> _items;
+    std::map<int, SceneItemPtr> _items; //keyed by drawing order: items added to the beginning get smaller keys
+    SceneIndex _index; //of the item rectangles, by the same keys
+    int _firstKey, _nextKey;
 };
 
 #endif //CORNUCOPIA_SCROLLSCENE_H_INCLUDED
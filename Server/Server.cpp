@@ -0,0 +1,199 @@
+/*--
+    Server.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//A fitting daemon, to run as a sidecar so the processes that want fits don't each start up the library: it
+//listens on a local (Unix domain) socket and fits the sketch files it gets with a FitServer, whose threads
+//keep their Fitters between strokes.  Each message, both ways, is a 64-bit byte count in the machine's byte
+//order followed by that many bytes: a request is a sketch file (see SketchFile.h) and its reply is a fit reply
+//(see FitServer.h), or empty if the request isn't a valid sketch file.  A connection sends a request and waits
+//for its reply before sending the next; clients that want more in flight open more connections, and the strokes
+//of all of them are fitted by the same threads.
+
+#include "FitServer.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <signal.h>
+#endif
+
+using namespace std;
+using namespace Cornu;
+
+static const uint64_t maxRequestSize = uint64_t(1) << 26; //64 MiB; a larger count is taken as a broken client
+
+//the number of open connections, each of which has a thread and a request buffer of up to maxRequestSize
+static mutex connectionMutex;
+static condition_variable connectionClosed;
+static int numConnections = 0;
+
+static void usage()
+{
+    printf("Usage: CornucopiaServer [-socket path] [-threads n] [-connections n]\n");
+    printf("   -socket      the socket to listen on (default /tmp/cornucopia.sock)\n");
+    printf("   -threads     the number of fitting threads, 0 for one per core (default)\n");
+    printf("   -connections the most connections served at once, later ones wait to be accepted (default 64)\n");
+}
+
+#ifndef _WIN32
+
+static bool readAll(int fd, void *data, size_t size)
+{
+    char *bytes = (char *)data;
+    while(size > 0)
+    {
+        ssize_t got = read(fd, bytes, size);
+        if(got <= 0)
+            return false;
+        bytes += got;
+        size -= (size_t)got;
+    }
+    return true;
+}
+
+static bool writeAll(int fd, const void *data, size_t size)
+{
+    const char *bytes = (const char *)data;
+    while(size > 0)
+    {
+        ssize_t put = write(fd, bytes, size);
+        if(put <= 0)
+            return false;
+        bytes += put;
+        size -= (size_t)put;
+    }
+    return true;
+}
+
+static void serve(int fd, FitServer *service)
+{
+    vector<char> request;
+    while(true)
+    {
+        uint64_t size;
+        if(!readAll(fd, &size, sizeof(size)) || size > maxRequestSize)
+            break;
+        request.resize((size_t)size);
+        if(size > 0 && !readAll(fd, &(request[0]), (size_t)size))
+            break;
+
+        vector<char> reply = service->fit(request.empty() ? NULL : &(request[0]), request.size());
+        uint64_t replySize = reply.size();
+        if(!writeAll(fd, &replySize, sizeof(replySize)) || (replySize > 0 && !writeAll(fd, &(reply[0]), reply.size())))
+            break;
+    }
+    close(fd);
+
+    lock_guard<mutex> lock(connectionMutex);
+    --numConnections;
+    connectionClosed.notify_one();
+}
+
+int main(int argc, char **argv)
+{
+    string socketPath = "/tmp/cornucopia.sock";
+    int numThreads = 0;
+    int maxConnections = 64;
+    for(int i = 1; i < argc; ++i)
+    {
+        if(!strcmp(argv[i], "-socket") && i + 1 < argc)
+            socketPath = argv[++i];
+        else if(!strcmp(argv[i], "-threads") && i + 1 < argc)
+            numThreads = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-connections") && i + 1 < argc && atoi(argv[i + 1]) > 0)
+            maxConnections = atoi(argv[++i]);
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(socketPath.size() >= sizeof(address.sun_path))
+    {
+        printf("Socket path %s is too long\n", socketPath.c_str());
+        return 1;
+    }
+    strcpy(address.sun_path, socketPath.c_str());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socketPath.c_str()); //left over from an earlier run
+    if(listener < 0 || bind(listener, (sockaddr *)&address, sizeof(address)) < 0 || listen(listener, 64) < 0)
+    {
+        printf("Could not listen on %s: %s\n", socketPath.c_str(), strerror(errno));
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN); //a client that goes away just ends its connection
+
+    FitServer service(numThreads);
+    printf("Listening on %s with %d fitting threads\n", socketPath.c_str(), service.numThreads());
+    fflush(stdout);
+
+    while(true)
+    {
+        {
+            unique_lock<mutex> lock(connectionMutex);
+            while(numConnections >= maxConnections) //the waiting clients queue in the listen backlog
+                connectionClosed.wait(lock);
+        }
+
+        int fd = accept(listener, NULL, NULL);
+        if(fd < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            printf("accept failed: %s\n", strerror(errno));
+            break;
+        }
+        {
+            lock_guard<mutex> lock(connectionMutex);
+            ++numConnections;
+        }
+        thread(serve, fd, &service).detach();
+    }
+
+    close(listener);
+    unlink(socketPath.c_str());
+    return 1;
+}
+
+#else //_WIN32
+
+int main(int argc, char **argv)
+{
+    usage();
+    printf("CornucopiaServer needs Unix domain sockets, which this build doesn't support\n");
+    return 1;
+}
+
+#endif //_WIN32
@@ -41,6 +41,7 @@ public:
         testLine();
         testArc();
         testClothoid();
+        testClothoidEval();
     }
 
     void testLine()
@@ -136,6 +137,13 @@ public:
 
                     clothoid->derivativeAt(s, der, tanDer);
 
+                    //evaluating together with the derivatives should give the same values
+                    Vector2d pos, tangent;
+                    CurvePrimitive::ParamDer der2, tanDer2;
+                    clothoid->evalWithDerivatives(s, &pos, &tangent, der2, tanDer2);
+                    CORNU_ASSERT_LT_MSG((pos - clothoid->pos(s)).norm() + (tangent - clothoid->der(s)).norm(), 1e-12, "Incorrect evaluation with derivatives");
+                    CORNU_ASSERT(der2 == der && tanDer2 == tanDer);
+
                     double delta = 5e-6;
                     for(int i = 0; i < (int)params.size(); ++i)
                     {
@@ -160,6 +168,30 @@ public:
             }
         }
     }
+
+    //Clothoids that are almost arcs are evaluated differently--compare both kinds with integrating the tangent
+    void testClothoidEval()
+    {
+        const double devs[] = { 1e-8, 1e-5, 1e-3, 0.5 };
+        for(int i = 0; i < 4; ++i)
+        {
+            for(double turn = -20.; turn < 21.; turn += 4.)
+            {
+                double length = 7., curvature = turn / length;
+                ClothoidPtr clothoid = new Clothoid(Vector2d(1., 3.), 0.5, length, curvature, curvature + 2. * devs[i] / length);
+
+                const int steps = 20000; //Simpson's rule
+                double h = length / steps;
+                Vector2d pos = clothoid->startPos();
+                for(int j = 0; j < steps; ++j)
+                {
+                    if(j % 2000 == 0)
+                        CORNU_ASSERT_LT_MSG((pos - clothoid->pos(j * h)).norm(), 1e-11, "Incorrect clothoid evaluation");
+                    pos += h / 6. * (clothoid->der(j * h) + 4. * clothoid->der((j + 0.5) * h) + clothoid->der((j + 1) * h));
+                }
+            }
+        }
+    }
 };
 
 static CurveDerivativesTest test;
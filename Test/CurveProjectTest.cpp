@@ -91,6 +91,11 @@ public:
             if(s > tol && s < curve->length() - tol)
                 maxDot = max(maxDot, fabs(dot));
 
+            //any hint should give the same point, up to the accuracy of project
+            double nearS = curve->projectNear(pt, drand(0, curve->length()));
+            CORNU_ASSERT_LT_MSG((pt - curve->pos(nearS)).norm(), projDist + tol, "Projection from hint should be closest point");
+            CORNU_ASSERT_LT_MSG(projDist, (pt - curve->pos(nearS)).norm() + tol, "Projection from hint should be closest point");
+
             double newS = curve->project(curvePt);
             if(!curve->isClosed() || fabs(s - newS) + tol < curve->length())
                 CORNU_ASSERT_LT_MSG(fabs(s - newS), tol, "Projecting again should yield the same result");
@@ -102,6 +107,25 @@ public:
                 CORNU_ASSERT_LT_MSG(projDist, (pt - newPt).norm() + tol * (pt - newPt).squaredNorm(), "Projection should be closest point");
             }
         }
+        //the batched versions should agree with the one-at-a-time versions
+        const int numBatch = 50;
+        Curve::PointVector batchPts(numBatch), batchPos(numBatch), batchDer(numBatch);
+        vector<double> batchS(numBatch), batchDistSq(numBatch);
+        for(int i = 0; i < numBatch; ++i)
+            batchPts[i] = Vector2d(drand(-10, 10), drand(-10, 10));
+        curve->projectMany(&(batchPts[0]), numBatch, &(batchS[0]));
+        curve->evalMany(&(batchS[0]), numBatch, &(batchPos[0]), &(batchDer[0]));
+        curve->distanceSqMany(&(batchPts[0]), numBatch, &(batchDistSq[0]));
+        for(int i = 0; i < numBatch; ++i)
+        {
+            CORNU_ASSERT_LT_MSG(fabs(batchS[i] - curve->project(batchPts[i])), 1e-12, "projectMany should agree with project");
+            CORNU_ASSERT_LT_MSG((batchPos[i] - curve->pos(batchS[i])).norm(), 1e-12, "evalMany should agree with pos");
+            CORNU_ASSERT_LT_MSG((batchDer[i] - curve->der(batchS[i])).norm(), 1e-12, "evalMany should agree with der");
+            double distSq = (batchPts[i] - batchPos[i]).squaredNorm();
+            CORNU_ASSERT_LT_MSG(fabs(batchDistSq[i] - distSq), 1e-9 * (1. + distSq), "distanceSqMany should agree with projecting");
+            CORNU_ASSERT_LT_MSG(fabs(curve->distanceSqTo(batchPts[i]) - distSq), 1e-9 * (1. + distSq), "distanceSqTo should agree with projecting");
+        }
+
         if(false) for(int i = 0; i < 105000; ++i)
         {
             Vector2d pt = Vector2d(drand(-10, 10), drand(-10, 10));
@@ -22,6 +22,26 @@
 #include "Test.h"
 #include "SimpleAPI.h" //just the simple API
 #include "Cornucopia.h" //includes everything necessary to use the library
+#include "PrimitiveFitter.h"
+#include "ErrorComputer.h"
+#include "Preprocessing.h"
+#include "Resampler.h"
+#include "DebuggingRing.h"
+#include "GraphConstructor.h"
+#include "Dataset.h"
+#include "EdgeCostModel.h"
+#include "Parallel.h"
+#include "SketchFile.h"
+#include "FitServer.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <sstream>
+#include <thread>
+#include <Eigen/Geometry>
+
+using Cornu::Debugging; //for the assertion macros
 
 class EndToEndTest : public TestCase
 {
@@ -33,7 +53,40 @@ public:
     void run()
     {
         simpleAPITest();
+        batchAPITest();
+        bufferAPITest();
+        pooledFitTest();
+        pipelineTest(Cornu::FitPipeline::defaultThreadFirstStages(), 0);
+        pipelineTest(Cornu::FitPipeline::everyStage(), 3);
         fullAPITest();
+        incrementalTest(Cornu::Parameters());
+        incrementalTest(streamingParams());
+        paramChangeTest();
+        debuggingRingTest();
+        tracingTest();
+        timeBudgetTest();
+        cancellationTest();
+        reuseTest();
+        releaseOutputsTest();
+        cacheTest();
+        canonicalCacheTest();
+        hierarchicalTest();
+        validationEarlyStopTest();
+        dominancePruningTest();
+        candidateSteppingTest();
+        fastSimpleStrokesTest();
+        fresnelTierTest();
+        batchedErrorsTest();
+        footPointsTest();
+        fitServiceTest();
+        datasetTest();
+        edgeCostModelTest();
+        pathValidationStopTest();
+        oversketchLocalityTest();
+        jointTest();
+        closedCircleTest();
+        lazyParametersTest();
+        parallelResamplingTest();
     }
 
     void simpleAPITest()
@@ -62,6 +115,147 @@ public:
         Cornu::Debugging::get()->printf("Conversion to Bezier results in %d segments\n", bezier.size());
     }
 
+    void batchAPITest()
+    {
+        Cornu::Parameters params;
+        std::vector<std::vector<Cornu::Point> > strokes(20);
+
+        for(int i = 0; i < (int)strokes.size(); ++i)
+        {
+            for(int j = 0; j <= 10 + i; ++j) //strokes of different sizes and shapes
+                strokes[i].push_back(Cornu::Point(100 + 10 * j, 100 + (i % 3) * 0.01 * j * j * j + 20 * sin(0.3 * i * j)));
+        }
+
+        std::vector<bool> closed;
+        std::vector<std::vector<Cornu::BasicPrimitive> > batch = Cornu::fitBatch(strokes, params, &closed, 4);
+
+        CORNU_ASSERT(batch.size() == strokes.size() && closed.size() == strokes.size());
+        for(int i = 0; i < (int)strokes.size(); ++i) //should match fitting one at a time
+        {
+            bool singleClosed;
+            std::vector<Cornu::BasicPrimitive> single = Cornu::fit(strokes[i], params, &singleClosed);
+            CORNU_ASSERT_MSG(single.size() == batch[i].size(), "Batch result differs for stroke " << i);
+            CORNU_ASSERT(singleClosed == closed[i]);
+            for(int j = 0; j < (int)single.size(); ++j)
+            {
+                CORNU_ASSERT(single[j].type == batch[i][j].type);
+                CORNU_ASSERT(single[j].length == batch[i][j].length);
+            }
+        }
+
+        Cornu::Debugging::get()->printf("Batch API fit %d strokes\n", (int)batch.size());
+    }
+
+    //fitting from and into caller buffers should give what the vector version does
+    void bufferAPITest()
+    {
+        Cornu::Parameters params;
+        Cornu::FitCachePtr cache = new Cornu::FitCache();
+        std::vector<Cornu::Point> pts;
+        std::vector<double> xyp; //with a third value per point, e.g., a pressure, that isn't read
+        for(int i = 0; i < 40; ++i)
+        {
+            pts.push_back(Cornu::Point(100 + 8 * i, 100 + 50 * sin(0.15 * i)));
+            xyp.push_back(pts.back().x);
+            xyp.push_back(pts.back().y);
+            xyp.push_back(0.5);
+        }
+
+        bool closed = true, bufferClosed = false;
+        std::vector<Cornu::BasicPrimitive> expected = Cornu::fit(pts, params, &closed);
+        CORNU_ASSERT(expected.size() > 1);
+
+        size_t size = Cornu::fit(&xyp[0], pts.size(), 3, params, NULL, 0, NULL, cache);
+        CORNU_ASSERT_MSG(size == expected.size(), "Wrong size from a buffer fit: " << size);
+        std::vector<Cornu::BasicPrimitive> out(size + 1);
+        out.back().length = -1; //shouldn't be written
+        CORNU_ASSERT(Cornu::fit(&xyp[0], pts.size(), 3, params, &out[0], size, &bufferClosed, cache) == size);
+        CORNU_ASSERT(cache->hits() == 1 && bufferClosed == closed && out.back().length == -1);
+        for(size_t i = 0; i < size; ++i)
+        {
+            CORNU_ASSERT(out[i].type == expected[i].type && out[i].length == expected[i].length);
+            CORNU_ASSERT(out[i].start.x == expected[i].start.x && out[i].startCurvature == expected[i].startCurvature);
+        }
+
+        //a buffer too small gets the start of the fit
+        std::vector<Cornu::BasicPrimitive> part(1);
+        CORNU_ASSERT(Cornu::fit(&xyp[0], pts.size(), 3, params, &part[0], 1, NULL, cache) == size);
+        CORNU_ASSERT(part[0].length == expected[0].length);
+        CORNU_ASSERT(Cornu::fit(&xyp[0], 1, 3, params, NULL, 0, &bufferClosed) == 0 && !bufferClosed);
+    }
+
+    //the fitters fit(...) keeps between calls shouldn't make a fit depend on the ones before it
+    void pooledFitTest()
+    {
+        const std::vector<Cornu::Parameters> &presets = Cornu::Parameters::presets();
+        for(int k = 0; k < 6; ++k)
+        {
+            const Cornu::Parameters &kParams = presets[k % presets.size()]; //the parameters change between the fits
+            std::vector<Cornu::Point> pts;
+            for(int i = 0; i < 30 + 7 * k; ++i)
+                pts.push_back(Cornu::Point(100 + 8 * i, 100 + 40 * sin((0.1 + 0.02 * k) * i)));
+
+            bool closed = true;
+            std::vector<Cornu::BasicPrimitive> pooled = Cornu::fit(pts, kParams, &closed);
+
+            Cornu::Fitter fresh;
+            fresh.setParams(kParams);
+            fresh.setOriginalSketch(new Cornu::Polyline(&pts[0].x, (int)pts.size(), 2));
+            fresh.run();
+            if(!fresh.finalOutput())
+            {
+                CORNU_ASSERT_MSG(pooled.empty(), "Pooled fit succeeded for stroke " << k << " whose fresh fit failed");
+                continue;
+            }
+            const Cornu::VectorC<Cornu::CurvePrimitiveConstPtr> &expected = fresh.finalOutput()->primitives();
+            CORNU_ASSERT_MSG(pooled.size() == (size_t)expected.size(), "Pooled fit differs for stroke " << k);
+            CORNU_ASSERT(closed == fresh.finalOutput()->isClosed());
+            for(int i = 0; i < expected.size(); ++i)
+                CORNU_ASSERT(pooled[i].length == expected[i]->length() && pooled[i].startAngle == expected[i]->startAngle());
+        }
+    }
+
+    //strokes going through a pipeline should come out in order, fitted as by Fitter::run
+    void pipelineTest(const std::vector<Cornu::AlgorithmStage> &threadFirstStages, int maxInFlight)
+    {
+        Cornu::Parameters params;
+        std::vector<Cornu::PolylineConstPtr> strokes(12);
+        for(int i = 0; i < (int)strokes.size(); ++i)
+        {
+            Cornu::VectorC<Eigen::Vector2d> pts(15 + 3 * i, Cornu::NOT_CIRCULAR);
+            for(int j = 0; j < pts.size(); ++j)
+                pts[j] = Eigen::Vector2d(100 + 10 * j, 100 + 30 * sin((0.2 + 0.02 * i) * j));
+            strokes[i] = new Cornu::Polyline(pts);
+        }
+
+        Cornu::FitPipeline pipeline(params, threadFirstStages, maxInFlight);
+        Cornu::FitPipeline::Result result;
+        int numTaken = 0;
+        for(int i = 0; i <= (int)strokes.size(); ++i)
+        {
+            if(i < (int)strokes.size())
+                pipeline.submit(strokes[i]);
+            if(i < 4) //let some results pile up
+                continue;
+            while(numTaken < i - 1 && pipeline.takeResult(result))
+            {
+                int k = numTaken++;
+                Cornu::Fitter fitter;
+                fitter.setOriginalSketch(strokes[k]);
+                fitter.run();
+                CORNU_ASSERT_MSG(!result.curve == !fitter.finalOutput(), "Pipeline fit differs for stroke " << k);
+                CORNU_ASSERT(result.stats.numGraphEdges == fitter.stats().numGraphEdges);
+                if(!result.curve) //some of the short strokes are degenerate
+                    continue;
+                CORNU_ASSERT_MSG(result.curve->primitives().size() == fitter.finalOutput()->primitives().size(), "Pipeline result differs for stroke " << k);
+                CORNU_ASSERT(fabs(result.curve->length() - fitter.finalOutput()->length()) < 1e-8);
+            }
+        }
+        while(pipeline.takeResult(result))
+            ++numTaken;
+        CORNU_ASSERT(numTaken == (int)strokes.size());
+    }
+
     void fullAPITest()
     {
         //initialize the fitter
@@ -79,7 +273,16 @@ public:
 
         //pass it to the fitter and process it
         fitter.setOriginalSketch(new Cornu::Polyline(pts));
-        fitter.run(); //to see why this prints debugging output, look at DebuggingTestImpl in Test.cpp
+        const Cornu::FitStats &stats = fitter.run(); //to see why this prints debugging output, look at DebuggingTestImpl in Test.cpp
+        CORNU_ASSERT(stats.numResampledPoints > 0 && stats.numCandidatePrimitives > 0 && stats.numGraphEdges > 0);
+        CORNU_ASSERT(stats.numValidatedEdges > 0 && stats.totalNanoseconds >= stats.stageNanoseconds[Cornu::PRIMITIVE_FITTING]);
+#if CORNU_COUNTERS
+        CORNU_ASSERT(stats.counters[Cornu::WorkCounters::EDGE_VALIDATIONS] >= stats.numValidatedEdges);
+        CORNU_ASSERT(stats.counters[Cornu::WorkCounters::LS_ITERATIONS] >= stats.numLSIterations && stats.counters[Cornu::WorkCounters::FRESNEL_VALUES] > 0);
+#endif
+        int numPrimitives = stats.numCandidatePrimitives;
+        fitter.run(); //nothing changed, so no stage runs but the counts stay
+        CORNU_ASSERT(stats.stageNanoseconds[Cornu::PRIMITIVE_FITTING] == 0 && stats.numCandidatePrimitives == numPrimitives);
 
         //process the output -- count the number of primitives of each type
         Cornu::PrimitiveSequenceConstPtr output = fitter.finalOutput();
@@ -114,6 +317,1176 @@ public:
 
         //output is destroyed with the destruction of the smart pointer and the fitter
     }
+
+    //default parameters, except the preliminary resampling keeps up with points as they are appended
+    Cornu::Parameters streamingParams()
+    {
+        Cornu::Parameters params;
+        std::vector<std::string> names = Cornu::Algorithm<Cornu::PRELIM_RESAMPLING>::names();
+        int streaming = (int)(std::find(names.begin(), names.end(), "Streaming") - names.begin());
+        CORNU_ASSERT(streaming < (int)names.size());
+        params.setAlgorithm(Cornu::PRELIM_RESAMPLING, streaming);
+        return params;
+    }
+
+    void incrementalTest(const Cornu::Parameters &params)
+    {
+        Cornu::VectorC<Eigen::Vector2d> pts(120, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < pts.size(); ++i)
+            pts[i] = Eigen::Vector2d(100 + 3 * i, 200 + 40 * sin(0.05 * i));
+
+        //feed the points to one fitter a few at a time, as if the curve was being drawn
+        Cornu::Fitter incremental;
+        incremental.setParams(params);
+        int numReused = 0;
+        for(int start = 0; start < pts.size(); start += 10)
+        {
+            Cornu::VectorC<Eigen::Vector2d> newPts(std::min(10, pts.size() - start), Cornu::NOT_CIRCULAR);
+            for(int i = 0; i < newPts.size(); ++i)
+                newPts[i] = pts[start + i];
+            incremental.appendPoints(newPts);
+
+            Cornu::smart_ptr<const Cornu::AlgorithmOutput<Cornu::PRIMITIVE_FITTING> > previous = incremental.previousOutput<Cornu::PRIMITIVE_FITTING>();
+            incremental.run();
+            if(!previous)
+                continue;
+            const std::vector<Cornu::FitPrimitive> &prims = incremental.output<Cornu::PRIMITIVE_FITTING>()->primitives;
+            for(int i = 0; i < (int)prims.size(); ++i)
+                for(int j = 0; j < (int)previous->primitives.size(); ++j)
+                    numReused += (prims[i].curve == previous->primitives[j].curve);
+        }
+
+        //the result should be the same as fitting all the points at once
+        Cornu::Fitter full;
+        full.setParams(params);
+        full.setOriginalSketch(new Cornu::Polyline(pts));
+        full.run();
+
+        CORNU_ASSERT(incremental.output<Cornu::PRELIM_RESAMPLING>()->output->pts() == full.output<Cornu::PRELIM_RESAMPLING>()->output->pts());
+
+        const std::vector<Cornu::FitPrimitive> &incPrims = incremental.output<Cornu::PRIMITIVE_FITTING>()->primitives;
+        const std::vector<Cornu::FitPrimitive> &fullPrims = full.output<Cornu::PRIMITIVE_FITTING>()->primitives;
+        CORNU_ASSERT(incPrims.size() == fullPrims.size());
+        for(int i = 0; i < (int)fullPrims.size(); ++i)
+        {
+            CORNU_ASSERT(incPrims[i].startIdx == fullPrims[i].startIdx && incPrims[i].endIdx == fullPrims[i].endIdx);
+            CORNU_ASSERT(incPrims[i].error == fullPrims[i].error);
+            CORNU_ASSERT(incPrims[i].curve->params() == fullPrims[i].curve->params());
+        }
+        CORNU_ASSERT(incremental.finalOutput()->length() == full.finalOutput()->length());
+
+        Cornu::Debugging::get()->printf("Incremental fit reused %d candidate primitives\n", numReused);
+        CORNU_ASSERT(numReused > 0);
+    }
+
+    static void fitWithRing(Cornu::DebuggingRing *ring, const Cornu::VectorC<Eigen::Vector2d> *pts, std::atomic<bool> *finished)
+    {
+        Debugging::setForCurrentThread(ring);
+        Cornu::Fitter fitter;
+        fitter.setOriginalSketch(new Cornu::Polyline(*pts));
+        fitter.run();
+        Debugging::setForCurrentThread(NULL);
+        *finished = true;
+    }
+
+    //a fit on another thread records its debugging output, which this thread reads while it runs
+    void debuggingRingTest()
+    {
+        Cornu::VectorC<Eigen::Vector2d> pts(40, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < pts.size(); ++i)
+            pts[i] = Eigen::Vector2d(100 + 8 * i, 200 + 60 * sin(0.15 * i));
+
+        Cornu::DebuggingRing ring(1 << 16);
+        std::atomic<bool> finished(false);
+        std::thread worker(&fitWithRing, &ring, &pts, &finished);
+        std::vector<Cornu::DebuggingRing::Record, Eigen::aligned_allocator<Cornu::DebuggingRing::Record> > records;
+        Cornu::DebuggingRing::Record record;
+        while(!finished)
+        {
+            while(ring.pop(record))
+                records.push_back(record);
+            std::this_thread::yield();
+        }
+        worker.join();
+        while(ring.pop(record))
+            records.push_back(record);
+
+        CORNU_ASSERT(ring.numDropped() == 0 && records.size() > 10);
+        CORNU_ASSERT(records[0].type == Cornu::DebuggingRing::CLEAR && records[1].type == Cornu::DebuggingRing::TEXT);
+        int numCurves = 0;
+        for(int i = 0; i < (int)records.size(); ++i)
+            numCurves += (records[i].type == Cornu::DebuggingRing::CURVE);
+        CORNU_ASSERT(numCurves > 0);
+
+        //a full ring drops records instead of waiting
+        Cornu::DebuggingRing small(4);
+        fitWithRing(&small, &pts, &finished);
+        CORNU_ASSERT(small.numDropped() > 0);
+        small.replay(Debugging::get());
+        CORNU_ASSERT(!small.pop(record));
+    }
+
+    void tracingTest()
+    {
+        Cornu::VectorC<Eigen::Vector2d> pts(40, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < pts.size(); ++i)
+            pts[i] = Eigen::Vector2d(100 + 8 * i, 200 + 60 * sin(0.15 * i));
+
+        Cornu::Tracing::start();
+        Cornu::Fitter fitter;
+        fitter.setOriginalSketch(new Cornu::Polyline(pts));
+        fitter.run();
+        Cornu::Tracing::stop();
+        fitter.setOriginalSketch(new Cornu::Polyline(pts));
+        fitter.run(); //not recorded
+
+        std::ostringstream trace;
+        CORNU_ASSERT(Cornu::Tracing::writeChromeTrace(trace));
+        std::string str = trace.str();
+        CORNU_ASSERT(str.find("{\"traceEvents\":[") == 0 && str.find("\"name\":\"Fitter::run\"") != std::string::npos);
+        CORNU_ASSERT(str.find("\"name\":\"Path Finding\"") != std::string::npos);
+        CORNU_ASSERT(str.find("\"name\":\"twoCurveCombine\"") != std::string::npos);
+        CORNU_ASSERT(str.find("\"name\":\"LSSolver::solve\"") != std::string::npos && str.find("\"args\":{\"iterations\":") != std::string::npos);
+        CORNU_ASSERT(str.find("Fitter::run") == str.rfind("Fitter::run"));
+    }
+
+    void timeBudgetTest()
+    {
+        Cornu::VectorC<Eigen::Vector2d> pts(80, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < pts.size(); ++i)
+            pts[i] = Eigen::Vector2d(100 + 8 * i, 200 + 60 * sin(0.15 * i));
+
+        //a budget that's used up right away still gives a fit
+        Cornu::Fitter fitter;
+        fitter.setOriginalSketch(new Cornu::Polyline(pts));
+        fitter.setTimeBudget(1e-6);
+        Cornu::FitStats stats = fitter.run();
+        CORNU_ASSERT(stats.degraded && fitter.finalOutput());
+        CORNU_ASSERT(fitter.output<Cornu::COMBINING>()->degraded && stats.numLSIterations <= 5);
+
+        //without the budget, the degraded stages run again and the fit is the full one
+        fitter.setTimeBudget(0.);
+        stats = fitter.run();
+        CORNU_ASSERT(!stats.degraded && stats.stageNanoseconds[Cornu::COMBINING] > 0);
+        Cornu::Fitter fresh;
+        fresh.setOriginalSketch(new Cornu::Polyline(pts));
+        fresh.run();
+        CORNU_ASSERT(fresh.finalOutput()->primitives().size() == fitter.finalOutput()->primitives().size());
+        CORNU_ASSERT(fabs(fresh.finalOutput()->length() - fitter.finalOutput()->length()) < 1e-8);
+    }
+
+    //cancels a token when the fitter prints a message starting with the prefix
+    class CancellingDebugging : public Cornu::Debugging
+    {
+    public:
+        CancellingDebugging(Cornu::CancellationTokenPtr token, const char *prefix) : _token(token), _prefix(prefix) {}
+
+        void printf(const char *fmt, ...) { if(strncmp(fmt, _prefix, strlen(_prefix)) == 0) _token->cancel(); }
+
+    private:
+        Cornu::CancellationTokenPtr _token;
+        const char *_prefix;
+    };
+
+    void cancellationTest()
+    {
+        Cornu::VectorC<Eigen::Vector2d> pts(80, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < pts.size(); ++i)
+            pts[i] = Eigen::Vector2d(100 + 8 * i, 200 + 60 * sin(0.15 * i));
+
+        //cancelled before the run, nothing runs
+        Cornu::CancellationTokenPtr token = new Cornu::CancellationToken();
+        token->cancel();
+        Cornu::Fitter fitter;
+        fitter.setOriginalSketch(new Cornu::Polyline(pts));
+        fitter.setCancellationToken(token);
+        Cornu::FitStats stats = fitter.run();
+        CORNU_ASSERT(stats.cancelled && !fitter.finalOutput() && !fitter.output<Cornu::SCALE_DETECTION>());
+
+        //cancelled as the graph is done, the stage that noticed is dropped and the ones before it are kept
+        token->reset();
+        CancellingDebugging debugging(token, "Graph vertices");
+        Debugging::setForCurrentThread(&debugging);
+        stats = fitter.run();
+        Debugging::setForCurrentThread(NULL);
+        CORNU_ASSERT(stats.cancelled && !fitter.finalOutput());
+        CORNU_ASSERT(fitter.output<Cornu::PRIMITIVE_FITTING>() && !fitter.output<Cornu::GRAPH_CONSTRUCTION>());
+
+        //the next run picks up from there and fits the curve like a fresh fitter
+        token->reset();
+        stats = fitter.run();
+        CORNU_ASSERT(!stats.cancelled && stats.stageNanoseconds[Cornu::PRIMITIVE_FITTING] == 0 && fitter.finalOutput());
+        Cornu::Fitter fresh;
+        fresh.setOriginalSketch(new Cornu::Polyline(pts));
+        fresh.run();
+        CORNU_ASSERT(fresh.finalOutput()->primitives().size() == fitter.finalOutput()->primitives().size());
+        CORNU_ASSERT(fabs(fresh.finalOutput()->length() - fitter.finalOutput()->length()) < 1e-8);
+    }
+
+    //one fitter reused for several strokes gives the same fits as new fitters, and outputs held by the
+    //caller aren't overwritten by the next stroke
+    void reuseTest()
+    {
+        Cornu::Fitter reused;
+        Cornu::PrimitiveSequenceConstPtr held;
+        for(int k = 0; k < 3; ++k)
+        {
+            Cornu::VectorC<Eigen::Vector2d> pts(60 + 10 * k, Cornu::NOT_CIRCULAR);
+            for(int i = 0; i < pts.size(); ++i)
+                pts[i] = Eigen::Vector2d(100 + 8 * i, 200 + 60 * sin((0.12 + 0.03 * k) * i));
+
+            reused.reset();
+            reused.setOriginalSketch(new Cornu::Polyline(pts));
+            reused.run();
+            Cornu::Fitter fresh;
+            fresh.setOriginalSketch(new Cornu::Polyline(pts));
+            fresh.run();
+            CORNU_ASSERT(fresh.finalOutput()->primitives().size() == reused.finalOutput()->primitives().size());
+            CORNU_ASSERT(fabs(fresh.finalOutput()->length() - reused.finalOutput()->length()) < 1e-8);
+
+            if(k == 0)
+                held = reused.finalOutput();
+            else
+                CORNU_ASSERT(held != reused.finalOutput() && held->primitives().size() > 0);
+        }
+    }
+
+    //releasing the outputs the later stages don't need shouldn't change the fits, before or after a parameter change
+    void releaseOutputsTest()
+    {
+        Cornu::PolylineConstPtr sketch = wave(80, 0.15);
+        Cornu::Fitter kept, released;
+        released.setReleaseIntermediateOutputs(true);
+        kept.setOriginalSketch(sketch);
+        released.setOriginalSketch(sketch);
+        const Cornu::FitStats &keptStats = kept.run();
+        const Cornu::FitStats &releasedStats = released.run();
+        CORNU_ASSERT(kept.finalOutput() && released.finalOutput());
+        CORNU_ASSERT(fabs(kept.finalOutput()->length() - released.finalOutput()->length()) < 1e-8);
+
+        long long total = 0;
+        for(int i = 0; i < Cornu::NUM_ALGORITHM_STAGES; ++i)
+            total += keptStats.stageBytes[i];
+        CORNU_ASSERT(keptStats.stageBytes[Cornu::PRIMITIVE_FITTING] > 0 && keptStats.stageBytes[Cornu::GRAPH_CONSTRUCTION] > 0);
+        CORNU_ASSERT(keptStats.peakBytes >= total);
+        CORNU_ASSERT_MSG(releasedStats.peakBytes <= keptStats.peakBytes, "Released peak " << releasedStats.peakBytes << " above " << keptStats.peakBytes);
+        CORNU_ASSERT(kept.output<Cornu::PRIMITIVE_FITTING>() && !released.output<Cornu::PRIMITIVE_FITTING>() && !released.output<Cornu::PRELIM_RESAMPLING>());
+        CORNU_ASSERT(released.output<Cornu::SCALE_DETECTION>() && released.originalSketchToFinalParameters().size() == (size_t)sketch->pts().size());
+
+        //the released stages are made again for the stages a parameter change reruns
+        Cornu::Parameters params;
+        params.set(Cornu::Parameters::ERROR_COST, 2. * params.get(Cornu::Parameters::ERROR_COST));
+        kept.setParams(params);
+        released.setParams(params);
+        kept.run();
+        released.run();
+        CORNU_ASSERT(released.finalOutput() && kept.finalOutput()->primitives().size() == released.finalOutput()->primitives().size());
+        CORNU_ASSERT(fabs(kept.finalOutput()->length() - released.finalOutput()->length()) < 1e-8);
+
+        //a curve fitted in pieces gives them the stages through corner detection, so those stay until the candidates are fitted
+        Cornu::PolylineConstPtr longSketch = wave(200, 0.3);
+        Cornu::Parameters piecesParams(Cornu::Parameters::LINES_AND_ARCS);
+        piecesParams.set(Cornu::Parameters::HIERARCHICAL_POINTS, 40);
+        Cornu::Fitter whole, keptPieces, releasedPieces;
+        releasedPieces.setReleaseIntermediateOutputs(true);
+        whole.setParams(Cornu::Parameters(Cornu::Parameters::LINES_AND_ARCS));
+        keptPieces.setParams(piecesParams);
+        releasedPieces.setParams(piecesParams);
+        whole.setOriginalSketch(longSketch);
+        keptPieces.setOriginalSketch(longSketch);
+        releasedPieces.setOriginalSketch(longSketch);
+        releasedPieces.runUntil(Cornu::PRIMITIVE_FITTING);
+        CORNU_ASSERT(releasedPieces.output<Cornu::PRELIM_RESAMPLING>() && releasedPieces.output<Cornu::CORNER_DETECTION>());
+        whole.run();
+        keptPieces.run();
+        releasedPieces.run();
+        CORNU_ASSERT_MSG(keptPieces.stats().numGraphEdges != whole.stats().numGraphEdges, "Curve wasn't fitted in pieces");
+        CORNU_ASSERT(releasedPieces.finalOutput() && !releasedPieces.output<Cornu::PRELIM_RESAMPLING>());
+        CORNU_ASSERT(keptPieces.finalOutput()->primitives().size() == releasedPieces.finalOutput()->primitives().size());
+        CORNU_ASSERT(fabs(keptPieces.finalOutput()->length() - releasedPieces.finalOutput()->length()) < 1e-8);
+    }
+
+    static Cornu::PolylineConstPtr wave(int numPts, double frequency)
+    {
+        Cornu::VectorC<Eigen::Vector2d> pts(numPts, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < pts.size(); ++i)
+            pts[i] = Eigen::Vector2d(100 + 8 * i, 200 + 60 * sin(frequency * i));
+        return new Cornu::Polyline(pts);
+    }
+
+    const Cornu::FitStats &fitCached(Cornu::Fitter &fitter, Cornu::FitCachePtr cache, Cornu::PolylineConstPtr sketch, const Cornu::Parameters &params)
+    {
+        fitter.reset();
+        fitter.setCache(cache);
+        fitter.setParams(params);
+        fitter.setOriginalSketch(sketch);
+        return fitter.run();
+    }
+
+    void cacheTest()
+    {
+        Cornu::Parameters params;
+        Cornu::FitCachePtr cache = new Cornu::FitCache();
+        Cornu::Fitter first, second;
+
+        CORNU_ASSERT(!fitCached(first, cache, wave(60, 0.15), params).cached && cache->size() == 1);
+        CORNU_ASSERT(fitCached(second, cache, wave(60, 0.15), params).cached); //the same points in another polyline
+        CORNU_ASSERT(!second.output<Cornu::PRIMITIVE_FITTING>());
+        CORNU_ASSERT(second.finalOutput()->primitives().size() == first.finalOutput()->primitives().size());
+        CORNU_ASSERT(fabs(second.finalOutput()->length() - first.finalOutput()->length()) < 1e-8);
+        CORNU_ASSERT(second.originalSketchToFinalParameters() == first.originalSketchToFinalParameters());
+
+        Cornu::Parameters other(Cornu::Parameters::LINES_AND_ARCS);
+        CORNU_ASSERT(!fitCached(second, cache, wave(60, 0.15), other).cached && cache->size() == 2);
+        CORNU_ASSERT(!fitCached(second, cache, wave(61, 0.15), params).cached && cache->size() == 3);
+        CORNU_ASSERT(cache->hits() == 1 && cache->misses() == 3);
+
+        //without room for all three fits, the least recently used one goes
+        Cornu::FitCachePtr all = new Cornu::FitCache();
+        const double frequencies[3] = { 0.15, 0.25, 0.35 };
+        for(int i = 0; i < 3; ++i)
+            fitCached(first, all, wave(60, frequencies[i]), params);
+        Cornu::FitCachePtr small = new Cornu::FitCache(all->bytes() - 1);
+        fitCached(first, small, wave(60, 0.15), params);
+        fitCached(first, small, wave(60, 0.25), params);
+        fitCached(first, small, wave(60, 0.15), params); //now the most recently used
+        fitCached(first, small, wave(60, 0.35), params);
+        CORNU_ASSERT(small->size() == 2 && small->bytes() < all->bytes());
+        CORNU_ASSERT(fitCached(first, small, wave(60, 0.15), params).cached);
+        CORNU_ASSERT(!fitCached(first, small, wave(60, 0.25), params).cached);
+
+        //fitBatch's threads share the cache
+        std::vector<std::vector<Cornu::Point> > strokes(6);
+        for(int i = 0; i < (int)strokes.size(); ++i)
+            for(int j = 0; j < 30; ++j)
+                strokes[i].push_back(Cornu::Point(100 + 10 * j, 100 + 30 * sin((0.2 + 0.05 * i) * j)));
+        Cornu::FitCachePtr batchCache = new Cornu::FitCache();
+        std::vector<std::vector<Cornu::BasicPrimitive> > uncached = Cornu::fitBatch(strokes, params, NULL, 3, batchCache);
+        std::vector<std::vector<Cornu::BasicPrimitive> > cached = Cornu::fitBatch(strokes, params, NULL, 3, batchCache);
+        CORNU_ASSERT(batchCache->hits() == (int)strokes.size());
+        for(int i = 0; i < (int)strokes.size(); ++i)
+        {
+            CORNU_ASSERT(cached[i].size() == uncached[i].size());
+            for(int j = 0; j < (int)cached[i].size(); ++j)
+                CORNU_ASSERT(cached[i][j].length == uncached[i][j].length);
+        }
+    }
+
+    //a wave, scaled, rotated and moved
+    static Cornu::PolylineConstPtr movedWave(int numPts, double frequency, double scale, double angle, const Eigen::Vector2d &translation)
+    {
+        Cornu::VectorC<Eigen::Vector2d> pts(numPts, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < pts.size(); ++i)
+            pts[i] = scale * (Eigen::Rotation2D<double>(angle) * Eigen::Vector2d(8 * i, 60 * sin(frequency * i))) + translation;
+        return new Cornu::Polyline(pts);
+    }
+
+    static double maxDistance(Cornu::PrimitiveSequenceConstPtr curve, Cornu::PolylineConstPtr sketch)
+    {
+        double out = 0.;
+        for(int i = 0; i < sketch->pts().size(); ++i)
+            out = std::max(out, curve->distanceTo(sketch->pts()[i]));
+        return out;
+    }
+
+    void canonicalCacheTest()
+    {
+        Cornu::Parameters params;
+        Cornu::FitCachePtr cache = new Cornu::FitCache(16 << 20, true);
+        Cornu::Fitter cached, fresh;
+
+        //a moved and rotated copy (which isn't rescaled) gets the fit it would get itself
+        fitCached(cached, cache, movedWave(40, 0.3, 1., 0., Eigen::Vector2d(100, 100)), params);
+        Cornu::PolylineConstPtr copy = movedWave(40, 0.3, 1., 2.2, Eigen::Vector2d(-40, 300));
+        CORNU_ASSERT(fitCached(cached, cache, copy, params).cached);
+        fitCached(fresh, Cornu::FitCachePtr(), copy, params);
+        CORNU_ASSERT(cached.finalOutput()->primitives().size() == fresh.finalOutput()->primitives().size());
+        CORNU_ASSERT(fabs(cached.finalOutput()->length() - fresh.finalOutput()->length()) < 1e-6);
+        CORNU_ASSERT((cached.finalOutput()->endPos() - fresh.finalOutput()->endPos()).norm() < 1e-6);
+        CORNU_ASSERT(fabs(cached.originalSketchToFinalParameters().back() - fresh.originalSketchToFinalParameters().back()) < 1e-6);
+
+        //a scaled copy only matches if the scale detector rescales it as much: this one isn't rescaled
+        CORNU_ASSERT(!fitCached(cached, cache, movedWave(40, 0.3, 0.8, 0., Eigen::Vector2d(100, 100)), params).cached);
+
+        //small curves are rescaled with their size, so a scaled copy gets about as good a fit (the solvers' damping isn't scaled)
+        fitCached(cached, cache, movedWave(30, 0.45, 0.45, 0., Eigen::Vector2d(100, 100)), params);
+        copy = movedWave(30, 0.45, 0.55, Cornu::PI, Eigen::Vector2d(0, 50));
+        CORNU_ASSERT(fitCached(cached, cache, copy, params).cached);
+        fitCached(fresh, Cornu::FitCachePtr(), copy, params);
+        CORNU_ASSERT(cached.finalOutput()->primitives().size() == fresh.finalOutput()->primitives().size());
+        CORNU_ASSERT_LT_MSG(maxDistance(cached.finalOutput(), copy), 1.1 * maxDistance(fresh.finalOutput(), copy) + 0.1, "Cached fit of a scaled copy is too far");
+    }
+
+    //a long curve fitted in pieces should be about as close to the sketch as one fitted whole
+    void hierarchicalTest()
+    {
+        Cornu::VectorC<Eigen::Vector2d> pts(5000, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < pts.size(); ++i)
+        {
+            double t = 0.5 * i;
+            pts[i] = Eigen::Vector2d(t + 30 * sin(0.013 * t), 80 * sin(0.021 * t) + 40 * cos(0.0071 * t));
+        }
+        std::vector<Cornu::FitStats> stats = checkFitInPieces(pts, Cornu::Parameters::HIERARCHICAL_POINTS, 60);
+        CORNU_ASSERT_MSG(stats[1].numCandidatePrimitives > stats[0].numCandidatePrimitives, "Curve wasn't fitted in overlapping pieces"); //the overlaps are fitted twice
+
+        //a zigzag, split at its corners
+        Cornu::VectorC<Eigen::Vector2d> zigzag(3000, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < zigzag.size(); ++i)
+        {
+            int segment = i / 300;
+            double u = (i % 300) / 300.;
+            zigzag[i] = 10. * Eigen::Vector2d(150 * (segment + u), 200 * (segment % 2 ? 1 - u : u) + 20 * sin(6 * u));
+        }
+        checkFitInPieces(zigzag, Cornu::Parameters::CORNER_PIECES, 1);
+    }
+
+    std::vector<Cornu::FitStats> checkFitInPieces(const Cornu::VectorC<Eigen::Vector2d> &pts, Cornu::Parameters::ParameterType option, double value)
+    {
+        std::vector<Cornu::FitStats> stats = compareWithOption(pts, Cornu::Parameters(Cornu::Parameters::LINES_AND_ARCS), option, value,
+                                                               1.2, 0.1, "Curve fitted in pieces is too far from the sketch");
+        CORNU_ASSERT_MSG(stats[1].numGraphEdges != stats[0].numGraphEdges, "Curve wasn't fitted in pieces");
+        return stats;
+    }
+
+    typedef std::function<void(int pass, const Cornu::Fitter &fitter)> FitCheck;
+
+    //Fits the sketch with the base parameters and then with the option set to onValue, and checks that both fits
+    //succeed and that the second one's RMS distance to the sketch is under factor times the first one's plus slack.
+    //check, if given, is called with each fitter after it runs.  Returns the stats of the fits, the option off first.
+    static std::vector<Cornu::FitStats> compareWithOption(const Cornu::VectorC<Eigen::Vector2d> &pts, const Cornu::Parameters &base,
+                                                          Cornu::Parameters::ParameterType option, double onValue, double factor,
+                                                          double slack, const char *tooFarMessage, const FitCheck &check = FitCheck())
+    {
+        std::vector<Cornu::FitStats> stats(2);
+        double errors[2];
+        for(int pass = 0; pass < 2; ++pass)
+        {
+            Cornu::Parameters params = base;
+            if(pass == 1)
+                params.set(option, onValue);
+            Cornu::Fitter fitter;
+            fitter.setParams(params);
+            fitter.setOriginalSketch(new Cornu::Polyline(pts));
+            stats[pass] = fitter.run();
+            CORNU_ASSERT(fitter.finalOutput());
+            if(check)
+                check(pass, fitter);
+
+            errors[pass] = 0.;
+            for(int i = 0; i < pts.size(); ++i)
+                errors[pass] += fitter.finalOutput()->distanceSqTo(pts[i]);
+            errors[pass] = sqrt(errors[pass] / pts.size());
+        }
+
+        CORNU_ASSERT_LT_MSG(errors[1], factor * errors[0] + slack, tooFarMessage);
+        return stats;
+    }
+
+    //stopping the validation solves early should save iterations and fit about as closely
+    void validationEarlyStopTest()
+    {
+        Cornu::VectorC<Eigen::Vector2d> pts(300, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < pts.size(); ++i)
+        {
+            double a = 2 * Cornu::PI * 0.9 * i / pts.size();
+            double r = 150 + 40 * sin(4 * a) + 15 * cos(6 * a + 1);
+            pts[i] = Eigen::Vector2d(300 + r * cos(a), 300 + r * sin(a));
+        }
+
+        std::vector<Cornu::FitStats> stats = compareWithOption(pts, Cornu::Parameters(), Cornu::Parameters::VALIDATION_EARLY_STOP, 1,
+                                                               1.2, 0.1, "Fit with early stopping is too far from the sketch");
+        CORNU_ASSERT(stats[0].numValidatedEdges > 0 && stats[1].numValidatedEdges > 0);
+#if CORNU_COUNTERS //the validation solves' iterations are only counted with the work counters
+        CORNU_ASSERT_LT_MSG(stats[1].counters[Cornu::WorkCounters::LS_ITERATIONS], stats[0].counters[Cornu::WorkCounters::LS_ITERATIONS],
+                            "Early stopping didn't save solver iterations");
+#endif
+    }
+
+    //dropping dominated candidates should shrink the graph and fit about as closely
+    void dominancePruningTest()
+    {
+        Cornu::VectorC<Eigen::Vector2d> pts(300, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < pts.size(); ++i)
+        {
+            double a = 2 * Cornu::PI * 0.9 * i / pts.size();
+            double r = 150 + 40 * sin(4 * a) + 15 * cos(6 * a + 1);
+            pts[i] = Eigen::Vector2d(300 + r * cos(a), 300 + r * sin(a));
+        }
+
+        std::vector<Cornu::FitStats> stats = compareWithOption(pts, Cornu::Parameters(), Cornu::Parameters::DOMINANCE_PRUNING, 1,
+                                                               1.2, 0.1, "Fit with dominance pruning is too far from the sketch");
+        CORNU_ASSERT_LT_MSG(stats[1].numCandidatePrimitives, stats[0].numCandidatePrimitives, "Dominance pruning didn't drop any candidates");
+        CORNU_ASSERT_LT_MSG(stats[1].numGraphEdges, stats[0].numGraphEdges * 4 / 5, "Dominance pruning didn't shrink the graph");
+
+        //the candidates are pruned again when a type cost changes, even if it stays finite
+        Cornu::Parameters params;
+        params.set(Cornu::Parameters::DOMINANCE_PRUNING, 1);
+        Cornu::Fitter changed, fresh;
+        changed.setParams(params);
+        changed.setOriginalSketch(new Cornu::Polyline(pts));
+        changed.run();
+        params.set(Cornu::Parameters::ARC_COST, params.get(Cornu::Parameters::CLOTHOID_COST) + 10.);
+        changed.setParams(params);
+        changed.run();
+        fresh.setParams(params);
+        fresh.setOriginalSketch(new Cornu::Polyline(pts));
+        fresh.run();
+        CORNU_ASSERT(changed.finalOutput() && fresh.finalOutput());
+        int numFresh = (int)fresh.output<Cornu::PRIMITIVE_FITTING>()->primitives.size();
+        CORNU_ASSERT_MSG(numFresh != stats[1].numCandidatePrimitives, "The cost change doesn't change which candidates are pruned");
+        CORNU_ASSERT((int)changed.output<Cornu::PRIMITIVE_FITTING>()->primitives.size() == numFresh);
+        CORNU_ASSERT(fabs(changed.finalOutput()->length() - fresh.finalOutput()->length()) < 1e-8);
+    }
+
+    //on a smooth spiral, growing the candidates geometrically should fit far fewer of them and about as closely
+    void candidateSteppingTest()
+    {
+        Cornu::VectorC<Eigen::Vector2d> pts(300, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < pts.size(); ++i)
+        {
+            double a = 4 * Cornu::PI * i / pts.size();
+            double r = 300 + 10 * a;
+            pts[i] = Eigen::Vector2d(1000 + r * cos(a), 1000 + r * sin(a));
+        }
+
+        std::vector<Cornu::FitStats> stats = compareWithOption(pts, Cornu::Parameters(), Cornu::Parameters::CANDIDATE_LENGTHS_PER_DOUBLING, 4,
+                                                               1.2, 0.1, "Fit with geometric stepping is too far from the sketch");
+        CORNU_ASSERT_LT_MSG(stats[1].numCandidatePrimitives, stats[0].numCandidatePrimitives * 3 / 5, "Geometric stepping didn't fit fewer candidates");
+    }
+
+    //a near-straight stroke and an arc should each be fitted as one primitive from just a few candidates and
+    //about as closely, while a wave needs the full fit and should get the same one
+    void fastSimpleStrokesTest()
+    {
+        Cornu::VectorC<Eigen::Vector2d> line(100, Cornu::NOT_CIRCULAR), arc(100, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < line.size(); ++i)
+        {
+            line[i] = Eigen::Vector2d(100 + 5 * i, 200 + 0.2 * sin(0.7 * i));
+            double a = 0.02 * i;
+            arc[i] = Eigen::Vector2d(500 + 300 * cos(a), 500 + 300 * sin(a));
+        }
+        const Cornu::VectorC<Eigen::Vector2d> *simple[2] = { &line, &arc };
+
+        for(int s = 0; s < 2; ++s)
+        {
+            std::vector<Cornu::FitStats> stats = compareWithOption(*simple[s], Cornu::Parameters(), Cornu::Parameters::FAST_SIMPLE_STROKES, 1,
+                                                                   1.2, 0.1, "Fast fit of a simple stroke is too far from the sketch",
+                                                                   [](int, const Cornu::Fitter &fitter) { CORNU_ASSERT(fitter.finalOutput()->primitives().size() == 1); });
+            int numCandidates = stats[1].numCandidatePrimitives;
+            CORNU_ASSERT_MSG(numCandidates <= 3 && numCandidates < stats[0].numCandidatePrimitives, "A simple stroke wasn't fitted as one primitive");
+        }
+
+        Cornu::PrimitiveSequenceConstPtr waves[2];
+        for(int pass = 0; pass < 2; ++pass)
+        {
+            Cornu::Parameters params;
+            params.set(Cornu::Parameters::FAST_SIMPLE_STROKES, pass);
+            Cornu::Fitter fitter;
+            fitter.setParams(params);
+            fitter.setOriginalSketch(wave(60, 0.15));
+            fitter.run();
+            waves[pass] = fitter.finalOutput();
+            CORNU_ASSERT(waves[pass]);
+        }
+        CORNU_ASSERT(waves[0]->primitives().size() == waves[1]->primitives().size());
+        CORNU_ASSERT(waves[0]->length() == waves[1]->length());
+    }
+
+    //with the approximations for the search, a wavy stroke should be fitted about as closely, with the candidates
+    //and validations evaluated cheaply (on the worker threads too) and the final solve at full precision
+    void fresnelTierTest()
+    {
+        Cornu::VectorC<Eigen::Vector2d> pts(300, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < pts.size(); ++i)
+            pts[i] = Eigen::Vector2d(100 + 3 * i, 300 + (50 + i / 3.) * sin(0.01 * i * (1 + 0.01 * i)));
+
+        compareWithOption(pts, Cornu::Parameters(), Cornu::Parameters::FRESNEL_TIER, 2, 1.05, 0.01,
+                          "Fit with approximate Fresnel integrals is too far from the sketch",
+                          [](int pass, const Cornu::Fitter &fitter)
+                          {
+                              CORNU_ASSERT(fitter.fresnelTier(Cornu::PATH_FINDING) == (pass ? Cornu::FresnelTier::APPROX : Cornu::FresnelTier::FULL));
+                              CORNU_ASSERT(fitter.fresnelTier(Cornu::COMBINING) == Cornu::FresnelTier::FULL);
+#if CORNU_COUNTERS
+                              CORNU_ASSERT((fitter.stats().counters[Cornu::WorkCounters::FRESNEL_APPROX_VALUES] > 0) == (pass == 1));
+#endif
+                          });
+
+        //the workers of a parallel loop evaluate with the tier of the thread that started it
+        std::vector<int> tiers(64, -1);
+        {
+            Cornu::FresnelTier::Scope fresnelScope(Cornu::FresnelTier::APPROX);
+            Cornu::parallelFor((int)tiers.size(), [&tiers](int i) { tiers[i] = Cornu::FresnelTier::current(); }, 4);
+        }
+        CORNU_ASSERT(std::count(tiers.begin(), tiers.end(), (int)Cornu::FresnelTier::APPROX) == (int)tiers.size());
+        CORNU_ASSERT(Cornu::FresnelTier::current() == Cornu::FresnelTier::FULL);
+    }
+
+    //the error computer that takes the candidates in batches should give the same candidates and fit as fitting
+    //them one at a time, on a curve with corners and on a closed one
+    void batchedErrorsTest()
+    {
+        Cornu::VectorC<Eigen::Vector2d> zigzag(150, Cornu::NOT_CIRCULAR), loop(120, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < zigzag.size(); ++i)
+            zigzag[i] = Eigen::Vector2d(100 + 4 * i, 200 + 2 * abs(i % 50 - 25) + 10 * sin(0.1 * i));
+        for(int i = 0; i < loop.size(); ++i)
+        {
+            double a = 2 * Cornu::PI * i / loop.size();
+            loop[i] = Eigen::Vector2d(500 + 200 * cos(a), 500 + 120 * sin(a));
+        }
+        Cornu::PolylineConstPtr sketches[2] = { new Cornu::Polyline(zigzag), new Cornu::Polyline(loop) };
+
+        std::vector<std::string> names = Cornu::Algorithm<Cornu::ERROR_COMPUTER>::names();
+        int batched = (int)(std::find(names.begin(), names.end(), "L-Infinity Batched") - names.begin());
+        CORNU_ASSERT(batched < (int)names.size());
+
+        for(int s = 0; s < 2; ++s)
+        {
+            Cornu::PrimitiveSequenceConstPtr fits[2];
+            int candidates[2];
+            for(int pass = 0; pass < 2; ++pass)
+            {
+                Cornu::Parameters params;
+                if(pass == 1)
+                    params.setAlgorithm(Cornu::ERROR_COMPUTER, batched);
+                Cornu::Fitter fitter;
+                fitter.setParams(params);
+                fitter.setOriginalSketch(sketches[s]);
+                fitter.run();
+                fits[pass] = fitter.finalOutput();
+                CORNU_ASSERT(fits[pass]);
+                candidates[pass] = (int)fitter.output<Cornu::PRIMITIVE_FITTING>()->primitives.size();
+            }
+            CORNU_ASSERT(candidates[0] == candidates[1]);
+            CORNU_ASSERT(sameFit(fits[0], fits[1]));
+        }
+    }
+
+    //Errors computed from the foot points of a slightly moved curve (by Newton steps) should be those computed by
+    //projecting the samples again, up to the accuracy of the projections.  For a curve moved by more than the
+    //sample spacing, the samples that are too far are projected again, and the rest get close.
+    void footPointsTest()
+    {
+        Cornu::Fitter fitter;
+        fitter.setOriginalSketch(wave(40, 0.15));
+        fitter.run();
+        Cornu::ErrorComputerConstPtr errors = fitter.output<Cornu::ERROR_COMPUTER>()->errorComputer;
+        const std::vector<Cornu::FitPrimitive> &primitives = fitter.output<Cornu::PRIMITIVE_FITTING>()->primitives;
+
+        int numTested = 0;
+        for(int i = 0; i < (int)primitives.size() && numTested < 10; ++i)
+        {
+            const Cornu::FitPrimitive &primitive = primitives[i];
+            if(primitive.curve->getType() != Cornu::CurvePrimitive::CLOTHOID || primitive.numPts < 6)
+                continue;
+            ++numTested;
+
+            for(int pass = 0; pass < 2; ++pass)
+            {
+                std::vector<double> footPoints, freshFootPoints;
+                Eigen::VectorXd error, fresh;
+                Eigen::MatrixXd der, freshDer;
+                errors->computeErrorVector(primitive.curve, primitive.startIdx, primitive.endIdx, error, &der, false, false, false, &footPoints);
+                CORNU_ASSERT((int)footPoints.size() == primitive.numPts);
+
+                Cornu::CurvePrimitivePtr moved = primitive.curve->clone();
+                Cornu::CurvePrimitive::ParamVec params = moved->params();
+                double scale = pass ? 1. : 1e-4;
+                params[Cornu::CurvePrimitive::X] += 20. * scale;
+                params[Cornu::CurvePrimitive::ANGLE] += 0.1 * scale;
+                params[Cornu::CurvePrimitive::LENGTH] *= 1. + 0.2 * scale;
+                moved->setParams(params);
+
+                errors->computeErrorVector(moved, primitive.startIdx, primitive.endIdx, error, &der, false, false, false, &footPoints);
+                errors->computeErrorVector(moved, primitive.startIdx, primitive.endIdx, fresh, &freshDer, false, false, false, &freshFootPoints);
+                CORNU_ASSERT(footPoints.size() == freshFootPoints.size());
+                double maxFootPointDiff = 0.;
+                for(int j = 0; j < (int)footPoints.size(); ++j)
+                    maxFootPointDiff = std::max(maxFootPointDiff, fabs(footPoints[j] - freshFootPoints[j]));
+
+                if(pass == 0)
+                {
+                    CORNU_ASSERT_LT_MSG(maxFootPointDiff, 1e-4, "Newton steps didn't find the foot points");
+                    CORNU_ASSERT_LT_MSG((error - fresh).norm(), 1e-4 * (1. + fresh.norm()), "Errors from the foot points are off");
+                    CORNU_ASSERT_LT_MSG((der - freshDer).norm(), 1e-4 * (1. + freshDer.norm()), "Error derivatives from the foot points are off");
+                }
+                else
+                {
+                    CORNU_ASSERT_LT_MSG(maxFootPointDiff, 1., "Foot points of a moved curve are too far");
+                    CORNU_ASSERT_LT_MSG((error - fresh).norm(), 0.02 * fresh.norm(), "Errors from the foot points of a moved curve are off");
+                }
+            }
+        }
+        CORNU_ASSERT(numTested > 0);
+    }
+
+    //the service should reply to requests, also many at once, with the fits the simple API makes, and reject
+    //requests that aren't sketch files
+    void fitServiceTest()
+    {
+        std::vector<Cornu::SketchFileEntry> entries(4);
+        for(int i = 0; i < 3; ++i)
+            entries[i].pts = wave(30 + 10 * i, 0.1 + 0.05 * i);
+        entries[1].params.set(Cornu::Parameters::ERROR_THRESHOLD, 3.);
+        entries[3].pts = new Cornu::Polyline(Cornu::VectorC<Eigen::Vector2d>(1, Cornu::NOT_CIRCULAR)); //can't be fitted
+        std::ostringstream file;
+        CORNU_ASSERT(Cornu::writeSketchFile(file, entries));
+        std::string request = file.str();
+
+        std::vector<std::vector<Cornu::BasicPrimitive> > expected(entries.size());
+        for(int i = 0; i < 3; ++i)
+        {
+            const Cornu::VectorC<Eigen::Vector2d> &pts = entries[i].pts->pts();
+            std::vector<Cornu::Point> points;
+            for(int j = 0; j < pts.size(); ++j)
+                points.push_back(Cornu::Point(pts[j][0], pts[j][1]));
+            expected[i] = Cornu::fit(points, entries[i].params);
+        }
+
+        Cornu::FitServer service(3);
+        CORNU_ASSERT(service.fit(request.data(), request.size() - 1).empty());
+
+        //a request crafted to read outside itself gets an empty reply, and so does garbage
+        std::string crafted = request;
+        const Cornu::SketchFileHeader &header = *(const Cornu::SketchFileHeader *)crafted.data();
+        Cornu::SketchFileSketch *sketch = (Cornu::SketchFileSketch *)&(crafted[(size_t)header.sketchesOffset]);
+        sketch->firstPoint = ~uint64_t(0) - 1000000;
+        sketch->numPoints = 1000000;
+        CORNU_ASSERT(service.fit(crafted.data(), crafted.size()).empty());
+        CORNU_ASSERT(!service.submit(crafted.data(), crafted.size(), [](const std::vector<char> &) { CORNU_ASSERT(false); }));
+        std::string garbage(request.size(), '\xff');
+        memcpy(&(garbage[0]), request.data(), 32); //past the magic, the version and the byte order
+        CORNU_ASSERT(service.fit(garbage.data(), garbage.size()).empty());
+
+        std::vector<char> replies[9];
+        std::atomic<int> numReplies(0);
+        for(int r = 0; r < 8; ++r)
+        {
+            std::vector<char> *reply = &(replies[r]);
+            CORNU_ASSERT(service.submit(request.data(), request.size(),
+                                        [reply, &numReplies](const std::vector<char> &out) { *reply = out; ++numReplies; }));
+        }
+        replies[8] = service.fit(request.data(), request.size());
+        while(numReplies < 8)
+            std::this_thread::yield();
+
+        for(int r = 0; r < 9; ++r)
+        {
+            std::vector<std::vector<Cornu::BasicPrimitive> > strokes;
+            std::vector<bool> closed;
+            CORNU_ASSERT(Cornu::readFitReply(replies[r].data(), replies[r].size(), strokes, &closed));
+            CORNU_ASSERT(strokes.size() == entries.size() && strokes[3].empty());
+            for(int i = 0; i < 3; ++i)
+            {
+                CORNU_ASSERT(strokes[i].size() == expected[i].size() && !closed[i]);
+                for(int j = 0; j < (int)strokes[i].size(); ++j)
+                {
+                    CORNU_ASSERT(strokes[i][j].type == expected[i][j].type && strokes[i][j].length == expected[i][j].length);
+                    CORNU_ASSERT(strokes[i][j].start.x == expected[i][j].start.x && strokes[i][j].curvatureDerivative == expected[i][j].curvatureDerivative);
+                }
+            }
+        }
+        std::vector<std::vector<Cornu::BasicPrimitive> > strokes;
+        CORNU_ASSERT(!Cornu::readFitReply(replies[0].data(), replies[0].size() - 1, strokes));
+    }
+
+    //the dataset should have a row for every edge of every graph, read back the way it was written
+    void datasetTest()
+    {
+        std::vector<Cornu::PolylineConstPtr> sketches;
+        for(int i = 0; i < 5; ++i)
+            sketches.push_back(wave(25 + 5 * i, 0.1 + 0.05 * i));
+        Cornu::Parameters params;
+
+        int numEdges = 0, expectedValidated = 0;
+        for(int i = 0; i < (int)sketches.size(); ++i)
+        {
+            Cornu::Fitter fitter;
+            fitter.setParams(params);
+            fitter.setOriginalSketch(sketches[i]);
+            fitter.runUntil(Cornu::PATH_FINDING);
+            const std::vector<Cornu::Edge> &edges = fitter.output<Cornu::GRAPH_CONSTRUCTION>()->edges;
+            int strokeEdges = 0;
+            for(int e = 0; e < (int)edges.size(); ++e)
+                strokeEdges += (edges[e].continuity >= 0);
+            numEdges += strokeEdges;
+            expectedValidated += std::min(strokeEdges, 4); //the shortest wave may have no real edges
+        }
+
+        Cornu::DatasetOptions options;
+        options.validatedEdgesPerStroke = 4;
+        options.rowsPerBlock = 100;
+        options.numThreads = 3;
+        std::stringstream file;
+        CORNU_ASSERT(Cornu::generateDataset(sketches, params, file, options) == numEdges);
+
+        Cornu::DatasetFileReader reader(file);
+        CORNU_ASSERT(reader.isValid());
+        Cornu::Dataset block;
+        int numRows = 0, numValidated = 0;
+        while(reader.next(block))
+        {
+            numRows += block.numRows();
+            for(int r = 0; r < block.numRows(); ++r)
+            {
+                float validated = block.get(r, Cornu::Dataset::VALIDATED_COST);
+                CORNU_ASSERT(block.get(r, Cornu::Dataset::CONTINUITY) >= 0 && block.get(r, Cornu::Dataset::CONTINUITY) <= 2);
+                if(validated >= 0.f)
+                {
+                    ++numValidated;
+                    CORNU_ASSERT(validated >= block.get(r, Cornu::Dataset::PREDICTED_COST)); //validation only raises costs
+                }
+            }
+        }
+        CORNU_ASSERT(numRows == numEdges);
+        CORNU_ASSERT(numValidated == expectedValidated);
+
+        //bad files are rejected
+        std::stringstream bad("CORNUXXX and then some more bytes");
+        CORNU_ASSERT(!Cornu::DatasetFileReader(bad).isValid());
+
+        //and so are blocks with more rows than the file holds, while empty ones are read as such
+        std::stringstream header;
+        Cornu::DatasetFileWriter writer(header);
+        uint64_t counts[2] = { 0, uint64_t(1) << 40 };
+        std::stringstream truncated(header.str() + std::string((const char *)counts, sizeof(counts)) + "some more bytes");
+        Cornu::DatasetFileReader truncatedReader(truncated);
+        CORNU_ASSERT(truncatedReader.isValid());
+        CORNU_ASSERT(truncatedReader.next(block) && block.numRows() == 0);
+        CORNU_ASSERT(!truncatedReader.next(block) && !truncatedReader.isValid());
+    }
+
+    static Cornu::PrimitiveSequenceConstPtr fitWithModels(const Cornu::VectorC<Eigen::Vector2d> &pts, Cornu::EdgeCostModelConstPtr edgeCostModel,
+                                                          Cornu::EdgeCostModelConstPtr validatedCostModel, int *outNumValidated)
+    {
+        Cornu::Fitter fitter;
+        fitter.setParams(Cornu::Parameters());
+        fitter.setEdgeCostModel(edgeCostModel);
+        fitter.setValidatedCostModel(validatedCostModel);
+        fitter.setOriginalSketch(new Cornu::Polyline(pts));
+        *outNumValidated = fitter.run().numValidatedEdges;
+        CORNU_ASSERT(fitter.finalOutput());
+        return fitter.finalOutput();
+    }
+
+    static bool sameFit(Cornu::PrimitiveSequenceConstPtr a, Cornu::PrimitiveSequenceConstPtr b)
+    {
+        if(a->primitives().size() != b->primitives().size())
+            return false;
+        for(int i = 0; i < a->primitives().size(); ++i)
+        {
+            if(a->primitives()[i]->getType() != b->primitives()[i]->getType() || a->primitives()[i]->length() != b->primitives()[i]->length())
+                return false;
+        }
+        return true;
+    }
+
+    //models that give back the predicted cost should fit the same as none, and trusting them should skip validation
+    void edgeCostModelTest()
+    {
+        Cornu::VectorC<Eigen::Vector2d> pts(200, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < pts.size(); ++i)
+            pts[i] = Eigen::Vector2d(100 + 3 * i, 200 + 60 * sin(0.04 * i) + 20 * cos(0.11 * i));
+
+        std::vector<float> weights(Cornu::EdgeCostModel::NUM_FEATURES, 0.f);
+        weights[Cornu::Dataset::PREDICTED_COST] = 1.f;
+        Cornu::EdgeCostModelConstPtr linear = new Cornu::LinearEdgeCostModel(weights, 0.f);
+        Eigen::MatrixXf hidden = Eigen::MatrixXf::Zero(2, Cornu::EdgeCostModel::NUM_FEATURES);
+        hidden(0, Cornu::Dataset::PREDICTED_COST) = 1.f;
+        hidden(1, Cornu::Dataset::CONTINUITY) = 1.f;
+        Cornu::EdgeCostModelConstPtr mlp = new Cornu::MLPEdgeCostModel(hidden, Eigen::VectorXf::Zero(2), Eigen::Vector2f(1.f, 0.f), 0.f);
+
+        int numValidated, numValidatedWithModel;
+        Cornu::PrimitiveSequenceConstPtr plain = fitWithModels(pts, NULL, NULL, &numValidated);
+        CORNU_ASSERT(numValidated > 0);
+        CORNU_ASSERT(sameFit(plain, fitWithModels(pts, linear, NULL, &numValidatedWithModel)));
+        CORNU_ASSERT(numValidatedWithModel == numValidated);
+        CORNU_ASSERT(sameFit(plain, fitWithModels(pts, mlp, NULL, &numValidatedWithModel)));
+
+        //predicting no increase skips every solve; predicting a large one skips none.  The count isn't the plain
+        //fit's, though: the pessimist orders the solves by its predicted increases instead of by cost, and how many
+        //are solved before an invalid edge stops the validation of a path depends on that order
+        fitWithModels(pts, NULL, linear, &numValidatedWithModel);
+        CORNU_ASSERT(numValidatedWithModel == 0);
+        Cornu::EdgeCostModelConstPtr pessimist = new Cornu::LinearEdgeCostModel(weights, 1000.f);
+        CORNU_ASSERT(sameFit(plain, fitWithModels(pts, NULL, pessimist, &numValidatedWithModel)));
+        CORNU_ASSERT(numValidatedWithModel > 0);
+    }
+
+    //stopping the validation of a path once it can't be the cheapest should find the same path with fewer solves
+    void pathValidationStopTest()
+    {
+        Cornu::VectorC<Eigen::Vector2d> pts(200, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < pts.size(); ++i)
+        {
+            double a = 2 * Cornu::PI * 0.9 * i / pts.size();
+            double r = 150 + 40 * sin(4 * a) + 15 * cos(6 * a + 1);
+            pts[i] = Eigen::Vector2d(300 + r * cos(a), 300 + r * sin(a));
+        }
+
+        Cornu::PrimitiveSequenceConstPtr fits[2];
+        int numValidated[2];
+        for(int pass = 0; pass < 2; ++pass)
+        {
+            Cornu::Fitter fitter;
+            Cornu::Parameters params(Cornu::Parameters::ACCURATE);
+            params.set(Cornu::Parameters::PATH_VALIDATION_STOP, pass);
+            fitter.setParams(params);
+            fitter.setOriginalSketch(new Cornu::Polyline(pts));
+            numValidated[pass] = fitter.run().numValidatedEdges;
+            CORNU_ASSERT(fitter.finalOutput());
+            fits[pass] = fitter.finalOutput();
+        }
+        CORNU_ASSERT(sameFit(fits[0], fits[1]));
+        CORNU_ASSERT(numValidated[1] < numValidated[0]);
+    }
+
+    //Oversketching refits only the stroke and its transitions between fixed primitives of the base, so the same
+    //edit of a longer base should take the same work and give the same primitives there
+    void oversketchLocalityTest()
+    {
+        Cornu::Fitter baseFitter;
+        baseFitter.setParams(Cornu::Parameters());
+        baseFitter.setOriginalSketch(wave(80, 0.1));
+        baseFitter.run();
+        Cornu::PrimitiveSequenceConstPtr shortBase = baseFitter.finalOutput();
+        CORNU_ASSERT(shortBase && !shortBase->isClosed());
+
+        Cornu::VectorC<Cornu::CurvePrimitiveConstPtr> longPrimitives = shortBase->primitives();
+        Eigen::Vector2d end = shortBase->endPos();
+        for(int i = 0; i < 500; ++i) //a zigzag going on far past the edit
+        {
+            Eigen::Vector2d next = end + Eigen::Vector2d(10, (i % 2) ? 8 : -8);
+            longPrimitives.push_back(new Cornu::Line(end, next));
+            end = next;
+        }
+        Cornu::PrimitiveSequenceConstPtr longBase = new Cornu::PrimitiveSequence(longPrimitives);
+
+        //a stroke over the middle of the short base, a little off it
+        Cornu::VectorC<Eigen::Vector2d> stroke(40, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < stroke.size(); ++i)
+        {
+            double s = shortBase->length() * (0.3 + 0.4 * i / (stroke.size() - 1));
+            Eigen::Vector2d der;
+            Eigen::Vector2d pos;
+            shortBase->eval(s, &pos, &der);
+            stroke[i] = pos + Eigen::Vector2d(-der[1], der[0]) * 3. * sin(Cornu::PI * i / (stroke.size() - 1));
+        }
+
+        Cornu::FitStats stats[2];
+        Cornu::PrimitiveSequenceConstPtr results[2];
+        for(int pass = 0; pass < 2; ++pass)
+        {
+            Cornu::Fitter fitter;
+            fitter.setParams(Cornu::Parameters());
+            fitter.setOversketchBase(pass ? longBase : shortBase);
+            fitter.setOriginalSketch(new Cornu::Polyline(stroke));
+            stats[pass] = fitter.run();
+            results[pass] = fitter.finalOutput();
+            CORNU_ASSERT(results[pass]);
+        }
+
+        CORNU_ASSERT(stats[0].numResampledPoints == stats[1].numResampledPoints);
+        CORNU_ASSERT(stats[0].numCandidatePrimitives == stats[1].numCandidatePrimitives);
+        CORNU_ASSERT(stats[0].numGraphEdges == stats[1].numGraphEdges);
+        CORNU_ASSERT(results[1]->primitives().size() == results[0]->primitives().size() + 500);
+        for(int i = 0; i < results[0]->primitives().size(); ++i) //the zigzag follows what is left of the short base
+            CORNU_ASSERT(fabs(results[0]->primitives()[i]->length() - results[1]->primitives()[i]->length()) < 1e-9);
+    }
+
+    void jointTest()
+    {
+        Cornu::VectorC<Eigen::Vector2d> meeting(30, Cornu::NOT_CIRCULAR), landing(20, Cornu::NOT_CIRCULAR);
+        Cornu::PolylineConstPtr main = wave(40, 0.15);
+        Eigen::Vector2d mainEnd = main->pts()[main->pts().size() - 1];
+        for(int i = 0; i < meeting.size(); ++i) //starts short of the end of main
+            meeting[i] = mainEnd + Eigen::Vector2d(6 + 2 * sin(0.2 * i), 8 + 8 * i);
+        for(int i = 0; i < landing.size(); ++i) //ends above the middle of main
+            landing[i] = Eigen::Vector2d(250 + 3 * sin(0.3 * i), 400 - 170. * i / (landing.size() - 1));
+
+        Cornu::JointFitter joint;
+        int mainIdx = joint.addStroke(main);
+        int meetingIdx = joint.addStroke(new Cornu::Polyline(meeting));
+        int landingIdx = joint.addStroke(new Cornu::Polyline(landing));
+        int aloneIdx = joint.addStroke(wave(30, 0.2));
+        joint.addIncidence(Cornu::StrokeIncidence(mainIdx, Cornu::StrokeIncidence::END, meetingIdx, Cornu::StrokeIncidence::START));
+        joint.addIncidence(Cornu::StrokeIncidence(meetingIdx, Cornu::StrokeIncidence::START, mainIdx, Cornu::StrokeIncidence::END)); //says it again
+        joint.addIncidence(Cornu::StrokeIncidence(landingIdx, Cornu::StrokeIncidence::END, mainIdx, Cornu::StrokeIncidence::ANYWHERE));
+        joint.addIncidence(Cornu::StrokeIncidence(aloneIdx, Cornu::StrokeIncidence::START, 7, Cornu::StrokeIncidence::ANYWHERE)); //no such stroke
+        joint.run();
+
+        for(int i = 0; i < joint.numStrokes(); ++i)
+        {
+            CORNU_ASSERT(joint.output(i));
+            Cornu::PolylineConstPtr sketch = joint.fitter(i).originalSketch();
+            for(int j = 0; j < sketch->pts().size(); ++j)
+                CORNU_ASSERT_LT_MSG(joint.output(i)->distanceTo(sketch->pts()[j]), 15., "Joint fit is too far from the sketch");
+        }
+        CORNU_ASSERT_LT_MSG((joint.output(mainIdx)->endPos() - joint.output(meetingIdx)->startPos()).norm(), 1e-3, "Joined ends don't meet");
+        CORNU_ASSERT_LT_MSG(joint.output(mainIdx)->distanceTo(joint.output(landingIdx)->endPos()), 1e-3, "Joined end isn't on the other stroke");
+
+        //separately, the ends don't meet, and a stroke without incidences gets the same fit
+        Cornu::Fitter separate[4];
+        for(int i = 0; i < 4; ++i)
+        {
+            separate[i].setOriginalSketch(joint.fitter(i).originalSketch());
+            separate[i].run();
+        }
+        CORNU_ASSERT((separate[mainIdx].finalOutput()->endPos() - separate[meetingIdx].finalOutput()->startPos()).norm() > 5.);
+        CORNU_ASSERT(separate[mainIdx].finalOutput()->distanceTo(separate[landingIdx].finalOutput()->endPos()) > 5.);
+        CORNU_ASSERT(separate[aloneIdx].finalOutput()->primitives().size() == joint.output(aloneIdx)->primitives().size());
+        CORNU_ASSERT(separate[aloneIdx].finalOutput()->length() == joint.output(aloneIdx)->length());
+
+        //the joint solve keeps to the time budget and stops when cancelled
+        Cornu::JointFitter limited;
+        limited.addStroke(main);
+        limited.addStroke(new Cornu::Polyline(landing));
+        limited.addIncidence(Cornu::StrokeIncidence(1, Cornu::StrokeIncidence::END, 0, Cornu::StrokeIncidence::ANYWHERE));
+        limited.setTimeBudget(1e-6);
+        limited.run();
+        CORNU_ASSERT(limited.output(0) && limited.output(1));
+        CORNU_ASSERT(limited.fitter(0).stats().degraded && limited.fitter(1).stats().degraded);
+        CORNU_ASSERT(limited.fitter(0).output<Cornu::COMBINING>()->lsIterations <= 5);
+        Cornu::CancellationTokenPtr token = new Cornu::CancellationToken();
+        token->cancel();
+        limited.setTimeBudget(0.);
+        limited.setCancellationToken(token);
+        limited.run();
+        CORNU_ASSERT(!limited.output(0) && !limited.output(1));
+        CORNU_ASSERT(limited.fitter(0).stats().cancelled && limited.fitter(1).stats().cancelled);
+    }
+
+    //Around a nearly circular closed curve, the continuity constraints are nearly dependent, so their solve must
+    //not leave the combined curve to rounding: moving the sketch by much less than a pixel should barely change it.
+    void closedCircleTest()
+    {
+        double objectives[2];
+        for(int pass = 0; pass < 2; ++pass)
+        {
+            Cornu::VectorC<Eigen::Vector2d> pts(201, Cornu::NOT_CIRCULAR);
+            for(int i = 0; i < pts.size(); ++i)
+            {
+                double a = 2 * Cornu::PI * i / (pts.size() - 1);
+                pts[i] = Eigen::Vector2d(300 + pass * 1e-9, 300) + 100 * Eigen::Vector2d(cos(a), sin(a)) + 0.5 * Eigen::Vector2d(sin(39. * i), cos(57. * i));
+            }
+
+            Cornu::Fitter fitter;
+            fitter.setParams(Cornu::Parameters(Cornu::Parameters::CLOTHOID_ONLY));
+            fitter.setOriginalSketch(new Cornu::Polyline(pts));
+            fitter.run();
+            CORNU_ASSERT(fitter.output<Cornu::CURVE_CLOSING>()->closed);
+            CORNU_ASSERT(fitter.output<Cornu::COMBINING>()->lsIterations > 0);
+            objectives[pass] = fitter.output<Cornu::COMBINING>()->objective;
+        }
+        CORNU_ASSERT(fabs(objectives[1] - objectives[0]) < 1e-3 * objectives[0]);
+    }
+
+    //without debugging, the parameters of the sketch points are only found when asked for, which may be after
+    //the fitter has moved on to another sketch
+    void lazyParametersTest()
+    {
+        Cornu::Fitter quiet, fresh;
+        Debugging *debugging = Debugging::get();
+        Debugging::setForCurrentThread(Debugging::null());
+        quiet.setOriginalSketch(wave(40, 0.15));
+        quiet.run();
+        Cornu::smart_ptr<const Cornu::AlgorithmOutput<Cornu::COMBINING> > combined = quiet.output<Cornu::COMBINING>();
+        CORNU_ASSERT(combined->parameterTracking);
+        quiet.setOriginalSketch(wave(30, 0.2));
+        quiet.run();
+        Debugging::setForCurrentThread(debugging);
+
+        fresh.setOriginalSketch(wave(40, 0.15));
+        fresh.run();
+        CORNU_ASSERT(combined->parameters() == fresh.originalSketchToFinalParameters());
+        CORNU_ASSERT(!combined->parameterTracking);
+        CORNU_ASSERT(fabs(combined->parameters().back() - combined->output->length()) < 1e-8);
+    }
+
+    //resampling the segments between corners with several threads should give exactly the serial output, on an
+    //open curve with corners and on a closed one
+    void parallelResamplingTest()
+    {
+        Cornu::VectorC<Eigen::Vector2d> zigzag(150, Cornu::NOT_CIRCULAR), square(160, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < zigzag.size(); ++i)
+            zigzag[i] = Eigen::Vector2d(100 + 4 * i, 200 + 4 * abs(i % 30 - 15) + 3 * sin(0.2 * i));
+        for(int i = 0; i < square.size(); ++i)
+        {
+            int side = i / 40, along = i % 40;
+            Eigen::Vector2d corners[5] = { Eigen::Vector2d(100, 100), Eigen::Vector2d(300, 100), Eigen::Vector2d(300, 300),
+                                           Eigen::Vector2d(100, 300), Eigen::Vector2d(100, 100) };
+            square[i] = corners[side] + (corners[side + 1] - corners[side]) * along / 40. + Eigen::Vector2d(0, 2 * sin(0.5 * i));
+        }
+
+        Cornu::VectorC<Eigen::Vector2d> sketches[2] = { zigzag, square };
+        for(int k = 0; k < 2; ++k)
+        {
+            Cornu::Fitter fitters[2];
+            for(int pass = 0; pass < 2; ++pass)
+            {
+                Cornu::Parameters params;
+                params.set(Cornu::Parameters::RESAMPLING_THREADS, pass ? 4 : 1);
+                fitters[pass].setParams(params);
+                fitters[pass].setOriginalSketch(new Cornu::Polyline(sketches[k]));
+                fitters[pass].run();
+                CORNU_ASSERT(fitters[pass].finalOutput());
+            }
+
+            Cornu::smart_ptr<const Cornu::AlgorithmOutput<Cornu::RESAMPLING> > serial = fitters[0].output<Cornu::RESAMPLING>();
+            Cornu::smart_ptr<const Cornu::AlgorithmOutput<Cornu::RESAMPLING> > parallel = fitters[1].output<Cornu::RESAMPLING>();
+            CORNU_ASSERT_MSG(std::count(serial->corners.begin(), serial->corners.end(), true) >= 3, "Curve has too few segments between corners");
+            CORNU_ASSERT(parallel->output->pts() == serial->output->pts());
+            CORNU_ASSERT(parallel->corners == serial->corners);
+            CORNU_ASSERT(parallel->parameters == serial->parameters);
+            CORNU_ASSERT(fitters[1].finalOutput()->length() == fitters[0].finalOutput()->length());
+        }
+    }
+
+    void paramChangeTest()
+    {
+        Cornu::VectorC<Eigen::Vector2d> pts(40, Cornu::NOT_CIRCULAR);
+        for(int i = 0; i < pts.size(); ++i)
+            pts[i] = Eigen::Vector2d(100 + 8 * i, 200 + 60 * sin(0.15 * i));
+
+        Cornu::Parameters params;
+        Cornu::Fitter fitter;
+        fitter.setParams(params);
+        fitter.setOriginalSketch(new Cornu::Polyline(pts));
+        fitter.run();
+        Cornu::smart_ptr<const Cornu::AlgorithmOutput<Cornu::PRIMITIVE_FITTING> > primitives = fitter.output<Cornu::PRIMITIVE_FITTING>();
+
+        //changing a graph cost should not rerun primitive fitting, but should give the same result as a new fitter
+        params.set(Cornu::Parameters::G2_COST, 5.);
+        fitter.setParams(params);
+        CORNU_ASSERT(fitter.output<Cornu::PRIMITIVE_FITTING>() == primitives);
+        CORNU_ASSERT(!fitter.output<Cornu::GRAPH_CONSTRUCTION>());
+        fitter.run();
+
+        Cornu::Fitter fresh;
+        fresh.setParams(params);
+        fresh.setOriginalSketch(new Cornu::Polyline(pts));
+        fresh.run();
+        CORNU_ASSERT(fitter.finalOutput()->primitives().size() == fresh.finalOutput()->primitives().size());
+        CORNU_ASSERT(fitter.finalOutput()->length() == fresh.finalOutput()->length());
+
+        //stopping the validation solves early should only rerun path finding, unless the pieces are joined by them
+        params.set(Cornu::Parameters::VALIDATION_EARLY_STOP, 1.);
+        fitter.setParams(params);
+        CORNU_ASSERT(fitter.output<Cornu::GRAPH_CONSTRUCTION>());
+        CORNU_ASSERT(!fitter.output<Cornu::PATH_FINDING>());
+        fitter.run();
+        params.set(Cornu::Parameters::HIERARCHICAL_POINTS, 20.);
+        fitter.setParams(params);
+        fitter.run();
+        params.set(Cornu::Parameters::VALIDATION_EARLY_STOP, 0.);
+        fitter.setParams(params);
+        CORNU_ASSERT(!fitter.output<Cornu::PRIMITIVE_FITTING>());
+
+        //changing the error threshold should rerun it
+        params.set(Cornu::Parameters::ERROR_THRESHOLD, 3.);
+        fitter.setParams(params);
+        CORNU_ASSERT(!fitter.output<Cornu::PRIMITIVE_FITTING>());
+        CORNU_ASSERT(fitter.output<Cornu::RESAMPLING>());
+    }
 };
 
 static EndToEndTest test;
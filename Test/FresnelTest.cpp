@@ -56,6 +56,27 @@ public:
         Debugging::get()->printf("Done, max relative error = %.10lf", relErr);
 
         CORNU_ASSERT(relErr < 1e-6);
+
+        //the vectorized double precision version should match the scalar one
+        double maxDiff = 0;
+        for(int i = 0; i < num; i += 7)
+        {
+            double s, c;
+            fresnel(t[i], &s, &c);
+            maxDiff = max(maxDiff, max(fabs(s - s1[i]), fabs(c - c1[i])));
+        }
+        CORNU_ASSERT_LT_MSG(maxDiff, 1e-15, "Vectorized Fresnel differs from scalar");
+
+        //the tables are accurate to about 1e-10 in absolute terms, including past where they end
+        VectorXd tWide = 2. * t, s3, c3, s4, c4;
+        fresnel(tWide, &s4, &c4);
+        Debugging::get()->startTiming("Fresnel table");
+        fresnelTable(tWide, &s3, &c3);
+        Debugging::get()->elapsedTime("Fresnel table");
+
+        double tableErr = max((s3 - s4).cwiseAbs().maxCoeff(), (c3 - c4).cwiseAbs().maxCoeff());
+        Debugging::get()->printf("Max table error = %g", tableErr);
+        CORNU_ASSERT_LT_MSG(tableErr, 1e-10, "Fresnel table is inaccurate");
     }
 
     double f(int i, int num)
@@ -21,6 +21,7 @@
 #include "Test.h"
 
 #include "Polyline.h"
+#include "PiecewiseLinearUtils.h"
 
 using namespace std;
 using namespace Eigen;
@@ -48,10 +49,130 @@ public:
         pts2[2] = Vector2d(5, 4);
         
         testPolyline(Polyline(pts2));
+
+        testProject(NOT_CIRCULAR);
+        testProject(CIRCULAR);
+
+        testCirculator(NOT_CIRCULAR);
+        testCirculator(CIRCULAR);
+
+        testPiecewiseLinear(PiecewiseLinearMonotone::POSITIVE);
+        testPiecewiseLinear(PiecewiseLinearMonotone::NEGATIVE);
+    }
+
+    //a frozen function should evaluate and invert exactly like the one it was frozen from, and batchEval should
+    //give the same as evaluating one x at a time, also when the x's go back
+    void testPiecewiseLinear(PiecewiseLinearMonotone::Sign sign)
+    {
+        PiecewiseLinearMonotone live(sign), frozen(sign);
+        double x = 0., y = 0.;
+        for(int i = 0; i < 30; ++i)
+        {
+            live.add(x, y);
+            frozen.add(x, y);
+            if(i == 10)
+                y += (sign == PiecewiseLinearMonotone::POSITIVE ? 1. : -1.) * 2.; //a jump
+            else
+                x += drand(0.1, 1.);
+            if(i != 20) //and a flat stretch
+                y += (sign == PiecewiseLinearMonotone::POSITIVE ? 1. : -1.) * drand(0.1, 1.);
+        }
+        frozen.freeze();
+        CORNU_ASSERT(frozen.frozen() && !live.frozen());
+        CORNU_ASSERT(frozen.minX() == live.minX() && frozen.maxX() == live.maxX());
+
+        vector<double> xs;
+        for(int i = 0; i < 200; ++i)
+            xs.push_back(drand(live.minX() - 1., live.maxX() + 1.) + (i % 7 == 0 ? -3. : 0.));
+        xs.push_back(live.minX());
+        xs.push_back(live.maxX());
+        for(int i = 0; i + 1 < (int)xs.size(); i += 3) //mostly increasing, as when resampling
+            sort(xs.begin() + i, xs.begin() + min((int)xs.size(), i + 3));
+
+        vector<double> expected(xs.size());
+        bool allGood = true;
+        for(int i = 0; i < (int)xs.size(); ++i)
+        {
+            double liveY = 0., frozenY = 0., liveX = 0., frozenX = 0.;
+            bool good = live.eval(xs[i], liveY);
+            CORNU_ASSERT(frozen.eval(xs[i], frozenY) == good);
+            CORNU_ASSERT(frozenY == liveY);
+            CORNU_ASSERT(frozen.invert(liveY, frozenX) == live.invert(liveY, liveX));
+            CORNU_ASSERT(frozenX == liveX);
+            expected[i] = liveY;
+            allGood = allGood && good;
+        }
+        CORNU_ASSERT(!allGood); //some x's are out of range
+
+        vector<double> liveBatch = xs, frozenBatch = xs;
+        CORNU_ASSERT(!live.batchEval(liveBatch) && !frozen.batchEval(frozenBatch));
+        CORNU_ASSERT(liveBatch == expected && frozenBatch == expected);
+    }
+
+    //circulators wrap without division--they should agree with indexing by modulo
+    void testCirculator(CircularType circular)
+    {
+        VectorC<int> v(5, circular);
+        for(int i = 0; i < v.size(); ++i)
+            v[i] = i;
+        for(int idx = -12; idx < 12; ++idx)
+            if(circular)
+                CORNU_ASSERT(v.toLinearIdx(idx) == ((idx % 5) + 5) % 5);
+
+        for(int start = 0; start < v.size(); ++start)
+        {
+            for(int sign = -1; sign < 2; sign += 2)
+            {
+                VectorC<int>::Circulator circ = v.circulator(start);
+                int steps = 0;
+                for(; !circ.done(); sign > 0 ? ++circ : --circ, ++steps)
+                {
+                    int expected = start + sign * steps;
+                    CORNU_ASSERT(*circ == (circular ? (expected + 5) % 5 : expected) && circ.index() == *circ);
+                    CORNU_ASSERT((circ + 7).index() == v.circulator(expected + 7).index() || !circular);
+                    CORNU_ASSERT((circ - 6).index() == v.circulator(expected - 6).index() || !circular);
+                }
+                CORNU_ASSERT(steps == (circular ? 5 : (sign > 0 ? 5 - start : start + 1)));
+            }
+        }
+    }
+
+    //a long polyline gets a segment tree for projection--it should give the same results as checking every segment
+    void testProject(CircularType circular)
+    {
+        seedTestRand(1);
+        VectorC<Vector2d> pts(2000, circular);
+        pts[0] = Vector2d(0, 0);
+        for(int i = 1; i < pts.size(); ++i)
+            pts[i] = pts[i - 1] + Vector2d(cos(0.01 * i), sin(0.013 * i)) + 0.3 * Vector2d(drand(-1, 1), drand(-1, 1));
+        Polyline p(pts);
+
+        for(int i = 0; i < 200; ++i)
+        {
+            Vector2d pt = pts[irand(pts.size())] + 20. * Vector2d(drand(-1, 1), drand(-1, 1));
+            double minDistSq = 1e100;
+            for(int j = 0; j < pts.endIdx(1); ++j)
+            {
+                Vector2d der = pts[j + 1] - pts[j];
+                double t = max(0., min(1., der.dot(pt - pts[j]) / der.squaredNorm()));
+                minDistSq = min(minDistSq, (pts[j] + t * der - pt).squaredNorm());
+            }
+
+            double param = p.project(pt);
+            CORNU_ASSERT_LT_MSG(fabs((p.pos(param) - pt).squaredNorm() - minDistSq), 1e-8, "Incorrect projection");
+            CORNU_ASSERT_LT_MSG(fabs(p.distanceSqTo(pt) - minDistSq), 1e-8, "Incorrect distance");
+        }
     }
 
     void testPolyline(const Polyline &p)
     {
+        //the bounds, found along with the lengths, are those of the points
+        BoxTree::Box bounds;
+        for(int i = 0; i < p.pts().size(); ++i)
+            bounds.extend(p.pts()[i]);
+        for(int i = 0; i < 2; ++i)
+            CORNU_ASSERT(p.bounds().min[i] == bounds.min[i] && p.bounds().max[i] == bounds.max[i]);
+
         vector<double> params;
         vector<int> indices;
 
@@ -66,6 +187,15 @@ public:
             indices.push_back(idx);
         }
 
+        //a cursor should give exactly what eval does, whichever way the parameters go
+        Polyline::Cursor cursor(p);
+        for(int i = 0; i < 3 * num; ++i)
+        {
+            double param = (i < num) ? params[i] : p.length() * drand(0, 1);
+            CORNU_ASSERT(cursor.pos(param) == p.pos(param));
+            CORNU_ASSERT(cursor.advanceTo(param) == p.paramToIdx(p.isClosed() ? fmod(param, p.length()) : param));
+        }
+
         for(int i = 1; i < (int)indices.size(); ++i)
         {
             CORNU_ASSERT(indices[i] >= indices[i - 1]);
@@ -100,8 +230,44 @@ public:
                     Vector2d diff = trim->pos(x) - p.pos(from + x);
                     CORNU_ASSERT_LT_MSG(diff.norm(), 1e-8, "Incorrect trim");
                 }
+
+                testView(p.trimmedView(from, to), *trim);
             }
         }
+
+        //views between points
+        for(int from = 0; from < p.pts().size(); ++from)
+        {
+            for(int to = 0; to < p.pts().size(); ++to)
+            {
+                if(to <= from && !p.isClosed())
+                    continue;
+
+                VectorC<Vector2d> pts(0, NOT_CIRCULAR);
+                for(VectorC<Vector2d>::Circulator circ = p.pts().circulator(from); ; ++circ)
+                {
+                    pts.push_back(*circ);
+                    if(pts.size() > 1 && circ.index() == to)
+                        break;
+                }
+                testView(PolylineView(p, from, to), Polyline(pts));
+            }
+        }
+        testView(PolylineView(p), p);
+    }
+
+    void testView(const PolylineView &view, const Polyline &copy)
+    {
+        CORNU_ASSERT(view.isClosed() == copy.isClosed());
+        CORNU_ASSERT_LT_MSG(fabs(view.length() - copy.length()), 1e-8, "Incorrect view length");
+        CORNU_ASSERT(view.numPts() == copy.pts().size());
+        for(int i = 0; i < view.numPts(); ++i)
+        {
+            CORNU_ASSERT_LT_MSG((view.pt(i) - copy.pts()[i]).norm(), 1e-8, "Incorrect view point " << i);
+            CORNU_ASSERT_LT_MSG(fabs(view.idxToParam(i) - copy.idxToParam(i)), 1e-8, "Incorrect view parameter " << i);
+        }
+        for(double x = 0; x < copy.length(); x += 0.05)
+            CORNU_ASSERT_LT_MSG((view.pos(x) - copy.pos(x)).norm(), 1e-8, "Incorrect view position");
     }
 };
 
@@ -21,7 +21,17 @@
 #include "Test.h"
 
 #include "PrimitiveSequence.h"
+#include "PackedPrimitiveSequence.h"
 #include "Line.h"
+#include "Arc.h"
+#include "Clothoid.h"
+#include "Bezier.h"
+#include "SketchFile.h"
+#include "Polyline.h"
+#include "Arena.h"
+
+#include <Eigen/Geometry>
+#include <cstring>
 
 using namespace std;
 using namespace Eigen;
@@ -57,6 +67,381 @@ public:
             prims2[i] = new Line(pts2[i], pts2[(i + 1) % 3]);
         
         testPrimitiveSequence(PrimitiveSequence(prims2));
+
+        testProject();
+        testTransform();
+        testTessellate();
+        testPacked();
+        testArenaAlignment();
+        testPathWriter();
+        testSketchFile();
+    }
+
+    void testPathWriter()
+    {
+        VectorC<CurvePrimitiveConstPtr> line(1, NOT_CIRCULAR);
+        line[0] = new Line(Vector2d(0, 0.5), Vector2d(-1.5, 2e-4));
+        ostringstream svg;
+        PathWriter(svg).write(PrimitiveSequence(line), 1e-3);
+        CORNU_ASSERT_MSG(svg.str() == "M 0 0.5 L -1.5 0", "Wrong SVG path: " << svg.str());
+
+        ostringstream pdf;
+        PathWriter(pdf, PathWriter::PDF, 2).write(PrimitiveSequence(line), 1e-3);
+        CORNU_ASSERT_MSG(pdf.str() == "0 0.5 m\n-1.5 0 l\n", "Wrong PDF path: " << pdf.str());
+
+        //numbers too long to format are cut off instead of read past the end
+        VectorC<CurvePrimitiveConstPtr> far(1, NOT_CIRCULAR);
+        far[0] = new Line(Vector2d(1e300, 0.5), Vector2d(-1.5, 1.));
+        ostringstream huge, precise;
+        PathWriter(huge).write(PrimitiveSequence(far), 1e-3);
+        PathWriter(precise, PathWriter::SVG, 35).write(PrimitiveSequence(line), 1e-3);
+        CORNU_ASSERT_MSG(huge.str().size() < 100 && huge.str().compare(0, 3, "M 1") == 0, "Wrong SVG path: " << huge.str());
+        CORNU_ASSERT_MSG(precise.str().size() < 200 && precise.str().compare(0, 6, "M 0.00") == 0, "Wrong SVG path: " << precise.str());
+
+        //an arc turning by more than pi is split for SVG, and clothoids become cubics
+        VectorC<CurvePrimitiveConstPtr> prims(3, NOT_CIRCULAR);
+        prims[0] = new Arc(Vector2d(1, 1), 0.5, 10., 0.5);
+        prims[1] = new Clothoid(prims[0]->endPos(), prims[0]->endAngle(), 3., 0.5, -0.2);
+        prims[2] = new Line(prims[1]->endPos(), Vector2d(4, 4));
+        PrimitiveSequence seq(prims);
+        ostringstream out;
+        {
+            PathWriter writer(out);
+            writer.write(seq, 1e-3);
+            writer.write(*seq.toBezierSpline(1e-3));
+        }
+        string str = out.str();
+        CORNU_ASSERT(str.find("A 2 2 0 0 1") != string::npos && str.find("A", str.find("A") + 1) < str.find("C"));
+        CORNU_ASSERT(str.find("L 4 4 M") != string::npos);
+
+        //the same into a buffer, and cut off when the buffer's too small
+        vector<char> buffer(str.size());
+        PathWriter toBuffer(&(buffer[0]), buffer.size());
+        toBuffer.write(seq, 1e-3);
+        toBuffer.write(*seq.toBezierSpline(1e-3));
+        CORNU_ASSERT(!toBuffer.truncated() && toBuffer.size() == str.size() && string(buffer.begin(), buffer.end()) == str);
+        PathWriter small(&(buffer[0]), 10);
+        small.write(seq, 1e-3);
+        CORNU_ASSERT(small.truncated());
+    }
+
+    void testSketchFile()
+    {
+        VectorC<CurvePrimitiveConstPtr> prims(3, CIRCULAR);
+        prims[0] = new Arc(Vector2d(1, 1), 0.5, 2., 0.5);
+        prims[1] = new Clothoid(prims[0]->endPos(), prims[0]->endAngle(), 3., 0.5, -0.2);
+        prims[2] = new Line(prims[1]->endPos(), prims[0]->startPos());
+
+        VectorC<Vector2d> pts(4, NOT_CIRCULAR);
+        for(int i = 0; i < pts.size(); ++i)
+            pts[i] = Vector2d(i, 0.5 * i * i);
+
+        vector<SketchFileEntry> entries(3);
+        for(int i = 0; i < 3; ++i)
+            entries[i].pts = new Polyline(pts);
+        entries[0].curve = new PrimitiveSequence(prims);
+        entries[1].params.set(Parameters::PIXEL_SIZE, 2.5);
+        entries[2].oversketch = 1;
+
+        ostringstream out;
+        CORNU_ASSERT(writeSketchFile(out, entries));
+        string str = out.str();
+        vector<double> data((str.size() + 7) / 8); //for alignment
+        memcpy(&(data[0]), str.data(), str.size());
+
+        SketchFileView view(&(data[0]), str.size());
+        CORNU_ASSERT(view.isValid() && view.numSketches() == 3);
+        CORNU_ASSERT(view.sketch(0).parameterSet == view.sketch(2).parameterSet && view.sketch(0).parameterSet != view.sketch(1).parameterSet);
+        CORNU_ASSERT(view.parameters(1).get(Parameters::PIXEL_SIZE) == 2.5 && view.entry(2).oversketch == 1);
+        CORNU_ASSERT(view.points(1)[7] == 4.5 && view.polyline(2)->pts()[3] == pts[3]);
+        CORNU_ASSERT(!view.curve(1));
+
+        PrimitiveSequencePtr curve = view.curve(0);
+        CORNU_ASSERT(curve->isClosed() && curve->primitives().size() == 3 && curve->primitives()[1]->getType() == CurvePrimitive::CLOTHOID);
+        for(double s = 0; s < curve->length(); s += 0.1)
+            CORNU_ASSERT_LT_MSG((curve->pos(s) - entries[0].curve->pos(s)).norm(), 1e-12, "Sketch file curve changed");
+
+        //damaged files are rejected, including counts and offsets chosen so that the bounds checks would wrap around
+        const uint64_t huge = ~uint64_t(0);
+        for(int damage = 0; damage < 9; ++damage)
+        {
+            vector<double> bad = data;
+            SketchFileHeader &header = *(SketchFileHeader *)&(bad[0]);
+            SketchFileSketch &sketch = *(SketchFileSketch *)((char *)&(bad[0]) + header.sketchesOffset);
+            switch(damage)
+            {
+            case 0: sketch.firstPoint = huge - 1000000; sketch.numPoints = 1000000; break;
+            case 1: sketch.firstPrimitive = huge - 1; sketch.numPrimitives = 3; break;
+            case 2: sketch.oversketch = -2; break;
+            case 3: header.numPoints = huge / 16 + 2; break;
+            case 4: header.numPrimitives = huge / sizeof(SketchFilePrimitive) + 2; break;
+            case 5: header.numParameterSets = 0xffffffffu; break;
+            case 6: header.numParameters = 0xffffffffu; break;
+            case 7: header.pointsOffset = huge - 7; break;
+            case 8: header.numSketches = 0xffffffffu; break;
+            }
+            CORNU_ASSERT_MSG(!SketchFileView(&(bad[0]), str.size()).isValid(), "Damaged sketch file " << damage << " accepted");
+        }
+        CORNU_ASSERT(!SketchFileView(&(data[0]), str.size() - 1).isValid());
+        ((char *)&(data[0]))[0] = 'X';
+        CORNU_ASSERT(!SketchFileView(&(data[0]), str.size()).isValid());
+    }
+
+    //projection skips primitives using their bounding boxes--it should find the same point as trying all of them
+    void testProject()
+    {
+        seedTestRand(1);
+        VectorC<CurvePrimitiveConstPtr> prims(300, NOT_CIRCULAR);
+        Vector2d pos(0, 0);
+        double angle = 0, curvature = 0;
+        for(int i = 0; i < prims.size(); ++i)
+        {
+            double length = 1. + irand(10);
+            double endCurvature = 0.2 * (drand(0, 1) - 0.5);
+            if(i % 3 == 0)
+                prims[i] = new Line(pos, pos + length * Vector2d(cos(angle), sin(angle)));
+            else if(i % 3 == 1)
+                prims[i] = new Arc(pos, angle, length, endCurvature);
+            else
+                prims[i] = new Clothoid(pos, angle, length, curvature, endCurvature);
+            pos = prims[i]->endPos();
+            angle = prims[i]->endAngle();
+            curvature = prims[i]->endCurvature();
+        }
+        PrimitiveSequence seq(prims);
+
+        for(int i = 0; i < 100; ++i)
+        {
+            Vector2d pt = prims[irand(prims.size())]->startPos() + 10. * Vector2d(drand(-1, 1), drand(-1, 1));
+            double minDistSq = 1e50, bestS = 0, startS = 0;
+            for(int j = 0; j < prims.size(); startS += prims[j]->length(), ++j)
+            {
+                double s = prims[j]->project(pt);
+                double distSq = (prims[j]->pos(s) - pt).squaredNorm();
+                if(distSq < minDistSq)
+                {
+                    minDistSq = distSq;
+                    bestS = startS + s;
+                }
+            }
+
+            CORNU_ASSERT_LT_MSG(fabs(seq.project(pt) - bestS), 1e-8, "Incorrect projection");
+            CORNU_ASSERT_LT_MSG(fabs(seq.distanceSqTo(pt) - minDistSq), 1e-8, "Incorrect distance");
+            CORNU_ASSERT(seq.boundsDistanceSq(pt) <= minDistSq);
+
+            //a hint anywhere should lead to the same point
+            double nearS = seq.projectNear(pt, seq.length() * drand(0, 1));
+            CORNU_ASSERT_LT_MSG(fabs((seq.pos(nearS) - pt).squaredNorm() - minDistSq), 1e-8, "Incorrect projection from hint");
+        }
+
+        //the Bezier conversion is checked at points where it compares with the curve
+        const double tolerance = 1e-3;
+        BezierSplinePtr spline = seq.toBezierSpline(tolerance);
+        CORNU_ASSERT(spline->primitives().size() >= prims.size());
+        CORNU_ASSERT((spline->primitives()[0].controlPoint(0) - seq.startPos()).norm() < 1e-10);
+        CORNU_ASSERT((spline->primitives().back().controlPoint(3) - seq.endPos()).norm() < 1e-10);
+        for(int i = 0; i < (int)spline->primitives().size(); ++i)
+        {
+            if(i > 0)
+                CORNU_ASSERT((spline->primitives()[i].controlPoint(0) - spline->primitives()[i - 1].controlPoint(3)).norm() < 1e-10);
+            for(int m = 1; m < 4; ++m)
+            {
+                Vector2d pt;
+                spline->primitives()[i].eval(0.25 * m, &pt);
+                CORNU_ASSERT_LT_MSG(seq.distanceTo(pt), tolerance, "Bezier conversion too far from curve");
+            }
+        }
+    }
+
+    //tessellations should stay within the tolerance of the curve and meet up at the primitive joints
+    void testTessellate()
+    {
+        const double tolerance = 1e-2;
+        VectorC<CurvePrimitiveConstPtr> prims(5, NOT_CIRCULAR);
+        prims[0] = new Line(Vector2d(1, 2), Vector2d(4, 3));
+        prims[1] = new Arc(prims[0]->endPos(), prims[0]->endAngle(), 5., 0.3);
+        prims[2] = new Clothoid(prims[1]->endPos(), prims[1]->endAngle(), 6., 0.3, -0.2);
+        prims[3] = new Clothoid(prims[2]->endPos(), prims[2]->endAngle(), 20., -0.2, 1.5);
+        prims[4] = new Arc(prims[3]->endPos(), prims[3]->endAngle(), 3., 1e-9);
+        PrimitiveSequence seq(prims);
+
+        int total = 0;
+        for(int i = 0; i < prims.size(); ++i)
+        {
+            Curve::PointVector pts;
+            prims[i]->tessellate(tolerance, pts);
+            total += (int)pts.size();
+            CORNU_ASSERT((pts[0] - prims[i]->startPos()).norm() < 1e-10);
+            CORNU_ASSERT((pts.back() - prims[i]->endPos()).norm() < 1e-10);
+            for(int j = 0; j <= 200; ++j)
+            {
+                Vector2d pt = prims[i]->pos(prims[i]->length() * j / 200.);
+                double minDistSq = 1e50;
+                for(int k = 0; k + 1 < (int)pts.size(); ++k)
+                {
+                    Vector2d dir = pts[k + 1] - pts[k];
+                    double t = max(0., min(1., (pt - pts[k]).dot(dir) / dir.squaredNorm()));
+                    minDistSq = min(minDistSq, (pts[k] + t * dir - pt).squaredNorm());
+                }
+                CORNU_ASSERT_LT_MSG(sqrt(minDistSq), tolerance * 1.001, "Tessellation too far from curve");
+            }
+        }
+
+        //lines and nearly straight arcs need no inner points
+        Curve::PointVector pts;
+        prims[0]->tessellate(tolerance, pts);
+        CORNU_ASSERT(pts.size() == 2);
+        pts.clear();
+        prims[4]->tessellate(tolerance, pts);
+        CORNU_ASSERT(pts.size() == 2);
+
+        pts.clear();
+        seq.tessellate(tolerance, pts);
+        CORNU_ASSERT((int)pts.size() == total - ((int)prims.size() - 1));
+    }
+
+    //primitives from an arena must be aligned as their Eigen members need (32 bytes for a Matrix2d with AVX),
+    //after allocations of odd sizes and in the first slot of a new block
+    void testArenaAlignment()
+    {
+        Arena arena(4096);
+        Arena::Scope scope(&arena);
+        vector<CurvePrimitiveConstPtr> prims;
+        vector<void *> raw;
+        for(int i = 0; i < 200; ++i)
+        {
+            raw.push_back(Arena::allocate(8 + i % 24));
+            Clothoid *clothoid = new Clothoid(Vector2d(i, 0), 0.1 * i, 3., 0.1, -0.2);
+            CORNU_ASSERT_MSG((size_t)clothoid % alignof(Clothoid) == 0, "Arena misaligned a clothoid at " << (void *)clothoid);
+            CORNU_ASSERT_MSG((size_t)raw.back() % max(size_t(16), size_t(EIGEN_MAX_ALIGN_BYTES)) == 0, "Arena misaligned an allocation");
+            prims.push_back(clothoid);
+        }
+        for(int i = 0; i < (int)raw.size(); ++i)
+            Arena::deallocate(raw[i]);
+    }
+
+    //a packed sequence should be close to the original, take a fraction of its memory, and unpack to itself
+    void testPacked()
+    {
+        seedTestRand(2);
+        VectorC<CurvePrimitiveConstPtr> prims(300, NOT_CIRCULAR);
+        Vector2d pos(500, 300);
+        double angle = 0, curvature = 0;
+        size_t unpackedBytes = sizeof(PrimitiveSequence);
+        for(int i = 0; i < prims.size(); ++i)
+        {
+            double length = 1. + irand(10);
+            double endCurvature = 0.2 * (drand(0, 1) - 0.5);
+            if(i % 3 == 0)
+                prims[i] = new Line(pos, pos + length * Vector2d(cos(angle), sin(angle)));
+            else if(i % 3 == 1)
+                prims[i] = new Arc(pos, angle, length, endCurvature);
+            else
+                prims[i] = new Clothoid(pos, angle, length, curvature, endCurvature);
+            pos = prims[i]->endPos();
+            angle = prims[i]->endAngle();
+            curvature = prims[i]->endCurvature();
+            unpackedBytes += (i % 3 == 0 ? sizeof(Line) : (i % 3 == 1 ? sizeof(Arc) : sizeof(Clothoid)));
+            unpackedBytes += sizeof(CurvePrimitiveConstPtr) + sizeof(double); //the pointer and the summed length
+        }
+        PrimitiveSequence seq(prims);
+        PackedPrimitiveSequence packed(seq);
+
+        CORNU_ASSERT(packed.numPrimitives() == prims.size() && !packed.isClosed());
+        CORNU_ASSERT_LT_MSG(fabs(packed.length() - seq.length()), 1e-9, "Packed length differs");
+        CORNU_ASSERT_LT_MSG(packed.memoryUsage() * 5, unpackedBytes, "Packed sequence too large");
+
+        const double tol = 1e-3;
+        vector<double> params;
+        for(int i = 0; i <= 1000; ++i)
+            params.push_back(seq.length() * i / 1000.);
+        Curve::PointVector manyPos(params.size()), manyDer(params.size());
+        packed.evalMany(&(params[0]), (int)params.size(), &(manyPos[0]), &(manyDer[0]));
+        for(int i = 0; i < (int)params.size(); ++i)
+        {
+            Vector2d p, d;
+            packed.eval(params[i], &p, &d);
+            CORNU_ASSERT(p == manyPos[i] && d == manyDer[i]);
+            CORNU_ASSERT_LT_MSG((p - seq.pos(params[i])).norm(), tol, "Packed position differs");
+            CORNU_ASSERT_LT_MSG((d - seq.der(params[i])).norm(), tol, "Packed tangent differs");
+        }
+
+        for(int i = 0; i < 100; ++i)
+        {
+            Vector2d pt = prims[irand(prims.size())]->startPos() + 10. * Vector2d(drand(-1, 1), drand(-1, 1));
+            CORNU_ASSERT_LT_MSG(fabs(packed.distanceTo(pt) - seq.distanceTo(pt)), tol, "Packed distance differs");
+            CORNU_ASSERT_LT_MSG((packed.pos(packed.project(pt)) - seq.pos(seq.project(pt))).norm(), 0.1, "Packed projection differs");
+            double nearS = packed.projectNear(pt, packed.length() * drand(0, 1));
+            CORNU_ASSERT_LT_MSG(fabs((packed.pos(nearS) - pt).norm() - packed.distanceTo(pt)), 1e-8, "Packed projection from hint differs");
+        }
+
+        Curve::PointVector packedPts, pts;
+        packed.tessellate(1e-2, packedPts);
+        seq.tessellate(1e-2, pts);
+        CORNU_ASSERT(packedPts.size() == pts.size());
+
+        //packing is lossy only the first time
+        PrimitiveSequencePtr unpacked = packed.unpacked();
+        PackedPrimitiveSequence repacked(*unpacked);
+        for(int i = 0; i < prims.size(); ++i)
+        {
+            CORNU_ASSERT(unpacked->primitives()[i]->getType() == prims[i]->getType() && packed.type(i) == prims[i]->getType());
+            CORNU_ASSERT(repacked.primitive(i)->params() == unpacked->primitives()[i]->params());
+        }
+    }
+
+    //a transformed curve should go through the transformed points, with its derivatives scaled and rotated
+    void testTransform()
+    {
+        VectorC<CurvePrimitiveConstPtr> prims(4, NOT_CIRCULAR);
+        prims[0] = new Line(Vector2d(1, 2), Vector2d(4, 3));
+        prims[1] = new Arc(prims[0]->endPos(), prims[0]->endAngle(), 5., 0.3);
+        prims[2] = new Clothoid(prims[1]->endPos(), prims[1]->endAngle(), 6., 0.3, -0.2);
+        prims[3] = new Clothoid(prims[2]->endPos(), prims[2]->endAngle(), 1., -0.2, -0.19); //evaluated as nearly an arc
+        PrimitiveSequence seq(prims);
+
+        const double scale = 2.5, angle = 2.;
+        const Vector2d translation(-3, 7);
+        Similarity similarity(scale, angle, translation);
+        PrimitiveSequencePtr transformed = seq.transformed(similarity);
+        CORNU_ASSERT(fabs(transformed->length() - scale * seq.length()) < 1e-10);
+
+        Matrix2d rotation = Rotation2D<double>(angle).toRotationMatrix();
+        for(double s = 0; s <= seq.length(); s += 0.25)
+        {
+            Vector2d pos, der, der2, tPos, tDer, tDer2;
+            seq.eval(s, &pos, &der, &der2);
+            transformed->eval(scale * s, &tPos, &tDer, &tDer2);
+            CORNU_ASSERT_LT_MSG((tPos - (scale * rotation * pos + translation)).norm(), 1e-8, "Transformed curve in the wrong place at " << s);
+            CORNU_ASSERT_LT_MSG((tDer - rotation * der).norm(), 1e-8, "Transformed tangent wrong at " << s);
+            CORNU_ASSERT_LT_MSG((tDer2 - rotation * der2 / scale).norm(), 1e-8, "Transformed curvature wrong at " << s);
+        }
+
+        //the clothoids are updated without _paramsChanged, so they should agree with ones made from their parameters
+        for(int i = 2; i < 4; ++i)
+        {
+            const CurvePrimitive &moved = *transformed->primitives()[i];
+            ClothoidPtr fresh = new Clothoid();
+            fresh->setParams(moved.params());
+            for(double s = 0; s <= moved.length(); s += 0.5)
+            {
+                Vector2d pos, freshPos, tan, freshTan;
+                CurvePrimitive::ParamDer der, derTan, freshDer, freshDerTan;
+                moved.evalWithDerivatives(s, &pos, &tan, der, derTan);
+                fresh->evalWithDerivatives(s, &freshPos, &freshTan, freshDer, freshDerTan);
+                CORNU_ASSERT_LT_MSG((pos - freshPos).norm() + (tan - freshTan).norm(), 1e-8, "Transformed clothoid evaluates differently at " << s);
+                CORNU_ASSERT_LT_MSG((der - freshDer).norm() + (derTan - freshDerTan).norm(), 1e-7, "Transformed clothoid derivatives wrong at " << s);
+            }
+            Vector2d pt = moved.startPos() + Vector2d(3, -2);
+            CORNU_ASSERT_LT_MSG(fabs(moved.project(pt) - fresh->project(pt)), 1e-8, "Transformed clothoid projects differently");
+        }
+
+        //and moving it back should give the original
+        PrimitiveSequencePtr back = transformed->transformed(similarity.inverse());
+        Similarity identity = similarity.inverse() * similarity;
+        CORNU_ASSERT(fabs(identity.scale() - 1.) < 1e-12 && fabs(identity.angle()) < 1e-12 && identity.translation().norm() < 1e-12);
+        for(double s = 0; s <= seq.length(); s += 0.25)
+            CORNU_ASSERT_LT_MSG((back->pos(s) - seq.pos(s)).norm(), 1e-8, "Transformed back to the wrong place at " << s);
     }
 
     void testPrimitiveSequence(const PrimitiveSequence &p)
@@ -74,14 +459,38 @@ public:
             for(double to = from + step; to - from < p.length(); to += step)
             {
                 PrimitiveSequencePtr trim = p.trimmed(from, to);
+                PrimitiveSequenceView view = p.trimmedView(from, to), flippedView = view.flipped();
+                CORNU_ASSERT(view.numPrimitives() == trim->primitives().size() && fabs(view.length() - trim->length()) < 1e-8);
 
                 for(double x = 0; x < trim->length(); x += step * 0.5)
                 {
                     Vector2d diff = trim->pos(x) - p.pos(from + x);
                     CORNU_ASSERT_LT_MSG(diff.norm(), 1e-8, "Incorrect trim");
+                    CORNU_ASSERT_LT_MSG((view.pos(x) - trim->pos(x)).norm(), 1e-8, "Incorrect trimmed view");
+                    CORNU_ASSERT_LT_MSG((flippedView.pos(view.length() - x) - trim->pos(x)).norm(), 1e-8, "Incorrect flipped view");
                 }
+
+                //trimming a flipped view keeps it flipped: its middle half runs backwards over the middle of the trim
+                double quarter = 0.25 * view.length();
+                PrimitiveSequenceView middle = flippedView.trimmed(quarter, 3. * quarter);
+                CORNU_ASSERT(middle.isFlipped());
+                for(double x = 0; x < middle.length(); x += step * 0.5)
+                    CORNU_ASSERT_LT_MSG((middle.pos(x) - trim->pos(3. * quarter - x)).norm(), 1e-8, "Incorrect trim of a flipped view");
             }
         }
+
+        //a flipped sequence has the same primitives as a flipped view of it
+        PrimitiveSequencePtr flipped = p.flipped();
+        PrimitiveSequenceView flippedView = p.flippedView();
+        CORNU_ASSERT(flipped->isClosed() == p.isClosed() && flippedView.numPrimitives() == flipped->primitives().size());
+        for(double x = step * 0.25; x < p.length(); x += step * 0.5) //off the corners, where the tangent jumps
+        {
+            Vector2d der, viewDer;
+            flipped->eval(x, NULL, &der);
+            flippedView.eval(x, NULL, &viewDer);
+            CORNU_ASSERT_LT_MSG((flipped->pos(x) - p.pos(p.length() - x)).norm(), 1e-8, "Incorrect flip");
+            CORNU_ASSERT_LT_MSG((flippedView.pos(x) - flipped->pos(x)).norm() + (viewDer - der).norm(), 1e-8, "Incorrect flipped view");
+        }
     }
 };
 
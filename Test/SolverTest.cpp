@@ -0,0 +1,84 @@
+/*--
+    SolverTest.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Test.h"
+
+#include "Solver.h"
+
+using namespace std;
+using namespace Eigen;
+using namespace Cornu;
+
+class SolverTest : public TestCase
+{
+public:
+    //override
+    std::string name() { return "SolverTest"; }
+
+    //override
+    void run()
+    {
+        for(int control = LSSolver::HALVING; control <= LSSolver::TRUST_REGION; ++control)
+        {
+            //unconstrained, the minimum is at (1, 1)
+            VectorXd x = solve((LSSolver::StepControl)control, vector<LSBoxConstraint>());
+            CORNU_ASSERT_LT_MSG((x - Vector2d(1., 1.)).norm(), 1e-4, "Step control " << control << " ended at " << x.transpose());
+
+            //with x at most 0.5, the constraint is active at the minimum and y = x^2.
+            //Halving can shorten a step off the bound while the bound stays active, freezing x,
+            //so only the trust region is expected to get there from this start
+            if(control != LSSolver::TRUST_REGION)
+                continue;
+            vector<LSBoxConstraint> constraints(1, LSBoxConstraint(0, 0.5, -1));
+            x = solve((LSSolver::StepControl)control, constraints);
+            CORNU_ASSERT_LT_MSG((x - Vector2d(0.5, 0.25)).norm(), 1e-4, "Step control " << control << " ended at " << x.transpose());
+        }
+    }
+
+private:
+    //Rosenbrock's function as least squares: the errors are 10 (y - x^2) and 1 - x
+    class RosenbrockProblem : public LSProblem
+    {
+    public:
+        //overrides
+        LSEvalData *createEvalData() { return new LSDenseEvalData(); }
+        void eval(const VectorXd &x, LSEvalData *data)
+        {
+            LSDenseEvalData *denseData = static_cast<LSDenseEvalData *>(data);
+            VectorXd &err = denseData->errVectorRef();
+            MatrixXd &errDer = denseData->errDerRef();
+            err.resize(2);
+            errDer.resize(2, 2);
+            err << 10. * (x[1] - x[0] * x[0]), 1. - x[0];
+            errDer << -20. * x[0], 10., -1., 0.;
+        }
+    };
+
+    VectorXd solve(LSSolver::StepControl control, const vector<LSBoxConstraint> &constraints)
+    {
+        RosenbrockProblem problem;
+        LSSolver solver(&problem, constraints);
+        solver.setStepControl(control);
+        solver.setDefaultDamping(1e-3);
+        return solver.solve(Vector2d(-1.2, 1.));
+    }
+};
+
+static SolverTest test;
@@ -21,29 +21,32 @@
 #include "Test.h"
 #include "Debugging.h"
 #include <cstdio>
-#include <ctime>
+#include <cstdlib>
+#include <cstring>
 #include <cstdarg>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
 #include <map>
+#include <thread>
 
 using namespace std;
 using namespace Eigen;
 using namespace Cornu;
 
+typedef chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point start)
+{
+    return chrono::duration<double>(Clock::now() - start).count();
+}
+
+//Collects a test's output so tests running at the same time don't interleave theirs
 class DebuggingTestImpl : public Cornu::Debugging
 {
 public:
-    static DebuggingTestImpl *get()
-    {
-        //see if an instance exists
-        DebuggingTestImpl *cur = dynamic_cast<DebuggingTestImpl *>(Cornu::Debugging::get());
-        if(cur)
-            return cur;
-
-        //create new instance
-        cur = new DebuggingTestImpl();
-        Cornu::Debugging::set(cur);
-        return cur;
-    }
+    explicit DebuggingTestImpl(string *out) : _out(out), _indent(0) {}
 
     //overrides
     void printf(const char *fmt, ...)
@@ -58,14 +61,14 @@ public:
 
         va_end(ap);
 
-        for(int i = 0; i < _indent * 10; ++i)
-            std::printf(".");
-        std::printf("%s\n", buffer);
+        _out->append(_indent * 10, '.');
+        _out->append(buffer);
+        _out->append("\n");
     }
 
     void startTiming(const string &description)
     {
-        _startTimes[description] = clock();
+        _startTimes[description] = Clock::now();
     }
     void elapsedTime(const string &description = "")
     {
@@ -75,8 +78,7 @@ public:
 
             return;
         }
-        int diff = clock() - _startTimes[description];
-        printf("Timing: %20s   ---   %.3lf", description.c_str(), double(diff) / CLOCKS_PER_SEC);
+        printf("Timing: %20s   ---   %.3lf", description.c_str(), secondsSince(_startTimes[description]));
     }
 
     //not overrides
@@ -84,9 +86,8 @@ public:
     void unindent() { --_indent; }
 
 private:
-    DebuggingTestImpl() : _indent(0) {}
-
-    map<string, int> _startTimes; 
+    string *_out;
+    map<string, Clock::time_point> _startTimes;
     int _indent;
 };
 
@@ -102,46 +103,202 @@ struct TestComparator
     bool operator()(TestCase *t1, TestCase *t2) const { return t1->name() < t2->name(); }
 };
 
-int main()
+struct TestRun
 {
-    std::sort(TestCase::allTests().begin(), TestCase::allTests().end(), TestComparator());
+    TestRun() : test(NULL), failed(true), seconds(0), done(false) {}
 
-    DebuggingTestImpl::get()->printf("Starting tests\n");
+    TestCase *test;
+    string output;
+    bool failed;
+    double seconds;
+    Clock::time_point start;
+    atomic<bool> done; //set by the test's thread when it's finished with the rest
+    thread worker;
+};
 
-    bool anyFailed = false;
+//Each test runs on its own thread, which is what lets a runaway test be abandoned
+static void runTest(TestRun *run)
+{
+    DebuggingTestImpl debugging(&run->output);
+    Debugging::setForCurrentThread(&debugging);
 
-    for(int i = 0; i < (int)TestCase::allTests().size(); ++i)
+    string name = run->test->name();
+    debugging.printf("running %s", name.c_str());
+    debugging.startTiming(name);
+    debugging.indent();
+    try
+    {
+        run->test->run();
+        run->failed = false;
+    }
+    catch(Assertion)
     {
-        if(i > 0)
-            DebuggingTestImpl::get()->printf("");
+    }
+    catch(...)
+    {
+        debugging.printf("Exception thrown");
+    }
+    debugging.unindent();
+    debugging.elapsedTime(name);
+    run->seconds = secondsSince(run->start);
 
+    Debugging::setForCurrentThread(NULL);
+    run->done = true;
+}
+
+//A history file has a "name seconds" line for every test that passed in every run with it, oldest first
+static map<string, vector<double> > readHistory(const string &fileName)
+{
+    map<string, vector<double> > out;
+    ifstream in(fileName.c_str());
+    string name;
+    double seconds;
+    while(in >> name >> seconds)
+        out[name].push_back(seconds);
+    return out;
+}
+
+//The median of the last few runs, which a single noisy run doesn't move much; negative if there are too few
+static double typicalSeconds(const vector<double> &history)
+{
+    const int minRuns = 3, maxRuns = 5;
+    if((int)history.size() < minRuns)
+        return -1.;
+    vector<double> recent(history.end() - min((int)history.size(), maxRuns), history.end());
+    sort(recent.begin(), recent.end());
+    return recent[recent.size() / 2];
+}
+
+static int usage()
+{
+    std::printf("Usage: Test [-j THREADS] [-timeout SECONDS] [-history FILE] [-slowdown FACTOR] [NAME...]\n"
+                "  Runs the tests whose names contain any of the NAMEs (all of them if none are given).\n"
+                "  -j         number of tests to run at once (default: the number of cores)\n"
+                "  -timeout   a test taking longer fails (default 600, 0 for none)\n"
+                "  -history   compares each test's time with its earlier times in FILE and adds the new ones\n"
+                "  -slowdown  with -history, a test this many times slower than usual fails (default 1.5)\n");
+    return 2;
+}
+
+int main(int argc, char **argv)
+{
+    int numThreads = max(1, (int)thread::hardware_concurrency());
+    double timeout = 600., slowdown = 1.5;
+    string historyFile;
+    vector<string> filters;
+    for(int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(arg == "-j" && hasValue)
+            numThreads = max(1, atoi(argv[++i]));
+        else if(arg == "-timeout" && hasValue)
+            timeout = atof(argv[++i]);
+        else if(arg == "-history" && hasValue)
+            historyFile = argv[++i];
+        else if(arg == "-slowdown" && hasValue)
+            slowdown = atof(argv[++i]);
+        else if(arg[0] == '-')
+            return usage();
+        else
+            filters.push_back(arg);
+    }
+
+    std::sort(TestCase::allTests().begin(), TestCase::allTests().end(), TestComparator());
+    vector<TestCase *> tests;
+    for(int i = 0; i < (int)TestCase::allTests().size(); ++i)
+    {
         TestCase *test = TestCase::allTests()[i];
-        string name = test->name();
-        DebuggingTestImpl::get()->printf("running %s", name.c_str());
-        bool failed = true;
-        try
+        bool selected = filters.empty();
+        for(int j = 0; j < (int)filters.size(); ++j)
+            selected = selected || test->name().find(filters[j]) != string::npos;
+        if(selected)
+            tests.push_back(test);
+    }
+
+    map<string, vector<double> > history;
+    if(!historyFile.empty())
+        history = readHistory(historyFile);
+
+    std::printf("Starting tests\n\n");
+
+    //Tests start in name order as threads free up, and each one's output is printed in that order once it and
+    //the ones before it are done, so the output doesn't depend on how many run at once.
+    vector<TestRun> runs(tests.size());
+    vector<bool> finished(tests.size(), false), timedOut(tests.size(), false);
+    int numStarted = 0, numFinished = 0, numPrinted = 0;
+    bool anyFailed = false, anyTimedOut = false;
+    while(numPrinted < (int)runs.size())
+    {
+        while(numStarted < (int)runs.size() && numStarted - numFinished < numThreads)
         {
-            DebuggingTestImpl::get()->startTiming(name);
-            DebuggingTestImpl::get()->indent();
-            test->run();
-            failed = false;
-            DebuggingTestImpl::get()->unindent();
+            TestRun &run = runs[numStarted++];
+            run.test = tests[numStarted - 1];
+            run.start = Clock::now();
+            run.worker = thread(runTest, &run);
         }
-        catch(Assertion)
+
+        this_thread::sleep_for(chrono::milliseconds(1));
+
+        for(int i = numPrinted; i < numStarted; ++i)
         {
-            DebuggingTestImpl::get()->unindent();
+            if(finished[i])
+                continue;
+            if(runs[i].done)
+                runs[i].worker.join();
+            else if(timeout > 0. && secondsSince(runs[i].start) > timeout)
+            {
+                //there's no stopping a thread, so it's left running and the process exits without waiting for it
+                runs[i].worker.detach();
+                timedOut[i] = anyTimedOut = true;
+            }
+            else
+                continue;
+            finished[i] = true;
+            ++numFinished;
         }
-        catch(...)
+
+        for(; numPrinted < numStarted && finished[numPrinted]; ++numPrinted)
         {
-            DebuggingTestImpl::get()->unindent();
-            DebuggingTestImpl::get()->printf("Exception thrown");
+            TestRun &run = runs[numPrinted];
+            string name = run.test->name();
+            if(numPrinted > 0)
+                std::printf("\n");
+            if(timedOut[numPrinted])
+            {
+                std::printf("running %s\nTimed out after %g seconds\nFAILED! %s\n", name.c_str(), timeout, name.c_str());
+                anyFailed = true;
+                continue;
+            }
+
+            std::printf("%s", run.output.c_str());
+            double typical = history.count(name) ? typicalSeconds(history[name]) : -1.;
+            bool slow = !run.failed && typical > 0. && run.seconds > slowdown * typical
+                        && run.seconds - typical > 0.05; //too quick to time reliably otherwise
+            if(slow)
+                std::printf("Took %.3lf seconds, usually %.3lf\n", run.seconds, typical);
+            if(run.failed || slow)
+                std::printf("FAILED! %s\n", name.c_str());
+            else
+                std::printf("passed  %s\n", name.c_str());
+            fflush(stdout);
+            anyFailed = anyFailed || run.failed || slow;
         }
-        DebuggingTestImpl::get()->elapsedTime(name);
-        if(failed)
-            DebuggingTestImpl::get()->printf("FAILED! %s", name.c_str());
-        else
-            DebuggingTestImpl::get()->printf("passed  %s", name.c_str());
-        anyFailed = anyFailed || failed;
+    }
+
+    if(!historyFile.empty())
+    {
+        //slow runs are recorded too, so a slowdown that's accepted becomes the usual time after a few runs
+        ofstream out(historyFile.c_str(), ios::app);
+        for(int i = 0; i < (int)runs.size(); ++i)
+            if(!timedOut[i] && !runs[i].failed)
+                out << runs[i].test->name() << " " << runs[i].seconds << "\n";
+    }
+
+    if(anyTimedOut)
+    {
+        fflush(stdout);
+        _Exit(1); //the tests that timed out may still be running
     }
 
     return anyFailed ? 1 : 0;
@@ -69,6 +69,16 @@ struct Assertion {};
 #define CORNU_ASSERT_LT_MSG(EXPR, VAL, MSG) \
     CORNU_ASSERT_MSG((EXPR) < (VAL), (EXPR) << " > " << (VAL) << " " << MSG)
 
-inline double drand(double from, double to) { return from + (to - from) * double(rand() % RAND_MAX) / double(RAND_MAX); }
+//Random numbers for tests.  rand() (and Eigen's Random(), which calls it) shares its state between threads, so
+//tests, which may run in parallel, use a per-thread generator instead.  Each test starts on a new thread with
+//the same seed, so a test sees the same numbers however many run alongside it.
+inline unsigned &testRandState() { static thread_local unsigned state = 1; return state; }
+inline void seedTestRand(unsigned seed) { testRandState() = seed; }
+inline int irand(int n) //in [0, n)
+{
+    testRandState() = testRandState() * 1103515245u + 12345u;
+    return int((testRandState() >> 8) % unsigned(n));
+}
+inline double drand(double from, double to) { return from + (to - from) * double(irand(1 << 24)) / double(1 << 24); }
 
 #endif //CORNUCOPIA_TESTUTILS_H_INCLUDED
@@ -0,0 +1,232 @@
+/*--
+    Replay.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//A command line replay of a sketch file corpus (see SketchFile.h) for throughput testing and profiling:
+//the file is memory mapped and read in place, and its strokes are fitted across threads as fast as they go.
+//Unlike the rest of Tools, it doesn't use Qt.
+
+#include "SketchFile.h"
+#include "Fitter.h"
+#include "Polyline.h"
+#include "Parallel.h"
+#include "Algorithm.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace Cornu;
+
+static void usage()
+{
+    printf("Usage: CornucopiaReplay corpus.skf [-threads n] [-preset name] [-reps n]\n");
+    printf("   -threads the number of fitting threads, 0 for one per core (default)\n");
+    printf("   -preset  fit every stroke with this preset (by name or number) instead of its own parameters\n");
+    printf("   -reps    how many times to replay the corpus (default 1)\n");
+    printf("Oversketches are fitted as strokes of their own.  The exit code is 1 if the corpus can't be read.\n");
+}
+
+//the outcome of fitting one stroke once
+struct StrokeResult
+{
+    StrokeResult() : seconds(0.), failed(false) {}
+
+    double seconds; //from reading the stroke to having its curve
+    FitStats stats;
+    bool failed;
+};
+
+//Fits the strokes of the replay.  Each thread keeps one Fitter for all the strokes it fits (see Fitter::reset),
+//so the memory of the outputs is reused, as in FitServer.
+class _ReplayBody
+{
+public:
+    _ReplayBody(const SketchFileView &view, const vector<Parameters> &params, vector<StrokeResult> &results)
+        : _view(view), _params(params), _results(results) {}
+
+    void operator()(int job) const
+    {
+        static thread_local Fitter fitter;
+        int sketch = job % _view.numSketches();
+        StrokeResult &result = _results[job];
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        fitter.reset();
+        fitter.setParams(_params[sketch]);
+        fitter.setOriginalSketch(_view.polyline(sketch)); //the one copy of the points, which the fitter owns
+        result.stats = fitter.run();
+        result.failed = !fitter.finalOutput();
+        result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    const SketchFileView &_view;
+    const vector<Parameters> &_params; //by sketch
+    vector<StrokeResult> &_results; //by job: replay * numSketches + sketch
+};
+
+static string lowercase(string str)
+{
+    for(int i = 0; i < (int)str.size(); ++i)
+        str[i] = (char)tolower(str[i]);
+    return str;
+}
+
+//a preset matches its number, or its name with or without the part in parentheses, in any case
+static bool findPreset(const char *nameOrNumber, Parameters &out)
+{
+    const vector<Parameters> &presets = Parameters::presets();
+    string wanted = lowercase(nameOrNumber);
+    for(int i = 0; i < (int)presets.size(); ++i)
+    {
+        string name = lowercase(presets[i].name());
+        if(name == wanted || name.substr(0, name.find(" (")) == wanted || (isdigit(wanted[0]) && atoi(wanted.c_str()) == i))
+        {
+            out = presets[i];
+            return true;
+        }
+    }
+
+    printf("Unknown preset %s; the presets are:\n", nameOrNumber);
+    for(int i = 0; i < (int)presets.size(); ++i)
+        printf("   %d %s\n", i, presets[i].name().c_str());
+    return false;
+}
+
+static double percentile(const vector<double> &sorted, double p)
+{
+    return sorted[min((int)sorted.size() - 1, (int)(p * 0.01 * sorted.size()))];
+}
+
+static void report(const vector<StrokeResult> &results, double seconds, int numThreads, const Parameters &stageParams)
+{
+    vector<double> latencies;
+    FitStats sum;
+    long long peakBytes = 0;
+    int numFailed = 0, numDegraded = 0;
+    for(int i = 0; i < (int)results.size(); ++i)
+    {
+        const FitStats &stats = results[i].stats;
+        latencies.push_back(results[i].seconds * 1e3);
+        numFailed += results[i].failed;
+        numDegraded += stats.degraded;
+        sum.totalNanoseconds += stats.totalNanoseconds;
+        for(int stage = 0; stage < NUM_ALGORITHM_STAGES; ++stage)
+            sum.stageNanoseconds[stage] += stats.stageNanoseconds[stage];
+        peakBytes = max(peakBytes, stats.peakBytes);
+        sum.numResampledPoints += stats.numResampledPoints;
+        sum.numCandidatePrimitives += stats.numCandidatePrimitives;
+        sum.numGraphEdges += stats.numGraphEdges;
+        sum.numValidatedEdges += stats.numValidatedEdges;
+        sum.counters += stats.counters;
+    }
+    sort(latencies.begin(), latencies.end());
+
+    int n = (int)results.size();
+    printf("%d strokes on %d threads in %.3f s: %.1f strokes/s\n", n, numThreads, seconds, n / seconds);
+    printf("latency (ms): p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n",
+           percentile(latencies, 50), percentile(latencies, 90), percentile(latencies, 99), latencies.back());
+    printf("failed %d, degraded %d, largest peak output memory %.1f MB\n", numFailed, numDegraded, peakBytes / 1048576.);
+    printf("per stroke: %.1f resampled points, %.1f candidates, %.1f graph edges, %.1f validated edges\n",
+           double(sum.numResampledPoints) / n, double(sum.numCandidatePrimitives) / n,
+           double(sum.numGraphEdges) / n, double(sum.numValidatedEdges) / n);
+
+    printf("%-28s %12s %12s %8s\n", "stage", "total ms", "ms/stroke", "share");
+    for(int stage = 0; stage < NUM_ALGORITHM_STAGES; ++stage)
+    {
+        string name = AlgorithmBase::get((AlgorithmStage)stage, stageParams.getAlgorithm((AlgorithmStage)stage))->stageName();
+        double ms = sum.stageNanoseconds[stage] * 1e-6;
+        printf("%-28s %12.2f %12.4f %7.1f%%\n", name.c_str(), ms, ms / n, 100. * sum.stageNanoseconds[stage] / max(1LL, sum.totalNanoseconds));
+    }
+    printf("%-28s %12.2f %12.4f\n", "Total", sum.totalNanoseconds * 1e-6, sum.totalNanoseconds * 1e-6 / n);
+
+    for(int i = 0; i < WorkCounters::NUM_COUNTERS; ++i) //all zero unless CORNU_COUNTERS is on
+    {
+        if(sum.counters.counts[i] > 0)
+            printf("%-28s %12lld\n", WorkCounters::name((WorkCounters::Counter)i), sum.counters.counts[i]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *fileName = NULL;
+    int numThreads = 0;
+    int reps = 1;
+    Parameters preset;
+    bool usePreset = false;
+    for(int i = 1; i < argc; ++i)
+    {
+        if(!strcmp(argv[i], "-threads") && i + 1 < argc)
+            numThreads = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-reps") && i + 1 < argc)
+            reps = max(1, atoi(argv[++i]));
+        else if(!strcmp(argv[i], "-preset") && i + 1 < argc)
+        {
+            usePreset = findPreset(argv[++i], preset);
+            if(!usePreset)
+                return 1;
+        }
+        else if(argv[i][0] != '-' && !fileName)
+            fileName = argv[i];
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+    if(!fileName)
+    {
+        usage();
+        return 1;
+    }
+
+    MappedFile file(fileName);
+    SketchFileView view(file.data(), file.size());
+    if(!file.isOpen() || !view.isValid() || view.numSketches() == 0)
+    {
+        printf("Could not read a sketch file from %s\n", fileName);
+        return 1;
+    }
+
+    //the parameter sets are decoded once by the view; a sketch's are copied here so the threads don't
+    vector<Parameters> params(view.numSketches(), preset);
+    if(!usePreset)
+    {
+        for(int i = 0; i < view.numSketches(); ++i)
+            params[i] = view.parameters(i);
+    }
+
+    if(numThreads <= 0)
+        numThreads = numHardwareThreads();
+    vector<StrokeResult> results(reps * view.numSketches());
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    parallelFor((int)results.size(), _ReplayBody(view, params, results), numThreads);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    printf("%s, %s\n", fileName, usePreset ? preset.name().c_str() : "each stroke's own parameters");
+    report(results, seconds, numThreads, params[0]);
+    return 0;
+}
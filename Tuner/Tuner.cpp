@@ -0,0 +1,292 @@
+/*--
+    Tuner.cpp
+
+    This file is part of the Cornucopia curve sketching library.
+    Copyright (C) 2010 Ilya Baran (baran37@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//Searches for the internal parameters that fit a stroke corpus fastest while keeping the quality close to a
+//reference preset's, and prints the result as a preset for Parameters::_makePresets.
+//The quality of a fit is the RMS distance from the sketch points to the final curve and the number of
+//primitives.  A candidate is acceptable if, over the corpus, both are within the tolerance of the reference
+//and it fits every stroke the reference fits.  The search is coordinate descent over a grid of values for
+//each tuned parameter; the strokes are fitted in parallel.
+
+#include "Corpus.h"
+#include "Fitter.h"
+#include "PrimitiveSequence.h"
+#include "Parallel.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+using namespace Eigen;
+using namespace Cornu;
+
+struct TunedParameter
+{
+    Parameters::ParameterType type;
+    const char *enumName; //for printing the preset
+    vector<double> values;
+};
+
+static void addTuned(vector<TunedParameter> &out, Parameters::ParameterType type, const char *enumName, const double *values, int numValues)
+{
+    TunedParameter p;
+    p.type = type;
+    p.enumName = enumName;
+    p.values.assign(values, values + numValues);
+    out.push_back(p);
+}
+
+#define ADD_TUNED(OUT, TYPE, VALUES) addTuned(OUT, Parameters::TYPE, #TYPE, VALUES, sizeof(VALUES) / sizeof(double))
+
+//the parameters that mostly trade speed for quality, with the values tried
+static vector<TunedParameter> tunedParameters()
+{
+    static const double errorThreshold[] = { 1.5, 2., 3., 4., 5., 6., 8. };
+    static const double pointsPerCircle[] = { 10., 15., 20., 25., 30., 40. };
+    static const double maxSamplingInterval[] = { 20., 35., 50., 75., 100. };
+    static const double curvatureEstimateRegion[] = { 10., 15., 20., 30. };
+    static const double denseSamplingStep[] = { 0.5, 1., 1.5, 2. };
+    static const double reduceGraphEvery[] = { 1., 3., 10., 30. };
+    static const double maxEdgesPerVertex[] = { 0., 8., 16., 32. };
+    static const double fresnelTier[] = { 0., 1., 2. };
+    static const double validationEarlyStop[] = { 0., 1. };
+    static const double dominancePruning[] = { 0., 1. };
+    static const double candidateLengthsPerDoubling[] = { 0., 2., 4., 8. };
+    static const double fastSimpleStrokes[] = { 0., 1. };
+
+    vector<TunedParameter> out;
+    ADD_TUNED(out, ERROR_THRESHOLD, errorThreshold);
+    ADD_TUNED(out, POINTS_PER_CIRCLE, pointsPerCircle);
+    ADD_TUNED(out, MAX_SAMPLING_INTERVAL, maxSamplingInterval);
+    ADD_TUNED(out, CURVATURE_ESTIMATE_REGION, curvatureEstimateRegion);
+    ADD_TUNED(out, DENSE_SAMPLING_STEP, denseSamplingStep);
+    ADD_TUNED(out, REDUCE_GRAPH_EVERY, reduceGraphEvery);
+    ADD_TUNED(out, MAX_EDGES_PER_VERTEX, maxEdgesPerVertex);
+    ADD_TUNED(out, FRESNEL_TIER, fresnelTier);
+    ADD_TUNED(out, VALIDATION_EARLY_STOP, validationEarlyStop);
+    ADD_TUNED(out, DOMINANCE_PRUNING, dominancePruning);
+    ADD_TUNED(out, CANDIDATE_LENGTHS_PER_DOUBLING, candidateLengthsPerDoubling);
+    ADD_TUNED(out, FAST_SIMPLE_STROKES, fastSimpleStrokes);
+    return out;
+}
+
+struct StrokeResult
+{
+    double seconds; //the fastest of the repetitions
+    double sumDistSq; //over the sketch points
+    int numPoints;
+    int numPrimitives;
+    bool failed;
+};
+
+struct Evaluation
+{
+    double seconds;
+    double rmsError;
+    int numPrimitives;
+    vector<bool> failed;
+};
+
+class FitBody
+{
+public:
+    FitBody(const vector<CorpusStroke> &strokes, const Parameters &params, int reps, vector<StrokeResult> &out)
+        : _strokes(strokes), _params(params), _reps(reps), _out(out) {}
+
+    void operator()(int i) const
+    {
+        StrokeResult &result = _out[i];
+        result.seconds = 1e100;
+        for(int rep = 0; rep < _reps; ++rep)
+        {
+            Fitter fitter;
+            fitter.setParams(_params);
+            fitter.setOriginalSketch(_strokes[i].pts);
+            const FitStats &stats = fitter.run();
+            result.seconds = min(result.seconds, stats.totalNanoseconds * 1e-9);
+
+            if(rep > 0)
+                continue;
+            const VectorC<Vector2d> &pts = _strokes[i].pts->pts();
+            PrimitiveSequenceConstPtr curve = fitter.finalOutput();
+            result.failed = !curve;
+            result.numPoints = pts.size();
+            result.numPrimitives = curve ? curve->primitives().size() : 0;
+            result.sumDistSq = 0.;
+            for(int j = 0; curve && j < pts.size(); ++j)
+                result.sumDistSq += curve->distanceSqTo(pts[j]);
+        }
+    }
+
+private:
+    const vector<CorpusStroke> &_strokes;
+    const Parameters &_params;
+    int _reps;
+    vector<StrokeResult> &_out;
+};
+
+static Evaluation evaluate(const Parameters &params, int reps, int numThreads)
+{
+    const vector<CorpusStroke> &strokes = Corpus::strokes();
+    vector<StrokeResult> results(strokes.size());
+    parallelFor((int)strokes.size(), FitBody(strokes, params, reps, results), numThreads);
+
+    Evaluation out;
+    out.seconds = 0.;
+    out.numPrimitives = 0;
+    double sumDistSq = 0.;
+    int numPoints = 0;
+    for(int i = 0; i < (int)results.size(); ++i)
+    {
+        out.seconds += results[i].seconds;
+        out.numPrimitives += results[i].numPrimitives;
+        out.failed.push_back(results[i].failed);
+        if(results[i].failed)
+            continue;
+        sumDistSq += results[i].sumDistSq;
+        numPoints += results[i].numPoints;
+    }
+    out.rmsError = numPoints ? sqrt(sumDistSq / numPoints) : 0.;
+    return out;
+}
+
+static bool acceptable(const Evaluation &eval, const Evaluation &reference, double tolerance)
+{
+    for(int i = 0; i < (int)eval.failed.size(); ++i)
+        if(eval.failed[i] && !reference.failed[i])
+            return false;
+    return eval.rmsError <= (1. + tolerance) * reference.rmsError && eval.numPrimitives <= (1. + tolerance) * reference.numPrimitives;
+}
+
+static void printEvaluation(const char *what, const Evaluation &eval)
+{
+    printf("%-28s %9.2f ms, RMS error %.4f, %d primitives\n", what, eval.seconds * 1e3, eval.rmsError, eval.numPrimitives);
+}
+
+static void usage()
+{
+    printf("Usage: CornucopiaTune [-start PRESET] [-reference PRESET] [-tolerance T] [-reps N] [-threads N] [SKETCHFILE...]\n");
+    printf("  -start PRESET      the preset index to start the search from (default: the reference)\n");
+    printf("  -reference PRESET  the preset index whose quality is the bound (default %d, Accurate)\n", (int)Parameters::ACCURATE);
+    printf("  -tolerance T       how much worse than the reference the error and primitive count may be (default 0.05)\n");
+    printf("  -reps N            fits per stroke, the fastest is timed (default 3)\n");
+    printf("  -threads N         how many strokes are fitted at once (default 0, one per core)\n");
+    printf("  SKETCHFILE         sketch files (see SketchFile.h) whose strokes are added to the corpus\n");
+}
+
+int main(int argc, char **argv)
+{
+    int start = -1, reference = Parameters::ACCURATE, reps = 3, numThreads = 0;
+    double tolerance = 0.05;
+    for(int i = 1; i < argc; ++i)
+    {
+        if(!strcmp(argv[i], "-start") && i + 1 < argc)
+            start = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-reference") && i + 1 < argc)
+            reference = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "-tolerance") && i + 1 < argc)
+            tolerance = atof(argv[++i]);
+        else if(!strcmp(argv[i], "-reps") && i + 1 < argc)
+            reps = max(1, atoi(argv[++i]));
+        else if(!strcmp(argv[i], "-threads") && i + 1 < argc)
+            numThreads = atoi(argv[++i]);
+        else if(argv[i][0] == '-')
+        {
+            usage();
+            return 1;
+        }
+        else if(!Corpus::addSketchFile(argv[i]))
+        {
+            printf("Could not read sketch file %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if(start < 0)
+        start = reference;
+    if(reference < 0 || reference >= Parameters::NUM_PRESETS || start >= Parameters::NUM_PRESETS)
+    {
+        usage();
+        return 1;
+    }
+
+    const Parameters &referenceParams = Parameters::presets()[reference];
+    const Parameters &startParams = Parameters::presets()[start];
+    printf("%d strokes; reference %s, starting from %s\n", (int)Corpus::strokes().size(), referenceParams.name().c_str(), startParams.name().c_str());
+
+    evaluate(referenceParams, 1, numThreads); //warm up
+    Evaluation referenceEval = evaluate(referenceParams, reps, numThreads);
+    printEvaluation("reference", referenceEval);
+
+    Parameters best = startParams;
+    Evaluation bestEval = evaluate(best, reps, numThreads);
+    printEvaluation("start", bestEval);
+    if(!acceptable(bestEval, referenceEval, tolerance))
+        printf("The starting parameters are outside the quality bound--only changes that are within it are taken\n");
+
+    //a change has to be this much faster to be taken, so timing noise doesn't make the search wander
+    const double minImprovement = 0.03;
+    const int maxPasses = 3;
+    vector<TunedParameter> tuned = tunedParameters();
+    for(int pass = 0; pass < maxPasses; ++pass)
+    {
+        bool changed = false;
+        for(int i = 0; i < (int)tuned.size(); ++i)
+        {
+            double current = best.get(tuned[i].type);
+            double bestValue = current;
+            for(int j = 0; j < (int)tuned[i].values.size(); ++j)
+            {
+                if(tuned[i].values[j] == current)
+                    continue;
+                Parameters candidate = best;
+                candidate.set(tuned[i].type, tuned[i].values[j]);
+                Evaluation eval = evaluate(candidate, reps, numThreads);
+                if(acceptable(eval, referenceEval, tolerance) && eval.seconds < (1. - minImprovement) * bestEval.seconds)
+                {
+                    bestEval = eval;
+                    bestValue = tuned[i].values[j];
+                }
+            }
+            if(bestValue != current)
+            {
+                best.set(tuned[i].type, bestValue);
+                changed = true;
+                char what[100];
+                sprintf(what, "%s = %g", tuned[i].enumName, bestValue);
+                printEvaluation(what, bestEval);
+            }
+        }
+        if(!changed)
+            break;
+    }
+
+    printf("\nSpeedup over the start: %.2fx\n\n", (evaluate(startParams, reps, numThreads).seconds / evaluate(best, reps, numThreads).seconds));
+    printf("    //Tuned from %s for speed within %g of %s on %d strokes\n", startParams.name().c_str(), tolerance, referenceParams.name().c_str(), (int)Corpus::strokes().size());
+    static const char *presetEnumNames[Parameters::NUM_PRESETS] = { "DEFAULT", "LOOSE", "ACCURATE", "POLYLINE", "LINES_AND_ARCS", "CLOTHOID_ONLY" };
+    printf("    Parameters tuned = out[%s];\n", presetEnumNames[start]);
+    printf("    tuned._name = \"Tuned\";\n");
+    for(int i = 0; i < (int)tuned.size(); ++i)
+        if(best.get(tuned[i].type) != startParams.get(tuned[i].type))
+            printf("    tuned.set(%s, %g);\n", tuned[i].enumName, best.get(tuned[i].type));
+
+    return 0;
+}